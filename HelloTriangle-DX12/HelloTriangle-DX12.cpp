@@ -3,14 +3,41 @@
 #include <iostream>
 #include <d3d12.h>
 #include <d3d12sdklayers.h>
+#include <d3dcompiler.h>
 #include <dxgi1_6.h>
 #include <glfw/glfw3.h>
 #include <glfw/glfw3native.h>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include "glm/trigonometric.hpp"
 #include "glm/vec3.hpp"
 #include <fstream>
 #include <chrono>
 #include <wrl.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "command_bundle.h"
+#include "deferred_release.h"
+#include "file_io.h"
+#include "frame_mailbox.h"
+#include "frame_packet.h"
+#include "light_clusters.h"
+#include "mesh_codec.h"
+#include "mesh_cooker.h"
+#include "mesh_format.h"
+#include "occlusion_culling.h"
+#include "overlay.h"
+#include "particles.h"
+#include "projection.h"
+#include "scene.h"
+#include "shader_reload.h"
+#include "upload_ring.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -20,14 +47,85 @@ void throw_if_failed(const HRESULT hr) {
     }
 }
 
+D3D12_RESOURCE_BARRIER transition_barrier(ID3D12Resource* resource, const D3D12_RESOURCE_STATES before, const D3D12_RESOURCE_STATES after) {
+    D3D12_RESOURCE_BARRIER barrier;
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.Transition.pResource = resource;
+    barrier.Transition.StateBefore = before;
+    barrier.Transition.StateAfter = after;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    return barrier;
+}
+
+DXGI_FORMAT dxgi_format(const VertexFormat format) {
+    switch (format) {
+        case VertexFormat::float2: return DXGI_FORMAT_R32G32_FLOAT;
+        case VertexFormat::float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+        case VertexFormat::float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case VertexFormat::unorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
+
 constexpr uint32_t width = 1280;
 constexpr uint32_t height = 720;
 static constexpr UINT backbuffer_count = 2;
 
-void read_file(const std::string& path, size_t& size_bytes, char*& data, bool silent);
-
-int main()
+int main(int argc, char** argv)
 {
+    // Command line: [mesh file] [--lights count] [--validate-lights] [--particles emitters] [--gpu-particles]
+    // [--validate-particles] [--hot-reload shader source directory] [--crowd count] [--validate-occlusion]
+    // [--no-occlusion-culling], where validating the particles means simulating them on the GPU, hot reload rebuilds
+    // the pipelines when their shaders in that directory change, and the crowd is that many more copies of the mesh,
+    // for the occlusion culling. Without occlusion culling, the draws are recorded into a bundle.
+    const char* mesh_path = nullptr;
+    uint32_t light_count = 2048;
+    bool validate_lights = false;
+    uint32_t particle_emitter_count = 16384;
+    bool gpu_particles = false;
+    bool validate_particles = false;
+    const char* shader_source_directory = nullptr;
+    uint32_t crowd_count = 0;
+    bool validate_occlusion = false;
+    bool disable_occlusion_culling = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+            const unsigned long requested = strtoul(argv[++i], nullptr, 10);
+            light_count = requested < max_cluster_lights ? static_cast<uint32_t>(requested) : max_cluster_lights;
+        }
+        else if (strcmp(argv[i], "--validate-lights") == 0) {
+            validate_lights = true;
+        }
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+            const unsigned long requested = strtoul(argv[++i], nullptr, 10);
+            particle_emitter_count = requested < 65536 ? static_cast<uint32_t>(requested) : 65536;
+        }
+        else if (strcmp(argv[i], "--gpu-particles") == 0) {
+            gpu_particles = true;
+        }
+        else if (strcmp(argv[i], "--validate-particles") == 0) {
+            gpu_particles = true;
+            validate_particles = true;
+        }
+        else if (strcmp(argv[i], "--hot-reload") == 0 && i + 1 < argc) {
+            shader_source_directory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--crowd") == 0 && i + 1 < argc) {
+            const unsigned long requested = strtoul(argv[++i], nullptr, 10);
+            crowd_count = requested < max_occlusion_objects - 1 ? static_cast<uint32_t>(requested) : max_occlusion_objects - 1;
+        }
+        else if (strcmp(argv[i], "--validate-occlusion") == 0) {
+            validate_occlusion = true;
+        }
+        else if (strcmp(argv[i], "--no-occlusion-culling") == 0) {
+            disable_occlusion_culling = true;
+        }
+        else if (mesh_path == nullptr) {
+            mesh_path = argv[i];
+        }
+    }
+
     // Create window - use GLFW_NO_API, since we're not using OpenGL
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -120,26 +218,40 @@ int main()
     throw_if_failed(device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&command_queue)));
 
     /* COMMAND ALLOCATOR:
-    * A command allocator is used to create command lists
+    * A command allocator is used to create command lists. The memory of the commands stays in use until the GPU is
+    * done with them, so every backbuffer gets its own, and it's reset when its backbuffer comes around again.
     */
-    ComPtr<ID3D12CommandAllocator> command_allocator;
-    throw_if_failed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, 
-                                                   IID_PPV_ARGS(&command_allocator)));
+    ComPtr<ID3D12CommandAllocator> command_allocators[backbuffer_count];
+    for (auto& command_allocator : command_allocators) {
+        throw_if_failed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                       IID_PPV_ARGS(&command_allocator)));
+    }
 
     /* FENCE:
     * A fence is used for synchronization between CPU and GPU, and lets you know when the GPU is done
     * with its tasks (e.g. uploads, rendering,) so you can send more commands.
     */
 
-    // Create fence
+    // Signaled after every frame with the frame's number. Objects that frames in flight might still use go into the
+    // release queue, tagged with the number of the frame being recorded, and are released once the GPU is done with
+    // that frame (see deferred_release.h).
     UINT frame_index;
     HANDLE fence_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    ComPtr<ID3D12Fence> fences[backbuffer_count];
-    UINT64 fence_values[backbuffer_count];
-    for (unsigned i = 0u; i < backbuffer_count; ++i) {
-        throw_if_failed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fences[i])));
-        fence_values[i] = 0;
-    }
+    ComPtr<ID3D12Fence> frame_fence;
+    UINT64 frame_fence_value = 0;
+    throw_if_failed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&frame_fence)));
+    DeferredReleaseQueue release_queue;
+    constexpr size_t release_budget_per_frame = 64;
+
+    // The number of the last frame that rendered to each backbuffer. Before a backbuffer is used again, the CPU waits
+    // for that frame, and only for that one, so it can record the next frame while the GPU renders the one before.
+    UINT64 backbuffer_frames[backbuffer_count] = {};
+    const auto wait_for_frame = [&](const UINT64 frame) {
+        if (frame_fence->GetCompletedValue() < frame) {
+            throw_if_failed(frame_fence->SetEventOnCompletion(frame, fence_event));
+            WaitForSingleObject(fence_event, INFINITE);
+        }
+    };
 
     /* BARRIER:
     * A barrier is used for resources, to determine how the driver should access it.
@@ -232,6 +344,62 @@ int main()
         }
     }
 
+    /* DEPTH BUFFER
+    * The depth buffer stores how far away the closest surface is for every pixel, so triangles behind it can
+    * be thrown away before the pixel shader runs. It needs its own descriptor heap, since a Depth Stencil View
+    * can't live in the same heap as the Render Target Views. It has the same size as the swapchain.
+    *
+    * We use reverse-Z (see projection.h): the depth buffer is cleared to 0, and closer surfaces have higher values.
+    * The occlusion culling reads it too, to build the depth pyramid, so the resource is typeless: the Depth Stencil
+    * View sees it as D32_FLOAT, and the Shader Resource View (see OCCLUSION BUFFERS) as R32_FLOAT.
+    */
+
+    // Create depth stencil view heap
+    ComPtr<ID3D12DescriptorHeap> depth_stencil_view_heap;
+    ComPtr<ID3D12Resource> depth_buffer;
+    D3D12_DESCRIPTOR_HEAP_DESC depth_stencil_view_heap_desc{};
+    depth_stencil_view_heap_desc.NumDescriptors = 1;
+    depth_stencil_view_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    depth_stencil_view_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    throw_if_failed(device->CreateDescriptorHeap(&depth_stencil_view_heap_desc, IID_PPV_ARGS(&depth_stencil_view_heap)));
+
+    // Create the depth buffer itself
+    {
+        D3D12_HEAP_PROPERTIES default_heap_props = {
+            D3D12_HEAP_TYPE_DEFAULT, // Only the GPU touches the depth buffer
+            D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            D3D12_MEMORY_POOL_UNKNOWN, 1, 1 };
+
+        D3D12_RESOURCE_DESC depth_buffer_desc = {
+            D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            0,
+            swapchain_desc.Width, // Same size as the backbuffers
+            swapchain_desc.Height,
+            1,
+            1,
+            DXGI_FORMAT_R32_TYPELESS,
+            {1, 0}, // Must match the sample count of the render target
+            D3D12_TEXTURE_LAYOUT_UNKNOWN, // Let the driver pick the fastest layout
+            D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL,
+        };
+
+        // Telling the driver what we'll clear to lets it use fast clears
+        D3D12_CLEAR_VALUE depth_clear_value{};
+        depth_clear_value.Format = DXGI_FORMAT_D32_FLOAT;
+        depth_clear_value.DepthStencil.Depth = reverse_z_clear_depth;
+        depth_clear_value.DepthStencil.Stencil = 0;
+
+        throw_if_failed(device->CreateCommittedResource(&default_heap_props, D3D12_HEAP_FLAG_NONE, &depth_buffer_desc,
+            D3D12_RESOURCE_STATE_DEPTH_WRITE, &depth_clear_value, IID_PPV_ARGS(&depth_buffer)));
+        depth_buffer->SetName(L"Depth Buffer");
+
+        D3D12_DEPTH_STENCIL_VIEW_DESC depth_stencil_view_desc{};
+        depth_stencil_view_desc.Format = DXGI_FORMAT_D32_FLOAT;
+        depth_stencil_view_desc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+        depth_stencil_view_desc.Flags = D3D12_DSV_FLAG_NONE;
+        device->CreateDepthStencilView(depth_buffer.Get(), &depth_stencil_view_desc, depth_stencil_view_heap->GetCPUDescriptorHandleForHeapStart());
+    }
+
     /* ROOT SIGNATURE
     * A root signature is an object that defines which resource parameters your
     * shaders have access to, like constant buffers, structured buffers, textures and samplers
@@ -264,13 +432,30 @@ int main()
     * and holds a pointer to an array of ranges
     */
 
-    // Bind the descriptor ranges to the descriptor table of the root signature
-    D3D12_ROOT_PARAMETER1 root_parameters[1];
+    // Bind the descriptor ranges to the descriptor table of the root signature. The pixel shader needs the
+    // constants too, to find its cluster of lights.
+    D3D12_ROOT_PARAMETER1 root_parameters[6];
     root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
     root_parameters[0].DescriptorTable.NumDescriptorRanges = 1;
     root_parameters[0].DescriptorTable.pDescriptorRanges = ranges;
 
+    // The cluster ranges, the cluster light indices and the lights (t0 to t2), as root descriptors, so they don't
+    // need a descriptor heap
+    for (UINT i = 1; i < 4; ++i) {
+        root_parameters[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        root_parameters[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        root_parameters[i].Descriptor = { i - 1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+    }
+
+    // The world transforms of the draws (t3), and which one a draw uses (b1), set before every draw
+    root_parameters[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    root_parameters[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+    root_parameters[4].Descriptor = { 3, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+    root_parameters[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    root_parameters[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+    root_parameters[5].Constants = { 1, 0, 1 };
+
     /* ROOT SIGNATURE DESCRIPTION
     * Determines the number of parameters, the number of samplers, and holds pointers to 
     * said parameters and samplers.
@@ -280,7 +465,7 @@ int main()
     D3D12_VERSIONED_ROOT_SIGNATURE_DESC root_signature_desc;
     root_signature_desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
     root_signature_desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-    root_signature_desc.Desc_1_1.NumParameters = 1;
+    root_signature_desc.Desc_1_1.NumParameters = _countof(root_parameters);
     root_signature_desc.Desc_1_1.pParameters = root_parameters;
     root_signature_desc.Desc_1_1.NumStaticSamplers = 0;
     root_signature_desc.Desc_1_1.pStaticSamplers = nullptr;
@@ -315,6 +500,180 @@ int main()
         signature = nullptr;
     }
 
+    /* COMPUTE ROOT SIGNATURE
+    * The light assignment shaders (see light_clusters.hlsli) get everything as root descriptors: the constants (b0),
+    * the lights and the cluster bounds they read (t0, t1), and the bitmasks, ranges and light indices they write
+    * (u0 to u2).
+    */
+    ComPtr<ID3D12RootSignature> compute_root_signature = nullptr;
+    {
+        constexpr D3D12_ROOT_PARAMETER_TYPE compute_parameter_types[] = {
+            D3D12_ROOT_PARAMETER_TYPE_CBV,
+            D3D12_ROOT_PARAMETER_TYPE_SRV, D3D12_ROOT_PARAMETER_TYPE_SRV,
+            D3D12_ROOT_PARAMETER_TYPE_UAV, D3D12_ROOT_PARAMETER_TYPE_UAV, D3D12_ROOT_PARAMETER_TYPE_UAV,
+        };
+        constexpr UINT compute_parameter_registers[] = { 0, 0, 1, 0, 1, 2 };
+        D3D12_ROOT_PARAMETER1 compute_root_parameters[_countof(compute_parameter_types)];
+        for (UINT i = 0; i < _countof(compute_root_parameters); ++i) {
+            compute_root_parameters[i].ParameterType = compute_parameter_types[i];
+            compute_root_parameters[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+            compute_root_parameters[i].Descriptor = { compute_parameter_registers[i], 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+        }
+
+        D3D12_VERSIONED_ROOT_SIGNATURE_DESC compute_root_signature_desc{};
+        compute_root_signature_desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+        compute_root_signature_desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+        compute_root_signature_desc.Desc_1_1.NumParameters = _countof(compute_root_parameters);
+        compute_root_signature_desc.Desc_1_1.pParameters = compute_root_parameters;
+
+        ComPtr<ID3DBlob> compute_signature;
+        ComPtr<ID3DBlob> compute_error;
+        if (FAILED(D3D12SerializeVersionedRootSignature(&compute_root_signature_desc, &compute_signature, &compute_error))) {
+            std::cout << static_cast<const char*>(compute_error->GetBufferPointer());
+            throw std::exception();
+        }
+        throw_if_failed(device->CreateRootSignature(0, compute_signature->GetBufferPointer(),
+                        compute_signature->GetBufferSize(), IID_PPV_ARGS(&compute_root_signature)));
+        compute_root_signature->SetName(L"Light Cluster Root Signature");
+    }
+
+    /* PARTICLE ROOT SIGNATURE
+    * The particle simulation shaders (see particles.hlsli) get their constants as root constants (b0), and their
+    * buffers as root descriptors: the emitters and the spawn plan they read (t0, t1), and the two particle buffers,
+    * the slots, the group offsets and the particle state they write (u0 to u4).
+    */
+    ComPtr<ID3D12RootSignature> particle_root_signature = nullptr;
+    {
+        D3D12_ROOT_PARAMETER1 particle_root_parameters[8];
+        particle_root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        particle_root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        particle_root_parameters[0].Constants = { 0, 0, 7 };
+        for (UINT i = 1; i < _countof(particle_root_parameters); ++i) {
+            particle_root_parameters[i].ParameterType = i < 3 ? D3D12_ROOT_PARAMETER_TYPE_SRV : D3D12_ROOT_PARAMETER_TYPE_UAV;
+            particle_root_parameters[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+            particle_root_parameters[i].Descriptor = { i < 3 ? i - 1 : i - 3, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+        }
+
+        D3D12_VERSIONED_ROOT_SIGNATURE_DESC particle_root_signature_desc{};
+        particle_root_signature_desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+        particle_root_signature_desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+        particle_root_signature_desc.Desc_1_1.NumParameters = _countof(particle_root_parameters);
+        particle_root_signature_desc.Desc_1_1.pParameters = particle_root_parameters;
+
+        ComPtr<ID3DBlob> particle_signature;
+        ComPtr<ID3DBlob> particle_error;
+        if (FAILED(D3D12SerializeVersionedRootSignature(&particle_root_signature_desc, &particle_signature, &particle_error))) {
+            std::cout << static_cast<const char*>(particle_error->GetBufferPointer());
+            throw std::exception();
+        }
+        throw_if_failed(device->CreateRootSignature(0, particle_signature->GetBufferPointer(),
+                        particle_signature->GetBufferSize(), IID_PPV_ARGS(&particle_root_signature)));
+        particle_root_signature->SetName(L"Particle Root Signature");
+    }
+
+    /* OVERLAY ROOT SIGNATURE
+    * The overlay shaders only need where the pixels go, as root constants (b0), and the texture of the batch (t0),
+    * as a descriptor table, so every batch just points the table at its texture. The sampler never changes, so it's
+    * a static sampler.
+    */
+    ComPtr<ID3D12RootSignature> overlay_root_signature = nullptr;
+    {
+        D3D12_DESCRIPTOR_RANGE1 overlay_texture_range{};
+        overlay_texture_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        overlay_texture_range.NumDescriptors = 1;
+        overlay_texture_range.BaseShaderRegister = 0;
+        overlay_texture_range.RegisterSpace = 0;
+        overlay_texture_range.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+        overlay_texture_range.OffsetInDescriptorsFromTableStart = 0;
+
+        D3D12_ROOT_PARAMETER1 overlay_root_parameters[2];
+        overlay_root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        overlay_root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+        overlay_root_parameters[0].Constants = { 0, 0, 4 };
+        overlay_root_parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        overlay_root_parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        overlay_root_parameters[1].DescriptorTable = { 1, &overlay_texture_range };
+
+        D3D12_STATIC_SAMPLER_DESC overlay_sampler{};
+        overlay_sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+        overlay_sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        overlay_sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        overlay_sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        overlay_sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+        overlay_sampler.MaxLOD = D3D12_FLOAT32_MAX;
+        overlay_sampler.ShaderRegister = 0;
+        overlay_sampler.RegisterSpace = 0;
+        overlay_sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        D3D12_VERSIONED_ROOT_SIGNATURE_DESC overlay_root_signature_desc{};
+        overlay_root_signature_desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+        overlay_root_signature_desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+        overlay_root_signature_desc.Desc_1_1.NumParameters = _countof(overlay_root_parameters);
+        overlay_root_signature_desc.Desc_1_1.pParameters = overlay_root_parameters;
+        overlay_root_signature_desc.Desc_1_1.NumStaticSamplers = 1;
+        overlay_root_signature_desc.Desc_1_1.pStaticSamplers = &overlay_sampler;
+
+        ComPtr<ID3DBlob> overlay_signature;
+        ComPtr<ID3DBlob> overlay_error;
+        if (FAILED(D3D12SerializeVersionedRootSignature(&overlay_root_signature_desc, &overlay_signature, &overlay_error))) {
+            std::cout << static_cast<const char*>(overlay_error->GetBufferPointer());
+            throw std::exception();
+        }
+        throw_if_failed(device->CreateRootSignature(0, overlay_signature->GetBufferPointer(),
+                        overlay_signature->GetBufferSize(), IID_PPV_ARGS(&overlay_root_signature)));
+        overlay_root_signature->SetName(L"Overlay Root Signature");
+    }
+
+    /* OCCLUSION ROOT SIGNATURE
+    * The occlusion culling shaders (see occlusion_culling.hlsli) get the level or the phase as a root constant (b0),
+    * the constants (b1), the depth buffer (t0) as a descriptor table, since textures can't be root descriptors, and
+    * the rest as root descriptors: the objects and the transforms they read (t1, t2), and the depth pyramid, the
+    * visibility, the draws and the counters they write (u0 to u3). The depth buffer is written between the dispatches
+    * that read it, so its data is volatile.
+    */
+    ComPtr<ID3D12RootSignature> occlusion_root_signature = nullptr;
+    {
+        D3D12_DESCRIPTOR_RANGE1 depth_buffer_range{};
+        depth_buffer_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        depth_buffer_range.NumDescriptors = 1;
+        depth_buffer_range.BaseShaderRegister = 0;
+        depth_buffer_range.RegisterSpace = 0;
+        depth_buffer_range.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+        depth_buffer_range.OffsetInDescriptorsFromTableStart = 0;
+
+        D3D12_ROOT_PARAMETER1 occlusion_root_parameters[9];
+        occlusion_root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        occlusion_root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        occlusion_root_parameters[0].Constants = { 0, 0, 1 };
+        occlusion_root_parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+        occlusion_root_parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        occlusion_root_parameters[1].Descriptor = { 1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+        occlusion_root_parameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        occlusion_root_parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        occlusion_root_parameters[2].DescriptorTable = { 1, &depth_buffer_range };
+        for (UINT i = 3; i < _countof(occlusion_root_parameters); ++i) {
+            occlusion_root_parameters[i].ParameterType = i < 5 ? D3D12_ROOT_PARAMETER_TYPE_SRV : D3D12_ROOT_PARAMETER_TYPE_UAV;
+            occlusion_root_parameters[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+            occlusion_root_parameters[i].Descriptor = { i < 5 ? i - 2 : i - 5, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+        }
+
+        D3D12_VERSIONED_ROOT_SIGNATURE_DESC occlusion_root_signature_desc{};
+        occlusion_root_signature_desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+        occlusion_root_signature_desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+        occlusion_root_signature_desc.Desc_1_1.NumParameters = _countof(occlusion_root_parameters);
+        occlusion_root_signature_desc.Desc_1_1.pParameters = occlusion_root_parameters;
+
+        ComPtr<ID3DBlob> occlusion_signature;
+        ComPtr<ID3DBlob> occlusion_error;
+        if (FAILED(D3D12SerializeVersionedRootSignature(&occlusion_root_signature_desc, &occlusion_signature, &occlusion_error))) {
+            std::cout << static_cast<const char*>(occlusion_error->GetBufferPointer());
+            throw std::exception();
+        }
+        throw_if_failed(device->CreateRootSignature(0, occlusion_signature->GetBufferPointer(),
+                        occlusion_signature->GetBufferSize(), IID_PPV_ARGS(&occlusion_root_signature)));
+        occlusion_root_signature->SetName(L"Occlusion Culling Root Signature");
+    }
+
     /* HEAP
     * A heap is a sort of gateway to GPU memory, which you can use to upload buffers or 
     * textures to the GPU.
@@ -338,20 +697,59 @@ int main()
         2
     };
 
+    /* MESH
+    * Geometry is drawn from a mesh file (see mesh_format.h), which is made by the MeshCooker tool. Its sections
+    * are already in the layout the GPU wants, and aligned for it, so they're copied into the upload buffer, or
+    * decoded straight into it if they're compressed, and the vertex and index buffer views point into it.
+    * Nothing gets parsed.
+    * A mesh file can be passed on the command line. Without one, we cook the triangle above in memory.
+    */
+    MappedFile mesh_file;
+    std::vector<uint8_t> cooked_triangle;
+    MeshView mesh;
+    const MeshSectionHeader* mesh_lod_section = nullptr;
+    const MeshSectionHeader* mesh_index_section = nullptr;
+    const auto find_mesh_sections = [&]() {
+        mesh_lod_section = mesh.find_section(MeshSectionType::lods);
+        mesh_index_section = mesh.find_section(MeshSectionType::indices);
+        return mesh_lod_section != nullptr && mesh_index_section != nullptr;
+    };
+    if (mesh_path == nullptr || !mesh_file.open(mesh_path, false) || !open_mesh_view(mesh_file.data(), mesh_file.size(), mesh)
+        || !find_mesh_sections()) {
+        if (mesh_path != nullptr) {
+            printf("[ERROR] Can't draw mesh file %s, drawing a triangle instead\n", mesh_path);
+        }
+        MeshSource triangle;
+        for (const Vertex& vertex : triangle_verts) {
+            triangle.positions.push_back(vertex.pos);
+            triangle.colors.push_back(vertex.color);
+        }
+        triangle.indices.assign(std::begin(triangle_indices), std::end(triangle_indices));
+        MeshCookSettings triangle_settings;
+        triangle_settings.max_lod_count = 1;
+        triangle_settings.build_meshlets = false;
+        if (!cook_mesh(triangle, triangle_settings, cooked_triangle) || !open_mesh_view(cooked_triangle.data(), cooked_triangle.size(), mesh)
+            || !find_mesh_sections()) {
+            throw std::exception();
+        }
+    }
+    const MeshLod mesh_lod = mesh.section_data<MeshLod>(*mesh_lod_section)[0];
+
     /* VERTEX BUFFER VIEW
     * Similar to a VAO in OpenGL. It has the GPU address of the buffer, the size of the buffer, and the stride
-    * of each vertex entry of the buffer.
+    * of each vertex entry of the buffer. The mesh has a separate buffer for every vertex stream, and they're all
+    * in the same resource as the indices.
     */
 
     // Declare handles
-    ComPtr<ID3D12Resource> vertex_buffer;
-    D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
+    ComPtr<ID3D12Resource> mesh_buffer;
+    std::vector<D3D12_VERTEX_BUFFER_VIEW> vertex_buffer_views;
 
     // Only the GPU needs this data, the CPU won't need this
-    D3D12_RANGE vertex_range{ 0, 0 };
-    uint8_t* vertex_data_begin;
+    D3D12_RANGE mesh_range{ 0, 0 };
+    uint8_t* mesh_data_begin;
 
-    // Upload vertex buffer to GPU
+    // Upload the mesh to the GPU
     {
         D3D12_HEAP_PROPERTIES upload_heap_props = {
             D3D12_HEAP_TYPE_UPLOAD, // The heap will be used to upload data to the GPU
@@ -361,7 +759,7 @@ int main()
         D3D12_RESOURCE_DESC upload_buffer_desc = {
             D3D12_RESOURCE_DIMENSION_BUFFER, // Can either be texture or buffer, we want a buffer
             0,
-            sizeof(triangle_verts),
+            mesh.header->upload_size,
             1,
             1,
             1,
@@ -373,80 +771,62 @@ int main()
 
 
         throw_if_failed(device->CreateCommittedResource(&upload_heap_props, D3D12_HEAP_FLAG_NONE, &upload_buffer_desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, __uuidof(ID3D12Resource), &vertex_buffer));
-
-        // Bind the vertex buffer, copy the data to it, then unbind the vertex buffer
-        throw_if_failed(vertex_buffer->Map(0, &vertex_range, reinterpret_cast<void**>(&vertex_data_begin)));
-        memcpy_s(vertex_data_begin, sizeof(triangle_verts), triangle_verts, sizeof(triangle_verts));
-        vertex_buffer->Unmap(0, nullptr);
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, __uuidof(ID3D12Resource), &mesh_buffer));
+
+        // Bind the mesh buffer, copy or decode every section into it, then unbind the mesh buffer
+        throw_if_failed(mesh_buffer->Map(0, &mesh_range, reinterpret_cast<void**>(&mesh_data_begin)));
+        const bool mesh_copied = copy_mesh_sections(mesh, mesh_data_begin);
+        mesh_buffer->Unmap(0, nullptr);
+        if (!mesh_copied) {
+            throw std::exception();
+        }
 
-        // Init the buffer view
-        vertex_buffer_view = D3D12_VERTEX_BUFFER_VIEW{
-            vertex_buffer->GetGPUVirtualAddress(),
-            sizeof(triangle_verts),
-            sizeof(Vertex),
-        }; 
+        // Init the buffer views, one per vertex stream
+        for (uint32_t stream = 0; const MeshSectionHeader* section = mesh.find_section(MeshSectionType::vertex_stream, stream); ++stream) {
+            vertex_buffer_views.push_back(D3D12_VERTEX_BUFFER_VIEW{
+                mesh_buffer->GetGPUVirtualAddress() + section->offset,
+                static_cast<UINT>(section->size),
+                section->element_size,
+            });
+        }
     }
 
     /* INDEX BUFFER VIEW
     * Same idea as vertex buffer view, except the data integers
     */
 
-    // Declare handles
-    ComPtr<ID3D12Resource> index_buffer;
-    D3D12_INDEX_BUFFER_VIEW index_buffer_view;
-
-    // Only the GPU needs this data, the CPU won't need this
-    D3D12_RANGE index_range{ 0, 0 };
-    uint8_t* index_data_begin = nullptr;
-
-    // Upload index buffer to GPU
-    {
-        D3D12_HEAP_PROPERTIES upload_heap_props = {
-            D3D12_HEAP_TYPE_UPLOAD, // The heap will be used to upload data to the GPU
-            D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-            D3D12_MEMORY_POOL_UNKNOWN, 1, 1 };
-
-        D3D12_RESOURCE_DESC upload_buffer_desc = {
-            D3D12_RESOURCE_DIMENSION_BUFFER, // Can either be texture or buffer, we want a buffer
-            0,
-            sizeof(triangle_indices),
-            1,
-            1,
-            1,
-            DXGI_FORMAT_UNKNOWN, // This is only really useful for textures, so for buffer this is unknown
-            {1, 0}, // Texture sampling quality settings, not important for non-textures, so set it to lowest
-            D3D12_TEXTURE_LAYOUT_ROW_MAJOR, // First left to right, then top to bottom
-            D3D12_RESOURCE_FLAG_NONE,
-        };
-
+    // The indices are in the mesh buffer too
+    const D3D12_INDEX_BUFFER_VIEW index_buffer_view{
+        mesh_buffer->GetGPUVirtualAddress() + mesh_index_section->offset,
+        static_cast<UINT>(mesh_index_section->size),
+        mesh_index_section->element_size == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+    };
 
-        throw_if_failed(device->CreateCommittedResource(&upload_heap_props, D3D12_HEAP_FLAG_NONE, &upload_buffer_desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, __uuidof(ID3D12Resource),
-            &index_buffer));
-
-        // Bind the index buffer, copy the data to it, then unbind the index buffer
-        throw_if_failed(index_buffer->Map(0, &index_range, reinterpret_cast<void**>(&index_data_begin)));
-        memcpy_s(index_data_begin, sizeof(triangle_indices), triangle_indices, sizeof(triangle_indices));
-        index_buffer->Unmap(0, nullptr);
-
-        // Init the buffer view
-        index_buffer_view = D3D12_INDEX_BUFFER_VIEW{
-            index_buffer->GetGPUVirtualAddress(),
-            sizeof(triangle_indices),
-            DXGI_FORMAT_R32_UINT,
-        };
-    }
+    /* CAMERA
+    * The simulation moves the camera, we only need the projection (see projection.h). The cluster grid for the
+    * lights only depends on the projection, so it's made once too. Lights further away than its far plane don't
+    * light anything, the lights of this scene are all much closer.
+    */
+    constexpr float near_plane = 0.1f;
+    const glm::mat4 projection = reverse_z_infinite_perspective(glm::radians(60.0f), static_cast<float>(width) / static_cast<float>(height), near_plane);
+    const ClusterGrid cluster_grid = make_cluster_grid(projection, width, height, near_plane, 100.0f);
 
     /* CONSTANT BUFFER
     * Same as uniform buffers in OpenGL, usually meant to hold transform matrices, initialized 
     * the same way as the other buffers. In this case I will use it to make the triangle pulsate.
     */
 
-    // Define what the constant buffer's layout is
+    // Define what the constant buffer's layout is, must match frame_constants.hlsli
     struct {
+        glm::mat4 view;
+        glm::mat4 projection;
         glm::vec3 color_mul;
+        uint32_t light_count;
+        ClusterLookup cluster_lookup;
     } const_buffer_data_struct{};
+    const_buffer_data_struct.view = glm::mat4(1.0f);
+    const_buffer_data_struct.projection = projection;
+    const_buffer_data_struct.cluster_lookup = cluster_grid.lookup;
 
     // Declare handles
     ComPtr<ID3D12Resource> const_buffer;
@@ -457,6 +837,14 @@ int main()
     D3D12_RANGE const_range{ 0, 0 };
     uint8_t* const_data_begin = nullptr;
 
+    // The constants are written every frame, while the GPU may still be reading the ones of the frame before, so every
+    // backbuffer has its own copy, with its own Constant Buffer View. The textures overlay batches can use, just the
+    // glyph atlas (overlay_font_texture) for now, come after those, and then the depth buffer's Shader Resource View.
+    constexpr UINT64 const_buffer_slice_size = (sizeof(const_buffer_data_struct) | 0xFF) + 1; // Constant buffers must be 256-byte aligned
+    constexpr UINT overlay_texture_descriptor = backbuffer_count;
+    constexpr UINT overlay_texture_count = 1;
+    constexpr UINT depth_buffer_descriptor = overlay_texture_descriptor + overlay_texture_count;
+
     // Upload constant buffer to GPU
     {
         D3D12_HEAP_PROPERTIES upload_heap_props = {
@@ -464,9 +852,11 @@ int main()
             D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
             D3D12_MEMORY_POOL_UNKNOWN, 1, 1 };
 
+        // Only one heap of this type can be bound at a time, so the overlay textures and the depth buffer come after
+        // the constant buffers
         D3D12_DESCRIPTOR_HEAP_DESC heap_desc{
             D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-            1,
+            depth_buffer_descriptor + 1,
             D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
             0
         };
@@ -476,7 +866,7 @@ int main()
         D3D12_RESOURCE_DESC upload_buffer_desc = {
             D3D12_RESOURCE_DIMENSION_BUFFER, // Can either be texture or buffer, we want a buffer
             0,
-            (sizeof(const_buffer_data_struct) | 0xFF) + 1, // Constant buffers must be 256-byte aligned
+            const_buffer_slice_size * backbuffer_count,
             1,
             1,
             1,
@@ -494,21 +884,224 @@ int main()
         assert(const_buffer_heap != nullptr);
         const_buffer_heap->SetName(L"Constant Buffer Upload Resource Heap");
 
-        // Create the buffer view
-        const_buffer_view_desc = {
-            const_buffer->GetGPUVirtualAddress(),
-            (sizeof(const_buffer_data_struct) | 0xFF) + 1
-        };
-
-        D3D12_CPU_DESCRIPTOR_HANDLE const_buffer_view_handle(const_buffer_heap->GetCPUDescriptorHandleForHeapStart());
-        device->CreateConstantBufferView(&const_buffer_view_desc, const_buffer_view_handle);
+        // Create the buffer views, one per backbuffer
+        const UINT view_descriptor_size = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        for (UINT i = 0; i < backbuffer_count; ++i) {
+            const_buffer_view_desc = {
+                const_buffer->GetGPUVirtualAddress() + i * const_buffer_slice_size,
+                static_cast<UINT>(const_buffer_slice_size)
+            };
+
+            D3D12_CPU_DESCRIPTOR_HANDLE const_buffer_view_handle(const_buffer_heap->GetCPUDescriptorHandleForHeapStart());
+            const_buffer_view_handle.ptr += static_cast<SIZE_T>(i) * view_descriptor_size;
+            device->CreateConstantBufferView(&const_buffer_view_desc, const_buffer_view_handle);
+        }
 
-        // Bind the constant buffer, copy the data to it, then unbind the constant buffer
+        // Bind the constant buffer, copy the data to every copy, then unbind the constant buffer
         throw_if_failed(const_buffer->Map(0, &const_range, reinterpret_cast<void**>(&const_data_begin)));
-        memcpy_s(const_data_begin, sizeof(const_buffer_data_struct), &const_buffer_data_struct, sizeof(const_buffer_data_struct));
+        for (UINT i = 0; i < backbuffer_count; ++i) {
+            memcpy_s(const_data_begin + i * const_buffer_slice_size, sizeof(const_buffer_data_struct), &const_buffer_data_struct, sizeof(const_buffer_data_struct));
+        }
         const_buffer->Unmap(0, nullptr);
     }
 
+    /* LIGHT BUFFERS
+    * The lights and the cluster bounds are uploaded by the CPU, the lights every frame, into their backbuffer's part
+    * of the light buffer. The bitmasks (one bit per light in every cluster),
+    * the ranges and the light indices are only written by the compute shaders, so they're in a default heap.
+    * Buffers start out in the common state, and get promoted to whatever the first command that uses them needs.
+    * Committed resources are zeroed, so the bitmasks start out cleared, like cluster_compact.cs.hlsl expects.
+    * With --validate-lights, the ranges and the light indices are copied back to the CPU every frame, and compared
+    * with what assign_lights_to_clusters() makes of the same lights.
+    */
+    const auto create_buffer = [&](const D3D12_HEAP_TYPE heap_type, const UINT64 size, const D3D12_RESOURCE_FLAGS flags,
+                                   const D3D12_RESOURCE_STATES state, const wchar_t* name) {
+        const D3D12_HEAP_PROPERTIES heap_props = {
+            heap_type,
+            D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            D3D12_MEMORY_POOL_UNKNOWN, 1, 1 };
+
+        const D3D12_RESOURCE_DESC buffer_desc = {
+            D3D12_RESOURCE_DIMENSION_BUFFER,
+            0,
+            size,
+            1,
+            1,
+            1,
+            DXGI_FORMAT_UNKNOWN,
+            {1, 0},
+            D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            flags,
+        };
+
+        ComPtr<ID3D12Resource> buffer;
+        throw_if_failed(device->CreateCommittedResource(&heap_props, D3D12_HEAP_FLAG_NONE, &buffer_desc, state, nullptr, IID_PPV_ARGS(&buffer)));
+        buffer->SetName(name);
+        return buffer;
+    };
+
+    constexpr UINT64 cluster_mask_buffer_size = static_cast<UINT64>(cluster_count) * (max_cluster_lights / 32) * sizeof(uint32_t);
+    constexpr UINT64 cluster_range_buffer_size = cluster_count * sizeof(ClusterRange);
+    constexpr UINT64 cluster_light_index_buffer_size = max_cluster_light_indices * sizeof(uint32_t);
+    constexpr UINT64 light_buffer_slice_size = max_cluster_lights * sizeof(ClusterLight);
+    const ComPtr<ID3D12Resource> light_buffer = create_buffer(D3D12_HEAP_TYPE_UPLOAD, light_buffer_slice_size * backbuffer_count,
+        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, L"Light Buffer");
+    const ComPtr<ID3D12Resource> cluster_bounds_buffer = create_buffer(D3D12_HEAP_TYPE_UPLOAD, sizeof(ClusterBounds),
+        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, L"Cluster Bounds Buffer");
+    const ComPtr<ID3D12Resource> cluster_mask_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, cluster_mask_buffer_size,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Cluster Light Mask Buffer");
+    const ComPtr<ID3D12Resource> cluster_range_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, cluster_range_buffer_size,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Cluster Range Buffer");
+    const ComPtr<ID3D12Resource> cluster_light_index_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, cluster_light_index_buffer_size,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Cluster Light Index Buffer");
+    ComPtr<ID3D12Resource> cluster_range_readback;
+    ComPtr<ID3D12Resource> cluster_light_index_readback;
+    if (validate_lights) {
+        cluster_range_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, cluster_range_buffer_size,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Cluster Range Readback");
+        cluster_light_index_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, cluster_light_index_buffer_size,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Cluster Light Index Readback");
+    }
+
+    // The world transforms of the draws, uploaded every frame, with room for transform_capacity of them per backbuffer.
+    // It gets replaced by a bigger one when the scene grows, and the old one is released once the GPU is done with it.
+    size_t transform_capacity = 256;
+    ComPtr<ID3D12Resource> transform_buffer = create_buffer(D3D12_HEAP_TYPE_UPLOAD, transform_capacity * sizeof(glm::mat4) * backbuffer_count,
+        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, L"Transform Buffer");
+
+    // The bounds never change
+    {
+        void* bounds_data = nullptr;
+        throw_if_failed(cluster_bounds_buffer->Map(0, &const_range, &bounds_data));
+        memcpy(bounds_data, &cluster_grid.bounds, sizeof(ClusterBounds));
+        cluster_bounds_buffer->Unmap(0, nullptr);
+    }
+
+    /* UPLOAD RING
+    * What changes every frame, the particle billboards (or the spawn plan when the GPU simulates the particles) and
+    * the overlay quads, goes through an upload ring (see upload_ring.h): one upload buffer that stays mapped, where
+    * every frame writes after the frame before it, and space is reused once the GPU is done with it.
+    */
+    constexpr UINT64 upload_ring_size = 16 << 20;
+    const ComPtr<ID3D12Resource> upload_ring_buffer = create_buffer(D3D12_HEAP_TYPE_UPLOAD, upload_ring_size,
+        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, L"Upload Ring");
+    UploadRing upload_ring(upload_ring_size);
+    uint8_t* upload_ring_data = nullptr;
+    throw_if_failed(upload_ring_buffer->Map(0, &const_range, reinterpret_cast<void**>(&upload_ring_data)));
+
+    /* PARTICLE BUFFERS
+    * With --gpu-particles, the particles live in two default heap buffers, and every step compacts them from one
+    * into the other. The particle state starts with the arguments of the particle draw, so it's drawn with
+    * ExecuteIndirect, and the CPU never needs to know how many particles there are. The emitters never change, so
+    * they're uploaded once. With --validate-particles, the CPU runs the same steps, and its particles are compared
+    * with the GPU's every frame.
+    */
+    constexpr uint32_t particle_capacity = 1 << 18;
+    static_assert(particle_capacity % 256 == 0 && particle_capacity <= max_particles, "The particle shaders need whole groups of 256");
+    const std::vector<ParticleEmitter> particle_emitters = make_particle_emitters(particle_emitter_count);
+
+    constexpr UINT64 particle_buffer_size = particle_capacity * sizeof(GpuParticle);
+    constexpr UINT64 particle_state_size = 5 * sizeof(uint32_t);
+    ComPtr<ID3D12Resource> particle_buffers[2];
+    ComPtr<ID3D12Resource> particle_slot_buffer;
+    ComPtr<ID3D12Resource> particle_group_buffer;
+    ComPtr<ID3D12Resource> particle_state_buffer;
+    ComPtr<ID3D12Resource> particle_emitter_buffer;
+    ComPtr<ID3D12Resource> particle_readback;
+    ComPtr<ID3D12Resource> particle_state_readback;
+    ComPtr<ID3D12CommandSignature> particle_command_signature;
+    if (gpu_particles) {
+        particle_buffers[0] = create_buffer(D3D12_HEAP_TYPE_DEFAULT, particle_buffer_size,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Particle Buffer 0");
+        particle_buffers[1] = create_buffer(D3D12_HEAP_TYPE_DEFAULT, particle_buffer_size,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Particle Buffer 1");
+        particle_slot_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, particle_capacity * sizeof(uint32_t),
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Particle Slot Buffer");
+        particle_group_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, particle_capacity / 256 * sizeof(uint32_t),
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Particle Group Buffer");
+        particle_state_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, particle_state_size,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Particle State Buffer");
+
+        const UINT64 emitter_buffer_size = (particle_emitters.empty() ? 1 : particle_emitters.size()) * sizeof(ParticleEmitter);
+        particle_emitter_buffer = create_buffer(D3D12_HEAP_TYPE_UPLOAD, emitter_buffer_size,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, L"Particle Emitter Buffer");
+        void* emitter_data = nullptr;
+        throw_if_failed(particle_emitter_buffer->Map(0, &const_range, &emitter_data));
+        memcpy(emitter_data, particle_emitters.data(), particle_emitters.size() * sizeof(ParticleEmitter));
+        particle_emitter_buffer->Unmap(0, nullptr);
+
+        if (validate_particles) {
+            particle_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, particle_buffer_size,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Particle Readback");
+            particle_state_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, particle_state_size,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Particle State Readback");
+        }
+
+        // A plain draw, with all of its arguments from the particle state
+        D3D12_INDIRECT_ARGUMENT_DESC draw_argument{};
+        draw_argument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+        const D3D12_COMMAND_SIGNATURE_DESC command_signature_desc{ sizeof(D3D12_DRAW_ARGUMENTS), 1, &draw_argument, 0 };
+        throw_if_failed(device->CreateCommandSignature(&command_signature_desc, nullptr, IID_PPV_ARGS(&particle_command_signature)));
+    }
+
+    /* OCCLUSION BUFFERS
+    * Everything the occlusion culling (see occlusion_culling.h) keeps from one frame to the next is in default heap
+    * buffers: the depth pyramid, which objects were visible, the draws of both phases, the early ones first, and the
+    * counters, where the first two are the draw counts of ExecuteIndirect. The objects and the constants go through
+    * the upload ring every frame. Every draw of the mesh is an object, with the box from the mesh's bounds, so
+    * without bounds (or with --no-occlusion-culling) the draws just aren't culled. The counters are copied back every frame, for the stats. With
+    * --validate-occlusion, the depth buffer, the pyramid and the visibility are copied back too, and compared with
+    * what the CPU makes of the same depth.
+    */
+    const MeshSectionHeader* mesh_bounds_section = mesh.find_section(MeshSectionType::bounds);
+    const bool occlusion_culling = mesh_bounds_section != nullptr && !disable_occlusion_culling;
+    MeshBounds mesh_bounds;
+    if (mesh_bounds_section) {
+        mesh_bounds = mesh.section_data<MeshBounds>(*mesh_bounds_section)[0];
+    }
+    DepthPyramid depth_pyramid;
+    make_depth_pyramid(swapchain_desc.Width, swapchain_desc.Height, depth_pyramid);
+    const UINT64 depth_pyramid_size = depth_pyramid.texels.size() * sizeof(float);
+    constexpr UINT64 occlusion_visibility_size = max_occlusion_objects * sizeof(uint32_t);
+    constexpr UINT64 occlusion_draw_buffer_size = 2 * max_occlusion_objects * sizeof(OcclusionDrawCommand);
+    const ComPtr<ID3D12Resource> depth_pyramid_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, depth_pyramid_size,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Depth Pyramid Buffer");
+    const ComPtr<ID3D12Resource> occlusion_visibility_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, occlusion_visibility_size,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Occlusion Visibility Buffer");
+    const ComPtr<ID3D12Resource> occlusion_draw_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, occlusion_draw_buffer_size,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Occlusion Draw Buffer");
+    const ComPtr<ID3D12Resource> occlusion_counter_buffer = create_buffer(D3D12_HEAP_TYPE_DEFAULT, sizeof(OcclusionCounters),
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, L"Occlusion Counter Buffer");
+    // The counters are read back for the overlay once the frame's backbuffer comes around again, so each has its own
+    const ComPtr<ID3D12Resource> occlusion_counter_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, sizeof(OcclusionCounters) * backbuffer_count,
+        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Occlusion Counter Readback");
+    ComPtr<ID3D12Resource> depth_readback;
+    ComPtr<ID3D12Resource> depth_pyramid_readback;
+    ComPtr<ID3D12Resource> occlusion_visibility_readback;
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT depth_readback_footprint{};
+    if (validate_occlusion) {
+        const D3D12_RESOURCE_DESC depth_buffer_desc = depth_buffer->GetDesc();
+        UINT64 depth_readback_size = 0;
+        device->GetCopyableFootprints(&depth_buffer_desc, 0, 1, 0, &depth_readback_footprint, nullptr, nullptr, &depth_readback_size);
+        depth_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, depth_readback_size,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Depth Readback");
+        depth_pyramid_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, depth_pyramid_size,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Depth Pyramid Readback");
+        occlusion_visibility_readback = create_buffer(D3D12_HEAP_TYPE_READBACK, occlusion_visibility_size,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Occlusion Visibility Readback");
+    }
+
+    // A draw of the mesh, with the transform index root constant set first, like the draw loop does
+    ComPtr<ID3D12CommandSignature> occlusion_command_signature;
+    {
+        D3D12_INDIRECT_ARGUMENT_DESC draw_arguments[2]{};
+        draw_arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+        draw_arguments[0].Constant = { 5, 0, 1 };
+        draw_arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+        const D3D12_COMMAND_SIGNATURE_DESC command_signature_desc{ sizeof(OcclusionDrawCommand), _countof(draw_arguments), draw_arguments, 0 };
+        throw_if_failed(device->CreateCommandSignature(&command_signature_desc, root_signature.Get(), IID_PPV_ARGS(&occlusion_command_signature)));
+    }
+
     /* SHADERS
     * Shaders are loaded as pre-compiled binary files. Shaders are compiled using the Microsoft DirectX Shader
     * Compiler (https://github.com/microsoft/DirectXShaderCompiler), which compiles .hlsl files into .dxil files.
@@ -531,20 +1124,118 @@ int main()
     vs_bytecode.pShaderBytecode = vs_data;
     ps_bytecode.pShaderBytecode = ps_data;
 
+    /* SHADER HOT RELOAD
+    * With --hot-reload, every pipeline is registered with the ShaderReloader, along with the .hlsl files it's built
+    * from. When one of them changes, the reloader's thread compiles them with D3DCompileFromFile and creates a new
+    * pipeline state from a copy of the original description, and the render thread swaps it in at the start of a
+    * frame. The device is free-threaded, so creating the pipeline there is fine. Without the flag, nothing is
+    * registered and no thread is started.
+    */
+    ShaderReloader shader_reloader;
+    const auto compile_shader = [shader_source_directory](const std::string& file, const char* target) -> ID3DBlob* {
+        const std::string path = std::string(shader_source_directory) + "/" + file;
+        const int wide_length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        std::wstring wide_path(wide_length > 0 ? wide_length : 1, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide_path[0], wide_length);
+#ifdef _DEBUG
+        constexpr UINT compile_flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+        constexpr UINT compile_flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+        ID3DBlob* bytecode = nullptr;
+        ID3DBlob* errors = nullptr;
+        const HRESULT result = D3DCompileFromFile(wide_path.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", target, compile_flags, 0, &bytecode, &errors);
+        if (errors) {
+            printf("%s:\n%s\n", path.c_str(), static_cast<const char*>(errors->GetBufferPointer()));
+            errors->Release();
+        }
+        if (FAILED(result)) {
+            printf("[ERROR] Failed to compile shader '%s'\n", path.c_str());
+            if (bytecode) {
+                bytecode->Release();
+            }
+            return nullptr;
+        }
+        return bytecode;
+    };
+    const auto release_pipeline_state = [](void* object) {
+        static_cast<ID3D12PipelineState*>(object)->Release();
+    };
+
+    // The description is copied, with its input layout, since the one it came from doesn't live that long. Only
+    // the shaders are replaced, so the root signature it points to has to outlive the reloader, which it does.
+    const auto hot_reload_graphics_pipeline = [&](ID3D12PipelineState** pipeline, const char* name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                                  const std::string& shader_name) {
+        if (!shader_source_directory) {
+            return;
+        }
+        std::vector<D3D12_INPUT_ELEMENT_DESC> input_layout(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + desc.InputLayout.NumElements);
+        const std::string vs_file = shader_name + ".vs.hlsl";
+        const std::string ps_file = shader_name + ".ps.hlsl";
+        shader_reloader.add(name, { vs_file, ps_file }, [&device, &compile_shader, desc, input_layout, vs_file, ps_file, name]() -> void* {
+            ID3DBlob* vs_blob = compile_shader(vs_file, "vs_5_0");
+            ID3DBlob* ps_blob = compile_shader(ps_file, "ps_5_0");
+            ID3D12PipelineState* reloaded_pipeline_state = nullptr;
+            if (vs_blob && ps_blob) {
+                D3D12_GRAPHICS_PIPELINE_STATE_DESC reloaded_desc = desc;
+                reloaded_desc.InputLayout = { input_layout.data(), static_cast<UINT>(input_layout.size()) };
+                reloaded_desc.VS = { vs_blob->GetBufferPointer(), vs_blob->GetBufferSize() };
+                reloaded_desc.PS = { ps_blob->GetBufferPointer(), ps_blob->GetBufferSize() };
+                if (FAILED(device->CreateGraphicsPipelineState(&reloaded_desc, IID_PPV_ARGS(&reloaded_pipeline_state)))) {
+                    printf("[ERROR] Failed to recreate %s\n", name);
+                    reloaded_pipeline_state = nullptr;
+                }
+            }
+            if (vs_blob) {
+                vs_blob->Release();
+            }
+            if (ps_blob) {
+                ps_blob->Release();
+            }
+            return reloaded_pipeline_state;
+        }, release_pipeline_state, pipeline);
+    };
+    const auto hot_reload_compute_pipeline = [&](ID3D12PipelineState** pipeline, const char* name, ID3D12RootSignature* signature,
+                                                 const std::string& shader_name) {
+        if (!shader_source_directory) {
+            return;
+        }
+        const std::string cs_file = shader_name + ".cs.hlsl";
+        shader_reloader.add(name, { cs_file }, [&device, &compile_shader, signature, cs_file, name]() -> void* {
+            ID3DBlob* cs_blob = compile_shader(cs_file, "cs_5_0");
+            if (!cs_blob) {
+                return nullptr;
+            }
+            D3D12_COMPUTE_PIPELINE_STATE_DESC reloaded_desc{};
+            reloaded_desc.pRootSignature = signature;
+            reloaded_desc.CS = { cs_blob->GetBufferPointer(), cs_blob->GetBufferSize() };
+            ID3D12PipelineState* reloaded_pipeline_state = nullptr;
+            if (FAILED(device->CreateComputePipelineState(&reloaded_desc, IID_PPV_ARGS(&reloaded_pipeline_state)))) {
+                printf("[ERROR] Failed to recreate %s\n", name);
+                reloaded_pipeline_state = nullptr;
+            }
+            cs_blob->Release();
+            return reloaded_pipeline_state;
+        }, release_pipeline_state, pipeline);
+    };
+
     /* PIPELINE STATE
     * The pipeline state has all the info you need to execute a draw call
     */
 
     // Define graphics pipeline
-    ID3D12PipelineState* pipeline_state;
+    ID3D12PipelineState* pipeline_state = nullptr;
     D3D12_GRAPHICS_PIPELINE_STATE_DESC pipeline_state_desc{};
 
-    // Define input assembly - this defines what our shader input is
-    D3D12_INPUT_ELEMENT_DESC input_element_descs[] = {
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, pos), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        {"COLOR",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, color), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-    };
-    pipeline_state_desc.InputLayout = { input_element_descs, _countof(input_element_descs) };
+    // Define input assembly - this defines what our shader input is. It comes from the mesh's vertex attributes,
+    // and every vertex stream is its own input slot.
+    std::vector<D3D12_INPUT_ELEMENT_DESC> input_element_descs;
+    for (uint32_t i = 0; i < mesh.header->attribute_count; ++i) {
+        const MeshVertexAttribute& attribute = mesh.attributes[i];
+        input_element_descs.push_back({vertex_semantic_name(attribute.semantic), attribute.semantic_index, dxgi_format(attribute.format),
+                                       attribute.stream_index, attribute.offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0});
+    }
+    pipeline_state_desc.InputLayout = { input_element_descs.data(), static_cast<UINT>(input_element_descs.size()) };
 
     // Assign root signature
     pipeline_state_desc.pRootSignature = root_signature.Get();
@@ -592,14 +1283,17 @@ int main()
     pipeline_state_desc.BlendState = blend_desc;
 
 
-    // Set up depth/stencil state
-    pipeline_state_desc.DepthStencilState.DepthEnable = FALSE;
+    // Set up depth/stencil state - with reverse-Z, closer means greater
+    pipeline_state_desc.DepthStencilState.DepthEnable = TRUE;
+    pipeline_state_desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+    pipeline_state_desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER_EQUAL;
     pipeline_state_desc.DepthStencilState.StencilEnable = FALSE;
     pipeline_state_desc.SampleMask = UINT_MAX;
 
     // Setup render target output
     pipeline_state_desc.NumRenderTargets = 1;
     pipeline_state_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+    pipeline_state_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
     pipeline_state_desc.SampleDesc.Count = 1;
 
     // Create graphics pipeline state
@@ -609,156 +1303,1005 @@ int main()
     catch ([[maybe_unused]] std::exception& e) {
         puts("Failed to create Graphics Pipeline");
     }
+    hot_reload_graphics_pipeline(&pipeline_state, "pipeline state", pipeline_state_desc, "hello_triangle");
 
-    // Create command allocator and command list
-    ID3D12GraphicsCommandList* command_list;
-    throw_if_failed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, command_allocator.Get(), pipeline_state, IID_PPV_ARGS(&command_list)));
-
-
-    // Main window update loop
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = std::chrono::high_resolution_clock::now();
-    float time = 0.0f;
-
-    while (!glfwWindowShouldClose(window)) {
-        // Update delta time
-        end = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration<float, std::ratio<1, 1>>(end - start).count();
-        time += dt;
-        start = std::chrono::high_resolution_clock::now();
-
-        // Update constant buffer    
-        const_buffer_data_struct.color_mul.r = sinf(time + 0.0f * 3.141593f) + 1.f;
-        const_buffer_data_struct.color_mul.g = sinf(time + 0.5f * 3.141593f) + 1.f;
-        const_buffer_data_struct.color_mul.b = sinf(time + 1.0f * 3.141593f) + 1.f;
-        throw_if_failed(const_buffer->Map(0, &const_range, reinterpret_cast<void**>(&const_data_begin)));
-        memcpy_s(const_data_begin, sizeof(const_buffer_data_struct), &const_buffer_data_struct, sizeof(const_buffer_data_struct));
-        const_buffer->Unmap(0, nullptr);
+    /* PARTICLE PIPELINE STATE
+    * Billboards are drawn after the meshes, back to front, blended with premultiplied alpha. They're tested against
+    * the depth buffer, but don't write to it, so they don't hide each other. The instance data either comes from
+    * the CPU (ParticleInstance), or straight from the GPU's particle buffer (GpuParticle), which has the same values
+    * at other offsets.
+    */
+    ID3D12PipelineState* particle_pipeline_state = nullptr;
+    {
+        size_t particle_vs_size = 0;
+        size_t particle_ps_size = 0;
+        char* particle_vs_data = nullptr;
+        char* particle_ps_data = nullptr;
+        read_file("Assets/Shaders/DX12/particle.vs.cso", particle_vs_size, particle_vs_data, false);
+        read_file("Assets/Shaders/DX12/particle.ps.cso", particle_ps_size, particle_ps_data, false);
+
+        const UINT size_offset = static_cast<UINT>(gpu_particles ? offsetof(GpuParticle, size) : offsetof(ParticleInstance, size));
+        const UINT color_offset = static_cast<UINT>(gpu_particles ? offsetof(GpuParticle, color) : offsetof(ParticleInstance, color));
+        const D3D12_INPUT_ELEMENT_DESC particle_input_element_descs[] = {
+            { "PARTICLE_POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "PARTICLE_SIZE", 0, DXGI_FORMAT_R32_FLOAT, 0, size_offset, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "PARTICLE_COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, color_offset, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        };
 
-        // Bind root signature
-        command_list->SetGraphicsRootSignature(root_signature.Get());
-
-        // Bind constant buffer
-        ID3D12DescriptorHeap* descriptor_heaps[] = { const_buffer_heap.Get() };
-        command_list->SetDescriptorHeaps(_countof(descriptor_heaps), descriptor_heaps);
-        D3D12_GPU_DESCRIPTOR_HANDLE const_buffer_view_handle(const_buffer_heap->GetGPUDescriptorHandleForHeapStart());
-        
-        // Set root descriptor table
-        command_list->SetGraphicsRootDescriptorTable(0, const_buffer_view_handle);
-
-        // Set backbuffer as render target
-        D3D12_RESOURCE_BARRIER render_target_barrier;
-        render_target_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        render_target_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-        render_target_barrier.Transition.pResource = render_targets[frame_index].Get();
-        render_target_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-        render_target_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-        render_target_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-        command_list->ResourceBarrier(1, &render_target_barrier);
-
-        // Set render target
-        D3D12_CPU_DESCRIPTOR_HANDLE render_target_view_handle(render_target_view_heap->GetCPUDescriptorHandleForHeapStart());
-        render_target_view_handle.ptr += static_cast<SIZE_T>(frame_index * render_target_view_descriptor_size);
-        command_list->OMSetRenderTargets(1, &render_target_view_handle, FALSE, nullptr);
-
-        // Record raster commands
-        constexpr float clear_color[] = {0.1f, 0.1f, 0.2f, 1.0f};
-        command_list->RSSetViewports(1, &viewport); // Set viewport
-        command_list->RSSetScissorRects(1, &surface_size); // todo: comment
-        command_list->ClearRenderTargetView(render_target_view_handle, clear_color, 0, nullptr); // Clear the screen
-        command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST); // We draw triangles
-        command_list->IASetVertexBuffers(0, 1, &vertex_buffer_view); // Bind vertex buffer
-        command_list->IASetIndexBuffer(&index_buffer_view); // Bind index buffer
-        
-        // Submit draw call
-        command_list->DrawIndexedInstanced(3, 1, 0, 0, 0);
-
-        // Present backbuffer
-        D3D12_RESOURCE_BARRIER present_barrier;
-        present_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        present_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-        present_barrier.Transition.pResource = render_targets[frame_index].Get();
-        present_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-        present_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-        present_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-        command_list->ResourceBarrier(1, &present_barrier);
-
-        // Finish the command list, we're done with the frame
-        throw_if_failed(command_list->Close());
-
-        // Execute command list
-        ID3D12CommandList* command_lists[] = { command_list };
-        command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
-
-        // Present
-        swapchain->Present(1, 0);
-
-        // Use fence to wait until the frame is fully rendered
-        throw_if_failed(command_queue->Signal(fences[frame_index].Get(), fence_values[frame_index]));
-
-        if (fences[frame_index]->GetCompletedValue() < fence_values[frame_index]) {
-            throw_if_failed(fences[frame_index]->SetEventOnCompletion(fence_values[frame_index], fence_event));
-            WaitForSingleObject(fence_event, INFINITE);
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC particle_pipeline_state_desc = pipeline_state_desc;
+        particle_pipeline_state_desc.InputLayout = { particle_input_element_descs, _countof(particle_input_element_descs) };
+        particle_pipeline_state_desc.VS = { particle_vs_data, particle_vs_size };
+        particle_pipeline_state_desc.PS = { particle_ps_data, particle_ps_size };
+        D3D12_RENDER_TARGET_BLEND_DESC& particle_blend = particle_pipeline_state_desc.BlendState.RenderTarget[0];
+        particle_blend.BlendEnable = TRUE;
+        particle_blend.SrcBlend = D3D12_BLEND_ONE;
+        particle_blend.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+        particle_blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+        particle_blend.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+        particle_pipeline_state_desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+        if (FAILED(device->CreateGraphicsPipelineState(&particle_pipeline_state_desc, IID_PPV_ARGS(&particle_pipeline_state)))) {
+            puts("Failed to create Particle Pipeline");
         }
-        fence_values[frame_index]++;
+        hot_reload_graphics_pipeline(&particle_pipeline_state, "particle pipeline state", particle_pipeline_state_desc, "particle");
+        free(particle_vs_data);
+        free(particle_ps_data);
+    }
 
-        frame_index = swapchain->GetCurrentBackBufferIndex();
+    /* OVERLAY PIPELINE STATE
+    * The overlay is drawn last, over everything, so it ignores the depth buffer. Every quad is one instance
+    * (OverlayQuad), blended with premultiplied alpha like the particles.
+    */
+    ID3D12PipelineState* overlay_pipeline_state = nullptr;
+    {
+        size_t overlay_vs_size = 0;
+        size_t overlay_ps_size = 0;
+        char* overlay_vs_data = nullptr;
+        char* overlay_ps_data = nullptr;
+        read_file("Assets/Shaders/DX12/overlay.vs.cso", overlay_vs_size, overlay_vs_data, false);
+        read_file("Assets/Shaders/DX12/overlay.ps.cso", overlay_ps_size, overlay_ps_data, false);
+
+        const D3D12_INPUT_ELEMENT_DESC overlay_input_element_descs[] = {
+            { "OVERLAY_RECT", 0, DXGI_FORMAT_R16G16B16A16_SINT, 0, offsetof(OverlayQuad, x0), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "OVERLAY_UV", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(OverlayQuad, u0), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "OVERLAY_COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(OverlayQuad, color), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        };
 
-        // Update GLFW window
-        glfwPollEvents();
-        glfwSwapBuffers(window);
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC overlay_pipeline_state_desc = pipeline_state_desc;
+        overlay_pipeline_state_desc.InputLayout = { overlay_input_element_descs, _countof(overlay_input_element_descs) };
+        overlay_pipeline_state_desc.pRootSignature = overlay_root_signature.Get();
+        overlay_pipeline_state_desc.VS = { overlay_vs_data, overlay_vs_size };
+        overlay_pipeline_state_desc.PS = { overlay_ps_data, overlay_ps_size };
+        D3D12_RENDER_TARGET_BLEND_DESC& overlay_blend = overlay_pipeline_state_desc.BlendState.RenderTarget[0];
+        overlay_blend.BlendEnable = TRUE;
+        overlay_blend.SrcBlend = D3D12_BLEND_ONE;
+        overlay_blend.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+        overlay_blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+        overlay_blend.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+        overlay_pipeline_state_desc.DepthStencilState.DepthEnable = FALSE;
+        overlay_pipeline_state_desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+        if (FAILED(device->CreateGraphicsPipelineState(&overlay_pipeline_state_desc, IID_PPV_ARGS(&overlay_pipeline_state)))) {
+            puts("Failed to create Overlay Pipeline");
+        }
+        hot_reload_graphics_pipeline(&overlay_pipeline_state, "overlay pipeline state", overlay_pipeline_state_desc, "overlay");
+        free(overlay_vs_data);
+        free(overlay_ps_data);
+    }
 
-        // Reset command allocator and use the raster graphics pipeline
-        throw_if_failed(command_allocator->Reset());
-        throw_if_failed(command_list->Reset(command_allocator.Get(), pipeline_state));
+    // Create the light assignment pipelines, and the particle simulation ones if the GPU simulates the particles
+    const auto create_compute_pipeline_state = [&](const std::string& path, ID3D12RootSignature* signature) {
+        size_t cs_size = 0;
+        char* cs_data = nullptr;
+        read_file(path, cs_size, cs_data, false);
+        D3D12_COMPUTE_PIPELINE_STATE_DESC compute_pipeline_state_desc{};
+        compute_pipeline_state_desc.pRootSignature = signature;
+        compute_pipeline_state_desc.CS = { cs_data, cs_size };
+        ID3D12PipelineState* compute_pipeline_state = nullptr;
+        if (FAILED(device->CreateComputePipelineState(&compute_pipeline_state_desc, IID_PPV_ARGS(&compute_pipeline_state)))) {
+            printf("Failed to create Compute Pipeline from %s\n", path.c_str());
+        }
+        free(cs_data);
+        return compute_pipeline_state;
+    };
+    ID3D12PipelineState* cluster_assign_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/cluster_assign.cs.cso", compute_root_signature.Get());
+    ID3D12PipelineState* cluster_compact_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/cluster_compact.cs.cso", compute_root_signature.Get());
+    ID3D12PipelineState* particle_integrate_pipeline_state = nullptr;
+    ID3D12PipelineState* particle_scan_pipeline_state = nullptr;
+    ID3D12PipelineState* particle_compact_pipeline_state = nullptr;
+    if (gpu_particles) {
+        particle_integrate_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/particle_integrate.cs.cso", particle_root_signature.Get());
+        particle_scan_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/particle_scan.cs.cso", particle_root_signature.Get());
+        particle_compact_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/particle_compact.cs.cso", particle_root_signature.Get());
+    }
+    ID3D12PipelineState* depth_pyramid_pipeline_state = nullptr;
+    ID3D12PipelineState* occlusion_cull_pipeline_state = nullptr;
+    if (occlusion_culling) {
+        depth_pyramid_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/depth_pyramid.cs.cso", occlusion_root_signature.Get());
+        occlusion_cull_pipeline_state = create_compute_pipeline_state("Assets/Shaders/DX12/occlusion_cull.cs.cso", occlusion_root_signature.Get());
+    }
+    hot_reload_compute_pipeline(&cluster_assign_pipeline_state, "light assignment pipeline state", compute_root_signature.Get(), "cluster_assign");
+    hot_reload_compute_pipeline(&cluster_compact_pipeline_state, "light compaction pipeline state", compute_root_signature.Get(), "cluster_compact");
+    if (gpu_particles) {
+        hot_reload_compute_pipeline(&particle_integrate_pipeline_state, "particle integration pipeline state", particle_root_signature.Get(), "particle_integrate");
+        hot_reload_compute_pipeline(&particle_scan_pipeline_state, "particle scan pipeline state", particle_root_signature.Get(), "particle_scan");
+        hot_reload_compute_pipeline(&particle_compact_pipeline_state, "particle compaction pipeline state", particle_root_signature.Get(), "particle_compact");
+    }
+    if (occlusion_culling) {
+        hot_reload_compute_pipeline(&depth_pyramid_pipeline_state, "depth pyramid pipeline state", occlusion_root_signature.Get(), "depth_pyramid");
+        hot_reload_compute_pipeline(&occlusion_cull_pipeline_state, "occlusion culling pipeline state", occlusion_root_signature.Get(), "occlusion_cull");
+    }
+    if (shader_source_directory && shader_reloader.start(shader_source_directory)) {
+        printf("Watching '%s' for shader changes\n", shader_source_directory);
     }
 
-    /* TODO
-    * // TO FIX THE CODE
-    * - Split each step into its own function
-    * - Dont Repeat Yourself
-    * - Maybe just pop this into the FlanRenderer-RW header, it was made for cross-api stuff so might as well
+    // The pipeline state has its own copy of the shader bytecode, and the GPU has its own copy of the mesh
+    free(vs_data);
+    free(ps_data);
+    mesh_file.close();
+
+    // Create command allocator and command list
+    ID3D12GraphicsCommandList* command_list = nullptr;
+    throw_if_failed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, command_allocators[frame_index].Get(), pipeline_state,
+                                              IID_PPV_ARGS(&command_list)));
+
+    /* DRAW BUNDLE
+    * Without occlusion culling, the draws of the scene are recorded the same way every frame, unless the scene
+    * changes. So they're recorded into a bundle (see command_bundle.h), which is only recorded again when the draws,
+    * the pipeline state or the mesh's buffer views change. The bundle sets the pipeline state, the root signature and
+    * the input assembler itself, since it doesn't inherit those, and inherits the other root arguments from the
+    * frame's command list. A bundle that's replaced is released, with its allocator, once the GPU is done with it.
     */
-}
+    CachedBundle draw_bundle;
+    ID3D12CommandAllocator* draw_bundle_allocator = nullptr;
+    ID3D12GraphicsCommandList* draw_bundle_list = nullptr;
+
+    /* OVERLAY FONT
+    * The glyph atlas is packed once, at startup, and copied into a texture through the upload ring. The copy goes
+    * into the command list before the first frame, so it runs with the first frame, and the ring keeps the pixels
+    * around until the GPU is done with that frame.
+    */
+    OverlayFont overlay_font;
+    if (!build_overlay_font(overlay_font)) {
+        throw std::exception();
+    }
+    ComPtr<ID3D12Resource> overlay_atlas;
+    const UINT shader_descriptor_size = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    {
+        const D3D12_HEAP_PROPERTIES default_heap_props = {
+            D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            D3D12_MEMORY_POOL_UNKNOWN, 1, 1 };
 
-void read_file(const std::string& path, size_t& size_bytes, char*& data, const bool silent)
-{
-    //Open file
-    std::ifstream file_stream(path, std::ios::binary);
+        const D3D12_RESOURCE_DESC atlas_desc = {
+            D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            0,
+            overlay_font.atlas_width,
+            overlay_font.atlas_height,
+            1,
+            1,
+            DXGI_FORMAT_R8G8B8A8_UNORM,
+            {1, 0},
+            D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            D3D12_RESOURCE_FLAG_NONE,
+        };
+        throw_if_failed(device->CreateCommittedResource(&default_heap_props, D3D12_HEAP_FLAG_NONE, &atlas_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&overlay_atlas)));
+        overlay_atlas->SetName(L"Overlay Glyph Atlas");
+
+        // Rows of a texture upload have to be 256-byte aligned, the footprint says where they go
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT atlas_footprint{};
+        UINT64 atlas_upload_size = 0;
+        device->GetCopyableFootprints(&atlas_desc, 0, 1, 0, &atlas_footprint, nullptr, nullptr, &atlas_upload_size);
+        const uint64_t atlas_offset = upload_ring.allocate(atlas_upload_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        if (atlas_offset == UploadRing::invalid_offset) {
+            throw std::exception();
+        }
+        const size_t atlas_row_size = static_cast<size_t>(overlay_font.atlas_width) * 4;
+        for (uint32_t y = 0; y < overlay_font.atlas_height; ++y) {
+            memcpy(upload_ring_data + atlas_offset + y * atlas_footprint.Footprint.RowPitch,
+                   overlay_font.atlas_pixels.data() + y * atlas_row_size, atlas_row_size);
+        }
+        atlas_footprint.Offset = atlas_offset;
+
+        D3D12_TEXTURE_COPY_LOCATION atlas_destination{};
+        atlas_destination.pResource = overlay_atlas.Get();
+        atlas_destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        atlas_destination.SubresourceIndex = 0;
+        D3D12_TEXTURE_COPY_LOCATION atlas_source{};
+        atlas_source.pResource = upload_ring_buffer.Get();
+        atlas_source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+        atlas_source.PlacedFootprint = atlas_footprint;
+        command_list->CopyTextureRegion(&atlas_destination, 0, 0, 0, &atlas_source, nullptr);
+        const D3D12_RESOURCE_BARRIER atlas_barrier = transition_barrier(overlay_atlas.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                                                        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        command_list->ResourceBarrier(1, &atlas_barrier);
+
+        // Its descriptor goes after the constant buffers'
+        D3D12_SHADER_RESOURCE_VIEW_DESC atlas_view_desc{};
+        atlas_view_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        atlas_view_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        atlas_view_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        atlas_view_desc.Texture2D.MipLevels = 1;
+        D3D12_CPU_DESCRIPTOR_HANDLE atlas_view_handle(const_buffer_heap->GetCPUDescriptorHandleForHeapStart());
+        atlas_view_handle.ptr += static_cast<SIZE_T>(overlay_texture_descriptor + overlay_font_texture) * shader_descriptor_size;
+        device->CreateShaderResourceView(overlay_atlas.Get(), &atlas_view_desc, atlas_view_handle);
+    }
 
-    //Is it actually open?
-    if (file_stream.is_open() == false)
+    // The depth buffer's Shader Resource View, for the depth pyramid, goes after the overlay textures
     {
-        if (!silent)
-            printf("[ERROR] Failed to open file '%s'!\n", path.c_str());
-        size_bytes = 0;
-        data = nullptr;
-        return;
+        D3D12_SHADER_RESOURCE_VIEW_DESC depth_view_desc{};
+        depth_view_desc.Format = DXGI_FORMAT_R32_FLOAT;
+        depth_view_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        depth_view_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        depth_view_desc.Texture2D.MipLevels = 1;
+        D3D12_CPU_DESCRIPTOR_HANDLE depth_view_handle(const_buffer_heap->GetCPUDescriptorHandleForHeapStart());
+        depth_view_handle.ptr += static_cast<SIZE_T>(depth_buffer_descriptor) * shader_descriptor_size;
+        device->CreateShaderResourceView(depth_buffer.Get(), &depth_view_desc, depth_view_handle);
     }
 
-    //See how big the file is so we can allocate the right amount of memory
-    const auto begin = file_stream.tellg();
-    file_stream.seekg(0, std::ifstream::end);
-    const auto end = file_stream.tellg();
-    const auto size = end - begin;
-    size_bytes = static_cast<size_t>(size);
+    /* THREADS
+    * Input, simulation and rendering each run on their own thread, and hand their results to the next one through a
+    * FrameMailbox (see frame_packet.h). The main thread keeps the window and the input, since GLFW needs that.
+    */
+    FrameMailbox<InputState> input_mailbox;
+    FrameMailbox<FramePacket> frame_mailbox;
+    std::atomic<bool> running{ true };
+
+    // The render thread sleeps until the first packet is published, the mailbox itself never waits
+    std::mutex first_packet_mutex;
+    std::condition_variable first_packet_ready;
+    bool first_packet_published = false;
+
+    // The scene is just the mesh's most detailed LOD, on a turntable. With --crowd, the copies stand in rows behind
+    // it, as seen from the camera, a bit more than a mesh apart, so they hide each other as the turntable spins.
+    SimulationState simulation;
+    simulation.turntable = create_entity(simulation.scene, scene_component_transform);
+    const SceneEntity mesh_entity = create_entity(simulation.scene, scene_component_transform | scene_component_draw);
+    set_parent(simulation.scene, mesh_entity, simulation.turntable);
+    *find_draw(simulation.scene, mesh_entity) = { mesh_lod.index_count, mesh_lod.first_index, 0, 0 };
+    if (crowd_count > 0) {
+        const float crowd_spacing = 1.25f * std::max({ mesh_bounds.max[0] - mesh_bounds.min[0], mesh_bounds.max[2] - mesh_bounds.min[2], 0.1f });
+        const uint32_t crowd_columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(crowd_count))));
+        for (uint32_t i = 0; i < crowd_count; ++i) {
+            const SceneEntity copy = create_entity(simulation.scene, scene_component_transform | scene_component_draw);
+            set_parent(simulation.scene, copy, simulation.turntable);
+            const glm::vec3 position((static_cast<float>(i % crowd_columns) - 0.5f * static_cast<float>(crowd_columns - 1)) * crowd_spacing, 0.0f,
+                                     -static_cast<float>(1 + i / crowd_columns) * crowd_spacing);
+            set_local_transform(simulation.scene, copy, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+            *find_draw(simulation.scene, copy) = { mesh_lod.index_count, mesh_lod.first_index, 0, 0 };
+        }
+    }
+    simulation.light_count = light_count;
+    if (!gpu_particles) {
+        simulation.particle_emitters = particle_emitters;
+        init_particle_system(simulation.particles, particle_capacity, particle_emitter_count);
+    }
 
-    //Allocate memory
-    data = static_cast<char*>(malloc(static_cast<uint32_t>(size)));
+    // Simulation thread: fixed steps, each one publishes a frame packet
+    std::thread simulation_thread([&]() {
+        const auto step_duration = std::chrono::duration_cast<FrameClock::duration>(std::chrono::duration<double>(simulation_step));
+        auto next_step = FrameClock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            input_mailbox.acquire();
+            simulate_frame(simulation, input_mailbox.front(), frame_mailbox.back());
+            frame_mailbox.publish();
+            if (simulation.step == 1) {
+                {
+                    std::lock_guard<std::mutex> lock(first_packet_mutex);
+                    first_packet_published = true;
+                }
+                first_packet_ready.notify_one();
+            }
+
+            // If we fell far behind (e.g. the process was suspended), don't try to catch up all at once
+            next_step += step_duration;
+            const auto now = FrameClock::now();
+            if (now - next_step > 4 * step_duration) {
+                next_step = now;
+            }
+            std::this_thread::sleep_until(next_step);
+        }
+    });
+
+    // Render thread: records and presents the newest frame packet
+    std::thread render_thread([&]() {
+        ClusterLightLists cpu_cluster_lights;
+        uint64_t validated_frames = 0;
+
+        // With --gpu-particles, the GPU steps the particles once per frame, by the simulation time since the frame
+        // before. The spawns are planned here, and with --validate-particles, the same steps run on the CPU too.
+        ParticleSystem cpu_particles;
+        init_particle_system(cpu_particles, validate_particles ? particle_capacity : 0, particle_emitter_count);
+        std::vector<ParticleSpawn> particle_spawns;
+        uint32_t particle_source = 0;
+        double particle_time = -1.0;
+        uint64_t validated_particle_frames = 0;
+
+        // The occlusion culling's objects, rebuilt from the draws every frame, and what it found the frame before.
+        // With --validate-occlusion, the CPU builds its own pyramid from the same depth, and tests the same objects.
+        std::vector<OcclusionObject> occlusion_objects;
+        OcclusionCounters occlusion_counters;
+        DepthPyramid cpu_depth_pyramid = depth_pyramid;
+        std::vector<uint8_t> cpu_visibility;
+        uint64_t validated_occlusion_frames = 0;
+
+        // The counters of a frame can be read once the CPU waited for it, into occlusion_counters, for the overlay
+        bool backbuffer_occlusion[backbuffer_count] = {};   // Whether the last frame of each backbuffer culled
+        const auto read_occlusion_counters = [&](const UINT backbuffer) {
+            occlusion_counters = {};
+            if (backbuffer_occlusion[backbuffer]) {
+                const SIZE_T counter_offset = backbuffer * sizeof(OcclusionCounters);
+                const D3D12_RANGE counter_read_range{ counter_offset, counter_offset + sizeof(OcclusionCounters) };
+                uint8_t* gpu_counters = nullptr;
+                throw_if_failed(occlusion_counter_readback->Map(0, &counter_read_range, reinterpret_cast<void**>(&gpu_counters)));
+                memcpy(&occlusion_counters, gpu_counters + counter_offset, sizeof(OcclusionCounters));
+                occlusion_counter_readback->Unmap(0, &const_range);
+            }
+        };
 
-    //Load file data into that memory
-    file_stream.seekg(0, std::ifstream::beg);
-    const std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(file_stream), {});
+        // The overlay shows the frame stats, smoothed so they're readable, and what building it cost the frame before
+        Overlay overlay;
+        double frame_ms = 0.0;
+        double overlay_build_ms = 0.0;
+        OverlayStats previous_overlay_stats;
+        auto previous_frame_start = FrameClock::now();
+        std::vector<ShaderReload> shader_reloads;
+
+        // Sleep until there's something to render, after that there's always a packet
+        {
+            std::unique_lock<std::mutex> lock(first_packet_mutex);
+            first_packet_ready.wait(lock, [&]() { return first_packet_published || !running.load(std::memory_order_relaxed); });
+        }
+        while (running.load(std::memory_order_relaxed)) {
+            frame_mailbox.acquire();
+            const FramePacket& packet = frame_mailbox.front();
+            const auto frame_start = FrameClock::now();
+            frame_ms += (std::chrono::duration<double, std::milli>(frame_start - previous_frame_start).count() - frame_ms) * 0.05;
+            previous_frame_start = frame_start;
+
+            // Swap in the pipelines that were rebuilt, before this frame records anything with them. The frames in
+            // flight can still be using the old ones.
+            shader_reloads.clear();
+            shader_reloader.take_reloads(shader_reloads);
+            for (const ShaderReload& reload : shader_reloads) {
+                ID3D12PipelineState*& reloaded_pipeline_state = *static_cast<ID3D12PipelineState**>(reload.user);
+                release_queue.enqueue_release(frame_fence_value + 1, reloaded_pipeline_state, reload.name);
+                reloaded_pipeline_state = static_cast<ID3D12PipelineState*>(reload.object);
+                printf("Reloaded %s, %.1f ms after the change (%.1f ms to build)\n", reload.name, reload.latency_ms, reload.build_ms);
+            }
+
+            // Update constant buffer
+            const uint32_t frame_light_count = static_cast<uint32_t>(packet.lights.size());
+            const_buffer_data_struct.view = packet.view;
+            const_buffer_data_struct.color_mul = packet.color_mul;
+            const_buffer_data_struct.light_count = frame_light_count;
+            const UINT64 const_buffer_offset = frame_index * const_buffer_slice_size;
+            throw_if_failed(const_buffer->Map(0, &const_range, reinterpret_cast<void**>(&const_data_begin)));
+            memcpy_s(const_data_begin + const_buffer_offset, sizeof(const_buffer_data_struct), &const_buffer_data_struct, sizeof(const_buffer_data_struct));
+            const_buffer->Unmap(0, nullptr);
+            const D3D12_GPU_VIRTUAL_ADDRESS const_buffer_address = const_buffer->GetGPUVirtualAddress() + const_buffer_offset;
+
+            // Upload the world transforms, into a bigger buffer if they don't fit anymore
+            if (packet.transforms.size() > transform_capacity) {
+                release_queue.enqueue_release(frame_fence_value + 1, transform_buffer.Detach(), "transform buffer");
+                while (transform_capacity < packet.transforms.size()) {
+                    transform_capacity *= 2;
+                }
+                transform_buffer = create_buffer(D3D12_HEAP_TYPE_UPLOAD, transform_capacity * sizeof(glm::mat4) * backbuffer_count,
+                    D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, L"Transform Buffer");
+            }
+            const UINT64 transform_offset = frame_index * transform_capacity * sizeof(glm::mat4);
+            if (!packet.transforms.empty()) {
+                uint8_t* transform_data = nullptr;
+                throw_if_failed(transform_buffer->Map(0, &const_range, reinterpret_cast<void**>(&transform_data)));
+                memcpy(transform_data + transform_offset, packet.transforms.data(), packet.transforms.size() * sizeof(glm::mat4));
+                transform_buffer->Unmap(0, nullptr);
+            }
+            const D3D12_GPU_VIRTUAL_ADDRESS transform_address = transform_buffer->GetGPUVirtualAddress() + transform_offset;
+
+            // Upload the lights, the last frame that used this backbuffer is done with them
+            const UINT64 light_offset = frame_index * light_buffer_slice_size;
+            if (frame_light_count > 0) {
+                uint8_t* light_data = nullptr;
+                throw_if_failed(light_buffer->Map(0, &const_range, reinterpret_cast<void**>(&light_data)));
+                memcpy(light_data + light_offset, packet.lights.data(), frame_light_count * sizeof(ClusterLight));
+                light_buffer->Unmap(0, nullptr);
+            }
+            const D3D12_GPU_VIRTUAL_ADDRESS light_address = light_buffer->GetGPUVirtualAddress() + light_offset;
+
+            // Copy the particle billboards into the upload ring. If the GPU is so far behind that they don't fit,
+            // they're not drawn this frame, rather than waiting for it.
+            D3D12_VERTEX_BUFFER_VIEW particle_buffer_view{};
+            UINT particle_instance_count = 0;
+            if (!packet.particles.empty()) {
+                const uint64_t particle_data_size = packet.particles.size() * sizeof(ParticleInstance);
+                const uint64_t particle_offset = upload_ring.allocate(particle_data_size, 16);
+                if (particle_offset != UploadRing::invalid_offset) {
+                    memcpy(upload_ring_data + particle_offset, packet.particles.data(), particle_data_size);
+                    particle_buffer_view = { upload_ring_buffer->GetGPUVirtualAddress() + particle_offset, static_cast<UINT>(particle_data_size),
+                                             sizeof(ParticleInstance) };
+                    particle_instance_count = static_cast<UINT>(packet.particles.size());
+                }
+            }
+
+            // Build the overlay: a panel with the frame stats, with the text clipped to the panel. That's one batch for
+            // the panel and one for the text, so two draws.
+            const auto overlay_start = FrameClock::now();
+            constexpr uint32_t overlay_text_color = overlay_color(255, 255, 255);
+            constexpr OverlayRect stats_panel{ 8, 8, 648, 152 };
+            begin_overlay(overlay, overlay_font, width, height, 2);
+            add_overlay_rect(overlay, stats_panel.left, stats_panel.top, stats_panel.right - stats_panel.left,
+                             stats_panel.bottom - stats_panel.top, overlay_color(0, 0, 0, 160));
+            set_overlay_scissor(overlay, { stats_panel.left + 4, stats_panel.top + 4, stats_panel.right - 4, stats_panel.bottom - 4 });
+            const int32_t stats_x = stats_panel.left + 8;
+            const int32_t stats_line = overlay_line_height * 2;
+            int32_t stats_y = stats_panel.top + 8;
+            add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "%.2f ms (%.0f fps)", frame_ms, frame_ms > 0.0 ? 1000.0 / frame_ms : 0.0);
+            stats_y += stats_line;
+            add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "step %llu, %zu draws, %u lights",
+                              static_cast<unsigned long long>(packet.sequence), packet.draws.size(), frame_light_count);
+            stats_y += stats_line;
+            if (gpu_particles) {
+                add_overlay_text(overlay, stats_x, stats_y, "particles simulated on the GPU", overlay_text_color);
+            }
+            else {
+                add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "%zu particles", packet.particles.size());
+            }
+            stats_y += stats_line;
+            add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "upload ring: %llu KB used",
+                              static_cast<unsigned long long>(upload_ring.used() >> 10));
+            stats_y += stats_line;
+            add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "overlay: %u quads, %u draws, %.3f ms",
+                              previous_overlay_stats.quads, previous_overlay_stats.batches, overlay_build_ms);
+            stats_y += stats_line;
+            if (occlusion_culling) {
+                add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "occlusion: %u + %u draws, %u occluded, %u outside",
+                                  occlusion_counters.early_draws, occlusion_counters.late_draws, occlusion_counters.occluded,
+                                  occlusion_counters.outside_frustum);
+            }
+            else {
+                add_overlay_textf(overlay, stats_x, stats_y, overlay_text_color, "draw bundle: recorded %llu times in %llu frames",
+                                  static_cast<unsigned long long>(draw_bundle.stats().recordings),
+                                  static_cast<unsigned long long>(draw_bundle.stats().uses));
+            }
+            previous_overlay_stats = overlay_stats(overlay);
+
+            // Copy all of its quads into the upload ring at once. Like the particles, no room means no overlay.
+            D3D12_VERTEX_BUFFER_VIEW overlay_buffer_view{};
+            if (overlay.quad_count > 0) {
+                const uint64_t overlay_data_size = overlay.quad_count * sizeof(OverlayQuad);
+                const uint64_t overlay_offset = upload_ring.allocate(overlay_data_size, 16);
+                if (overlay_offset != UploadRing::invalid_offset) {
+                    memcpy(upload_ring_data + overlay_offset, overlay.quads.data(), overlay_data_size);
+                    overlay_buffer_view = { upload_ring_buffer->GetGPUVirtualAddress() + overlay_offset, static_cast<UINT>(overlay_data_size),
+                                            sizeof(OverlayQuad) };
+                }
+            }
+            overlay_build_ms = std::chrono::duration<double, std::milli>(FrameClock::now() - overlay_start).count();
+
+            // Assign the lights to clusters: set their bits in the clusters they touch, wait for all of them, then
+            // turn the bitmasks into lists
+            command_list->SetComputeRootSignature(compute_root_signature.Get());
+            command_list->SetComputeRootConstantBufferView(0, const_buffer_address);
+            command_list->SetComputeRootShaderResourceView(1, light_address);
+            command_list->SetComputeRootShaderResourceView(2, cluster_bounds_buffer->GetGPUVirtualAddress());
+            command_list->SetComputeRootUnorderedAccessView(3, cluster_mask_buffer->GetGPUVirtualAddress());
+            command_list->SetComputeRootUnorderedAccessView(4, cluster_range_buffer->GetGPUVirtualAddress());
+            command_list->SetComputeRootUnorderedAccessView(5, cluster_light_index_buffer->GetGPUVirtualAddress());
+            if (frame_light_count > 0) {
+                command_list->SetPipelineState(cluster_assign_pipeline_state);
+                command_list->Dispatch((frame_light_count + 63) / 64, 1, 1);
+            }
+            D3D12_RESOURCE_BARRIER mask_barrier{};
+            mask_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            mask_barrier.UAV.pResource = cluster_mask_buffer.Get();
+            command_list->ResourceBarrier(1, &mask_barrier);
+            command_list->SetPipelineState(cluster_compact_pipeline_state);
+            command_list->Dispatch(1, 1, 1);
+
+            // The pixel shader reads the lists. Buffers go back to the common state once the command list is done,
+            // so they don't have to be transitioned back.
+            constexpr D3D12_RESOURCE_STATES list_read_state = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_COPY_SOURCE;
+            const D3D12_RESOURCE_BARRIER list_barriers[] = {
+                transition_barrier(cluster_range_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, list_read_state),
+                transition_barrier(cluster_light_index_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, list_read_state),
+            };
+            command_list->ResourceBarrier(_countof(list_barriers), list_barriers);
+            if (validate_lights) {
+                command_list->CopyResource(cluster_range_readback.Get(), cluster_range_buffer.Get());
+                command_list->CopyResource(cluster_light_index_readback.Get(), cluster_light_index_buffer.Get());
+            }
+
+            // Step the particles on the GPU: plan the spawns and upload the plan, integrate, turn the numbers of
+            // survivors into offsets, then compact and spawn into the other particle buffer
+            if (gpu_particles) {
+                const float delta_time = particle_time < 0.0 ? 0.0f : static_cast<float>(packet.simulation_time - particle_time);
+                particle_time = packet.simulation_time;
+                uint32_t spawn_total = plan_particle_spawns(cpu_particles, particle_emitters.data(), delta_time, particle_spawns);
+                uint64_t spawn_offset = upload_ring.allocate((particle_spawns.empty() ? 1 : particle_spawns.size()) * sizeof(ParticleSpawn), 16);
+                if (spawn_offset == UploadRing::invalid_offset) {
+                    // No room, so these particles are never spawned, on the GPU or the CPU
+                    particle_spawns.clear();
+                    spawn_total = 0;
+                    spawn_offset = 0;
+                }
+                else {
+                    memcpy(upload_ring_data + spawn_offset, particle_spawns.data(), particle_spawns.size() * sizeof(ParticleSpawn));
+                }
+                const glm::vec3 velocity_step = particle_gravity * delta_time;
+                if (validate_particles) {
+                    integrate_particles(cpu_particles, velocity_step, delta_time);
+                    spawn_particles(cpu_particles, particle_emitters.data(), particle_spawns.data(), static_cast<uint32_t>(particle_spawns.size()));
+                }
+
+                // Must match particle_constants in particles.hlsli
+                const struct {
+                    glm::vec3 velocity_step;
+                    float delta_time;
+                    uint32_t capacity;
+                    uint32_t spawn_count;
+                    uint32_t spawn_total;
+                } particle_constants{ velocity_step, delta_time, particle_capacity, static_cast<uint32_t>(particle_spawns.size()), spawn_total };
+                command_list->SetComputeRootSignature(particle_root_signature.Get());
+                command_list->SetComputeRoot32BitConstants(0, 7, &particle_constants, 0);
+                command_list->SetComputeRootShaderResourceView(1, particle_emitter_buffer->GetGPUVirtualAddress());
+                command_list->SetComputeRootShaderResourceView(2, upload_ring_buffer->GetGPUVirtualAddress() + spawn_offset);
+                command_list->SetComputeRootUnorderedAccessView(3, particle_buffers[particle_source]->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(4, particle_buffers[particle_source ^ 1]->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(5, particle_slot_buffer->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(6, particle_group_buffer->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(7, particle_state_buffer->GetGPUVirtualAddress());
+
+                // Every pass reads what the one before it wrote, a UAV barrier without a resource waits for all of them
+                D3D12_RESOURCE_BARRIER particle_pass_barrier{};
+                particle_pass_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+                particle_pass_barrier.UAV.pResource = nullptr;
+                command_list->SetPipelineState(particle_integrate_pipeline_state);
+                command_list->Dispatch(particle_capacity / 256, 1, 1);
+                command_list->ResourceBarrier(1, &particle_pass_barrier);
+                command_list->SetPipelineState(particle_scan_pipeline_state);
+                command_list->Dispatch(1, 1, 1);
+                command_list->ResourceBarrier(1, &particle_pass_barrier);
+                command_list->SetPipelineState(particle_compact_pipeline_state);
+                command_list->Dispatch(particle_capacity / 256, 1, 1);
+                particle_source ^= 1;
+
+                // The compacted particles are the instance data of the particle draw, the state has its arguments
+                const D3D12_RESOURCE_BARRIER particle_barriers[] = {
+                    transition_barrier(particle_buffers[particle_source].Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                                       D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_COPY_SOURCE),
+                    transition_barrier(particle_state_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                                       D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE),
+                };
+                command_list->ResourceBarrier(_countof(particle_barriers), particle_barriers);
+                if (validate_particles) {
+                    command_list->CopyResource(particle_readback.Get(), particle_buffers[particle_source].Get());
+                    command_list->CopyResource(particle_state_readback.Get(), particle_state_buffer.Get());
+                }
+                particle_buffer_view = { particle_buffers[particle_source]->GetGPUVirtualAddress(), static_cast<UINT>(particle_buffer_size),
+                                         sizeof(GpuParticle) };
+            }
+
+            // Occlusion culling, phase 1: write the draws of what was visible last frame. The objects, the constants
+            // and zeroed counters go through the upload ring, and without room for them, every draw is just drawn.
+            const uint32_t occlusion_object_count = static_cast<uint32_t>(packet.draws.size());
+            const glm::mat4 view_projection = projection * packet.view;
+            bool occlusion_active = occlusion_culling && occlusion_object_count > 0 && occlusion_object_count <= max_occlusion_objects;
+            uint64_t occlusion_object_offset = UploadRing::invalid_offset;
+            uint64_t occlusion_constant_offset = UploadRing::invalid_offset;
+            uint64_t occlusion_counter_offset = UploadRing::invalid_offset;
+            if (occlusion_active) {
+                occlusion_object_offset = upload_ring.allocate(occlusion_object_count * sizeof(OcclusionObject), 16);
+                occlusion_constant_offset = upload_ring.allocate(sizeof(OcclusionConstants), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+                occlusion_counter_offset = upload_ring.allocate(sizeof(OcclusionCounters), 16);
+                occlusion_active = occlusion_object_offset != UploadRing::invalid_offset && occlusion_constant_offset != UploadRing::invalid_offset &&
+                                   occlusion_counter_offset != UploadRing::invalid_offset;
+            }
+            if (occlusion_active) {
+                occlusion_objects.resize(occlusion_object_count);
+                for (uint32_t i = 0; i < occlusion_object_count; ++i) {
+                    const DrawItem& draw = packet.draws[i];
+                    occlusion_objects[i] = {
+                        glm::vec3(mesh_bounds.min[0], mesh_bounds.min[1], mesh_bounds.min[2]), draw.transform_index,
+                        glm::vec3(mesh_bounds.max[0], mesh_bounds.max[1], mesh_bounds.max[2]), draw.index_count,
+                        draw.first_index, draw.base_vertex, { 0, 0 },
+                    };
+                }
+                memcpy(upload_ring_data + occlusion_object_offset, occlusion_objects.data(), occlusion_object_count * sizeof(OcclusionObject));
+
+                OcclusionConstants occlusion_constants{};
+                occlusion_constants.view_projection = view_projection;
+                occlusion_constants.object_count = occlusion_object_count;
+                occlusion_constants.level_count = depth_pyramid.level_count;
+                occlusion_constants.depth_width = depth_pyramid.width;
+                occlusion_constants.depth_height = depth_pyramid.height;
+                memcpy(occlusion_constants.levels, depth_pyramid.levels, sizeof(depth_pyramid.levels));
+                memcpy(upload_ring_data + occlusion_constant_offset, &occlusion_constants, sizeof(OcclusionConstants));
+                memset(upload_ring_data + occlusion_counter_offset, 0, sizeof(OcclusionCounters));
+
+                command_list->CopyBufferRegion(occlusion_counter_buffer.Get(), 0, upload_ring_buffer.Get(), occlusion_counter_offset, sizeof(OcclusionCounters));
+                const D3D12_RESOURCE_BARRIER counter_barrier = transition_barrier(occlusion_counter_buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                                                                  D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                command_list->ResourceBarrier(1, &counter_barrier);
+
+                // These stay bound for the pyramid and phase 2, between the draws
+                ID3D12DescriptorHeap* occlusion_heaps[] = { const_buffer_heap.Get() };
+                command_list->SetDescriptorHeaps(_countof(occlusion_heaps), occlusion_heaps);
+                command_list->SetComputeRootSignature(occlusion_root_signature.Get());
+                command_list->SetComputeRoot32BitConstant(0, 0, 0);
+                command_list->SetComputeRootConstantBufferView(1, upload_ring_buffer->GetGPUVirtualAddress() + occlusion_constant_offset);
+                command_list->SetComputeRootDescriptorTable(2, { const_buffer_heap->GetGPUDescriptorHandleForHeapStart().ptr +
+                                                                 static_cast<UINT64>(depth_buffer_descriptor) * shader_descriptor_size });
+                command_list->SetComputeRootShaderResourceView(3, upload_ring_buffer->GetGPUVirtualAddress() + occlusion_object_offset);
+                command_list->SetComputeRootShaderResourceView(4, transform_address);
+                command_list->SetComputeRootUnorderedAccessView(5, depth_pyramid_buffer->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(6, occlusion_visibility_buffer->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(7, occlusion_draw_buffer->GetGPUVirtualAddress());
+                command_list->SetComputeRootUnorderedAccessView(8, occlusion_counter_buffer->GetGPUVirtualAddress());
+                command_list->SetPipelineState(occlusion_cull_pipeline_state);
+                command_list->Dispatch((occlusion_object_count + occlusion_group_size - 1) / occlusion_group_size, 1, 1);
+
+                const D3D12_RESOURCE_BARRIER early_draw_barriers[] = {
+                    transition_barrier(occlusion_draw_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+                    transition_barrier(occlusion_counter_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+                };
+                command_list->ResourceBarrier(_countof(early_draw_barriers), early_draw_barriers);
+            }
+            command_list->SetPipelineState(pipeline_state);
+
+            // Bind root signature
+            command_list->SetGraphicsRootSignature(root_signature.Get());
+
+            // Bind constant buffer
+            ID3D12DescriptorHeap* descriptor_heaps[] = { const_buffer_heap.Get() };
+            command_list->SetDescriptorHeaps(_countof(descriptor_heaps), descriptor_heaps);
+            D3D12_GPU_DESCRIPTOR_HANDLE const_buffer_view_handle(const_buffer_heap->GetGPUDescriptorHandleForHeapStart());
+            const_buffer_view_handle.ptr += static_cast<UINT64>(frame_index) * shader_descriptor_size;
+
+            // Set root descriptor table
+            command_list->SetGraphicsRootDescriptorTable(0, const_buffer_view_handle);
+
+            // Bind the light lists
+            command_list->SetGraphicsRootShaderResourceView(1, cluster_range_buffer->GetGPUVirtualAddress());
+            command_list->SetGraphicsRootShaderResourceView(2, cluster_light_index_buffer->GetGPUVirtualAddress());
+            command_list->SetGraphicsRootShaderResourceView(3, light_address);
+            command_list->SetGraphicsRootShaderResourceView(4, transform_address);
+
+            // Set backbuffer as render target
+            D3D12_RESOURCE_BARRIER render_target_barrier;
+            render_target_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            render_target_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            render_target_barrier.Transition.pResource = render_targets[frame_index].Get();
+            render_target_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+            render_target_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+            render_target_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            command_list->ResourceBarrier(1, &render_target_barrier);
+
+            // Set render target
+            D3D12_CPU_DESCRIPTOR_HANDLE render_target_view_handle(render_target_view_heap->GetCPUDescriptorHandleForHeapStart());
+            render_target_view_handle.ptr += static_cast<SIZE_T>(frame_index * render_target_view_descriptor_size);
+            D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil_view_handle(depth_stencil_view_heap->GetCPUDescriptorHandleForHeapStart());
+            command_list->OMSetRenderTargets(1, &render_target_view_handle, FALSE, &depth_stencil_view_handle);
+
+            // Record raster commands
+            constexpr float clear_color[] = {0.1f, 0.1f, 0.2f, 1.0f};
+            command_list->RSSetViewports(1, &viewport); // Set viewport
+            command_list->RSSetScissorRects(1, &surface_size); // todo: comment
+            command_list->ClearRenderTargetView(render_target_view_handle, clear_color, 0, nullptr); // Clear the screen
+            command_list->ClearDepthStencilView(depth_stencil_view_handle, D3D12_CLEAR_FLAG_DEPTH, reverse_z_clear_depth, 0, 0, nullptr); // Clear the depth buffer
+            command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST); // We draw triangles
+            command_list->IASetVertexBuffers(0, static_cast<UINT>(vertex_buffer_views.size()), vertex_buffer_views.data()); // Bind vertex buffers
+            command_list->IASetIndexBuffer(&index_buffer_view); // Bind index buffer
+            
+            // Submit draw calls. With occlusion culling, the draws of phase 1 go first, then the depth buffer is reduced
+            // into the pyramid, phase 2 tests every object against it, and its draws go after. The compute work in
+            // between needs its own pipeline state, the graphics root arguments are left alone.
+            if (occlusion_active) {
+                command_list->ExecuteIndirect(occlusion_command_signature.Get(), occlusion_object_count, occlusion_draw_buffer.Get(), 0,
+                                              occlusion_counter_buffer.Get(), offsetof(OcclusionCounters, early_draws));
+
+                const D3D12_RESOURCE_STATES depth_read_state = validate_occlusion ? D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_COPY_SOURCE
+                                                                                  : D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+                const D3D12_RESOURCE_BARRIER depth_read_barrier = transition_barrier(depth_buffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, depth_read_state);
+                command_list->ResourceBarrier(1, &depth_read_barrier);
+                if (validate_occlusion) {
+                    D3D12_TEXTURE_COPY_LOCATION depth_source{};
+                    depth_source.pResource = depth_buffer.Get();
+                    depth_source.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+                    depth_source.SubresourceIndex = 0;
+                    D3D12_TEXTURE_COPY_LOCATION depth_destination{};
+                    depth_destination.pResource = depth_readback.Get();
+                    depth_destination.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+                    depth_destination.PlacedFootprint = depth_readback_footprint;
+                    command_list->CopyTextureRegion(&depth_destination, 0, 0, 0, &depth_source, nullptr);
+                }
+
+                // Every level reads the one before it
+                D3D12_RESOURCE_BARRIER pyramid_level_barrier{};
+                pyramid_level_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+                pyramid_level_barrier.UAV.pResource = nullptr;
+                command_list->SetPipelineState(depth_pyramid_pipeline_state);
+                for (uint32_t level = 0; level < depth_pyramid.level_count; ++level) {
+                    command_list->SetComputeRoot32BitConstant(0, level, 0);
+                    command_list->Dispatch((depth_pyramid.levels[level].width + depth_pyramid_group_size - 1) / depth_pyramid_group_size,
+                                           (depth_pyramid.levels[level].height + depth_pyramid_group_size - 1) / depth_pyramid_group_size, 1);
+                    command_list->ResourceBarrier(1, &pyramid_level_barrier);
+                }
+
+                const D3D12_RESOURCE_BARRIER late_cull_barriers[] = {
+                    transition_barrier(occlusion_draw_buffer.Get(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+                    transition_barrier(occlusion_counter_buffer.Get(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+                };
+                command_list->ResourceBarrier(_countof(late_cull_barriers), late_cull_barriers);
+                command_list->SetComputeRoot32BitConstant(0, 1, 0);
+                command_list->SetPipelineState(occlusion_cull_pipeline_state);
+                command_list->Dispatch((occlusion_object_count + occlusion_group_size - 1) / occlusion_group_size, 1, 1);
+
+                const D3D12_RESOURCE_BARRIER late_draw_barriers[] = {
+                    transition_barrier(occlusion_draw_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+                    transition_barrier(occlusion_counter_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                                       D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE),
+                    transition_barrier(depth_buffer.Get(), depth_read_state, D3D12_RESOURCE_STATE_DEPTH_WRITE),
+                };
+                command_list->ResourceBarrier(_countof(late_draw_barriers), late_draw_barriers);
+                command_list->CopyBufferRegion(occlusion_counter_readback.Get(), frame_index * sizeof(OcclusionCounters), occlusion_counter_buffer.Get(), 0,
+                                               sizeof(OcclusionCounters));
+                if (validate_occlusion) {
+                    const D3D12_RESOURCE_BARRIER occlusion_copy_barriers[] = {
+                        transition_barrier(depth_pyramid_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+                        transition_barrier(occlusion_visibility_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+                    };
+                    command_list->ResourceBarrier(_countof(occlusion_copy_barriers), occlusion_copy_barriers);
+                    command_list->CopyResource(depth_pyramid_readback.Get(), depth_pyramid_buffer.Get());
+                    command_list->CopyResource(occlusion_visibility_readback.Get(), occlusion_visibility_buffer.Get());
+                }
+
+                command_list->SetPipelineState(pipeline_state);
+                command_list->ExecuteIndirect(occlusion_command_signature.Get(), occlusion_object_count, occlusion_draw_buffer.Get(),
+                                              static_cast<UINT64>(occlusion_object_count) * sizeof(OcclusionDrawCommand),
+                                              occlusion_counter_buffer.Get(), offsetof(OcclusionCounters, late_draws));
+            }
+            else if (!packet.draws.empty()) {
+                BundleKey& draw_key = draw_bundle.begin_key();
+                draw_key.add_pointer(pipeline_state);
+                draw_key.add_pointer(root_signature.Get());
+                draw_key.add(vertex_buffer_views.data(), vertex_buffer_views.size() * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+                draw_key.add_value(index_buffer_view);
+                draw_key.add(packet.draws.data(), packet.draws.size() * sizeof(DrawItem));
+                if (draw_bundle.needs_recording()) {
+                    release_queue.enqueue_release(frame_fence_value + 1, draw_bundle_list, "draw bundle");
+                    release_queue.enqueue_release(frame_fence_value + 1, draw_bundle_allocator, "draw bundle allocator");
+                    throw_if_failed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS(&draw_bundle_allocator)));
+                    throw_if_failed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, draw_bundle_allocator, pipeline_state,
+                                                              IID_PPV_ARGS(&draw_bundle_list)));
+                    draw_bundle_list->SetGraphicsRootSignature(root_signature.Get());
+                    draw_bundle_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                    draw_bundle_list->IASetVertexBuffers(0, static_cast<UINT>(vertex_buffer_views.size()), vertex_buffer_views.data());
+                    draw_bundle_list->IASetIndexBuffer(&index_buffer_view);
+                    for (const DrawItem& draw : packet.draws) {
+                        draw_bundle_list->SetGraphicsRoot32BitConstant(5, draw.transform_index, 0);
+                        draw_bundle_list->DrawIndexedInstanced(draw.index_count, 1, draw.first_index, draw.base_vertex, 0);
+                    }
+                    throw_if_failed(draw_bundle_list->Close());
+                }
+                command_list->ExecuteBundle(draw_bundle_list);
+            }
+
+            // Particles last, blended over everything else. Every one is a strip of 4 vertices.
+            if (particle_instance_count > 0 || gpu_particles) {
+                command_list->SetPipelineState(particle_pipeline_state);
+                command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+                command_list->IASetVertexBuffers(0, 1, &particle_buffer_view);
+                if (gpu_particles) {
+                    command_list->ExecuteIndirect(particle_command_signature.Get(), 1, particle_state_buffer.Get(), 0, nullptr, 0);
+                }
+                else {
+                    command_list->DrawInstanced(4, particle_instance_count, 0, 0);
+                }
+            }
+
+            // The overlay over everything, one draw per batch, each with its own scissor and texture
+            if (overlay_buffer_view.SizeInBytes > 0) {
+                const float overlay_constants[] = { 2.0f / width, -2.0f / height, -1.0f, 1.0f };
+                command_list->SetPipelineState(overlay_pipeline_state);
+                command_list->SetGraphicsRootSignature(overlay_root_signature.Get());
+                command_list->SetGraphicsRoot32BitConstants(0, _countof(overlay_constants), overlay_constants, 0);
+                command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+                command_list->IASetVertexBuffers(0, 1, &overlay_buffer_view);
+                const D3D12_GPU_DESCRIPTOR_HANDLE overlay_textures{ const_buffer_heap->GetGPUDescriptorHandleForHeapStart().ptr +
+                                                                    static_cast<UINT64>(overlay_texture_descriptor) * shader_descriptor_size };
+                for (const OverlayBatch& batch : overlay.batches) {
+                    if (batch.quad_count == 0) {
+                        continue;
+                    }
+                    const D3D12_RECT batch_scissor{ batch.scissor.left, batch.scissor.top, batch.scissor.right, batch.scissor.bottom };
+                    command_list->RSSetScissorRects(1, &batch_scissor);
+                    command_list->SetGraphicsRootDescriptorTable(1, { overlay_textures.ptr + static_cast<UINT64>(batch.texture) * shader_descriptor_size });
+                    command_list->DrawInstanced(4, batch.quad_count, 0, batch.first_quad);
+                }
+            }
+
+            // Present backbuffer
+            D3D12_RESOURCE_BARRIER present_barrier;
+            present_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            present_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            present_barrier.Transition.pResource = render_targets[frame_index].Get();
+            present_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+            present_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+            present_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            command_list->ResourceBarrier(1, &present_barrier);
+
+            // Finish the command list, we're done with the frame
+            throw_if_failed(command_list->Close());
+
+            // Execute command list
+            ID3D12CommandList* command_lists[] = { command_list };
+            command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+
+            // Present
+            swapchain->Present(1, 0);
+
+            // Signal the end of the frame, the next one is recorded while the GPU renders this one
+            throw_if_failed(command_queue->Signal(frame_fence.Get(), ++frame_fence_value));
+            backbuffer_frames[frame_index] = frame_fence_value;
+            backbuffer_occlusion[frame_index] = occlusion_active;
+            upload_ring.finish_frame(frame_fence_value);
+
+            // The validations compare what the GPU did in this frame with the CPU, so with any of them, the CPU waits
+            // for the frame right away. Their readback buffers are shared by all frames, which is fine since no other
+            // frame is in flight then.
+            const bool validate_frame = validate_lights || validate_particles || (occlusion_active && validate_occlusion);
+            if (validate_frame) {
+                wait_for_frame(frame_fence_value);
+                read_occlusion_counters(frame_index);
+            }
+
+            // Check the GPU's light lists against the CPU's, print the result now and then, and every mismatch
+            if (validate_lights) {
+                ClusterAssignStats cluster_stats;
+                const auto assign_start = FrameClock::now();
+                assign_lights_to_clusters(cluster_grid, packet.lights.data(), frame_light_count, cpu_cluster_lights, &cluster_stats);
+                const double assign_ms = std::chrono::duration<double, std::milli>(FrameClock::now() - assign_start).count();
+
+                const D3D12_RANGE range_read_range{ 0, static_cast<SIZE_T>(cluster_range_buffer_size) };
+                const D3D12_RANGE index_read_range{ 0, static_cast<SIZE_T>(cluster_light_index_buffer_size) };
+                void* gpu_ranges = nullptr;
+                void* gpu_light_indices = nullptr;
+                throw_if_failed(cluster_range_readback->Map(0, &range_read_range, &gpu_ranges));
+                throw_if_failed(cluster_light_index_readback->Map(0, &index_read_range, &gpu_light_indices));
+                const size_t differences = count_cluster_differences(cpu_cluster_lights, static_cast<const ClusterRange*>(gpu_ranges),
+                                                                     static_cast<const uint32_t*>(gpu_light_indices));
+                cluster_range_readback->Unmap(0, &const_range);
+                cluster_light_index_readback->Unmap(0, &const_range);
+
+                if (differences != 0 || validated_frames % 120 == 0) {
+                    printf("%u lights, %llu light/cluster pairs (%llu didn't fit), up to %u per cluster, %u empty clusters, "
+                           "%.3f ms on the CPU, %zu clusters differ from the GPU\n",
+                           frame_light_count, static_cast<unsigned long long>(cluster_stats.light_cluster_pairs),
+                           static_cast<unsigned long long>(cluster_stats.dropped), cluster_stats.max_cluster_lights,
+                           cluster_stats.empty_clusters, assign_ms, differences);
+                }
+                validated_frames++;
+            }
+
+            // Same for the particles
+            if (validate_particles) {
+                const D3D12_RANGE particle_read_range{ 0, static_cast<SIZE_T>(particle_buffer_size) };
+                const D3D12_RANGE state_read_range{ 0, static_cast<SIZE_T>(particle_state_size) };
+                void* gpu_particle_data = nullptr;
+                void* gpu_state_data = nullptr;
+                throw_if_failed(particle_readback->Map(0, &particle_read_range, &gpu_particle_data));
+                throw_if_failed(particle_state_readback->Map(0, &state_read_range, &gpu_state_data));
+                const uint32_t gpu_particle_count = static_cast<const uint32_t*>(gpu_state_data)[1];
+                const size_t differences = count_particle_differences(cpu_particles, static_cast<const GpuParticle*>(gpu_particle_data), gpu_particle_count);
+                particle_readback->Unmap(0, &const_range);
+                particle_state_readback->Unmap(0, &const_range);
+
+                if (differences != 0 || validated_particle_frames % 120 == 0) {
+                    printf("%u particles on the GPU, %u on the CPU, %zu differ\n", gpu_particle_count, cpu_particles.count, differences);
+                }
+                validated_particle_frames++;
+            }
+
+            // With --validate-occlusion, the GPU's pyramid and visibility checked against the CPU's
+            if (occlusion_active && validate_occlusion) {
+                const D3D12_RANGE depth_read_range{ 0, static_cast<SIZE_T>(depth_readback_footprint.Footprint.RowPitch) * depth_readback_footprint.Footprint.Height };
+                const D3D12_RANGE pyramid_read_range{ 0, static_cast<SIZE_T>(depth_pyramid_size) };
+                const D3D12_RANGE visibility_read_range{ 0, occlusion_object_count * sizeof(uint32_t) };
+                void* gpu_depth = nullptr;
+                void* gpu_pyramid = nullptr;
+                void* gpu_visibility = nullptr;
+                throw_if_failed(depth_readback->Map(0, &depth_read_range, &gpu_depth));
+                throw_if_failed(depth_pyramid_readback->Map(0, &pyramid_read_range, &gpu_pyramid));
+                throw_if_failed(occlusion_visibility_readback->Map(0, &visibility_read_range, &gpu_visibility));
+
+                OcclusionCullStats occlusion_stats;
+                const auto cull_start = FrameClock::now();
+                build_depth_pyramid(static_cast<const float*>(gpu_depth), depth_readback_footprint.Footprint.RowPitch / sizeof(float), cpu_depth_pyramid);
+                cpu_visibility.resize(occlusion_object_count);
+                cull_occluded_objects(occlusion_objects.data(), occlusion_object_count, packet.transforms.data(), view_projection,
+                                      cpu_depth_pyramid, cpu_visibility.data(), &occlusion_stats);
+                const double cull_ms = std::chrono::duration<double, std::milli>(FrameClock::now() - cull_start).count();
+
+                const size_t pyramid_differences = count_depth_pyramid_differences(cpu_depth_pyramid, static_cast<const float*>(gpu_pyramid));
+                size_t visibility_differences = 0;
+                for (uint32_t i = 0; i < occlusion_object_count; ++i) {
+                    visibility_differences += (static_cast<const uint32_t*>(gpu_visibility)[i] != 0) != (cpu_visibility[i] != 0) ? 1 : 0;
+                }
+                depth_readback->Unmap(0, &const_range);
+                depth_pyramid_readback->Unmap(0, &const_range);
+                occlusion_visibility_readback->Unmap(0, &const_range);
+
+                if (pyramid_differences != 0 || visibility_differences != 0 || validated_occlusion_frames % 120 == 0) {
+                    printf("%u objects, %u outside the frustum, %u occluded, %u visible, %u + %u draws on the GPU, %.3f ms on the CPU, "
+                           "%zu pyramid texels and %zu objects differ from the GPU\n",
+                           occlusion_stats.tested, occlusion_stats.outside_frustum, occlusion_stats.occluded, occlusion_stats.visible,
+                           occlusion_counters.early_draws, occlusion_counters.late_draws, cull_ms, pyramid_differences, visibility_differences);
+                }
+                validated_occlusion_frames++;
+            }
+
+            // Wait for the last frame that rendered to the next backbuffer, then its command allocator and its part of the
+            // per-frame buffers can be reused. Without validation, the overlay shows what the occlusion culling found in it.
+            frame_index = swapchain->GetCurrentBackBufferIndex();
+            wait_for_frame(backbuffer_frames[frame_index]);
+            if (!validate_frame) {
+                read_occlusion_counters(frame_index);
+            }
+
+            // Release what the GPU is done with, a limited amount per frame to avoid spikes
+            release_queue.retire(frame_fence->GetCompletedValue(), release_budget_per_frame);
+            upload_ring.retire(frame_fence->GetCompletedValue());
+
+            // Reset command allocator and use the raster graphics pipeline
+            throw_if_failed(command_allocators[frame_index]->Reset());
+            throw_if_failed(command_list->Reset(command_allocators[frame_index].Get(), pipeline_state));
+        }
+    });
 
-    //Is it actually open?
-    if (buffer.empty())
+    // Main thread: sample the input on its own cadence, or sooner when events come in
+    constexpr double input_interval = 1.0 / 240.0;
+    uint64_t input_sequence = 0;
+    while (!glfwWindowShouldClose(window)) {
+        glfwWaitEventsTimeout(input_interval);
+        InputState& input = input_mailbox.back();
+        input.sequence = ++input_sequence;
+        input.sample_time = FrameClock::now();
+        glfwGetCursorPos(window, &input.cursor_x, &input.cursor_y);
+        input.pause_held = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+        input_mailbox.publish();
+    }
     {
-        if (!silent)
-            printf("[ERROR] Failed to open file '%s'!\n", path.c_str());
-        free(data);
-        size_bytes = 0;
-        data = nullptr;
-        return;
-    }
-    memcpy(data, buffer.data(), size_bytes);
+        std::lock_guard<std::mutex> lock(first_packet_mutex);
+        running = false;
+    }
+    first_packet_ready.notify_one();
+    simulation_thread.join();
+    render_thread.join();
+    shader_reloader.stop();
+
+    // Wait for the GPU to finish everything, then release what's left. The queue reports anything that's still in it.
+    release_queue.enqueue_release(frame_fence_value + 1, command_list, "command list");
+    release_queue.enqueue_release(frame_fence_value + 1, draw_bundle_list, "draw bundle");
+    release_queue.enqueue_release(frame_fence_value + 1, draw_bundle_allocator, "draw bundle allocator");
+    release_queue.enqueue_release(frame_fence_value + 1, pipeline_state, "pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, cluster_assign_pipeline_state, "light assignment pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, cluster_compact_pipeline_state, "light compaction pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, particle_pipeline_state, "particle pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, overlay_pipeline_state, "overlay pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, particle_integrate_pipeline_state, "particle integration pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, particle_scan_pipeline_state, "particle scan pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, particle_compact_pipeline_state, "particle compaction pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, depth_pyramid_pipeline_state, "depth pyramid pipeline state");
+    release_queue.enqueue_release(frame_fence_value + 1, occlusion_cull_pipeline_state, "occlusion culling pipeline state");
+    throw_if_failed(command_queue->Signal(frame_fence.Get(), ++frame_fence_value));
+    wait_for_frame(frame_fence_value);
+    release_queue.retire(frame_fence->GetCompletedValue());
+    upload_ring_buffer->Unmap(0, nullptr);
+
+    /* TODO
+    * // TO FIX THE CODE
+    * - Split each step into its own function
+    * - Dont Repeat Yourself
+    * - Maybe just pop this into the FlanRenderer-RW header, it was made for cross-api stuff so might as well
+    */
 }
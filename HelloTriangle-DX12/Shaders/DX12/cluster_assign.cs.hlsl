@@ -0,0 +1,47 @@
+#include "light_clusters.hlsli"
+
+/* LIGHT ASSIGNMENT
+* One thread per light. It tests its light against every cluster the light could reach, and sets the light's
+* bit in the bitmask of every cluster it touches. The bitmasks are turned into lists by cluster_compact.cs.hlsl.
+* It's the same test as assign_lights_to_clusters() in light_clusters.cpp, (dz * dz + dy * dy) + dx * dx against
+* radius * radius, and every step is precise, so both get exactly the same result.
+*/
+
+StructuredBuffer<ClusterLight> lights : register(t0);
+StructuredBuffer<float2> cluster_bounds : register(t1);
+RWStructuredBuffer<uint> cluster_light_masks : register(u0);
+
+[numthreads(64, 1, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID)
+{
+    const uint light_index = thread_id.x;
+    if (light_index >= min(light_count, MAX_CLUSTER_LIGHTS)) {
+        return;
+    }
+    const ClusterLight light = lights[light_index];
+    precise float radius_squared = light.radius * light.radius;
+    const uint word = light_index / 32;
+    const uint bit = 1u << (light_index % 32);
+
+    for (uint slice = 0; slice < CLUSTER_SLICES; ++slice) {
+        precise float dz = axis_distance(cluster_bounds[CLUSTER_BOUNDS_Z(slice)], light.position.z);
+        precise float dz_squared = dz * dz;
+        if (dz_squared > radius_squared) {
+            continue;
+        }
+        for (uint row = 0; row < CLUSTER_TILES_Y; ++row) {
+            precise float dy = axis_distance(cluster_bounds[CLUSTER_BOUNDS_Y(slice, row)], light.position.y);
+            precise float yz_squared = dz_squared + dy * dy;
+            if (yz_squared > radius_squared) {
+                continue;
+            }
+            for (uint column = 0; column < CLUSTER_TILES_X; ++column) {
+                precise float dx = axis_distance(cluster_bounds[CLUSTER_BOUNDS_X(slice, column)], light.position.x);
+                precise float distance_squared = yz_squared + dx * dx;
+                if (distance_squared <= radius_squared) {
+                    InterlockedOr(cluster_light_masks[cluster_index(slice, row, column) * CLUSTER_MASK_WORDS + word], bit);
+                }
+            }
+        }
+    }
+}
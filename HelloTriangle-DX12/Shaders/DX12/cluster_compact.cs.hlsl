@@ -0,0 +1,68 @@
+#include "light_clusters.hlsli"
+
+/* LIGHT LIST COMPACTION
+* One group turns the bitmasks from cluster_assign.cs.hlsl into a list of light indices per cluster:
+* - Every thread counts the lights in a few neighboring clusters
+* - A prefix sum over the group gives every thread the offset of its first cluster's list
+* - Every thread writes the lists of its clusters, in light order, and clears their bitmasks for the next frame
+*   (they start out cleared, since committed resources are zeroed)
+* So the lists are in cluster order, no matter which threads run first, like in light_clusters.cpp. The offsets
+* are where the lists would be if the index list was big enough, clusters past its end get a count of 0.
+*/
+
+#define COMPACT_THREADS 1024
+#define CLUSTERS_PER_THREAD ((CLUSTER_COUNT + COMPACT_THREADS - 1) / COMPACT_THREADS)
+
+RWStructuredBuffer<uint> cluster_light_masks : register(u0);
+RWStructuredBuffer<ClusterRange> cluster_ranges : register(u1);
+RWStructuredBuffer<uint> cluster_light_indices : register(u2);
+
+groupshared uint thread_totals[COMPACT_THREADS];
+
+[numthreads(COMPACT_THREADS, 1, 1)]
+void main(uint thread_index : SV_GroupIndex)
+{
+    // Lights past the last word were never assigned, and their bits were cleared when they were
+    const uint word_count = (min(light_count, MAX_CLUSTER_LIGHTS) + 31) / 32;
+    const uint first_cluster = thread_index * CLUSTERS_PER_THREAD;
+    const uint end_cluster = min(first_cluster + CLUSTERS_PER_THREAD, CLUSTER_COUNT);
+
+    // Count
+    uint total = 0;
+    for (uint cluster = first_cluster; cluster < end_cluster; ++cluster) {
+        for (uint word = 0; word < word_count; ++word) {
+            total += countbits(cluster_light_masks[cluster * CLUSTER_MASK_WORDS + word]);
+        }
+    }
+    thread_totals[thread_index] = total;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Inclusive prefix sum over the threads, then take out our own total
+    for (uint step = 1; step < COMPACT_THREADS; step *= 2) {
+        const uint value = thread_index >= step ? thread_totals[thread_index - step] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        thread_totals[thread_index] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    uint offset = thread_totals[thread_index] - total;
+
+    // Write the lists
+    for (uint cluster = first_cluster; cluster < end_cluster; ++cluster) {
+        ClusterRange range;
+        range.offset = offset;
+        for (uint word = 0; word < word_count; ++word) {
+            const uint mask_index = cluster * CLUSTER_MASK_WORDS + word;
+            uint bits = cluster_light_masks[mask_index];
+            cluster_light_masks[mask_index] = 0;
+            while (bits != 0) {
+                if (offset < MAX_CLUSTER_LIGHT_INDICES) {
+                    cluster_light_indices[offset] = word * 32 + firstbitlow(bits);
+                }
+                offset++;
+                bits &= bits - 1;
+            }
+        }
+        range.count = range.offset >= MAX_CLUSTER_LIGHT_INDICES ? 0 : min(offset - range.offset, MAX_CLUSTER_LIGHT_INDICES - range.offset);
+        cluster_ranges[cluster] = range;
+    }
+}
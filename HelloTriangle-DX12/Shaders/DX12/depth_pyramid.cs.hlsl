@@ -0,0 +1,37 @@
+#include "occlusion_culling.hlsli"
+
+/* DEPTH PYRAMID
+* One level per dispatch (pass_index), one thread per texel. A texel gets the farthest depth, the smallest with
+* reverse-Z, of the 2x2 texels under it: in the depth buffer for level 0, in the level before for the others. At the
+* edge of an odd-sized level, the last row or column is used twice. Same as build_depth_pyramid() in
+* occlusion_culling.cpp.
+*/
+
+Texture2D<float> depth_buffer : register(t0);
+RWStructuredBuffer<float> depth_pyramid : register(u0);
+
+[numthreads(DEPTH_PYRAMID_GROUP_SIZE, DEPTH_PYRAMID_GROUP_SIZE, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID)
+{
+    const uint4 level = pyramid_levels[pass_index];
+    if (thread_id.x >= level.y || thread_id.y >= level.z) {
+        return;
+    }
+
+    float depth;
+    const uint2 first = thread_id.xy * 2;
+    if (pass_index == 0) {
+        const uint2 last = min(first + 1, uint2(depth_width, depth_height) - 1);
+        depth = min(min(depth_buffer.Load(int3(first.x, first.y, 0)), depth_buffer.Load(int3(last.x, first.y, 0))),
+                    min(depth_buffer.Load(int3(first.x, last.y, 0)), depth_buffer.Load(int3(last.x, last.y, 0))));
+    }
+    else {
+        const uint4 source = pyramid_levels[pass_index - 1];
+        const uint2 last = min(first + 1, source.yz - 1);
+        const uint row_0 = source.x + first.y * source.y;
+        const uint row_1 = source.x + last.y * source.y;
+        depth = min(min(depth_pyramid[row_0 + first.x], depth_pyramid[row_0 + last.x]),
+                    min(depth_pyramid[row_1 + first.x], depth_pyramid[row_1 + last.x]));
+    }
+    depth_pyramid[level.x + thread_id.y * level.y + thread_id.x] = depth;
+}
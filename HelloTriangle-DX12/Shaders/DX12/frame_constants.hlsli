@@ -0,0 +1,16 @@
+#ifndef FRAME_CONSTANTS_HLSLI
+#define FRAME_CONSTANTS_HLSLI
+
+// Must match the constant buffer in HelloTriangle-DX12.cpp
+cbuffer frame_constants : register(b0)
+{
+    float4x4 view;
+    float4x4 projection;
+    float3 color_mul;
+    uint light_count;
+    float2 cluster_tile_scale;      // See ClusterLookup in light_clusters.h
+    float cluster_slice_scale;
+    float cluster_slice_bias;
+};
+
+#endif
@@ -1,6 +1,14 @@
+#include "light_clusters.hlsli"
+
+StructuredBuffer<ClusterRange> cluster_ranges : register(t0);
+StructuredBuffer<uint> cluster_light_indices : register(t1);
+StructuredBuffer<ClusterLight> lights : register(t2);
+
 struct PixelInput
 {
     float3 color : COLOR;
+    float3 view_position : VIEW_POSITION;
+    float4 position : SV_Position;
 };
 
 struct PixelOutput
@@ -10,8 +18,27 @@ struct PixelOutput
 
 PixelOutput main(PixelInput pixel_input)
 {
+    // The face normal, from how the position changes across the screen, so meshes without normals get lit too
+    const float3 view_position = pixel_input.view_position;
+    const float3 normal = normalize(cross(ddy(view_position), ddx(view_position)));
+
+    // Only the lights of this pixel's cluster can reach it
+    float3 lighting = 0.25f;
+    const ClusterRange range = cluster_ranges[cluster_at(pixel_input.position.xy, -view_position.z)];
+    for (uint i = 0; i < range.count; ++i) {
+        const ClusterLight light = lights[cluster_light_indices[range.offset + i]];
+        const float3 to_light = light.position - view_position;
+        const float distance_squared = dot(to_light, to_light);
+        const float radius_squared = light.radius * light.radius;
+        if (distance_squared < radius_squared) {
+            // Falls off smoothly to 0 at the light's radius
+            const float falloff = 1.0f - distance_squared / radius_squared;
+            lighting += light.color * (falloff * falloff * saturate(dot(normal, to_light * rsqrt(max(distance_squared, 1e-8f)))));
+        }
+    }
+
     float3 in_color = pixel_input.color;
     PixelOutput output;
-    output.attachment0 = float4(in_color, 1.0f);
+    output.attachment0 = float4(in_color * lighting, 1.0f);
     return output;
 }
\ No newline at end of file
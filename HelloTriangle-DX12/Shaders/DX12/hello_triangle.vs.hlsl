@@ -1,6 +1,10 @@
-cbuffer cb : register(b0)
+#include "frame_constants.hlsli"
+
+// The world transforms of all draws, and which one this draw uses
+StructuredBuffer<float4x4> transforms : register(t3);
+cbuffer draw_constants : register(b1)
 {
-    float3 color : packoffset(c0);
+    uint transform_index;
 };
 
 struct VertexInput
@@ -12,13 +16,16 @@ struct VertexInput
 struct VertexOutput
 {
     float3 color : COLOR;
+    float3 view_position : VIEW_POSITION;
     float4 position : SV_Position;
 };
 
 VertexOutput main(VertexInput vertexInput)
 {
     VertexOutput output;
-    output.color = vertexInput.in_color * color;
-    output.position = float4(vertexInput.in_pos, 0.5f);
+    const float4 view_position = mul(view, mul(transforms[transform_index], float4(vertexInput.in_pos, 1.0f)));
+    output.color = vertexInput.in_color * color_mul;
+    output.view_position = view_position.xyz;
+    output.position = mul(projection, view_position);
     return output;
 }
\ No newline at end of file
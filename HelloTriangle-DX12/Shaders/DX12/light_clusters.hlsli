@@ -0,0 +1,63 @@
+#ifndef LIGHT_CLUSTERS_HLSLI
+#define LIGHT_CLUSTERS_HLSLI
+#include "frame_constants.hlsli"
+
+/* CLUSTERED LIGHTING
+* See light_clusters.h. The compute shaders assign the lights to clusters (cluster_assign.cs.hlsl, then
+* cluster_compact.cs.hlsl), and pixel shaders find their cluster with cluster_at() and loop over its lights.
+* The CPU version in light_clusters.cpp gives exactly the same lists, so anything that changes the test here
+* has to change there too.
+*/
+
+// Must match light_clusters.h
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+#define MAX_CLUSTER_LIGHTS 16384
+#define MAX_CLUSTER_LIGHT_INDICES (1 << 20)
+
+// Every cluster has a bitmask with one bit per light while the lights are assigned
+#define CLUSTER_MASK_WORDS (MAX_CLUSTER_LIGHTS / 32)
+
+// Where the ranges of ClusterBounds are in the cluster bounds buffer
+#define CLUSTER_BOUNDS_Z(slice) (slice)
+#define CLUSTER_BOUNDS_X(slice, column) (CLUSTER_SLICES + (slice) * CLUSTER_TILES_X + (column))
+#define CLUSTER_BOUNDS_Y(slice, row) (CLUSTER_SLICES * (1 + CLUSTER_TILES_X) + (slice) * CLUSTER_TILES_Y + (row))
+
+struct ClusterLight
+{
+    float3 position;    // View space
+    float radius;
+    float3 color;
+    float padding;
+};
+
+struct ClusterRange
+{
+    uint offset;
+    uint count;
+};
+
+uint cluster_index(uint slice, uint row, uint column)
+{
+    return (slice * CLUSTER_TILES_Y + row) * CLUSTER_TILES_X + column;
+}
+
+// How far p is outside of the range, 0 if it's inside. Precise, like everything the light test computes, so the
+// compiler can't fuse it into a mad or reorder it, which would make it differ from the CPU.
+float axis_distance(float2 range, float p)
+{
+    precise float distance = max(max(range.x - p, p - range.y), 0.0f);
+    return distance;
+}
+
+// The cluster of a pixel, from its position (SV_Position.xy) and its view space depth
+uint cluster_at(float2 pixel, float depth)
+{
+    const uint2 tile = min(uint2(max(pixel * cluster_tile_scale, 0.0f)), uint2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+    const float slice = log2(max(depth, 1e-30f)) * cluster_slice_scale + cluster_slice_bias;
+    return cluster_index(min(uint(max(slice, 0.0f)), CLUSTER_SLICES - 1), tile.y, tile.x);
+}
+
+#endif
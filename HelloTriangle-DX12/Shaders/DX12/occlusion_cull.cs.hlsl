@@ -0,0 +1,137 @@
+#include "occlusion_culling.hlsli"
+
+/* OCCLUSION CULLING PHASES
+* One thread per object, pass_index 0 runs phase 1 and 1 runs phase 2 (see occlusion_culling.h):
+* - Phase 1 writes the draws of the objects that were visible last frame, unless they're outside the frustum now.
+* - Phase 2 tests every object against the depth pyramid of what phase 1 drew, like test_occlusion() in
+*   occlusion_culling.cpp, and writes the draws of the visible ones that phase 1 didn't draw. What it finds is the
+*   visible set of the next frame.
+* The draws of phase 1 start at 0 in draw_commands, the ones of phase 2 at object_count. The order of the draws
+* depends on which thread gets there first, which doesn't matter with a depth test.
+*/
+
+StructuredBuffer<OcclusionObject> objects : register(t1);
+StructuredBuffer<ObjectTransform> transforms : register(t2);
+RWStructuredBuffer<float> depth_pyramid : register(u0);
+RWStructuredBuffer<uint> object_visibility : register(u1);
+RWStructuredBuffer<OcclusionDrawCommand> draw_commands : register(u2);
+RWStructuredBuffer<uint> occlusion_counters : register(u3);
+
+uint test_occlusion(OcclusionObject object, ObjectTransform world)
+{
+    float4 corners[8];
+    clip_corners(object, world, corners);
+
+    // Outside if all corners are outside the same plane. A box that reaches past the near plane can't be
+    // projected, so it counts as visible.
+    uint outside = 0xffffffff;
+    bool crossing_near = false;
+    [unroll]
+    for (uint i = 0; i < 8; ++i) {
+        const uint outcode = clip_outcode(corners[i]);
+        outside &= outcode;
+        crossing_near = crossing_near || (outcode & OUTCODE_NEAR) != 0 || corners[i].w <= 0.0f;
+    }
+    if (outside != 0) {
+        return OCCLUSION_RESULT_OUTSIDE_FRUSTUM;
+    }
+    if (crossing_near) {
+        return OCCLUSION_RESULT_VISIBLE;
+    }
+
+    // The level 0 texels the box covers
+    const float x_scale = float(depth_width) * 0.25f;
+    const float y_scale = float(depth_height) * 0.25f;
+    const int max_x = int(pyramid_levels[0].y) - 1;
+    const int max_y = int(pyramid_levels[0].z) - 1;
+    int2 low = int2(max_x, max_y);
+    int2 high = int2(0, 0);
+    [unroll]
+    for (uint j = 0; j < 8; ++j) {
+        precise float x_numerator = (corners[j].x + corners[j].w) * x_scale;
+        precise float y_numerator = (corners[j].w - corners[j].y) * y_scale;
+        const int2 texel = int2(floor_ratio(x_numerator, corners[j].w, max_x), floor_ratio(y_numerator, corners[j].w, max_y));
+        low = min(low, texel);
+        high = max(high, texel);
+    }
+
+    // The first level where that's at most 4x4 texels, and the farthest depth of those
+    uint level_index = 0;
+    while (level_index + 1 < level_count && ((high.x >> level_index) - (low.x >> level_index) > 3 || (high.y >> level_index) - (low.y >> level_index) > 3)) {
+        ++level_index;
+    }
+    const uint4 level = pyramid_levels[level_index];
+    const int2 first = low >> level_index;
+    const int2 last = high >> level_index;
+    float farthest = depth_pyramid[level.x + uint(first.y) * level.y + uint(first.x)];
+    for (int y = first.y; y <= last.y; ++y) {
+        for (int x = first.x; x <= last.x; ++x) {
+            farthest = min(farthest, depth_pyramid[level.x + uint(y) * level.y + uint(x)]);
+        }
+    }
+
+    // Hidden if every corner is farther away, z / w < farthest
+    [unroll]
+    for (uint k = 0; k < 8; ++k) {
+        precise float behind = farthest * corners[k].w;
+        if (!(corners[k].z < behind)) {
+            return OCCLUSION_RESULT_VISIBLE;
+        }
+    }
+    return OCCLUSION_RESULT_OCCLUDED;
+}
+
+void write_draw(OcclusionObject object, uint counter, uint first_command)
+{
+    uint slot;
+    InterlockedAdd(occlusion_counters[counter], 1, slot);
+    OcclusionDrawCommand command;
+    command.transform_index = object.transform_index;
+    command.index_count = object.index_count;
+    command.instance_count = 1;
+    command.first_index = object.first_index;
+    command.base_vertex = object.base_vertex;
+    command.first_instance = 0;
+    draw_commands[first_command + slot] = command;
+}
+
+[numthreads(OCCLUSION_GROUP_SIZE, 1, 1)]
+void main(uint3 thread_id : SV_DispatchThreadID)
+{
+    const uint index = thread_id.x;
+    if (index >= object_count) {
+        return;
+    }
+    const OcclusionObject object = objects[index];
+    const ObjectTransform world = transforms[object.transform_index];
+    const bool was_visible = object_visibility[index] != 0;
+
+    if (pass_index == 0) {
+        if (was_visible) {
+            float4 corners[8];
+            clip_corners(object, world, corners);
+            uint outside = 0xffffffff;
+            [unroll]
+            for (uint i = 0; i < 8; ++i) {
+                outside &= clip_outcode(corners[i]);
+            }
+            if (outside == 0) {
+                write_draw(object, OCCLUSION_EARLY_DRAWS, 0);
+            }
+        }
+        return;
+    }
+
+    const uint result = test_occlusion(object, world);
+    if (result == OCCLUSION_RESULT_OUTSIDE_FRUSTUM) {
+        InterlockedAdd(occlusion_counters[OCCLUSION_OUTSIDE_FRUSTUM], 1);
+    }
+    else if (result == OCCLUSION_RESULT_OCCLUDED) {
+        InterlockedAdd(occlusion_counters[OCCLUSION_OCCLUDED], 1);
+    }
+    const bool visible = result == OCCLUSION_RESULT_VISIBLE;
+    if (visible && !was_visible) {
+        write_draw(object, OCCLUSION_LATE_DRAWS, object_count);
+    }
+    object_visibility[index] = visible ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+#ifndef OCCLUSION_CULLING_HLSLI
+#define OCCLUSION_CULLING_HLSLI
+
+/* OCCLUSION CULLING
+* See occlusion_culling.h. depth_pyramid.cs.hlsl builds the depth pyramid, one level per dispatch, and
+* occlusion_cull.cs.hlsl runs the two culling phases. They do what build_depth_pyramid() and test_occlusion() in
+* occlusion_culling.cpp do, with only mul, add and min, every step precise, so both get exactly the same results.
+* So anything that changes the math here has to change there too.
+*/
+
+// Must match occlusion_culling.h
+#define MAX_DEPTH_PYRAMID_LEVELS 16
+#define OCCLUSION_GROUP_SIZE 64
+#define DEPTH_PYRAMID_GROUP_SIZE 8
+
+// The counters, see OcclusionCounters. The first two are the draw counts of the two phases, which ExecuteIndirect reads.
+#define OCCLUSION_EARLY_DRAWS 0
+#define OCCLUSION_LATE_DRAWS 1
+#define OCCLUSION_OUTSIDE_FRUSTUM 2
+#define OCCLUSION_OCCLUDED 3
+
+// What test_occlusion() finds, like OcclusionResult
+#define OCCLUSION_RESULT_VISIBLE 0
+#define OCCLUSION_RESULT_OUTSIDE_FRUSTUM 1
+#define OCCLUSION_RESULT_OCCLUDED 2
+
+#define OUTCODE_NEAR 16
+
+struct OcclusionObject
+{
+    float3 box_min;
+    uint transform_index;
+    float3 box_max;
+    uint index_count;
+    uint first_index;
+    int base_vertex;
+    uint2 padding;
+};
+
+struct OcclusionDrawCommand
+{
+    uint transform_index;
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint first_instance;
+};
+
+// A world transform, column by column, like glm stores it
+struct ObjectTransform
+{
+    float4 columns[4];
+};
+
+// Root constant, set by the render loop in HelloTriangle-DX12.cpp: the level to build, or the culling phase
+cbuffer occlusion_pass : register(b0)
+{
+    uint pass_index;
+};
+
+// Must match OcclusionConstants in occlusion_culling.h
+cbuffer occlusion_constants : register(b1)
+{
+    float4 view_projection[4];      // Columns
+    uint object_count;
+    uint level_count;
+    uint depth_width;
+    uint depth_height;
+    uint4 pyramid_levels[MAX_DEPTH_PYRAMID_LEVELS];     // Offset, width, height, of every level
+};
+
+// Same as clip_outcode() in occlusion_culling.cpp
+uint clip_outcode(float4 corner)
+{
+    return (corner.x < -corner.w ? 1u : 0u) | (corner.x > corner.w ? 2u : 0u) | (corner.y < -corner.w ? 4u : 0u) |
+           (corner.y > corner.w ? 8u : 0u) | (corner.z > corner.w ? OUTCODE_NEAR : 0u) | (corner.z < 0.0f ? 32u : 0u);
+}
+
+// m * v, one column at a time, same as transform_column() in occlusion_culling.cpp
+float4 transform_column(float4 m[4], float4 v)
+{
+    precise float4 x = m[0] * v.x;
+    precise float4 xy = x + m[1] * v.y;
+    precise float4 xyz = xy + m[2] * v.z;
+    precise float4 xyzw = xyz + m[3] * v.w;
+    return xyzw;
+}
+
+// Same as clip_corners() in occlusion_culling.cpp
+void clip_corners(OcclusionObject object, ObjectTransform world, out float4 corners[8])
+{
+    float4 columns[4];
+    for (uint i = 0; i < 4; ++i) {
+        columns[i] = transform_column(view_projection, world.columns[i]);
+    }
+    precise float3 extent = object.box_max - object.box_min;
+    const float4 base = transform_column(columns, float4(object.box_min, 1.0f));
+    precise float4 axis_x = columns[0] * extent.x;
+    precise float4 axis_y = columns[1] * extent.y;
+    precise float4 axis_z = columns[2] * extent.z;
+    [unroll]
+    for (uint corner = 0; corner < 8; ++corner) {
+        precise float4 position = base;
+        if (corner & 1) {
+            position = position + axis_x;
+        }
+        if (corner & 2) {
+            position = position + axis_y;
+        }
+        if (corner & 4) {
+            position = position + axis_z;
+        }
+        corners[corner] = position;
+    }
+}
+
+// The largest q in [0, max_q] with q * denominator <= numerator, same as floor_ratio() in occlusion_culling.cpp. The
+// division is only the first guess, it isn't exact here, the products decide.
+int floor_ratio(float numerator, float denominator, int max_q)
+{
+    const float estimate = numerator / denominator;
+    int q = 0;
+    if (estimate > 0.0f) {
+        q = estimate < float(max_q) ? int(estimate) : max_q;
+    }
+    [loop]
+    while (q > 0) {
+        precise float product = float(q) * denominator;
+        if (product <= numerator) {
+            break;
+        }
+        --q;
+    }
+    [loop]
+    while (q < max_q) {
+        precise float product = float(q + 1) * denominator;
+        if (product > numerator) {
+            break;
+        }
+        ++q;
+    }
+    return q;
+}
+
+#endif
@@ -0,0 +1,23 @@
+Texture2D overlay_texture : register(t0);
+SamplerState overlay_sampler : register(s0);
+
+struct PixelInput
+{
+    float4 color : COLOR;
+    float2 uv : TEXCOORD;
+    float4 position : SV_Position;
+};
+
+struct PixelOutput
+{
+    float4 attachment0 : SV_Target0;
+};
+
+// The texture is premultiplied too, the glyph atlas is white where a glyph covers it. Point sampled, so text stays
+// sharp at whole pixel sizes.
+PixelOutput main(PixelInput pixel_input)
+{
+    PixelOutput output;
+    output.attachment0 = pixel_input.color * overlay_texture.Sample(overlay_sampler, pixel_input.uv);
+    return output;
+}
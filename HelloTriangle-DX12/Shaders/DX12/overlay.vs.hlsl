@@ -0,0 +1,38 @@
+/* OVERLAY
+* One instance per quad, drawn as a triangle strip of 4 vertices, like the particles. The quad is in pixels from the
+* top left of the screen, the root constants turn that into clip space.
+*/
+
+// Must match the root constants in HelloTriangle-DX12.cpp
+cbuffer overlay_constants : register(b0)
+{
+    float2 pixel_scale;                 // 2 / width, -2 / height
+    float2 pixel_offset;                // -1, 1
+};
+
+struct OverlayInput
+{
+    int4 rect : OVERLAY_RECT;           // Left, top, right, bottom
+    float4 uv : OVERLAY_UV;             // Same order
+    float4 color : OVERLAY_COLOR;       // Premultiplied alpha
+    uint vertex_id : SV_VertexID;
+};
+
+struct OverlayOutput
+{
+    float4 color : COLOR;
+    float2 uv : TEXCOORD;
+    float4 position : SV_Position;
+};
+
+OverlayOutput main(OverlayInput input)
+{
+    OverlayOutput output;
+    const bool right = (input.vertex_id & 1) != 0;
+    const bool bottom = (input.vertex_id & 2) != 0;
+    const float2 pixel = float2(right ? input.rect.z : input.rect.x, bottom ? input.rect.w : input.rect.y);
+    output.color = input.color;
+    output.uv = float2(right ? input.uv.z : input.uv.x, bottom ? input.uv.w : input.uv.y);
+    output.position = float4(pixel * pixel_scale + pixel_offset, 0.0f, 1.0f);
+    return output;
+}
@@ -0,0 +1,20 @@
+struct PixelInput
+{
+    float4 color : COLOR;
+    float2 corner : CORNER;
+    float4 position : SV_Position;
+};
+
+struct PixelOutput
+{
+    float4 attachment0 : SV_Target0;
+};
+
+// A soft round dot. The color is premultiplied, so it's blended with ONE, INV_SRC_ALPHA.
+PixelOutput main(PixelInput pixel_input)
+{
+    PixelOutput output;
+    const float falloff = saturate(1.0f - dot(pixel_input.corner, pixel_input.corner));
+    output.attachment0 = pixel_input.color * (falloff * falloff);
+    return output;
+}
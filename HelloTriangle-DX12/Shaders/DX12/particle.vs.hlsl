@@ -0,0 +1,33 @@
+#include "frame_constants.hlsli"
+
+/* PARTICLE BILLBOARDS
+* One instance per particle, drawn as a triangle strip of 4 vertices. The corners come from SV_VertexID, so only
+* the instance data is in a vertex buffer. The quad is spread out in view space, so it always faces the camera.
+*/
+
+struct ParticleInput
+{
+    float3 position : PARTICLE_POSITION;
+    float size : PARTICLE_SIZE;
+    float4 color : PARTICLE_COLOR;      // Premultiplied alpha
+    uint vertex_id : SV_VertexID;
+};
+
+struct ParticleOutput
+{
+    float4 color : COLOR;
+    float2 corner : CORNER;             // -1 to 1 across the quad
+    float4 position : SV_Position;
+};
+
+ParticleOutput main(ParticleInput input)
+{
+    ParticleOutput output;
+    const float2 corner = float2((input.vertex_id & 1) != 0 ? 1.0f : -1.0f, (input.vertex_id & 2) != 0 ? -1.0f : 1.0f);
+    float4 view_position = mul(view, float4(input.position, 1.0f));
+    view_position.xy += corner * input.size;
+    output.color = input.color;
+    output.corner = corner;
+    output.position = mul(projection, view_position);
+    return output;
+}
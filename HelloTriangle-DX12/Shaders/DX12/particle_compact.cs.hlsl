@@ -0,0 +1,46 @@
+#include "particles.hlsli"
+
+/* PARTICLE COMPACTION AND SPAWNING
+* One thread per particle slot. A survivor is copied to the place of its group's first survivor plus its place in
+* the group, so the survivors stay in order. Thread i also spawns particle i of the spawn plan, after all
+* survivors, unless it doesn't fit anymore. It finds the plan entry it belongs to with a binary search, the entries
+* are in order of their first particle.
+*/
+
+StructuredBuffer<ParticleEmitter> emitters : register(t0);
+StructuredBuffer<ParticleSpawn> spawns : register(t1);
+RWStructuredBuffer<Particle> particles : register(u0);
+RWStructuredBuffer<Particle> compacted_particles : register(u1);
+RWStructuredBuffer<uint> particle_slots : register(u2);
+RWStructuredBuffer<uint> group_offsets : register(u3);
+RWStructuredBuffer<uint> particle_state : register(u4);
+
+[numthreads(PARTICLE_GROUP_SIZE, 1, 1)]
+void main(uint3 group_id : SV_GroupID, uint3 thread_id : SV_DispatchThreadID)
+{
+    const uint index = thread_id.x;
+    const uint slot = particle_slots[index];
+    if (slot != PARTICLE_DEAD) {
+        compacted_particles[group_offsets[group_id.x] + slot] = particles[index];
+    }
+
+    const uint alive = particle_state[PARTICLE_STATE_ALIVE];
+    if (index >= spawn_total || alive + index >= capacity) {
+        return;
+    }
+
+    // The last entry whose first particle is at or before this one
+    uint low = 0;
+    uint high = spawn_count;
+    while (high - low > 1) {
+        const uint middle = (low + high) / 2;
+        if (spawns[middle].first <= index) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+    const ParticleSpawn spawn = spawns[low];
+    compacted_particles[alive + index] = spawn_particle(emitters[spawn.emitter], spawn.sequence + (index - spawn.first));
+}
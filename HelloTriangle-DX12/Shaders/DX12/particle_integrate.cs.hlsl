@@ -0,0 +1,50 @@
+#include "particles.hlsli"
+
+/* PARTICLE INTEGRATION
+* One thread per particle slot. Every particle is integrated in place, and the survivors of a group get their
+* place among the group's survivors, in order, from a prefix sum over the group. The group's number of survivors
+* goes into group_offsets, which particle_scan.cs.hlsl turns into the place of the group's first survivor.
+* Slots past the particle count are dead, so every slot gets written, and nothing needs to be cleared.
+*/
+
+RWStructuredBuffer<Particle> particles : register(u0);
+RWStructuredBuffer<uint> particle_slots : register(u2);
+RWStructuredBuffer<uint> group_offsets : register(u3);
+RWStructuredBuffer<uint> particle_state : register(u4);
+
+groupshared uint alive_counts[PARTICLE_GROUP_SIZE];
+
+[numthreads(PARTICLE_GROUP_SIZE, 1, 1)]
+void main(uint3 group_id : SV_GroupID, uint3 thread_id : SV_DispatchThreadID, uint thread_index : SV_GroupIndex)
+{
+    const uint index = thread_id.x;
+    uint alive = 0;
+    if (index < particle_state[PARTICLE_STATE_COUNT]) {
+        Particle particle = particles[index];
+        precise float3 velocity = particle.velocity + velocity_step;
+        precise float3 position = particle.position + velocity * delta_time;
+        precise float age = particle.age + delta_time;
+        if (age < particle.lifetime) {
+            alive = 1;
+            particle.position = position;
+            particle.velocity = velocity;
+            particle.age = age;
+            particles[index] = particle;
+        }
+    }
+
+    // Inclusive prefix sum over the group
+    alive_counts[thread_index] = alive;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint step = 1; step < PARTICLE_GROUP_SIZE; step *= 2) {
+        const uint value = thread_index >= step ? alive_counts[thread_index - step] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        alive_counts[thread_index] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    particle_slots[index] = alive != 0 ? alive_counts[thread_index] - 1 : PARTICLE_DEAD;
+    if (thread_index == PARTICLE_GROUP_SIZE - 1) {
+        group_offsets[group_id.x] = alive_counts[thread_index];
+    }
+}
@@ -0,0 +1,56 @@
+#include "particles.hlsli"
+
+/* PARTICLE SCAN
+* One group turns the number of survivors of every group from particle_integrate.cs.hlsl into the place of the
+* group's first survivor, with a prefix sum, like the chunk offsets in integrate_particles(). The total is the
+* number of survivors, and with the spawned particles that fit, the new particle count, which goes straight into
+* the arguments of the particle draw.
+*/
+
+#define SCAN_THREADS 1024
+#define GROUPS_PER_THREAD (MAX_PARTICLES / PARTICLE_GROUP_SIZE / SCAN_THREADS)
+
+RWStructuredBuffer<uint> group_offsets : register(u3);
+RWStructuredBuffer<uint> particle_state : register(u4);
+
+groupshared uint thread_totals[SCAN_THREADS];
+
+[numthreads(SCAN_THREADS, 1, 1)]
+void main(uint thread_index : SV_GroupIndex)
+{
+    const uint group_count = capacity / PARTICLE_GROUP_SIZE;
+    const uint first_group = thread_index * GROUPS_PER_THREAD;
+
+    uint counts[GROUPS_PER_THREAD];
+    uint total = 0;
+    for (uint i = 0; i < GROUPS_PER_THREAD; ++i) {
+        counts[i] = first_group + i < group_count ? group_offsets[first_group + i] : 0;
+        total += counts[i];
+    }
+    thread_totals[thread_index] = total;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Inclusive prefix sum over the threads, then take out our own total
+    for (uint step = 1; step < SCAN_THREADS; step *= 2) {
+        const uint value = thread_index >= step ? thread_totals[thread_index - step] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        thread_totals[thread_index] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    uint offset = thread_totals[thread_index] - total;
+    for (uint j = 0; j < GROUPS_PER_THREAD; ++j) {
+        if (first_group + j < group_count) {
+            group_offsets[first_group + j] = offset;
+        }
+        offset += counts[j];
+    }
+
+    if (thread_index == SCAN_THREADS - 1) {
+        const uint alive = thread_totals[thread_index];
+        particle_state[PARTICLE_STATE_VERTICES] = 4;
+        particle_state[PARTICLE_STATE_COUNT] = min(alive + spawn_total, capacity);
+        particle_state[2] = 0;
+        particle_state[3] = 0;
+        particle_state[PARTICLE_STATE_ALIVE] = alive;
+    }
+}
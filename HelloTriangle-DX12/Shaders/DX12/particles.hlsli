@@ -0,0 +1,105 @@
+#ifndef PARTICLES_HLSLI
+#define PARTICLES_HLSLI
+
+/* PARTICLES
+* See particles.h. A step runs in three compute shaders, which do what integrate_particles() and spawn_particles()
+* in particles.cpp do, and give exactly the same particles in the same order:
+* - particle_integrate.cs.hlsl integrates every particle in place, and gives every survivor its place among the
+*   survivors of its group
+* - particle_scan.cs.hlsl gives every group the place of its first survivor, and works out the new particle count
+* - particle_compact.cs.hlsl copies the survivors to the other particle buffer, and spawns the particles of the
+*   spawn plan after them
+* So anything that changes the math here has to change there too.
+*/
+
+// Must match particles.h
+#define MAX_PARTICLES (1 << 20)
+
+#define PARTICLE_GROUP_SIZE 256
+#define PARTICLE_DEAD 0xffffffff
+
+// The particle state buffer. It starts with the arguments of the particle draw, so the particles can be drawn
+// with ExecuteIndirect without the CPU knowing how many there are: vertices per instance, instances (the
+// particle count), first vertex, first instance. After those comes the number of survivors of the step.
+#define PARTICLE_STATE_VERTICES 0
+#define PARTICLE_STATE_COUNT 1
+#define PARTICLE_STATE_ALIVE 4
+#define PARTICLE_STATE_SIZE 5
+
+struct ParticleEmitter
+{
+    float3 position;
+    float rate;
+    float3 velocity;
+    float velocity_spread;
+    float lifetime;
+    float size;
+    uint color;
+    uint seed;
+};
+
+struct ParticleSpawn
+{
+    uint emitter;
+    uint first;
+    uint count;
+    uint sequence;
+};
+
+struct Particle
+{
+    float3 position;
+    float age;
+    float3 velocity;
+    float lifetime;
+    float size;
+    uint color;
+    uint2 padding;
+};
+
+// Root constants, set by the render loop in HelloTriangle-DX12.cpp
+cbuffer particle_constants : register(b0)
+{
+    float3 velocity_step;   // gravity * delta_time, computed on the CPU
+    float delta_time;
+    uint capacity;          // Of the particle buffers, a multiple of PARTICLE_GROUP_SIZE
+    uint spawn_count;       // Entries in the spawn plan
+    uint spawn_total;       // Particles the spawn plan spawns
+};
+
+// Same as particle_hash() in particles.cpp
+uint particle_hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// In [0, 1), exact
+float particle_random(uint seed, uint sequence, uint k)
+{
+    return float(particle_hash(seed ^ particle_hash(sequence * 4 + k)) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Particle `sequence` of an emitter, like spawn_particle() in particles.cpp
+Particle spawn_particle(ParticleEmitter emitter, uint sequence)
+{
+    Particle particle;
+    particle.position = emitter.position;
+    particle.age = 0.0f;
+    precise float3 random = float3(particle_random(emitter.seed, sequence, 0), particle_random(emitter.seed, sequence, 1),
+                                   particle_random(emitter.seed, sequence, 2));
+    precise float3 velocity = (random * 2.0f - 1.0f) * emitter.velocity_spread + emitter.velocity;
+    precise float lifetime = (particle_random(emitter.seed, sequence, 3) * 0.5f + 0.75f) * emitter.lifetime;
+    particle.velocity = velocity;
+    particle.lifetime = lifetime;
+    particle.size = emitter.size;
+    particle.color = emitter.color;
+    particle.padding = uint2(0, 0);
+    return particle;
+}
+
+#endif
@@ -0,0 +1,697 @@
+#include "blend_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include "texture_convert.h"
+
+namespace {
+    uint32_t float_bits(const float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bits_float(const uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    float saturate(const float value) {
+        return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f; // Also turns NaN into 0
+    }
+
+    uint32_t float_to_unorm(const float value, const float max_value) {
+        return static_cast<uint32_t>(saturate(value) * max_value + 0.5f);
+    }
+
+    constexpr bool is_unorm_format(const RenderTargetFormat format) {
+        return format == RenderTargetFormat::r8g8b8a8_unorm || format == RenderTargetFormat::r8g8b8a8_unorm_srgb || format == RenderTargetFormat::r10g10b10a2_unorm;
+    }
+
+    // The bits of the channels that are enabled in a write mask
+    uint64_t channel_bits(const RenderTargetFormat format, const uint8_t write_mask) {
+        static constexpr uint64_t rgba8_bits[4] = { 0xff, 0xff00, 0xff0000, 0xff000000 };
+        static constexpr uint64_t rgb10a2_bits[4] = { 0x3ff, 0x3ffull << 10, 0x3ffull << 20, 0x3ull << 30 };
+        static constexpr uint64_t r11g11b10_bits[4] = { 0x7ff, 0x7ffull << 11, 0x3ffull << 22, 0 };
+        static constexpr uint64_t rgba16_bits[4] = { 0xffff, 0xffffull << 16, 0xffffull << 32, 0xffffull << 48 };
+        const uint64_t* bits = rgba8_bits;
+        switch (format) {
+            case RenderTargetFormat::r10g10b10a2_unorm: bits = rgb10a2_bits; break;
+            case RenderTargetFormat::r11g11b10_float: bits = r11g11b10_bits; break;
+            case RenderTargetFormat::r16g16b16a16_float: bits = rgba16_bits; break;
+            default: break;
+        }
+        uint64_t result = 0;
+        for (uint32_t channel = 0; channel < 4; ++channel) {
+            if (write_mask & (1u << channel)) {
+                result |= bits[channel];
+            }
+        }
+        return result;
+    }
+
+    /* SRGB
+    * Decoding is a table lookup, since there are only 256 values. Encoding compares against the 255 linear values
+    * where the sRGB value rounds up to the next one, which gives exactly round(srgb(x) * 255), computed in doubles,
+    * without calling pow() for every pixel. The exponent and the top 8 mantissa bits of the value pick a bucket, and
+    * since the buckets are small enough that none of them contains more than one of those thresholds, one compare
+    * against the bucket's next threshold finishes the job.
+    */
+    double srgb_encode(const double linear) {
+        return linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+    }
+
+    double srgb_decode(const double srgb) {
+        return srgb <= 0.04045 ? srgb / 12.92 : std::pow((srgb + 0.055) / 1.055, 2.4);
+    }
+
+    constexpr uint32_t srgb_bucket_shift = 15;
+    constexpr uint32_t srgb_first_bucket = (127 - 13) << (23 - srgb_bucket_shift);  // Everything below 2^-13 encodes to 0
+    constexpr uint32_t srgb_bucket_count = (127 << (23 - srgb_bucket_shift)) - srgb_first_bucket + 1;
+
+    struct SrgbTables {
+        float to_linear[256];
+        float thresholds[256];  // The smallest linear value that encodes to i + 1, the last one is never reached
+        uint8_t buckets[srgb_bucket_count];  // The sRGB value of the start of the bucket
+
+        SrgbTables() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                to_linear[i] = static_cast<float>(srgb_decode(i / 255.0));
+            }
+            for (uint32_t i = 0; i < 255; ++i) {
+                const double target = i + 0.5;
+                float threshold = static_cast<float>(srgb_decode(target / 255.0));
+                while (threshold > 0.0f && srgb_encode(std::nextafter(threshold, 0.0f)) * 255.0 >= target) {
+                    threshold = std::nextafter(threshold, 0.0f);
+                }
+                while (srgb_encode(threshold) * 255.0 < target) {
+                    threshold = std::nextafter(threshold, 2.0f);
+                }
+                thresholds[i] = threshold;
+            }
+            thresholds[255] = 2.0f;
+            uint32_t value = 0;
+            for (uint32_t bucket = 0; bucket < srgb_bucket_count; ++bucket) {
+                const float start = bits_float((srgb_first_bucket + bucket) << srgb_bucket_shift);
+                while (value < 255 && thresholds[value] <= start) {
+                    ++value;
+                }
+                buckets[bucket] = static_cast<uint8_t>(value);
+            }
+        }
+    };
+
+    const SrgbTables& srgb_tables() {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    uint32_t linear_to_srgb8(const float value) {
+        const double scaled = srgb_encode(saturate(value)) * 255.0;
+        uint32_t result = static_cast<uint32_t>(scaled);
+        if (scaled - result >= 0.5) {
+            ++result;
+        }
+        return std::min(result, 255u);
+    }
+
+    // Branchless version of linear_to_srgb8()
+    uint32_t lookup_srgb8(const SrgbTables& tables, const float value) {
+        const float clamped = saturate(value);
+        const int32_t bucket = static_cast<int32_t>(float_bits(clamped) >> srgb_bucket_shift) - static_cast<int32_t>(srgb_first_bucket);
+        const uint32_t start = tables.buckets[std::max(bucket, 0)];
+        return start + (clamped >= tables.thresholds[start] ? 1 : 0);
+    }
+
+    /* SMALL FLOATS
+    * R11G11B10_FLOAT has unsigned floats with 5 exponent bits, and 6 (red and green) or 5 (blue) mantissa bits.
+    * Conversion rounds to nearest even, and like for RGB9E5, negative values and NaN become 0, and values that are
+    * too large are clamped to the largest finite one.
+    */
+    uint32_t round_shift(const uint32_t value, const uint32_t shift) {
+        return (value + (1u << (shift - 1)) - 1 + ((value >> shift) & 1)) >> shift;
+    }
+
+    uint32_t float_to_small_float(const float value, const uint32_t mantissa_bits) {
+        if (!(value > 0.0f)) {
+            return 0;
+        }
+        const uint32_t max_value = (30u << mantissa_bits) | ((1u << mantissa_bits) - 1);
+        const uint32_t bits = float_bits(value);
+        const int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 + 15;
+        const uint32_t shift = 23 - mantissa_bits;
+        uint32_t result = 0;
+        if (exponent >= 1) {
+            result = round_shift((static_cast<uint32_t>(exponent) << 23) | (bits & 0x7fffff), shift);
+        }
+        else {
+            // Denormal, the implicit 1 becomes part of the mantissa
+            const uint32_t denormal_shift = shift + 1 + static_cast<uint32_t>(-exponent);
+            if (denormal_shift < 32) {
+                result = round_shift((bits & 0x7fffff) | 0x800000, denormal_shift);
+            }
+        }
+        return std::min(result, max_value);
+    }
+
+    // Branchless version of float_to_small_float()
+    uint32_t float_to_small_float_branchless(const float value, const uint32_t mantissa_bits) {
+        const uint32_t max_value = (30u << mantissa_bits) | ((1u << mantissa_bits) - 1);
+        const uint32_t bits = float_bits(value);
+        const int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 + 15;
+        const uint32_t shift = 23 - mantissa_bits;
+        const uint32_t normal = round_shift((static_cast<uint32_t>(exponent) << 23) | (bits & 0x7fffff), shift);
+        const uint32_t denormal_shift = static_cast<uint32_t>(std::clamp(static_cast<int32_t>(shift) + 1 - exponent, 1, 31));
+        const uint32_t denormal = round_shift((bits & 0x7fffff) | 0x800000, denormal_shift);
+        const uint32_t result = std::min(exponent >= 1 ? normal : denormal, max_value);
+        return value > 0.0f ? result : 0;
+    }
+
+    // Also used for halves, without the sign
+    float small_float_to_float(const uint32_t value, const uint32_t mantissa_bits) {
+        const uint32_t exponent = (value >> mantissa_bits) & 31;
+        const uint32_t mantissa = value & ((1u << mantissa_bits) - 1);
+        if (exponent == 0) {
+            return std::ldexp(static_cast<float>(mantissa), -14 - static_cast<int>(mantissa_bits));
+        }
+        if (exponent == 31) {
+            return bits_float(0x7f800000 | (mantissa << (23 - mantissa_bits)));
+        }
+        return bits_float(((exponent + 112) << 23) | (mantissa << (23 - mantissa_bits)));
+    }
+
+    // Branchless version of small_float_to_float()
+    float small_float_to_float_branchless(const uint32_t value, const uint32_t mantissa_bits) {
+        const uint32_t exponent = (value >> mantissa_bits) & 31;
+        const uint32_t mantissa = value & ((1u << mantissa_bits) - 1);
+        const float denormal = static_cast<float>(mantissa) * bits_float((127u - 14u - mantissa_bits) << 23);
+        const uint32_t biased_exponent = exponent == 31 ? 255 : exponent + 112;
+        const float normal = bits_float((biased_exponent << 23) | (mantissa << (23 - mantissa_bits)));
+        return exponent == 0 ? denormal : normal;
+    }
+
+    float half_to_float(const uint32_t half) {
+        return bits_float(float_bits(small_float_to_float(half & 0x7fff, 10)) | ((half & 0x8000) << 16));
+    }
+
+    float half_to_float_branchless(const uint32_t half) {
+        return bits_float(float_bits(small_float_to_float_branchless(half & 0x7fff, 10)) | ((half & 0x8000) << 16));
+    }
+
+    /* 8 PIXELS AT A TIME
+    * All loops go over the 8 lanes, with the work for every lane written without branches, so the compiler can
+    * turn every loop into a few vector instructions.
+    */
+    template <RenderTargetFormat format>
+    using PixelType = std::conditional_t<format == RenderTargetFormat::r16g16b16a16_float, uint64_t, uint32_t>;
+
+    template <RenderTargetFormat format>
+    void pack_lanes(const float source[4][shader_lane_count], PixelType<format>* destination) {
+        if constexpr (format == RenderTargetFormat::r8g8b8a8_unorm) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[lane] = float_to_unorm(source[0][lane], 255.0f) | (float_to_unorm(source[1][lane], 255.0f) << 8)
+                    | (float_to_unorm(source[2][lane], 255.0f) << 16) | (float_to_unorm(source[3][lane], 255.0f) << 24);
+            }
+        }
+        else if constexpr (format == RenderTargetFormat::r8g8b8a8_unorm_srgb) {
+            const SrgbTables& tables = srgb_tables();
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[lane] = lookup_srgb8(tables, source[0][lane]) | (lookup_srgb8(tables, source[1][lane]) << 8)
+                    | (lookup_srgb8(tables, source[2][lane]) << 16) | (float_to_unorm(source[3][lane], 255.0f) << 24);
+            }
+        }
+        else if constexpr (format == RenderTargetFormat::r10g10b10a2_unorm) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[lane] = float_to_unorm(source[0][lane], 1023.0f) | (float_to_unorm(source[1][lane], 1023.0f) << 10)
+                    | (float_to_unorm(source[2][lane], 1023.0f) << 20) | (float_to_unorm(source[3][lane], 3.0f) << 30);
+            }
+        }
+        else if constexpr (format == RenderTargetFormat::r11g11b10_float) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[lane] = float_to_small_float_branchless(source[0][lane], 6) | (float_to_small_float_branchless(source[1][lane], 6) << 11)
+                    | (float_to_small_float_branchless(source[2][lane], 5) << 22);
+            }
+        }
+        else {
+            uint16_t halves[4][shader_lane_count];
+            for (uint32_t channel = 0; channel < 4; ++channel) {
+                float_to_half(source[channel], halves[channel], shader_lane_count);
+            }
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[lane] = halves[0][lane] | (static_cast<uint64_t>(halves[1][lane]) << 16) | (static_cast<uint64_t>(halves[2][lane]) << 32)
+                    | (static_cast<uint64_t>(halves[3][lane]) << 48);
+            }
+        }
+    }
+
+    template <RenderTargetFormat format>
+    void unpack_lanes(const PixelType<format>* source, float destination[4][shader_lane_count]) {
+        if constexpr (format == RenderTargetFormat::r8g8b8a8_unorm || format == RenderTargetFormat::r8g8b8a8_unorm_srgb) {
+            const float* to_linear = srgb_tables().to_linear;
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                for (uint32_t channel = 0; channel < 4; ++channel) {
+                    const uint32_t value = (source[lane] >> (channel * 8)) & 0xff;
+                    const bool srgb = format == RenderTargetFormat::r8g8b8a8_unorm_srgb && channel < 3;
+                    destination[channel][lane] = srgb ? to_linear[value] : static_cast<float>(value) / 255.0f;
+                }
+            }
+        }
+        else if constexpr (format == RenderTargetFormat::r10g10b10a2_unorm) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[0][lane] = static_cast<float>(source[lane] & 0x3ff) / 1023.0f;
+                destination[1][lane] = static_cast<float>((source[lane] >> 10) & 0x3ff) / 1023.0f;
+                destination[2][lane] = static_cast<float>((source[lane] >> 20) & 0x3ff) / 1023.0f;
+                destination[3][lane] = static_cast<float>(source[lane] >> 30) / 3.0f;
+            }
+        }
+        else if constexpr (format == RenderTargetFormat::r11g11b10_float) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                destination[0][lane] = small_float_to_float_branchless(source[lane] & 0x7ff, 6);
+                destination[1][lane] = small_float_to_float_branchless((source[lane] >> 11) & 0x7ff, 6);
+                destination[2][lane] = small_float_to_float_branchless(source[lane] >> 22, 5);
+                destination[3][lane] = 1.0f;
+            }
+        }
+        else {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                for (uint32_t channel = 0; channel < 4; ++channel) {
+                    destination[channel][lane] = half_to_float_branchless(static_cast<uint32_t>(source[lane] >> (channel * 16)) & 0xffff);
+                }
+            }
+        }
+    }
+
+    // Alpha uses the alpha version of the color factors, so `channel` picks the source and destination channel
+    float blend_factor_value(const BlendFactor factor, const uint32_t channel, const float source[4], const float destination[4], const float constant[4]) {
+        switch (factor) {
+            case BlendFactor::zero: return 0.0f;
+            case BlendFactor::one: return 1.0f;
+            case BlendFactor::src_color: return source[channel];
+            case BlendFactor::inv_src_color: return 1.0f - source[channel];
+            case BlendFactor::src_alpha: return source[3];
+            case BlendFactor::inv_src_alpha: return 1.0f - source[3];
+            case BlendFactor::dest_alpha: return destination[3];
+            case BlendFactor::inv_dest_alpha: return 1.0f - destination[3];
+            case BlendFactor::dest_color: return destination[channel];
+            case BlendFactor::inv_dest_color: return 1.0f - destination[channel];
+            case BlendFactor::src_alpha_sat: return channel == 3 ? 1.0f : std::min(source[3], 1.0f - destination[3]);
+            case BlendFactor::blend_factor: return constant[channel];
+            case BlendFactor::inv_blend_factor: return 1.0f - constant[channel];
+        }
+        return 0.0f;
+    }
+
+    void blend_factor_lanes(const BlendFactor factor, const uint32_t channel, const float source[4][shader_lane_count],
+                            const float destination[4][shader_lane_count], const float constant[4], float result[shader_lane_count]) {
+        const auto fill = [&](const auto& function) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                result[lane] = function(lane);
+            }
+        };
+        switch (factor) {
+            case BlendFactor::zero: fill([](uint32_t) { return 0.0f; }); break;
+            case BlendFactor::one: fill([](uint32_t) { return 1.0f; }); break;
+            case BlendFactor::src_color: fill([&](uint32_t lane) { return source[channel][lane]; }); break;
+            case BlendFactor::inv_src_color: fill([&](uint32_t lane) { return 1.0f - source[channel][lane]; }); break;
+            case BlendFactor::src_alpha: fill([&](uint32_t lane) { return source[3][lane]; }); break;
+            case BlendFactor::inv_src_alpha: fill([&](uint32_t lane) { return 1.0f - source[3][lane]; }); break;
+            case BlendFactor::dest_alpha: fill([&](uint32_t lane) { return destination[3][lane]; }); break;
+            case BlendFactor::inv_dest_alpha: fill([&](uint32_t lane) { return 1.0f - destination[3][lane]; }); break;
+            case BlendFactor::dest_color: fill([&](uint32_t lane) { return destination[channel][lane]; }); break;
+            case BlendFactor::inv_dest_color: fill([&](uint32_t lane) { return 1.0f - destination[channel][lane]; }); break;
+            case BlendFactor::src_alpha_sat:
+                fill([&](uint32_t lane) { return channel == 3 ? 1.0f : std::min(source[3][lane], 1.0f - destination[3][lane]); });
+                break;
+            case BlendFactor::blend_factor: fill([&](uint32_t) { return constant[channel]; }); break;
+            case BlendFactor::inv_blend_factor: fill([&](uint32_t) { return 1.0f - constant[channel]; }); break;
+        }
+    }
+
+    float blend_op_value(const BlendOp op, const float source, const float source_factor, const float destination, const float destination_factor) {
+        switch (op) {
+            case BlendOp::add: return source * source_factor + destination * destination_factor;
+            case BlendOp::subtract: return source * source_factor - destination * destination_factor;
+            case BlendOp::rev_subtract: return destination * destination_factor - source * source_factor;
+            case BlendOp::min: return std::min(source, destination);
+            case BlendOp::max: return std::max(source, destination);
+        }
+        return 0.0f;
+    }
+
+    void blend_op_lanes(const BlendOp op, const float source[shader_lane_count], const float source_factor[shader_lane_count],
+                        const float destination[shader_lane_count], const float destination_factor[shader_lane_count], float result[shader_lane_count]) {
+        const auto fill = [&](const auto& function) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                result[lane] = function(source[lane], source_factor[lane], destination[lane], destination_factor[lane]);
+            }
+        };
+        switch (op) {
+            case BlendOp::add: fill([](float s, float fs, float d, float fd) { return s * fs + d * fd; }); break;
+            case BlendOp::subtract: fill([](float s, float fs, float d, float fd) { return s * fs - d * fd; }); break;
+            case BlendOp::rev_subtract: fill([](float s, float fs, float d, float fd) { return d * fd - s * fs; }); break;
+            case BlendOp::min: fill([](float s, float, float d, float) { return std::min(s, d); }); break;
+            case BlendOp::max: fill([](float s, float, float d, float) { return std::max(s, d); }); break;
+        }
+    }
+
+    template <typename T>
+    T logic_op_value(const LogicOp op, const T source, const T destination) {
+        switch (op) {
+            case LogicOp::clear: return 0;
+            case LogicOp::set: return static_cast<T>(~T(0));
+            case LogicOp::copy: return source;
+            case LogicOp::copy_inverted: return ~source;
+            case LogicOp::noop: return destination;
+            case LogicOp::invert: return ~destination;
+            case LogicOp::and_: return source & destination;
+            case LogicOp::nand: return ~(source & destination);
+            case LogicOp::or_: return source | destination;
+            case LogicOp::nor: return ~(source | destination);
+            case LogicOp::xor_: return source ^ destination;
+            case LogicOp::equiv: return ~(source ^ destination);
+            case LogicOp::and_reverse: return source & ~destination;
+            case LogicOp::and_inverted: return ~source & destination;
+            case LogicOp::or_reverse: return source | ~destination;
+            case LogicOp::or_inverted: return ~source | destination;
+        }
+        return destination;
+    }
+
+    // The switch is outside the loop, and every case becomes its own vectorized loop
+    template <typename T>
+    void logic_op_lanes(const LogicOp op, T source_result[shader_lane_count], const T destination[shader_lane_count]) {
+        const auto fill = [&](const auto& function) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                source_result[lane] = function(source_result[lane], destination[lane]);
+            }
+        };
+        switch (op) {
+            case LogicOp::clear: fill([](T, T) { return T(0); }); break;
+            case LogicOp::set: fill([](T, T) { return static_cast<T>(~T(0)); }); break;
+            case LogicOp::copy: break;
+            case LogicOp::copy_inverted: fill([](T s, T) { return static_cast<T>(~s); }); break;
+            case LogicOp::noop: fill([](T, T d) { return d; }); break;
+            case LogicOp::invert: fill([](T, T d) { return static_cast<T>(~d); }); break;
+            case LogicOp::and_: fill([](T s, T d) { return static_cast<T>(s & d); }); break;
+            case LogicOp::nand: fill([](T s, T d) { return static_cast<T>(~(s & d)); }); break;
+            case LogicOp::or_: fill([](T s, T d) { return static_cast<T>(s | d); }); break;
+            case LogicOp::nor: fill([](T s, T d) { return static_cast<T>(~(s | d)); }); break;
+            case LogicOp::xor_: fill([](T s, T d) { return static_cast<T>(s ^ d); }); break;
+            case LogicOp::equiv: fill([](T s, T d) { return static_cast<T>(~(s ^ d)); }); break;
+            case LogicOp::and_reverse: fill([](T s, T d) { return static_cast<T>(s & ~d); }); break;
+            case LogicOp::and_inverted: fill([](T s, T d) { return static_cast<T>(~s & d); }); break;
+            case LogicOp::or_reverse: fill([](T s, T d) { return static_cast<T>(s | ~d); }); break;
+            case LogicOp::or_inverted: fill([](T s, T d) { return static_cast<T>(~s | d); }); break;
+        }
+    }
+
+    enum class BlendKind : uint8_t {
+        opaque,             // Blending and logic ops off
+        logic_op,
+        alpha,              // src_alpha, inv_src_alpha for color, one, inv_src_alpha for alpha
+        premultiplied,      // one, inv_src_alpha
+        additive,           // one, one
+        general,
+    };
+
+    template <RenderTargetFormat format, BlendKind kind, bool full_write_mask>
+    void blend_row(const SoftwareBlendState& state, const float source[4][shader_lane_count], const float blend_factor[4], const uint32_t mask,
+                   void* destination) {
+        using Pixel = PixelType<format>;
+        Pixel* pixels = static_cast<Pixel*>(destination);
+        Pixel result[shader_lane_count];
+        if constexpr (kind == BlendKind::opaque) {
+            pack_lanes<format>(source, result);
+        }
+        else if constexpr (kind == BlendKind::logic_op) {
+            pack_lanes<format>(source, result);
+            logic_op_lanes<Pixel>(state.logic_op, result, pixels);
+        }
+        else {
+            constexpr bool clamp = is_unorm_format(format);
+            float clamped[4][shader_lane_count];
+            float current[4][shader_lane_count];
+            float blended[4][shader_lane_count];
+            for (uint32_t channel = 0; channel < 4; ++channel) {
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    clamped[channel][lane] = clamp ? saturate(source[channel][lane]) : source[channel][lane];
+                }
+            }
+            unpack_lanes<format>(pixels, current);
+
+            if constexpr (kind == BlendKind::alpha || kind == BlendKind::premultiplied || kind == BlendKind::additive) {
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    const float inverse_alpha = 1.0f - clamped[3][lane];
+                    for (uint32_t channel = 0; channel < 4; ++channel) {
+                        const float source_factor = kind == BlendKind::alpha && channel < 3 ? clamped[3][lane] : 1.0f;
+                        const float destination_factor = kind == BlendKind::additive ? 1.0f : inverse_alpha;
+                        blended[channel][lane] = clamped[channel][lane] * source_factor + current[channel][lane] * destination_factor;
+                    }
+                }
+            }
+            else {
+                float constant[4];
+                for (uint32_t channel = 0; channel < 4; ++channel) {
+                    constant[channel] = clamp ? saturate(blend_factor[channel]) : blend_factor[channel];
+                }
+                for (uint32_t channel = 0; channel < 4; ++channel) {
+                    float source_factors[shader_lane_count];
+                    float destination_factors[shader_lane_count];
+                    blend_factor_lanes(channel < 3 ? state.src_blend : state.src_blend_alpha, channel, clamped, current, constant, source_factors);
+                    blend_factor_lanes(channel < 3 ? state.dest_blend : state.dest_blend_alpha, channel, clamped, current, constant, destination_factors);
+                    blend_op_lanes(channel < 3 ? state.blend_op : state.blend_op_alpha, clamped[channel], source_factors, current[channel],
+                                   destination_factors, blended[channel]);
+                }
+            }
+            pack_lanes<format>(blended, result);
+        }
+
+        if constexpr (full_write_mask) {
+            // All 8 pixels get replaced, so they don't need to be read (unless blending did already)
+            if (mask == (1u << shader_lane_count) - 1) {
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    pixels[lane] = result[lane];
+                }
+                return;
+            }
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                pixels[lane] = (mask & (1u << lane)) ? result[lane] : pixels[lane];
+            }
+        }
+        else {
+            const Pixel written = static_cast<Pixel>(channel_bits(format, state.write_mask));
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                pixels[lane] = (mask & (1u << lane)) ? static_cast<Pixel>((result[lane] & written) | (pixels[lane] & ~written)) : pixels[lane];
+            }
+        }
+    }
+
+    // For a write mask without any of the format's channels
+    void skip_row(const SoftwareBlendState&, const float[4][shader_lane_count], const float[4], uint32_t, void*) {
+    }
+
+    template <RenderTargetFormat format, bool full_write_mask>
+    BlendFunction select_blend_kind(const SoftwareBlendState& state) {
+        if (state.logic_op_enable) {
+            return &blend_row<format, BlendKind::logic_op, full_write_mask>;
+        }
+        if (!state.blend_enable) {
+            return &blend_row<format, BlendKind::opaque, full_write_mask>;
+        }
+        const auto adds = [&](const BlendFactor src, const BlendFactor dest, const BlendFactor src_alpha, const BlendFactor dest_alpha) {
+            return state.blend_op == BlendOp::add && state.blend_op_alpha == BlendOp::add && state.src_blend == src && state.dest_blend == dest
+                && state.src_blend_alpha == src_alpha && state.dest_blend_alpha == dest_alpha;
+        };
+        if (adds(BlendFactor::src_alpha, BlendFactor::inv_src_alpha, BlendFactor::one, BlendFactor::inv_src_alpha)) {
+            return &blend_row<format, BlendKind::alpha, full_write_mask>;
+        }
+        if (adds(BlendFactor::one, BlendFactor::inv_src_alpha, BlendFactor::one, BlendFactor::inv_src_alpha)) {
+            return &blend_row<format, BlendKind::premultiplied, full_write_mask>;
+        }
+        if (adds(BlendFactor::one, BlendFactor::one, BlendFactor::one, BlendFactor::one)) {
+            return &blend_row<format, BlendKind::additive, full_write_mask>;
+        }
+        return &blend_row<format, BlendKind::general, full_write_mask>;
+    }
+
+    template <RenderTargetFormat format>
+    BlendFunction select_blend_mask(const SoftwareBlendState& state) {
+        const uint64_t written = channel_bits(format, state.write_mask);
+        if (written == 0) {
+            return &skip_row;
+        }
+        if (written == channel_bits(format, 0xf)) {
+            return select_blend_kind<format, true>(state);
+        }
+        return select_blend_kind<format, false>(state);
+    }
+
+    bool is_valid_blend_factor(const BlendFactor factor) {
+        const uint8_t value = static_cast<uint8_t>(factor);
+        return (value >= 1 && value <= 11) || value == 14 || value == 15;
+    }
+
+    bool is_valid_blend_op(const BlendOp op) {
+        return static_cast<uint8_t>(op) >= 1 && static_cast<uint8_t>(op) <= 5;
+    }
+}
+
+size_t render_target_format_pixel_size(const RenderTargetFormat format) {
+    return format == RenderTargetFormat::r16g16b16a16_float ? 8 : 4;
+}
+
+BlendFunction select_blend_function(const SoftwareBlendState& state, const RenderTargetFormat format) {
+    if (state.blend_enable && state.logic_op_enable) {
+        return nullptr;
+    }
+    if (state.blend_enable) {
+        if (!is_valid_blend_factor(state.src_blend) || !is_valid_blend_factor(state.dest_blend) || !is_valid_blend_factor(state.src_blend_alpha)
+            || !is_valid_blend_factor(state.dest_blend_alpha) || !is_valid_blend_op(state.blend_op) || !is_valid_blend_op(state.blend_op_alpha)) {
+            return nullptr;
+        }
+    }
+    if (state.logic_op_enable && static_cast<uint8_t>(state.logic_op) > static_cast<uint8_t>(LogicOp::or_inverted)) {
+        return nullptr;
+    }
+    switch (format) {
+        case RenderTargetFormat::r8g8b8a8_unorm: return select_blend_mask<RenderTargetFormat::r8g8b8a8_unorm>(state);
+        case RenderTargetFormat::r8g8b8a8_unorm_srgb: return select_blend_mask<RenderTargetFormat::r8g8b8a8_unorm_srgb>(state);
+        case RenderTargetFormat::r10g10b10a2_unorm: return select_blend_mask<RenderTargetFormat::r10g10b10a2_unorm>(state);
+        case RenderTargetFormat::r11g11b10_float: return select_blend_mask<RenderTargetFormat::r11g11b10_float>(state);
+        case RenderTargetFormat::r16g16b16a16_float: return select_blend_mask<RenderTargetFormat::r16g16b16a16_float>(state);
+    }
+    return nullptr;
+}
+
+bool blend_reads_destination(const SoftwareBlendState& state, const RenderTargetFormat format) {
+    return state.blend_enable || state.logic_op_enable || channel_bits(format, state.write_mask) != channel_bits(format, 0xf);
+}
+
+void pack_pixels(const RenderTargetFormat format, const float source[4][shader_lane_count], void* destination) {
+    switch (format) {
+        case RenderTargetFormat::r8g8b8a8_unorm:
+            pack_lanes<RenderTargetFormat::r8g8b8a8_unorm>(source, static_cast<uint32_t*>(destination));
+            break;
+        case RenderTargetFormat::r8g8b8a8_unorm_srgb:
+            pack_lanes<RenderTargetFormat::r8g8b8a8_unorm_srgb>(source, static_cast<uint32_t*>(destination));
+            break;
+        case RenderTargetFormat::r10g10b10a2_unorm:
+            pack_lanes<RenderTargetFormat::r10g10b10a2_unorm>(source, static_cast<uint32_t*>(destination));
+            break;
+        case RenderTargetFormat::r11g11b10_float:
+            pack_lanes<RenderTargetFormat::r11g11b10_float>(source, static_cast<uint32_t*>(destination));
+            break;
+        case RenderTargetFormat::r16g16b16a16_float:
+            pack_lanes<RenderTargetFormat::r16g16b16a16_float>(source, static_cast<uint64_t*>(destination));
+            break;
+    }
+}
+
+void unpack_pixels(const RenderTargetFormat format, const void* source, float destination[4][shader_lane_count]) {
+    switch (format) {
+        case RenderTargetFormat::r8g8b8a8_unorm:
+            unpack_lanes<RenderTargetFormat::r8g8b8a8_unorm>(static_cast<const uint32_t*>(source), destination);
+            break;
+        case RenderTargetFormat::r8g8b8a8_unorm_srgb:
+            unpack_lanes<RenderTargetFormat::r8g8b8a8_unorm_srgb>(static_cast<const uint32_t*>(source), destination);
+            break;
+        case RenderTargetFormat::r10g10b10a2_unorm:
+            unpack_lanes<RenderTargetFormat::r10g10b10a2_unorm>(static_cast<const uint32_t*>(source), destination);
+            break;
+        case RenderTargetFormat::r11g11b10_float:
+            unpack_lanes<RenderTargetFormat::r11g11b10_float>(static_cast<const uint32_t*>(source), destination);
+            break;
+        case RenderTargetFormat::r16g16b16a16_float:
+            unpack_lanes<RenderTargetFormat::r16g16b16a16_float>(static_cast<const uint64_t*>(source), destination);
+            break;
+    }
+}
+
+uint64_t pack_pixel(const RenderTargetFormat format, const float rgba[4]) {
+    switch (format) {
+        case RenderTargetFormat::r8g8b8a8_unorm:
+            return float_to_unorm(rgba[0], 255.0f) | (float_to_unorm(rgba[1], 255.0f) << 8) | (float_to_unorm(rgba[2], 255.0f) << 16)
+                | (static_cast<uint64_t>(float_to_unorm(rgba[3], 255.0f)) << 24);
+        case RenderTargetFormat::r8g8b8a8_unorm_srgb:
+            return linear_to_srgb8(rgba[0]) | (linear_to_srgb8(rgba[1]) << 8) | (linear_to_srgb8(rgba[2]) << 16)
+                | (static_cast<uint64_t>(float_to_unorm(rgba[3], 255.0f)) << 24);
+        case RenderTargetFormat::r10g10b10a2_unorm:
+            return float_to_unorm(rgba[0], 1023.0f) | (float_to_unorm(rgba[1], 1023.0f) << 10) | (float_to_unorm(rgba[2], 1023.0f) << 20)
+                | (static_cast<uint64_t>(float_to_unorm(rgba[3], 3.0f)) << 30);
+        case RenderTargetFormat::r11g11b10_float:
+            return float_to_small_float(rgba[0], 6) | (float_to_small_float(rgba[1], 6) << 11) | (static_cast<uint64_t>(float_to_small_float(rgba[2], 5)) << 22);
+        case RenderTargetFormat::r16g16b16a16_float:
+            return float_to_half(rgba[0]) | (static_cast<uint64_t>(float_to_half(rgba[1])) << 16) | (static_cast<uint64_t>(float_to_half(rgba[2])) << 32)
+                | (static_cast<uint64_t>(float_to_half(rgba[3])) << 48);
+    }
+    return 0;
+}
+
+void unpack_pixel(const RenderTargetFormat format, const uint64_t pixel, float rgba[4]) {
+    switch (format) {
+        case RenderTargetFormat::r8g8b8a8_unorm:
+        case RenderTargetFormat::r8g8b8a8_unorm_srgb:
+            for (uint32_t channel = 0; channel < 4; ++channel) {
+                const uint32_t value = (pixel >> (channel * 8)) & 0xff;
+                if (format == RenderTargetFormat::r8g8b8a8_unorm_srgb && channel < 3) {
+                    rgba[channel] = static_cast<float>(srgb_decode(value / 255.0));
+                }
+                else {
+                    rgba[channel] = static_cast<float>(value) / 255.0f;
+                }
+            }
+            break;
+        case RenderTargetFormat::r10g10b10a2_unorm:
+            for (uint32_t channel = 0; channel < 3; ++channel) {
+                rgba[channel] = static_cast<float>((pixel >> (channel * 10)) & 0x3ff) / 1023.0f;
+            }
+            rgba[3] = static_cast<float>((pixel >> 30) & 3) / 3.0f;
+            break;
+        case RenderTargetFormat::r11g11b10_float:
+            rgba[0] = small_float_to_float(pixel & 0x7ff, 6);
+            rgba[1] = small_float_to_float((pixel >> 11) & 0x7ff, 6);
+            rgba[2] = small_float_to_float((pixel >> 22) & 0x3ff, 5);
+            rgba[3] = 1.0f;
+            break;
+        case RenderTargetFormat::r16g16b16a16_float:
+            for (uint32_t channel = 0; channel < 4; ++channel) {
+                rgba[channel] = half_to_float((pixel >> (channel * 16)) & 0xffff);
+            }
+            break;
+    }
+}
+
+uint64_t blend_pixel(const SoftwareBlendState& state, const RenderTargetFormat format, const float source[4], const float blend_factor[4],
+                     const uint64_t destination) {
+    uint64_t result = 0;
+    if (state.logic_op_enable) {
+        result = logic_op_value<uint64_t>(state.logic_op, pack_pixel(format, source), destination);
+    }
+    else if (!state.blend_enable) {
+        result = pack_pixel(format, source);
+    }
+    else {
+        const bool clamp = is_unorm_format(format);
+        float clamped[4];
+        float current[4];
+        float constant[4];
+        float blended[4];
+        for (uint32_t channel = 0; channel < 4; ++channel) {
+            clamped[channel] = clamp ? saturate(source[channel]) : source[channel];
+            constant[channel] = clamp ? saturate(blend_factor[channel]) : blend_factor[channel];
+        }
+        unpack_pixel(format, destination, current);
+        for (uint32_t channel = 0; channel < 4; ++channel) {
+            const float source_factor = blend_factor_value(channel < 3 ? state.src_blend : state.src_blend_alpha, channel, clamped, current, constant);
+            const float destination_factor = blend_factor_value(channel < 3 ? state.dest_blend : state.dest_blend_alpha, channel, clamped, current, constant);
+            blended[channel] = blend_op_value(channel < 3 ? state.blend_op : state.blend_op_alpha, clamped[channel], source_factor, current[channel],
+                                              destination_factor);
+        }
+        result = pack_pixel(format, blended);
+    }
+    const uint64_t written = channel_bits(format, state.write_mask);
+    return (result & written) | (destination & ~written);
+}
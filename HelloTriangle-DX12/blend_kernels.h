@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "shader_interpreter.h"
+
+/* BLENDING
+* D3D12_RENDER_TARGET_BLEND_DESC has 13 blend factors for each of 4 inputs, 5 blend ops for color and alpha,
+* 16 logic ops and a write mask. Switching on all of that for every pixel would cost more than the blending itself.
+* So blending works on a block row (8 pixels) at a time, with the shader outputs in the same [channel][lane] layout
+* the shader interpreter uses, and the function that does it is picked once per pipeline state. It's a template
+* instance for the render target format and the kind of blending: opaque, logic op, the common blend states
+* (alpha, premultiplied alpha and additive), or the general case. The general case only switches on the blend
+* factors once per 8 pixels, and every case is a loop over the 8 lanes, which the compiler vectorizes.
+*
+* Like on the GPU, UNORM and sRGB formats clamp the shader output and the blend factor to [0, 1] before blending,
+* sRGB formats blend in linear space, and logic ops work on the packed bits. Pixels that are fully overwritten,
+* with every channel enabled in the write mask, are stored without reading the render target first.
+*/
+
+// Render target formats, named after the DXGI_FORMAT they match
+enum class RenderTargetFormat : uint8_t {
+    r8g8b8a8_unorm,
+    r8g8b8a8_unorm_srgb,
+    r10g10b10a2_unorm,
+    r11g11b10_float,       // No alpha, and no negative values
+    r16g16b16a16_float,    // 8 bytes per pixel
+};
+
+size_t render_target_format_pixel_size(RenderTargetFormat format);
+
+// Same values as D3D12_BLEND, without the dual source factors
+enum class BlendFactor : uint8_t {
+    zero = 1,
+    one = 2,
+    src_color = 3,
+    inv_src_color = 4,
+    src_alpha = 5,
+    inv_src_alpha = 6,
+    dest_alpha = 7,
+    inv_dest_alpha = 8,
+    dest_color = 9,
+    inv_dest_color = 10,
+    src_alpha_sat = 11,
+    blend_factor = 14,
+    inv_blend_factor = 15,
+};
+
+// Same values as D3D12_BLEND_OP
+enum class BlendOp : uint8_t {
+    add = 1,
+    subtract = 2,
+    rev_subtract = 3,
+    min = 4,
+    max = 5,
+};
+
+// Same values as D3D12_LOGIC_OP
+enum class LogicOp : uint8_t {
+    clear = 0,
+    set,
+    copy,
+    copy_inverted,
+    noop,
+    invert,
+    and_,
+    nand,
+    or_,
+    nor,
+    xor_,
+    equiv,
+    and_reverse,
+    and_inverted,
+    or_reverse,
+    or_inverted,
+};
+
+// Like D3D12_RENDER_TARGET_BLEND_DESC
+struct SoftwareBlendState {
+    bool blend_enable = false;
+    bool logic_op_enable = false;
+    BlendFactor src_blend = BlendFactor::one;
+    BlendFactor dest_blend = BlendFactor::zero;
+    BlendOp blend_op = BlendOp::add;
+    BlendFactor src_blend_alpha = BlendFactor::one;
+    BlendFactor dest_blend_alpha = BlendFactor::zero;
+    BlendOp blend_op_alpha = BlendOp::add;
+    LogicOp logic_op = LogicOp::noop;
+    uint8_t write_mask = 0xf;      // Like D3D12_COLOR_WRITE_ENABLE, bit 0 is red and bit 3 is alpha
+};
+
+// Blends 8 shader outputs, stored as [channel][lane], into 8 consecutive pixels of `format`. Only the lanes in `mask`
+// are written.
+using BlendFunction = void (*)(const SoftwareBlendState& state, const float source[4][shader_lane_count], const float blend_factor[4],
+                               uint32_t mask, void* destination);
+
+// Returns nullptr if the state isn't valid, like blending and a logic op at the same time
+BlendFunction select_blend_function(const SoftwareBlendState& state, RenderTargetFormat format);
+
+// True if the blend function doesn't just overwrite the pixels it writes to
+bool blend_reads_destination(const SoftwareBlendState& state, RenderTargetFormat format);
+
+// Building blocks, 8 pixels at a time, exposed so they can be verified against the scalar versions below
+void pack_pixels(RenderTargetFormat format, const float source[4][shader_lane_count], void* destination);
+void unpack_pixels(RenderTargetFormat format, const void* source, float destination[4][shader_lane_count]);
+
+// Straightforward scalar versions, one pixel at a time. The 8-pixel versions produce exactly the same bits.
+uint64_t pack_pixel(RenderTargetFormat format, const float rgba[4]);
+void unpack_pixel(RenderTargetFormat format, uint64_t pixel, float rgba[4]);
+uint64_t blend_pixel(const SoftwareBlendState& state, RenderTargetFormat format, const float source[4], const float blend_factor[4],
+                     uint64_t destination);
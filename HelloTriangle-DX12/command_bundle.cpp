@@ -0,0 +1,34 @@
+#include "command_bundle.h"
+#include <cstring>
+#include <utility>
+
+void BundleKey::add(const void* data, const size_t size) {
+    if (size == 0) {
+        return;
+    }
+    const size_t start = bytes.size();
+    bytes.resize(start + size);
+    memcpy(bytes.data() + start, data, size);
+}
+
+bool BundleKey::operator==(const BundleKey& other) const {
+    return bytes.size() == other.bytes.size() && (bytes.empty() || memcmp(bytes.data(), other.bytes.data(), bytes.size()) == 0);
+}
+
+BundleKey& CachedBundle::begin_key() {
+    frame_key.clear();
+    return frame_key;
+}
+
+bool CachedBundle::needs_recording() {
+    statistics.uses++;
+    if (recorded && frame_key == recorded_key) {
+        return false;
+    }
+
+    // Swapping keeps both buffers, so building the key doesn't allocate once it's as big as it gets
+    std::swap(recorded_key, frame_key);
+    recorded = true;
+    statistics.recordings++;
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* COMMAND BUNDLES
+* Some commands are recorded exactly the same way every frame, like the draws of a scene that doesn't change. Those
+* can be recorded once into a bundle, and every frame then only executes the bundle, which is one call instead of a
+* few per draw. A bundle is only right as long as everything it was recorded with stays the same, so a CachedBundle
+* keeps a key: the bytes of everything the bundle was recorded with. Every frame, the caller builds the key of what
+* it would record, and if that's different, the bundle has to be recorded again. Objects go into the key by their
+* address, so a pipeline that was hot reloaded or a buffer that was replaced makes the bundle stale by itself, and
+* nobody has to remember to invalidate it.
+*
+* A bundle inherits the root arguments of the command list that executes it, so whatever root arguments it doesn't
+* set itself don't go into the key.
+*
+* Like the UploadRing, it only compares bytes, so it doesn't know about D3D12. The bundle itself belongs to the
+* caller, since the old one may still be in use by the GPU when it's replaced.
+*/
+
+// What a bundle was recorded with
+class BundleKey {
+public:
+    void clear() { bytes.clear(); }
+    void add(const void* data, size_t size);
+    void add_pointer(const void* pointer) { add(&pointer, sizeof(pointer)); }
+    template <typename T>
+    void add_value(const T& value) { add(&value, sizeof(T)); }
+
+    size_t size() const { return bytes.size(); }
+    bool operator==(const BundleKey& other) const;
+    bool operator!=(const BundleKey& other) const { return !(*this == other); }
+
+private:
+    std::vector<uint8_t> bytes;
+};
+
+struct CachedBundleStats {
+    uint64_t uses = 0;                  // Frames that executed the bundle
+    uint64_t recordings = 0;            // How many of those had to record it first
+};
+
+class CachedBundle {
+public:
+    // Clears the key for this frame, then everything the bundle would be recorded with goes into it
+    BundleKey& begin_key();
+
+    // Whether the bundle has to be recorded, because this frame's key differs from the one it was recorded with, or
+    // it was never recorded. If so, the caller records it right away, and this frame's key becomes the bundle's.
+    bool needs_recording();
+
+    // The next needs_recording() returns true, whatever the key
+    void invalidate() { recorded = false; }
+
+    const CachedBundleStats& stats() const { return statistics; }
+
+private:
+    BundleKey recorded_key;
+    BundleKey frame_key;
+    bool recorded = false;
+    CachedBundleStats statistics;
+};
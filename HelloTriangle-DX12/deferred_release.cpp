@@ -0,0 +1,65 @@
+#include "deferred_release.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+DeferredReleaseQueue::~DeferredReleaseQueue() {
+    report_leaks();
+}
+
+void DeferredReleaseQueue::enqueue(const uint64_t fence_value, void* object, const ReleaseFunction release, const char* name) {
+    if (!object || !release) {
+        return;
+    }
+    last_fence_value = std::max(last_fence_value, fence_value);
+    entries.push_back({ last_fence_value, object, release, name });
+    statistics.enqueued++;
+    statistics.peak_pending = std::max(statistics.peak_pending, pending());
+}
+
+void DeferredReleaseQueue::enqueue_free(const uint64_t fence_value, void* memory, const char* name) {
+    enqueue(fence_value, memory, [](void* pointer) { free(pointer); }, name);
+}
+
+size_t DeferredReleaseQueue::retire(const uint64_t completed_fence_value, const size_t budget) {
+    size_t released = 0;
+    while (head < entries.size() && entries[head].fence_value <= completed_fence_value) {
+        if (released == budget) {
+            statistics.budget_limited++;
+            break;
+        }
+        entries[head].release(entries[head].object);
+        entries[head] = {};
+        head++;
+        released++;
+    }
+    statistics.released += released;
+
+    // Move the pending entries back to the start once the released ones take up most of the vector, so it doesn't
+    // keep growing. That way every entry is moved at most once on average.
+    if (head == entries.size()) {
+        entries.clear();
+        head = 0;
+    }
+    else if (head > entries.size() / 2) {
+        entries.erase(entries.begin(), entries.begin() + static_cast<ptrdiff_t>(head));
+        head = 0;
+    }
+    return released;
+}
+
+size_t DeferredReleaseQueue::flush() {
+    return retire(UINT64_MAX);
+}
+
+size_t DeferredReleaseQueue::report_leaks() const {
+    const size_t leaked = pending();
+    if (leaked == 0) {
+        return 0;
+    }
+    printf("[ERROR] Deferred release queue still has %zu objects that were never released:\n", leaked);
+    for (size_t i = head; i < entries.size(); ++i) {
+        printf("[ERROR]     %s (fence value %llu)\n", entries[i].name ? entries[i].name : "unnamed", static_cast<unsigned long long>(entries[i].fence_value));
+    }
+    return leaked;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* DEFERRED RELEASE
+* The GPU runs behind the CPU, so an object the CPU is done with can still be used by frames that are in flight.
+* Releasing it right away would mean waiting for the GPU to go idle first. Instead it goes into this queue, tagged
+* with the fence value the GPU will signal once the current frame is done, and it gets released once the fence
+* has passed that value.
+*
+* Entries are kept in fence order, so retiring them is just popping from the front until we reach an entry whose
+* fence value hasn't been reached yet. A budget limits how many objects get released per call, so unloading a lot
+* at once is spread out over a few frames instead of causing one long frame. Whatever is still in the queue when
+* it's destroyed was never released, and gets reported as a leak.
+*
+* The queue doesn't know about D3D12, it only compares fence values, so it can be tested without a GPU. It's not
+* thread safe, it belongs to the thread that signals the fence.
+*/
+
+struct DeferredReleaseStats {
+    uint64_t enqueued = 0;
+    uint64_t released = 0;
+    uint64_t budget_limited = 0;    // Times retire() stopped because of the budget while more objects were ready
+    size_t peak_pending = 0;
+};
+
+class DeferredReleaseQueue {
+public:
+    using ReleaseFunction = void (*)(void* object);
+
+    DeferredReleaseQueue() = default;
+    DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+    DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+    ~DeferredReleaseQueue();
+
+    // Releases the object once the fence has reached fence_value. The fence values have to be given in increasing
+    // order, a smaller one than before is treated like the previous one, which only makes the release later.
+    // The name is used for the leak report and has to stay valid, e.g. a string literal.
+    void enqueue(uint64_t fence_value, void* object, ReleaseFunction release, const char* name = nullptr);
+
+    // For COM objects, calls Release() on them
+    template <typename T>
+    void enqueue_release(const uint64_t fence_value, T* object, const char* name = nullptr) {
+        enqueue(fence_value, object, [](void* pointer) { static_cast<T*>(pointer)->Release(); }, name);
+    }
+
+    // For malloc'd memory, like the buffers from read_file()
+    void enqueue_free(uint64_t fence_value, void* memory, const char* name = nullptr);
+
+    // Releases up to `budget` objects whose fence value has been reached, oldest first. Returns how many.
+    size_t retire(uint64_t completed_fence_value, size_t budget = SIZE_MAX);
+
+    // Releases everything, no matter the fence. Only call this once the GPU is idle.
+    size_t flush();
+
+    // Prints the objects that are still pending, and returns how many there are
+    size_t report_leaks() const;
+
+    size_t pending() const { return entries.size() - head; }
+    const DeferredReleaseStats& stats() const { return statistics; }
+
+private:
+    struct Entry {
+        uint64_t fence_value = 0;
+        void* object = nullptr;
+        ReleaseFunction release = nullptr;
+        const char* name = nullptr;
+    };
+
+    std::vector<Entry> entries;     // In fence order, the ones before `head` were released already
+    size_t head = 0;
+    uint64_t last_fence_value = 0;
+    DeferredReleaseStats statistics;
+};
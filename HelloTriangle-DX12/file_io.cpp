@@ -0,0 +1,150 @@
+#include "file_io.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void read_file(const std::string& path, size_t& size_bytes, char*& data, const bool silent)
+{
+    //Open file
+    std::ifstream file_stream(path, std::ios::binary);
+
+    //Is it actually open?
+    if (file_stream.is_open() == false)
+    {
+        if (!silent)
+            printf("[ERROR] Failed to open file '%s'!\n", path.c_str());
+        size_bytes = 0;
+        data = nullptr;
+        return;
+    }
+
+    //See how big the file is so we can allocate the right amount of memory
+    const auto begin = file_stream.tellg();
+    file_stream.seekg(0, std::ifstream::end);
+    const auto end = file_stream.tellg();
+    const auto size = end - begin;
+    size_bytes = static_cast<size_t>(size);
+
+    //Allocate memory
+    data = static_cast<char*>(malloc(static_cast<uint32_t>(size)));
+
+    //Load file data into that memory
+    file_stream.seekg(0, std::ifstream::beg);
+    const std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(file_stream), {});
+
+    //Is it actually open?
+    if (buffer.empty())
+    {
+        if (!silent)
+            printf("[ERROR] Failed to open file '%s'!\n", path.c_str());
+        free(data);
+        size_bytes = 0;
+        data = nullptr;
+        return;
+    }
+    memcpy(data, buffer.data(), size_bytes);
+}
+
+bool write_file(const std::string& path, const void* data, const size_t size_bytes, const bool silent)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        if (!silent)
+            printf("[ERROR] Failed to open file '%s' for writing!\n", path.c_str());
+        return false;
+    }
+    const bool written = fwrite(data, 1, size_bytes, file) == size_bytes;
+    const bool closed = fclose(file) == 0;
+    if (!(written && closed))
+    {
+        if (!silent)
+            printf("[ERROR] Failed to write file '%s'!\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::open(const std::string& path, const bool silent)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER file_size{};
+    if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        file_handle = file;
+        mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle)
+        {
+            mapped = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+            mapped_size = static_cast<size_t>(file_size.QuadPart);
+        }
+    }
+    else if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+    }
+#else
+    file_descriptor = ::open(path.c_str(), O_RDONLY);
+    struct stat file_stat{};
+    if (file_descriptor >= 0 && fstat(file_descriptor, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (view != MAP_FAILED)
+        {
+            mapped = static_cast<const uint8_t*>(view);
+            mapped_size = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+#endif
+    if (!mapped)
+    {
+        if (!silent)
+            printf("[ERROR] Failed to map file '%s'!\n", path.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mapped)
+        UnmapViewOfFile(mapped);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+    file_handle = nullptr;
+    mapping_handle = nullptr;
+#else
+    if (mapped)
+        munmap(const_cast<uint8_t*>(mapped), mapped_size);
+    if (file_descriptor >= 0)
+        ::close(file_descriptor);
+    file_descriptor = -1;
+#endif
+    mapped = nullptr;
+    mapped_size = 0;
+}
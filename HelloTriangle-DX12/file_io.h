@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Reads a whole file into a malloc'd buffer. On failure, size_bytes is 0 and data is nullptr.
+// The caller owns the buffer and has to free() it.
+void read_file(const std::string& path, size_t& size_bytes, char*& data, bool silent);
+
+// Writes a whole file, replacing it if it exists. Returns false on failure.
+bool write_file(const std::string& path, const void* data, size_t size_bytes, bool silent);
+
+/* MAPPED FILES
+* Maps a whole file into memory, read-only. Nothing is read until it's touched, then the OS reads the pages
+* straight into memory that's shared with its file cache, so there's no extra copy like with read_file().
+*/
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // Returns false on failure, an empty file fails too
+    bool open(const std::string& path, bool silent);
+    void close();
+
+    const uint8_t* data() const { return mapped; }
+    size_t size() const { return mapped_size; }
+
+private:
+    const uint8_t* mapped = nullptr;
+    size_t mapped_size = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+};
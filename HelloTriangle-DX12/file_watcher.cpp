@@ -0,0 +1,176 @@
+#include "file_watcher.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+namespace {
+    constexpr DWORD watched_changes = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+
+    // Queues the next read, which completes on its own once changes come in
+    bool read_changes(void* directory_handle, std::vector<uint32_t>& buffer, void* overlapped) {
+        return ReadDirectoryChangesW(directory_handle, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(uint32_t)), FALSE,
+                                     watched_changes, nullptr, static_cast<OVERLAPPED*>(overlapped), nullptr) != FALSE;
+    }
+}
+
+bool FileWatcher::open(const std::string& directory) {
+    close();
+    const int wide_length = MultiByteToWideChar(CP_UTF8, 0, directory.c_str(), -1, nullptr, 0);
+    std::wstring wide_directory(wide_length > 0 ? wide_length : 1, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, directory.c_str(), -1, &wide_directory[0], wide_length);
+
+    // Directories can only be opened with FILE_FLAG_BACKUP_SEMANTICS
+    const HANDLE handle = CreateFileW(wide_directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                      nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        printf("[ERROR] Failed to watch directory '%s'\n", directory.c_str());
+        return false;
+    }
+    directory_handle = handle;
+    OVERLAPPED* overlapped_read = new OVERLAPPED{};
+    overlapped_read->hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    overlapped = overlapped_read;
+    buffer.assign(16384, 0);
+    if (overlapped_read->hEvent == nullptr || !read_changes(directory_handle, buffer, overlapped)) {
+        printf("[ERROR] Failed to watch directory '%s'\n", directory.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FileWatcher::close() {
+    if (directory_handle) {
+        // Cancel the read that's still queued, and wait for it, since it writes into the buffer
+        OVERLAPPED* overlapped_read = static_cast<OVERLAPPED*>(overlapped);
+        if (overlapped_read) {
+            DWORD bytes = 0;
+            CancelIoEx(directory_handle, overlapped_read);
+            GetOverlappedResult(directory_handle, overlapped_read, &bytes, TRUE);
+        }
+        CloseHandle(directory_handle);
+        directory_handle = nullptr;
+    }
+    if (overlapped) {
+        OVERLAPPED* overlapped_read = static_cast<OVERLAPPED*>(overlapped);
+        if (overlapped_read->hEvent) {
+            CloseHandle(overlapped_read->hEvent);
+        }
+        delete overlapped_read;
+        overlapped = nullptr;
+    }
+    buffer.clear();
+}
+
+bool FileWatcher::is_open() const {
+    return directory_handle != nullptr;
+}
+
+bool FileWatcher::wait(std::vector<std::string>& changed, const uint32_t timeout_ms) {
+    if (!directory_handle) {
+        return false;
+    }
+    OVERLAPPED* overlapped_read = static_cast<OVERLAPPED*>(overlapped);
+    const DWORD wait_result = WaitForSingleObject(overlapped_read->hEvent, timeout_ms);
+    if (wait_result == WAIT_TIMEOUT) {
+        return true;
+    }
+    DWORD bytes = 0;
+    if (wait_result != WAIT_OBJECT_0 || !GetOverlappedResult(directory_handle, overlapped_read, &bytes, FALSE)) {
+        return false;
+    }
+    ResetEvent(overlapped_read->hEvent);
+
+    // 0 bytes means the buffer overflowed and the changes were lost. Nothing we can do but wait for the next ones.
+    const uint8_t* entry_data = reinterpret_cast<const uint8_t*>(buffer.data());
+    for (DWORD offset = 0; bytes > 0;) {
+        const FILE_NOTIFY_INFORMATION* entry = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry_data + offset);
+        if (entry->Action != FILE_ACTION_REMOVED && entry->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+            const int name_length = static_cast<int>(entry->FileNameLength / sizeof(WCHAR));
+            const int utf8_length = WideCharToMultiByte(CP_UTF8, 0, entry->FileName, name_length, nullptr, 0, nullptr, nullptr);
+            std::string name(utf8_length, '\0');
+            WideCharToMultiByte(CP_UTF8, 0, entry->FileName, name_length, &name[0], utf8_length, nullptr, nullptr);
+            changed.push_back(std::move(name));
+        }
+        if (entry->NextEntryOffset == 0) {
+            break;
+        }
+        offset += entry->NextEntryOffset;
+    }
+    return read_changes(directory_handle, buffer, overlapped);
+}
+#else
+bool FileWatcher::open(const std::string& directory) {
+    close();
+    inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_descriptor < 0) {
+        printf("[ERROR] Failed to watch directory '%s'\n", directory.c_str());
+        return false;
+    }
+
+    // IN_CLOSE_WRITE instead of IN_MODIFY, so a file that's being written is only reported once it's complete
+    if (inotify_add_watch(inotify_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        printf("[ERROR] Failed to watch directory '%s'\n", directory.c_str());
+        close();
+        return false;
+    }
+    buffer.assign(16384, 0);
+    return true;
+}
+
+void FileWatcher::close() {
+    if (inotify_descriptor >= 0) {
+        ::close(inotify_descriptor);
+        inotify_descriptor = -1;
+    }
+    buffer.clear();
+}
+
+bool FileWatcher::is_open() const {
+    return inotify_descriptor >= 0;
+}
+
+bool FileWatcher::wait(std::vector<std::string>& changed, const uint32_t timeout_ms) {
+    if (inotify_descriptor < 0) {
+        return false;
+    }
+    pollfd descriptor{ inotify_descriptor, POLLIN, 0 };
+    const int ready = poll(&descriptor, 1, static_cast<int>(timeout_ms));
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+    if (ready == 0) {
+        return true;
+    }
+
+    // Read everything that's queued, the descriptor is non-blocking, so this stops once it's empty
+    for (;;) {
+        const ssize_t bytes = read(inotify_descriptor, buffer.data(), buffer.size());
+        if (bytes <= 0) {
+            return bytes == 0 || errno == EAGAIN || errno == EINTR;
+        }
+        for (ssize_t offset = 0; offset < bytes;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                changed.emplace_back(event->name);
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+}
+#endif
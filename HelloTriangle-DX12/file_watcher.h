@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* FILE WATCHER
+* Reports which files in a directory were written, created or renamed into it, without polling the files: the OS
+* queues the changes (ReadDirectoryChangesW on Windows, inotify on Linux), and wait() sleeps until there are some.
+* It only watches the directory itself, not the ones in it.
+* Editors often save in several steps (truncate, write, rename a temporary file), so one save can be reported as
+* several changes to the same file. The caller decides when a file has settled, see ShaderReloader.
+*/
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    ~FileWatcher() { close(); }
+
+    // Returns false if the directory can't be watched
+    bool open(const std::string& directory);
+    void close();
+    bool is_open() const;
+
+    // Waits up to `timeout_ms` for changes, and appends the names of the files that changed, relative to the
+    // directory, to `changed`. A file can be in there more than once. Returns false if watching failed.
+    bool wait(std::vector<std::string>& changed, uint32_t timeout_ms);
+
+private:
+#ifdef _WIN32
+    void* directory_handle = nullptr;
+    void* overlapped = nullptr;         // An OVERLAPPED, with the event that's signaled when changes come in
+    std::vector<uint32_t> buffer;       // FILE_NOTIFY_INFORMATION entries, which have to be DWORD aligned
+#else
+    int inotify_descriptor = -1;
+    std::vector<uint8_t> buffer;
+#endif
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/* FRAME MAILBOX
+* Hands the newest version of something (a frame packet, an input sample) from one producer thread to one
+* consumer thread, without locks and without either side ever waiting for the other.
+*
+* It's a triple buffer: the producer owns one slot to write into, the consumer owns one slot to read from, and
+* the third slot holds the newest published value. Publishing swaps the producer's slot with the middle one,
+* acquiring swaps the consumer's slot with the middle one if something new was published since the last time.
+* Both swaps are a single atomic exchange on the middle slot's index. If the producer is faster than the
+* consumer, the older values are simply overwritten, so the consumer always gets the newest one and never
+* falls behind. If the consumer is faster, it keeps the value it already has.
+*
+* Slots are reused, so a value with vectors in it keeps their capacity, and filling it again doesn't allocate
+* once the vectors have grown large enough.
+*/
+template <typename T>
+class FrameMailbox {
+public:
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "The mailbox needs a lock-free atomic");
+
+    // Producer: the slot to write the next value into. It's not visible to the consumer until publish().
+    T& back() { return slots[back_index]; }
+
+    // Producer: makes back() the newest value, and hands the producer a new slot to write into. The new slot
+    // still contains an older value, so the producer has to overwrite all of it.
+    void publish() {
+        back_index = latest.exchange(back_index | fresh_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    // Consumer: takes the newest value if there is one that it hasn't taken yet. Returns false and keeps the
+    // current front() otherwise.
+    bool acquire() {
+        if ((latest.load(std::memory_order_relaxed) & fresh_bit) == 0) {
+            return false;
+        }
+        front_index = latest.exchange(front_index, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    // Consumer: the value that was taken by the last acquire(). Before the first acquire() that returned true,
+    // it's a default-constructed T.
+    const T& front() const { return slots[front_index]; }
+
+private:
+    static constexpr uint32_t index_mask = 0x3;
+    static constexpr uint32_t fresh_bit = 0x4;   // Set when the middle slot was published and not yet acquired
+
+    T slots[3];
+
+    // Each side's index on its own cache line, so the threads don't keep taking the line from each other
+    alignas(64) std::atomic<uint32_t> latest{ 1 };
+    alignas(64) uint32_t back_index = 0;
+    alignas(64) uint32_t front_index = 2;
+};
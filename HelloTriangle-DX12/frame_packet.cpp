@@ -0,0 +1,100 @@
+#include "frame_packet.h"
+#include <cmath>
+#include "glm/ext/matrix_transform.hpp"
+
+namespace {
+    // A number in [0, 1) that's always the same for the same light (or emitter) and n
+    float light_random(const uint32_t light, const uint32_t n) {
+        uint32_t x = (light * 8 + n + 1) * 0x9E3779B9u;
+        x ^= x >> 16;
+        x *= 0x85EBCA6Bu;
+        x ^= x >> 13;
+        x *= 0xC2B2AE35u;
+        x ^= x >> 16;
+        return static_cast<float>(x >> 8) / 16777216.0f;
+    }
+}
+
+void simulate_frame(SimulationState& state, const InputState& input, FramePacket& packet) {
+    state.step++;
+    if (!input.pause_held) {
+        state.time += simulation_step;
+    }
+
+    packet.sequence = state.step;
+    packet.simulation_time = state.time;
+    packet.input_sequence = input.sequence;
+    packet.input_time = input.sample_time;
+
+    // Cycle the triangle's colors
+    const float time = static_cast<float>(state.time);
+    packet.color_mul.r = sinf(time + 0.0f * 3.141593f) + 1.f;
+    packet.color_mul.g = sinf(time + 0.5f * 3.141593f) + 1.f;
+    packet.color_mul.b = sinf(time + 1.0f * 3.141593f) + 1.f;
+
+    // Spin the turntable, then write out what changed. The packet still has the contents of an older frame, resizing
+    // keeps the capacity.
+    set_local_transform(state.scene, state.turntable, glm::vec3(0.0f), glm::angleAxis(0.5f * time, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f));
+    update_transforms(state.scene);
+    const size_t draw_count = count_draws(state.scene);
+    packet.transforms.resize(draw_count);
+    packet.draws.resize(draw_count);
+    pack_draws(state.scene, packet.transforms.data(), packet.draws.data());
+
+    // Every light circles the origin on its own tilted orbit, with its own speed, size and color
+    packet.view = glm::lookAt(state.camera_position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    packet.lights.resize(state.light_count);
+    for (uint32_t i = 0; i < state.light_count; ++i) {
+        const float orbit_radius = 0.2f + 0.8f * light_random(i, 0);
+        const float angle = time * (0.2f + light_random(i, 1)) * (light_random(i, 2) < 0.5f ? -1.0f : 1.0f) + 6.283185f * light_random(i, 3);
+        const float tilt = 3.141593f * (light_random(i, 4) - 0.5f);
+        const glm::vec3 position(cosf(angle) * orbit_radius, sinf(angle) * sinf(tilt) * orbit_radius, sinf(angle) * cosf(tilt) * orbit_radius);
+        const float hue = 6.283185f * light_random(i, 5);
+        ClusterLight& light = packet.lights[i];
+        light.position = glm::vec3(packet.view * glm::vec4(position, 1.0f));
+        light.radius = 0.1f + 0.2f * light_random(i, 6);
+        light.color = 0.5f * glm::vec3(cosf(hue) + 1.0f, cosf(hue - 2.094395f) + 1.0f, cosf(hue + 2.094395f) + 1.0f);
+        light.padding = 0.0f;
+    }
+
+    // Particles are stepped with the simulation, and sorted for the camera of this step
+    if (!state.particle_emitters.empty()) {
+        if (!input.pause_held) {
+            step_particles(state.particles, state.particle_emitters.data(), particle_gravity, static_cast<float>(simulation_step));
+        }
+        sort_particles_by_depth(state.particles, packet.view, state.particle_order);
+        packet.particles.resize(state.particles.count);
+        write_particle_instances(state.particles, state.particle_order.data(), state.particles.count, packet.particles.data());
+    }
+    else {
+        packet.particles.clear();
+    }
+
+    // Last, so the latency measurement includes the simulation step
+    packet.publish_time = FrameClock::now();
+}
+
+std::vector<ParticleEmitter> make_particle_emitters(const uint32_t count) {
+    std::vector<ParticleEmitter> emitters(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const float radius = 0.8f * sqrtf(light_random(i, 0));
+        const float angle = 6.283185f * light_random(i, 1);
+        const float hue = 6.283185f * light_random(i, 2);
+        const glm::vec3 color = 0.5f * glm::vec3(cosf(hue) + 1.0f, cosf(hue - 2.094395f) + 1.0f, cosf(hue + 2.094395f) + 1.0f);
+
+        // RGBA8 with half alpha, premultiplied
+        constexpr float alpha = 0.5f;
+        const auto channel = [](const float value) { return static_cast<uint32_t>(value * 255.0f + 0.5f); };
+
+        ParticleEmitter& emitter = emitters[i];
+        emitter.position = glm::vec3(cosf(angle) * radius, -0.6f, sinf(angle) * radius);
+        emitter.rate = 2.0f + 4.0f * light_random(i, 3);
+        emitter.velocity = glm::vec3(0.0f, 1.0f + 0.6f * light_random(i, 4), 0.0f);
+        emitter.velocity_spread = 0.15f;
+        emitter.lifetime = 1.0f + light_random(i, 5);
+        emitter.size = 0.008f;
+        emitter.color = channel(color.r * alpha) | channel(color.g * alpha) << 8 | channel(color.b * alpha) << 16 | channel(alpha) << 24;
+        emitter.seed = i * 0x9E3779B9u;
+    }
+    return emitters;
+}
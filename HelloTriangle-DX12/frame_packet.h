@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include "light_clusters.h"
+#include "particles.h"
+#include "scene.h"
+
+/* FRAME PACKETS
+* The app runs on three threads:
+* - The main thread samples input, on its own cadence, and publishes it to the simulation thread. GLFW
+*   wants its events to be polled on the main thread, so that's where this has to happen.
+* - The simulation thread advances the world in fixed steps, using the newest input, and writes everything the
+*   renderer needs for a frame into a frame packet: the shader constants, the transforms, the draw list, the lights
+*   and the particle billboards.
+* - The render thread takes the newest frame packet, records the command list from it, and presents.
+*
+* Both handoffs go through a FrameMailbox, so no thread ever waits for another, except the render thread for the
+* very first packet. Once published, a packet is never changed, so the render thread can read it while the
+* simulation thread is already writing the next one.
+* If rendering is slower than the simulation, the render thread skips to the newest packet. If it's faster,
+* it renders the same packet again.
+*/
+
+// Timestamps for the latency measurements
+using FrameClock = std::chrono::steady_clock;
+
+struct InputState {
+    uint64_t sequence = 0;              // Increases with every sample, 0 means no input was sampled yet
+    FrameClock::time_point sample_time{};
+    double cursor_x = 0.0;
+    double cursor_y = 0.0;
+    bool pause_held = false;            // Space bar, stops the animation while it's held
+};
+
+struct FramePacket {
+    uint64_t sequence = 0;              // The simulation step that produced it, 0 means nothing was simulated yet
+    double simulation_time = 0.0;       // In seconds
+    FrameClock::time_point publish_time{};
+    uint64_t input_sequence = 0;        // The input sample the simulation step used
+    FrameClock::time_point input_time{};
+
+    // Shader constants
+    glm::mat4 view{ 1.0f };
+    glm::vec3 color_mul{ 1.0f, 1.0f, 1.0f };
+
+    std::vector<glm::mat4> transforms;  // World transforms, from pack_draws()
+    std::vector<DrawItem> draws;
+    std::vector<ClusterLight> lights;   // In view space
+    std::vector<ParticleInstance> particles;    // Back to front, empty when the GPU simulates the particles
+};
+
+// Fixed simulation step, independent of the frame rate
+constexpr double simulation_step = 1.0 / 120.0;
+
+struct SimulationState {
+    uint64_t step = 0;
+    double time = 0.0;                  // Animation time, doesn't advance while paused
+    Scene scene;                        // Every entity with a draw component is drawn every frame
+    SceneEntity turntable;              // Spins, with everything that's attached to it
+    glm::vec3 camera_position{ 0.0f, 0.0f, 1.5f };   // Looks at the origin
+    uint32_t light_count = 0;           // Point lights that circle around the origin
+
+    // Simulated here, unless the GPU does it, then the render thread plans the spawns and this stays empty
+    std::vector<ParticleEmitter> particle_emitters;
+    ParticleSystem particles;
+    std::vector<uint32_t> particle_order;
+};
+
+inline const glm::vec3 particle_gravity{ 0.0f, -2.0f, 0.0f };
+
+// Fountains on a disk under the origin, each with its own rate, speed and color
+std::vector<ParticleEmitter> make_particle_emitters(uint32_t count);
+
+// Advances the simulation by one step and writes the result into `packet`, overwriting everything in it
+void simulate_frame(SimulationState& state, const InputState& input, FramePacket& packet);
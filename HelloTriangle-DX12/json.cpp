@@ -0,0 +1,294 @@
+#include "json.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    // Deeper documents are rejected instead of overflowing the stack
+    constexpr int max_depth = 256;
+
+    struct JsonParser {
+        const char* begin;
+        const char* cursor;
+        const char* end;
+        const char* error = nullptr;
+
+        bool fail(const char* message) {
+            if (!error) {
+                error = message;
+            }
+            return false;
+        }
+
+        void skip_whitespace() {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+                ++cursor;
+            }
+        }
+
+        bool consume(const char* literal) {
+            const size_t length = strlen(literal);
+            if (static_cast<size_t>(end - cursor) < length || memcmp(cursor, literal, length) != 0) {
+                return false;
+            }
+            cursor += length;
+            return true;
+        }
+
+        bool parse_hex4(uint32_t& code) {
+            if (end - cursor < 4) {
+                return fail("Unfinished \\u escape");
+            }
+            code = 0;
+            for (int i = 0; i < 4; ++i) {
+                const char c = *cursor++;
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= c - '0';
+                else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+                else return fail("Invalid \\u escape");
+            }
+            return true;
+        }
+
+        static void append_utf8(std::string& string, const uint32_t code) {
+            if (code < 0x80) {
+                string += static_cast<char>(code);
+            }
+            else if (code < 0x800) {
+                string += static_cast<char>(0xC0 | (code >> 6));
+                string += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000) {
+                string += static_cast<char>(0xE0 | (code >> 12));
+                string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                string += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else {
+                string += static_cast<char>(0xF0 | (code >> 18));
+                string += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                string += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        bool parse_string(std::string& string) {
+            ++cursor; // Opening quote
+            string.clear();
+            while (cursor < end) {
+                // Copy everything up to the next quote or escape in one go
+                const char* run = cursor;
+                while (cursor < end && *cursor != '"' && *cursor != '\\') {
+                    if (static_cast<unsigned char>(*cursor) < 0x20) {
+                        return fail("Control character in string");
+                    }
+                    ++cursor;
+                }
+                string.append(run, cursor);
+                if (cursor == end) {
+                    break;
+                }
+                if (*cursor++ == '"') {
+                    return true;
+                }
+                if (cursor == end) {
+                    break;
+                }
+                switch (*cursor++) {
+                    case '"': string += '"'; break;
+                    case '\\': string += '\\'; break;
+                    case '/': string += '/'; break;
+                    case 'b': string += '\b'; break;
+                    case 'f': string += '\f'; break;
+                    case 'n': string += '\n'; break;
+                    case 'r': string += '\r'; break;
+                    case 't': string += '\t'; break;
+                    case 'u': {
+                        uint32_t code;
+                        if (!parse_hex4(code)) {
+                            return false;
+                        }
+                        // Characters outside the BMP are escaped as a surrogate pair
+                        if (code >= 0xD800 && code < 0xDC00) {
+                            uint32_t low;
+                            if (!consume("\\u") || !parse_hex4(low) || low < 0xDC00 || low >= 0xE000) {
+                                return fail("Unpaired surrogate in \\u escape");
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        else if (code >= 0xDC00 && code < 0xE000) {
+                            return fail("Unpaired surrogate in \\u escape");
+                        }
+                        append_utf8(string, code);
+                        break;
+                    }
+                    default:
+                        return fail("Invalid escape in string");
+                }
+            }
+            return fail("Unfinished string");
+        }
+
+        bool parse_number(double& number) {
+            // Check the JSON grammar first, strtod accepts more than JSON does
+            const char* start = cursor;
+            if (cursor < end && *cursor == '-') ++cursor;
+            if (cursor == end || *cursor < '0' || *cursor > '9') return fail("Invalid number");
+            if (*cursor == '0') ++cursor;
+            else while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+            if (cursor < end && *cursor == '.') {
+                ++cursor;
+                if (cursor == end || *cursor < '0' || *cursor > '9') return fail("Invalid number");
+                while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+            }
+            if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+                ++cursor;
+                if (cursor < end && (*cursor == '+' || *cursor == '-')) ++cursor;
+                if (cursor == end || *cursor < '0' || *cursor > '9') return fail("Invalid number");
+                while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+            }
+
+            // The text isn't null terminated, so strtod gets a copy
+            char buffer[64];
+            const size_t length = static_cast<size_t>(cursor - start);
+            if (length < sizeof(buffer)) {
+                memcpy(buffer, start, length);
+                buffer[length] = '\0';
+                number = strtod(buffer, nullptr);
+            }
+            else {
+                number = strtod(std::string(start, cursor).c_str(), nullptr);
+            }
+            return true;
+        }
+
+        bool parse_value(JsonValue& value, const int depth) {
+            if (depth > max_depth) {
+                return fail("Nested too deep");
+            }
+            skip_whitespace();
+            if (cursor == end) {
+                return fail("Expected a value");
+            }
+            switch (*cursor) {
+                case '{': {
+                    value.type = JsonValue::Type::object;
+                    ++cursor;
+                    skip_whitespace();
+                    if (cursor < end && *cursor == '}') {
+                        ++cursor;
+                        return true;
+                    }
+                    while (true) {
+                        skip_whitespace();
+                        if (cursor == end || *cursor != '"') {
+                            return fail("Expected a member name");
+                        }
+                        value.object.emplace_back();
+                        if (!parse_string(value.object.back().first)) {
+                            return false;
+                        }
+                        skip_whitespace();
+                        if (cursor == end || *cursor++ != ':') {
+                            return fail("Expected ':'");
+                        }
+                        if (!parse_value(value.object.back().second, depth + 1)) {
+                            return false;
+                        }
+                        skip_whitespace();
+                        if (cursor < end && *cursor == ',') {
+                            ++cursor;
+                            continue;
+                        }
+                        if (cursor < end && *cursor == '}') {
+                            ++cursor;
+                            return true;
+                        }
+                        return fail("Expected ',' or '}'");
+                    }
+                }
+                case '[': {
+                    value.type = JsonValue::Type::array;
+                    ++cursor;
+                    skip_whitespace();
+                    if (cursor < end && *cursor == ']') {
+                        ++cursor;
+                        return true;
+                    }
+                    while (true) {
+                        value.array.emplace_back();
+                        if (!parse_value(value.array.back(), depth + 1)) {
+                            return false;
+                        }
+                        skip_whitespace();
+                        if (cursor < end && *cursor == ',') {
+                            ++cursor;
+                            continue;
+                        }
+                        if (cursor < end && *cursor == ']') {
+                            ++cursor;
+                            return true;
+                        }
+                        return fail("Expected ',' or ']'");
+                    }
+                }
+                case '"':
+                    value.type = JsonValue::Type::string;
+                    return parse_string(value.string);
+                case 't':
+                case 'f':
+                case 'n':
+                    if (consume("true")) {
+                        value.type = JsonValue::Type::boolean;
+                        value.boolean = true;
+                        return true;
+                    }
+                    if (consume("false")) {
+                        value.type = JsonValue::Type::boolean;
+                        return true;
+                    }
+                    if (consume("null")) {
+                        return true;
+                    }
+                    return fail("Unknown literal");
+                default:
+                    value.type = JsonValue::Type::number;
+                    return parse_number(value.number);
+            }
+        }
+    };
+}
+
+const JsonValue* JsonValue::find(const char* key) const {
+    for (const auto& member : object) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+double JsonValue::number_or(const char* key, const double fallback) const {
+    const JsonValue* member = find(key);
+    return member && member->type == Type::number ? member->number : fallback;
+}
+
+const std::string& JsonValue::string_or(const char* key, const std::string& fallback) const {
+    const JsonValue* member = find(key);
+    return member && member->type == Type::string ? member->string : fallback;
+}
+
+bool parse_json(const char* text, const size_t size, JsonValue& value) {
+    value = JsonValue{};
+    JsonParser parser{ text, text, text + size };
+    if (parser.parse_value(value, 0)) {
+        parser.skip_whitespace();
+        if (parser.cursor == parser.end) {
+            return true;
+        }
+        parser.fail("Unexpected data after the document");
+    }
+    printf("[ERROR] Invalid JSON at byte %zu: %s\n", static_cast<size_t>(parser.cursor - parser.begin), parser.error);
+    return false;
+}
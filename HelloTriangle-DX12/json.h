@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* JSON
+* A small JSON reader, just enough for glTF files. The whole document is parsed into a tree of JsonValues.
+* glTF JSON is small compared to the binary buffers it describes, so this doesn't need to be fast.
+* Numbers are always doubles, and object members keep the order they have in the file.
+*/
+
+struct JsonValue {
+    enum class Type {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object,
+    };
+
+    Type type = Type::null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    // Returns nullptr if this isn't an object or it doesn't have the member
+    const JsonValue* find(const char* key) const;
+
+    // Shortcuts for optional members, they return the fallback if the member is missing or has another type
+    double number_or(const char* key, double fallback) const;
+    const std::string& string_or(const char* key, const std::string& fallback) const;
+};
+
+// Parses a whole document. Prints an error with the byte offset and returns false if it isn't valid JSON.
+bool parse_json(const char* text, size_t size, JsonValue& value);
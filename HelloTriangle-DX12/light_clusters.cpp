@@ -0,0 +1,270 @@
+#include "light_clusters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "parallel_for.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_CLUSTERS_SSE2 1
+#include <emmintrin.h>
+#else
+#define LIGHT_CLUSTERS_SSE2 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    unsigned count_trailing_zeros(const uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    // How far p is outside of the range, 0 if it's inside. Same as axis_distance() in light_clusters.hlsli.
+    float axis_distance(const glm::vec2& range, const float p) {
+        return std::max(std::max(range.x - p, p - range.y), 0.0f);
+    }
+
+    // Which of the 16 clusters in a row the light touches, one bit per column. `yz_squared` is dz * dz + dy * dy.
+    uint32_t test_cluster_row(const glm::vec2* x_ranges, const float x, const float yz_squared, const float radius_squared) {
+        static_assert(cluster_tiles_x % 4 == 0, "A row of clusters has to be a whole number of SSE2 vectors");
+#if LIGHT_CLUSTERS_SSE2
+        const __m128 position = _mm_set1_ps(x);
+        const __m128 yz = _mm_set1_ps(yz_squared);
+        const __m128 radius = _mm_set1_ps(radius_squared);
+        uint32_t mask = 0;
+        for (uint32_t column = 0; column < cluster_tiles_x; column += 4) {
+            // Four (min, max) pairs, split into the minimums and the maximums
+            const __m128 ranges_01 = _mm_loadu_ps(&x_ranges[column].x);
+            const __m128 ranges_23 = _mm_loadu_ps(&x_ranges[column + 2].x);
+            const __m128 minimum = _mm_shuffle_ps(ranges_01, ranges_23, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 maximum = _mm_shuffle_ps(ranges_01, ranges_23, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minimum, position), _mm_sub_ps(position, maximum)), _mm_setzero_ps());
+            const __m128 distance_squared = _mm_add_ps(yz, _mm_mul_ps(dx, dx));
+            mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(distance_squared, radius))) << column;
+        }
+        return mask;
+#else
+        uint32_t mask = 0;
+        for (uint32_t column = 0; column < cluster_tiles_x; ++column) {
+            const float dx = axis_distance(x_ranges[column], x);
+            mask |= (yz_squared + dx * dx <= radius_squared ? 1u : 0u) << column;
+        }
+        return mask;
+#endif
+    }
+
+    // Which of 4 lights reach into a slice, one bit per light. The same test as the first step of the full one.
+    uint32_t test_slice(const glm::vec2& z_range, const float* z, const float* radius_squared) {
+#if LIGHT_CLUSTERS_SSE2
+        const __m128 position = _mm_loadu_ps(z);
+        const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(z_range.x), position), _mm_sub_ps(position, _mm_set1_ps(z_range.y))), _mm_setzero_ps());
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dz, dz), _mm_loadu_ps(radius_squared))));
+#else
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < 4; ++i) {
+            const float dz = axis_distance(z_range, z[i]);
+            mask |= (dz * dz <= radius_squared[i] ? 1u : 0u) << i;
+        }
+        return mask;
+#endif
+    }
+}
+
+ClusterGrid make_cluster_grid(const glm::mat4& projection, const uint32_t width, const uint32_t height, const float near_plane, const float far_plane) {
+    ClusterGrid grid;
+    grid.near_plane = near_plane;
+    grid.far_plane = far_plane;
+
+    // Tiles are a whole number of pixels, so the last ones can stick out of the screen a little
+    const uint32_t tile_width = (width + cluster_tiles_x - 1) / cluster_tiles_x;
+    const uint32_t tile_height = (height + cluster_tiles_y - 1) / cluster_tiles_y;
+    grid.lookup.tile_scale = glm::vec2(1.0f / static_cast<float>(tile_width), 1.0f / static_cast<float>(tile_height));
+
+    // Slice s starts at depth near * (far / near)^(s / slices), so log2(depth) maps to the slice linearly
+    const float depth_ratio = far_plane / near_plane;
+    grid.lookup.slice_scale = static_cast<float>(cluster_slices) / log2f(depth_ratio);
+    grid.lookup.slice_bias = -log2f(near_plane) * grid.lookup.slice_scale;
+
+    // A view space point at depth d (-z) that projects to NDC x is at x = d * (ndc_x + P[2][0]) / P[0][0], so at
+    // a given depth, the cluster's edges are at the tile's edges. The box has to fit both ends of the slice.
+    const auto view_range = [](const float ndc_0, const float ndc_1, const float depth_0, const float depth_1, const float offset, const float scale) {
+        const float values[4] = {
+            depth_0 * (ndc_0 + offset) / scale, depth_0 * (ndc_1 + offset) / scale,
+            depth_1 * (ndc_0 + offset) / scale, depth_1 * (ndc_1 + offset) / scale,
+        };
+        return glm::vec2(*std::min_element(values, values + 4), *std::max_element(values, values + 4));
+    };
+    for (uint32_t slice = 0; slice < cluster_slices; ++slice) {
+        const float depth_0 = near_plane * powf(depth_ratio, static_cast<float>(slice) / cluster_slices);
+        const float depth_1 = slice + 1 == cluster_slices ? far_plane : near_plane * powf(depth_ratio, static_cast<float>(slice + 1) / cluster_slices);
+        grid.bounds.z[slice] = glm::vec2(-depth_1, -depth_0);
+        for (uint32_t column = 0; column < cluster_tiles_x; ++column) {
+            const float ndc_0 = 2.0f * static_cast<float>(column * tile_width) / static_cast<float>(width) - 1.0f;
+            const float ndc_1 = 2.0f * static_cast<float>((column + 1) * tile_width) / static_cast<float>(width) - 1.0f;
+            grid.bounds.x[slice][column] = view_range(ndc_0, ndc_1, depth_0, depth_1, projection[2][0], projection[0][0]);
+        }
+        for (uint32_t row = 0; row < cluster_tiles_y; ++row) {
+            // NDC y goes up, rows go down
+            const float ndc_0 = 1.0f - 2.0f * static_cast<float>(row * tile_height) / static_cast<float>(height);
+            const float ndc_1 = 1.0f - 2.0f * static_cast<float>((row + 1) * tile_height) / static_cast<float>(height);
+            grid.bounds.y[slice][row] = view_range(ndc_0, ndc_1, depth_0, depth_1, projection[2][1], projection[1][1]);
+        }
+    }
+    return grid;
+}
+
+uint32_t cluster_at(const ClusterLookup& lookup, const float pixel_x, const float pixel_y, const float depth) {
+    const uint32_t column = std::min(static_cast<uint32_t>(std::max(pixel_x * lookup.tile_scale.x, 0.0f)), cluster_tiles_x - 1);
+    const uint32_t row = std::min(static_cast<uint32_t>(std::max(pixel_y * lookup.tile_scale.y, 0.0f)), cluster_tiles_y - 1);
+    const float slice = log2f(std::max(depth, 1e-30f)) * lookup.slice_scale + lookup.slice_bias;
+    return cluster_index(std::min(static_cast<uint32_t>(std::max(slice, 0.0f)), cluster_slices - 1), row, column);
+}
+
+/* LIGHT ASSIGNMENT
+* Three steps, the first two on all threads:
+* - For every slice, test 4 lights at a time against its z range, then work out which rows of the slice the lights
+*   that pass reach into, and add them to those rows, with the part of the distance the row already knows.
+* - For every row of clusters, test its lights against all 16 clusters of the row at once, and write the row's
+*   lists, one after the other. Clusters are numbered row by row, so these are already in the right order, and
+*   lights are added to rows in order, so the lists are too.
+* - Give every row its place in the index list, then copy the rows there. Clusters that don't fit anymore get cut
+*   off, like the compaction shader does.
+* A row only ever gets written by one thread, so nothing needs to be locked.
+*/
+void assign_lights_to_clusters(const ClusterGrid& grid, const ClusterLight* lights, uint32_t light_count, ClusterLightLists& lists,
+                               ClusterAssignStats* stats, const unsigned thread_count) {
+    light_count = std::min(light_count, max_cluster_lights);
+    constexpr uint32_t row_count = cluster_slices * cluster_tiles_y;
+    lists.ranges.resize(cluster_count);
+    lists.row_lights.resize(row_count);
+    lists.row_indices.resize(row_count);
+    lists.worker_columns.resize(parallel_thread_count(thread_count));
+
+    // The z and the squared radius of every light, for testing 4 lights at a time. The padding never reaches anything.
+    lists.light_z.resize((light_count + 3) & ~3u);
+    lists.light_radius_squared.resize(lists.light_z.size());
+    for (uint32_t i = 0; i < light_count; ++i) {
+        lists.light_z[i] = lights[i].position.z;
+        lists.light_radius_squared[i] = lights[i].radius * lights[i].radius;
+    }
+    for (uint32_t i = light_count; i < lists.light_z.size(); ++i) {
+        lists.light_z[i] = 0.0f;
+        lists.light_radius_squared[i] = -1.0f;
+    }
+
+    // Lights per row of clusters
+    parallel_for(cluster_slices, 1, [&](const size_t begin, const size_t end) {
+        for (size_t slice = begin; slice < end; ++slice) {
+            std::vector<ClusterRowLight>* row_lights = &lists.row_lights[slice * cluster_tiles_y];
+            for (uint32_t row = 0; row < cluster_tiles_y; ++row) {
+                row_lights[row].clear();
+            }
+            for (uint32_t first = 0; first < light_count; first += 4) {
+                for (uint32_t slice_mask = test_slice(grid.bounds.z[slice], &lists.light_z[first], &lists.light_radius_squared[first]); slice_mask != 0; slice_mask &= slice_mask - 1) {
+                    const uint32_t i = first + count_trailing_zeros(slice_mask);
+                    const ClusterLight& light = lights[i];
+                    const float dz = axis_distance(grid.bounds.z[slice], light.position.z);
+                    const float dz_squared = dz * dz;
+
+                    // All rows without branches, most lights only reach one or two
+                    float yz_squared[cluster_tiles_y];
+                    uint32_t row_mask = 0;
+                    for (uint32_t row = 0; row < cluster_tiles_y; ++row) {
+                        const float dy = axis_distance(grid.bounds.y[slice][row], light.position.y);
+                        yz_squared[row] = dz_squared + dy * dy;
+                        row_mask |= (yz_squared[row] <= light.radius * light.radius ? 1u : 0u) << row;
+                    }
+                    for (; row_mask != 0; row_mask &= row_mask - 1) {
+                        const uint32_t row = count_trailing_zeros(row_mask);
+                        row_lights[row].push_back({ i, yz_squared[row] });
+                    }
+                }
+            }
+        }
+    }, thread_count);
+
+    // Lists per row
+    parallel_for_with_worker(row_count, 1, [&](const size_t begin, const size_t end, const unsigned worker) {
+        std::vector<uint32_t>& columns = lists.worker_columns[worker];
+        for (size_t row_index = begin; row_index < end; ++row_index) {
+            const uint32_t slice = static_cast<uint32_t>(row_index / cluster_tiles_y);
+            const uint32_t row = static_cast<uint32_t>(row_index % cluster_tiles_y);
+            const std::vector<ClusterRowLight>& row_lights = lists.row_lights[row_index];
+
+            // Every column gets room for all of the row's lights, and every light is written to all of them, but
+            // only counted where it's in the cluster. That's faster than branching on the mask.
+            const size_t stride = row_lights.size();
+            if (columns.size() < stride * cluster_tiles_x) {
+                columns.resize(stride * cluster_tiles_x);
+            }
+            uint32_t counts[cluster_tiles_x] = {};
+            for (const ClusterRowLight& row_light : row_lights) {
+                const ClusterLight& light = lights[row_light.light_index];
+                const uint32_t mask = test_cluster_row(grid.bounds.x[slice], light.position.x, row_light.yz_squared, light.radius * light.radius);
+                for (uint32_t column = 0; column < cluster_tiles_x; ++column) {
+                    columns[column * stride + counts[column]] = row_light.light_index;
+                    counts[column] += (mask >> column) & 1;
+                }
+            }
+
+            // The row's lists, one after the other, with offsets relative to the start of the row for now
+            std::vector<uint32_t>& indices = lists.row_indices[row_index];
+            indices.clear();
+            for (uint32_t column = 0; column < cluster_tiles_x; ++column) {
+                lists.ranges[cluster_index(slice, row, column)] = { static_cast<uint32_t>(indices.size()), counts[column] };
+                indices.insert(indices.end(), columns.begin() + column * stride, columns.begin() + column * stride + counts[column]);
+            }
+        }
+    }, thread_count);
+
+    // Place the rows in the index list. Offsets are where the list would be if the index list was big enough.
+    std::vector<uint32_t> row_offsets(row_count);
+    uint64_t total = 0;
+    ClusterAssignStats assign_stats;
+    for (uint32_t row_index = 0; row_index < row_count; ++row_index) {
+        row_offsets[row_index] = static_cast<uint32_t>(total);
+        for (uint32_t column = 0; column < cluster_tiles_x; ++column) {
+            ClusterRange& range = lists.ranges[row_index * cluster_tiles_x + column];
+            const uint32_t count = range.count;
+            range.offset += static_cast<uint32_t>(total);
+            range.count = range.offset >= max_cluster_light_indices ? 0 : std::min(count, max_cluster_light_indices - range.offset);
+            assign_stats.light_cluster_pairs += count;
+            assign_stats.dropped += count - range.count;
+            assign_stats.max_cluster_lights = std::max(assign_stats.max_cluster_lights, count);
+            assign_stats.empty_clusters += count == 0 ? 1 : 0;
+        }
+        total += lists.row_indices[row_index].size();
+    }
+    lists.light_indices.resize(static_cast<size_t>(std::min<uint64_t>(total, max_cluster_light_indices)));
+    parallel_for(row_count, 16, [&](const size_t begin, const size_t end) {
+        for (size_t row_index = begin; row_index < end; ++row_index) {
+            const std::vector<uint32_t>& indices = lists.row_indices[row_index];
+            const size_t offset = row_offsets[row_index];
+            if (offset < lists.light_indices.size() && !indices.empty()) {
+                memcpy(&lists.light_indices[offset], indices.data(), std::min(indices.size(), lists.light_indices.size() - offset) * sizeof(uint32_t));
+            }
+        }
+    }, thread_count);
+    if (stats) {
+        *stats = assign_stats;
+    }
+}
+
+size_t count_cluster_differences(const ClusterLightLists& expected, const ClusterRange* ranges, const uint32_t* light_indices) {
+    size_t differences = 0;
+    for (uint32_t i = 0; i < cluster_count; ++i) {
+        const ClusterRange& range = expected.ranges[i];
+        if (range.offset != ranges[i].offset || range.count != ranges[i].count ||
+            (range.count != 0 && memcmp(&expected.light_indices[range.offset], &light_indices[range.offset], range.count * sizeof(uint32_t)) != 0)) {
+            differences++;
+        }
+    }
+    return differences;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+
+/* CLUSTERED LIGHTING
+* With thousands of lights, a pixel can't loop over all of them. The view frustum is cut into a grid of clusters
+* (froxels): screen tiles in x and y, and slices in depth that get thicker further away, so clusters stay roughly
+* cube-shaped. Every light is assigned to the clusters its sphere touches, and a pixel only loops over the lights
+* of the cluster it's in.
+*
+* The assignment runs on the GPU in two compute shaders (see Shaders/DX12/light_clusters.hlsli): every light sets
+* its bit in the clusters it touches, then one group turns those bitmasks into a compact list per cluster. The
+* functions here do the same thing on the CPU, with SSE2 and on all threads, and give bit-identical results:
+* - Both test each light against each cluster's view space box with the same float operations in the same order,
+*   (dz * dz + dy * dy) + dx * dx <= radius * radius, where the box comes from the grid, which is made here once
+*   and uploaded as is. Every early out in between is implied by that test, so it can't change the result.
+* - Lists are in light order, and clusters get their place in the index list in cluster order, so neither
+*   depends on which thread gets there first.
+* - When the index list is full, the clusters that don't fit get cut off the same way.
+* So the CPU version can check the GPU, and the software rasterizer can use it in place of the GPU.
+*
+* A cluster's box only depends on its slice and column for x, and its slice and row for y, so the grid stores
+* those ranges separately, which is much less to upload, and lets us test a light against a row of 16 clusters
+* with 4 SSE2 compares.
+*/
+
+// Must match light_clusters.hlsli
+constexpr uint32_t cluster_tiles_x = 16;
+constexpr uint32_t cluster_tiles_y = 9;
+constexpr uint32_t cluster_slices = 24;
+constexpr uint32_t cluster_count = cluster_tiles_x * cluster_tiles_y * cluster_slices;
+constexpr uint32_t max_cluster_lights = 16384;
+constexpr uint32_t max_cluster_light_indices = 1 << 20;
+
+// Clusters are numbered slice by slice, row by row, top to bottom
+inline uint32_t cluster_index(const uint32_t slice, const uint32_t row, const uint32_t column) {
+    return (slice * cluster_tiles_y + row) * cluster_tiles_x + column;
+}
+
+// One light, as the compute and pixel shaders read it
+struct ClusterLight {
+    glm::vec3 position;     // View space
+    float radius;           // Nothing outside it is lit, has to be more than 0
+    glm::vec3 color;
+    float padding;
+};
+static_assert(sizeof(ClusterLight) == 32, "ClusterLight must match the HLSL struct");
+
+// The view space box of every cluster, uploaded as is, as a StructuredBuffer<float2> of (min, max) ranges
+struct ClusterBounds {
+    glm::vec2 z[cluster_slices];                    // View space z, so negative in front of the camera
+    glm::vec2 x[cluster_slices][cluster_tiles_x];
+    glm::vec2 y[cluster_slices][cluster_tiles_y];   // Row 0 is the top of the screen
+};
+
+// What a pixel needs to find its cluster, part of the shader constants
+struct ClusterLookup {
+    glm::vec2 tile_scale;   // 1 / tile size in pixels
+    float slice_scale;      // slice = log2(depth) * slice_scale + slice_bias
+    float slice_bias;
+};
+
+struct ClusterGrid {
+    ClusterBounds bounds;
+    ClusterLookup lookup;
+    float near_plane = 0.0f;
+    float far_plane = 0.0f;
+};
+
+// A light that reaches into a row of clusters, with dz * dz + dy * dy to the row
+struct ClusterRowLight {
+    uint32_t light_index;
+    float yz_squared;
+};
+
+// Where a cluster's lights are in ClusterLightLists::light_indices
+struct ClusterRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+struct ClusterLightLists {
+    std::vector<ClusterRange> ranges;       // One per cluster
+    std::vector<uint32_t> light_indices;    // At most max_cluster_light_indices, as big as it has to be
+
+    // Kept between calls, so assigning the lights of every frame doesn't allocate
+    std::vector<float> light_z;
+    std::vector<float> light_radius_squared;
+    std::vector<std::vector<ClusterRowLight>> row_lights;
+    std::vector<std::vector<uint32_t>> row_indices;
+    std::vector<std::vector<uint32_t>> worker_columns;
+};
+
+struct ClusterAssignStats {
+    uint64_t light_cluster_pairs = 0;   // Including the ones that didn't fit
+    uint64_t dropped = 0;               // Light indices that didn't fit in the list
+    uint32_t max_cluster_lights = 0;
+    uint32_t empty_clusters = 0;
+};
+
+// The grid for a (normal or reverse-Z) perspective projection, with slices from near_plane to far_plane. Lights
+// further away than far_plane aren't assigned, pixels further away use the last slice.
+ClusterGrid make_cluster_grid(const glm::mat4& projection, uint32_t width, uint32_t height, float near_plane, float far_plane);
+
+// The same cluster a pixel shader finds with cluster_at() in light_clusters.hlsli. log2 isn't exact on GPUs, so
+// at the edge of a slice, the two can pick neighboring clusters.
+uint32_t cluster_at(const ClusterLookup& lookup, float pixel_x, float pixel_y, float depth);
+
+// Assigns up to max_cluster_lights lights to clusters, replacing what's in `lists`
+void assign_lights_to_clusters(const ClusterGrid& grid, const ClusterLight* lights, uint32_t light_count, ClusterLightLists& lists,
+                               ClusterAssignStats* stats = nullptr, unsigned thread_count = 0);
+
+// How many clusters have a different list in `ranges` and `light_indices` (usually read back from the GPU)
+size_t count_cluster_differences(const ClusterLightLists& expected, const ClusterRange* ranges, const uint32_t* light_indices);
@@ -0,0 +1,591 @@
+#include "mesh_codec.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include "parallel_for.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE2 1
+#include <emmintrin.h>
+#else
+#define MESH_CODEC_SSE2 0
+#endif
+
+namespace {
+    constexpr uint8_t index_codec_version = 0xE1;
+    constexpr uint8_t vertex_codec_version = 0xA1;
+
+    // The high nibble of a triangle code is an edge, 15 means the triangle doesn't share one
+    constexpr uint32_t edge_fifo_size = 15;
+    // The low nibble is the third vertex: 0 is the next new vertex, 1 to 13 a recent vertex, 14 the one after the last
+    // explicit vertex and 15 an explicit one
+    constexpr uint32_t vertex_fifo_size = 13;
+    constexpr uint32_t vertex_code_next = 0;
+    constexpr uint32_t vertex_code_sequential = 14;
+    constexpr uint32_t vertex_code_explicit = 15;
+
+    // A triangle without a shared edge: three new vertices in order, or a general one with its vertex codes after it
+    constexpr uint8_t triangle_code_fresh = 0xF0;
+    constexpr uint8_t triangle_code_general = 0xFF;
+
+    // The vertex codec works on blocks that fit in 8 KB, so both the planes and the vertices stay in L1
+    constexpr uint32_t vertex_block_bytes = 8192;
+    constexpr uint32_t vertex_group_bytes[4] = { 0, 4, 8, 16 };
+
+    /* INDEX CODEC STATE
+    * The same on both sides: the encoder only ever makes choices the decoder can repeat from what it has already
+    * decoded. Entry 0 is the most recent one.
+    */
+    struct IndexCodecState {
+        uint32_t edges[16][2] = {};
+        uint32_t vertices[16] = {};
+        uint32_t edge_head = 0;
+        uint32_t vertex_head = 0;
+        uint32_t next = 0;  // The lowest vertex that hasn't been used yet, if the vertices are in order
+        uint32_t last = 0;  // The last explicit or sequential vertex
+
+        void push_edge(const uint32_t a, const uint32_t b) {
+            edges[edge_head & 15][0] = a;
+            edges[edge_head & 15][1] = b;
+            edge_head++;
+        }
+        const uint32_t* edge(const uint32_t i) const {
+            return edges[(edge_head - 1 - i) & 15];
+        }
+        void push_vertex(const uint32_t vertex) {
+            vertices[vertex_head & 15] = vertex;
+            vertex_head++;
+        }
+        uint32_t vertex(const uint32_t i) const {
+            return vertices[(vertex_head - 1 - i) & 15];
+        }
+    };
+
+    uint32_t zigzag(const uint32_t value, const uint32_t base) {
+        const int32_t delta = static_cast<int32_t>(value - base);
+        return (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+    }
+
+    uint32_t unzigzag(const uint32_t value) {
+        return (value >> 1) ^ (0u - (value & 1));
+    }
+
+    // Vertices that aren't references to the FIFO go into it
+    bool goes_in_fifo(const uint32_t vertex_code) {
+        return vertex_code == vertex_code_next || vertex_code >= vertex_code_sequential;
+    }
+
+    uint8_t zigzag8(const uint8_t value, const uint8_t base) {
+        const int8_t delta = static_cast<int8_t>(value - base);
+        return static_cast<uint8_t>((static_cast<uint8_t>(delta) << 1) ^ static_cast<uint8_t>(delta >> 7));
+    }
+
+#if !MESH_CODEC_SSE2
+    uint8_t unzigzag8(const uint8_t value) {
+        return static_cast<uint8_t>((value >> 1) ^ (0u - (value & 1)));
+    }
+#endif
+
+    void write_varint(std::vector<uint8_t>& output, uint32_t value) {
+        while (value >= 0x80) {
+            output.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool read_varint(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+        value = 0;
+        for (uint32_t shift = 0; shift < 35 && data < end; shift += 7) {
+            const uint8_t byte = *data++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The code for a vertex that isn't part of a shared edge, updates the state like the decoder will
+    uint32_t encode_vertex(IndexCodecState& state, const uint32_t vertex, std::vector<uint8_t>& explicit_vertices) {
+        if (vertex == state.next) {
+            state.next++;
+            return vertex_code_next;
+        }
+        for (uint32_t i = 0; i < vertex_fifo_size; ++i) {
+            if (state.vertex(i) == vertex) {
+                return 1 + i;
+            }
+        }
+        const bool sequential = vertex == state.last + 1;
+        if (!sequential) {
+            write_varint(explicit_vertices, zigzag(vertex, state.last));
+        }
+        state.last = vertex;
+        return sequential ? vertex_code_sequential : vertex_code_explicit;
+    }
+
+    bool decode_vertex(IndexCodecState& state, const uint32_t code, const uint8_t*& data, const uint8_t* end, uint32_t& vertex) {
+        if (code == vertex_code_next) {
+            vertex = state.next++;
+        }
+        else if (code == vertex_code_sequential) {
+            vertex = ++state.last;
+        }
+        else if (code != vertex_code_explicit) {
+            vertex = state.vertex(code - 1);
+        }
+        else {
+            uint32_t value;
+            if (!read_varint(data, end, value)) {
+                return false;
+            }
+            vertex = state.last += unzigzag(value);
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool decode_indices(T* destination, const size_t triangle_count, const uint8_t* codes, const uint8_t* data, const uint8_t* end) {
+        IndexCodecState state;
+        uint32_t all_vertices = 0;  // Every vertex ORed together, to find ones that don't fit in T without a branch per triangle
+        for (size_t triangle = 0; triangle < triangle_count; ++triangle) {
+            const uint32_t code = codes[triangle];
+            const uint32_t edge_code = code >> 4;
+            const uint32_t vertex_code = code & 15;
+            uint32_t a, b, c;
+            if (edge_code < edge_fifo_size) {
+                // Shares an edge with a recent triangle. This is most triangles, so the next, sequential and recent
+                // vertices are told apart without branches, they'd be mispredicted a lot.
+                const uint32_t* edge = state.edge(edge_code);
+                a = edge[0];
+                b = edge[1];
+                if (vertex_code == vertex_code_explicit) {
+                    if (!decode_vertex(state, vertex_code, data, end, c)) {
+                        return false;
+                    }
+                }
+                else {
+                    const bool next = vertex_code == vertex_code_next;
+                    const bool sequential = vertex_code == vertex_code_sequential;
+                    const uint32_t recent = state.vertex((vertex_code - 1) & 15);
+                    c = next ? state.next : sequential ? state.last + 1 : recent;
+                    state.next += next ? 1 : 0;
+                    state.last = sequential ? c : state.last;
+                }
+                state.vertices[state.vertex_head & 15] = c;
+                state.vertex_head += goes_in_fifo(vertex_code) ? 1 : 0;
+                state.push_edge(c, b);
+                state.push_edge(a, c);
+            }
+            else {
+                uint32_t vertex_codes[3] = { vertex_code_next, vertex_code_next, vertex_code_next };
+                if (code == triangle_code_general) {
+                    if (end - data < 2) {
+                        return false;
+                    }
+                    vertex_codes[0] = data[0] >> 4;
+                    vertex_codes[1] = data[0] & 15;
+                    vertex_codes[2] = data[1] >> 4;
+                    data += 2;
+                }
+                else if (code != triangle_code_fresh) {
+                    return false;
+                }
+                // All three are looked up before any of them goes into the FIFO, like the encoder does
+                if (!decode_vertex(state, vertex_codes[0], data, end, a) || !decode_vertex(state, vertex_codes[1], data, end, b)
+                    || !decode_vertex(state, vertex_codes[2], data, end, c)) {
+                    return false;
+                }
+                const uint32_t triangle_vertices[3] = { a, b, c };
+                for (uint32_t i = 0; i < 3; ++i) {
+                    if (goes_in_fifo(vertex_codes[i])) {
+                        state.push_vertex(triangle_vertices[i]);
+                    }
+                }
+                state.push_edge(b, a);
+                state.push_edge(c, b);
+                state.push_edge(a, c);
+            }
+            destination[triangle * 3 + 0] = static_cast<T>(a);
+            destination[triangle * 3 + 1] = static_cast<T>(b);
+            destination[triangle * 3 + 2] = static_cast<T>(c);
+            all_vertices |= a | b | c;
+        }
+        return data == end && all_vertices <= std::numeric_limits<T>::max();
+    }
+
+    uint32_t vertex_block_size(const uint32_t vertex_size) {
+        return std::min(vertex_block_bytes / vertex_size, 256u) & ~15u;
+    }
+
+#if MESH_CODEC_SSE2
+    __m128i decode_group(const uint8_t* data, const uint32_t width) {
+        switch (width) {
+            case 1: {
+                // Value i is in bits 2 * (i / 4) of byte i % 4
+                int32_t bits;
+                memcpy(&bits, data, sizeof(bits));
+                const __m128i packed = _mm_cvtsi32_si128(bits);
+                const __m128i mask = _mm_set1_epi8(3);
+                const __m128i a = _mm_and_si128(packed, mask);
+                const __m128i b = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+                const __m128i c = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+                const __m128i d = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+                return _mm_unpacklo_epi64(_mm_unpacklo_epi32(a, b), _mm_unpacklo_epi32(c, d));
+            }
+            case 2: {
+                // Values 0 to 7 are in the low nibbles, 8 to 15 in the high ones
+                const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+                const __m128i mask = _mm_set1_epi8(15);
+                return _mm_unpacklo_epi64(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+            }
+            case 3:
+                return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            default:
+                return _mm_setzero_si128();
+        }
+    }
+
+    // Every byte of the result holds byte 15 of `value`
+    __m128i broadcast_last_byte(const __m128i value) {
+        const __m128i high = _mm_unpackhi_epi8(value, value);
+        return _mm_shuffle_epi32(_mm_unpackhi_epi16(high, high), 0xFF);
+    }
+#endif
+
+    // Decodes one plane of a block: unpacks the groups, undoes the zigzag and adds up the differences
+    bool decode_plane(const uint8_t*& data, const uint8_t* end, const uint32_t group_count, uint8_t& previous, uint8_t* plane) {
+        const uint8_t* widths = data;
+        const uint32_t width_bytes = (group_count + 3) / 4;
+        if (static_cast<size_t>(end - data) < width_bytes) {
+            return false;
+        }
+        data += width_bytes;
+
+#if MESH_CODEC_SSE2
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i low_bits = _mm_set1_epi8(0x7F);
+        __m128i carry = _mm_set1_epi8(static_cast<char>(previous));
+        for (uint32_t group = 0; group < group_count; ++group) {
+            const uint32_t width = (widths[group / 4] >> (group % 4 * 2)) & 3;
+            if (static_cast<size_t>(end - data) < vertex_group_bytes[width]) {
+                return false;
+            }
+            __m128i value = decode_group(data, width);
+            data += vertex_group_bytes[width];
+
+            value = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(value, 1), low_bits), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(value, one)));
+            value = _mm_add_epi8(value, _mm_slli_si128(value, 1));
+            value = _mm_add_epi8(value, _mm_slli_si128(value, 2));
+            value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+            value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+            value = _mm_add_epi8(value, carry);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(plane + group * 16), value);
+            carry = broadcast_last_byte(value);
+        }
+        previous = static_cast<uint8_t>(_mm_cvtsi128_si32(carry));
+#else
+        for (uint32_t group = 0; group < group_count; ++group) {
+            const uint32_t width = (widths[group / 4] >> (group % 4 * 2)) & 3;
+            if (static_cast<size_t>(end - data) < vertex_group_bytes[width]) {
+                return false;
+            }
+            for (uint32_t i = 0; i < 16; ++i) {
+                uint8_t value = 0;
+                if (width == 1) {
+                    value = (data[i % 4] >> (i / 4 * 2)) & 3;
+                }
+                else if (width == 2) {
+                    value = (data[i % 8] >> (i / 8 * 4)) & 15;
+                }
+                else if (width == 3) {
+                    value = data[i];
+                }
+                previous = static_cast<uint8_t>(previous + unzigzag8(value));
+                plane[group * 16 + i] = previous;
+            }
+            data += vertex_group_bytes[width];
+        }
+#endif
+        return true;
+    }
+
+    /* TRANSPOSE
+    * Turns the planes of a block back into vertices, 16 vertices and 8 bytes of each at a time. Every vertex gets
+    * 8-byte stores, so when the vertex size isn't a multiple of 8, the last store of a vertex runs 4 bytes into the
+    * next one. That's fine as long as the start of the next vertex is written after it: the last 8 planes go first,
+    * then the rest. The planes buffer needs room for the vertex size rounded up to 8 planes, and the vertices buffer
+    * 8 bytes more than the vertices.
+    */
+    void transpose_planes(const uint8_t* planes, const uint32_t padded_count, const uint32_t vertex_size, uint8_t* vertices) {
+#if MESH_CODEC_SSE2
+        const uint32_t last_byte = (vertex_size - 1) / 8 * 8;
+        for (uint32_t first = 0; first < padded_count; first += 16) {
+            for (uint32_t pass = 0; pass <= last_byte; pass += 8) {
+                const uint32_t byte = pass == 0 ? last_byte : pass - 8;
+                const uint8_t* input = planes + byte * padded_count + first;
+                const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 0 * padded_count));
+                const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 1 * padded_count));
+                const __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * padded_count));
+                const __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 3 * padded_count));
+                const __m128i p4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 4 * padded_count));
+                const __m128i p5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 5 * padded_count));
+                const __m128i p6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 6 * padded_count));
+                const __m128i p7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 7 * padded_count));
+
+                // 2 bytes of vertices 0-7 and 8-15
+                const __m128i p01_low = _mm_unpacklo_epi8(p0, p1);
+                const __m128i p01_high = _mm_unpackhi_epi8(p0, p1);
+                const __m128i p23_low = _mm_unpacklo_epi8(p2, p3);
+                const __m128i p23_high = _mm_unpackhi_epi8(p2, p3);
+                const __m128i p45_low = _mm_unpacklo_epi8(p4, p5);
+                const __m128i p45_high = _mm_unpackhi_epi8(p4, p5);
+                const __m128i p67_low = _mm_unpacklo_epi8(p6, p7);
+                const __m128i p67_high = _mm_unpackhi_epi8(p6, p7);
+
+                // 4 bytes of vertices 0-3, 4-7, 8-11 and 12-15
+                const __m128i p03_0 = _mm_unpacklo_epi16(p01_low, p23_low);
+                const __m128i p03_1 = _mm_unpackhi_epi16(p01_low, p23_low);
+                const __m128i p03_2 = _mm_unpacklo_epi16(p01_high, p23_high);
+                const __m128i p03_3 = _mm_unpackhi_epi16(p01_high, p23_high);
+                const __m128i p47_0 = _mm_unpacklo_epi16(p45_low, p67_low);
+                const __m128i p47_1 = _mm_unpackhi_epi16(p45_low, p67_low);
+                const __m128i p47_2 = _mm_unpacklo_epi16(p45_high, p67_high);
+                const __m128i p47_3 = _mm_unpackhi_epi16(p45_high, p67_high);
+
+                // 8 bytes of two vertices each
+                const __m128i pairs[8] = {
+                    _mm_unpacklo_epi32(p03_0, p47_0),
+                    _mm_unpackhi_epi32(p03_0, p47_0),
+                    _mm_unpacklo_epi32(p03_1, p47_1),
+                    _mm_unpackhi_epi32(p03_1, p47_1),
+                    _mm_unpacklo_epi32(p03_2, p47_2),
+                    _mm_unpackhi_epi32(p03_2, p47_2),
+                    _mm_unpacklo_epi32(p03_3, p47_3),
+                    _mm_unpackhi_epi32(p03_3, p47_3),
+                };
+                uint8_t* output = vertices + first * vertex_size + byte;
+                for (const __m128i& pair : pairs) {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), pair);
+                    _mm_storeh_pi(reinterpret_cast<__m64*>(output + vertex_size), _mm_castsi128_ps(pair));
+                    output += 2 * vertex_size;
+                }
+            }
+        }
+#else
+        for (uint32_t vertex = 0; vertex < padded_count; ++vertex) {
+            for (uint32_t byte = 0; byte < vertex_size; ++byte) {
+                vertices[vertex * vertex_size + byte] = planes[byte * padded_count + vertex];
+            }
+        }
+#endif
+    }
+}
+
+void encode_index_buffer(const uint32_t* indices, const size_t index_count, std::vector<uint8_t>& encoded) {
+    const size_t triangle_count = index_count / 3;
+    std::vector<uint8_t> data;
+    encoded.assign(1 + triangle_count, 0);
+    encoded[0] = index_codec_version;
+    uint8_t* codes = encoded.data() + 1;
+
+    IndexCodecState state;
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle) {
+        const uint32_t* corners = indices + triangle * 3;
+
+        // Find the cheapest rotation that starts with a recent edge: the third vertex next, then a recent one
+        uint32_t best_edge = edge_fifo_size;
+        uint32_t best_rotation = 0;
+        uint32_t best_cost = UINT32_MAX;
+        for (uint32_t rotation = 0; rotation < 3; ++rotation) {
+            const uint32_t a = corners[rotation];
+            const uint32_t b = corners[(rotation + 1) % 3];
+            const uint32_t c = corners[(rotation + 2) % 3];
+            for (uint32_t i = 0; i < edge_fifo_size; ++i) {
+                if (state.edge(i)[0] != a || state.edge(i)[1] != b) {
+                    continue;
+                }
+                uint32_t cost = c == state.last + 1 ? 1 : 2;
+                if (c == state.next) {
+                    cost = 0;
+                }
+                else {
+                    for (uint32_t j = 0; j < vertex_fifo_size; ++j) {
+                        cost = state.vertex(j) == c ? 1 : cost;
+                    }
+                }
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_edge = i;
+                    best_rotation = rotation;
+                }
+                break;
+            }
+        }
+
+        if (best_edge < edge_fifo_size) {
+            const uint32_t a = corners[best_rotation];
+            const uint32_t b = corners[(best_rotation + 1) % 3];
+            const uint32_t c = corners[(best_rotation + 2) % 3];
+            const uint32_t vertex_code = encode_vertex(state, c, data);
+            codes[triangle] = static_cast<uint8_t>(best_edge << 4 | vertex_code);
+            if (goes_in_fifo(vertex_code)) {
+                state.push_vertex(c);
+            }
+            state.push_edge(c, b);
+            state.push_edge(a, c);
+            continue;
+        }
+
+        const uint32_t a = corners[0];
+        const uint32_t b = corners[1];
+        const uint32_t c = corners[2];
+        std::vector<uint8_t> explicit_vertices;
+        uint32_t vertex_codes[3];
+        vertex_codes[0] = encode_vertex(state, a, explicit_vertices);
+        vertex_codes[1] = encode_vertex(state, b, explicit_vertices);
+        vertex_codes[2] = encode_vertex(state, c, explicit_vertices);
+        if (vertex_codes[0] == vertex_code_next && vertex_codes[1] == vertex_code_next && vertex_codes[2] == vertex_code_next) {
+            codes[triangle] = triangle_code_fresh;
+        }
+        else {
+            codes[triangle] = triangle_code_general;
+            data.push_back(static_cast<uint8_t>(vertex_codes[0] << 4 | vertex_codes[1]));
+            data.push_back(static_cast<uint8_t>(vertex_codes[2] << 4));
+            data.insert(data.end(), explicit_vertices.begin(), explicit_vertices.end());
+        }
+        for (uint32_t i = 0; i < 3; ++i) {
+            if (goes_in_fifo(vertex_codes[i])) {
+                state.push_vertex(corners[i]);
+            }
+        }
+        state.push_edge(b, a);
+        state.push_edge(c, b);
+        state.push_edge(a, c);
+    }
+    encoded.insert(encoded.end(), data.begin(), data.end());
+}
+
+bool decode_index_buffer(void* destination, const size_t index_count, const uint32_t index_size, const uint8_t* encoded, const size_t encoded_size) {
+    const size_t triangle_count = index_count / 3;
+    if (index_count % 3 != 0 || (index_size != 2 && index_size != 4) || encoded_size < 1 + triangle_count || encoded[0] != index_codec_version) {
+        printf("[ERROR] Encoded index buffer has the wrong version or size\n");
+        return false;
+    }
+    const uint8_t* codes = encoded + 1;
+    const uint8_t* end = encoded + encoded_size;
+    const bool valid = index_size == 2
+        ? decode_indices(static_cast<uint16_t*>(destination), triangle_count, codes, codes + triangle_count, end)
+        : decode_indices(static_cast<uint32_t*>(destination), triangle_count, codes, codes + triangle_count, end);
+    if (!valid) {
+        printf("[ERROR] Encoded index buffer is broken\n");
+    }
+    return valid;
+}
+
+void encode_vertex_buffer(const void* vertices, const size_t vertex_count, const uint32_t vertex_size, std::vector<uint8_t>& encoded) {
+    encoded.assign(1, vertex_codec_version);
+    const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+    const uint32_t block_size = vertex_block_size(vertex_size);
+    std::vector<uint8_t> previous(vertex_size, 0);
+    uint8_t values[256];
+
+    for (size_t block = 0; block < vertex_count; block += block_size) {
+        const uint32_t count = static_cast<uint32_t>(std::min<size_t>(block_size, vertex_count - block));
+        const uint32_t group_count = (count + 15) / 16;
+        for (uint32_t byte = 0; byte < vertex_size; ++byte) {
+            memset(values, 0, sizeof(values));
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint8_t value = bytes[(block + i) * vertex_size + byte];
+                values[i] = zigzag8(value, previous[byte]);
+                previous[byte] = value;
+            }
+
+            const size_t widths = encoded.size();
+            encoded.resize(encoded.size() + (group_count + 3) / 4, 0);
+            for (uint32_t group = 0; group < group_count; ++group) {
+                const uint8_t* group_values = values + group * 16;
+                uint8_t largest = 0;
+                for (uint32_t i = 0; i < 16; ++i) {
+                    largest = std::max(largest, group_values[i]);
+                }
+                const uint32_t width = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+                encoded[widths + group / 4] |= static_cast<uint8_t>(width << (group % 4 * 2));
+
+                uint8_t packed[16] = {};
+                for (uint32_t i = 0; i < 16; ++i) {
+                    if (width == 1) {
+                        packed[i % 4] |= static_cast<uint8_t>(group_values[i] << (i / 4 * 2));
+                    }
+                    else if (width == 2) {
+                        packed[i % 8] |= static_cast<uint8_t>(group_values[i] << (i / 8 * 4));
+                    }
+                    else {
+                        packed[i] = group_values[i];
+                    }
+                }
+                encoded.insert(encoded.end(), packed, packed + vertex_group_bytes[width]);
+            }
+        }
+    }
+}
+
+bool decode_vertex_buffer(void* destination, const size_t vertex_count, const uint32_t vertex_size, const uint8_t* encoded, const size_t encoded_size) {
+    if (vertex_size == 0 || vertex_size % 4 != 0 || vertex_size > 256 || encoded_size < 1 || encoded[0] != vertex_codec_version) {
+        printf("[ERROR] Encoded vertex buffer has the wrong version or vertex size\n");
+        return false;
+    }
+    const uint8_t* data = encoded + 1;
+    const uint8_t* end = encoded + encoded_size;
+    uint8_t* output = static_cast<uint8_t*>(destination);
+    const uint32_t block_size = vertex_block_size(vertex_size);
+    alignas(16) uint8_t planes[vertex_block_bytes + 8 * 256] = {};
+    alignas(16) uint8_t block_vertices[vertex_block_bytes + 8];
+    uint8_t previous[256] = {};
+
+    for (size_t block = 0; block < vertex_count; block += block_size) {
+        const uint32_t count = static_cast<uint32_t>(std::min<size_t>(block_size, vertex_count - block));
+        const uint32_t group_count = (count + 15) / 16;
+        const uint32_t padded_count = group_count * 16;
+        for (uint32_t byte = 0; byte < vertex_size; ++byte) {
+            if (!decode_plane(data, end, group_count, previous[byte], planes + byte * padded_count)) {
+                printf("[ERROR] Encoded vertex buffer is broken\n");
+                return false;
+            }
+            // The padding after the last vertex decodes to zero differences, so `previous` is the last vertex
+        }
+        transpose_planes(planes, padded_count, vertex_size, block_vertices);
+        memcpy(output + block * vertex_size, block_vertices, static_cast<size_t>(count) * vertex_size);
+    }
+    if (data != end) {
+        printf("[ERROR] Encoded vertex buffer is broken\n");
+        return false;
+    }
+    return true;
+}
+
+bool copy_mesh_sections(const MeshView& mesh, void* destination) {
+    uint8_t* output = static_cast<uint8_t*>(destination);
+    std::atomic<bool> valid{ true };
+    parallel_for(mesh.header->section_count, 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const MeshSectionHeader& section = mesh.sections[i];
+            uint8_t* target = output + section.offset;
+            const uint8_t* source = mesh.data + section.file_offset;
+            const size_t source_size = static_cast<size_t>(section.file_size);
+            if (section.encoding == MeshSectionEncoding::indices) {
+                valid = decode_index_buffer(target, section.element_count, section.element_size, source, source_size) && valid;
+            }
+            else if (section.encoding == MeshSectionEncoding::vertices) {
+                valid = decode_vertex_buffer(target, section.element_count, section.element_size, source, source_size) && valid;
+            }
+            else if (section.size > 0) {
+                memcpy(target, source, static_cast<size_t>(section.size));
+            }
+        }
+    });
+    return valid;
+}
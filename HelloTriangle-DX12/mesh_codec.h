@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "mesh_format.h"
+
+/* MESH CODEC
+* Makes index and vertex buffers smaller on disk, with decoders fast enough to run straight into upload memory while
+* a mesh is loaded. Both only work on whole buffers, and both decoders write their output front to back, so they
+* can write to write-combined memory.
+*
+* Index buffers (triangle lists) are encoded one triangle at a time, with two small FIFOs that the encoder and the
+* decoder keep in the same state:
+* - the last 15 edges, so a triangle next to a recent one only has to say which edge it shares and its third vertex
+* - the last 13 new vertices, so the third vertex is often a 4-bit reference too
+* Vertices that haven't been seen yet are usually the next one in order (meshes are cooked with their vertices in
+* the order the triangles first use them), so that's a code of its own. Everything else is stored as the difference
+* to the last such vertex, except the vertex right after it, which has a code too: a row of a grid uses the
+* vertices of the row before it in order. A triangle that shares an edge costs one byte, a 32-bit triangle list is 12.
+* Triangles can come back rotated (b, c, a instead of a, b, c), but never flipped, and in the same order.
+*
+* Vertex buffers are encoded in blocks of up to 256 vertices. Within a block, every byte of the vertex is its own
+* plane: byte 0 of all vertices, then byte 1 of all vertices, and so on. Every byte is stored as the difference to
+* the same byte of the vertex before it, so bytes that hardly change (the sign and exponent of floats, colors,
+* the high bytes of indices) become runs of small numbers. Those are zigzag-encoded, so small negative numbers are
+* small too, and stored in groups of 16 with 0, 2, 4 or 8 bits each, whichever is the smallest that fits the
+* group. The decoder undoes that with SSE2 16 bytes at a time, adds up the differences, transposes the planes back
+* into vertices in a small buffer, and copies each finished block to the output in one go.
+* The vertex size has to be a multiple of 4 and at most 256 bytes, the data itself can be anything.
+*/
+
+// Both return the encoded bytes in `encoded`
+void encode_index_buffer(const uint32_t* indices, size_t index_count, std::vector<uint8_t>& encoded);
+void encode_vertex_buffer(const void* vertices, size_t vertex_count, uint32_t vertex_size, std::vector<uint8_t>& encoded);
+
+// Decode into `destination`, which has room for exactly index_count indices of index_size (2 or 4) bytes, or
+// vertex_count vertices of vertex_size bytes. Return false and print an error if the encoded data is broken, or if
+// an index doesn't fit in index_size.
+bool decode_index_buffer(void* destination, size_t index_count, uint32_t index_size, const uint8_t* encoded, size_t encoded_size);
+bool decode_vertex_buffer(void* destination, size_t vertex_count, uint32_t vertex_size, const uint8_t* encoded, size_t encoded_size);
+
+// Copies every section of the mesh to `destination` + its offset, decoding the ones that are encoded. `destination`
+// needs header->upload_size bytes, and is usually mapped upload memory. Sections are decoded in parallel.
+bool copy_mesh_sections(const MeshView& mesh, void* destination);
@@ -0,0 +1,334 @@
+#include "mesh_cooker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "mesh_codec.h"
+
+namespace {
+    uint64_t align_up(const uint64_t value, const uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    struct SectionSource {
+        MeshSectionHeader header;
+        const void* data = nullptr;
+        std::vector<uint8_t> encoded;   // What goes in the file instead of `data`, if the section is encoded
+    };
+
+    template <typename T>
+    SectionSource make_section(const MeshSectionType type, const std::vector<T>& elements, const uint32_t stream_index = 0) {
+        SectionSource section;
+        section.header.type = type;
+        section.header.stream_index = stream_index;
+        section.header.element_size = sizeof(T);
+        section.header.element_count = static_cast<uint32_t>(elements.size());
+        section.header.size = sizeof(T) * elements.size();
+        section.data = elements.data();
+        return section;
+    }
+
+    template <typename T>
+    void reorder(std::vector<T>& values, const std::vector<uint32_t>& new_index) {
+        if (values.empty()) {
+            return;
+        }
+        std::vector<T> reordered(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            reordered[new_index[i]] = values[i];
+        }
+        values.swap(reordered);
+    }
+
+    template <typename T>
+    void write_attribute(std::vector<uint8_t>& stream, const uint32_t stride, const uint32_t offset, const std::vector<T>& values) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            memcpy(stream.data() + i * stride + offset, &values[i], sizeof(T));
+        }
+    }
+}
+
+MeshBounds compute_mesh_bounds(const std::vector<glm::vec3>& positions) {
+    MeshBounds bounds;
+    if (positions.empty()) {
+        return bounds;
+    }
+    glm::vec3 min = positions[0];
+    glm::vec3 max = positions[0];
+    for (const glm::vec3& position : positions) {
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    const glm::vec3 center = (min + max) * 0.5f;
+    float radius_squared = 0.0f;
+    for (const glm::vec3& position : positions) {
+        const glm::vec3 offset = position - center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        bounds.min[axis] = min[axis];
+        bounds.max[axis] = max[axis];
+        bounds.center[axis] = center[axis];
+    }
+    bounds.radius = std::sqrt(radius_squared);
+    return bounds;
+}
+
+void reorder_vertices_by_first_use(MeshSource& mesh) {
+    std::vector<uint32_t> new_index(mesh.positions.size(), UINT32_MAX);
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices) {
+        if (new_index[index] == UINT32_MAX) {
+            new_index[index] = next++;
+        }
+        index = new_index[index];
+    }
+    for (uint32_t& index : new_index) {
+        if (index == UINT32_MAX) {
+            index = next++;
+        }
+    }
+    reorder(mesh.positions, new_index);
+    reorder(mesh.normals, new_index);
+    reorder(mesh.colors, new_index);
+    reorder(mesh.texcoords, new_index);
+}
+
+void build_clustered_lod(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const float cell_size,
+                         std::vector<uint32_t>& lod_indices) {
+    lod_indices.clear();
+    if (positions.empty()) {
+        return;
+    }
+    glm::vec3 min = positions[0];
+    for (const glm::vec3& position : positions) {
+        min = glm::min(min, position);
+    }
+
+    // Sort the vertices by cell, so every cell's vertices are next to each other. 21 bits per axis is plenty,
+    // the grids we use are a lot coarser than that.
+    std::vector<std::pair<uint64_t, uint32_t>> cells(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const glm::vec3 cell = (positions[i] - min) / cell_size;
+        const uint64_t x = std::min<uint64_t>(static_cast<uint64_t>(cell.x), 0x1FFFFF);
+        const uint64_t y = std::min<uint64_t>(static_cast<uint64_t>(cell.y), 0x1FFFFF);
+        const uint64_t z = std::min<uint64_t>(static_cast<uint64_t>(cell.z), 0x1FFFFF);
+        cells[i] = { x | (y << 21) | (z << 42), static_cast<uint32_t>(i) };
+    }
+    std::sort(cells.begin(), cells.end());
+
+    // Every vertex is replaced by the vertex closest to the average of its cell
+    std::vector<uint32_t> representative(positions.size());
+    for (size_t begin = 0; begin < cells.size();) {
+        size_t end = begin + 1;
+        glm::vec3 sum = positions[cells[begin].second];
+        while (end < cells.size() && cells[end].first == cells[begin].first) {
+            sum += positions[cells[end].second];
+            end++;
+        }
+        const glm::vec3 average = sum / static_cast<float>(end - begin);
+        uint32_t best = cells[begin].second;
+        float best_distance = INFINITY;
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 offset = positions[cells[i].second] - average;
+            const float distance = glm::dot(offset, offset);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best = cells[i].second;
+            }
+        }
+        for (size_t i = begin; i < end; ++i) {
+            representative[cells[i].second] = best;
+        }
+        begin = end;
+    }
+
+    // Triangles with two corners in the same cell collapse
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const uint32_t a = representative[indices[i + 0]];
+        const uint32_t b = representative[indices[i + 1]];
+        const uint32_t c = representative[indices[i + 2]];
+        if (a != b && b != c && a != c) {
+            lod_indices.insert(lod_indices.end(), { a, b, c });
+        }
+    }
+}
+
+bool cook_mesh(const MeshSource& input, const MeshCookSettings& settings, std::vector<uint8_t>& file) {
+    file.clear();
+    const size_t vertex_count = input.positions.size();
+    if (vertex_count == 0 || vertex_count > UINT32_MAX || input.indices.size() % 3 != 0 || input.indices.size() > UINT32_MAX) {
+        printf("[ERROR] Mesh to cook has no vertices, too many, or an index count that isn't a multiple of 3\n");
+        return false;
+    }
+    if ((!input.normals.empty() && input.normals.size() != vertex_count) || (!input.colors.empty() && input.colors.size() != vertex_count)
+        || (!input.texcoords.empty() && input.texcoords.size() != vertex_count)) {
+        printf("[ERROR] Mesh to cook has vertex attributes with a different number of vertices than the positions\n");
+        return false;
+    }
+    for (const uint32_t index : input.indices) {
+        if (index >= vertex_count) {
+            printf("[ERROR] Mesh to cook has an index (%u) past the last vertex (%zu)\n", index, vertex_count - 1);
+            return false;
+        }
+    }
+
+    // Vertices in the order the triangles use them, which helps the vertex cache and the mesh codec
+    MeshSource source = input;
+    reorder_vertices_by_first_use(source);
+
+    // Vertex streams: positions on their own, the rest interleaved
+    std::vector<MeshVertexAttribute> attributes;
+    attributes.push_back({ VertexSemantic::position, 0, VertexFormat::float3, 0, 0 });
+    uint32_t stride = 0;
+    const auto add_attribute = [&](const VertexSemantic semantic, const VertexFormat format) {
+        attributes.push_back({ semantic, 0, format, 1, stride });
+        stride += vertex_format_size(format);
+    };
+    add_attribute(VertexSemantic::color, VertexFormat::float3);
+    if (!source.normals.empty()) {
+        add_attribute(VertexSemantic::normal, VertexFormat::float3);
+    }
+    if (!source.texcoords.empty()) {
+        add_attribute(VertexSemantic::texcoord, VertexFormat::float2);
+    }
+    std::vector<uint8_t> attribute_stream(vertex_count * stride);
+    if (source.colors.empty()) {
+        write_attribute(attribute_stream, stride, 0, std::vector<glm::vec3>(vertex_count, glm::vec3(1.0f)));
+    }
+    else {
+        write_attribute(attribute_stream, stride, 0, source.colors);
+    }
+    for (const MeshVertexAttribute& attribute : attributes) {
+        if (attribute.semantic == VertexSemantic::normal) {
+            write_attribute(attribute_stream, stride, attribute.offset, source.normals);
+        }
+        else if (attribute.semantic == VertexSemantic::texcoord) {
+            write_attribute(attribute_stream, stride, attribute.offset, source.texcoords);
+        }
+    }
+
+    // LODs, all in one index buffer
+    const MeshBounds bounds = compute_mesh_bounds(source.positions);
+    const float extent = std::max({ bounds.max[0] - bounds.min[0], bounds.max[1] - bounds.min[1], bounds.max[2] - bounds.min[2] });
+    std::vector<uint32_t> indices = source.indices;
+    std::vector<MeshLod> lods(1);
+    lods[0].index_count = static_cast<uint32_t>(indices.size());
+    std::vector<uint32_t> lod_indices;
+    size_t previous_triangles = indices.size() / 3;
+    for (float resolution = std::floor(std::sqrt(static_cast<float>(vertex_count))); lods.size() < settings.max_lod_count && resolution >= 2.0f
+         && previous_triangles >= settings.min_lod_triangles && extent > 0.0f; resolution = std::floor(resolution * 0.5f)) {
+        const float cell_size = extent / resolution;
+        build_clustered_lod(source.positions, source.indices, cell_size, lod_indices);
+        const size_t triangles = lod_indices.size() / 3;
+        if (triangles == 0 || static_cast<float>(triangles) > static_cast<float>(previous_triangles) * (1.0f - settings.min_lod_reduction)) {
+            continue;
+        }
+        MeshLod lod;
+        lod.first_index = static_cast<uint32_t>(indices.size());
+        lod.index_count = static_cast<uint32_t>(lod_indices.size());
+        lod.error = cell_size * std::sqrt(3.0f);
+        lods.push_back(lod);
+        indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+        previous_triangles = triangles;
+    }
+
+    // Meshlets, per LOD
+    std::vector<MeshletDesc> meshlets;
+    std::vector<uint32_t> meshlet_vertices;
+    std::vector<uint32_t> meshlet_triangles;
+    std::vector<MeshletBounds> meshlet_bounds;
+    if (settings.build_meshlets) {
+        for (MeshLod& lod : lods) {
+            lod.first_meshlet = static_cast<uint32_t>(meshlets.size());
+            build_meshlets(source.positions, indices.data() + lod.first_index, lod.index_count, settings.meshlet_cone_weight,
+                           meshlets, meshlet_vertices, meshlet_triangles);
+            lod.meshlet_count = static_cast<uint32_t>(meshlets.size()) - lod.first_meshlet;
+        }
+        for (const MeshletDesc& meshlet : meshlets) {
+            meshlet_bounds.push_back(compute_meshlet_bounds(source.positions, meshlet, meshlet_vertices, meshlet_triangles));
+        }
+    }
+
+    // 16-bit indices if they're enough
+    std::vector<uint16_t> indices_16;
+    if (vertex_count <= UINT16_MAX) {
+        indices_16.assign(indices.begin(), indices.end());
+    }
+
+    std::vector<SectionSource> sections;
+    sections.push_back(make_section(MeshSectionType::vertex_stream, source.positions, 0));
+    sections.push_back(make_section(MeshSectionType::vertex_stream, attribute_stream, 1));
+    sections.back().header.element_size = stride;
+    sections.back().header.element_count = static_cast<uint32_t>(vertex_count);
+    sections.push_back(indices_16.empty() ? make_section(MeshSectionType::indices, indices) : make_section(MeshSectionType::indices, indices_16));
+    if (settings.build_meshlets) {
+        sections.push_back(make_section(MeshSectionType::meshlets, meshlets));
+        sections.push_back(make_section(MeshSectionType::meshlet_vertices, meshlet_vertices));
+        sections.push_back(make_section(MeshSectionType::meshlet_triangles, meshlet_triangles));
+        sections.push_back(make_section(MeshSectionType::meshlet_bounds, meshlet_bounds));
+    }
+    const std::vector<MeshBounds> bounds_section = { bounds };
+    sections.push_back(make_section(MeshSectionType::bounds, bounds_section));
+    sections.push_back(make_section(MeshSectionType::lods, lods));
+
+    // Encode the sections the GPU reads, and keep the encoding only if it's smaller
+    if (settings.compress) {
+        for (SectionSource& section : sections) {
+            if (section.header.type == MeshSectionType::indices) {
+                encode_index_buffer(indices.data(), indices.size(), section.encoded);
+                section.header.encoding = MeshSectionEncoding::indices;
+            }
+            else if (section.header.type == MeshSectionType::vertex_stream || section.header.type == MeshSectionType::meshlet_vertices
+                     || section.header.type == MeshSectionType::meshlet_triangles) {
+                encode_vertex_buffer(section.data, section.header.element_count, section.header.element_size, section.encoded);
+                section.header.encoding = MeshSectionEncoding::vertices;
+            }
+            if (section.encoded.size() >= section.header.size) {
+                section.encoded.clear();
+                section.header.encoding = MeshSectionEncoding::none;
+            }
+        }
+    }
+
+    // Lay out the file and upload memory: the tables, then every section at the next aligned offset
+    MeshFileHeader header;
+    header.section_count = static_cast<uint32_t>(sections.size());
+    header.attribute_count = static_cast<uint32_t>(attributes.size());
+    header.vertex_count = static_cast<uint32_t>(vertex_count);
+    header.lod_count = static_cast<uint32_t>(lods.size());
+    const uint64_t tables_size = sizeof(MeshFileHeader) + sections.size() * sizeof(MeshSectionHeader) + attributes.size() * sizeof(MeshVertexAttribute);
+    uint64_t offset = tables_size;
+    uint64_t file_offset = tables_size;
+    for (SectionSource& section : sections) {
+        const bool encoded = section.header.encoding != MeshSectionEncoding::none;
+        offset = align_up(offset, mesh_section_alignment);
+        file_offset = align_up(file_offset, mesh_section_alignment);
+        section.header.offset = offset;
+        section.header.file_offset = file_offset;
+        section.header.file_size = encoded ? section.encoded.size() : section.header.size;
+        offset += section.header.size;
+        file_offset += section.header.file_size;
+    }
+    header.upload_size = align_up(offset, mesh_section_alignment);
+    header.file_size = align_up(file_offset, mesh_section_alignment);
+
+    file.assign(static_cast<size_t>(header.file_size), 0);
+    uint8_t* output = file.data();
+    memcpy(output, &header, sizeof(header));
+    output += sizeof(header);
+    for (const SectionSource& section : sections) {
+        memcpy(output, &section.header, sizeof(MeshSectionHeader));
+        output += sizeof(MeshSectionHeader);
+    }
+    memcpy(output, attributes.data(), attributes.size() * sizeof(MeshVertexAttribute));
+    for (const SectionSource& section : sections) {
+        const void* data = section.header.encoding != MeshSectionEncoding::none ? section.encoded.data() : section.data;
+        if (section.header.file_size > 0) {
+            memcpy(file.data() + section.header.file_offset, data, static_cast<size_t>(section.header.file_size));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "mesh_format.h"
+#include "meshlet_builder.h"
+
+/* MESH COOKER
+* Turns imported geometry into a mesh file (see mesh_format.h). All the work that would otherwise happen at load
+* time happens here, once: choosing the index size, splitting the attributes into vertex streams, building the
+* LODs, the meshlets and the bounds.
+*
+* The positions get a vertex stream of their own, so passes that only need positions (depth, shadows, culling)
+* read a third of the memory. All other attributes are interleaved in the second stream.
+*
+* LODs are made with vertex clustering: the bounding box is divided into a grid, all vertices in a cell are merged
+* into the one closest to the cell's average, and triangles that collapse are dropped. The merged vertices are
+* existing vertices, so all LODs share the vertex streams and only have their own indices. Every LOD uses a grid
+* with half the resolution of the one before, and we stop when a LOD doesn't remove enough triangles anymore.
+* This doesn't look as good as edge collapse simplification, but it's fast and it works on any triangle soup.
+*
+* Every LOD gets its own meshlets (see meshlet_builder.h), each with a bounding sphere and a normal cone.
+*
+* Vertices are stored in the order the triangles first use them. With compression on, the indices, the vertex
+* streams and the meshlet vertices and triangles are encoded (see mesh_codec.h), unless that doesn't make them smaller.
+*/
+
+struct MeshSource {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;     // Empty, or one per position
+    std::vector<glm::vec3> colors;      // Empty means white, like a glTF primitive without COLOR_0
+    std::vector<glm::vec2> texcoords;   // Empty, or one per position
+    std::vector<uint32_t> indices;      // Triangle list
+};
+
+struct MeshCookSettings {
+    uint32_t max_lod_count = 4;
+    float min_lod_reduction = 0.25f;    // A LOD has to have at least this much fewer triangles than the one before
+    uint32_t min_lod_triangles = 64;    // No more LODs are made once a LOD has fewer triangles than this
+    bool build_meshlets = true;
+    float meshlet_cone_weight = meshlet_default_cone_weight;
+    bool compress = true;
+};
+
+// Returns false and prints an error if the source isn't valid
+bool cook_mesh(const MeshSource& source, const MeshCookSettings& settings, std::vector<uint8_t>& file);
+
+// Building blocks, exposed for tools that want to look at the results before writing a file
+void reorder_vertices_by_first_use(MeshSource& mesh);
+void build_clustered_lod(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, float cell_size,
+                         std::vector<uint32_t>& lod_indices);
+MeshBounds compute_mesh_bounds(const std::vector<glm::vec3>& positions);
@@ -0,0 +1,142 @@
+#include "mesh_format.h"
+#include <cstdio>
+
+uint32_t vertex_format_size(const VertexFormat format) {
+    switch (format) {
+        case VertexFormat::float2: return 8;
+        case VertexFormat::float3: return 12;
+        case VertexFormat::float4: return 16;
+        case VertexFormat::unorm8x4: return 4;
+    }
+    return 0;
+}
+
+const char* vertex_semantic_name(const VertexSemantic semantic) {
+    switch (semantic) {
+        case VertexSemantic::position: return "POSITION";
+        case VertexSemantic::normal: return "NORMAL";
+        case VertexSemantic::color: return "COLOR";
+        case VertexSemantic::texcoord: return "TEXCOORD";
+    }
+    return "";
+}
+
+const MeshSectionHeader* MeshView::find_section(const MeshSectionType type, const uint32_t stream_index) const {
+    for (uint32_t i = 0; i < header->section_count; ++i) {
+        if (sections[i].type == type && (type != MeshSectionType::vertex_stream || sections[i].stream_index == stream_index)) {
+            return &sections[i];
+        }
+    }
+    return nullptr;
+}
+
+bool open_mesh_view(const void* data, const size_t size, MeshView& view) {
+    view = {};
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (!bytes || size < sizeof(MeshFileHeader)) {
+        printf("[ERROR] Mesh file is too small\n");
+        return false;
+    }
+    const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(bytes);
+    if (header->magic != mesh_file_magic) {
+        printf("[ERROR] Not a mesh file\n");
+        return false;
+    }
+    if (header->version != mesh_file_version) {
+        printf("[ERROR] Mesh file has version %u, expected %u, it has to be cooked again\n", header->version, mesh_file_version);
+        return false;
+    }
+    if (header->file_size != size) {
+        printf("[ERROR] Mesh file should be %llu bytes, but it's %zu bytes\n", static_cast<unsigned long long>(header->file_size), size);
+        return false;
+    }
+    const uint64_t tables_size = sizeof(MeshFileHeader) + uint64_t(header->section_count) * sizeof(MeshSectionHeader)
+        + uint64_t(header->attribute_count) * sizeof(MeshVertexAttribute);
+    if (tables_size > size) {
+        printf("[ERROR] Mesh file's section table doesn't fit in the file\n");
+        return false;
+    }
+
+    const MeshSectionHeader* sections = reinterpret_cast<const MeshSectionHeader*>(bytes + sizeof(MeshFileHeader));
+    for (uint32_t i = 0; i < header->section_count; ++i) {
+        const MeshSectionHeader& section = sections[i];
+        if (section.file_offset % mesh_section_alignment != 0 || section.file_offset < tables_size || section.file_offset > size
+            || section.file_size > size - section.file_offset) {
+            printf("[ERROR] Mesh file section %u is outside the file or not aligned\n", i);
+            return false;
+        }
+        if (section.offset % mesh_section_alignment != 0 || section.offset > header->upload_size || section.size > header->upload_size - section.offset) {
+            printf("[ERROR] Mesh file section %u is outside upload memory or not aligned\n", i);
+            return false;
+        }
+        if (uint64_t(section.element_size) * section.element_count != section.size) {
+            printf("[ERROR] Mesh file section %u has the wrong size for its elements\n", i);
+            return false;
+        }
+        // Indices can only use the index codec, and the sections the CPU reads can't be encoded at all
+        bool valid_encoding = section.file_size == section.size;
+        if (section.encoding == MeshSectionEncoding::indices) {
+            valid_encoding = section.type == MeshSectionType::indices && (section.element_size == 2 || section.element_size == 4) && section.element_count % 3 == 0;
+        }
+        else if (section.encoding == MeshSectionEncoding::vertices) {
+            valid_encoding = (section.type == MeshSectionType::vertex_stream || section.type == MeshSectionType::meshlet_vertices
+                || section.type == MeshSectionType::meshlet_triangles) && section.element_size % 4 == 0 && section.element_size <= 256;
+        }
+        else if (section.encoding != MeshSectionEncoding::none) {
+            valid_encoding = false;
+        }
+        if (!valid_encoding) {
+            printf("[ERROR] Mesh file section %u has an encoding it can't have\n", i);
+            return false;
+        }
+    }
+
+    view.data = bytes;
+    view.size = size;
+    view.header = header;
+    view.sections = sections;
+    view.attributes = reinterpret_cast<const MeshVertexAttribute*>(sections + header->section_count);
+    for (uint32_t i = 0; i < header->attribute_count; ++i) {
+        const MeshSectionHeader* stream = view.find_section(MeshSectionType::vertex_stream, view.attributes[i].stream_index);
+        if (!stream || view.attributes[i].offset + vertex_format_size(view.attributes[i].format) > stream->element_size) {
+            printf("[ERROR] Mesh file vertex attribute %u is outside its vertex stream\n", i);
+            view = {};
+            return false;
+        }
+    }
+
+    // The sections the CPU reads have to have the struct they're read as, and every mesh needs indices and a LOD
+    const MeshSectionHeader* indices = view.find_section(MeshSectionType::indices);
+    const MeshSectionHeader* lods = view.find_section(MeshSectionType::lods);
+    const MeshSectionHeader* bounds = view.find_section(MeshSectionType::bounds);
+    const MeshSectionHeader* meshlets = view.find_section(MeshSectionType::meshlets);
+    const MeshSectionHeader* meshlet_bounds = view.find_section(MeshSectionType::meshlet_bounds);
+    if (!indices || indices->element_count == 0 || (indices->element_size != 2 && indices->element_size != 4)) {
+        printf("[ERROR] Mesh file has no indices\n");
+        view = {};
+        return false;
+    }
+    if (!lods || lods->element_count == 0 || lods->element_count != header->lod_count || lods->element_size != sizeof(MeshLod)) {
+        printf("[ERROR] Mesh file has no LODs, or they don't match the header\n");
+        view = {};
+        return false;
+    }
+    if ((bounds && (bounds->element_count != 1 || bounds->element_size != sizeof(MeshBounds)))
+        || (meshlets && meshlets->element_size != sizeof(MeshletDesc))
+        || (meshlet_bounds && (meshlet_bounds->element_size != sizeof(MeshletBounds) || !meshlets || meshlet_bounds->element_count != meshlets->element_count))) {
+        printf("[ERROR] Mesh file has bounds or meshlets of the wrong size\n");
+        view = {};
+        return false;
+    }
+    const MeshLod* lod_data = view.section_data<MeshLod>(*lods);
+    const uint32_t meshlet_count = meshlets ? meshlets->element_count : 0;
+    for (uint32_t i = 0; i < lods->element_count; ++i) {
+        if (uint64_t(lod_data[i].first_index) + lod_data[i].index_count > indices->element_count
+            || uint64_t(lod_data[i].first_meshlet) + lod_data[i].meshlet_count > meshlet_count) {
+            printf("[ERROR] Mesh file LOD %u is outside the indices or meshlets\n", i);
+            view = {};
+            return false;
+        }
+    }
+    return true;
+}
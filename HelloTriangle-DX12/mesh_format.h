@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/* MESH FILES
+* A mesh file is already in the layout the GPU wants, so loading it is mapping the file and copying sections into
+* upload memory, with no parsing in between. It starts with a header, the section table and the vertex attribute
+* table, followed by the sections:
+* - Vertex streams: one buffer per stream, interleaved attributes, ready to bind with IASetVertexBuffers
+* - Indices: 16-bit if all vertices can be reached with them, 32-bit otherwise, all LODs after each other
+* - Meshlets, meshlet vertices, meshlet triangles and meshlet bounds, for mesh-shader-style rendering
+* - Bounds: an axis-aligned box and a bounding sphere around the whole mesh
+* - LODs: for every level of detail, its range in the index buffer and in the meshlets
+*
+* Every section starts at a multiple of 256 bytes from the start of the file, and the file is padded to a multiple
+* of 256 bytes too. That's the largest alignment D3D12 asks for buffer data (constant buffers), so a section can be
+* copied to the same offset in an upload buffer as one block, or the file can be copied into the upload buffer as a
+* whole, and every section is correctly aligned in it. All values are little-endian.
+*
+* Sections can also be encoded (see mesh_codec.h), which makes the file smaller, but then they have to be decoded
+* into upload memory instead of copied. Every section has two places: `file_offset` and `file_size` say where its
+* bytes are in the file, `offset` and `size` say where it goes in upload memory once it's decoded. For a section
+* that isn't encoded they're the same, so a file without encoded sections can still be copied as a whole.
+* Sections the CPU reads (bounds, LODs, meshlets and meshlet bounds) are never encoded.
+*
+* The version is increased whenever the layout changes. There's no backwards compatibility, old files have to be
+* cooked again.
+*/
+
+constexpr uint32_t mesh_file_magic = 0x48534D48; // "HMSH"
+constexpr uint32_t mesh_file_version = 3;
+constexpr uint64_t mesh_section_alignment = 256;
+
+// The meshlet size limits, the same as recommended for D3D12 mesh shaders
+constexpr uint32_t meshlet_max_vertices = 64;
+constexpr uint32_t meshlet_max_triangles = 124;
+
+enum class MeshSectionType : uint32_t {
+    vertex_stream = 1,      // stream_index says which one
+    indices = 2,            // element_size is 2 or 4
+    meshlets = 3,           // MeshletDesc
+    meshlet_vertices = 4,   // uint32_t, indices into the vertex streams
+    meshlet_triangles = 5,  // uint32_t, 3 10-bit indices into the meshlet's vertices, see pack_meshlet_triangle()
+    bounds = 6,             // One MeshBounds
+    lods = 7,               // MeshLod, the most detailed one first
+    meshlet_bounds = 8,     // MeshletBounds, one per meshlet
+};
+
+enum class MeshSectionEncoding : uint32_t {
+    none = 0,
+    indices = 1,            // encode_index_buffer(), element_size is the index size
+    vertices = 2,           // encode_vertex_buffer(), element_size is the vertex size
+};
+
+enum class VertexSemantic : uint8_t {
+    position = 0,
+    normal = 1,
+    color = 2,
+    texcoord = 3,
+};
+
+enum class VertexFormat : uint8_t {
+    float2 = 0,     // DXGI_FORMAT_R32G32_FLOAT
+    float3 = 1,     // DXGI_FORMAT_R32G32B32_FLOAT
+    float4 = 2,     // DXGI_FORMAT_R32G32B32A32_FLOAT
+    unorm8x4 = 3,   // DXGI_FORMAT_R8G8B8A8_UNORM
+};
+
+uint32_t vertex_format_size(VertexFormat format);
+
+// The HLSL semantic name for a vertex semantic, e.g. "POSITION"
+const char* vertex_semantic_name(VertexSemantic semantic);
+
+struct MeshFileHeader {
+    uint32_t magic = mesh_file_magic;
+    uint32_t version = mesh_file_version;
+    uint64_t file_size = 0;
+    uint32_t section_count = 0;
+    uint32_t attribute_count = 0;
+    uint32_t vertex_count = 0;
+    uint32_t lod_count = 0;
+    uint64_t upload_size = 0;   // How much upload memory the decoded sections need, the same as file_size without encoded sections
+    uint32_t reserved[6] = {};
+};
+static_assert(sizeof(MeshFileHeader) == 64, "The mesh file header has a fixed size");
+
+struct MeshSectionHeader {
+    MeshSectionType type = MeshSectionType::vertex_stream;
+    uint32_t stream_index = 0;  // For vertex streams
+    uint64_t offset = 0;        // From the start of upload memory, a multiple of mesh_section_alignment
+    uint64_t size = 0;          // In bytes once decoded, without the padding after it
+    uint32_t element_size = 0;  // Vertex stride, index size, or the size of the struct in the section
+    uint32_t element_count = 0;
+    uint64_t file_offset = 0;   // From the start of the file, a multiple of mesh_section_alignment
+    uint64_t file_size = 0;     // In bytes as stored in the file
+    MeshSectionEncoding encoding = MeshSectionEncoding::none;
+    uint32_t reserved[3] = {};
+};
+static_assert(sizeof(MeshSectionHeader) == 64, "The mesh section header has a fixed size");
+
+// Like D3D12_INPUT_ELEMENT_DESC, without the names
+struct MeshVertexAttribute {
+    VertexSemantic semantic = VertexSemantic::position;
+    uint8_t semantic_index = 0;
+    VertexFormat format = VertexFormat::float3;
+    uint8_t stream_index = 0;
+    uint32_t offset = 0;        // In the stream's vertices
+};
+static_assert(sizeof(MeshVertexAttribute) == 8, "The mesh vertex attribute has a fixed size");
+
+struct MeshletDesc {
+    uint32_t vertex_offset = 0;     // Into the meshlet vertices
+    uint32_t triangle_offset = 0;   // Into the meshlet triangles
+    uint32_t vertex_count = 0;
+    uint32_t triangle_count = 0;
+};
+
+/* MESHLET BOUNDS
+* What a culler needs to know about a meshlet, in 20 bytes, so a compute or amplification shader can test a
+* meshlet with a single StructuredBuffer load.
+* The normal cone is quantized to signed bytes (value / 127): the axis is the average direction the triangles face,
+* and the cutoff is the sine of the largest angle between the axis and a triangle normal. The cutoff is rounded up
+* far enough to cover the rounding of the axis, so a test with the quantized values never culls a visible meshlet.
+* The meshlet faces away from a camera at `camera` if
+*     dot(center - camera, axis) >= cutoff * length(center - camera) + radius
+* Front faces are counter-clockwise, like in glTF. A cutoff of 127 means the cone can't cull the meshlet.
+*/
+struct MeshletBounds {
+    float center[3] = {};
+    float radius = 0.0f;
+    int8_t cone_axis[3] = {};
+    int8_t cone_cutoff = 127;
+};
+static_assert(sizeof(MeshletBounds) == 20, "Meshlet bounds are packed for the GPU");
+
+struct MeshBounds {
+    float min[3] = {};
+    float max[3] = {};
+    float center[3] = {};
+    float radius = 0.0f;
+};
+
+struct MeshLod {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    uint32_t first_meshlet = 0;
+    uint32_t meshlet_count = 0;
+    float error = 0.0f;         // How far vertices may have moved compared to LOD 0, in mesh units
+    uint32_t reserved[3] = {};
+};
+
+inline uint32_t pack_meshlet_triangle(const uint32_t a, const uint32_t b, const uint32_t c) {
+    return a | (b << 10) | (c << 20);
+}
+
+inline void unpack_meshlet_triangle(const uint32_t packed, uint32_t& a, uint32_t& b, uint32_t& c) {
+    a = packed & 0x3FF;
+    b = (packed >> 10) & 0x3FF;
+    c = (packed >> 20) & 0x3FF;
+}
+
+// A validated mesh file, pointing into its memory. The memory has to stay alive (and mapped) while it's used.
+struct MeshView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const MeshFileHeader* header = nullptr;
+    const MeshSectionHeader* sections = nullptr;
+    const MeshVertexAttribute* attributes = nullptr;
+
+    // Returns nullptr if there is no such section
+    const MeshSectionHeader* find_section(MeshSectionType type, uint32_t stream_index = 0) const;
+
+    // Only for sections that aren't encoded, encoded ones have to be decoded first (see copy_mesh_sections())
+    template <typename T>
+    const T* section_data(const MeshSectionHeader& section) const {
+        return reinterpret_cast<const T*>(data + section.file_offset);
+    }
+};
+
+// Checks the header, that every section is inside the file and aligned, that there are indices and LODs, that the
+// sections the CPU reads have the size of their struct, and that the LODs are inside the indices and meshlets.
+// Doesn't look at the contents of the other sections.
+// Prints an error and returns false if the file isn't valid.
+bool open_mesh_view(const void* data, size_t size, MeshView& view);
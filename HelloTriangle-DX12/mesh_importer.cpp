@@ -0,0 +1,1238 @@
+#include "mesh_importer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "file_io.h"
+#include "json.h"
+#include "parallel_for.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_IMPORTER_SSE2 1
+#include <emmintrin.h>
+#else
+#define MESH_IMPORTER_SSE2 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    using ImportClock = std::chrono::steady_clock;
+
+    constexpr uint32_t no_index = UINT32_MAX;
+
+    unsigned count_trailing_zeros(const uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    /* NUMBER PARSING
+    * OBJ files are mostly numbers, and strtod is slow: it handles locales, hex floats and arbitrary precision.
+    * The numbers in OBJ files are short decimals, so we find the digit runs with one SSE2 compare per 16 bytes,
+    * and turn up to 8 digits at a time into an integer with three multiplies in a 64-bit register. A mantissa
+    * of up to 15 digits is exact in a double, and so are powers of 10 up to 1e22, so one multiply or divide
+    * gives a correctly rounded double. Anything else (long mantissas, big exponents, inf and nan, the end of the
+    * file) goes to strtod.
+    */
+
+    // Number of digits at p, up to 16. The 16 bytes at p have to be readable.
+    unsigned count_digits16(const char* p) {
+#if MESH_IMPORTER_SSE2
+        // Shift '0' to -128, so the digits are the only bytes below -118 in a signed compare
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(0x80 - '0')));
+        const uint32_t digits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + 10)))));
+        return count_trailing_zeros(~digits); // Bit 16 is always set in ~digits
+#else
+        unsigned count = 0;
+        while (count < 16 && p[count] >= '0' && p[count] <= '9') {
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    // Value of the `count` (at most 8) digits at p. The 8 bytes at p have to be readable.
+    uint32_t parse_digits8(const char* p, const unsigned count) {
+        if (count == 0) {
+            return 0;
+        }
+        // The first digit ends up in the lowest byte. Shifting left drops the bytes after the digits, and the zeros
+        // that come in at the bottom are leading zeros. Then pairs of digits are combined, then pairs of those.
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        value = (value & 0x0F0F0F0F0F0F0F0Full) << (8 * (8 - count));
+        value = (value * 2561) >> 8;
+        value = ((value & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+        return static_cast<uint32_t>(((value & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+    }
+
+    uint64_t parse_digits16(const char* p, const unsigned count) {
+        if (count <= 8) {
+            return parse_digits8(p, count);
+        }
+        return static_cast<uint64_t>(parse_digits8(p, count - 8)) * 100000000ull + parse_digits8(p + count - 8, 8);
+    }
+
+    bool is_separator(const char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    // For everything the fast path doesn't handle
+    const char* parse_float_slow(const char* p, const char* line_end, float& value) {
+        char buffer[64];
+        size_t length = 0;
+        while (p + length < line_end && length < sizeof(buffer) - 1 && !is_separator(p[length]) && p[length] != '\r') {
+            buffer[length] = p[length];
+            ++length;
+        }
+        buffer[length] = '\0';
+        char* parsed_end;
+        value = strtof(buffer, &parsed_end);
+        return parsed_end == buffer ? nullptr : p + (parsed_end - buffer);
+    }
+
+    // Parses a float, skipping separators first. Returns nullptr if there is no number before the end of the line.
+    const char* parse_float(const char* p, const char* line_end, const char* file_end, float& value) {
+        while (p < line_end && is_separator(*p)) {
+            ++p;
+        }
+        if (p == line_end) {
+            return nullptr;
+        }
+        // The fast path reads up to 48 bytes past the start of the number
+        if (file_end - p < 48) {
+            return parse_float_slow(p, line_end, value);
+        }
+        const char* start = p;
+        const bool negative = *p == '-';
+        if (*p == '-' || *p == '+') {
+            ++p;
+        }
+        const unsigned integer_digits = count_digits16(p);
+        const char* fraction = p + integer_digits;
+        unsigned fraction_digits = 0;
+        if (*fraction == '.') {
+            ++fraction;
+            fraction_digits = count_digits16(fraction);
+        }
+        const unsigned digits = integer_digits + fraction_digits;
+        if (digits == 0 || digits > 15) {
+            return parse_float_slow(start, line_end, value);
+        }
+        static const uint64_t integer_powers_of_10[16] = {
+            1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+            10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull, 1000000000000000ull,
+        };
+        const uint64_t mantissa = parse_digits16(p, integer_digits) * integer_powers_of_10[fraction_digits] + parse_digits16(fraction, fraction_digits);
+        p = fraction + fraction_digits;
+
+        int exponent = -static_cast<int>(fraction_digits);
+        if (*p == 'e' || *p == 'E') {
+            const char* exponent_start = p + 1;
+            const bool exponent_negative = *exponent_start == '-';
+            if (*exponent_start == '-' || *exponent_start == '+') {
+                ++exponent_start;
+            }
+            const unsigned exponent_digits = count_digits16(exponent_start);
+            if (exponent_digits == 0 || exponent_digits > 3) {
+                return parse_float_slow(start, line_end, value);
+            }
+            const int exponent_value = static_cast<int>(parse_digits8(exponent_start, exponent_digits));
+            exponent += exponent_negative ? -exponent_value : exponent_value;
+            p = exponent_start + exponent_digits;
+        }
+        if (exponent < -22 || exponent > 22) {
+            return parse_float_slow(start, line_end, value);
+        }
+
+        static const double powers_of_10[23] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+        double result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / powers_of_10[-exponent] : result * powers_of_10[exponent];
+        value = static_cast<float>(negative ? -result : result);
+        return p;
+    }
+
+    // Parses a signed integer without skipping anything first. Returns nullptr if there is no number.
+    const char* parse_int(const char* p, const char* line_end, const char* file_end, int64_t& value) {
+        const bool negative = p < line_end && *p == '-';
+        if (negative) {
+            ++p;
+        }
+        uint64_t magnitude = 0;
+        const char* digits_start = p;
+        if (file_end - p >= 16) {
+            const unsigned digits = count_digits16(p);
+            if (digits > 15) {
+                return nullptr;
+            }
+            magnitude = parse_digits16(p, digits);
+            p += digits;
+        }
+        else {
+            while (p < line_end && *p >= '0' && *p <= '9' && p - digits_start < 15) {
+                magnitude = magnitude * 10 + static_cast<uint64_t>(*p++ - '0');
+            }
+        }
+        if (p == digits_start) {
+            return nullptr;
+        }
+        value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+        return p;
+    }
+
+    /* OBJ CHUNKS
+    * Every chunk is parsed on its own, so while parsing, a chunk only knows how many elements it has itself.
+    * Face indices are 1-based from the start of the file, or negative and relative to the last element before
+    * the face. Relative ones are stored relative to the start of the chunk, and get fixed up once the chunks
+    * know where they start.
+    */
+    struct ObjCorner {
+        uint32_t position = no_index;
+        uint32_t texcoord = no_index;
+        uint32_t normal = no_index;
+    };
+
+    struct ObjGroup {
+        size_t first_corner = 0;
+        std::string name;
+    };
+
+    struct ObjChunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colors;           // Empty if no position in the chunk has a color
+        std::vector<glm::vec2> texcoords;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners;          // Three per triangle
+        std::vector<size_t> relative_indices;    // Index components (corner * 3 + component) that are relative
+        std::vector<ObjGroup> groups;
+
+        // Where the chunk's elements start in the whole file
+        size_t first_position = 0;
+        size_t first_texcoord = 0;
+        size_t first_normal = 0;
+        size_t first_corner = 0;
+
+        const char* error = nullptr;
+        const char* error_position = nullptr;
+    };
+
+    bool fail_chunk(ObjChunk& chunk, const char* position, const char* message) {
+        chunk.error = message;
+        chunk.error_position = position;
+        return false;
+    }
+
+    // Parses one face corner: v, v/vt, v//vn or v/vt/vn
+    const char* parse_obj_corner(ObjChunk& chunk, const char* p, const char* line_end, const char* file_end, ObjCorner& corner, uint8_t& relative) {
+        const size_t counts[3] = { chunk.positions.size(), chunk.texcoords.size(), chunk.normals.size() };
+        uint32_t* components[3] = { &corner.position, &corner.texcoord, &corner.normal };
+        relative = 0;
+        for (int component = 0; component < 3; ++component) {
+            if (component > 0) {
+                if (p == line_end || *p != '/') {
+                    break;
+                }
+                ++p;
+                if (component == 1 && p < line_end && *p == '/') {
+                    continue;
+                }
+            }
+            int64_t index;
+            p = parse_int(p, line_end, file_end, index);
+            if (!p || index == 0 || index > UINT32_MAX || index < -static_cast<int64_t>(UINT32_MAX)) {
+                return nullptr;
+            }
+            if (index > 0) {
+                *components[component] = static_cast<uint32_t>(index - 1);
+            }
+            else {
+                // Relative to the chunk start, this wraps around if it points into an earlier chunk
+                *components[component] = static_cast<uint32_t>(static_cast<int64_t>(counts[component]) + index);
+                relative |= 1 << component;
+            }
+        }
+        return p;
+    }
+
+    bool parse_obj_chunk(ObjChunk& chunk, const char* file_end) {
+        std::vector<ObjCorner> polygon;
+        std::vector<uint8_t> polygon_relative;
+        const char* line = chunk.begin;
+        while (line < chunk.end) {
+            const char* line_end = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(chunk.end - line)));
+            line_end = line_end ? line_end : chunk.end;
+            const char* p = line;
+            line = line_end + 1;
+            while (p < line_end && is_separator(*p)) {
+                ++p;
+            }
+            if (line_end - p < 2) {
+                continue;
+            }
+
+            if (p[0] == 'v' && is_separator(p[1])) {
+                glm::vec3 position;
+                p += 1;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (!(p = parse_float(p, line_end, file_end, position[axis]))) {
+                        return fail_chunk(chunk, line_end, "Vertex position needs 3 numbers");
+                    }
+                }
+                chunk.positions.push_back(position);
+
+                // Some tools put a vertex color after the position
+                glm::vec3 color;
+                const char* color_end = parse_float(p, line_end, file_end, color.r);
+                if (color_end && (color_end = parse_float(color_end, line_end, file_end, color.g)) && parse_float(color_end, line_end, file_end, color.b)) {
+                    chunk.colors.resize(chunk.positions.size() - 1, glm::vec3(1.0f));
+                    chunk.colors.push_back(color);
+                }
+            }
+            else if (p[0] == 'v' && p[1] == 't' && line_end - p > 2 && is_separator(p[2])) {
+                glm::vec2 texcoord;
+                p += 2;
+                if (!(p = parse_float(p, line_end, file_end, texcoord.x))) {
+                    return fail_chunk(chunk, line_end, "Texture coordinate needs at least 1 number");
+                }
+                if (!parse_float(p, line_end, file_end, texcoord.y)) {
+                    texcoord.y = 0.0f;
+                }
+                chunk.texcoords.emplace_back(texcoord.x, 1.0f - texcoord.y);
+            }
+            else if (p[0] == 'v' && p[1] == 'n' && line_end - p > 2 && is_separator(p[2])) {
+                glm::vec3 normal;
+                p += 2;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (!(p = parse_float(p, line_end, file_end, normal[axis]))) {
+                        return fail_chunk(chunk, line_end, "Vertex normal needs 3 numbers");
+                    }
+                }
+                chunk.normals.push_back(normal);
+            }
+            else if (p[0] == 'f' && is_separator(p[1])) {
+                polygon.clear();
+                polygon_relative.clear();
+                p += 1;
+                while (true) {
+                    while (p < line_end && is_separator(*p)) {
+                        ++p;
+                    }
+                    if (p == line_end || *p == '\r' || *p == '#') {
+                        break;
+                    }
+                    ObjCorner corner;
+                    uint8_t relative;
+                    if (!(p = parse_obj_corner(chunk, p, line_end, file_end, corner, relative))) {
+                        return fail_chunk(chunk, line_end, "Invalid face index");
+                    }
+                    polygon.push_back(corner);
+                    polygon_relative.push_back(relative);
+                }
+                if (polygon.size() < 3) {
+                    return fail_chunk(chunk, line_end, "Face needs at least 3 vertices");
+                }
+
+                // Polygons become triangle fans
+                for (size_t i = 2; i < polygon.size(); ++i) {
+                    for (const size_t corner : { size_t(0), i - 1, i }) {
+                        for (int component = 0; component < 3; ++component) {
+                            if (polygon_relative[corner] & (1 << component)) {
+                                chunk.relative_indices.push_back(chunk.corners.size() * 3 + component);
+                            }
+                        }
+                        chunk.corners.push_back(polygon[corner]);
+                    }
+                }
+            }
+            else if ((p[0] == 'o' || p[0] == 'g') && is_separator(p[1])) {
+                const char* name_begin = p + 2;
+                const char* name_end = line_end;
+                while (name_begin < name_end && is_separator(*name_begin)) {
+                    ++name_begin;
+                }
+                while (name_end > name_begin && (is_separator(name_end[-1]) || name_end[-1] == '\r')) {
+                    --name_end;
+                }
+                chunk.groups.push_back({ chunk.corners.size(), std::string(name_begin, name_end) });
+            }
+            // Everything else (comments, materials, smoothing groups, lines, points) is skipped
+        }
+        if (!chunk.colors.empty()) {
+            chunk.colors.resize(chunk.positions.size(), glm::vec3(1.0f));
+        }
+        return true;
+    }
+
+    // Turns a group's corners into indexed vertices, corners that use the same position, texcoord and normal
+    // become the same vertex
+    void build_obj_mesh(const ObjCorner* corners, const size_t corner_count, const std::vector<glm::vec3>& positions,
+                        const std::vector<glm::vec3>& colors, const std::vector<glm::vec2>& texcoords,
+                        const std::vector<glm::vec3>& normals, MeshSource& mesh) {
+        uint32_t min_position = UINT32_MAX;
+        uint32_t max_position = 0;
+        bool has_texcoords = false;
+        bool has_normals = false;
+        for (size_t i = 0; i < corner_count; ++i) {
+            min_position = std::min(min_position, corners[i].position);
+            max_position = std::max(max_position, corners[i].position);
+            has_texcoords |= corners[i].texcoord != no_index;
+            has_normals |= corners[i].normal != no_index;
+        }
+
+        // Vertices are found by position first, then by walking the list of vertices with that position.
+        // Groups usually use a compact range of positions, so this is a flat array instead of a hash map.
+        struct VertexKey {
+            uint32_t texcoord;
+            uint32_t normal;
+            uint32_t next;
+        };
+        std::vector<uint32_t> first_vertex(static_cast<size_t>(max_position - min_position) + 1, no_index);
+        std::vector<VertexKey> vertex_keys;
+        vertex_keys.reserve(corner_count / 4);
+        mesh.indices.resize(corner_count);
+        for (size_t i = 0; i < corner_count; ++i) {
+            const ObjCorner& corner = corners[i];
+            uint32_t& head = first_vertex[corner.position - min_position];
+            uint32_t vertex = head;
+            while (vertex != no_index && (vertex_keys[vertex].texcoord != corner.texcoord || vertex_keys[vertex].normal != corner.normal)) {
+                vertex = vertex_keys[vertex].next;
+            }
+            if (vertex == no_index) {
+                vertex = static_cast<uint32_t>(mesh.positions.size());
+                vertex_keys.push_back({ corner.texcoord, corner.normal, head });
+                head = vertex;
+                mesh.positions.push_back(positions[corner.position]);
+                if (!colors.empty()) {
+                    mesh.colors.push_back(colors[corner.position]);
+                }
+                if (has_texcoords) {
+                    mesh.texcoords.push_back(corner.texcoord != no_index ? texcoords[corner.texcoord] : glm::vec2(0.0f));
+                }
+                if (has_normals) {
+                    mesh.normals.push_back(corner.normal != no_index ? normals[corner.normal] : glm::vec3(0.0f));
+                }
+            }
+            mesh.indices[i] = vertex;
+        }
+    }
+
+    void fill_stats(ImportStats* stats, const ImportedScene& scene, const size_t input_bytes, const ImportClock::time_point start) {
+        if (!stats) {
+            return;
+        }
+        stats->input_bytes = input_bytes;
+        stats->import_seconds = std::chrono::duration<double>(ImportClock::now() - start).count();
+        stats->vertex_count = 0;
+        stats->triangle_count = 0;
+        for (const MeshSource& mesh : scene.meshes) {
+            stats->vertex_count += mesh.positions.size();
+            stats->triangle_count += mesh.indices.size() / 3;
+        }
+    }
+
+    /* GLTF BUFFERS
+    * Buffers are the GLB binary chunk, a data URI, or a file next to the .gltf, which gets mapped too.
+    * Accessors are checked against their buffer view and buffer before anything reads them.
+    */
+    struct GltfBuffer {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct GltfBufferView {
+        uint32_t buffer = 0;
+        size_t offset = 0;
+        size_t size = 0;
+        size_t stride = 0;                  // 0 means tightly packed
+    };
+
+    struct GltfAccessor {
+        const uint8_t* data = nullptr;      // nullptr if there is no buffer view, then everything is zero
+        size_t stride = 0;
+        size_t count = 0;
+        uint32_t component_type = 0;
+        uint32_t component_count = 0;
+        bool normalized = false;
+    };
+
+    enum GltfComponentType : uint32_t {
+        gltf_int8 = 5120,
+        gltf_uint8 = 5121,
+        gltf_int16 = 5122,
+        gltf_uint16 = 5123,
+        gltf_uint32 = 5125,
+        gltf_float = 5126,
+    };
+
+    uint32_t gltf_component_size(const uint32_t component_type) {
+        switch (component_type) {
+            case gltf_int8: case gltf_uint8: return 1;
+            case gltf_int16: case gltf_uint16: return 2;
+            case gltf_uint32: case gltf_float: return 4;
+            default: return 0;
+        }
+    }
+
+    uint32_t gltf_component_count(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT2") return 4;
+        if (type == "MAT3") return 9;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    bool decode_base64(const char* text, const size_t length, std::vector<uint8_t>& bytes) {
+        bytes.clear();
+        bytes.reserve(length / 4 * 3);
+        uint32_t bits = 0;
+        int bit_count = 0;
+        for (size_t i = 0; i < length && text[i] != '='; ++i) {
+            const char c = text[i];
+            uint32_t value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '+') value = 62;
+            else if (c == '/') value = 63;
+            else return false;
+            bits = (bits << 6) | value;
+            bit_count += 6;
+            if (bit_count >= 8) {
+                bit_count -= 8;
+                bytes.push_back(static_cast<uint8_t>(bits >> bit_count));
+            }
+        }
+        return true;
+    }
+
+    // URIs are percent encoded, "my%20model.bin" is "my model.bin"
+    std::string decode_uri(const std::string& uri) {
+        std::string path;
+        for (size_t i = 0; i < uri.size(); ++i) {
+            if (uri[i] == '%' && i + 2 < uri.size()) {
+                char hex[3] = { uri[i + 1], uri[i + 2], '\0' };
+                char* hex_end;
+                const long value = strtol(hex, &hex_end, 16);
+                if (hex_end == hex + 2) {
+                    path += static_cast<char>(value);
+                    i += 2;
+                    continue;
+                }
+            }
+            path += uri[i];
+        }
+        return path;
+    }
+
+    // Reads any accessor as floats. Normalized integers become [0, 1] or [-1, 1], missing components are `fill`.
+    template <typename T>
+    void convert_accessor(const GltfAccessor& accessor, const uint32_t out_components, const float fill, float* out) {
+        const float scale = accessor.normalized ? 1.0f / static_cast<float>(std::numeric_limits<T>::max()) : 1.0f;
+        const float min_value = accessor.normalized ? -1.0f : -std::numeric_limits<float>::max();
+        const uint32_t components = std::min(accessor.component_count, out_components);
+        for (size_t i = 0; i < accessor.count; ++i) {
+            const uint8_t* element = accessor.data + i * accessor.stride;
+            float* out_element = out + i * out_components;
+            for (uint32_t c = 0; c < components; ++c) {
+                T value;
+                memcpy(&value, element + c * sizeof(T), sizeof(T));
+                out_element[c] = std::max(static_cast<float>(value) * scale, min_value);
+            }
+            for (uint32_t c = components; c < out_components; ++c) {
+                out_element[c] = fill;
+            }
+        }
+    }
+
+    template <>
+    void convert_accessor<float>(const GltfAccessor& accessor, const uint32_t out_components, const float fill, float* out) {
+        const uint32_t components = std::min(accessor.component_count, out_components);
+        if (components == out_components && accessor.stride == sizeof(float) * out_components) {
+            memcpy(out, accessor.data, accessor.count * accessor.stride);
+            return;
+        }
+        for (size_t i = 0; i < accessor.count; ++i) {
+            float* out_element = out + i * out_components;
+            memcpy(out_element, accessor.data + i * accessor.stride, components * sizeof(float));
+            for (uint32_t c = components; c < out_components; ++c) {
+                out_element[c] = fill;
+            }
+        }
+    }
+
+    bool read_accessor_floats(const GltfAccessor& accessor, const uint32_t out_components, const float fill, float* out) {
+        if (!accessor.data) {
+            for (size_t i = 0; i < accessor.count; ++i) {
+                for (uint32_t c = 0; c < out_components; ++c) {
+                    out[i * out_components + c] = c < accessor.component_count ? 0.0f : fill;
+                }
+            }
+            return true;
+        }
+        switch (accessor.component_type) {
+            case gltf_float: convert_accessor<float>(accessor, out_components, fill, out); return true;
+            case gltf_uint8: convert_accessor<uint8_t>(accessor, out_components, fill, out); return true;
+            case gltf_uint16: convert_accessor<uint16_t>(accessor, out_components, fill, out); return true;
+            case gltf_int8: convert_accessor<int8_t>(accessor, out_components, fill, out); return true;
+            case gltf_int16: convert_accessor<int16_t>(accessor, out_components, fill, out); return true;
+            default: return false;
+        }
+    }
+
+    bool read_accessor_indices(const GltfAccessor& accessor, std::vector<uint32_t>& indices) {
+        indices.resize(accessor.count);
+        if (accessor.component_count != 1 || !accessor.data) {
+            return false;
+        }
+        for (size_t i = 0; i < accessor.count; ++i) {
+            const uint8_t* element = accessor.data + i * accessor.stride;
+            switch (accessor.component_type) {
+                case gltf_uint8: indices[i] = *element; break;
+                case gltf_uint16: { uint16_t value; memcpy(&value, element, 2); indices[i] = value; break; }
+                case gltf_uint32: memcpy(&indices[i], element, 4); break;
+                default: return false;
+            }
+        }
+        return true;
+    }
+
+    struct GltfPrimitiveJob {
+        const JsonValue* primitive = nullptr;
+        uint32_t mesh_index = 0;
+        const char* error = nullptr;
+    };
+
+    // Converts one primitive, returns an error message or nullptr
+    const char* convert_gltf_primitive(const JsonValue& primitive, const std::vector<GltfAccessor>& accessors, MeshSource& mesh) {
+        const JsonValue* attributes = primitive.find("attributes");
+        const JsonValue* position_index = attributes ? attributes->find("POSITION") : nullptr;
+        if (!position_index || position_index->type != JsonValue::Type::number) {
+            return "Primitive has no POSITION attribute";
+        }
+        const auto get_accessor = [&](const JsonValue* index) -> const GltfAccessor* {
+            if (!index || index->type != JsonValue::Type::number || index->number < 0 || index->number >= static_cast<double>(accessors.size())) {
+                return nullptr;
+            }
+            return &accessors[static_cast<size_t>(index->number)];
+        };
+
+        // Points and lines are skipped, they leave an empty mesh
+        const int mode = static_cast<int>(primitive.number_or("mode", 4));
+        if (mode < 4 || mode > 6) {
+            return mode >= 0 && mode < 4 ? nullptr : "Primitive has an unknown mode";
+        }
+
+        const GltfAccessor* positions = get_accessor(position_index);
+        if (!positions || positions->component_count != 3) {
+            return "POSITION accessor isn't a valid VEC3";
+        }
+        const size_t vertex_count = positions->count;
+        mesh.positions.resize(vertex_count);
+        if (!read_accessor_floats(*positions, 3, 0.0f, reinterpret_cast<float*>(mesh.positions.data()))) {
+            return "POSITION accessor has an unsupported component type";
+        }
+        if (const JsonValue* normal_index = attributes->find("NORMAL")) {
+            const GltfAccessor* normals = get_accessor(normal_index);
+            if (!normals || normals->count != vertex_count || normals->component_count != 3) {
+                return "NORMAL accessor isn't a valid VEC3 with one element per vertex";
+            }
+            mesh.normals.resize(vertex_count);
+            if (!read_accessor_floats(*normals, 3, 0.0f, reinterpret_cast<float*>(mesh.normals.data()))) {
+                return "NORMAL accessor has an unsupported component type";
+            }
+        }
+        if (const JsonValue* texcoord_index = attributes->find("TEXCOORD_0")) {
+            const GltfAccessor* texcoords = get_accessor(texcoord_index);
+            if (!texcoords || texcoords->count != vertex_count || texcoords->component_count != 2) {
+                return "TEXCOORD_0 accessor isn't a valid VEC2 with one element per vertex";
+            }
+            mesh.texcoords.resize(vertex_count);
+            if (!read_accessor_floats(*texcoords, 2, 0.0f, reinterpret_cast<float*>(mesh.texcoords.data()))) {
+                return "TEXCOORD_0 accessor has an unsupported component type";
+            }
+        }
+        if (const JsonValue* color_index = attributes->find("COLOR_0")) {
+            // RGBA colors lose their alpha
+            const GltfAccessor* colors = get_accessor(color_index);
+            if (!colors || colors->count != vertex_count || colors->component_count < 3 || colors->component_count > 4) {
+                return "COLOR_0 accessor isn't a valid VEC3 or VEC4 with one element per vertex";
+            }
+            mesh.colors.resize(vertex_count);
+            GltfAccessor rgb = *colors;
+            rgb.component_count = 3;
+            if (!read_accessor_floats(rgb, 3, 1.0f, reinterpret_cast<float*>(mesh.colors.data()))) {
+                return "COLOR_0 accessor has an unsupported component type";
+            }
+        }
+
+        std::vector<uint32_t> indices;
+        if (const JsonValue* indices_index = primitive.find("indices")) {
+            const GltfAccessor* index_accessor = get_accessor(indices_index);
+            if (!index_accessor || !read_accessor_indices(*index_accessor, indices)) {
+                return "Index accessor isn't a valid unsigned SCALAR";
+            }
+            for (const uint32_t index : indices) {
+                if (index >= vertex_count) {
+                    return "Index is past the last vertex";
+                }
+            }
+        }
+        else {
+            indices.resize(vertex_count);
+            for (size_t i = 0; i < vertex_count; ++i) {
+                indices[i] = static_cast<uint32_t>(i);
+            }
+        }
+
+        if (mode == 4) {
+            indices.resize(indices.size() / 3 * 3);
+            mesh.indices = std::move(indices);
+        }
+        else if (mode == 5) {
+            // Triangle strip, every other triangle is flipped to keep the winding
+            for (size_t i = 2; i < indices.size(); ++i) {
+                const bool odd = (i & 1) != 0;
+                mesh.indices.insert(mesh.indices.end(), { indices[i - 2], indices[odd ? i : i - 1], indices[odd ? i - 1 : i] });
+            }
+        }
+        else {
+            // Triangle fan
+            for (size_t i = 2; i < indices.size(); ++i) {
+                mesh.indices.insert(mesh.indices.end(), { indices[0], indices[i - 1], indices[i] });
+            }
+        }
+        return nullptr;
+    }
+
+    glm::mat4 gltf_node_transform(const JsonValue& node) {
+        if (const JsonValue* matrix = node.find("matrix")) {
+            glm::mat4 transform(1.0f);
+            if (matrix->type == JsonValue::Type::array && matrix->array.size() == 16) {
+                for (int i = 0; i < 16; ++i) {
+                    transform[i / 4][i % 4] = static_cast<float>(matrix->array[i].number); // Column major, like glm
+                }
+            }
+            return transform;
+        }
+        const auto read_vector = [&](const char* key, float* values, const int count) {
+            const JsonValue* array = node.find(key);
+            if (array && array->type == JsonValue::Type::array && array->array.size() == static_cast<size_t>(count)) {
+                for (int i = 0; i < count; ++i) {
+                    values[i] = static_cast<float>(array->array[i].number);
+                }
+            }
+        };
+        glm::vec3 translation(0.0f);
+        glm::vec4 rotation(0.0f, 0.0f, 0.0f, 1.0f); // x, y, z, w
+        glm::vec3 scale(1.0f);
+        read_vector("translation", glm::value_ptr(translation), 3);
+        read_vector("rotation", glm::value_ptr(rotation), 4);
+        read_vector("scale", glm::value_ptr(scale), 3);
+        const glm::mat4 rotation_matrix = glm::mat4_cast(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
+        glm::mat4 transform = rotation_matrix;
+        transform[0] *= scale.x;
+        transform[1] *= scale.y;
+        transform[2] *= scale.z;
+        transform[3] = glm::vec4(translation, 1.0f);
+        return transform;
+    }
+
+    const std::string empty_string;
+}
+
+bool import_obj(const std::string& path, ImportedScene& scene, ImportStats* stats) {
+    const ImportClock::time_point start = ImportClock::now();
+    scene = ImportedScene{};
+    MappedFile file;
+    if (!file.open(path, false)) {
+        return false;
+    }
+    const char* text = reinterpret_cast<const char*>(file.data());
+    const char* text_end = text + file.size();
+
+    // Cut the file into chunks that end at a line break
+    constexpr size_t chunk_size = 1 << 20;
+    std::vector<ObjChunk> chunks;
+    for (const char* chunk_begin = text; chunk_begin < text_end;) {
+        const char* chunk_end = chunk_begin + std::min(chunk_size, static_cast<size_t>(text_end - chunk_begin));
+        const char* line_break = static_cast<const char*>(memchr(chunk_end - 1, '\n', static_cast<size_t>(text_end - chunk_end + 1)));
+        chunk_end = line_break ? line_break + 1 : text_end;
+        chunks.emplace_back();
+        chunks.back().begin = chunk_begin;
+        chunks.back().end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    parallel_for(chunks.size(), 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            parse_obj_chunk(chunks[i], text_end);
+        }
+    });
+    for (const ObjChunk& chunk : chunks) {
+        if (chunk.error) {
+            const size_t line_number = 1 + static_cast<size_t>(std::count(text, chunk.error_position, '\n'));
+            printf("[ERROR] Failed to import '%s': %s on line %zu\n", path.c_str(), chunk.error, line_number);
+            return false;
+        }
+    }
+
+    // Now the chunks know where they start
+    size_t position_count = 0;
+    size_t texcoord_count = 0;
+    size_t normal_count = 0;
+    size_t corner_count = 0;
+    bool has_colors = false;
+    for (ObjChunk& chunk : chunks) {
+        chunk.first_position = position_count;
+        chunk.first_texcoord = texcoord_count;
+        chunk.first_normal = normal_count;
+        chunk.first_corner = corner_count;
+        position_count += chunk.positions.size();
+        texcoord_count += chunk.texcoords.size();
+        normal_count += chunk.normals.size();
+        corner_count += chunk.corners.size();
+        has_colors |= !chunk.colors.empty();
+    }
+    if (position_count >= no_index || texcoord_count >= no_index || normal_count >= no_index) {
+        printf("[ERROR] Failed to import '%s': too many vertices\n", path.c_str());
+        return false;
+    }
+
+    // Gather everything, fix up the relative indices, and check that every index is valid
+    std::vector<glm::vec3> positions(position_count);
+    std::vector<glm::vec3> colors(has_colors ? position_count : 0);
+    std::vector<glm::vec2> texcoords(texcoord_count);
+    std::vector<glm::vec3> normals(normal_count);
+    std::vector<ObjCorner> corners(corner_count);
+    std::vector<uint8_t> chunk_valid(chunks.size(), 1);
+    parallel_for(chunks.size(), 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.first_position);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.first_texcoord);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.first_normal);
+            if (has_colors) {
+                if (chunk.colors.empty()) {
+                    std::fill_n(colors.begin() + chunk.first_position, chunk.positions.size(), glm::vec3(1.0f));
+                }
+                else {
+                    std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.first_position);
+                }
+            }
+
+            const uint32_t bases[3] = { static_cast<uint32_t>(chunk.first_position), static_cast<uint32_t>(chunk.first_texcoord), static_cast<uint32_t>(chunk.first_normal) };
+            for (const size_t component : chunk.relative_indices) {
+                uint32_t* indices = &chunk.corners[component / 3].position;
+                indices[component % 3] += bases[component % 3];
+            }
+            for (const ObjCorner& corner : chunk.corners) {
+                if (corner.position >= position_count || (corner.texcoord != no_index && corner.texcoord >= texcoord_count)
+                    || (corner.normal != no_index && corner.normal >= normal_count)) {
+                    chunk_valid[i] = 0;
+                }
+            }
+            std::copy(chunk.corners.begin(), chunk.corners.end(), corners.begin() + chunk.first_corner);
+
+            // Free the chunk's memory as soon as possible, big files use a lot of it
+            chunk.positions = {};
+            chunk.colors = {};
+            chunk.texcoords = {};
+            chunk.normals = {};
+            chunk.corners = {};
+            chunk.relative_indices = {};
+        }
+    });
+    if (std::find(chunk_valid.begin(), chunk_valid.end(), 0) != chunk_valid.end()) {
+        printf("[ERROR] Failed to import '%s': a face uses a vertex that doesn't exist\n", path.c_str());
+        return false;
+    }
+
+    // Every object or group becomes a mesh, faces before the first one go into an unnamed mesh
+    std::vector<ObjGroup> groups(1);
+    for (const ObjChunk& chunk : chunks) {
+        for (const ObjGroup& group : chunk.groups) {
+            const size_t first_corner = chunk.first_corner + group.first_corner;
+            if (groups.back().first_corner == first_corner) {
+                groups.back().name = group.name; // The previous group has no faces
+            }
+            else {
+                groups.push_back({ first_corner, group.name });
+            }
+        }
+    }
+    groups.push_back({ corner_count, empty_string });
+
+    const size_t mesh_count = groups.size() - 1;
+    scene.meshes.resize(mesh_count);
+    parallel_for(mesh_count, 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const size_t first_corner = groups[i].first_corner;
+            if (groups[i + 1].first_corner > first_corner) {
+                build_obj_mesh(&corners[first_corner], groups[i + 1].first_corner - first_corner, positions, colors, texcoords, normals, scene.meshes[i]);
+            }
+        }
+    });
+
+    // Leave out the empty ones, every mesh is used once as it is
+    size_t kept = 0;
+    for (size_t i = 0; i < mesh_count; ++i) {
+        if (!scene.meshes[i].indices.empty()) {
+            if (kept != i) {
+                scene.meshes[kept] = std::move(scene.meshes[i]);
+            }
+            scene.mesh_names.push_back(groups[i].name);
+            scene.instances.push_back({ static_cast<uint32_t>(kept), glm::mat4(1.0f) });
+            ++kept;
+        }
+    }
+    scene.meshes.resize(kept);
+
+    fill_stats(stats, scene, file.size(), start);
+    return true;
+}
+
+bool import_gltf(const std::string& path, ImportedScene& scene, ImportStats* stats) {
+    const ImportClock::time_point start = ImportClock::now();
+    scene = ImportedScene{};
+    MappedFile file;
+    if (!file.open(path, false)) {
+        return false;
+    }
+    size_t input_bytes = file.size();
+    const auto fail = [&](const char* message) {
+        printf("[ERROR] Failed to import '%s': %s\n", path.c_str(), message);
+        return false;
+    };
+
+    // A .glb file is a header, then a JSON chunk, then an optional binary chunk
+    const uint8_t* json_text = file.data();
+    size_t json_size = file.size();
+    GltfBuffer glb_buffer;
+    constexpr uint32_t glb_magic = 0x46546C67; // "glTF"
+    uint32_t magic = 0;
+    if (file.size() >= 4) {
+        memcpy(&magic, file.data(), 4);
+    }
+    if (magic == glb_magic) {
+        uint32_t header[5];
+        if (file.size() < sizeof(header)) {
+            return fail("GLB file is too small");
+        }
+        memcpy(header, file.data(), sizeof(header));
+        if (header[1] != 2 || header[2] > file.size() || header[4] != 0x4E4F534A) {
+            return fail("GLB header isn't valid, or doesn't start with a JSON chunk");
+        }
+        const size_t glb_size = header[2];
+        json_text = file.data() + 20;
+        json_size = header[3];
+        if (json_size > glb_size - 20) {
+            return fail("GLB JSON chunk is past the end of the file");
+        }
+        const size_t bin_chunk = 20 + ((json_size + 3) & ~size_t(3));
+        if (bin_chunk + 8 <= glb_size) {
+            uint32_t bin_header[2];
+            memcpy(bin_header, file.data() + bin_chunk, sizeof(bin_header));
+            if (bin_header[1] == 0x004E4942 && bin_header[0] <= glb_size - bin_chunk - 8) {
+                glb_buffer = { file.data() + bin_chunk + 8, bin_header[0] };
+            }
+        }
+    }
+
+    JsonValue document;
+    if (!parse_json(reinterpret_cast<const char*>(json_text), json_size, document) || document.type != JsonValue::Type::object) {
+        return fail("glTF JSON isn't an object");
+    }
+    const JsonValue* asset = document.find("asset");
+    if (!asset || asset->string_or("version", empty_string).compare(0, 2, "2.") != 0) {
+        return fail("Only glTF 2.0 is supported");
+    }
+    if (const JsonValue* required = document.find("extensionsRequired")) {
+        if (!required->array.empty()) {
+            printf("[ERROR] Failed to import '%s': it requires extension '%s', which isn't supported\n", path.c_str(), required->array[0].string.c_str());
+            return false;
+        }
+    }
+    const auto get_array = [&](const char* key) -> const std::vector<JsonValue>& {
+        static const std::vector<JsonValue> empty;
+        const JsonValue* array = document.find(key);
+        return array && array->type == JsonValue::Type::array ? array->array : empty;
+    };
+
+    // Buffers
+    const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    std::vector<std::unique_ptr<MappedFile>> buffer_files;
+    std::vector<std::vector<uint8_t>> decoded_buffers;
+    std::vector<GltfBuffer> buffers;
+    for (const JsonValue& buffer_json : get_array("buffers")) {
+        const size_t byte_length = static_cast<size_t>(buffer_json.number_or("byteLength", 0));
+        const std::string& uri = buffer_json.string_or("uri", empty_string);
+        GltfBuffer buffer;
+        if (uri.empty()) {
+            if (!buffers.empty() || !glb_buffer.data) {
+                return fail("Buffer has no URI and isn't the GLB binary chunk");
+            }
+            buffer = glb_buffer;
+        }
+        else if (uri.compare(0, 5, "data:") == 0) {
+            const size_t data_start = uri.find(";base64,");
+            decoded_buffers.emplace_back();
+            if (data_start == std::string::npos || !decode_base64(uri.data() + data_start + 8, uri.size() - data_start - 8, decoded_buffers.back())) {
+                return fail("Buffer has a data URI that isn't base64");
+            }
+            buffer = { decoded_buffers.back().data(), decoded_buffers.back().size() };
+        }
+        else {
+            buffer_files.push_back(std::make_unique<MappedFile>());
+            if (!buffer_files.back()->open(directory + decode_uri(uri), false)) {
+                return fail("Buffer file can't be opened");
+            }
+            buffer = { buffer_files.back()->data(), buffer_files.back()->size() };
+            input_bytes += buffer.size;
+        }
+        if (buffer.size < byte_length) {
+            return fail("Buffer is smaller than its byteLength");
+        }
+        buffer.size = byte_length;
+        buffers.push_back(buffer);
+    }
+
+    std::vector<GltfBufferView> buffer_views;
+    for (const JsonValue& view_json : get_array("bufferViews")) {
+        GltfBufferView view;
+        const double buffer = view_json.number_or("buffer", -1);
+        if (buffer < 0 || buffer >= static_cast<double>(buffers.size())) {
+            return fail("Buffer view uses a buffer that doesn't exist");
+        }
+        view.buffer = static_cast<uint32_t>(buffer);
+        view.offset = static_cast<size_t>(view_json.number_or("byteOffset", 0));
+        view.size = static_cast<size_t>(view_json.number_or("byteLength", 0));
+        view.stride = static_cast<size_t>(view_json.number_or("byteStride", 0));
+        if (view.offset > buffers[view.buffer].size || view.size > buffers[view.buffer].size - view.offset) {
+            return fail("Buffer view is past the end of its buffer");
+        }
+        buffer_views.push_back(view);
+    }
+
+    std::vector<GltfAccessor> accessors;
+    for (const JsonValue& accessor_json : get_array("accessors")) {
+        if (accessor_json.find("sparse")) {
+            return fail("Sparse accessors aren't supported");
+        }
+        GltfAccessor accessor;
+        // glTF requires at least one element, and an empty POSITION accessor would leave nothing to read into
+        const double count = accessor_json.number_or("count", 0);
+        if (count < 1) {
+            return fail("Accessor has no elements");
+        }
+        accessor.count = static_cast<size_t>(count);
+        accessor.component_type = static_cast<uint32_t>(accessor_json.number_or("componentType", 0));
+        accessor.component_count = gltf_component_count(accessor_json.string_or("type", empty_string));
+        const JsonValue* normalized = accessor_json.find("normalized");
+        accessor.normalized = normalized && normalized->boolean;
+        const size_t element_size = static_cast<size_t>(gltf_component_size(accessor.component_type)) * accessor.component_count;
+        if (element_size == 0) {
+            return fail("Accessor has an unknown type or component type");
+        }
+        const double view_index = accessor_json.number_or("bufferView", -1);
+        if (view_index >= 0) {
+            if (view_index >= static_cast<double>(buffer_views.size())) {
+                return fail("Accessor uses a buffer view that doesn't exist");
+            }
+            const GltfBufferView& view = buffer_views[static_cast<size_t>(view_index)];
+            const size_t offset = static_cast<size_t>(accessor_json.number_or("byteOffset", 0));
+            accessor.stride = view.stride != 0 ? view.stride : element_size;
+            if (offset > view.size || element_size > view.size - offset
+                || (accessor.count - 1) > (view.size - offset - element_size) / accessor.stride) {
+                return fail("Accessor is past the end of its buffer view");
+            }
+            accessor.data = buffers[view.buffer].data + view.offset + offset;
+        }
+        accessors.push_back(accessor);
+    }
+
+    // Every primitive is converted on its own, in parallel
+    std::vector<GltfPrimitiveJob> jobs;
+    std::vector<uint32_t> first_job;
+    const std::vector<JsonValue>& meshes = get_array("meshes");
+    for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+        first_job.push_back(static_cast<uint32_t>(jobs.size()));
+        const JsonValue* primitives = meshes[mesh_index].find("primitives");
+        if (primitives) {
+            for (const JsonValue& primitive : primitives->array) {
+                jobs.push_back({ &primitive, static_cast<uint32_t>(mesh_index) });
+            }
+        }
+    }
+    first_job.push_back(static_cast<uint32_t>(jobs.size()));
+    scene.meshes.resize(jobs.size());
+    parallel_for(jobs.size(), 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            jobs[i].error = convert_gltf_primitive(*jobs[i].primitive, accessors, scene.meshes[i]);
+        }
+    });
+    for (const GltfPrimitiveJob& job : jobs) {
+        if (job.error) {
+            printf("[ERROR] Failed to import '%s': mesh %u: %s\n", path.c_str(), job.mesh_index, job.error);
+            scene = ImportedScene{};
+            return false;
+        }
+        scene.mesh_names.push_back(meshes[job.mesh_index].string_or("name", empty_string));
+    }
+
+    // Instances come from the node hierarchy of the scene. Without scenes, every mesh is used once as it is.
+    const auto add_mesh_instances = [&](const size_t mesh_index, const glm::mat4& transform) {
+        for (uint32_t job = first_job[mesh_index]; job < first_job[mesh_index + 1]; ++job) {
+            if (!scene.meshes[job].indices.empty()) {
+                scene.instances.push_back({ job, transform });
+            }
+        }
+    };
+    const std::vector<JsonValue>& scenes = get_array("scenes");
+    const std::vector<JsonValue>& nodes = get_array("nodes");
+    if (scenes.empty()) {
+        for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+            add_mesh_instances(mesh_index, glm::mat4(1.0f));
+        }
+    }
+    else {
+        const size_t scene_index = static_cast<size_t>(std::max(0.0, document.number_or("scene", 0)));
+        if (scene_index >= scenes.size()) {
+            return fail("Default scene doesn't exist");
+        }
+        struct NodeVisit {
+            size_t node;
+            glm::mat4 parent_transform;
+        };
+        // Nodes are pushed in reverse, so the instances come out in the order of the file
+        std::vector<NodeVisit> stack;
+        if (const JsonValue* roots = scenes[scene_index].find("nodes")) {
+            for (auto root = roots->array.rbegin(); root != roots->array.rend(); ++root) {
+                stack.push_back({ static_cast<size_t>(root->number), glm::mat4(1.0f) });
+            }
+        }
+        // Node hierarchies are trees, so no node can be visited more often than there are nodes
+        size_t visits = 0;
+        while (!stack.empty()) {
+            const NodeVisit visit = stack.back();
+            stack.pop_back();
+            if (visit.node >= nodes.size() || ++visits > nodes.size()) {
+                return fail("Node hierarchy uses a node that doesn't exist, or isn't a tree");
+            }
+            const JsonValue& node = nodes[visit.node];
+            const glm::mat4 transform = visit.parent_transform * gltf_node_transform(node);
+            const double mesh_index = node.number_or("mesh", -1);
+            if (mesh_index >= 0 && mesh_index < static_cast<double>(meshes.size())) {
+                add_mesh_instances(static_cast<size_t>(mesh_index), transform);
+            }
+            if (const JsonValue* children = node.find("children")) {
+                for (auto child = children->array.rbegin(); child != children->array.rend(); ++child) {
+                    stack.push_back({ static_cast<size_t>(child->number), transform });
+                }
+            }
+        }
+    }
+
+    fill_stats(stats, scene, input_bytes, start);
+    return true;
+}
+
+bool import_scene(const std::string& path, ImportedScene& scene, ImportStats* stats) {
+    const size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](const char c) { return static_cast<char>(tolower(c)); });
+    if (extension == "obj") {
+        return import_obj(path, scene, stats);
+    }
+    if (extension == "gltf" || extension == "glb") {
+        return import_gltf(path, scene, stats);
+    }
+    printf("[ERROR] Failed to import '%s': unknown file extension\n", path.c_str());
+    return false;
+}
+
+void flatten_scene(const ImportedScene& scene, MeshSource& mesh) {
+    mesh = MeshSource{};
+    bool has_normals = !scene.instances.empty();
+    bool has_texcoords = !scene.instances.empty();
+    bool has_colors = false;
+    std::vector<size_t> first_vertex(scene.instances.size() + 1, 0);
+    std::vector<size_t> first_index(scene.instances.size() + 1, 0);
+    for (size_t i = 0; i < scene.instances.size(); ++i) {
+        const MeshSource& source = scene.meshes[scene.instances[i].mesh_index];
+        has_normals &= !source.normals.empty();
+        has_texcoords &= !source.texcoords.empty();
+        has_colors |= !source.colors.empty();
+        first_vertex[i + 1] = first_vertex[i] + source.positions.size();
+        first_index[i + 1] = first_index[i] + source.indices.size();
+    }
+    const size_t vertex_count = first_vertex.back();
+    mesh.positions.resize(vertex_count);
+    mesh.normals.resize(has_normals ? vertex_count : 0);
+    mesh.texcoords.resize(has_texcoords ? vertex_count : 0);
+    mesh.colors.resize(has_colors ? vertex_count : 0);
+    mesh.indices.resize(first_index.back());
+
+    parallel_for(scene.instances.size(), 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const ImportedInstance& instance = scene.instances[i];
+            const MeshSource& source = scene.meshes[instance.mesh_index];
+            const size_t base = first_vertex[i];
+            const glm::mat3 normal_transform = glm::transpose(glm::inverse(glm::mat3(instance.transform)));
+            for (size_t v = 0; v < source.positions.size(); ++v) {
+                mesh.positions[base + v] = glm::vec3(instance.transform * glm::vec4(source.positions[v], 1.0f));
+            }
+            if (has_normals) {
+                for (size_t v = 0; v < source.normals.size(); ++v) {
+                    const glm::vec3 normal = normal_transform * source.normals[v];
+                    const float length = glm::length(normal);
+                    mesh.normals[base + v] = length > 0.0f ? normal / length : normal;
+                }
+            }
+            if (has_texcoords) {
+                std::copy(source.texcoords.begin(), source.texcoords.end(), mesh.texcoords.begin() + base);
+            }
+            if (has_colors) {
+                if (source.colors.empty()) {
+                    std::fill_n(mesh.colors.begin() + base, source.positions.size(), glm::vec3(1.0f));
+                }
+                else {
+                    std::copy(source.colors.begin(), source.colors.end(), mesh.colors.begin() + base);
+                }
+            }
+
+            // A mirroring transform turns the triangles inside out, so their winding has to flip too
+            const bool mirrored = glm::determinant(glm::mat3(instance.transform)) < 0.0f;
+            uint32_t* indices = mesh.indices.data() + first_index[i];
+            for (size_t t = 0; t + 2 < source.indices.size(); t += 3) {
+                indices[t + 0] = static_cast<uint32_t>(base + source.indices[t + 0]);
+                indices[t + 1] = static_cast<uint32_t>(base + source.indices[t + (mirrored ? 2 : 1)]);
+                indices[t + 2] = static_cast<uint32_t>(base + source.indices[t + (mirrored ? 1 : 2)]);
+            }
+        }
+    });
+}
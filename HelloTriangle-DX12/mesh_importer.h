@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "mesh_cooker.h"
+
+/* MESH IMPORTER
+* Reads glTF 2.0 (.gltf with .bin or data URI buffers, and .glb) and Wavefront OBJ files into MeshSources
+* for the mesh cooker. Input files are mapped instead of read, and the work is spread over all hardware threads:
+* - OBJ files are cut into chunks at line boundaries, and the chunks are parsed in parallel. Numbers are parsed
+*   with SSE2 to find where the digits end and 8 digits at a time in a 64-bit register, instead of with strtod.
+*   Then every object or group is turned into indexed vertices in parallel.
+* - glTF primitives are converted in parallel, each one only reads its own accessors.
+*
+* Texture coordinates have their origin in the top left like in D3D and glTF, so OBJ texture coordinates are
+* flipped. Points and lines are skipped, triangle strips and fans are turned into lists. glTF materials,
+* skins, morph targets and sparse accessors aren't supported, and neither are OBJ materials.
+*/
+
+struct ImportedInstance {
+    uint32_t mesh_index = 0;                // Into ImportedScene::meshes
+    glm::mat4 transform{ 1.0f };
+};
+
+struct ImportedScene {
+    std::vector<MeshSource> meshes;         // One per glTF primitive, or per OBJ object or group
+    std::vector<std::string> mesh_names;
+    std::vector<ImportedInstance> instances;
+};
+
+// Measurements for a single import
+struct ImportStats {
+    size_t input_bytes = 0;                 // Including external glTF buffers
+    double import_seconds = 0.0;
+    size_t vertex_count = 0;                // Over all meshes, not instances
+    size_t triangle_count = 0;
+};
+
+// Picks the importer from the file extension. Prints an error and returns false if the file can't be imported.
+bool import_scene(const std::string& path, ImportedScene& scene, ImportStats* stats = nullptr);
+bool import_obj(const std::string& path, ImportedScene& scene, ImportStats* stats = nullptr);
+bool import_gltf(const std::string& path, ImportedScene& scene, ImportStats* stats = nullptr);
+
+// Bakes every instance into one mesh, since a mesh file holds a single mesh. Normals and texture coordinates are
+// only kept if every instanced mesh has them, missing colors become white.
+void flatten_scene(const ImportedScene& scene, MeshSource& mesh);
@@ -0,0 +1,273 @@
+#include "meshlet_builder.h"
+#include <algorithm>
+#include <cmath>
+#include "glm/geometric.hpp"
+
+namespace {
+    constexpr uint32_t no_index = UINT32_MAX;
+
+    // Lower is better: first the priority, then the score
+    struct CandidateKey {
+        uint32_t priority = UINT32_MAX;
+        float score = 0.0f;
+
+        bool operator<(const CandidateKey& other) const {
+            return priority != other.priority ? priority < other.priority : score < other.score;
+        }
+    };
+
+    int8_t quantize_snorm8(const float value) {
+        return static_cast<int8_t>(std::clamp(std::lround(value * 127.0f), -127l, 127l));
+    }
+}
+
+void build_meshlets(const std::vector<glm::vec3>& positions, const uint32_t* indices, const size_t index_count, const float cone_weight,
+                    std::vector<MeshletDesc>& meshlets, std::vector<uint32_t>& meshlet_vertices, std::vector<uint32_t>& meshlet_triangles) {
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+    const size_t vertex_count = positions.size();
+
+    // The triangles around every vertex, in one array. Only the first live_counts[vertex] are still unused.
+    std::vector<uint32_t> live_counts(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        live_counts[indices[i]]++;
+    }
+    std::vector<size_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_counts[vertex];
+    }
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    {
+        std::vector<size_t> cursors(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < triangle_count * 3; ++i) {
+            adjacency[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    // Triangle centers and unit normals, for the score
+    std::vector<glm::vec3> triangle_centers(triangle_count);
+    std::vector<glm::vec3> triangle_normals(triangle_count);
+    double total_area = 0.0;
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle) {
+        const glm::vec3& a = positions[indices[triangle * 3 + 0]];
+        const glm::vec3& b = positions[indices[triangle * 3 + 1]];
+        const glm::vec3& c = positions[indices[triangle * 3 + 2]];
+        const glm::vec3 normal = glm::cross(b - a, c - a);
+        const float length = glm::length(normal);
+        triangle_centers[triangle] = (a + b + c) / 3.0f;
+        triangle_normals[triangle] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        total_area += 0.5 * length;
+    }
+
+    // About the radius of a flat, round meshlet, so distances have the same scale for every mesh
+    const double mean_area = total_area / static_cast<double>(triangle_count);
+    float expected_radius = static_cast<float>(std::sqrt(mean_area * meshlet_max_triangles / 3.14159265));
+    expected_radius = expected_radius > 0.0f ? expected_radius : 1.0f;
+
+    std::vector<uint8_t> used(triangle_count, 0);
+    std::vector<uint32_t> local_index(vertex_count, no_index); // Index in the current meshlet, if the vertex is in it
+
+    // The unused triangles that share a vertex with the meshlet. The stamp says which meshlet a triangle was last
+    // made a candidate for, so every triangle is only in the list once.
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> candidate_stamps(triangle_count, no_index);
+    uint32_t meshlet_stamp = 0;
+    MeshletDesc meshlet;
+    meshlet.vertex_offset = static_cast<uint32_t>(meshlet_vertices.size());
+    meshlet.triangle_offset = static_cast<uint32_t>(meshlet_triangles.size());
+    glm::vec3 center_sum(0.0f);
+    glm::vec3 normal_sum(0.0f);
+
+    const auto finish_meshlet = [&]() {
+        for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+            local_index[meshlet_vertices[meshlet.vertex_offset + i]] = no_index;
+        }
+        meshlets.push_back(meshlet);
+        meshlet = {};
+        meshlet.vertex_offset = static_cast<uint32_t>(meshlet_vertices.size());
+        meshlet.triangle_offset = static_cast<uint32_t>(meshlet_triangles.size());
+        center_sum = glm::vec3(0.0f);
+        normal_sum = glm::vec3(0.0f);
+        candidates.clear();
+        meshlet_stamp++;
+    };
+
+    const auto add_triangle = [&](const uint32_t triangle) {
+        uint32_t corners[3];
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            const uint32_t vertex = indices[triangle * 3 + corner];
+            if (local_index[vertex] == no_index) {
+                local_index[vertex] = meshlet.vertex_count++;
+                meshlet_vertices.push_back(vertex);
+            }
+            corners[corner] = local_index[vertex];
+
+            // Swap the triangle out of the vertex's live triangles, the ones that are left become candidates
+            uint32_t* live = adjacency.data() + adjacency_offsets[vertex];
+            uint32_t& live_count = live_counts[vertex];
+            const uint32_t position = static_cast<uint32_t>(std::find(live, live + live_count, triangle) - live);
+            std::swap(live[position], live[live_count - 1]);
+            live_count--;
+            for (uint32_t i = 0; i < live_count; ++i) {
+                if (candidate_stamps[live[i]] != meshlet_stamp) {
+                    candidate_stamps[live[i]] = meshlet_stamp;
+                    candidates.push_back(live[i]);
+                }
+            }
+        }
+        meshlet_triangles.push_back(pack_meshlet_triangle(corners[0], corners[1], corners[2]));
+        meshlet.triangle_count++;
+        used[triangle] = 1;
+        center_sum += triangle_centers[triangle];
+        normal_sum += triangle_normals[triangle];
+    };
+
+    size_t first_unused = 0;
+    uint32_t next_triangle = 0;
+    for (size_t added = 0; added < triangle_count; ++added) {
+        add_triangle(next_triangle);
+        if (added + 1 == triangle_count) {
+            break;
+        }
+
+        // Look at every candidate. `best` has to fit in the meshlet, `best_seed` doesn't, it starts the next meshlet if
+        // nothing fits anymore.
+        const glm::vec3 center = center_sum / static_cast<float>(meshlet.triangle_count);
+        const float normal_length = glm::length(normal_sum);
+        const glm::vec3 axis = normal_length > 0.0f ? normal_sum / normal_length : glm::vec3(0.0f);
+        const bool meshlet_full = meshlet.triangle_count == meshlet_max_triangles;
+        uint32_t best = no_index;
+        uint32_t best_seed = no_index;
+        CandidateKey best_key;
+        CandidateKey best_seed_key;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const uint32_t triangle = candidates[i];
+            if (used[triangle]) {
+                candidates[i--] = candidates.back();
+                candidates.pop_back();
+                continue;
+            }
+            const uint32_t* corners = indices + triangle * 3;
+            const uint32_t new_vertices = (local_index[corners[0]] == no_index) + (local_index[corners[1]] == no_index) + (local_index[corners[2]] == no_index);
+            const bool finishes_vertex = live_counts[corners[0]] == 1 || live_counts[corners[1]] == 1 || live_counts[corners[2]] == 1;
+
+            CandidateKey key;
+            key.priority = finishes_vertex ? 0 : 1 + new_vertices;
+            const float distance = glm::length(triangle_centers[triangle] - center);
+            const float cone = std::max(1.0f - glm::dot(triangle_normals[triangle], axis) * cone_weight, 1e-3f);
+            key.score = (1.0f + distance / expected_radius * (1.0f - cone_weight)) * cone;
+
+            if (key < best_seed_key) {
+                best_seed_key = key;
+                best_seed = triangle;
+            }
+            if (!meshlet_full && meshlet.vertex_count + new_vertices <= meshlet_max_vertices && key < best_key) {
+                best_key = key;
+                best = triangle;
+            }
+        }
+
+        if (best != no_index) {
+            next_triangle = best;
+            continue;
+        }
+        finish_meshlet();
+        if (best_seed != no_index) {
+            next_triangle = best_seed;
+        }
+        else {
+            // Nothing around the meshlet is left, start on the next connected piece
+            while (used[first_unused]) {
+                ++first_unused;
+            }
+            next_triangle = static_cast<uint32_t>(first_unused);
+        }
+    }
+    finish_meshlet();
+}
+
+MeshletBounds compute_meshlet_bounds(const std::vector<glm::vec3>& positions, const MeshletDesc& meshlet,
+                                     const std::vector<uint32_t>& meshlet_vertices, const std::vector<uint32_t>& meshlet_triangles) {
+    MeshletBounds bounds;
+    if (meshlet.vertex_count == 0) {
+        return bounds;
+    }
+    const uint32_t* vertices = meshlet_vertices.data() + meshlet.vertex_offset;
+
+    // Ritter's bounding sphere: start with the two points that are farthest apart along an axis, then grow the
+    // sphere just enough to include every point outside it
+    uint32_t min_point[3] = { 0, 0, 0 };
+    uint32_t max_point[3] = { 0, 0, 0 };
+    for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+        const glm::vec3& position = positions[vertices[i]];
+        for (int axis = 0; axis < 3; ++axis) {
+            min_point[axis] = position[axis] < positions[vertices[min_point[axis]]][axis] ? i : min_point[axis];
+            max_point[axis] = position[axis] > positions[vertices[max_point[axis]]][axis] ? i : max_point[axis];
+        }
+    }
+    int widest_axis = 0;
+    float widest_distance = -1.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        const glm::vec3 span = positions[vertices[max_point[axis]]] - positions[vertices[min_point[axis]]];
+        if (glm::dot(span, span) > widest_distance) {
+            widest_distance = glm::dot(span, span);
+            widest_axis = axis;
+        }
+    }
+    glm::vec3 center = (positions[vertices[min_point[widest_axis]]] + positions[vertices[max_point[widest_axis]]]) * 0.5f;
+    float radius = std::sqrt(widest_distance) * 0.5f;
+    for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+        const glm::vec3 offset = positions[vertices[i]] - center;
+        const float distance = glm::length(offset);
+        if (distance > radius) {
+            const float new_radius = (radius + distance) * 0.5f;
+            center += offset * ((new_radius - radius) / distance);
+            radius = new_radius;
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        bounds.center[axis] = center[axis];
+    }
+    bounds.radius = radius;
+
+    // Normal cone: the axis is the average triangle normal, the spread is the triangle furthest away from it
+    glm::vec3 normals[meshlet_max_triangles];
+    uint32_t normal_count = 0;
+    glm::vec3 normal_sum(0.0f);
+    for (uint32_t i = 0; i < meshlet.triangle_count; ++i) {
+        uint32_t a, b, c;
+        unpack_meshlet_triangle(meshlet_triangles[meshlet.triangle_offset + i], a, b, c);
+        const glm::vec3& p0 = positions[vertices[a]];
+        const glm::vec3 normal = glm::cross(positions[vertices[b]] - p0, positions[vertices[c]] - p0);
+        const float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals[normal_count++] = normal / length;
+            normal_sum += normal / length;
+        }
+    }
+    const float axis_length = glm::length(normal_sum);
+    if (normal_count == 0 || axis_length <= 0.0f) {
+        return bounds;
+    }
+    const glm::vec3 axis = normal_sum / axis_length;
+    float min_dot = 1.0f;
+    for (uint32_t i = 0; i < normal_count; ++i) {
+        min_dot = std::min(min_dot, glm::dot(axis, normals[i]));
+    }
+    if (min_dot <= 0.0f) {
+        return bounds; // The triangles face more than 90 degrees apart, there's no camera position they all face away from
+    }
+
+    // Every component of the quantized axis is off by up to half a step, which changes the dot product with a unit
+    // vector by at most the sum of those errors, so the cutoff grows by that much
+    const float cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    float axis_error = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        bounds.cone_axis[i] = quantize_snorm8(axis[i]);
+        axis_error += std::abs(static_cast<float>(bounds.cone_axis[i]) / 127.0f - axis[i]);
+    }
+    bounds.cone_cutoff = static_cast<int8_t>(std::min(127.0f, std::ceil((cutoff + axis_error) * 127.0f)));
+    return bounds;
+}
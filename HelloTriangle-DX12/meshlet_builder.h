@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "mesh_format.h"
+
+/* MESHLET BUILDER
+* Splits a triangle list into meshlets of at most 64 vertices and 124 triangles (see mesh_format.h).
+*
+* A meshlet is grown one triangle at a time from a seed triangle. The next triangle is always one that shares a
+* vertex with the meshlet. The builder picks, in this order:
+* - a triangle that uses up the last triangle of one of the meshlet's vertices, so no vertex is left behind
+*   with a single triangle that a later meshlet has to load the vertex again for
+* - the triangle that adds the fewest new vertices
+* - the triangle closest to the meshlet's center, whose normal is closest to the meshlet's average normal
+* The first makes fewer vertices shared between meshlets, the second fits more triangles into the vertex limit,
+* and the last keeps meshlets round and flat, so their bounding spheres are small and their normal cones narrow,
+* which is what makes them cullable. When a meshlet is full, the next one starts from the best triangle on its
+* border, so meshlets follow each other over the surface. When a connected piece of the mesh is used up, the next
+* one starts at the first triangle that's left, in index order.
+*
+* Used triangles are removed from the vertices' triangle lists. The triangles left around a vertex that was just
+* added become candidates, so each step only looks at the unused triangles around the meshlet, each of them once.
+*/
+
+// How much the normal cone matters compared to the distance to the meshlet center, from 0 to 1
+constexpr float meshlet_default_cone_weight = 0.25f;
+
+// Appends the meshlets for the triangles in `indices` to the arrays. Indices are into `positions`.
+void build_meshlets(const std::vector<glm::vec3>& positions, const uint32_t* indices, size_t index_count, float cone_weight,
+                    std::vector<MeshletDesc>& meshlets, std::vector<uint32_t>& meshlet_vertices, std::vector<uint32_t>& meshlet_triangles);
+
+// The bounding sphere and the quantized normal cone of one meshlet
+MeshletBounds compute_meshlet_bounds(const std::vector<glm::vec3>& positions, const MeshletDesc& meshlet,
+                                     const std::vector<uint32_t>& meshlet_vertices, const std::vector<uint32_t>& meshlet_triangles);
@@ -0,0 +1,68 @@
+#include "meshlet_culler.h"
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+
+MeshletCullView make_meshlet_cull_view(const glm::mat4& model, const glm::mat4& view_projection, const glm::vec3& camera_position) {
+    // Gribb-Hartmann: every frustum plane is a sum or difference of rows of the clip matrix
+    const glm::mat4 clip = view_projection * model;
+    const glm::vec4 rows[4] = {
+        { clip[0][0], clip[1][0], clip[2][0], clip[3][0] },
+        { clip[0][1], clip[1][1], clip[2][1], clip[3][1] },
+        { clip[0][2], clip[1][2], clip[2][2], clip[3][2] },
+        { clip[0][3], clip[1][3], clip[2][3], clip[3][3] },
+    };
+    MeshletCullView view;
+    view.planes[0] = rows[3] + rows[0]; // Left
+    view.planes[1] = rows[3] - rows[0]; // Right
+    view.planes[2] = rows[3] + rows[1]; // Bottom
+    view.planes[3] = rows[3] - rows[1]; // Top
+    view.planes[4] = rows[2];           // z >= 0
+    view.planes[5] = rows[3] - rows[2]; // z <= w
+    for (glm::vec4& plane : view.planes) {
+        // An infinite far plane has no normal, it's always in front of the camera
+        const float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    view.camera_position = glm::vec3(glm::inverse(model) * glm::vec4(camera_position, 1.0f));
+    return view;
+}
+
+bool meshlet_outside_frustum(const MeshletBounds& bounds, const MeshletCullView& view) {
+    const glm::vec3 center(bounds.center[0], bounds.center[1], bounds.center[2]);
+    for (const glm::vec4& plane : view.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -bounds.radius) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool meshlet_faces_away(const MeshletBounds& bounds, const MeshletCullView& view) {
+    // A quantized axis can be a little longer than 1, so the test would be wrong at a cutoff of 1
+    if (bounds.cone_cutoff >= 127) {
+        return false;
+    }
+    const glm::vec3 center(bounds.center[0], bounds.center[1], bounds.center[2]);
+    const glm::vec3 axis(bounds.cone_axis[0] / 127.0f, bounds.cone_axis[1] / 127.0f, bounds.cone_axis[2] / 127.0f);
+    const glm::vec3 to_center = center - view.camera_position;
+    return glm::dot(to_center, axis) >= bounds.cone_cutoff / 127.0f * glm::length(to_center) + bounds.radius;
+}
+
+void cull_meshlets(const MeshletBounds* bounds, const uint32_t first_meshlet, const uint32_t meshlet_count, const MeshletCullView& view,
+                   std::vector<uint32_t>& visible, MeshletCullStats& stats) {
+    stats.tested += meshlet_count;
+    for (uint32_t i = first_meshlet; i < first_meshlet + meshlet_count; ++i) {
+        if (meshlet_outside_frustum(bounds[i], view)) {
+            stats.frustum_culled++;
+        }
+        else if (meshlet_faces_away(bounds[i], view)) {
+            stats.cone_culled++;
+        }
+        else {
+            stats.visible++;
+            visible.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "mesh_format.h"
+
+/* MESHLET CULLING
+* The CPU reference for per-meshlet culling, it does the same tests an amplification shader would:
+* - Frustum: the bounding sphere is outside one of the frustum planes
+* - Backface: the whole meshlet faces away from the camera, using its normal cone (see MeshletBounds)
+*
+* The tests happen in the mesh's own space. The frustum planes are taken from the world-view-projection matrix and
+* the camera position is moved into mesh space, so the bounds never have to be transformed. That's exact for any
+* affine transform, even with non-uniform scale, because planes and facing don't change under them.
+*/
+
+struct MeshletCullView {
+    glm::vec4 planes[6];        // Mesh space, inside is positive, normalized so distances are in mesh units
+    glm::vec3 camera_position;  // Mesh space
+};
+
+struct MeshletCullStats {
+    uint32_t tested = 0;
+    uint32_t frustum_culled = 0;
+    uint32_t cone_culled = 0;
+    uint32_t visible = 0;
+
+    void add(const MeshletCullStats& other) {
+        tested += other.tested;
+        frustum_culled += other.frustum_culled;
+        cone_culled += other.cone_culled;
+        visible += other.visible;
+    }
+};
+
+// `view_projection` uses D3D clip space (0 <= z <= w), so it works with normal and reverse-Z projections
+MeshletCullView make_meshlet_cull_view(const glm::mat4& model, const glm::mat4& view_projection, const glm::vec3& camera_position);
+
+bool meshlet_outside_frustum(const MeshletBounds& bounds, const MeshletCullView& view);
+bool meshlet_faces_away(const MeshletBounds& bounds, const MeshletCullView& view);
+
+// Appends the indices of the meshlets in [first_meshlet, first_meshlet + meshlet_count) that survive both tests
+void cull_meshlets(const MeshletBounds* bounds, uint32_t first_meshlet, uint32_t meshlet_count, const MeshletCullView& view,
+                   std::vector<uint32_t>& visible, MeshletCullStats& stats);
@@ -0,0 +1,252 @@
+#include "occlusion_culling.h"
+#include <algorithm>
+#include <cstring>
+#include "parallel_for.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLING_SSE2 1
+#include <emmintrin.h>
+#else
+#define OCCLUSION_CULLING_SSE2 0
+#endif
+
+namespace {
+    // Levels smaller than this are built on the calling thread, starting threads would take longer
+    constexpr size_t parallel_level_texels = 16384;
+
+    // Frustum planes a clip space point is outside of, one bit per plane. Same as clip_outcode() in
+    // occlusion_culling.hlsli.
+    constexpr uint32_t outcode_near = 16;
+
+    uint32_t clip_outcode(const glm::vec4& corner) {
+        return (corner.x < -corner.w ? 1u : 0u) | (corner.x > corner.w ? 2u : 0u) | (corner.y < -corner.w ? 4u : 0u) |
+               (corner.y > corner.w ? 8u : 0u) | (corner.z > corner.w ? outcode_near : 0u) | (corner.z < 0.0f ? 32u : 0u);
+    }
+
+    // m * v, one column at a time, in the same order as transform_column() in occlusion_culling.hlsli
+    glm::vec4 transform_column(const glm::vec4* m, const glm::vec4& v) {
+        glm::vec4 result = m[0] * v.x;
+        result = result + m[1] * v.y;
+        result = result + m[2] * v.z;
+        result = result + m[3] * v.w;
+        return result;
+    }
+
+    // The corners of the box in clip space. Corner i is at the maximum of x, y and z for bits 0, 1 and 2 of i.
+    void clip_corners(const OcclusionObject& object, const glm::mat4& world, const glm::mat4& view_projection, glm::vec4 corners[8]) {
+        const glm::vec4* view_projection_columns = &view_projection[0];
+        glm::vec4 columns[4];
+        for (int i = 0; i < 4; ++i) {
+            columns[i] = transform_column(view_projection_columns, world[i]);
+        }
+        const glm::vec3 extent = object.box_max - object.box_min;
+        const glm::vec4 base = transform_column(columns, glm::vec4(object.box_min, 1.0f));
+        const glm::vec4 axis_x = columns[0] * extent.x;
+        const glm::vec4 axis_y = columns[1] * extent.y;
+        const glm::vec4 axis_z = columns[2] * extent.z;
+        for (int i = 0; i < 8; ++i) {
+            glm::vec4 corner = base;
+            if (i & 1) {
+                corner = corner + axis_x;
+            }
+            if (i & 2) {
+                corner = corner + axis_y;
+            }
+            if (i & 4) {
+                corner = corner + axis_z;
+            }
+            corners[i] = corner;
+        }
+    }
+
+    // The largest q in [0, max_q] with q * denominator <= numerator, where denominator > 0. The division is only the
+    // first guess, the products decide, so this gives the same q as floor_ratio() in occlusion_culling.hlsli even
+    // though the GPU divides differently. Rounded products still grow with q, so there is only one such q.
+    int32_t floor_ratio(const float numerator, const float denominator, const int32_t max_q) {
+        const float estimate = numerator / denominator;
+        int32_t q = estimate > 0.0f ? (estimate < static_cast<float>(max_q) ? static_cast<int32_t>(estimate) : max_q) : 0;
+        while (q > 0 && static_cast<float>(q) * denominator > numerator) {
+            --q;
+        }
+        while (q < max_q && static_cast<float>(q + 1) * denominator <= numerator) {
+            ++q;
+        }
+        return q;
+    }
+
+    // One level from the one before it (or from the depth buffer), rows [row_begin, row_end)
+    void reduce_rows(const float* source, const size_t source_pitch, const uint32_t source_width, const uint32_t source_height,
+                     float* destination, const uint32_t width, const uint32_t row_begin, const uint32_t row_end) {
+        for (uint32_t y = row_begin; y < row_end; ++y) {
+            const float* row_0 = source + static_cast<size_t>(y) * 2 * source_pitch;
+            const float* row_1 = source + static_cast<size_t>(std::min(y * 2 + 1, source_height - 1)) * source_pitch;
+            float* out = destination + static_cast<size_t>(y) * width;
+            uint32_t x = 0;
+#if OCCLUSION_CULLING_SSE2
+            // Four texels from 2x8 source texels, as long as none of them is past the edge
+            for (; (x + 4) * 2 <= source_width; x += 4) {
+                const __m128 columns_0 = _mm_min_ps(_mm_loadu_ps(row_0 + x * 2), _mm_loadu_ps(row_1 + x * 2));
+                const __m128 columns_1 = _mm_min_ps(_mm_loadu_ps(row_0 + x * 2 + 4), _mm_loadu_ps(row_1 + x * 2 + 4));
+                const __m128 even = _mm_shuffle_ps(columns_0, columns_1, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 odd = _mm_shuffle_ps(columns_0, columns_1, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + x, _mm_min_ps(even, odd));
+            }
+#endif
+            for (; x < width; ++x) {
+                const uint32_t x_0 = x * 2;
+                const uint32_t x_1 = std::min(x_0 + 1, source_width - 1);
+                out[x] = std::min(std::min(row_0[x_0], row_0[x_1]), std::min(row_1[x_0], row_1[x_1]));
+            }
+        }
+    }
+}
+
+void make_depth_pyramid(const uint32_t width, const uint32_t height, DepthPyramid& pyramid) {
+    pyramid.width = width;
+    pyramid.height = height;
+    pyramid.level_count = 0;
+    uint32_t offset = 0;
+    uint32_t level_width = std::max(1u, (width + 1) / 2);
+    uint32_t level_height = std::max(1u, (height + 1) / 2);
+    while (pyramid.level_count < max_depth_pyramid_levels) {
+        DepthPyramidLevel& level = pyramid.levels[pyramid.level_count++];
+        level = { offset, level_width, level_height, 0 };
+        offset += level_width * level_height;
+        if (level_width == 1 && level_height == 1) {
+            break;
+        }
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    }
+    pyramid.texels.resize(offset);
+}
+
+void build_depth_pyramid(const float* depth, const size_t row_pitch, DepthPyramid& pyramid, const unsigned thread_count) {
+    const float* source = depth;
+    size_t source_pitch = row_pitch;
+    uint32_t source_width = pyramid.width;
+    uint32_t source_height = pyramid.height;
+    for (uint32_t i = 0; i < pyramid.level_count; ++i) {
+        const DepthPyramidLevel& level = pyramid.levels[i];
+        float* destination = pyramid.texels.data() + level.offset;
+        if (static_cast<size_t>(level.width) * level.height >= parallel_level_texels) {
+            parallel_for(level.height, 8, [&](const size_t begin, const size_t end) {
+                reduce_rows(source, source_pitch, source_width, source_height, destination, level.width,
+                            static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+            }, thread_count);
+        }
+        else {
+            reduce_rows(source, source_pitch, source_width, source_height, destination, level.width, 0, level.height);
+        }
+        source = destination;
+        source_pitch = level.width;
+        source_width = level.width;
+        source_height = level.height;
+    }
+}
+
+bool outside_frustum(const OcclusionObject& object, const glm::mat4& world, const glm::mat4& view_projection) {
+    glm::vec4 corners[8];
+    clip_corners(object, world, view_projection, corners);
+    uint32_t outside = ~0u;
+    for (const glm::vec4& corner : corners) {
+        outside &= clip_outcode(corner);
+    }
+    return outside != 0;
+}
+
+OcclusionResult test_occlusion(const OcclusionObject& object, const glm::mat4& world, const glm::mat4& view_projection, const DepthPyramid& pyramid) {
+    glm::vec4 corners[8];
+    clip_corners(object, world, view_projection, corners);
+
+    // Outside if all corners are outside the same plane. A box that reaches past the near plane can't be
+    // projected, so it counts as visible.
+    uint32_t outside = ~0u;
+    bool crossing_near = false;
+    for (const glm::vec4& corner : corners) {
+        const uint32_t outcode = clip_outcode(corner);
+        outside &= outcode;
+        crossing_near |= (outcode & outcode_near) != 0 || corner.w <= 0.0f;
+    }
+    if (outside != 0) {
+        return OcclusionResult::outside_frustum;
+    }
+    if (crossing_near) {
+        return OcclusionResult::visible;
+    }
+
+    // The level 0 texels the box covers. A texel is 2 pixels, so column x / w * width / 4 + width / 4.
+    const float x_scale = static_cast<float>(pyramid.width) * 0.25f;
+    const float y_scale = static_cast<float>(pyramid.height) * 0.25f;
+    const int32_t max_x = static_cast<int32_t>(pyramid.levels[0].width) - 1;
+    const int32_t max_y = static_cast<int32_t>(pyramid.levels[0].height) - 1;
+    int32_t x_0 = max_x;
+    int32_t y_0 = max_y;
+    int32_t x_1 = 0;
+    int32_t y_1 = 0;
+    for (const glm::vec4& corner : corners) {
+        const int32_t x = floor_ratio((corner.x + corner.w) * x_scale, corner.w, max_x);
+        const int32_t y = floor_ratio((corner.w - corner.y) * y_scale, corner.w, max_y);
+        x_0 = std::min(x_0, x);
+        x_1 = std::max(x_1, x);
+        y_0 = std::min(y_0, y);
+        y_1 = std::max(y_1, y);
+    }
+
+    // The first level where that's at most 4x4 texels, and the farthest depth of those. 2x2 texels one level up
+    // would be cheaper, but can cover up to twice as much around the box, and the sky around it makes it visible.
+    uint32_t level_index = 0;
+    while (level_index + 1 < pyramid.level_count && ((x_1 >> level_index) - (x_0 >> level_index) > 3 || (y_1 >> level_index) - (y_0 >> level_index) > 3)) {
+        ++level_index;
+    }
+    const DepthPyramidLevel& level = pyramid.levels[level_index];
+    const float* texels = pyramid.texels.data() + level.offset;
+    float farthest = texels[static_cast<uint32_t>(y_0 >> level_index) * level.width + static_cast<uint32_t>(x_0 >> level_index)];
+    for (int32_t y = y_0 >> level_index; y <= (y_1 >> level_index); ++y) {
+        for (int32_t x = x_0 >> level_index; x <= (x_1 >> level_index); ++x) {
+            farthest = std::min(farthest, texels[static_cast<uint32_t>(y) * level.width + static_cast<uint32_t>(x)]);
+        }
+    }
+
+    // Hidden if every corner is farther away, z / w < farthest
+    for (const glm::vec4& corner : corners) {
+        if (!(corner.z < farthest * corner.w)) {
+            return OcclusionResult::visible;
+        }
+    }
+    return OcclusionResult::occluded;
+}
+
+void cull_occluded_objects(const OcclusionObject* objects, const uint32_t object_count, const glm::mat4* transforms, const glm::mat4& view_projection,
+                           const DepthPyramid& pyramid, uint8_t* visible, OcclusionCullStats* stats, const unsigned thread_count) {
+    std::vector<OcclusionCullStats> worker_stats(parallel_thread_count(thread_count));
+    parallel_for_with_worker(object_count, 512, [&](const size_t begin, const size_t end, const unsigned worker) {
+        OcclusionCullStats& counts = worker_stats[worker];
+        for (size_t i = begin; i < end; ++i) {
+            const OcclusionResult result = test_occlusion(objects[i], transforms[objects[i].transform_index], view_projection, pyramid);
+            visible[i] = result == OcclusionResult::visible ? 1 : 0;
+            counts.tested++;
+            counts.outside_frustum += result == OcclusionResult::outside_frustum ? 1 : 0;
+            counts.occluded += result == OcclusionResult::occluded ? 1 : 0;
+            counts.visible += visible[i];
+        }
+    }, thread_count);
+
+    if (stats) {
+        *stats = {};
+        for (const OcclusionCullStats& counts : worker_stats) {
+            stats->tested += counts.tested;
+            stats->outside_frustum += counts.outside_frustum;
+            stats->occluded += counts.occluded;
+            stats->visible += counts.visible;
+        }
+    }
+}
+
+size_t count_depth_pyramid_differences(const DepthPyramid& pyramid, const float* texels) {
+    size_t differences = 0;
+    for (size_t i = 0; i < pyramid.texels.size(); ++i) {
+        differences += memcmp(&pyramid.texels[i], &texels[i], sizeof(float)) != 0 ? 1 : 0;
+    }
+    return differences;
+}
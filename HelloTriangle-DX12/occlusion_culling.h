@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+
+/* OCCLUSION CULLING
+* Objects hidden behind other objects aren't drawn. It's done in two phases every frame, all on the GPU:
+* - Phase 1 draws the objects that were visible last frame. That's usually almost all of what's visible this frame,
+*   so the depth buffer ends up with nearly all occluders in it.
+* - The depth buffer is reduced into a depth pyramid: every texel of a level has the farthest depth of the 2x2
+*   texels under it in the level before. Level 0 is half the size of the depth buffer.
+* - Phase 2 tests every object's box against the pyramid, and draws the ones that are visible now but weren't drawn
+*   in phase 1. What it finds is the visible set for the next frame.
+* So an object that comes into view is drawn in the frame it does, and nothing ever waits for the CPU. The culling
+* shaders (see Shaders/DX12/occlusion_culling.hlsli) write the draws of both phases as ExecuteIndirect commands.
+*
+* The depth buffer uses reverse-Z (see projection.h), so the farthest depth is the smallest: the pyramid keeps the
+* minimum, and an object is hidden if its nearest point (its largest depth) is smaller than the smallest depth of
+* every pixel it could cover.
+*
+* The functions here do the same on the CPU, and give bit-identical results, so they can check the GPU:
+* - The pyramid only takes minimums, which are exact.
+* - A box is tested with mul and add only, in the same order as the shader, where every step is precise. The
+*   corners are never divided by w: a corner is in a texel column if q * w <= (x + w) * width / 4 < (q + 1) * w,
+*   and behind a depth if z < depth * w. A division only gives the first guess for q, which is then corrected.
+*   Dividing isn't exact on GPUs, multiplying and adding is.
+* - A box is tested against the texels of the first level where it covers at most 4x4 texels.
+*/
+
+// Must match occlusion_culling.hlsli
+constexpr uint32_t max_depth_pyramid_levels = 16;
+constexpr uint32_t max_occlusion_objects = 1 << 16;
+constexpr uint32_t occlusion_group_size = 64;
+constexpr uint32_t depth_pyramid_group_size = 8;
+
+// Where a level starts in the pyramid, and its size in texels
+struct DepthPyramidLevel {
+    uint32_t offset = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t padding = 0;
+};
+
+struct DepthPyramid {
+    uint32_t width = 0;                 // Of the depth buffer
+    uint32_t height = 0;
+    uint32_t level_count = 0;           // Down to 1x1
+    DepthPyramidLevel levels[max_depth_pyramid_levels];
+    std::vector<float> texels;          // Every level, level 0 first, rows top to bottom
+};
+
+// One object, as the culling shaders read it: the box around it, in the space of its transform, and its draw
+struct OcclusionObject {
+    glm::vec3 box_min;
+    uint32_t transform_index;
+    glm::vec3 box_max;
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t padding[2];
+};
+static_assert(sizeof(OcclusionObject) == 48, "OcclusionObject must match the HLSL struct");
+
+// A draw the culling shaders write, the arguments of the command signature: the transform index root constant,
+// then the arguments of DrawIndexedInstanced
+struct OcclusionDrawCommand {
+    uint32_t transform_index;
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t first_instance;
+};
+static_assert(sizeof(OcclusionDrawCommand) == 24, "OcclusionDrawCommand must match the command signature");
+
+// The constant buffer of the culling shaders
+struct OcclusionConstants {
+    glm::mat4 view_projection;          // D3D clip space, reverse-Z
+    uint32_t object_count;
+    uint32_t level_count;
+    uint32_t depth_width;
+    uint32_t depth_height;
+    DepthPyramidLevel levels[max_depth_pyramid_levels];
+};
+
+// The counters the culling shaders write, the first two are the draw counts of the two phases
+struct OcclusionCounters {
+    uint32_t early_draws = 0;
+    uint32_t late_draws = 0;
+    uint32_t outside_frustum = 0;
+    uint32_t occluded = 0;
+};
+
+enum class OcclusionResult : uint8_t {
+    visible,
+    outside_frustum,
+    occluded,
+};
+
+struct OcclusionCullStats {
+    uint32_t tested = 0;
+    uint32_t outside_frustum = 0;
+    uint32_t occluded = 0;
+    uint32_t visible = 0;
+};
+
+// Sets up the levels for a depth buffer of width x height, and makes room for the texels
+void make_depth_pyramid(uint32_t width, uint32_t height, DepthPyramid& pyramid);
+
+// Builds every level from the depth buffer, which has `row_pitch` floats per row, like depth_pyramid.cs.hlsl
+void build_depth_pyramid(const float* depth, size_t row_pitch, DepthPyramid& pyramid, unsigned thread_count = 0);
+
+// Tests a box against the pyramid, like occlusion_cull.cs.hlsl. `world` is the object's transform.
+OcclusionResult test_occlusion(const OcclusionObject& object, const glm::mat4& world, const glm::mat4& view_projection, const DepthPyramid& pyramid);
+
+// Only the frustum test, like phase 1 does
+bool outside_frustum(const OcclusionObject& object, const glm::mat4& world, const glm::mat4& view_projection);
+
+// Tests every object, and writes 1 into `visible` for the visible ones and 0 for the others, like phase 2 does
+void cull_occluded_objects(const OcclusionObject* objects, uint32_t object_count, const glm::mat4* transforms, const glm::mat4& view_projection,
+                           const DepthPyramid& pyramid, uint8_t* visible, OcclusionCullStats* stats = nullptr, unsigned thread_count = 0);
+
+// How many texels of `pyramid` differ from `texels` (usually read back from the GPU), bit for bit
+size_t count_depth_pyramid_differences(const DepthPyramid& pyramid, const float* texels);
@@ -0,0 +1,358 @@
+#include "overlay.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include "texture_atlas.h"
+
+namespace {
+    /* FONT
+    * The 8x8 font of the IBM PC BIOS, for ASCII 32 to 126 (public domain, as in font8x8 by Daniel Hepper). Every
+    * byte is a row, top to bottom, and bit 0 is the leftmost pixel.
+    */
+    constexpr uint8_t font_rows[overlay_glyph_count][8] = {
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ' '
+        { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },   // '!'
+        { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '"'
+        { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },   // '#'
+        { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },   // '$'
+        { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },   // '%'
+        { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },   // '&'
+        { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '''
+        { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },   // '('
+        { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },   // ')'
+        { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },   // '*'
+        { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },   // '+'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },   // ','
+        { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },   // '-'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },   // '.'
+        { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },   // '/'
+        { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },   // '0'
+        { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },   // '1'
+        { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },   // '2'
+        { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },   // '3'
+        { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },   // '4'
+        { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },   // '5'
+        { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },   // '6'
+        { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },   // '7'
+        { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },   // '8'
+        { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },   // '9'
+        { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },   // ':'
+        { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },   // ';'
+        { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },   // '<'
+        { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },   // '='
+        { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },   // '>'
+        { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },   // '?'
+        { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },   // '@'
+        { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },   // 'A'
+        { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },   // 'B'
+        { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },   // 'C'
+        { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },   // 'D'
+        { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },   // 'E'
+        { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },   // 'F'
+        { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },   // 'G'
+        { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },   // 'H'
+        { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // 'I'
+        { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },   // 'J'
+        { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },   // 'K'
+        { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },   // 'L'
+        { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },   // 'M'
+        { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },   // 'N'
+        { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },   // 'O'
+        { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },   // 'P'
+        { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },   // 'Q'
+        { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },   // 'R'
+        { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },   // 'S'
+        { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // 'T'
+        { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },   // 'U'
+        { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },   // 'V'
+        { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },   // 'W'
+        { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },   // 'X'
+        { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },   // 'Y'
+        { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },   // 'Z'
+        { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },   // '['
+        { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },   // '\'
+        { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },   // ']'
+        { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },   // '^'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },   // '_'
+        { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '`'
+        { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },   // 'a'
+        { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },   // 'b'
+        { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },   // 'c'
+        { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },   // 'd'
+        { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },   // 'e'
+        { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },   // 'f'
+        { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },   // 'g'
+        { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },   // 'h'
+        { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // 'i'
+        { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },   // 'j'
+        { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },   // 'k'
+        { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // 'l'
+        { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },   // 'm'
+        { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },   // 'n'
+        { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },   // 'o'
+        { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },   // 'p'
+        { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },   // 'q'
+        { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },   // 'r'
+        { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },   // 's'
+        { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },   // 't'
+        { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },   // 'u'
+        { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },   // 'v'
+        { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },   // 'w'
+        { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },   // 'x'
+        { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },   // 'y'
+        { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },   // 'z'
+        { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },   // '{'
+        { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },   // '|'
+        { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },   // '}'
+        { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '~'
+    };
+
+    constexpr uint32_t glyph_page_size = 128;
+
+    uint16_t to_unorm16(const uint32_t numerator, const uint32_t denominator) {
+        return static_cast<uint16_t>((static_cast<uint64_t>(numerator) * 65535 + denominator / 2) / denominator);
+    }
+
+    // The batch the next quads go into, a new one if the texture or the scissor changed. An empty batch at the end
+    // is reused, so there's never more than one empty batch, and only at the end.
+    OverlayBatch& current_batch(Overlay& overlay, const uint32_t texture) {
+        if (!overlay.batches.empty()) {
+            OverlayBatch& last = overlay.batches.back();
+            if (last.quad_count == 0) {
+                last.texture = texture;
+                last.scissor = overlay.scissor;
+                last.first_quad = overlay.quad_count;
+                return last;
+            }
+            if (last.texture == texture && last.scissor == overlay.scissor) {
+                return last;
+            }
+        }
+        overlay.batches.push_back(OverlayBatch{ texture, overlay.scissor, overlay.quad_count, 0 });
+        return overlay.batches.back();
+    }
+
+    // Makes room for `count` more quads, and returns where the first one goes
+    OverlayQuad* reserve_quads(Overlay& overlay, const size_t count) {
+        const size_t needed = overlay.quad_count + count;
+        if (needed > overlay.quads.size()) {
+            overlay.quads.resize(std::max(needed, overlay.quads.size() * 2));
+        }
+        return overlay.quads.data() + overlay.quad_count;
+    }
+
+    bool outside(const OverlayRect& scissor, const int32_t x0, const int32_t y0, const int32_t x1, const int32_t y1) {
+        return x1 <= scissor.left || x0 >= scissor.right || y1 <= scissor.top || y0 >= scissor.bottom;
+    }
+}
+
+bool build_overlay_font(OverlayFont& font) {
+    // Crop every glyph to the pixels it covers, as premultiplied white. The last image is the solid texel.
+    std::vector<uint8_t> glyph_pixels(static_cast<size_t>(overlay_glyph_count + 1) * 8 * 8 * 4, 0);
+    std::vector<AtlasImage> images(overlay_glyph_count + 1);
+    for (uint32_t glyph = 0; glyph < overlay_glyph_count; ++glyph) {
+        const uint8_t* rows = font_rows[glyph];
+        uint32_t min_x = 8, min_y = 8, max_x = 0, max_y = 0;
+        for (uint32_t y = 0; y < 8; ++y) {
+            for (uint32_t x = 0; x < 8; ++x) {
+                if (rows[y] & (1u << x)) {
+                    min_x = std::min(min_x, x);
+                    min_y = std::min(min_y, y);
+                    max_x = std::max(max_x, x + 1);
+                    max_y = std::max(max_y, y + 1);
+                }
+            }
+        }
+
+        OverlayGlyph& entry = font.glyphs[glyph];
+        entry = OverlayGlyph{};
+        if (max_x == 0) {
+            // Packing skips empty images
+            continue;
+        }
+        entry.x = static_cast<uint8_t>(min_x);
+        entry.y = static_cast<uint8_t>(min_y);
+        entry.width = static_cast<uint8_t>(max_x - min_x);
+        entry.height = static_cast<uint8_t>(max_y - min_y);
+
+        uint8_t* pixels = glyph_pixels.data() + static_cast<size_t>(glyph) * 8 * 8 * 4;
+        for (uint32_t y = 0; y < entry.height; ++y) {
+            for (uint32_t x = 0; x < entry.width; ++x) {
+                const uint8_t value = (rows[min_y + y] & (1u << (min_x + x))) ? 255 : 0;
+                memset(pixels + (y * entry.width + x) * 4, value, 4);
+            }
+        }
+        images[glyph] = AtlasImage{ entry.width, entry.height, pixels };
+    }
+    uint8_t* solid = glyph_pixels.data() + static_cast<size_t>(overlay_glyph_count) * 8 * 8 * 4;
+    memset(solid, 255, 4);
+    images[overlay_glyph_count] = AtlasImage{ 1, 1, solid };
+
+    // One page, point sampled at pixel centers, so a one pixel border is plenty
+    AtlasSettings settings;
+    settings.page_width = glyph_page_size;
+    settings.page_height = glyph_page_size;
+    settings.padding = 1;
+    settings.mip_levels = 1;
+    settings.max_pages = 1;
+    TextureAtlas atlas;
+    build_atlas(images, settings, atlas);
+    if (atlas.pages.size() != 1 || atlas.entries[overlay_glyph_count].page != 0) {
+        puts("[ERROR] The overlay font doesn't fit in its atlas");
+        return false;
+    }
+    for (uint32_t glyph = 0; glyph < overlay_glyph_count; ++glyph) {
+        OverlayGlyph& entry = font.glyphs[glyph];
+        const AtlasEntry& packed = atlas.entries[glyph];
+        if (entry.width == 0) {
+            continue;
+        }
+        if (packed.page != 0) {
+            puts("[ERROR] The overlay font doesn't fit in its atlas");
+            return false;
+        }
+        entry.u0 = to_unorm16(packed.x, glyph_page_size);
+        entry.v0 = to_unorm16(packed.y, glyph_page_size);
+        entry.u1 = to_unorm16(packed.x + packed.width, glyph_page_size);
+        entry.v1 = to_unorm16(packed.y + packed.height, glyph_page_size);
+    }
+    const AtlasEntry& solid_entry = atlas.entries[overlay_glyph_count];
+    font.solid_u = to_unorm16(solid_entry.x * 2 + 1, glyph_page_size * 2);
+    font.solid_v = to_unorm16(solid_entry.y * 2 + 1, glyph_page_size * 2);
+
+    font.atlas_width = glyph_page_size;
+    font.atlas_height = glyph_page_size;
+    font.atlas_pixels = std::move(atlas.pages[0].pixels);
+    return true;
+}
+
+void begin_overlay(Overlay& overlay, const OverlayFont& font, const uint32_t width, const uint32_t height, const int32_t text_scale) {
+    overlay.font = &font;
+    overlay.screen = OverlayRect{ 0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height) };
+    overlay.scissor = overlay.screen;
+    overlay.text_scale = std::max(text_scale, 1);
+    overlay.quad_count = 0;
+    overlay.batches.clear();
+    overlay.culled = 0;
+}
+
+void set_overlay_scissor(Overlay& overlay, const OverlayRect& scissor) {
+    overlay.scissor.left = std::clamp(scissor.left, overlay.screen.left, overlay.screen.right);
+    overlay.scissor.top = std::clamp(scissor.top, overlay.screen.top, overlay.screen.bottom);
+    overlay.scissor.right = std::clamp(scissor.right, overlay.scissor.left, overlay.screen.right);
+    overlay.scissor.bottom = std::clamp(scissor.bottom, overlay.scissor.top, overlay.screen.bottom);
+}
+
+void reset_overlay_scissor(Overlay& overlay) {
+    overlay.scissor = overlay.screen;
+}
+
+void add_overlay_rect(Overlay& overlay, const int32_t x, const int32_t y, const int32_t width, const int32_t height, const uint32_t color) {
+    // The whole rectangle has the same texel, so it can be clipped here without touching its texture coordinates,
+    // which also keeps huge rectangles in range of the 16-bit positions
+    const OverlayRect& scissor = overlay.scissor;
+    const int32_t x0 = std::max(x, scissor.left);
+    const int32_t y0 = std::max(y, scissor.top);
+    const int32_t x1 = std::min(x + width, scissor.right);
+    const int32_t y1 = std::min(y + height, scissor.bottom);
+    if (x0 >= x1 || y0 >= y1) {
+        overlay.culled++;
+        return;
+    }
+
+    OverlayBatch& batch = current_batch(overlay, overlay_font_texture);
+    const uint16_t u = overlay.font->solid_u;
+    const uint16_t v = overlay.font->solid_v;
+    *reserve_quads(overlay, 1) = OverlayQuad{ static_cast<int16_t>(x0), static_cast<int16_t>(y0), static_cast<int16_t>(x1), static_cast<int16_t>(y1),
+                                              u, v, u, v, color };
+    overlay.quad_count++;
+    batch.quad_count++;
+}
+
+void add_overlay_image(Overlay& overlay, const uint32_t texture, const int32_t x, const int32_t y, const int32_t width, const int32_t height,
+                       const uint16_t u0, const uint16_t v0, const uint16_t u1, const uint16_t v1, const uint32_t color) {
+    if (width <= 0 || height <= 0 || outside(overlay.scissor, x, y, x + width, y + height)) {
+        overlay.culled++;
+        return;
+    }
+
+    OverlayBatch& batch = current_batch(overlay, texture);
+    *reserve_quads(overlay, 1) = OverlayQuad{ static_cast<int16_t>(x), static_cast<int16_t>(y), static_cast<int16_t>(x + width),
+                                              static_cast<int16_t>(y + height), u0, v0, u1, v1, color };
+    overlay.quad_count++;
+    batch.quad_count++;
+}
+
+int32_t add_overlay_text(Overlay& overlay, const int32_t x, const int32_t y, const char* text, const uint32_t color) {
+    return add_overlay_text(overlay, x, y, text, strlen(text), color);
+}
+
+int32_t add_overlay_text(Overlay& overlay, const int32_t x, int32_t y, const char* text, const size_t length, const uint32_t color) {
+    const OverlayGlyph* glyphs = overlay.font->glyphs;
+    const OverlayRect& scissor = overlay.scissor;
+    const int32_t scale = overlay.text_scale;
+    const int32_t advance = overlay_glyph_advance * scale;
+    const int32_t line_height = overlay_line_height * scale;
+
+    // At most one quad per character
+    OverlayBatch& batch = current_batch(overlay, overlay_font_texture);
+    OverlayQuad* const first = reserve_quads(overlay, length);
+    OverlayQuad* quad = first;
+    int32_t pen = x;
+    bool line_visible = y + 8 * scale > scissor.top && y < scissor.bottom;
+    for (size_t i = 0; i < length; ++i) {
+        const uint32_t character = static_cast<uint8_t>(text[i]);
+        if (character == '\n') {
+            pen = x;
+            y += line_height;
+            line_visible = y + 8 * scale > scissor.top && y < scissor.bottom;
+            continue;
+        }
+
+        const uint32_t index = character - overlay_first_glyph;
+        const OverlayGlyph& glyph = glyphs[index < overlay_glyph_count ? index : '?' - overlay_first_glyph];
+        const int32_t x0 = pen + glyph.x * scale;
+        pen += advance;
+        if (glyph.width == 0) {
+            continue;
+        }
+        const int32_t x1 = x0 + glyph.width * scale;
+        if (!line_visible || x1 <= scissor.left || x0 >= scissor.right) {
+            overlay.culled++;
+            continue;
+        }
+        const int32_t y0 = y + glyph.y * scale;
+        *quad++ = OverlayQuad{ static_cast<int16_t>(x0), static_cast<int16_t>(y0), static_cast<int16_t>(x1),
+                               static_cast<int16_t>(y0 + glyph.height * scale), glyph.u0, glyph.v0, glyph.u1, glyph.v1, color };
+    }
+
+    const uint32_t added = static_cast<uint32_t>(quad - first);
+    overlay.quad_count += added;
+    batch.quad_count += added;
+    return pen;
+}
+
+int32_t add_overlay_textf(Overlay& overlay, const int32_t x, const int32_t y, const uint32_t color, const char* format, ...) {
+    char text[256];
+    va_list arguments;
+    va_start(arguments, format);
+    const int length = vsnprintf(text, sizeof(text), format, arguments);
+    va_end(arguments);
+    if (length <= 0) {
+        return x;
+    }
+    return add_overlay_text(overlay, x, y, text, std::min(static_cast<size_t>(length), sizeof(text) - 1), color);
+}
+
+OverlayStats overlay_stats(const Overlay& overlay) {
+    OverlayStats stats;
+    stats.quads = overlay.quad_count;
+    stats.batches = static_cast<uint32_t>(overlay.batches.size());
+    if (!overlay.batches.empty() && overlay.batches.back().quad_count == 0) {
+        stats.batches--;
+    }
+    stats.culled = overlay.culled;
+    return stats;
+}
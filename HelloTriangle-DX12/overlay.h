@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* OVERLAY
+* Text and rectangles drawn over the frame, in pixels, for the frame stats and debug text. Every rectangle is one
+* quad, and every quad is one instance of a strip of 4 vertices, so a quad is 20 bytes and nothing else. The quads
+* of a frame are accumulated in one array, copied into the upload ring in one go, and drawn with one draw per
+* batch: a run of quads with the same texture and the same scissor rectangle. A new batch only starts when either
+* one changes, so the whole overlay usually is one or two draws, no matter how much text it has.
+*
+* Text uses a built-in 8x8 bitmap font. At startup, the glyphs are cropped to the pixels they cover and packed into
+* a glyph atlas (see texture_atlas.h), together with one solid texel, so plain rectangles use the same texture as
+* the text and don't break the batch. Glyphs without pixels, like the space, don't make a quad at all. Quads that
+* are completely outside the scissor rectangle are dropped on the CPU, the rest is clipped by the GPU.
+*/
+
+constexpr uint32_t overlay_first_glyph = 32;           // Printable ASCII, 32 to 126
+constexpr uint32_t overlay_glyph_count = 95;
+constexpr int32_t overlay_glyph_advance = 8;           // In pixels, before scaling
+constexpr int32_t overlay_line_height = 10;
+constexpr uint32_t overlay_font_texture = 0;           // The glyph atlas is always the first overlay texture
+
+// One quad, as the overlay vertex shader reads it per instance. Positions are in pixels from the top left of the
+// screen, texture coordinates are 0 to 65535 across the texture.
+struct OverlayQuad {
+    int16_t x0, y0, x1, y1;
+    uint16_t u0, v0, u1, v1;
+    uint32_t color;                     // RGBA8, premultiplied alpha
+};
+static_assert(sizeof(OverlayQuad) == 20, "OverlayQuad must match the input layout");
+
+// In pixels, like a D3D12_RECT: left and top are inside, right and bottom are not
+struct OverlayRect {
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+
+    bool operator==(const OverlayRect& other) const {
+        return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+    }
+    bool operator!=(const OverlayRect& other) const { return !(*this == other); }
+};
+
+// Quads [first_quad, first_quad + quad_count), drawn with one draw
+struct OverlayBatch {
+    uint32_t texture = overlay_font_texture;
+    OverlayRect scissor;
+    uint32_t first_quad = 0;
+    uint32_t quad_count = 0;
+};
+
+struct OverlayGlyph {
+    uint16_t u0, v0, u1, v1;            // In the atlas
+    uint8_t x, y;                       // Where the cropped glyph starts in its 8x8 cell
+    uint8_t width, height;              // 0 for glyphs without any pixels
+};
+
+struct OverlayFont {
+    uint32_t atlas_width = 0;
+    uint32_t atlas_height = 0;
+    std::vector<uint8_t> atlas_pixels;  // RGBA8, premultiplied white
+    OverlayGlyph glyphs[overlay_glyph_count]{};
+    uint16_t solid_u = 0;               // The middle of a texel that's fully covered, for plain rectangles
+    uint16_t solid_v = 0;
+};
+
+struct OverlayStats {
+    uint32_t quads = 0;
+    uint32_t batches = 0;
+    uint32_t culled = 0;                // Quads that were completely outside their scissor rectangle
+};
+
+struct Overlay {
+    const OverlayFont* font = nullptr;
+    OverlayRect screen;
+    OverlayRect scissor;
+    int32_t text_scale = 1;
+
+    // Kept between frames, so building doesn't allocate. Only the first quad_count quads are used.
+    std::vector<OverlayQuad> quads;
+    uint32_t quad_count = 0;
+    std::vector<OverlayBatch> batches;  // The last one can be empty
+    uint32_t culled = 0;
+};
+
+// Packs the glyphs of the built-in font into an atlas. Returns false if they don't fit, which they always do.
+bool build_overlay_font(OverlayFont& font);
+
+// Packs a color into an RGBA8 quad color, with premultiplied alpha
+constexpr uint32_t overlay_color(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a = 255) {
+    return static_cast<uint32_t>(r * a / 255) | static_cast<uint32_t>(g * a / 255) << 8 | static_cast<uint32_t>(b * a / 255) << 16
+        | static_cast<uint32_t>(a) << 24;
+}
+
+// Clears the overlay for a new frame, for a screen of `width` by `height` pixels. Text is drawn `text_scale` times
+// the size of the font. The scissor starts out as the whole screen.
+void begin_overlay(Overlay& overlay, const OverlayFont& font, uint32_t width, uint32_t height, int32_t text_scale = 1);
+
+// Clips everything that's added after it, the rectangle is clipped to the screen first
+void set_overlay_scissor(Overlay& overlay, const OverlayRect& scissor);
+void reset_overlay_scissor(Overlay& overlay);
+
+// A plain rectangle
+void add_overlay_rect(Overlay& overlay, int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color);
+
+// A rectangle with another texture on it, `texture` is an index into the overlay's textures
+void add_overlay_image(Overlay& overlay, uint32_t texture, int32_t x, int32_t y, int32_t width, int32_t height,
+                       uint16_t u0, uint16_t v0, uint16_t u1, uint16_t v1, uint32_t color);
+
+// Draws text with its top left corner at (x, y). '\n' starts a new line under x, characters the font doesn't have
+// are drawn as '?'. Returns the x where the next character would go.
+int32_t add_overlay_text(Overlay& overlay, int32_t x, int32_t y, const char* text, uint32_t color);
+int32_t add_overlay_text(Overlay& overlay, int32_t x, int32_t y, const char* text, size_t length, uint32_t color);
+
+// Same, with printf formatting, up to 255 characters
+int32_t add_overlay_textf(Overlay& overlay, int32_t x, int32_t y, uint32_t color, const char* format, ...);
+
+OverlayStats overlay_stats(const Overlay& overlay);
@@ -0,0 +1,55 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// How many threads parallel_for will use, 0 means all hardware threads
+inline unsigned parallel_thread_count(unsigned thread_count = 0) {
+    return thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/* PARALLEL FOR
+* Runs function(begin, end) over [0, count) on all hardware threads. Work is handed out in chunks from an
+* atomic counter, so threads that finish early take more chunks instead of sitting idle.
+* The calling thread helps out too, and the function returns once all work is done.
+*
+* parallel_for_with_worker also passes the index of the thread that runs the chunk (the calling thread is 0),
+* so the function can use per-thread state without locking. Every thread takes its chunks in increasing order.
+*/
+template <typename Function>
+void parallel_for_with_worker(const size_t count, const size_t chunk_size, const Function& function, unsigned thread_count = 0) {
+    if (count == 0) {
+        return;
+    }
+    thread_count = parallel_thread_count(thread_count);
+    const size_t chunk = std::max<size_t>(1, chunk_size);
+    const size_t chunk_count = (count + chunk - 1) / chunk;
+    thread_count = static_cast<unsigned>(std::min<size_t>(thread_count, chunk_count));
+
+    std::atomic<size_t> next_chunk{ 0 };
+    const auto worker = [&](const unsigned worker_index) {
+        for (size_t i = next_chunk++; i < chunk_count; i = next_chunk++) {
+            const size_t begin = i * chunk;
+            function(begin, std::min(begin + chunk, count), worker_index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (unsigned i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+template <typename Function>
+void parallel_for(const size_t count, const size_t chunk_size, const Function& function, unsigned thread_count = 0) {
+    parallel_for_with_worker(count, chunk_size, [&](const size_t begin, const size_t end, unsigned) {
+        function(begin, end);
+    }, thread_count);
+}
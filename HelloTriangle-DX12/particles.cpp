@@ -0,0 +1,431 @@
+#include "particles.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "parallel_for.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_SSE2 1
+#include <emmintrin.h>
+#else
+#define PARTICLES_SSE2 0
+#endif
+
+namespace {
+    constexpr size_t particle_chunk_size = 16384;   // A multiple of 4
+    constexpr size_t spawn_chunk_size = 4096;
+
+    // How many bits are set in a 4-bit mask
+    constexpr uint8_t mask_population[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    // A good 32-bit integer hash (lowbias32). Same as particle_hash() in particles.hlsli.
+    uint32_t particle_hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Random value `k` (0 to 3) of an emitter's particle, in [0, 1). Exact, since it has only 24 bits.
+    float particle_random(const uint32_t seed, const uint32_t sequence, const uint32_t k) {
+        return static_cast<float>(static_cast<int32_t>(particle_hash(seed ^ particle_hash(sequence * 4 + k)) >> 8)) * (1.0f / 16777216.0f);
+    }
+
+    void resize_arrays(ParticleArrays& arrays, const size_t size) {
+        for (auto* values : { &arrays.position_x, &arrays.position_y, &arrays.position_z, &arrays.velocity_x, &arrays.velocity_y,
+                              &arrays.velocity_z, &arrays.age, &arrays.lifetime, &arrays.size }) {
+            values->assign(size, 0.0f);
+        }
+        arrays.color.assign(size, 0);
+    }
+
+    // Moves particle `from` of `source` to `to` of `destination`, integrated
+    void integrate_particle(const ParticleArrays& source, const size_t from, ParticleArrays& destination, const size_t to,
+                            const glm::vec3& velocity_step, const float delta_time) {
+        const float velocity_x = source.velocity_x[from] + velocity_step.x;
+        const float velocity_y = source.velocity_y[from] + velocity_step.y;
+        const float velocity_z = source.velocity_z[from] + velocity_step.z;
+        destination.position_x[to] = source.position_x[from] + velocity_x * delta_time;
+        destination.position_y[to] = source.position_y[from] + velocity_y * delta_time;
+        destination.position_z[to] = source.position_z[from] + velocity_z * delta_time;
+        destination.velocity_x[to] = velocity_x;
+        destination.velocity_y[to] = velocity_y;
+        destination.velocity_z[to] = velocity_z;
+        destination.age[to] = source.age[from] + delta_time;
+        destination.lifetime[to] = source.lifetime[from];
+        destination.size[to] = source.size[from];
+        destination.color[to] = source.color[from];
+    }
+
+    // Writes particle `sequence` of an emitter to `index`
+    void spawn_particle(ParticleArrays& particles, const size_t index, const ParticleEmitter& emitter, const uint32_t sequence) {
+        particles.position_x[index] = emitter.position.x;
+        particles.position_y[index] = emitter.position.y;
+        particles.position_z[index] = emitter.position.z;
+        particles.velocity_x[index] = (particle_random(emitter.seed, sequence, 0) * 2.0f - 1.0f) * emitter.velocity_spread + emitter.velocity.x;
+        particles.velocity_y[index] = (particle_random(emitter.seed, sequence, 1) * 2.0f - 1.0f) * emitter.velocity_spread + emitter.velocity.y;
+        particles.velocity_z[index] = (particle_random(emitter.seed, sequence, 2) * 2.0f - 1.0f) * emitter.velocity_spread + emitter.velocity.z;
+        particles.age[index] = 0.0f;
+        particles.lifetime[index] = (particle_random(emitter.seed, sequence, 3) * 0.5f + 0.75f) * emitter.lifetime;
+        particles.size[index] = emitter.size;
+        particles.color[index] = emitter.color;
+    }
+
+#if PARTICLES_SSE2
+    // SSE2 has no 32-bit multiply that keeps the low half, so multiply the even and the odd lanes separately
+    __m128i multiply_low(const __m128i a, const __m128i b) {
+        const __m128i even = _mm_mul_epu32(a, b);
+        const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    __m128i particle_hash_4(__m128i x) {
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        x = multiply_low(x, _mm_set1_epi32(0x7feb352d));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+        x = multiply_low(x, _mm_set1_epi32(static_cast<int>(0x846ca68bu)));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        return x;
+    }
+
+    __m128 particle_random_4(const __m128i seed, const __m128i sequence_times_4, const uint32_t k) {
+        const __m128i hash = particle_hash_4(_mm_xor_si128(seed, particle_hash_4(_mm_add_epi32(sequence_times_4, _mm_set1_epi32(static_cast<int>(k))))));
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(hash, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+    }
+#endif
+}
+
+void init_particle_system(ParticleSystem& system, const uint32_t capacity, const uint32_t emitter_count) {
+    system.capacity = std::min(capacity, max_particles);
+    system.count = 0;
+    resize_arrays(system.particles, system.capacity);
+    resize_arrays(system.compacted, system.capacity);
+    system.emitters.assign(emitter_count, ParticleEmitterState{});
+}
+
+uint32_t plan_particle_spawns(ParticleSystem& system, const ParticleEmitter* emitters, const float delta_time, std::vector<ParticleSpawn>& spawns) {
+    spawns.clear();
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(system.emitters.size()); ++i) {
+        ParticleEmitterState& state = system.emitters[i];
+        state.spawn_debt += emitters[i].rate * delta_time;
+        if (state.spawn_debt < 1.0f) {
+            continue;
+        }
+        const uint32_t count = static_cast<uint32_t>(state.spawn_debt);
+        state.spawn_debt -= static_cast<float>(count);
+        spawns.push_back(ParticleSpawn{ i, total, count, state.spawned });
+        state.spawned += count;
+        total += count;
+    }
+    return total;
+}
+
+/* INTEGRATION
+* First every chunk counts its survivors, which only needs the ages and lifetimes. A prefix sum over the chunks
+* gives every chunk its first place in the compacted arrays, then every chunk integrates its particles and writes
+* the survivors there. Most groups of 4 particles have no dead particle in them, those are written with one SSE2
+* store per array. Chunks are in order, and so are the particles in a chunk, so the result doesn't depend on the
+* threads. The age test has to be the same in both passes: age + dt < lifetime.
+*/
+void integrate_particles(ParticleSystem& system, const glm::vec3& velocity_step, const float delta_time, ParticleStepStats* stats,
+                         const unsigned thread_count) {
+    const size_t count = system.count;
+    const size_t chunk_count = (count + particle_chunk_size - 1) / particle_chunk_size;
+    system.chunk_offsets.assign(chunk_count + 1, 0);
+    const ParticleArrays& source = system.particles;
+    ParticleArrays& destination = system.compacted;
+
+    // Count
+    parallel_for(count, particle_chunk_size, [&](const size_t begin, const size_t end) {
+        uint32_t alive = 0;
+        size_t i = begin;
+#if PARTICLES_SSE2
+        const __m128 dt = _mm_set1_ps(delta_time);
+        for (; i + 4 <= end; i += 4) {
+            const __m128 age = _mm_add_ps(_mm_loadu_ps(&source.age[i]), dt);
+            alive += mask_population[_mm_movemask_ps(_mm_cmplt_ps(age, _mm_loadu_ps(&source.lifetime[i])))];
+        }
+#endif
+        for (; i < end; ++i) {
+            alive += source.age[i] + delta_time < source.lifetime[i] ? 1 : 0;
+        }
+        system.chunk_offsets[begin / particle_chunk_size + 1] = alive;
+    }, thread_count);
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        system.chunk_offsets[chunk + 1] += system.chunk_offsets[chunk];
+    }
+    const uint32_t alive_count = system.chunk_offsets[chunk_count];
+
+    // Integrate and compact
+    parallel_for(count, particle_chunk_size, [&](const size_t begin, const size_t end) {
+        size_t out = system.chunk_offsets[begin / particle_chunk_size];
+        size_t i = begin;
+#if PARTICLES_SSE2
+        const __m128 dt = _mm_set1_ps(delta_time);
+        const __m128 step_x = _mm_set1_ps(velocity_step.x);
+        const __m128 step_y = _mm_set1_ps(velocity_step.y);
+        const __m128 step_z = _mm_set1_ps(velocity_step.z);
+        for (; i + 4 <= end; i += 4) {
+            const __m128 age = _mm_add_ps(_mm_loadu_ps(&source.age[i]), dt);
+            const __m128 lifetime = _mm_loadu_ps(&source.lifetime[i]);
+            const uint32_t alive = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(age, lifetime)));
+            if (alive == 0) {
+                continue;
+            }
+            if (alive != 0xf) {
+                // Rare, so one at a time
+                for (uint32_t lane = 0; lane < 4; ++lane) {
+                    if ((alive >> lane) & 1) {
+                        integrate_particle(source, i + lane, destination, out++, velocity_step, delta_time);
+                    }
+                }
+                continue;
+            }
+            const __m128 velocity_x = _mm_add_ps(_mm_loadu_ps(&source.velocity_x[i]), step_x);
+            const __m128 velocity_y = _mm_add_ps(_mm_loadu_ps(&source.velocity_y[i]), step_y);
+            const __m128 velocity_z = _mm_add_ps(_mm_loadu_ps(&source.velocity_z[i]), step_z);
+            _mm_storeu_ps(&destination.position_x[out], _mm_add_ps(_mm_loadu_ps(&source.position_x[i]), _mm_mul_ps(velocity_x, dt)));
+            _mm_storeu_ps(&destination.position_y[out], _mm_add_ps(_mm_loadu_ps(&source.position_y[i]), _mm_mul_ps(velocity_y, dt)));
+            _mm_storeu_ps(&destination.position_z[out], _mm_add_ps(_mm_loadu_ps(&source.position_z[i]), _mm_mul_ps(velocity_z, dt)));
+            _mm_storeu_ps(&destination.velocity_x[out], velocity_x);
+            _mm_storeu_ps(&destination.velocity_y[out], velocity_y);
+            _mm_storeu_ps(&destination.velocity_z[out], velocity_z);
+            _mm_storeu_ps(&destination.age[out], age);
+            _mm_storeu_ps(&destination.lifetime[out], lifetime);
+            _mm_storeu_ps(&destination.size[out], _mm_loadu_ps(&source.size[i]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination.color[out]), _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source.color[i])));
+            out += 4;
+        }
+#endif
+        for (; i < end; ++i) {
+            if (source.age[i] + delta_time < source.lifetime[i]) {
+                integrate_particle(source, i, destination, out++, velocity_step, delta_time);
+            }
+        }
+    }, thread_count);
+
+    std::swap(system.particles, system.compacted);
+    if (stats) {
+        stats->killed += system.count - alive_count;
+    }
+    system.count = alive_count;
+}
+
+/* SPAWNING
+* Split over the particles, not the emitters: with a small step, most emitters spawn one particle or none, so
+* going emitter by emitter would hardly ever have 4 particles to do at once. Every chunk finds the spawn its first
+* particle belongs to, then walks along. The hashes are the expensive part, those are done 4 at a time, with the
+* emitter values of the 4 particles gathered into vectors.
+*/
+void spawn_particles(ParticleSystem& system, const ParticleEmitter* emitters, const ParticleSpawn* spawns, const uint32_t spawn_count,
+                     ParticleStepStats* stats, const unsigned thread_count) {
+    if (spawn_count == 0) {
+        return;
+    }
+    const uint32_t total = spawns[spawn_count - 1].first + spawns[spawn_count - 1].count;
+    const uint32_t fits = std::min(total, system.capacity - system.count);
+    const uint32_t first_index = system.count;
+    ParticleArrays& particles = system.particles;
+
+    parallel_for(fits, spawn_chunk_size, [&](const size_t begin, const size_t end) {
+        // The last spawn that starts at or before `begin`
+        const ParticleSpawn* spawn = std::upper_bound(spawns, spawns + spawn_count, static_cast<uint32_t>(begin),
+            [](const uint32_t particle, const ParticleSpawn& other) { return particle < other.first; }) - 1;
+        const auto advance = [&](const size_t particle) {
+            while (particle >= spawn->first + spawn->count) {
+                ++spawn;
+            }
+            return spawn;
+        };
+
+        size_t i = begin;
+#if PARTICLES_SSE2
+        for (; i + 4 <= end; i += 4) {
+            const ParticleEmitter* lane_emitters[4];
+            uint32_t sequences[4];
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                const ParticleSpawn* lane_spawn = advance(i + lane);
+                lane_emitters[lane] = &emitters[lane_spawn->emitter];
+                sequences[lane] = lane_spawn->sequence + static_cast<uint32_t>(i + lane - lane_spawn->first);
+            }
+            const auto gather = [&](const float ParticleEmitter::* value) {
+                return _mm_setr_ps(lane_emitters[0]->*value, lane_emitters[1]->*value, lane_emitters[2]->*value, lane_emitters[3]->*value);
+            };
+            const auto gather_vector = [&](const glm::vec3 ParticleEmitter::* value, const int axis) {
+                return _mm_setr_ps((lane_emitters[0]->*value)[axis], (lane_emitters[1]->*value)[axis], (lane_emitters[2]->*value)[axis], (lane_emitters[3]->*value)[axis]);
+            };
+            const __m128i seed = _mm_setr_epi32(static_cast<int>(lane_emitters[0]->seed), static_cast<int>(lane_emitters[1]->seed),
+                                                static_cast<int>(lane_emitters[2]->seed), static_cast<int>(lane_emitters[3]->seed));
+            const __m128i sequence_times_4 = _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sequences)), 2);
+            const __m128 spread = gather(&ParticleEmitter::velocity_spread);
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 two = _mm_set1_ps(2.0f);
+
+            const size_t index = first_index + i;
+            _mm_storeu_ps(&particles.position_x[index], gather_vector(&ParticleEmitter::position, 0));
+            _mm_storeu_ps(&particles.position_y[index], gather_vector(&ParticleEmitter::position, 1));
+            _mm_storeu_ps(&particles.position_z[index], gather_vector(&ParticleEmitter::position, 2));
+            _mm_storeu_ps(&particles.velocity_x[index], _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(particle_random_4(seed, sequence_times_4, 0), two), one), spread),
+                                                                   gather_vector(&ParticleEmitter::velocity, 0)));
+            _mm_storeu_ps(&particles.velocity_y[index], _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(particle_random_4(seed, sequence_times_4, 1), two), one), spread),
+                                                                   gather_vector(&ParticleEmitter::velocity, 1)));
+            _mm_storeu_ps(&particles.velocity_z[index], _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(particle_random_4(seed, sequence_times_4, 2), two), one), spread),
+                                                                   gather_vector(&ParticleEmitter::velocity, 2)));
+            _mm_storeu_ps(&particles.age[index], _mm_setzero_ps());
+            _mm_storeu_ps(&particles.lifetime[index], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(particle_random_4(seed, sequence_times_4, 3), _mm_set1_ps(0.5f)), _mm_set1_ps(0.75f)),
+                                                                 gather(&ParticleEmitter::lifetime)));
+            _mm_storeu_ps(&particles.size[index], gather(&ParticleEmitter::size));
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                particles.color[index + lane] = lane_emitters[lane]->color;
+            }
+        }
+#endif
+        for (; i < end; ++i) {
+            const ParticleSpawn* particle_spawn = advance(i);
+            spawn_particle(particles, first_index + i, emitters[particle_spawn->emitter],
+                           particle_spawn->sequence + static_cast<uint32_t>(i - particle_spawn->first));
+        }
+    }, thread_count);
+
+    system.count += fits;
+    if (stats) {
+        stats->spawned += fits;
+        stats->dropped += total - fits;
+    }
+}
+
+void step_particles(ParticleSystem& system, const ParticleEmitter* emitters, const glm::vec3& gravity, const float delta_time,
+                    ParticleStepStats* stats, const unsigned thread_count) {
+    plan_particle_spawns(system, emitters, delta_time, system.spawns);
+    integrate_particles(system, gravity * delta_time, delta_time, stats, thread_count);
+    spawn_particles(system, emitters, system.spawns.data(), static_cast<uint32_t>(system.spawns.size()), stats, thread_count);
+}
+
+/* DEPTH SORT
+* Back to front is from the most negative view space z to the least. The depths are mapped to 16-bit integers
+* between the nearest and the furthest particle, which is plenty to blend in the right order, and an LSD radix sort
+* sorts them in two passes of 8 bits. 256 buckets keep the scattered writes of a pass in the cache, a lot more
+* would make the sort slower, not faster. The depth and the particle index are sorted together as one 64-bit
+* value, so every pass only scatters one array. Radix sorts are stable, so particles at the same depth keep their
+* order, and it doesn't flicker between frames.
+*/
+void sort_particles_by_depth(ParticleSystem& system, const glm::mat4& view, std::vector<uint32_t>& order, const unsigned thread_count) {
+    const uint32_t count = system.count;
+    order.resize(count);
+    if (count == 0) {
+        return;
+    }
+    system.sort_depths.resize(count);
+    system.sort_items[0].resize(count);
+    system.sort_items[1].resize(count);
+
+    // Depths and their range per chunk, and the billboards
+    const ParticleArrays& particles = system.particles;
+    float* depths = system.sort_depths.data();
+    system.sort_instances.resize(count);
+    ParticleInstance* instances = system.sort_instances.data();
+    const size_t chunk_count = (count + particle_chunk_size - 1) / particle_chunk_size;
+    std::vector<glm::vec2> chunk_ranges(chunk_count);
+    parallel_for(count, particle_chunk_size, [&](const size_t begin, const size_t end) {
+        float minimum = FLT_MAX;
+        float maximum = -FLT_MAX;
+        size_t i = begin;
+#if PARTICLES_SSE2
+        const __m128 row_x = _mm_set1_ps(view[0][2]);
+        const __m128 row_y = _mm_set1_ps(view[1][2]);
+        const __m128 row_z = _mm_set1_ps(view[2][2]);
+        const __m128 row_w = _mm_set1_ps(view[3][2]);
+        __m128 minimum_4 = _mm_set1_ps(FLT_MAX);
+        __m128 maximum_4 = _mm_set1_ps(-FLT_MAX);
+        for (; i + 4 <= end; i += 4) {
+            const __m128 z = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row_x, _mm_loadu_ps(&particles.position_x[i])),
+                _mm_mul_ps(row_y, _mm_loadu_ps(&particles.position_y[i]))), _mm_mul_ps(row_z, _mm_loadu_ps(&particles.position_z[i]))), row_w);
+            _mm_storeu_ps(&depths[i], z);
+            minimum_4 = _mm_min_ps(minimum_4, z);
+            maximum_4 = _mm_max_ps(maximum_4, z);
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, minimum_4);
+        minimum = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        _mm_storeu_ps(lanes, maximum_4);
+        maximum = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+        for (size_t j = begin; j < end; ++j) {
+            ParticleInstance instance;
+            instance.position = glm::vec3(particles.position_x[j], particles.position_y[j], particles.position_z[j]);
+            instance.size = particles.size[j];
+            instance.color = particles.color[j];
+            instances[j] = instance;
+        }
+        for (; i < end; ++i) {
+            depths[i] = ((view[0][2] * particles.position_x[i] + view[1][2] * particles.position_y[i]) + view[2][2] * particles.position_z[i]) + view[3][2];
+            minimum = std::min(minimum, depths[i]);
+            maximum = std::max(maximum, depths[i]);
+        }
+        chunk_ranges[begin / particle_chunk_size] = glm::vec2(minimum, maximum);
+    }, thread_count);
+    glm::vec2 range = chunk_ranges[0];
+    for (const glm::vec2& chunk_range : chunk_ranges) {
+        range = glm::vec2(std::min(range.x, chunk_range.x), std::max(range.y, chunk_range.y));
+    }
+
+    // Keys, with the particle index in the low half, and the histograms of both digits
+    const float scale = range.y > range.x ? 65535.0f / (range.y - range.x) : 0.0f;
+    uint64_t* items = system.sort_items[0].data();
+    uint32_t histograms[2][256] = {};
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t key = std::min(static_cast<uint32_t>((depths[i] - range.x) * scale), 65535u);
+        items[i] = static_cast<uint64_t>(key) << 32 | i;
+        histograms[0][key & 0xff]++;
+        histograms[1][key >> 8]++;
+    }
+
+    for (uint32_t pass = 0; pass < 2; ++pass) {
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histograms[pass]) {
+            const uint32_t bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+        const uint64_t* source = system.sort_items[pass].data();
+        uint64_t* destination = system.sort_items[pass ^ 1].data();
+        const uint32_t shift = 32 + pass * 8;
+        for (uint32_t i = 0; i < count; ++i) {
+            destination[histograms[pass][(source[i] >> shift) & 0xff]++] = source[i];
+        }
+    }
+    const uint64_t* sorted = system.sort_items[0].data();
+    for (uint32_t i = 0; i < count; ++i) {
+        order[i] = static_cast<uint32_t>(sorted[i]);
+    }
+}
+
+void write_particle_instances(const ParticleSystem& system, const uint32_t* order, const uint32_t count, ParticleInstance* instances,
+                              const unsigned thread_count) {
+    const ParticleInstance* unsorted = system.sort_instances.data();
+    parallel_for(count, particle_chunk_size, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            instances[i] = unsorted[order[i]];
+        }
+    }, thread_count);
+}
+
+size_t count_particle_differences(const ParticleSystem& system, const GpuParticle* gpu_particles, const uint32_t count) {
+    const ParticleArrays& particles = system.particles;
+    size_t differences = 0;
+    for (uint32_t i = 0; i < std::min(count, system.count); ++i) {
+        GpuParticle expected{};
+        expected.position = glm::vec3(particles.position_x[i], particles.position_y[i], particles.position_z[i]);
+        expected.age = particles.age[i];
+        expected.velocity = glm::vec3(particles.velocity_x[i], particles.velocity_y[i], particles.velocity_z[i]);
+        expected.lifetime = particles.lifetime[i];
+        expected.size = particles.size[i];
+        expected.color = particles.color[i];
+        differences += memcmp(&expected, &gpu_particles[i], sizeof(GpuParticle)) != 0 ? 1 : 0;
+    }
+    return differences + (std::max(count, system.count) - std::min(count, system.count));
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+
+/* PARTICLES
+* Particles are kept as a structure of arrays, one array per value, so a step only loads what it needs, 4 particles
+* at a time with SSE2. A step does three things:
+* - Integrate: velocity += gravity * dt, position += velocity * dt, age += dt
+* - Kill: particles that got older than their lifetime are removed, by writing the ones that are left to the other
+*   of two sets of arrays, in order (stream compaction). To do that on all threads, the survivors of every chunk are
+*   counted first, then a prefix sum over the chunks gives every chunk the place to write its survivors.
+* - Spawn: every emitter spawns rate * dt particles (the rest carries over to the next step), appended after the
+*   survivors in emitter order. Their random values come from a hash of the emitter's seed and how many particles
+*   it spawned before, so they don't depend on the thread, or on SSE2.
+* The spawns of a step are planned first, and the plan can be uploaded, so the same step can run on the GPU (see
+* Shaders/DX12/particles.hlsli), which gives exactly the same particles in the same order: the math is the same,
+* with the same float operations in the same order, and the GPU compacts with the same prefix sums.
+*
+* For alpha blending, particles have to be drawn back to front. sort_particles_by_depth() radix sorts them by view
+* space depth, and packs their billboards in particle order while it reads their positions anyway. Then
+* write_particle_instances() only has to copy one billboard per particle in sorted order, instead of gathering from
+* five arrays, and it writes them front to back, so it can write straight into mapped upload memory.
+*/
+
+// Must match particles.hlsli
+constexpr uint32_t max_particles = 1 << 20;
+
+// One emitter, as the compute shaders read it
+struct ParticleEmitter {
+    glm::vec3 position;
+    float rate;                 // Particles per second
+    glm::vec3 velocity;         // Of a new particle, plus a random value in [-1, 1) * velocity_spread per axis
+    float velocity_spread;
+    float lifetime;             // In seconds, a new particle gets a random 0.75 to 1.25 times this
+    float size;                 // Half the width of the billboard, in world units
+    uint32_t color;             // RGBA8, premultiplied alpha
+    uint32_t seed;
+};
+static_assert(sizeof(ParticleEmitter) == 48, "ParticleEmitter must match the HLSL struct");
+
+// What the CPU keeps per emitter between steps
+struct ParticleEmitterState {
+    float spawn_debt = 0.0f;    // The part of a particle it didn't spawn yet
+    uint32_t spawned = 0;       // How many particles it spawned so far, the sequence number of the next one
+};
+
+// The particles an emitter spawns in a step. Particle `first + i` of the step is the emitter's particle
+// `sequence + i`. Uploaded as is.
+struct ParticleSpawn {
+    uint32_t emitter;
+    uint32_t first;
+    uint32_t count;
+    uint32_t sequence;
+};
+static_assert(sizeof(ParticleSpawn) == 16, "ParticleSpawn must match the HLSL struct");
+
+// One particle as the GPU stores it
+struct GpuParticle {
+    glm::vec3 position;
+    float age;
+    glm::vec3 velocity;
+    float lifetime;
+    float size;
+    uint32_t color;
+    uint32_t padding[2];
+};
+static_assert(sizeof(GpuParticle) == 48, "GpuParticle must match the HLSL struct");
+
+// One billboard, as the particle vertex shader reads it per instance
+struct ParticleInstance {
+    glm::vec3 position;
+    float size;
+    uint32_t color;
+};
+static_assert(sizeof(ParticleInstance) == 20, "ParticleInstance must match the input layout");
+
+struct ParticleArrays {
+    std::vector<float> position_x, position_y, position_z;
+    std::vector<float> velocity_x, velocity_y, velocity_z;
+    std::vector<float> age;
+    std::vector<float> lifetime;
+    std::vector<float> size;
+    std::vector<uint32_t> color;
+};
+
+struct ParticleSystem {
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+    ParticleArrays particles;                   // The first `count` are alive
+    std::vector<ParticleEmitterState> emitters;
+
+    // Kept between steps, so stepping doesn't allocate
+    ParticleArrays compacted;                   // Swapped with `particles` after compaction
+    std::vector<uint32_t> chunk_offsets;
+    std::vector<ParticleSpawn> spawns;
+    std::vector<float> sort_depths;
+    std::vector<uint64_t> sort_items[2];                // Depth key in the high half, particle index in the low
+    std::vector<ParticleInstance> sort_instances;       // In particle order
+};
+
+struct ParticleStepStats {
+    uint32_t killed = 0;
+    uint32_t spawned = 0;
+    uint32_t dropped = 0;       // Spawned past the capacity
+};
+
+// Allocates room for `capacity` particles (at most max_particles) and `emitter_count` emitters, and clears them
+void init_particle_system(ParticleSystem& system, uint32_t capacity, uint32_t emitter_count);
+
+// Works out how many particles every emitter spawns in a step of `delta_time`, and updates the emitters' state.
+// Replaces `spawns`, and returns how many particles they spawn in total.
+uint32_t plan_particle_spawns(ParticleSystem& system, const ParticleEmitter* emitters, float delta_time, std::vector<ParticleSpawn>& spawns);
+
+// Integrates and compacts the particles. `velocity_step` is gravity * delta_time, computed by the caller, so the
+// GPU can use exactly the same value.
+void integrate_particles(ParticleSystem& system, const glm::vec3& velocity_step, float delta_time, ParticleStepStats* stats = nullptr,
+                         unsigned thread_count = 0);
+
+// Appends the particles of a plan from plan_particle_spawns(), the ones that don't fit are dropped
+void spawn_particles(ParticleSystem& system, const ParticleEmitter* emitters, const ParticleSpawn* spawns, uint32_t spawn_count,
+                     ParticleStepStats* stats = nullptr, unsigned thread_count = 0);
+
+// All three, for one step
+void step_particles(ParticleSystem& system, const ParticleEmitter* emitters, const glm::vec3& gravity, float delta_time,
+                    ParticleStepStats* stats = nullptr, unsigned thread_count = 0);
+
+// Sorts the particles back to front, by their view space depth, into `order`. Only the order changes, the
+// particles stay where they are. Also packs their billboards, for write_particle_instances().
+void sort_particles_by_depth(ParticleSystem& system, const glm::mat4& view, std::vector<uint32_t>& order, unsigned thread_count = 0);
+
+// Writes the billboards of `count` particles, in the given order, to `instances`, front to back. Uses the
+// billboards packed by the last sort_particles_by_depth(), so it has to come after it.
+void write_particle_instances(const ParticleSystem& system, const uint32_t* order, uint32_t count, ParticleInstance* instances,
+                              unsigned thread_count = 0);
+
+// How many of the first `count` particles differ from `gpu_particles` (usually read back from the GPU), bit for bit
+size_t count_particle_differences(const ParticleSystem& system, const GpuParticle* gpu_particles, uint32_t count);
@@ -0,0 +1,31 @@
+#pragma once
+#include <cmath>
+#include "glm/mat4x4.hpp"
+#include "glm/ext/matrix_clip_space.hpp"
+
+/* REVERSE-Z PROJECTION
+* A float depth buffer has most of its precision near 0. A normal projection puts the far plane at 1 and
+* squeezes almost all of the scene into the range near 1, where floats are coarse. Reverse-Z maps the near
+* plane to 1 and the far plane to 0 instead, which spreads the float precision out evenly over the distance.
+*
+* With reverse-Z, the depth buffer is cleared to 0 instead of 1, and the depth test is GREATER_EQUAL
+* instead of LESS_EQUAL. D3D uses a depth range of 0 to 1, so we use the _ZO (zero to one) glm functions.
+*/
+
+constexpr float reverse_z_clear_depth = 0.0f;
+
+// Swapping near and far in a regular zero-to-one projection is all it takes
+inline glm::mat4 reverse_z_perspective(const float fov_y, const float aspect, const float near_plane, const float far_plane) {
+    return glm::perspectiveRH_ZO(fov_y, aspect, far_plane, near_plane);
+}
+
+// With reverse-Z, the far plane can be at infinity without losing precision
+inline glm::mat4 reverse_z_infinite_perspective(const float fov_y, const float aspect, const float near_plane) {
+    const float focal_length = 1.0f / tanf(fov_y * 0.5f);
+    glm::mat4 projection(0.0f);
+    projection[0][0] = focal_length / aspect;
+    projection[1][1] = focal_length;
+    projection[2][3] = -1.0f;
+    projection[3][2] = near_plane;
+    return projection;
+}
@@ -0,0 +1,465 @@
+#include "scene.h"
+#include <algorithm>
+#include <atomic>
+#include "parallel_for.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_SSE2 1
+#include <emmintrin.h>
+#else
+#define SCENE_SSE2 0
+#endif
+
+namespace {
+    // Nodes per chunk of a level. Smaller levels run on the calling thread only.
+    constexpr size_t transform_chunk_size = 4096;
+
+    // With fewer dirty nodes than this part of the hierarchy, the update follows the dirty subtrees instead of
+    // going over every node
+    constexpr uint32_t sparse_update_divisor = 16;
+
+    // Nodes [begin, end) of one level
+    struct NodeSpan {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    uint32_t find_or_add_table(Scene& scene, const uint32_t components) {
+        for (uint32_t i = 0; i < scene.tables.size(); ++i) {
+            if (scene.tables[i].components == components) {
+                return i;
+            }
+        }
+        scene.tables.emplace_back();
+        scene.tables.back().components = components;
+        return static_cast<uint32_t>(scene.tables.size() - 1);
+    }
+
+    void mark_dirty(SceneTransforms& transforms, const uint32_t node) {
+        if (!transforms.dirty[node]) {
+            transforms.dirty[node] = 1;
+            transforms.dirty_nodes.push_back(node);
+        }
+    }
+
+    uint32_t add_node(SceneTransforms& transforms, const SceneEntity entity) {
+        const uint32_t node = static_cast<uint32_t>(transforms.parents.size());
+        transforms.positions.emplace_back(0.0f);
+        transforms.rotations.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+        transforms.scales.emplace_back(1.0f);
+        transforms.world.emplace_back(1.0f);
+        transforms.parents.push_back(scene_no_node);
+        transforms.dirty.push_back(0);
+        transforms.entities.push_back(entity);
+        mark_dirty(transforms, node);
+
+        // Roots go before every other level
+        transforms.sorted = false;
+        return node;
+    }
+
+    template <typename T>
+    void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+        std::vector<T> sorted(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            sorted[i] = values[order[i]];
+        }
+        values.swap(sorted);
+    }
+
+    // Sorts the live nodes breadth-first, drops the removed ones, and points the tables at the new nodes
+    void sort_transforms(Scene& scene) {
+        SceneTransforms& transforms = scene.transforms;
+        const uint32_t node_count = static_cast<uint32_t>(transforms.parents.size());
+        const auto is_live = [&](const uint32_t node) { return transforms.entities[node].index != UINT32_MAX; };
+
+        // The children of every node, one after the other, in the order they are in now
+        std::vector<uint32_t> child_starts(node_count + 1, 0);
+        for (uint32_t node = 0; node < node_count; ++node) {
+            uint32_t& parent = transforms.parents[node];
+            if (!is_live(node) || parent == scene_no_node) {
+                continue;
+            }
+            if (!is_live(parent)) {
+                // The parent was destroyed, so this is a root now
+                parent = scene_no_node;
+                mark_dirty(transforms, node);
+                continue;
+            }
+            child_starts[parent + 1]++;
+        }
+        for (uint32_t node = 0; node < node_count; ++node) {
+            child_starts[node + 1] += child_starts[node];
+        }
+        std::vector<uint32_t> children(child_starts[node_count]);
+        std::vector<uint32_t> child_ends(child_starts.begin(), child_starts.end() - 1);
+        for (uint32_t node = 0; node < node_count; ++node) {
+            if (is_live(node) && transforms.parents[node] != scene_no_node) {
+                children[child_ends[transforms.parents[node]]++] = node;
+            }
+        }
+
+        // Breadth-first: the roots, then the children of each node of a level, in the order of the level
+        std::vector<uint32_t> order;
+        order.reserve(node_count);
+        for (uint32_t node = 0; node < node_count; ++node) {
+            if (is_live(node) && transforms.parents[node] == scene_no_node) {
+                order.push_back(node);
+            }
+        }
+        transforms.level_starts.assign(1, 0);
+        for (size_t level_begin = 0; level_begin < order.size();) {
+            const size_t level_end = order.size();
+            transforms.level_starts.push_back(static_cast<uint32_t>(level_end));
+            for (size_t i = level_begin; i < level_end; ++i) {
+                order.insert(order.end(), children.begin() + child_starts[order[i]], children.begin() + child_starts[order[i] + 1]);
+            }
+            level_begin = level_end;
+        }
+
+        // Move everything to its new place
+        std::vector<uint32_t> new_index(node_count, scene_no_node);
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            new_index[order[i]] = i;
+        }
+        permute(transforms.positions, order);
+        permute(transforms.rotations, order);
+        permute(transforms.scales, order);
+        permute(transforms.world, order);
+        permute(transforms.parents, order);
+        permute(transforms.dirty, order);
+        permute(transforms.entities, order);
+        const uint32_t live_count = static_cast<uint32_t>(order.size());
+        transforms.dirty_nodes.clear();
+        transforms.child_starts.assign(live_count + 1, 0);
+        for (uint32_t node = 0; node < live_count; ++node) {
+            uint32_t& parent = transforms.parents[node];
+            if (parent != scene_no_node) {
+                parent = new_index[parent];
+                transforms.child_starts[parent + 1]++;
+            }
+            if (transforms.dirty[node]) {
+                transforms.dirty_nodes.push_back(node);
+            }
+
+            const SceneEntitySlot& slot = scene.slots[transforms.entities[node].index];
+            scene.tables[slot.table].transform_nodes[slot.row] = node;
+        }
+
+        // Children come in the order of their parents, right after the roots
+        transforms.child_starts[0] = transforms.level_starts.size() > 1 ? transforms.level_starts[1] : 0;
+        for (uint32_t node = 0; node < live_count; ++node) {
+            transforms.child_starts[node + 1] += transforms.child_starts[node];
+        }
+        transforms.sorted = true;
+    }
+
+    // world = parent * translate(position) * rotate(rotation) * scale(scale), without a parent for roots
+    void compose_world(const glm::mat4* parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, glm::mat4& world) {
+        const glm::mat3 rotation_matrix = glm::mat3_cast(rotation);
+        const glm::vec3 axes[3] = { rotation_matrix[0] * scale.x, rotation_matrix[1] * scale.y, rotation_matrix[2] * scale.z };
+        if (!parent) {
+            world = glm::mat4(glm::vec4(axes[0], 0.0f), glm::vec4(axes[1], 0.0f), glm::vec4(axes[2], 0.0f), glm::vec4(position, 1.0f));
+            return;
+        }
+#if SCENE_SSE2
+        // The local matrix's last row is (0, 0, 0, 1), so every column is one multiply-add short
+        const float* parent_columns = &(*parent)[0][0];
+        const __m128 parent_x = _mm_loadu_ps(parent_columns);
+        const __m128 parent_y = _mm_loadu_ps(parent_columns + 4);
+        const __m128 parent_z = _mm_loadu_ps(parent_columns + 8);
+        const __m128 parent_w = _mm_loadu_ps(parent_columns + 12);
+        float* world_columns = &world[0][0];
+        for (int column = 0; column < 3; ++column) {
+            const glm::vec3& axis = axes[column];
+            const __m128 x = _mm_mul_ps(parent_x, _mm_set1_ps(axis.x));
+            const __m128 y = _mm_mul_ps(parent_y, _mm_set1_ps(axis.y));
+            const __m128 z = _mm_mul_ps(parent_z, _mm_set1_ps(axis.z));
+            _mm_storeu_ps(world_columns + column * 4, _mm_add_ps(_mm_add_ps(x, y), z));
+        }
+        const __m128 x = _mm_mul_ps(parent_x, _mm_set1_ps(position.x));
+        const __m128 y = _mm_mul_ps(parent_y, _mm_set1_ps(position.y));
+        const __m128 z = _mm_mul_ps(parent_z, _mm_set1_ps(position.z));
+        _mm_storeu_ps(world_columns + 12, _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, parent_w)));
+#else
+        for (int column = 0; column < 3; ++column) {
+            world[column] = (*parent)[0] * axes[column].x + (*parent)[1] * axes[column].y + (*parent)[2] * axes[column].z;
+        }
+        world[3] = (*parent)[0] * position.x + (*parent)[1] * position.y + ((*parent)[2] * position.z + (*parent)[3]);
+#endif
+    }
+}
+
+SceneEntity create_entity(Scene& scene, const uint32_t components) {
+    SceneEntity entity;
+    if (!scene.free_slots.empty()) {
+        entity.index = scene.free_slots.back();
+        scene.free_slots.pop_back();
+    }
+    else {
+        entity.index = static_cast<uint32_t>(scene.slots.size());
+        scene.slots.emplace_back();
+    }
+    SceneEntitySlot& slot = scene.slots[entity.index];
+    entity.generation = slot.generation;
+    slot.table = find_or_add_table(scene, components);
+
+    SceneTable& table = scene.tables[slot.table];
+    slot.row = static_cast<uint32_t>(table.entities.size());
+    table.entities.push_back(entity);
+    if (components & scene_component_transform) {
+        table.transform_nodes.push_back(add_node(scene.transforms, entity));
+    }
+    if (components & scene_component_draw) {
+        table.draws.emplace_back();
+    }
+    return entity;
+}
+
+void destroy_entity(Scene& scene, const SceneEntity entity) {
+    if (!is_alive(scene, entity)) {
+        return;
+    }
+    SceneEntitySlot& slot = scene.slots[entity.index];
+    SceneTable& table = scene.tables[slot.table];
+
+    // The node stays until the next sort, so no other node moves
+    if (table.components & scene_component_transform) {
+        scene.transforms.entities[table.transform_nodes[slot.row]] = SceneEntity{};
+        scene.transforms.sorted = false;
+    }
+
+    // Move the last row into the hole
+    const uint32_t last = static_cast<uint32_t>(table.entities.size() - 1);
+    table.entities[slot.row] = table.entities[last];
+    table.entities.pop_back();
+    if (table.components & scene_component_transform) {
+        table.transform_nodes[slot.row] = table.transform_nodes[last];
+        table.transform_nodes.pop_back();
+    }
+    if (table.components & scene_component_draw) {
+        table.draws[slot.row] = table.draws[last];
+        table.draws.pop_back();
+    }
+    if (slot.row != last) {
+        scene.slots[table.entities[slot.row].index].row = slot.row;
+    }
+
+    slot.generation++;
+    scene.free_slots.push_back(entity.index);
+}
+
+bool is_alive(const Scene& scene, const SceneEntity entity) {
+    return entity.index < scene.slots.size() && scene.slots[entity.index].generation == entity.generation;
+}
+
+bool set_parent(Scene& scene, const SceneEntity child, const SceneEntity parent) {
+    SceneTransforms& transforms = scene.transforms;
+    const uint32_t child_node = find_transform_node(scene, child);
+    uint32_t parent_node = scene_no_node;
+    if (child_node == scene_no_node) {
+        return false;
+    }
+    if (parent != SceneEntity{}) {
+        parent_node = find_transform_node(scene, parent);
+        if (parent_node == scene_no_node) {
+            return false;
+        }
+        for (uint32_t node = parent_node; node != scene_no_node; node = transforms.parents[node]) {
+            if (node == child_node) {
+                return false;
+            }
+        }
+    }
+    if (transforms.parents[child_node] != parent_node) {
+        transforms.parents[child_node] = parent_node;
+        transforms.sorted = false;
+        mark_dirty(transforms, child_node);
+    }
+    return true;
+}
+
+DrawItem* find_draw(Scene& scene, const SceneEntity entity) {
+    if (!is_alive(scene, entity)) {
+        return nullptr;
+    }
+    const SceneEntitySlot& slot = scene.slots[entity.index];
+    SceneTable& table = scene.tables[slot.table];
+    return (table.components & scene_component_draw) ? &table.draws[slot.row] : nullptr;
+}
+
+uint32_t find_transform_node(const Scene& scene, const SceneEntity entity) {
+    if (!is_alive(scene, entity)) {
+        return scene_no_node;
+    }
+    const SceneEntitySlot& slot = scene.slots[entity.index];
+    const SceneTable& table = scene.tables[slot.table];
+    return (table.components & scene_component_transform) ? table.transform_nodes[slot.row] : scene_no_node;
+}
+
+void set_local_transform(Scene& scene, const SceneEntity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    const uint32_t node = find_transform_node(scene, entity);
+    if (node == scene_no_node) {
+        return;
+    }
+    SceneTransforms& transforms = scene.transforms;
+    transforms.positions[node] = position;
+    transforms.rotations[node] = rotation;
+    transforms.scales[node] = scale;
+    mark_dirty(transforms, node);
+}
+
+void update_transforms(Scene& scene, SceneUpdateStats* stats, const unsigned thread_count) {
+    SceneTransforms& transforms = scene.transforms;
+    SceneUpdateStats update_stats;
+    if (!transforms.sorted) {
+        sort_transforms(scene);
+        update_stats.sorted = true;
+    }
+    update_stats.levels = transforms.level_starts.empty() ? 0 : static_cast<uint32_t>(transforms.level_starts.size() - 1);
+    const uint32_t node_count = static_cast<uint32_t>(transforms.parents.size());
+    std::atomic<uint32_t> updated_nodes{ 0 };
+    const auto update_node = [&](const uint32_t node) {
+        const uint32_t parent = transforms.parents[node];
+        compose_world(parent != scene_no_node ? &transforms.world[parent] : nullptr,
+                      transforms.positions[node], transforms.rotations[node], transforms.scales[node], transforms.world[node]);
+    };
+
+    if (transforms.dirty_nodes.empty()) {
+        // Nothing changed
+    }
+    else if (transforms.dirty_nodes.size() >= node_count / sparse_update_divisor) {
+        // Go over every node. A level only reads the dirty flags and the world transforms of the level before it,
+        // so its nodes can be done in any order.
+        for (uint32_t level = 0; level < update_stats.levels; ++level) {
+            const uint32_t level_begin = transforms.level_starts[level];
+            const uint32_t level_end = transforms.level_starts[level + 1];
+            parallel_for(level_end - level_begin, transform_chunk_size, [&](const size_t begin, const size_t end) {
+                uint32_t chunk_updated_nodes = 0;
+                for (uint32_t node = static_cast<uint32_t>(level_begin + begin); node < level_begin + end; ++node) {
+                    const uint32_t parent = transforms.parents[node];
+                    if (parent != scene_no_node && transforms.dirty[parent]) {
+                        transforms.dirty[node] = 1;
+                    }
+                    if (transforms.dirty[node]) {
+                        update_node(node);
+                        chunk_updated_nodes++;
+                    }
+                }
+                updated_nodes += chunk_updated_nodes;
+            }, thread_count);
+        }
+        std::fill(transforms.dirty.begin(), transforms.dirty.end(), static_cast<uint8_t>(0));
+    }
+    else {
+        // Follow the dirty subtrees down: every level updates its own dirty nodes, and the children of everything
+        // the level before it updated
+        std::vector<uint32_t>& dirty_nodes = transforms.dirty_nodes;
+        std::sort(dirty_nodes.begin(), dirty_nodes.end());
+        std::vector<NodeSpan> spans;
+        std::vector<NodeSpan> child_spans;
+        std::vector<NodeSpan> chunks;
+        size_t next_dirty = 0;
+        for (uint32_t level = 0; level < update_stats.levels; ++level) {
+            // Merge the level's dirty nodes into the spans, both are in order
+            const uint32_t level_end = transforms.level_starts[level + 1];
+            std::vector<NodeSpan> merged;
+            merged.reserve(spans.size() + 16);
+            size_t span = 0;
+            const auto append = [&](const NodeSpan next) {
+                if (!merged.empty() && merged.back().end >= next.begin) {
+                    merged.back().end = std::max(merged.back().end, next.end);
+                }
+                else {
+                    merged.push_back(next);
+                }
+            };
+            for (; next_dirty < dirty_nodes.size() && dirty_nodes[next_dirty] < level_end; ++next_dirty) {
+                const uint32_t node = dirty_nodes[next_dirty];
+                for (; span < spans.size() && spans[span].begin <= node; ++span) {
+                    append(spans[span]);
+                }
+                append({ node, node + 1 });
+            }
+            for (; span < spans.size(); ++span) {
+                append(spans[span]);
+            }
+            spans.swap(merged);
+            if (spans.empty()) {
+                continue;
+            }
+
+            // Chunks of about the same size, so big subtrees get all threads
+            chunks.clear();
+            uint32_t span_nodes = 0;
+            for (const NodeSpan& node_span : spans) {
+                span_nodes += node_span.end - node_span.begin;
+                for (uint32_t begin = node_span.begin; begin < node_span.end; begin += transform_chunk_size) {
+                    chunks.push_back({ begin, std::min(begin + static_cast<uint32_t>(transform_chunk_size), node_span.end) });
+                }
+            }
+            parallel_for(chunks.size(), std::max<size_t>(1, chunks.size() * transform_chunk_size / span_nodes), [&](const size_t begin, const size_t end) {
+                for (size_t chunk = begin; chunk < end; ++chunk) {
+                    for (uint32_t node = chunks[chunk].begin; node < chunks[chunk].end; ++node) {
+                        update_node(node);
+                    }
+                }
+            }, thread_count);
+            updated_nodes += span_nodes;
+
+            // Their children are the next level's spans
+            child_spans.clear();
+            for (const NodeSpan& node_span : spans) {
+                const NodeSpan children = { transforms.child_starts[node_span.begin], transforms.child_starts[node_span.end] };
+                if (children.begin == children.end) {
+                    continue;
+                }
+                if (!child_spans.empty() && child_spans.back().end == children.begin) {
+                    child_spans.back().end = children.end;
+                }
+                else {
+                    child_spans.push_back(children);
+                }
+            }
+            spans.swap(child_spans);
+        }
+        for (const uint32_t node : dirty_nodes) {
+            transforms.dirty[node] = 0;
+        }
+    }
+    transforms.dirty_nodes.clear();
+    update_stats.updated_nodes = updated_nodes;
+
+    if (stats) {
+        *stats = update_stats;
+    }
+}
+
+size_t count_draws(const Scene& scene) {
+    size_t count = 0;
+    for (const SceneTable& table : scene.tables) {
+        if (table.components & scene_component_draw) {
+            count += table.draws.size();
+        }
+    }
+    return count;
+}
+
+void pack_draws(const Scene& scene, glm::mat4* transforms, DrawItem* draws, const unsigned thread_count) {
+    size_t table_offset = 0;
+    for (const SceneTable& table : scene.tables) {
+        if (!(table.components & scene_component_draw)) {
+            continue;
+        }
+        const bool has_transform = (table.components & scene_component_transform) != 0;
+        parallel_for(table.draws.size(), transform_chunk_size, [&](const size_t begin, const size_t end) {
+            for (size_t row = begin; row < end; ++row) {
+                const size_t index = table_offset + row;
+                transforms[index] = has_transform ? scene.transforms.world[table.transform_nodes[row]] : glm::mat4(1.0f);
+                draws[index] = table.draws[row];
+                draws[index].transform_index = static_cast<uint32_t>(index);
+            }
+        }, thread_count);
+        table_offset += table.draws.size();
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+/* SCENE
+* Entities are grouped into tables by archetype, the set of components they have. A table keeps every component in
+* its own array (structure of arrays), so going over all draws only touches draws, and adding or removing an entity
+* is a swap with the last row. An entity handle is an index into a slot array, which knows the entity's table and
+* row, plus a generation, so handles of destroyed entities don't find the entity that got their slot.
+*
+* Transforms form a hierarchy. Its nodes have their own arrays, sorted by depth, breadth-first: all roots, then all
+* their children, then all of theirs, and so on. A node's parent is always in the level before it, and the parents
+* of a level are in order, so a level only reads the level before it, front to back. Updating goes level by level,
+* every level split over all threads, and every node costs one SSE2 mat4 multiply. Only nodes whose local transform
+* changed, and everything below them, are computed again. Breadth-first, the children of a run of nodes are a run
+* of nodes too, so when only a few nodes changed, the update just follows those runs down, level by level, and
+* doesn't look at the rest of the hierarchy at all.
+* Adding, removing and reparenting nodes doesn't move anything. It just marks the hierarchy, and the next update
+* sorts it again, which is a lot cheaper than keeping it sorted after every change.
+*/
+
+constexpr uint32_t scene_no_node = UINT32_MAX;
+
+struct SceneEntity {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const SceneEntity& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SceneEntity& other) const { return !(*this == other); }
+};
+
+// The components an entity can have, as bits of its archetype
+enum SceneComponentBits : uint32_t {
+    scene_component_transform = 1 << 0,     // A node in the transform hierarchy
+    scene_component_draw = 1 << 1,          // Drawn with its transform, or without one if it has none
+};
+
+struct DrawItem {
+    uint32_t index_count = 0;
+    uint32_t first_index = 0;
+    int32_t base_vertex = 0;
+    uint32_t transform_index = 0;           // Into the transforms written by pack_draws()
+};
+
+// All entities with the same components. Arrays of components the archetype doesn't have stay empty.
+struct SceneTable {
+    uint32_t components = 0;
+    std::vector<SceneEntity> entities;
+    std::vector<uint32_t> transform_nodes;  // Into SceneTransforms
+    std::vector<DrawItem> draws;
+};
+
+struct SceneTransforms {
+    // Relative to the parent
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    std::vector<glm::mat4> world;           // Up to date after update_transforms()
+    std::vector<uint32_t> parents;          // scene_no_node for roots
+    std::vector<uint8_t> dirty;             // The local transform or the parent changed since the last update
+    std::vector<uint32_t> dirty_nodes;      // The nodes with a dirty flag
+    std::vector<SceneEntity> entities;      // Removed nodes have an invalid entity until the next sort
+
+    // Only while sorted
+    std::vector<uint32_t> level_starts;     // Level l is [level_starts[l], level_starts[l + 1])
+    std::vector<uint32_t> child_starts;     // The children of n are [child_starts[n], child_starts[n + 1])
+    bool sorted = true;
+};
+
+struct SceneEntitySlot {
+    uint32_t generation = 0;
+    uint32_t table = 0;
+    uint32_t row = 0;
+};
+
+struct Scene {
+    std::vector<SceneTable> tables;
+    SceneTransforms transforms;
+    std::vector<SceneEntitySlot> slots;
+    std::vector<uint32_t> free_slots;
+};
+
+struct SceneUpdateStats {
+    uint32_t levels = 0;
+    uint32_t updated_nodes = 0;
+    bool sorted = false;                    // The hierarchy changed, so it was sorted again first
+};
+
+// Creates an entity with the given components (SceneComponentBits). A transform starts out as an identity root.
+SceneEntity create_entity(Scene& scene, uint32_t components);
+
+// Children of a destroyed entity become roots, with the same local transform
+void destroy_entity(Scene& scene, SceneEntity entity);
+bool is_alive(const Scene& scene, SceneEntity entity);
+
+// Pass an invalid entity to make `child` a root. Returns false, and changes nothing, if either one has no
+// transform, or if `parent` is `child` or one of its descendants.
+bool set_parent(Scene& scene, SceneEntity child, SceneEntity parent);
+
+// nullptr if the entity doesn't have a draw component
+DrawItem* find_draw(Scene& scene, SceneEntity entity);
+
+// Into SceneTransforms, scene_no_node if the entity doesn't have a transform. Only changes when the hierarchy is
+// sorted, at the start of update_transforms().
+uint32_t find_transform_node(const Scene& scene, SceneEntity entity);
+
+void set_local_transform(Scene& scene, SceneEntity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+// Sorts the hierarchy if it changed, then updates the world transform of every dirty node and its descendants
+void update_transforms(Scene& scene, SceneUpdateStats* stats = nullptr, unsigned thread_count = 0);
+
+// How many entities have a draw component
+size_t count_draws(const Scene& scene);
+
+// Writes every draw and its world transform, front to back, so `transforms` can be mapped upload memory. Both need
+// room for count_draws() entries. Draws without a transform get the identity.
+void pack_draws(const Scene& scene, glm::mat4* transforms, DrawItem* draws, unsigned thread_count = 0);
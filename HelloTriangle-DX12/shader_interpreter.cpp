@@ -0,0 +1,1088 @@
+#include "shader_interpreter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <strings.h>
+#endif
+
+namespace {
+    constexpr uint32_t fourcc(const char a, const char b, const char c, const char d) {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+    }
+
+    uint32_t read_u32(const uint8_t* data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    /* SIGNATURES
+    * ISGN/OSGN list every input and output with its semantic name and register. OSG5 adds a stream index
+    * in front of each element, and ISG1/OSG1 add a stream index and a minimum precision.
+    */
+    bool parse_signature(const uint8_t* chunk, const uint32_t chunk_size, const uint32_t chunk_type, std::vector<ShaderSignatureElement>& elements) {
+        if (chunk_size < 8) {
+            return false;
+        }
+        const uint32_t count = read_u32(chunk);
+        uint32_t stride = 24;
+        uint32_t first_field = 0;
+        if (chunk_type == fourcc('O', 'S', 'G', '5')) {
+            stride = 28;
+            first_field = 4;
+        }
+        else if (chunk_type == fourcc('I', 'S', 'G', '1') || chunk_type == fourcc('O', 'S', 'G', '1')) {
+            stride = 32;
+            first_field = 4;
+        }
+        if (8 + static_cast<uint64_t>(count) * stride > chunk_size) {
+            return false;
+        }
+
+        elements.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint8_t* element = chunk + 8 + i * stride + first_field;
+            const uint32_t name_offset = read_u32(element + 0);
+            if (name_offset >= chunk_size) {
+                return false;
+            }
+            const char* name = reinterpret_cast<const char*>(chunk + name_offset);
+            elements[i].semantic_name.assign(name, strnlen(name, chunk_size - name_offset));
+            elements[i].semantic_index = read_u32(element + 4);
+            elements[i].system_value = read_u32(element + 8);
+            elements[i].register_index = read_u32(element + 16);
+            elements[i].mask = element[20];
+        }
+        return true;
+    }
+
+    /* BYTECODE TOKENS
+    * Every instruction starts with an opcode token (opcode in bits 0-10, length in bits 24-30), followed by
+    * its operands. Every operand starts with an operand token that says how many components it has, which
+    * swizzle or mask to use, what kind of register it is, and how many index dwords follow.
+    */
+    enum : uint32_t {
+        opcode_add = 0,
+        opcode_and = 1,
+        opcode_break = 2,
+        opcode_breakc = 3,
+        opcode_continue = 7,
+        opcode_continuec = 8,
+        opcode_deriv_rtx = 11,
+        opcode_deriv_rty = 12,
+        opcode_discard = 13,
+        opcode_div = 14,
+        opcode_dp2 = 15,
+        opcode_dp3 = 16,
+        opcode_dp4 = 17,
+        opcode_else = 18,
+        opcode_endif = 21,
+        opcode_endloop = 22,
+        opcode_eq = 24,
+        opcode_exp = 25,
+        opcode_frc = 26,
+        opcode_ftoi = 27,
+        opcode_ftou = 28,
+        opcode_ge = 29,
+        opcode_iadd = 30,
+        opcode_if = 31,
+        opcode_ieq = 32,
+        opcode_ige = 33,
+        opcode_ilt = 34,
+        opcode_imad = 35,
+        opcode_imax = 36,
+        opcode_imin = 37,
+        opcode_imul = 38,
+        opcode_ine = 39,
+        opcode_ineg = 40,
+        opcode_ishl = 41,
+        opcode_ishr = 42,
+        opcode_itof = 43,
+        opcode_log = 47,
+        opcode_loop = 48,
+        opcode_lt = 49,
+        opcode_mad = 50,
+        opcode_min = 51,
+        opcode_max = 52,
+        opcode_customdata = 53,
+        opcode_mov = 54,
+        opcode_movc = 55,
+        opcode_mul = 56,
+        opcode_ne = 57,
+        opcode_nop = 58,
+        opcode_not = 59,
+        opcode_or = 60,
+        opcode_ret = 62,
+        opcode_retc = 63,
+        opcode_round_ni = 65,
+        opcode_rsq = 68,
+        opcode_sqrt = 75,
+        opcode_udiv = 78,
+        opcode_ult = 79,
+        opcode_uge = 80,
+        opcode_umul = 81,
+        opcode_umad = 82,
+        opcode_umax = 83,
+        opcode_umin = 84,
+        opcode_ushr = 85,
+        opcode_utof = 86,
+        opcode_xor = 87,
+        opcode_dcl_resource = 88,
+        opcode_dcl_input = 95,
+        opcode_dcl_input_ps_siv = 100,
+        opcode_dcl_output = 101,
+        opcode_dcl_output_siv = 103,
+        opcode_dcl_temps = 104,
+        opcode_dcl_global_flags = 106,
+        opcode_deriv_rtx_coarse = 122,
+        opcode_deriv_rtx_fine = 123,
+        opcode_deriv_rty_coarse = 124,
+        opcode_deriv_rty_fine = 125,
+        opcode_dcl_stream = 143,
+        opcode_dcl_resource_structured = 162,
+        opcode_ld_structured = 167,
+        opcode_dcl_gs_instance_count = 206,
+    };
+
+    // The dcl_* opcodes. They're not all in one range, shader model 5 added instructions like rcp and ubfe between them.
+    bool is_declaration(const uint32_t opcode) {
+        return (opcode >= opcode_dcl_resource && opcode <= opcode_dcl_global_flags) ||
+               (opcode >= opcode_dcl_stream && opcode <= opcode_dcl_resource_structured) ||
+               opcode == opcode_dcl_gs_instance_count;
+    }
+
+    enum : uint32_t {
+        operand_temp = 0,
+        operand_input = 1,
+        operand_output = 2,
+        operand_immediate32 = 4,
+        operand_resource = 7,
+        operand_constant_buffer = 8,
+        operand_null = 13,
+    };
+
+    struct OpcodeInfo {
+        uint32_t opcode;
+        ShaderOp op;
+        uint8_t source_count;
+    };
+
+    // deriv_rtx and deriv_rty are the coarse ones, umad has the same low bits as imad
+    constexpr OpcodeInfo opcode_table[] = {
+        { opcode_add,               ShaderOp::add,              2 },
+        { opcode_and,               ShaderOp::bit_and,          2 },
+        { opcode_deriv_rtx,         ShaderOp::deriv_rtx_coarse, 1 },
+        { opcode_deriv_rty,         ShaderOp::deriv_rty_coarse, 1 },
+        { opcode_div,               ShaderOp::div,              2 },
+        { opcode_dp2,               ShaderOp::dp2,              2 },
+        { opcode_dp3,               ShaderOp::dp3,              2 },
+        { opcode_dp4,               ShaderOp::dp4,              2 },
+        { opcode_eq,                ShaderOp::eq,               2 },
+        { opcode_exp,               ShaderOp::exp,              1 },
+        { opcode_frc,               ShaderOp::frc,              1 },
+        { opcode_ftoi,              ShaderOp::ftoi,             1 },
+        { opcode_ftou,              ShaderOp::ftou,             1 },
+        { opcode_ge,                ShaderOp::ge,               2 },
+        { opcode_iadd,              ShaderOp::iadd,             2 },
+        { opcode_ieq,               ShaderOp::ieq,              2 },
+        { opcode_ige,               ShaderOp::ige,              2 },
+        { opcode_ilt,               ShaderOp::ilt,              2 },
+        { opcode_imad,              ShaderOp::imad,             3 },
+        { opcode_imax,              ShaderOp::imax,             2 },
+        { opcode_imin,              ShaderOp::imin,             2 },
+        { opcode_imul,              ShaderOp::imul,             2 },
+        { opcode_ine,               ShaderOp::ine,              2 },
+        { opcode_ineg,              ShaderOp::ineg,             1 },
+        { opcode_ishl,              ShaderOp::ishl,             2 },
+        { opcode_ishr,              ShaderOp::ishr,             2 },
+        { opcode_itof,              ShaderOp::itof,             1 },
+        { opcode_log,               ShaderOp::log,              1 },
+        { opcode_lt,                ShaderOp::lt,               2 },
+        { opcode_mad,               ShaderOp::mad,              3 },
+        { opcode_min,               ShaderOp::min,              2 },
+        { opcode_max,               ShaderOp::max,              2 },
+        { opcode_mov,               ShaderOp::mov,              1 },
+        { opcode_movc,              ShaderOp::movc,             3 },
+        { opcode_mul,               ShaderOp::mul,              2 },
+        { opcode_ne,                ShaderOp::ne,               2 },
+        { opcode_not,               ShaderOp::bit_not,          1 },
+        { opcode_or,                ShaderOp::bit_or,           2 },
+        { opcode_round_ni,          ShaderOp::round_ni,         1 },
+        { opcode_rsq,               ShaderOp::rsq,              1 },
+        { opcode_sqrt,              ShaderOp::sqrt,             1 },
+        { opcode_udiv,              ShaderOp::udiv,             2 },
+        { opcode_ult,               ShaderOp::ult,              2 },
+        { opcode_uge,               ShaderOp::uge,              2 },
+        { opcode_umul,              ShaderOp::umul,             2 },
+        { opcode_umad,              ShaderOp::imad,             3 },
+        { opcode_umax,              ShaderOp::umax,             2 },
+        { opcode_umin,              ShaderOp::umin,             2 },
+        { opcode_ushr,              ShaderOp::ushr,             2 },
+        { opcode_utof,              ShaderOp::utof,             1 },
+        { opcode_xor,               ShaderOp::bit_xor,          2 },
+        { opcode_deriv_rtx_coarse,  ShaderOp::deriv_rtx_coarse, 1 },
+        { opcode_deriv_rtx_fine,    ShaderOp::deriv_rtx_fine,   1 },
+        { opcode_deriv_rty_coarse,  ShaderOp::deriv_rty_coarse, 1 },
+        { opcode_deriv_rty_fine,    ShaderOp::deriv_rty_fine,   1 },
+        { opcode_ld_structured,     ShaderOp::ld_structured,    3 },
+    };
+
+    // Instructions where negating a source means integer negation, and that have no float modifiers
+    bool reads_integers(const ShaderOp op) {
+        switch (op) {
+        case ShaderOp::bit_and:
+        case ShaderOp::bit_or:
+        case ShaderOp::bit_xor:
+        case ShaderOp::bit_not:
+        case ShaderOp::itof:
+        case ShaderOp::utof:
+        case ShaderOp::iadd:
+        case ShaderOp::imad:
+        case ShaderOp::imul:
+        case ShaderOp::ineg:
+        case ShaderOp::ieq:
+        case ShaderOp::ine:
+        case ShaderOp::ilt:
+        case ShaderOp::ige:
+        case ShaderOp::imin:
+        case ShaderOp::imax:
+        case ShaderOp::ishl:
+        case ShaderOp::ishr:
+        case ShaderOp::ushr:
+        case ShaderOp::ult:
+        case ShaderOp::uge:
+        case ShaderOp::umin:
+        case ShaderOp::umax:
+        case ShaderOp::umul:
+        case ShaderOp::udiv:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool has_second_destination(const ShaderOp op) {
+        return op == ShaderOp::imul || op == ShaderOp::umul || op == ShaderOp::udiv;
+    }
+
+    bool is_derivative(const ShaderOp op) {
+        return op >= ShaderOp::deriv_rtx_coarse && op <= ShaderOp::deriv_rty_fine;
+    }
+
+    bool parse_operand(const uint32_t*& token, const uint32_t* end, ShaderOperand& operand) {
+        if (token >= end) {
+            return false;
+        }
+        const uint32_t operand_token = *token++;
+        const uint32_t component_count = operand_token & 3;
+        const uint32_t selection_mode = (operand_token >> 2) & 3;
+        const uint32_t type = (operand_token >> 12) & 0xFF;
+        const uint32_t index_dimension = (operand_token >> 20) & 3;
+
+        // Extended operand tokens hold source modifiers like -x and abs(x)
+        bool extended = (operand_token >> 31) != 0;
+        while (extended) {
+            if (token >= end) {
+                return false;
+            }
+            const uint32_t extended_token = *token++;
+            if ((extended_token & 0x3F) == 1) {
+                operand.modifier = static_cast<ShaderModifier>((extended_token >> 6) & 3);
+            }
+            extended = (extended_token >> 31) != 0;
+        }
+
+        if (component_count == 2) {
+            if (selection_mode == 0) {
+                operand.mask = static_cast<uint8_t>((operand_token >> 4) & 0xF);
+            }
+            else if (selection_mode == 1) {
+                for (int i = 0; i < 4; ++i) {
+                    operand.swizzle[i] = static_cast<uint8_t>((operand_token >> (4 + i * 2)) & 3);
+                }
+            }
+            else {
+                const uint8_t component = static_cast<uint8_t>((operand_token >> 4) & 3);
+                for (auto& swizzle : operand.swizzle) {
+                    swizzle = component;
+                }
+                operand.mask = static_cast<uint8_t>(1 << component);
+            }
+        }
+        else if (component_count == 1) {
+            for (auto& swizzle : operand.swizzle) {
+                swizzle = 0;
+            }
+            operand.mask = 1;
+        }
+
+        switch (type) {
+        case operand_temp:            operand.type = ShaderRegisterType::temp; break;
+        case operand_input:           operand.type = ShaderRegisterType::input; break;
+        case operand_output:          operand.type = ShaderRegisterType::output; break;
+        case operand_constant_buffer: operand.type = ShaderRegisterType::constant_buffer; break;
+        case operand_resource:        operand.type = ShaderRegisterType::resource; break;
+        case operand_null:            operand.type = ShaderRegisterType::null; break;
+        case operand_immediate32: {
+            operand.type = ShaderRegisterType::immediate;
+            const uint32_t value_count = component_count == 2 ? 4 : 1;
+            if (token + value_count > end) {
+                return false;
+            }
+            for (uint32_t i = 0; i < 4; ++i) {
+                memcpy(&operand.immediate[i], token + (i < value_count ? i : 0), sizeof(float));
+            }
+            token += value_count;
+            return true;
+        }
+        default:
+            printf("[ERROR] Shader operand type %u is not supported on the CPU\n", type);
+            return false;
+        }
+
+        // Indices, only plain immediate indices are supported (no relative addressing)
+        uint32_t indices[3] = {};
+        for (uint32_t i = 0; i < index_dimension; ++i) {
+            const uint32_t representation = (operand_token >> (22 + i * 3)) & 7;
+            if (representation != 0 || token >= end) {
+                printf("[ERROR] Relative register addressing is not supported on the CPU\n");
+                return false;
+            }
+            indices[i] = *token++;
+        }
+        operand.index = indices[0];
+        operand.element = indices[1];
+        return true;
+    }
+
+    bool validate_operand(const ShaderOperand& operand, const ShaderProgram& program) {
+        switch (operand.type) {
+        case ShaderRegisterType::temp:            return operand.index < program.temp_count;
+        case ShaderRegisterType::input:           return operand.index < program.input_count;
+        case ShaderRegisterType::output:          return operand.index < program.output_count;
+        case ShaderRegisterType::constant_buffer: return operand.index < shader_max_constant_buffers;
+        case ShaderRegisterType::resource:        return operand.index < shader_max_structured_buffers;
+        default:                                  return true;
+        }
+    }
+
+    /* FLOW CONTROL
+    * Finds where every if, else and loop ends, for the jumps execute_shader() makes when no lane goes that way:
+    * an if goes to its else or endif, an else to its endif, and a loop past its endloop. An endloop goes back to the
+    * first instruction of the loop. Also checks that they're nested correctly and not too deep, and that breaks and
+    * continues are in a loop.
+    */
+    bool link_flow_control(ShaderProgram& program) {
+        std::vector<ShaderInstruction>& instructions = program.instructions;
+        std::vector<uint32_t> open; // The if, else or loop of every block we're in
+        uint32_t loop_depth = 0;
+        for (uint32_t i = 0; i < instructions.size(); ++i) {
+            const ShaderOp op = instructions[i].op;
+            const ShaderOp open_op = open.empty() ? ShaderOp::ret : instructions[open.back()].op;
+            bool nested = true;
+            switch (op) {
+            case ShaderOp::if_z:
+            case ShaderOp::if_nz:
+                open.push_back(i);
+                break;
+            case ShaderOp::loop:
+                open.push_back(i);
+                ++loop_depth;
+                break;
+            case ShaderOp::else_:
+                nested = open_op == ShaderOp::if_z || open_op == ShaderOp::if_nz;
+                if (nested) {
+                    instructions[open.back()].jump = i;
+                    open.back() = i;
+                }
+                break;
+            case ShaderOp::endif:
+                nested = open_op == ShaderOp::if_z || open_op == ShaderOp::if_nz || open_op == ShaderOp::else_;
+                if (nested) {
+                    instructions[open.back()].jump = i;
+                    open.pop_back();
+                }
+                break;
+            case ShaderOp::endloop:
+                nested = open_op == ShaderOp::loop;
+                if (nested) {
+                    instructions[open.back()].jump = i + 1;
+                    instructions[i].jump = open.back() + 1;
+                    open.pop_back();
+                    --loop_depth;
+                }
+                break;
+            case ShaderOp::break_:
+            case ShaderOp::breakc_z:
+            case ShaderOp::breakc_nz:
+            case ShaderOp::continue_:
+            case ShaderOp::continuec_z:
+            case ShaderOp::continuec_nz:
+                nested = loop_depth > 0;
+                break;
+            default:
+                break;
+            }
+            if (!nested || open.size() > shader_max_flow_control_depth) {
+                printf("[ERROR] Shader flow control is not nested correctly, or nested too deep\n");
+                return false;
+            }
+        }
+        if (!open.empty()) {
+            printf("[ERROR] Shader flow control is not nested correctly\n");
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_bytecode(const uint32_t* tokens, const uint32_t token_count, ShaderProgram& program) {
+        if (token_count < 2) {
+            return false;
+        }
+        const uint32_t program_type = tokens[0] >> 16;
+        program.stage = program_type <= 1 ? static_cast<ShaderStage>(program_type) : ShaderStage::unsupported;
+        if (program.stage == ShaderStage::unsupported) {
+            printf("[ERROR] Only vertex and pixel shaders can run on the CPU\n");
+            return false;
+        }
+
+        const uint32_t* end = tokens + std::min(token_count, tokens[1]);
+        const uint32_t* token = tokens + 2;
+        while (token < end) {
+            const uint32_t opcode_token = token[0];
+            const uint32_t opcode = opcode_token & 0x7FF;
+            uint32_t length = (opcode_token >> 24) & 0x7F;
+            if (opcode == opcode_customdata) {
+                length = token + 1 < end ? token[1] : 0;
+            }
+            if (length == 0 || token + length > end) {
+                printf("[ERROR] Shader bytecode is corrupt\n");
+                return false;
+            }
+            const uint32_t* next = token + length;
+
+            // Skip extended opcode tokens (used for sample offsets and resource types, which we don't support anyway)
+            const uint32_t* operand_token = token + 1;
+            if (opcode != opcode_customdata && (opcode_token >> 31) != 0) {
+                while (operand_token < next && (*operand_token++ >> 31) != 0) {}
+            }
+
+            // Declarations tell us how many registers of each kind we need. Declarations of things we don't support,
+            // like resources, are skipped: the instructions that would use them are rejected below.
+            if (is_declaration(opcode) || opcode == opcode_customdata) {
+                if (opcode == opcode_dcl_temps && length >= 2) {
+                    program.temp_count = token[1];
+                }
+                else if ((opcode >= opcode_dcl_input && opcode <= opcode_dcl_input_ps_siv) ||
+                         (opcode >= opcode_dcl_output && opcode <= opcode_dcl_output_siv)) {
+                    ShaderOperand operand;
+                    if (!parse_operand(operand_token, next, operand)) {
+                        return false;
+                    }
+                    uint32_t& count = opcode >= opcode_dcl_output ? program.output_count : program.input_count;
+                    count = std::max(count, operand.index + 1);
+                }
+                token = next;
+                continue;
+            }
+
+            ShaderInstruction instruction;
+            instruction.saturate = ((opcode_token >> 13) & 1) != 0;
+            if (opcode == opcode_nop) {
+                token = next;
+                continue;
+            }
+            if (opcode == opcode_ret) {
+                instruction.op = ShaderOp::ret;
+                program.instructions.push_back(instruction);
+                token = next;
+                continue;
+            }
+
+            // Bit 18 says whether conditional instructions test for non-zero or zero
+            const bool non_zero = ((opcode_token >> 18) & 1) != 0;
+            bool flow_control = true;
+            switch (opcode) {
+            case opcode_if:        instruction.op = non_zero ? ShaderOp::if_nz : ShaderOp::if_z; break;
+            case opcode_else:      instruction.op = ShaderOp::else_; break;
+            case opcode_endif:     instruction.op = ShaderOp::endif; break;
+            case opcode_loop:      instruction.op = ShaderOp::loop; break;
+            case opcode_endloop:   instruction.op = ShaderOp::endloop; break;
+            case opcode_break:     instruction.op = ShaderOp::break_; break;
+            case opcode_breakc:    instruction.op = non_zero ? ShaderOp::breakc_nz : ShaderOp::breakc_z; break;
+            case opcode_continue:  instruction.op = ShaderOp::continue_; break;
+            case opcode_continuec: instruction.op = non_zero ? ShaderOp::continuec_nz : ShaderOp::continuec_z; break;
+            case opcode_retc:      instruction.op = non_zero ? ShaderOp::retc_nz : ShaderOp::retc_z; break;
+            default:               flow_control = false; break;
+            }
+            if (flow_control) {
+                if (opcode == opcode_if || opcode == opcode_breakc || opcode == opcode_continuec || opcode == opcode_retc) {
+                    instruction.source_count = 1;
+                    if (!parse_operand(operand_token, next, instruction.sources[0]) || !validate_operand(instruction.sources[0], program) ||
+                        instruction.sources[0].type == ShaderRegisterType::resource) {
+                        return false;
+                    }
+                }
+                program.instructions.push_back(instruction);
+                token = next;
+                continue;
+            }
+
+            if (opcode == opcode_discard) {
+                instruction.op = non_zero ? ShaderOp::discard_nz : ShaderOp::discard_z;
+                instruction.source_count = 1;
+                if (!parse_operand(operand_token, next, instruction.sources[0]) || !validate_operand(instruction.sources[0], program)) {
+                    return false;
+                }
+                program.instructions.push_back(instruction);
+                token = next;
+                continue;
+            }
+
+            const OpcodeInfo* info = nullptr;
+            for (const auto& entry : opcode_table) {
+                if (entry.opcode == opcode) {
+                    info = &entry;
+                    break;
+                }
+            }
+            if (!info) {
+                printf("[ERROR] Shader opcode %u is not supported on the CPU\n", opcode);
+                return false;
+            }
+
+            instruction.op = info->op;
+            instruction.source_count = info->source_count;
+            if (!parse_operand(operand_token, next, instruction.destination) || !validate_operand(instruction.destination, program)) {
+                return false;
+            }
+            if (has_second_destination(instruction.op) &&
+                (!parse_operand(operand_token, next, instruction.second_destination) || !validate_operand(instruction.second_destination, program))) {
+                return false;
+            }
+            if (is_derivative(instruction.op)) {
+                if (program.stage != ShaderStage::pixel) {
+                    printf("[ERROR] Derivatives are only supported in pixel shaders\n");
+                    return false;
+                }
+                program.uses_derivatives = true;
+            }
+            for (uint8_t i = 0; i < instruction.source_count; ++i) {
+                if (!parse_operand(operand_token, next, instruction.sources[i]) || !validate_operand(instruction.sources[i], program)) {
+                    return false;
+                }
+                // Resources can only be read through loads, and the resource of a load is always its last operand
+                const bool resource = instruction.sources[i].type == ShaderRegisterType::resource;
+                if (resource != (instruction.op == ShaderOp::ld_structured && i == 2)) {
+                    printf("[ERROR] Shader opcode %u reads a resource in a way that is not supported on the CPU\n", opcode);
+                    return false;
+                }
+                ShaderModifier& modifier = instruction.sources[i].modifier;
+                if (reads_integers(instruction.op) && modifier != ShaderModifier::none) {
+                    if (modifier != ShaderModifier::negate) {
+                        printf("[ERROR] Shader opcode %u has a float modifier on an integer source\n", opcode);
+                        return false;
+                    }
+                    modifier = ShaderModifier::integer_negate;
+                }
+            }
+            for (const ShaderOperand* destination : { &instruction.destination, &instruction.second_destination }) {
+                if (destination->type == ShaderRegisterType::immediate || destination->type == ShaderRegisterType::constant_buffer ||
+                    destination->type == ShaderRegisterType::resource) {
+                    return false;
+                }
+            }
+            program.instructions.push_back(instruction);
+            token = next;
+        }
+        return link_flow_control(program);
+    }
+
+    // Reinterpret lanes as integers, for the comparison and bitwise instructions
+    uint32_t as_bits(const float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float from_bits(const uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    int32_t as_int(const float value) {
+        return static_cast<int32_t>(as_bits(value));
+    }
+
+    // Float to integer like D3D does it: rounded towards zero, NaN becomes 0 and out of range values saturate.
+    // A plain cast is undefined behavior for those.
+    int32_t float_to_int(const float value) {
+        if (std::isnan(value)) {
+            return 0;
+        }
+        if (value >= 2147483648.0f) {
+            return INT32_MAX;
+        }
+        if (value <= -2147483648.0f) {
+            return INT32_MIN;
+        }
+        return static_cast<int32_t>(value);
+    }
+
+    uint32_t float_to_uint(const float value) {
+        if (!(value > 0.0f)) { // Also catches NaN
+            return 0;
+        }
+        if (value >= 4294967296.0f) {
+            return UINT32_MAX;
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    // Fetch a source operand with its swizzle and modifier applied
+    void load_source(const ShaderOperand& operand, const ShaderContext& context, ShaderRegister& value) {
+        constexpr uint32_t n = shader_lane_count;
+        switch (operand.type) {
+        case ShaderRegisterType::temp:
+        case ShaderRegisterType::input:
+        case ShaderRegisterType::output: {
+            const std::vector<ShaderRegister>& file = operand.type == ShaderRegisterType::temp ? context.temps
+                                                    : operand.type == ShaderRegisterType::input ? context.inputs : context.outputs;
+            const ShaderRegister& source = file[operand.index];
+            for (int c = 0; c < 4; ++c) {
+                memcpy(value.lanes[c], source.lanes[operand.swizzle[c]], sizeof(value.lanes[c]));
+            }
+            break;
+        }
+        case ShaderRegisterType::constant_buffer: {
+            const float* buffer = context.constant_buffers[operand.index];
+            const bool in_range = buffer && operand.element < context.constant_buffer_sizes[operand.index];
+            for (int c = 0; c < 4; ++c) {
+                const float constant = in_range ? buffer[operand.element * 4 + operand.swizzle[c]] : 0.0f;
+                for (uint32_t l = 0; l < n; ++l) value.lanes[c][l] = constant;
+            }
+            break;
+        }
+        case ShaderRegisterType::immediate:
+            for (int c = 0; c < 4; ++c) {
+                const float constant = operand.immediate[operand.swizzle[c]];
+                for (uint32_t l = 0; l < n; ++l) value.lanes[c][l] = constant;
+            }
+            break;
+        default:
+            memset(&value, 0, sizeof(value));
+            break;
+        }
+
+        if (operand.modifier == ShaderModifier::absolute || operand.modifier == ShaderModifier::absolute_negate) {
+            for (auto& component : value.lanes) {
+                for (uint32_t l = 0; l < n; ++l) component[l] = std::fabs(component[l]);
+            }
+        }
+        if (operand.modifier == ShaderModifier::negate || operand.modifier == ShaderModifier::absolute_negate) {
+            for (auto& component : value.lanes) {
+                for (uint32_t l = 0; l < n; ++l) component[l] = -component[l];
+            }
+        }
+        if (operand.modifier == ShaderModifier::integer_negate) {
+            for (auto& component : value.lanes) {
+                for (uint32_t l = 0; l < n; ++l) component[l] = from_bits(0u - as_bits(component[l]));
+            }
+        }
+    }
+
+    // Write a result to a destination register, only the components in the write mask and only the active lanes
+    void write_destination(const ShaderOperand& destination, const ShaderRegister& value, const bool saturate, const uint32_t active,
+                           ShaderContext& context) {
+        constexpr uint32_t n = shader_lane_count;
+        if (destination.type == ShaderRegisterType::null) {
+            return;
+        }
+        std::vector<ShaderRegister>& file = destination.type == ShaderRegisterType::temp ? context.temps
+                                          : destination.type == ShaderRegisterType::input ? context.inputs : context.outputs;
+        ShaderRegister& target = file[destination.index];
+        for (int i = 0; i < 4; ++i) {
+            if (!(destination.mask & (1 << i))) {
+                continue;
+            }
+            const float* values = value.lanes[i];
+            float saturated[n];
+            if (saturate) {
+                // fmax/fmin with NaN return the other value, so NaN saturates to 0 like on the GPU
+                for (uint32_t l = 0; l < n; ++l) saturated[l] = std::fmin(std::fmax(values[l], 0.0f), 1.0f);
+                values = saturated;
+            }
+            if (active == (1u << n) - 1) {
+                memcpy(target.lanes[i], values, sizeof(target.lanes[i]));
+            }
+            else {
+                for (uint32_t l = 0; l < n; ++l) target.lanes[i][l] = (active >> l) & 1 ? values[l] : target.lanes[i][l];
+            }
+        }
+    }
+
+    // An if or a loop that's running
+    struct FlowControlBlock {
+        bool loop;
+        uint32_t restore;   // The lanes that were active when it started, they're active again after it
+        uint32_t pending;   // If: the lanes that run the else. Loop: the lanes that haven't left it, they run the next iteration.
+    };
+}
+
+bool load_shader_program(const void* bytecode, const size_t size, ShaderProgram& program) {
+    program = {};
+    const auto* data = static_cast<const uint8_t*>(bytecode);
+
+    // Container header: "DXBC", 16 byte checksum, version, total size, chunk count, then the chunk offsets
+    if (!data || size < 32 || read_u32(data) != fourcc('D', 'X', 'B', 'C')) {
+        printf("[ERROR] Shader is not a DXBC container\n");
+        return false;
+    }
+    const uint32_t chunk_count = read_u32(data + 28);
+    if (32 + static_cast<uint64_t>(chunk_count) * 4 > size) {
+        return false;
+    }
+
+    const uint8_t* shader_chunk = nullptr;
+    uint32_t shader_chunk_size = 0;
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        const uint32_t offset = read_u32(data + 32 + i * 4);
+        if (offset + 8ull > size) {
+            return false;
+        }
+        const uint32_t type = read_u32(data + offset);
+        const uint32_t chunk_size = read_u32(data + offset + 4);
+        if (offset + 8ull + chunk_size > size) {
+            return false;
+        }
+        const uint8_t* chunk = data + offset + 8;
+
+        if (type == fourcc('I', 'S', 'G', 'N') || type == fourcc('I', 'S', 'G', '1')) {
+            if (!parse_signature(chunk, chunk_size, type, program.inputs)) return false;
+        }
+        else if (type == fourcc('O', 'S', 'G', 'N') || type == fourcc('O', 'S', 'G', '5') || type == fourcc('O', 'S', 'G', '1')) {
+            if (!parse_signature(chunk, chunk_size, type, program.outputs)) return false;
+        }
+        else if (type == fourcc('S', 'H', 'D', 'R') || type == fourcc('S', 'H', 'E', 'X')) {
+            shader_chunk = chunk;
+            shader_chunk_size = chunk_size;
+        }
+        else if (type == fourcc('D', 'X', 'I', 'L')) {
+            printf("[ERROR] DXIL shaders (shader model 6) can't run on the CPU, compile with FXC instead\n");
+            return false;
+        }
+    }
+
+    if (!shader_chunk) {
+        printf("[ERROR] Shader has no bytecode chunk\n");
+        return false;
+    }
+
+    // The chunk data is only guaranteed to be 4-byte aligned relative to the container, so copy it out
+    std::vector<uint32_t> tokens(shader_chunk_size / 4);
+    memcpy(tokens.data(), shader_chunk, tokens.size() * 4);
+    if (!parse_bytecode(tokens.data(), static_cast<uint32_t>(tokens.size()), program)) {
+        program.instructions.clear();
+        return false;
+    }
+    return true;
+}
+
+int find_shader_register(const std::vector<ShaderSignatureElement>& signature, const char* semantic_name, const uint32_t semantic_index) {
+    for (const auto& element : signature) {
+#ifdef _WIN32
+        const bool same_name = _stricmp(element.semantic_name.c_str(), semantic_name) == 0;
+#else
+        const bool same_name = strcasecmp(element.semantic_name.c_str(), semantic_name) == 0;
+#endif
+        if (same_name && element.semantic_index == semantic_index) {
+            return static_cast<int>(element.register_index);
+        }
+    }
+    return -1;
+}
+
+int find_shader_system_value_register(const std::vector<ShaderSignatureElement>& signature, const uint32_t system_value) {
+    for (const auto& element : signature) {
+        if (element.system_value == system_value) {
+            return static_cast<int>(element.register_index);
+        }
+    }
+    return -1;
+}
+
+void ShaderContext::prepare(const ShaderProgram& program) {
+    inputs.resize(program.input_count);
+    outputs.resize(program.output_count);
+    temps.resize(program.temp_count);
+    discarded_lanes = 0;
+}
+
+void execute_shader(const ShaderProgram& program, ShaderContext& context) {
+    constexpr uint32_t n = shader_lane_count;
+    constexpr uint32_t all_lanes = (1u << n) - 1;
+    ShaderRegister a;
+    ShaderRegister b;
+    ShaderRegister c;
+    ShaderRegister result;
+    ShaderRegister second_result;
+
+    // Lanes that don't take a branch, have left a loop or returned are inactive: they skip the instructions, and
+    // their registers aren't written. Flow control instructions always run, they're what changes the mask.
+    FlowControlBlock blocks[shader_max_flow_control_depth];
+    uint32_t depth = 0;
+    uint32_t active = all_lanes;
+    uint32_t alive = all_lanes; // Lanes that haven't returned yet
+
+    const ShaderInstruction* instructions = program.instructions.data();
+    const uint32_t instruction_count = static_cast<uint32_t>(program.instructions.size());
+    uint32_t pc = 0;
+    while (pc < instruction_count) {
+        const ShaderInstruction& instruction = instructions[pc++];
+        const bool flow_control = instruction.op >= ShaderOp::if_z;
+        if (active == 0 && !flow_control) {
+            continue;
+        }
+        if (instruction.source_count > 0) load_source(instruction.sources[0], context, a);
+        if (instruction.source_count > 1) load_source(instruction.sources[1], context, b);
+        if (instruction.source_count > 2) load_source(instruction.sources[2], context, c);
+
+        if (flow_control) {
+            // The active lanes where the condition holds, or all of them for the unconditional ones
+            uint32_t lanes = active;
+            if (instruction.source_count > 0) {
+                const bool non_zero = instruction.op == ShaderOp::if_nz || instruction.op == ShaderOp::breakc_nz ||
+                                      instruction.op == ShaderOp::continuec_nz || instruction.op == ShaderOp::retc_nz;
+                lanes = 0;
+                for (uint32_t l = 0; l < n; ++l) {
+                    lanes |= static_cast<uint32_t>((as_bits(a.lanes[0][l]) != 0) == non_zero) << l;
+                }
+                lanes &= active;
+            }
+
+            switch (instruction.op) {
+            case ShaderOp::if_z:
+            case ShaderOp::if_nz:
+                blocks[depth++] = { false, active, active & ~lanes };
+                active = lanes;
+                if (active == 0) {
+                    pc = instruction.jump;
+                }
+                break;
+            case ShaderOp::else_:
+                active = blocks[depth - 1].pending & alive;
+                if (active == 0) {
+                    pc = instruction.jump;
+                }
+                break;
+            case ShaderOp::endif:
+                active = blocks[--depth].restore & alive;
+                break;
+            case ShaderOp::loop:
+                if (active == 0) {
+                    pc = instruction.jump;
+                    break;
+                }
+                blocks[depth++] = { true, active, active };
+                break;
+            case ShaderOp::endloop:
+                active = blocks[depth - 1].pending & alive;
+                if (active != 0) {
+                    pc = instruction.jump;
+                }
+                else {
+                    active = blocks[--depth].restore & alive;
+                }
+                break;
+            case ShaderOp::break_:
+            case ShaderOp::breakc_z:
+            case ShaderOp::breakc_nz:
+            case ShaderOp::continue_:
+            case ShaderOp::continuec_z:
+            case ShaderOp::continuec_nz: {
+                // The lanes stay inactive until the end of the loop, a break also takes them out of the next iterations.
+                // Other lanes can still be waiting for an else, so this doesn't jump.
+                active &= ~lanes;
+                uint32_t block = depth - 1;
+                for (; !blocks[block].loop; --block) {
+                    blocks[block].restore &= ~lanes;
+                    blocks[block].pending &= ~lanes;
+                }
+                if (instruction.op == ShaderOp::break_ || instruction.op == ShaderOp::breakc_z || instruction.op == ShaderOp::breakc_nz) {
+                    blocks[block].pending &= ~lanes;
+                }
+                break;
+            }
+            case ShaderOp::retc_z:
+            case ShaderOp::retc_nz:
+            case ShaderOp::ret:
+                alive &= ~lanes;
+                active &= ~lanes;
+                if (alive == 0) {
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+            continue;
+        }
+
+        switch (instruction.op) {
+        case ShaderOp::discard_z:
+        case ShaderOp::discard_nz:
+            for (uint32_t l = 0; l < n; ++l) {
+                const bool non_zero = as_bits(a.lanes[0][l]) != 0;
+                if (non_zero == (instruction.op == ShaderOp::discard_nz)) {
+                    context.discarded_lanes |= (1u << l) & active;
+                }
+            }
+            continue;
+        case ShaderOp::dp2:
+        case ShaderOp::dp3:
+        case ShaderOp::dp4: {
+            const int component_count = instruction.op == ShaderOp::dp2 ? 2 : (instruction.op == ShaderOp::dp3 ? 3 : 4);
+            for (uint32_t l = 0; l < n; ++l) {
+                float sum = a.lanes[0][l] * b.lanes[0][l];
+                for (int i = 1; i < component_count; ++i) {
+                    sum += a.lanes[i][l] * b.lanes[i][l];
+                }
+                result.lanes[0][l] = sum;
+            }
+            for (int i = 1; i < 4; ++i) {
+                memcpy(result.lanes[i], result.lanes[0], sizeof(result.lanes[0]));
+            }
+            break;
+        }
+        case ShaderOp::imul:
+        case ShaderOp::umul:
+        case ShaderOp::udiv:
+            // Two results: the high and low 32 bits of the product, or the quotient and remainder. Dividing by 0 gives
+            // all bits set for both, like D3D specifies.
+            for (int i = 0; i < 4; ++i) {
+                if (!((instruction.destination.mask | instruction.second_destination.mask) & (1 << i))) {
+                    continue;
+                }
+                for (uint32_t l = 0; l < n; ++l) {
+                    const uint32_t x = as_bits(a.lanes[i][l]);
+                    const uint32_t y = as_bits(b.lanes[i][l]);
+                    if (instruction.op == ShaderOp::udiv) {
+                        result.lanes[i][l] = from_bits(y != 0 ? x / y : ~0u);
+                        second_result.lanes[i][l] = from_bits(y != 0 ? x % y : ~0u);
+                    }
+                    else {
+                        const uint64_t product = instruction.op == ShaderOp::imul
+                            ? static_cast<uint64_t>(static_cast<int64_t>(as_int(a.lanes[i][l])) * as_int(b.lanes[i][l]))
+                            : static_cast<uint64_t>(x) * y;
+                        result.lanes[i][l] = from_bits(static_cast<uint32_t>(product >> 32));
+                        second_result.lanes[i][l] = from_bits(static_cast<uint32_t>(product));
+                    }
+                }
+            }
+            write_destination(instruction.second_destination, second_result, false, active, context);
+            break;
+        case ShaderOp::deriv_rtx_coarse:
+        case ShaderOp::deriv_rtx_fine:
+        case ShaderOp::deriv_rty_coarse:
+        case ShaderOp::deriv_rty_fine:
+            // The difference to the neighbor in the quad. Coarse uses the top row or the left column for the whole
+            // quad, fine uses the pixel's own row or column.
+            for (int i = 0; i < 4; ++i) {
+                for (uint32_t quad = 0; quad < n; quad += 4) {
+                    const float* x = a.lanes[i] + quad;
+                    float* r = result.lanes[i] + quad;
+                    switch (instruction.op) {
+                    case ShaderOp::deriv_rtx_coarse: r[0] = r[1] = r[2] = r[3] = x[1] - x[0]; break;
+                    case ShaderOp::deriv_rtx_fine:   r[0] = r[1] = x[1] - x[0]; r[2] = r[3] = x[3] - x[2]; break;
+                    case ShaderOp::deriv_rty_coarse: r[0] = r[1] = r[2] = r[3] = x[2] - x[0]; break;
+                    default:                         r[0] = r[2] = x[2] - x[0]; r[1] = r[3] = x[3] - x[1]; break;
+                    }
+                }
+            }
+            break;
+        case ShaderOp::ld_structured: {
+            // Element index and byte offset per lane, the resource swizzle picks the dword after the offset for
+            // every component. Anything outside the buffer or the element reads 0, like on the GPU.
+            const ShaderOperand& resource = instruction.sources[2];
+            const ShaderStructuredBuffer& buffer = context.structured_buffers[resource.index];
+            for (int i = 0; i < 4; ++i) {
+                if (!(instruction.destination.mask & (1 << i))) {
+                    continue;
+                }
+                for (uint32_t l = 0; l < n; ++l) {
+                    const uint32_t element = as_bits(a.lanes[0][l]);
+                    const uint64_t offset = static_cast<uint64_t>(as_bits(b.lanes[0][l])) + resource.swizzle[i] * 4u;
+                    uint32_t bits = 0;
+                    if (buffer.data && element < buffer.element_count && offset + 4 <= buffer.stride) {
+                        memcpy(&bits, buffer.data + static_cast<size_t>(element) * buffer.stride + offset, sizeof(bits));
+                    }
+                    result.lanes[i][l] = from_bits(bits);
+                }
+            }
+            break;
+        }
+        default:
+            for (int i = 0; i < 4; ++i) {
+                if (!(instruction.destination.mask & (1 << i))) {
+                    continue;
+                }
+                float* r = result.lanes[i];
+                const float* x = a.lanes[i];
+                const float* y = b.lanes[i];
+                const float* z = c.lanes[i];
+                switch (instruction.op) {
+                case ShaderOp::mov:      for (uint32_t l = 0; l < n; ++l) r[l] = x[l]; break;
+                case ShaderOp::movc:     for (uint32_t l = 0; l < n; ++l) r[l] = as_bits(x[l]) ? y[l] : z[l]; break;
+                case ShaderOp::add:      for (uint32_t l = 0; l < n; ++l) r[l] = x[l] + y[l]; break;
+                case ShaderOp::mul:      for (uint32_t l = 0; l < n; ++l) r[l] = x[l] * y[l]; break;
+                case ShaderOp::mad:      for (uint32_t l = 0; l < n; ++l) r[l] = x[l] * y[l] + z[l]; break;
+                case ShaderOp::div:      for (uint32_t l = 0; l < n; ++l) r[l] = x[l] / y[l]; break;
+                case ShaderOp::min:      for (uint32_t l = 0; l < n; ++l) r[l] = std::fmin(x[l], y[l]); break;
+                case ShaderOp::max:      for (uint32_t l = 0; l < n; ++l) r[l] = std::fmax(x[l], y[l]); break;
+                case ShaderOp::rsq:      for (uint32_t l = 0; l < n; ++l) r[l] = 1.0f / std::sqrt(x[l]); break;
+                case ShaderOp::sqrt:     for (uint32_t l = 0; l < n; ++l) r[l] = std::sqrt(x[l]); break;
+                case ShaderOp::frc:      for (uint32_t l = 0; l < n; ++l) r[l] = x[l] - std::floor(x[l]); break;
+                case ShaderOp::exp:      for (uint32_t l = 0; l < n; ++l) r[l] = std::exp2(x[l]); break;
+                case ShaderOp::log:      for (uint32_t l = 0; l < n; ++l) r[l] = std::log2(x[l]); break;
+                case ShaderOp::round_ni: for (uint32_t l = 0; l < n; ++l) r[l] = std::floor(x[l]); break;
+                case ShaderOp::lt:       for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(x[l] < y[l] ? ~0u : 0u); break;
+                case ShaderOp::ge:       for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(x[l] >= y[l] ? ~0u : 0u); break;
+                case ShaderOp::eq:       for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(x[l] == y[l] ? ~0u : 0u); break;
+                case ShaderOp::ne:       for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(x[l] != y[l] ? ~0u : 0u); break;
+                case ShaderOp::bit_and:  for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) & as_bits(y[l])); break;
+                case ShaderOp::bit_or:   for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) | as_bits(y[l])); break;
+                case ShaderOp::bit_xor:  for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) ^ as_bits(y[l])); break;
+                case ShaderOp::bit_not:  for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(~as_bits(x[l])); break;
+                case ShaderOp::ftoi:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(static_cast<uint32_t>(float_to_int(x[l]))); break;
+                case ShaderOp::ftou:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(float_to_uint(x[l])); break;
+                case ShaderOp::itof:     for (uint32_t l = 0; l < n; ++l) r[l] = static_cast<float>(as_int(x[l])); break;
+                case ShaderOp::utof:     for (uint32_t l = 0; l < n; ++l) r[l] = static_cast<float>(as_bits(x[l])); break;
+                case ShaderOp::iadd:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) + as_bits(y[l])); break;
+                case ShaderOp::imad:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) * as_bits(y[l]) + as_bits(z[l])); break;
+                case ShaderOp::ineg:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(0u - as_bits(x[l])); break;
+                case ShaderOp::ieq:      for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) == as_bits(y[l]) ? ~0u : 0u); break;
+                case ShaderOp::ine:      for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) != as_bits(y[l]) ? ~0u : 0u); break;
+                case ShaderOp::ilt:      for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_int(x[l]) < as_int(y[l]) ? ~0u : 0u); break;
+                case ShaderOp::ige:      for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_int(x[l]) >= as_int(y[l]) ? ~0u : 0u); break;
+                case ShaderOp::imin:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(static_cast<uint32_t>(std::min(as_int(x[l]), as_int(y[l])))); break;
+                case ShaderOp::imax:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(static_cast<uint32_t>(std::max(as_int(x[l]), as_int(y[l])))); break;
+                case ShaderOp::ishl:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) << (as_bits(y[l]) & 31)); break;
+                case ShaderOp::ishr:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(static_cast<uint32_t>(as_int(x[l]) >> (as_bits(y[l]) & 31))); break;
+                case ShaderOp::ushr:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) >> (as_bits(y[l]) & 31)); break;
+                case ShaderOp::ult:      for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) < as_bits(y[l]) ? ~0u : 0u); break;
+                case ShaderOp::uge:      for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(as_bits(x[l]) >= as_bits(y[l]) ? ~0u : 0u); break;
+                case ShaderOp::umin:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(std::min(as_bits(x[l]), as_bits(y[l]))); break;
+                case ShaderOp::umax:     for (uint32_t l = 0; l < n; ++l) r[l] = from_bits(std::max(as_bits(x[l]), as_bits(y[l]))); break;
+                default: break;
+                }
+            }
+            break;
+        }
+
+        write_destination(instruction.destination, result, instruction.saturate, active, context);
+    }
+}
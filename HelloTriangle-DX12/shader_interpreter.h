@@ -0,0 +1,208 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* CPU SHADER INTERPRETER
+* Runs the compiled .cso files (the same bytes we hand to CreateGraphicsPipelineState) on the CPU, so the
+* shaders can be executed on machines without a GPU. FXC outputs DXBC: a container with chunks for the
+* input/output signatures and the shader bytecode itself (SHDR for shader model 4, SHEX for shader model 5).
+*
+* The bytecode is translated once into a small internal instruction list, and that list is then executed
+* for 8 vertices or pixels at a time. Registers are stored as structure-of-arrays (all 8 x values next to
+* each other, then all 8 y values, and so on), so every instruction is a simple loop the compiler turns
+* into SIMD instructions.
+*
+* The float and integer arithmetic that vertex and pixel shaders use is supported, with loads from structured
+* buffers, structured flow control (if, loop, break, continue, ret) and derivatives, but no texture sampling,
+* switch or subroutines. Shaders that use anything else fail to load with an error saying which opcode it was.
+*
+* Flow control runs all 8 lanes in lockstep with an execution mask, like a GPU does: a lane that skips an if or
+* leaves a loop early keeps its registers until the others get there. For derivatives, the lanes of a pixel
+* shader are two 2x2 quads, each in the order top left, top right, bottom left, bottom right.
+*/
+
+constexpr uint32_t shader_lane_count = 8;
+constexpr uint32_t shader_max_constant_buffers = 14;
+constexpr uint32_t shader_max_structured_buffers = 16;
+constexpr uint32_t shader_max_flow_control_depth = 64; // Nested ifs and loops, the D3D11 limit
+
+enum class ShaderStage : uint8_t {
+    pixel = 0,
+    vertex = 1,
+    unsupported,
+};
+
+enum class ShaderOp : uint8_t {
+    mov,
+    movc,
+    add,
+    mul,
+    mad,
+    div,
+    dp2,
+    dp3,
+    dp4,
+    min,
+    max,
+    rsq,
+    sqrt,
+    frc,
+    exp,
+    log,
+    round_ni,
+    lt,
+    ge,
+    eq,
+    ne,
+    bit_and,
+    bit_or,
+    ftoi,
+    ftou,
+    itof,
+    iadd,
+    imad,
+    imul,       // High and low 32 bits of the product
+    ineg,
+    ieq,
+    ine,
+    ilt,
+    ige,
+    imin,
+    imax,
+    ishl,
+    ishr,
+    ushr,
+    ult,
+    uge,
+    umin,
+    umax,
+    umul,
+    udiv,       // Quotient and remainder
+    utof,
+    bit_not,
+    bit_xor,
+    deriv_rtx_coarse,
+    deriv_rtx_fine,
+    deriv_rty_coarse,
+    deriv_rty_fine,
+    discard_z,
+    discard_nz,
+    ld_structured,
+
+    // Flow control, everything from here on runs even when no lane is active. _z and _nz test for zero or non-zero.
+    if_z,
+    if_nz,
+    else_,
+    endif,
+    loop,
+    endloop,
+    break_,
+    breakc_z,
+    breakc_nz,
+    continue_,
+    continuec_z,
+    continuec_nz,
+    retc_z,
+    retc_nz,
+    ret,
+};
+
+enum class ShaderRegisterType : uint8_t {
+    temp,
+    input,
+    output,
+    constant_buffer,
+    immediate,
+    resource,
+    null,
+};
+
+enum class ShaderModifier : uint8_t {
+    none,
+    negate,
+    absolute,
+    absolute_negate,
+    integer_negate,     // Negate on an integer operand, two's complement
+};
+
+struct ShaderOperand {
+    ShaderRegisterType type = ShaderRegisterType::null;
+    ShaderModifier modifier = ShaderModifier::none;
+    uint8_t mask = 0xF;                     // Destination write mask, bit 0 = x
+    uint8_t swizzle[4] = { 0, 1, 2, 3 };    // Source component for x, y, z and w
+    uint32_t index = 0;                     // Register index, or constant or structured buffer slot
+    uint32_t element = 0;                   // Constant buffer element (float4 index)
+    float immediate[4] = {};
+};
+
+struct ShaderInstruction {
+    ShaderOp op = ShaderOp::mov;
+    bool saturate = false;
+    uint8_t source_count = 0;
+    uint32_t jump = 0;                      // Flow control: where to go when no lane takes this way, or back to the loop start
+    ShaderOperand destination;
+    ShaderOperand second_destination;       // Low bits of imul and umul, remainder of udiv
+    ShaderOperand sources[3];
+};
+
+// An entry in the input or output signature, e.g. "COLOR0 in register 1, components xyz"
+struct ShaderSignatureElement {
+    std::string semantic_name;
+    uint32_t semantic_index = 0;
+    uint32_t system_value = 0; // D3D_NAME: 0 = none, 1 = SV_Position, 64 = SV_Target, ...
+    uint32_t register_index = 0;
+    uint8_t mask = 0;
+};
+
+struct ShaderProgram {
+    ShaderStage stage = ShaderStage::unsupported;
+    uint32_t temp_count = 0;
+    uint32_t input_count = 0;   // Number of input registers, not signature elements
+    uint32_t output_count = 0;
+    bool uses_derivatives = false;  // The lanes have to be 2x2 quads of pixels
+    std::vector<ShaderSignatureElement> inputs;
+    std::vector<ShaderSignatureElement> outputs;
+    std::vector<ShaderInstruction> instructions;
+};
+
+// Parse a DXBC container and translate its bytecode. Returns false (and prints why) if the shader can't be run.
+bool load_shader_program(const void* bytecode, size_t size, ShaderProgram& program);
+
+// Find the register that holds a semantic, e.g. ("COLOR", 0). Returns -1 if the signature doesn't have it.
+int find_shader_register(const std::vector<ShaderSignatureElement>& signature, const char* semantic_name, uint32_t semantic_index);
+int find_shader_system_value_register(const std::vector<ShaderSignatureElement>& signature, uint32_t system_value);
+
+// One float4 register for 8 lanes, stored as [component][lane]
+struct alignas(32) ShaderRegister {
+    float lanes[4][shader_lane_count];
+};
+
+// A StructuredBuffer<T> bound to a t# slot, the CPU side of a buffer SRV
+struct ShaderStructuredBuffer {
+    const uint8_t* data = nullptr;
+    uint32_t stride = 0;                    // sizeof(T) in bytes
+    uint32_t element_count = 0;             // Loads past the end, or past the end of an element, return 0
+};
+
+/* EXECUTION CONTEXT
+* Holds the registers for one batch of 8 invocations. Fill in the inputs, point the constant buffers at
+* the constant data (as float4s, the same layout as on the GPU) and the structured buffers at theirs, run
+* the shader, then read the outputs.
+*/
+struct ShaderContext {
+    std::vector<ShaderRegister> inputs;
+    std::vector<ShaderRegister> outputs;
+    std::vector<ShaderRegister> temps;
+    const float* constant_buffers[shader_max_constant_buffers] = {};
+    uint32_t constant_buffer_sizes[shader_max_constant_buffers] = {}; // In float4s, reads past the end return 0
+    ShaderStructuredBuffer structured_buffers[shader_max_structured_buffers];
+    uint32_t discarded_lanes = 0; // Bit per lane, set by discard instructions in pixel shaders
+
+    void prepare(const ShaderProgram& program);
+};
+
+// Run the program for all 8 lanes. Lanes that aren't used just compute garbage, they don't need to be masked. In a
+// pixel shader they're the helper lanes that derivatives need.
+void execute_shader(const ShaderProgram& program, ShaderContext& context);
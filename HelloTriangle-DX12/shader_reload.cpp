@@ -0,0 +1,230 @@
+#include "shader_reload.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "file_io.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Appends the files included with #include "name" to `includes`. Good enough for our own shaders: it doesn't
+    // know about comments or #if, so it can find an include that isn't used, which only means an extra rebuild.
+    void find_includes(const char* text, const size_t size, std::vector<std::string>& includes) {
+        const char* end = text + size;
+        for (const char* line = text; line < end;) {
+            const char* line_end = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+            if (!line_end) {
+                line_end = end;
+            }
+            const char* c = line;
+            while (c < line_end && (*c == ' ' || *c == '\t')) {
+                ++c;
+            }
+            constexpr char directive[] = "#include";
+            constexpr size_t directive_length = sizeof(directive) - 1;
+            if (static_cast<size_t>(line_end - c) > directive_length && memcmp(c, directive, directive_length) == 0) {
+                const char* open = static_cast<const char*>(memchr(c, '"', static_cast<size_t>(line_end - c)));
+                const char* close = open ? static_cast<const char*>(memchr(open + 1, '"', static_cast<size_t>(line_end - open - 1))) : nullptr;
+                if (close) {
+                    includes.emplace_back(open + 1, close);
+                }
+            }
+            line = line_end + 1;
+        }
+    }
+
+    // The thread compiles shaders for as long as it takes, it shouldn't take time away from the frame
+    void lower_thread_priority() {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#else
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+    }
+}
+
+ShaderReloader::~ShaderReloader() {
+    stop();
+}
+
+void ShaderReloader::add(const char* name, std::vector<std::string> sources, BuildFunction build, const ReleaseFunction release, void* user) {
+    Entry entry;
+    entry.name = name;
+    entry.sources = std::move(sources);
+    entry.build = std::move(build);
+    entry.release = release;
+    entry.user = user;
+    entries.push_back(std::move(entry));
+}
+
+bool ShaderReloader::start(const std::string& watched_directory, const uint32_t settle_time_ms) {
+    stop();
+    if (!watcher.open(watched_directory)) {
+        return false;
+    }
+    directory = watched_directory;
+    settle_ms = settle_time_ms;
+    running = true;
+    thread = std::thread([this]() { run(); });
+    return true;
+}
+
+void ShaderReloader::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    watcher.close();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Ready& result : ready) {
+        entries[result.entry].release(result.reload.object);
+    }
+    ready.clear();
+    has_ready = false;
+}
+
+void ShaderReloader::take_reloads(std::vector<ShaderReload>& reloads) {
+    if (!has_ready.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Ready& result : ready) {
+        reloads.push_back(result.reload);
+    }
+    ready.clear();
+    has_ready.store(false, std::memory_order_relaxed);
+}
+
+ShaderReloadStats ShaderReloader::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void ShaderReloader::scan_dependencies(Entry& entry) const {
+    // Breadth-first over the includes, every file once
+    entry.dependencies = entry.sources;
+    for (size_t i = 0; i < entry.dependencies.size(); ++i) {
+        size_t size = 0;
+        char* text = nullptr;
+        read_file(directory + "/" + entry.dependencies[i], size, text, true);
+        if (!text) {
+            continue;
+        }
+        std::vector<std::string> includes;
+        find_includes(text, size, includes);
+        free(text);
+        for (std::string& include : includes) {
+            if (std::find(entry.dependencies.begin(), entry.dependencies.end(), include) == entry.dependencies.end()) {
+                entry.dependencies.push_back(std::move(include));
+            }
+        }
+    }
+}
+
+void ShaderReloader::rebuild(const size_t entry_index, const Clock::time_point first_change) {
+    Entry& entry = entries[entry_index];
+    const auto build_start = Clock::now();
+    void* object = entry.build();
+    const auto build_end = Clock::now();
+
+    // The includes may have changed too
+    scan_dependencies(entry);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics.rebuilds++;
+    if (!object) {
+        statistics.failures++;
+        return;
+    }
+
+    ShaderReload reload;
+    reload.name = entry.name;
+    reload.user = entry.user;
+    reload.object = object;
+    reload.latency_ms = std::chrono::duration<double, std::milli>(build_end - first_change).count();
+    reload.build_ms = std::chrono::duration<double, std::milli>(build_end - build_start).count();
+    statistics.last_latency_ms = reload.latency_ms;
+    statistics.max_latency_ms = std::max(statistics.max_latency_ms, reload.latency_ms);
+
+    // If the last one wasn't taken yet, it never will be
+    const auto previous = std::find_if(ready.begin(), ready.end(), [&](const Ready& result) { return result.entry == entry_index; });
+    if (previous != ready.end()) {
+        entry.release(previous->reload.object);
+        previous->reload = reload;
+        statistics.superseded++;
+    }
+    else {
+        ready.push_back(Ready{ entry_index, reload });
+    }
+    has_ready.store(true, std::memory_order_release);
+}
+
+void ShaderReloader::run() {
+    lower_thread_priority();
+    for (Entry& entry : entries) {
+        scan_dependencies(entry);
+    }
+
+    // Changes are collected until no file changed for settle_ms, then everything that uses one of them is rebuilt.
+    // The wait times out regularly, so stop() doesn't have to wait long.
+    std::vector<std::string> events;
+    std::vector<std::string> changed;
+    Clock::time_point first_change{};
+    Clock::time_point last_change{};
+    std::vector<uint8_t> affected(entries.size());
+    while (running.load(std::memory_order_relaxed)) {
+        events.clear();
+        if (!watcher.wait(events, changed.empty() ? 100 : settle_ms)) {
+            puts("[ERROR] Stopped watching the shaders, watching the directory failed");
+            return;
+        }
+        const auto now = Clock::now();
+        for (std::string& file : events) {
+            if (changed.empty()) {
+                first_change = now;
+            }
+            last_change = now;
+            if (std::find(changed.begin(), changed.end(), file) == changed.end()) {
+                changed.push_back(std::move(file));
+            }
+        }
+        if (changed.empty() || now - last_change < std::chrono::milliseconds(settle_ms)) {
+            continue;
+        }
+
+        std::fill(affected.begin(), affected.end(), 0);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            for (const std::string& file : changed) {
+                if (std::find(entries[i].dependencies.begin(), entries[i].dependencies.end(), file) != entries[i].dependencies.end()) {
+                    affected[i] = 1;
+                    break;
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            statistics.changed_files += changed.size();
+        }
+        changed.clear();
+        for (size_t i = 0; i < entries.size() && running.load(std::memory_order_relaxed); ++i) {
+            if (affected[i]) {
+                rebuild(i, first_change);
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "file_watcher.h"
+
+/* SHADER RELOAD
+* Rebuilds pipelines while the app runs, when their shader sources change, without a frame ever waiting for it.
+* A background thread watches the shader source directory (see file_watcher.h). Once the changed files have been
+* quiet for a moment, it finds every pipeline that uses one of them, directly or through an #include, and rebuilds
+* it there: compiling its shaders and creating its pipeline state object, which can take a long time. The new
+* objects wait in a list, and the render thread takes them at the start of a frame, so a pipeline is only ever
+* swapped between two frames. The object it replaces can still be in use by frames in flight, so it goes into the
+* DeferredReleaseQueue. A pipeline that fails to build, usually because of a compile error, which the build function
+* prints, keeps its old object.
+*
+* Like the DeferredReleaseQueue, this doesn't know about D3D12. The objects are void pointers, and they come with
+* the functions that build and release them.
+*/
+
+struct ShaderReload {
+    const char* name = nullptr;
+    void* user = nullptr;               // What was passed to add(), like where the object goes
+    void* object = nullptr;             // The new object, the caller owns it now
+    double latency_ms = 0.0;            // From the first change to the object being ready
+    double build_ms = 0.0;
+};
+
+struct ShaderReloadStats {
+    uint64_t changed_files = 0;
+    uint64_t rebuilds = 0;
+    uint64_t failures = 0;
+    uint64_t superseded = 0;            // Objects that were rebuilt again before they were taken
+    double last_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+};
+
+class ShaderReloader {
+public:
+    using BuildFunction = std::function<void*()>;
+    using ReleaseFunction = void (*)(void* object);
+
+    ShaderReloader() = default;
+    ShaderReloader(const ShaderReloader&) = delete;
+    ShaderReloader& operator=(const ShaderReloader&) = delete;
+    ~ShaderReloader();
+
+    // Registers something to rebuild when one of its sources (relative to the watched directory), or a file they
+    // include, changes. `build` runs on the background thread, and returns the new object, or nullptr if it failed.
+    // Has to be called before start(). The name has to stay valid, e.g. a string literal.
+    void add(const char* name, std::vector<std::string> sources, BuildFunction build, ReleaseFunction release, void* user = nullptr);
+
+    // Starts watching `directory` on the background thread, a change is handled once no file changed for
+    // `settle_ms`. Returns false if the directory can't be watched.
+    bool start(const std::string& directory, uint32_t settle_ms = 50);
+
+    // Stops the background thread. Whatever wasn't taken yet is released.
+    void stop();
+
+    // Appends everything that was rebuilt since the last call to `reloads`. Only locks when there is something, so
+    // it's fine to call every frame.
+    void take_reloads(std::vector<ShaderReload>& reloads);
+
+    ShaderReloadStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        const char* name = nullptr;
+        std::vector<std::string> sources;
+        BuildFunction build;
+        ReleaseFunction release = nullptr;
+        void* user = nullptr;
+        std::vector<std::string> dependencies;  // The sources and everything they include, only used by the thread
+    };
+
+    void run();
+    void rebuild(size_t entry_index, Clock::time_point first_change);
+    void scan_dependencies(Entry& entry) const;
+
+    std::vector<Entry> entries;
+    std::string directory;
+    uint32_t settle_ms = 50;
+    FileWatcher watcher;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+
+    struct Ready {
+        size_t entry = 0;
+        ShaderReload reload;
+    };
+
+    // Shared with the thread that takes the reloads
+    mutable std::mutex mutex;
+    std::vector<Ready> ready;           // At most one per entry
+    std::atomic<bool> has_ready{ false };
+    ShaderReloadStats statistics;
+};
@@ -0,0 +1,1518 @@
+#include "software_rasterizer.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "light_clusters.h"
+#include "parallel_for.h"
+
+namespace {
+    constexpr int64_t subpixel_scale = 1 << raster_subpixel_bits;
+
+    // Screen positions are clamped to this, so the 64-bit edge functions can't overflow: positions take up 19 + 8 bits,
+    // so the products in the edge functions fit in 56 bits. It's outside the guard band, so only rounding ends up here.
+    constexpr float max_screen_coordinate = 524288.0f;
+
+    // Vertices closer to the w = 0 plane than this get clipped
+    constexpr float raster_min_clip_w = 1e-5f;
+
+    // Clipping a triangle against the w plane and the four guard band planes adds at most one vertex per plane
+    constexpr uint32_t max_clipped_polygon_vertices = 8;
+    constexpr uint32_t clipped_polygons_per_block = 64;
+
+    // Work sizes for the threads: vertices for the vertex shader, and triangles for binning
+    constexpr size_t vertex_chunk_size = 256;
+    constexpr size_t triangle_chunk_size = 512;
+
+    // Triangles per index batch, and the size of the hash table that finds the batch's unique vertices. The table is
+    // kept under half full, so most lookups hit on the first try.
+    constexpr uint32_t vertex_batch_triangles = 128;
+    constexpr uint32_t vertex_cache_size_log2 = 10;
+    constexpr uint32_t vertex_cache_size = 1 << vertex_cache_size_log2;
+    constexpr uint32_t vertex_cache_empty = UINT32_MAX;
+
+    // Shaded vertices are allocated in blocks of this many vertices
+    constexpr uint32_t shaded_vertices_per_block = 4096;
+
+    // SoftwareRenderTarget::cleared_blocks
+    constexpr uint8_t cleared_color_bit = 1 << 0;
+    constexpr uint8_t cleared_depth_bit = 1 << 1;
+
+    // The standard D3D sample positions, in 1/16th of a pixel from the pixel center
+    struct SamplePosition {
+        int8_t x, y;
+    };
+    constexpr SamplePosition sample_pattern_1x[] = { { 0, 0 } };
+    constexpr SamplePosition sample_pattern_2x[] = { { 4, 4 }, { -4, -4 } };
+    constexpr SamplePosition sample_pattern_4x[] = { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+    constexpr SamplePosition sample_pattern_8x[] = { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 }, { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } };
+
+    const SamplePosition* sample_pattern(const uint32_t sample_count) {
+        switch (sample_count) {
+            case 2: return sample_pattern_2x;
+            case 4: return sample_pattern_4x;
+            case 8: return sample_pattern_8x;
+            default: return sample_pattern_1x;
+        }
+    }
+
+    // How far the samples reach from the pixel center, in subpixels
+    int64_t sample_pattern_extent(const uint32_t sample_count) {
+        const SamplePosition* pattern = sample_pattern(sample_count);
+        int64_t extent = 0;
+        for (uint32_t i = 0; i < sample_count; ++i) {
+            extent = std::max({ extent, static_cast<int64_t>(std::abs(pattern[i].x)), static_cast<int64_t>(std::abs(pattern[i].y)) });
+        }
+        return extent * subpixel_scale / 16;
+    }
+
+    // Coarse pixels are at most 4x4 pixels
+    constexpr uint32_t max_shading_rate_size = 4;
+
+    // Combines the draw's shading rate with the rate from the image, like the second D3D12 combiner
+    ShadingRate combine_shading_rates(const ShadingRate draw_rate, const ShadingRate image_rate, const ShadingRateCombiner combiner) {
+        const uint32_t draw_x = static_cast<uint32_t>(draw_rate) >> 2, draw_y = static_cast<uint32_t>(draw_rate) & 3;
+        const uint32_t image_x = static_cast<uint32_t>(image_rate) >> 2, image_y = static_cast<uint32_t>(image_rate) & 3;
+        uint32_t x = draw_x, y = draw_y;
+        switch (combiner) {
+            case ShadingRateCombiner::override: x = image_x; y = image_y; break;
+            case ShadingRateCombiner::min: x = std::min(draw_x, image_x); y = std::min(draw_y, image_y); break;
+            case ShadingRateCombiner::max: x = std::max(draw_x, image_x); y = std::max(draw_y, image_y); break;
+            case ShadingRateCombiner::sum: x = draw_x + image_x; y = draw_y + image_y; break;
+            default: break;
+        }
+        x = std::min(x, 2u);
+        y = std::min(y, 2u);
+
+        // 4x1 and 1x4 aren't valid rates, so the other axis goes up to 2
+        if (x == 2 && y == 0) {
+            y = 1;
+        }
+        if (y == 2 && x == 0) {
+            x = 1;
+        }
+        return static_cast<ShadingRate>((x << 2) | y);
+    }
+
+    // Returns the separate sample colors of a pixel, which gives the pixel separate sample colors if it didn't have them yet
+    uint32_t* expand_pixel(SoftwareRenderTarget& target, const uint32_t block_index, const uint32_t pixel) {
+        std::unique_ptr<SampleColorBlock>& block = target.sample_colors[block_index];
+        if (!block) {
+            block = std::make_unique<SampleColorBlock>();
+        }
+        const uint64_t pixel_bit = uint64_t(1) << pixel;
+        if ((block->slotted_pixels & pixel_bit) == 0) {
+            block->slots[pixel] = static_cast<uint8_t>(block->colors.size() / target.sample_count);
+            block->colors.resize(block->colors.size() + target.sample_count);
+            block->slotted_pixels |= pixel_bit;
+        }
+        uint32_t* samples = block->colors.data() + static_cast<size_t>(block->slots[pixel]) * target.sample_count;
+        if ((target.expanded_pixels[block_index] & pixel_bit) == 0) {
+            std::fill_n(samples, target.sample_count, target.color[static_cast<size_t>(block_index) * raster_block_pixels + pixel]);
+            target.expanded_pixels[block_index] |= pixel_bit;
+        }
+        return samples;
+    }
+
+    bool same_semantic(const char* a, const char* b) {
+        for (; *a && *b; ++a, ++b) {
+            if (tolower(static_cast<unsigned char>(*a)) != tolower(static_cast<unsigned char>(*b))) {
+                return false;
+            }
+        }
+        return *a == *b;
+    }
+
+    bool depth_test_passes(const DepthFunc func, const float depth, const float stored) {
+        switch (func) {
+            case DepthFunc::never: return false;
+            case DepthFunc::less: return depth < stored;
+            case DepthFunc::equal: return depth == stored;
+            case DepthFunc::less_equal: return depth <= stored;
+            case DepthFunc::greater: return depth > stored;
+            case DepthFunc::not_equal: return depth != stored;
+            case DepthFunc::greater_equal: return depth >= stored;
+            case DepthFunc::always: return true;
+        }
+        return true;
+    }
+
+    // True if no depth in [min, max] can pass against any depth stored in the block
+    bool block_fully_hidden(const DepthFunc func, const float min_depth, const float max_depth, const DepthBlockRange& block) {
+        switch (func) {
+            case DepthFunc::never: return true;
+            case DepthFunc::less: return min_depth >= block.max_depth;
+            case DepthFunc::equal: return max_depth < block.min_depth || min_depth > block.max_depth;
+            case DepthFunc::less_equal: return min_depth > block.max_depth;
+            case DepthFunc::greater: return max_depth <= block.min_depth;
+            case DepthFunc::greater_equal: return max_depth < block.min_depth;
+            default: return false;
+        }
+    }
+
+    // True if every depth in [min, max] passes against every depth stored in the block
+    bool block_fully_visible(const DepthFunc func, const float min_depth, const float max_depth, const DepthBlockRange& block) {
+        switch (func) {
+            case DepthFunc::always: return true;
+            case DepthFunc::less: return max_depth < block.min_depth;
+            case DepthFunc::less_equal: return max_depth <= block.min_depth;
+            case DepthFunc::greater: return min_depth > block.max_depth;
+            case DepthFunc::greater_equal: return min_depth >= block.max_depth;
+            default: return false;
+        }
+    }
+
+    // Writes one band of 8 block rows at a time, so the destination is written front to back. With MSAA, this copies
+    // the first sample of every pixel.
+    template <typename T>
+    void resolve_blocks(const SoftwareRenderTarget& target, const std::vector<T>& source, const uint32_t samples_per_pixel, const uint8_t cleared_bit,
+                        const T clear_value, T* destination, const size_t row_pitch) {
+        parallel_for(target.blocks_y, 4, [&](const size_t begin, const size_t end) {
+            for (size_t block_y = begin; block_y < end; ++block_y) {
+                const uint32_t y0 = static_cast<uint32_t>(block_y) * raster_block_size;
+                const uint32_t row_count = std::min(raster_block_size, target.height - y0);
+                for (uint32_t block_x = 0; block_x < target.blocks_x; ++block_x) {
+                    const size_t block_index = block_y * target.blocks_x + block_x;
+                    const uint32_t x0 = block_x * raster_block_size;
+                    const uint32_t column_count = std::min(raster_block_size, target.width - x0);
+                    const T* block = source.data() + block_index * raster_block_pixels * samples_per_pixel;
+                    const bool cleared = (target.cleared_blocks[block_index] & cleared_bit) != 0;
+                    for (uint32_t row = 0; row < row_count; ++row) {
+                        T* output = destination + (y0 + row) * row_pitch + x0;
+                        if (cleared) {
+                            std::fill_n(output, column_count, clear_value);
+                        }
+                        else if (column_count == raster_block_size) {
+                            // A constant size, so this becomes a single vector load and store
+                            memcpy(output, block + row * raster_block_size * samples_per_pixel, raster_block_size * sizeof(T));
+                        }
+                        else {
+                            memcpy(output, block + row * raster_block_size * samples_per_pixel, column_count * sizeof(T));
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+/* TRIANGLE SETUP
+* The three edge functions E(x, y) = a * x + b * y + c are positive on the inside of each edge. They're
+* evaluated with 64-bit integers on the snapped vertex positions, so neighbouring triangles that share an
+* edge never both cover (or both miss) a pixel on that edge. Which one gets it is decided by the top-left
+* rule, like on the GPU. Edge i is the edge opposite vertex i, so E_i divided by the area is the barycentric
+* weight of vertex i.
+*/
+struct SoftwareRasterizer::TriangleSetup {
+    int64_t a[3], b[3], c[3];
+    float inv_area;
+    int32_t min_x, min_y, max_x, max_y; // Pixels to consider, inclusive
+    float z[3];                         // Depth after the viewport transform
+    float inv_w[3];
+    float min_z, max_z;
+    const float* vertices[3];
+    uint32_t sequence;                  // Index of the triangle in the draw
+};
+
+/* WORKER
+* Everything a thread writes to while drawing. Every thread has its own, so nothing needs to be locked.
+* The triangle setups and clipped vertices stay around until the draw is done, since the bins point at them.
+*/
+struct SoftwareRasterizer::Worker {
+    ShaderContext vertex_context;
+    ShaderContext pixel_context;
+    RasterStats stats;
+    std::vector<TriangleSetup> setups;
+    std::vector<std::vector<float>> clip_blocks;
+    size_t clip_blocks_used = 0;
+    uint32_t clip_block_polygons = 0;
+    std::vector<std::vector<float>> vertex_blocks;
+    size_t vertex_blocks_used = 0;
+    uint32_t vertex_block_vertices = 0;
+
+    // The vertex cache of the current index batch: vertex index -> position in batch_vertices
+    uint32_t cache_keys[vertex_cache_size];
+    uint16_t cache_slots[vertex_cache_size];
+    uint32_t batch_vertices[vertex_batch_triangles * 3];   // Unique vertices, in the order they were first used
+    uint16_t batch_indices[vertex_batch_triangles * 3];    // The batch's indices, pointing into batch_vertices
+    std::vector<float> clip_scratch;
+    std::vector<BinReference> tile_triangles;
+};
+
+SoftwareRasterizer::SoftwareRasterizer() = default;
+SoftwareRasterizer::~SoftwareRasterizer() = default;
+
+void SoftwareRenderTarget::resize(const uint32_t new_width, const uint32_t new_height, const uint32_t new_sample_count, const RenderTargetFormat new_format) {
+    width = new_width;
+    height = new_height;
+    sample_count = new_sample_count;
+    if (sample_count != 1 && sample_count != 2 && sample_count != 4 && sample_count != 8) {
+        printf("[ERROR] Software render target can't have %u samples, using 1\n", sample_count);
+        sample_count = 1;
+    }
+    format = new_format;
+    if (render_target_format_pixel_size(format) != sizeof(uint32_t)) {
+        printf("[ERROR] Software render target can only use formats with 32 bits per pixel, using R8G8B8A8_UNORM\n");
+        format = RenderTargetFormat::r8g8b8a8_unorm;
+    }
+    blocks_x = (width + raster_block_size - 1) / raster_block_size;
+    blocks_y = (height + raster_block_size - 1) / raster_block_size;
+    // The edge blocks are padded to a full block, the padding is never drawn to
+    const size_t block_count = static_cast<size_t>(blocks_x) * blocks_y;
+    color.assign(block_count * raster_block_pixels, 0);
+    depth.assign(block_count * raster_block_pixels * sample_count, 0.0f);
+    depth_blocks.assign(block_count, DepthBlockRange{});
+    cleared_blocks.assign(block_count, 0);
+    expanded_pixels.assign(block_count, 0);
+    sample_colors.clear();
+    sample_colors.resize(block_count);
+}
+
+void SoftwareRenderTarget::clear_color(const float rgba[4]) {
+    clear_color_value = static_cast<uint32_t>(pack_pixel(format, rgba));
+    for (uint8_t& flags : cleared_blocks) {
+        flags |= cleared_color_bit;
+    }
+}
+
+void SoftwareRenderTarget::clear_depth(const float value) {
+    clear_depth_value = value;
+    for (uint8_t& flags : cleared_blocks) {
+        flags |= cleared_depth_bit;
+    }
+    std::fill(depth_blocks.begin(), depth_blocks.end(), DepthBlockRange{ value, value });
+}
+
+void SoftwareRenderTarget::prepare_block(const uint32_t block_index) {
+    uint8_t& flags = cleared_blocks[block_index];
+    if (flags & cleared_color_bit) {
+        std::fill_n(color.data() + static_cast<size_t>(block_index) * raster_block_pixels, raster_block_pixels, clear_color_value);
+        expanded_pixels[block_index] = 0;
+        if (sample_colors[block_index]) {
+            sample_colors[block_index]->slotted_pixels = 0;
+            sample_colors[block_index]->colors.clear();
+        }
+    }
+    if (flags & cleared_depth_bit) {
+        const size_t block_floats = static_cast<size_t>(raster_block_pixels) * sample_count;
+        std::fill_n(depth.data() + block_index * block_floats, block_floats, clear_depth_value);
+    }
+    flags = 0;
+}
+
+void SoftwareRenderTarget::resolve_color(uint32_t* destination, const size_t row_pitch) const {
+    resolve_blocks(*this, color, 1, cleared_color_bit, clear_color_value, destination, row_pitch);
+    if (sample_count == 1) {
+        return;
+    }
+
+    // Then average the samples of the expanded pixels
+    const uint32_t sample_shift = sample_count == 8 ? 3 : sample_count == 4 ? 2 : 1;
+    parallel_for(blocks_y, 4, [&](const size_t begin, const size_t end) {
+        for (size_t block_y = begin; block_y < end; ++block_y) {
+            const uint32_t y0 = static_cast<uint32_t>(block_y) * raster_block_size;
+            for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+                const size_t block_index = block_y * blocks_x + block_x;
+                if (expanded_pixels[block_index] == 0 || (cleared_blocks[block_index] & cleared_color_bit)) {
+                    continue;
+                }
+                const uint32_t x0 = block_x * raster_block_size;
+                const SampleColorBlock& block = *sample_colors[block_index];
+                for (uint64_t pixels = expanded_pixels[block_index]; pixels != 0; pixels &= pixels - 1) {
+                    uint32_t pixel = 0;
+                    while ((pixels & (uint64_t(1) << pixel)) == 0) {
+                        ++pixel;
+                    }
+                    const uint32_t x = x0 + pixel % raster_block_size;
+                    const uint32_t y = y0 + pixel / raster_block_size;
+                    if (x >= width || y >= height) {
+                        continue;
+                    }
+                    const uint32_t* samples = block.colors.data() + static_cast<size_t>(block.slots[pixel]) * sample_count;
+                    if (format != RenderTargetFormat::r8g8b8a8_unorm) {
+                        // Other formats are averaged as floats, which for sRGB means in linear space like the GPU does
+                        float sums[4] = {};
+                        for (uint32_t sample = 0; sample < sample_count; ++sample) {
+                            float rgba[4];
+                            unpack_pixel(format, samples[sample], rgba);
+                            for (uint32_t channel = 0; channel < 4; ++channel) {
+                                sums[channel] += rgba[channel];
+                            }
+                        }
+                        for (float& sum : sums) {
+                            sum /= static_cast<float>(sample_count);
+                        }
+                        destination[y * row_pitch + x] = static_cast<uint32_t>(pack_pixel(format, sums));
+                        continue;
+                    }
+                    uint32_t sums[4] = {};
+                    for (uint32_t sample = 0; sample < sample_count; ++sample) {
+                        for (uint32_t channel = 0; channel < 4; ++channel) {
+                            sums[channel] += (samples[sample] >> (channel * 8)) & 0xFF;
+                        }
+                    }
+                    uint32_t average = 0;
+                    for (uint32_t channel = 0; channel < 4; ++channel) {
+                        average |= ((sums[channel] + (sample_count >> 1)) >> sample_shift) << (channel * 8);
+                    }
+                    destination[y * row_pitch + x] = average;
+                }
+            }
+        }
+    });
+}
+
+void SoftwareRenderTarget::resolve_depth(float* destination, const size_t row_pitch) const {
+    resolve_blocks(*this, depth, sample_count, cleared_depth_bit, clear_depth_value, destination, row_pitch);
+}
+
+size_t SoftwareRenderTarget::memory_size() const {
+    size_t size = color.size() * sizeof(color[0]) + depth.size() * sizeof(depth[0]) + depth_blocks.size() * sizeof(depth_blocks[0])
+                + cleared_blocks.size() + expanded_pixels.size() * sizeof(expanded_pixels[0]) + sample_colors.size() * sizeof(sample_colors[0]);
+    for (const auto& block : sample_colors) {
+        if (block) {
+            size += sizeof(SampleColorBlock) + block->colors.capacity() * sizeof(uint32_t);
+        }
+    }
+    return size;
+}
+
+void SoftwareRasterizer::set_pipeline_state(const SoftwarePipelineState* new_pipeline_state) {
+    pipeline_state = new_pipeline_state;
+}
+
+void SoftwareRasterizer::set_vertex_buffer(const void* data, const size_t size_bytes) {
+    vertex_data = static_cast<const uint8_t*>(data);
+    vertex_data_size = size_bytes;
+}
+
+void SoftwareRasterizer::set_index_buffer(const uint32_t* indices, const size_t new_index_count) {
+    index_data = indices;
+    index_count = new_index_count;
+}
+
+void SoftwareRasterizer::set_constant_buffer(const uint32_t slot, const void* data, const size_t size_bytes) {
+    if (slot >= shader_max_constant_buffers) {
+        printf("[ERROR] Constant buffer slot %u is out of range\n", slot);
+        return;
+    }
+    constant_buffers[slot] = static_cast<const float*>(data);
+    constant_buffer_sizes[slot] = static_cast<uint32_t>(size_bytes / 16);
+}
+
+void SoftwareRasterizer::set_structured_buffer(const uint32_t slot, const void* data, const uint32_t stride, const uint32_t element_count) {
+    if (slot >= shader_max_structured_buffers) {
+        printf("[ERROR] Structured buffer slot %u is out of range\n", slot);
+        return;
+    }
+    structured_buffers[slot].data = static_cast<const uint8_t*>(data);
+    structured_buffers[slot].stride = stride;
+    structured_buffers[slot].element_count = element_count;
+}
+
+void SoftwareRasterizer::set_cluster_lights(const ClusterLightLists& lists, const ClusterLight* lights, const uint32_t light_count) {
+    set_structured_buffer(0, lists.ranges.data(), sizeof(ClusterRange), static_cast<uint32_t>(lists.ranges.size()));
+    set_structured_buffer(1, lists.light_indices.data(), sizeof(uint32_t), static_cast<uint32_t>(lists.light_indices.size()));
+    set_structured_buffer(2, lights, sizeof(ClusterLight), light_count);
+}
+
+void SoftwareRasterizer::set_viewport(const SoftwareViewport& new_viewport) {
+    viewport = new_viewport;
+}
+
+void SoftwareRasterizer::set_scissor_rect(const int32_t left, const int32_t top, const int32_t right, const int32_t bottom) {
+    scissor[0] = left;
+    scissor[1] = top;
+    scissor[2] = right;
+    scissor[3] = bottom;
+}
+
+void SoftwareRasterizer::set_render_target(SoftwareRenderTarget* new_render_target) {
+    render_target = new_render_target;
+}
+
+void SoftwareRasterizer::set_thread_count(const unsigned new_thread_count) {
+    thread_count = new_thread_count;
+}
+
+void SoftwareRasterizer::set_blend_factor(const float rgba[4]) {
+    for (uint32_t channel = 0; channel < 4; ++channel) {
+        blend_factor[channel] = rgba ? rgba[channel] : 1.0f;
+    }
+}
+
+void SoftwareRasterizer::set_shading_rate_image(const uint8_t* rates, const uint32_t width, const uint32_t height) {
+    shading_rate_image = rates;
+    shading_rate_image_width = rates ? width : 0;
+    shading_rate_image_height = rates ? height : 0;
+}
+
+bool SoftwareRasterizer::link_shaders() {
+    const ShaderProgram& vs = *pipeline_state->vertex_shader;
+    const ShaderProgram& ps = *pipeline_state->pixel_shader;
+    if (vs.stage != ShaderStage::vertex || ps.stage != ShaderStage::pixel) {
+        printf("[ERROR] Software pipeline state needs a vertex shader and a pixel shader\n");
+        return false;
+    }
+
+    // Vertex shader inputs come from the input layout
+    vertex_input_sources.assign(vs.input_count, -1);
+    vertex_id_register = -1;
+    for (const auto& element : vs.inputs) {
+        if (element.system_value == 6) { // SV_VertexID
+            vertex_id_register = static_cast<int>(element.register_index);
+            continue;
+        }
+        int source = -1;
+        for (size_t i = 0; i < pipeline_state->input_layout.size(); ++i) {
+            const SoftwareInputElement& layout = pipeline_state->input_layout[i];
+            if (same_semantic(layout.semantic_name, element.semantic_name.c_str()) && layout.semantic_index == element.semantic_index) {
+                source = static_cast<int>(i);
+            }
+        }
+        if (source < 0) {
+            printf("[ERROR] Input layout has no element for vertex shader input %s%u\n", element.semantic_name.c_str(), element.semantic_index);
+            return false;
+        }
+        vertex_input_sources[element.register_index] = source;
+    }
+
+    position_register = find_shader_system_value_register(vs.outputs, 1);
+    if (position_register < 0) {
+        printf("[ERROR] Vertex shader doesn't output SV_Position\n");
+        return false;
+    }
+
+    // Pixel shader inputs come from the vertex shader outputs with the same semantic
+    varying_links.clear();
+    pixel_position_register = -1;
+    for (const auto& element : ps.inputs) {
+        if (element.system_value == 1) {
+            pixel_position_register = static_cast<int>(element.register_index);
+            continue;
+        }
+        const int source = find_shader_register(vs.outputs, element.semantic_name.c_str(), element.semantic_index);
+        if (source < 0) {
+            printf("[ERROR] Vertex shader doesn't output pixel shader input %s%u\n", element.semantic_name.c_str(), element.semantic_index);
+            return false;
+        }
+        varying_links.push_back(VaryingLink{ element.register_index, static_cast<uint32_t>(source), element.mask });
+    }
+    color_register = find_shader_system_value_register(ps.outputs, 64);
+
+    shaded_vertex_stride = vs.output_count * 4;
+
+    // Reset the per-thread state
+    const unsigned worker_count = parallel_thread_count(thread_count);
+    while (workers.size() < worker_count) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    bin_arenas.resize(worker_count);
+    for (unsigned i = 0; i < worker_count; ++i) {
+        Worker& worker = *workers[i];
+        worker.vertex_context.prepare(vs);
+        worker.pixel_context.prepare(ps);
+        for (uint32_t slot = 0; slot < shader_max_constant_buffers; ++slot) {
+            worker.vertex_context.constant_buffers[slot] = worker.pixel_context.constant_buffers[slot] = constant_buffers[slot];
+            worker.vertex_context.constant_buffer_sizes[slot] = worker.pixel_context.constant_buffer_sizes[slot] = constant_buffer_sizes[slot];
+        }
+        for (uint32_t slot = 0; slot < shader_max_structured_buffers; ++slot) {
+            worker.vertex_context.structured_buffers[slot] = worker.pixel_context.structured_buffers[slot] = structured_buffers[slot];
+        }
+        worker.stats.reset();
+        worker.setups.clear();
+        worker.clip_blocks_used = 0;
+        worker.vertex_blocks_used = 0;
+        worker.clip_scratch.resize(static_cast<size_t>(max_clipped_polygon_vertices) * shaded_vertex_stride);
+        bin_arenas[i].reset(tiles_x * tiles_y);
+    }
+    return true;
+}
+
+void SoftwareRasterizer::shade_vertices(Worker& worker, const uint32_t* vertices, const uint32_t vertex_count, float* destination) {
+    const ShaderProgram& vs = *pipeline_state->vertex_shader;
+    const uint32_t stride = pipeline_state->vertex_stride;
+    ShaderContext& vertex_context = worker.vertex_context;
+
+    for (uint32_t batch_start = 0; batch_start < vertex_count; batch_start += shader_lane_count) {
+        const uint32_t lane_count = std::min(shader_lane_count, vertex_count - batch_start);
+
+        // Gather the vertex attributes, missing components default to (0, 0, 0, 1) like on the GPU
+        for (uint32_t reg = 0; reg < vs.input_count; ++reg) {
+            const int source = vertex_input_sources[reg];
+            if (source < 0) {
+                continue;
+            }
+            const SoftwareInputElement& element = pipeline_state->input_layout[source];
+            ShaderRegister& input = vertex_context.inputs[reg];
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                if (lane < lane_count) {
+                    const size_t offset = static_cast<size_t>(vertices[batch_start + lane]) * stride + element.offset;
+                    if (offset + element.component_count * sizeof(float) <= vertex_data_size) {
+                        memcpy(value, vertex_data + offset, element.component_count * sizeof(float));
+                    }
+                }
+                for (uint32_t c = 0; c < 4; ++c) {
+                    input.lanes[c][lane] = value[c];
+                }
+            }
+        }
+        if (vertex_id_register >= 0) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                const uint32_t vertex_id = lane < lane_count ? vertices[batch_start + lane] : 0;
+                memcpy(&vertex_context.inputs[vertex_id_register].lanes[0][lane], &vertex_id, sizeof(vertex_id));
+            }
+        }
+
+        execute_shader(vs, vertex_context);
+        worker.stats.vertex_shader_invocations += lane_count;
+
+        // Transpose the outputs back to one record per vertex
+        for (uint32_t lane = 0; lane < lane_count; ++lane) {
+            float* record = destination + static_cast<size_t>(batch_start + lane) * shaded_vertex_stride;
+            for (uint32_t reg = 0; reg < vs.output_count; ++reg) {
+                for (uint32_t c = 0; c < 4; ++c) {
+                    record[reg * 4 + c] = vertex_context.outputs[reg].lanes[c][lane];
+                }
+            }
+        }
+    }
+}
+
+/* VERTEX BATCHES
+* Running the vertex shader once per index would shade most vertices of a mesh about 6 times, since that's how many
+* triangles share a vertex in a regular mesh. When the indices use most of the vertices in their range, like when a
+* whole mesh is drawn, every vertex in the range is shaded once before the triangles are set up. Otherwise, like for
+* a small part of a big vertex buffer, that would shade lots of vertices nobody uses.
+*
+* So in that case the indices are processed in batches of 128 triangles instead. A small hash table finds the unique
+* vertices in the batch, those get shaded once, and the batch's triangles point at the shaded copies. A vertex that's
+* shared between batches gets shaded again in every batch, which is the same trade-off the post-transform vertex
+* cache on a GPU makes.
+*/
+void SoftwareRasterizer::process_index_batch(Worker& worker, const uint32_t worker_index, const uint32_t* indices, const int32_t base_vertex,
+                                             const uint32_t first_triangle, const uint32_t triangle_count) {
+    const uint32_t batch_index_count = triangle_count * 3;
+    const float* vertices[vertex_batch_triangles * 3];
+    if (!shaded_vertices.empty()) {
+        for (uint32_t i = 0; i < batch_index_count; ++i) {
+            const uint32_t vertex = indices[i] + static_cast<uint32_t>(base_vertex) - shaded_first_vertex;
+            vertices[i] = shaded_vertices.data() + static_cast<size_t>(vertex) * shaded_vertex_stride;
+        }
+        bin_index_batch(worker, worker_index, vertices, first_triangle, triangle_count);
+        return;
+    }
+
+    std::fill(std::begin(worker.cache_keys), std::end(worker.cache_keys), vertex_cache_empty);
+    uint32_t unique_count = 0;
+    for (uint32_t group_start = 0; group_start < batch_index_count; group_start += shader_lane_count) {
+        const uint32_t lane_count = std::min(shader_lane_count, batch_index_count - group_start);
+
+        // Hash 8 indices at once, this loop gets vectorized. Vertex indices wrap around like on the GPU.
+        uint32_t group_indices[shader_lane_count];
+        uint32_t slots[shader_lane_count];
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            group_indices[lane] = indices[group_start + std::min(lane, lane_count - 1)] + static_cast<uint32_t>(base_vertex);
+            slots[lane] = (group_indices[lane] * 0x9e3779b1u) >> (32 - vertex_cache_size_log2);
+        }
+
+        // Then look them up one by one, with linear probing. The vertex 0xffffffff looks like an empty entry, so it
+        // never gets found, and is shaded again every time. It's outside any vertex buffer anyway.
+        for (uint32_t lane = 0; lane < lane_count; ++lane) {
+            uint32_t slot = slots[lane];
+            while (worker.cache_keys[slot] != group_indices[lane] && worker.cache_keys[slot] != vertex_cache_empty) {
+                slot = (slot + 1) & (vertex_cache_size - 1);
+            }
+            if (worker.cache_keys[slot] != group_indices[lane] || group_indices[lane] == vertex_cache_empty) {
+                worker.cache_keys[slot] = group_indices[lane];
+                worker.cache_slots[slot] = static_cast<uint16_t>(unique_count);
+                worker.batch_vertices[unique_count++] = group_indices[lane];
+            }
+            worker.batch_indices[group_start + lane] = worker.cache_slots[slot];
+        }
+    }
+
+    float* shaded = allocate_shaded_vertices(worker, unique_count);
+    shade_vertices(worker, worker.batch_vertices, unique_count, shaded);
+    for (uint32_t i = 0; i < batch_index_count; ++i) {
+        vertices[i] = shaded + static_cast<size_t>(worker.batch_indices[i]) * shaded_vertex_stride;
+    }
+    bin_index_batch(worker, worker_index, vertices, first_triangle, triangle_count);
+}
+
+// Sets up the triangles in batches of 8, and sorts them into the tiles they touch
+void SoftwareRasterizer::bin_index_batch(Worker& worker, const uint32_t worker_index, const float* const vertices[], const uint32_t first_triangle,
+                                         const uint32_t triangle_count) {
+    const float* batch[shader_lane_count][3];
+    uint32_t sequences[shader_lane_count];
+    uint32_t batch_size = 0;
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        for (uint32_t v = 0; v < 3; ++v) {
+            batch[batch_size][v] = vertices[triangle * 3 + v];
+        }
+        sequences[batch_size] = first_triangle + triangle;
+        if (++batch_size == shader_lane_count) {
+            bin_triangle_batch(worker, worker_index, batch, sequences, batch_size);
+            batch_size = 0;
+        }
+    }
+    if (batch_size > 0) {
+        bin_triangle_batch(worker, worker_index, batch, sequences, batch_size);
+    }
+}
+
+// Shaded vertices are allocated from blocks that stay valid until the end of the draw, since the bins point at them
+float* SoftwareRasterizer::allocate_shaded_vertices(Worker& worker, const uint32_t count) {
+    if (worker.vertex_blocks_used == 0 || worker.vertex_block_vertices + count > shaded_vertices_per_block) {
+        if (worker.vertex_blocks_used == worker.vertex_blocks.size()) {
+            worker.vertex_blocks.emplace_back();
+        }
+        worker.vertex_blocks[worker.vertex_blocks_used++].resize(static_cast<size_t>(shaded_vertices_per_block) * shaded_vertex_stride);
+        worker.vertex_block_vertices = 0;
+    }
+    float* vertices = worker.vertex_blocks[worker.vertex_blocks_used - 1].data() + static_cast<size_t>(worker.vertex_block_vertices) * shaded_vertex_stride;
+    worker.vertex_block_vertices += count;
+    return vertices;
+}
+
+void SoftwareRasterizer::draw_indexed(const uint32_t draw_index_count, const uint32_t start_index, const int32_t base_vertex) {
+    if (!pipeline_state || !pipeline_state->vertex_shader || !pipeline_state->pixel_shader || !render_target || !index_data) {
+        printf("[ERROR] Software draw is missing a pipeline state, render target or index buffer\n");
+        return;
+    }
+    if (static_cast<size_t>(start_index) + draw_index_count > index_count) {
+        printf("[ERROR] Software draw reads past the end of the index buffer\n");
+        return;
+    }
+    if (pipeline_state->sample_count != render_target->sample_count) {
+        printf("[ERROR] Software draw has a pipeline state with %u samples, but the render target has %u\n", pipeline_state->sample_count, render_target->sample_count);
+        return;
+    }
+    if (pipeline_state->render_target_format != render_target->format) {
+        printf("[ERROR] Software draw has a pipeline state with a different render target format than the render target\n");
+        return;
+    }
+    blend_function = select_blend_function(pipeline_state->blend, render_target->format);
+    if (!blend_function) {
+        printf("[ERROR] Software pipeline state has an invalid blend state\n");
+        return;
+    }
+    blend_reads_pixels = blend_reads_destination(pipeline_state->blend, render_target->format);
+    tiles_x = (render_target->width + raster_tile_size - 1) / raster_tile_size;
+    tiles_y = (render_target->height + raster_tile_size - 1) / raster_tile_size;
+    if (!link_shaders()) {
+        return;
+    }
+
+    // Vertex indices wrap around like on the GPU
+    const uint32_t* indices = index_data + start_index;
+    const uint32_t triangle_count = draw_index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+    uint32_t min_vertex = UINT32_MAX;
+    uint32_t max_vertex = 0;
+    for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+        const uint32_t vertex = indices[i] + static_cast<uint32_t>(base_vertex);
+        min_vertex = std::min(min_vertex, vertex);
+        max_vertex = std::max(max_vertex, vertex);
+    }
+
+    // Shade the whole range up front if the indices use most of it, see VERTEX BATCHES
+    const uint32_t range_size = max_vertex - min_vertex + 1;
+    shaded_vertices.clear();
+    shaded_first_vertex = min_vertex;
+    if (range_size != 0 && range_size <= triangle_count) {
+        shaded_vertices.resize(static_cast<size_t>(range_size) * shaded_vertex_stride);
+        parallel_for_with_worker(range_size, vertex_chunk_size, [&](const size_t begin, const size_t end, const unsigned worker_index) {
+            uint32_t vertices[vertex_chunk_size];
+            for (size_t i = begin; i < end; ++i) {
+                vertices[i - begin] = min_vertex + static_cast<uint32_t>(i);
+            }
+            shade_vertices(*workers[worker_index], vertices, static_cast<uint32_t>(end - begin), shaded_vertices.data() + begin * shaded_vertex_stride);
+        }, thread_count);
+    }
+
+    // Then set up the triangles, one index batch at a time
+    parallel_for_with_worker(triangle_count, triangle_chunk_size, [&](const size_t begin, const size_t end, const unsigned worker_index) {
+        for (size_t batch_start = begin; batch_start < end; batch_start += vertex_batch_triangles) {
+            const uint32_t batch_triangles = static_cast<uint32_t>(std::min<size_t>(vertex_batch_triangles, end - batch_start));
+            process_index_batch(*workers[worker_index], worker_index, indices + batch_start * 3, base_vertex, static_cast<uint32_t>(batch_start), batch_triangles);
+        }
+    }, thread_count);
+
+    /* TILE WORK STEALING
+    * Every thread starts out with its own contiguous range of tiles, so it mostly touches its own part of the
+    * render target. Tiles are taken from a range with an atomic counter. A thread that runs out of tiles
+    * steals from the other ranges through the same counters, so one thread with expensive tiles doesn't
+    * keep all the others waiting. A tile is always rasterized by a single thread, in submission order,
+    * so the result is the same no matter which thread ends up doing it.
+    */
+    const uint32_t tile_count = tiles_x * tiles_y;
+    const uint32_t range_count = static_cast<uint32_t>(bin_arenas.size());
+    std::unique_ptr<std::atomic<uint32_t>[]> range_cursors(new std::atomic<uint32_t>[range_count]);
+    for (uint32_t i = 0; i < range_count; ++i) {
+        range_cursors[i] = i * tile_count / range_count;
+    }
+    const auto range_end = [&](const uint32_t range) { return (range + 1) * tile_count / range_count; };
+    parallel_for_with_worker(range_count, 1, [&](const size_t begin, const size_t end, const unsigned worker_index) {
+        Worker& worker = *workers[worker_index];
+        for (size_t own_range = begin; own_range < end; ++own_range) {
+            for (uint32_t i = 0; i < range_count; ++i) {
+                const uint32_t range = static_cast<uint32_t>((own_range + i) % range_count);
+                for (uint32_t tile = range_cursors[range]++; tile < range_end(range); tile = range_cursors[range]++) {
+                    worker.stats.tiles_stolen += i != 0;
+                    rasterize_tile(worker, tile);
+                }
+            }
+        }
+    }, thread_count);
+
+    for (uint32_t i = 0; i < range_count; ++i) {
+        stats.add(workers[i]->stats);
+    }
+}
+
+void SoftwareRasterizer::bin_triangle_batch(Worker& worker, const uint32_t worker_index, const float* const triangles[][3],
+                                            const uint32_t sequences[], const uint32_t triangle_count) {
+    TriangleSetup setups[shader_lane_count];
+    uint32_t clip_mask = 0;
+    worker.stats.triangles_in += triangle_count;
+    const uint32_t setup_count = setup_triangle_batch(worker, triangles, sequences, triangle_count, true, setups, clip_mask);
+    if (clip_mask == 0) {
+        for (uint32_t i = 0; i < setup_count; ++i) {
+            bin_triangle(worker, worker_index, setups[i]);
+        }
+        return;
+    }
+
+    // Clip the few triangles that need it. The pieces are set up in batches again, and can't need clipping themselves.
+    TriangleSetup clipped_setups[shader_lane_count * (max_clipped_polygon_vertices - 2)];
+    uint32_t clipped_setup_count = 0;
+    const float* clipped_batch[shader_lane_count][3];
+    uint32_t clipped_sequences[shader_lane_count];
+    uint32_t clipped_batch_size = 0;
+    const auto flush_clipped_batch = [&]() {
+        uint32_t unused_clip_mask = 0;
+        clipped_setup_count += setup_triangle_batch(worker, clipped_batch, clipped_sequences, clipped_batch_size, false,
+                                                    clipped_setups + clipped_setup_count, unused_clip_mask);
+        clipped_batch_size = 0;
+    };
+    for (uint32_t lane = 0; lane < triangle_count; ++lane) {
+        if ((clip_mask & (1u << lane)) == 0) {
+            continue;
+        }
+        worker.stats.triangles_clipped++;
+        float* polygon = allocate_clipped_polygon(worker);
+        const uint32_t vertex_count = clip_triangle(worker, triangles[lane], polygon);
+
+        // Triangle fan, which keeps the winding order of the original triangle
+        for (uint32_t v = 2; v < vertex_count; ++v) {
+            clipped_batch[clipped_batch_size][0] = polygon;
+            clipped_batch[clipped_batch_size][1] = polygon + static_cast<size_t>(v - 1) * shaded_vertex_stride;
+            clipped_batch[clipped_batch_size][2] = polygon + static_cast<size_t>(v) * shaded_vertex_stride;
+            clipped_sequences[clipped_batch_size] = sequences[lane];
+            if (++clipped_batch_size == shader_lane_count) {
+                flush_clipped_batch();
+            }
+        }
+    }
+    if (clipped_batch_size > 0) {
+        flush_clipped_batch();
+    }
+
+    // Bin the pieces where the triangle they came from was, so the tile lists stay in submission order. Both lists are
+    // sorted by sequence number, and a triangle is either in one or the other.
+    uint32_t clipped_index = 0;
+    for (uint32_t i = 0; i < setup_count; ++i) {
+        while (clipped_index < clipped_setup_count && clipped_setups[clipped_index].sequence < setups[i].sequence) {
+            bin_triangle(worker, worker_index, clipped_setups[clipped_index++]);
+        }
+        bin_triangle(worker, worker_index, setups[i]);
+    }
+    while (clipped_index < clipped_setup_count) {
+        bin_triangle(worker, worker_index, clipped_setups[clipped_index++]);
+    }
+}
+
+// Clipped vertices are allocated from blocks that stay valid until the end of the draw, since the bins point at them
+float* SoftwareRasterizer::allocate_clipped_polygon(Worker& worker) {
+    const size_t polygon_floats = static_cast<size_t>(max_clipped_polygon_vertices) * shaded_vertex_stride;
+    if (worker.clip_block_polygons == clipped_polygons_per_block || worker.clip_blocks_used == 0) {
+        if (worker.clip_blocks_used == worker.clip_blocks.size()) {
+            worker.clip_blocks.emplace_back();
+        }
+        // Growing the outer vector moves the blocks, but their memory stays where it is
+        worker.clip_blocks[worker.clip_blocks_used++].resize(polygon_floats * clipped_polygons_per_block);
+        worker.clip_block_polygons = 0;
+    }
+    return worker.clip_blocks[worker.clip_blocks_used - 1].data() + polygon_floats * worker.clip_block_polygons++;
+}
+
+void SoftwareRasterizer::bin_triangle(Worker& worker, const uint32_t worker_index, const TriangleSetup& setup) {
+    const uint32_t setup_index = static_cast<uint32_t>(worker.setups.size());
+    worker.setups.push_back(setup);
+
+    TileBinArena& arena = bin_arenas[worker_index];
+    const uint32_t first_tile_x = setup.min_x / raster_tile_size;
+    const uint32_t last_tile_x = setup.max_x / raster_tile_size;
+    const uint32_t first_tile_y = setup.min_y / raster_tile_size;
+    const uint32_t last_tile_y = setup.max_y / raster_tile_size;
+    for (uint32_t tile_y = first_tile_y; tile_y <= last_tile_y; ++tile_y) {
+        for (uint32_t tile_x = first_tile_x; tile_x <= last_tile_x; ++tile_x) {
+            arena.append(tile_y * tiles_x + tile_x, BinEntry{ setup.sequence, setup_index });
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterize_tile(Worker& worker, const uint32_t tile) {
+    merge_tile_bins(bin_arenas, tile, worker.tile_triangles);
+    if (worker.tile_triangles.empty()) {
+        return;
+    }
+    worker.stats.tiles_rasterized++;
+
+    const int32_t tile_min_x = static_cast<int32_t>((tile % tiles_x) * raster_tile_size);
+    const int32_t tile_min_y = static_cast<int32_t>((tile / tiles_x) * raster_tile_size);
+    for (const BinReference& reference : worker.tile_triangles) {
+        TriangleSetup setup = workers[reference.arena]->setups[reference.payload];
+        setup.min_x = std::max(setup.min_x, tile_min_x);
+        setup.min_y = std::max(setup.min_y, tile_min_y);
+        setup.max_x = std::min(setup.max_x, tile_min_x + static_cast<int32_t>(raster_tile_size) - 1);
+        setup.max_y = std::min(setup.max_y, tile_min_y + static_cast<int32_t>(raster_tile_size) - 1);
+        rasterize_triangle(worker, setup);
+    }
+}
+
+/* BATCHED TRIANGLE SETUP
+* Sets up 8 triangles at once. Every step is a loop over the 8 lanes, with the triangle data stored as
+* structure-of-arrays, so the compiler can turn the steps into SIMD instructions. Triangles that get culled
+* just get their lane switched off in a mask, instead of branching away.
+*
+* Triangles only need to be clipped if they cross the w = 0 plane (where the perspective divide breaks), or
+* if they reach beyond the guard band, where the fixed point edge functions would overflow. Everything else
+* is rasterized as-is: the pixels outside the viewport are skipped by the bounding box, and the pixels in
+* front of the near plane or behind the far plane are skipped by the per-pixel depth clipping.
+*/
+uint32_t SoftwareRasterizer::setup_triangle_batch(Worker& worker, const float* const triangles[][3], const uint32_t sequences[],
+                                                  const uint32_t triangle_count, const bool allow_clipping, TriangleSetup* setups, uint32_t& clip_mask) {
+    constexpr uint32_t lanes = shader_lane_count;
+    const uint32_t valid_mask = (1u << triangle_count) - 1;
+
+    // Gather the clip space positions
+    float clip_x[3][lanes], clip_y[3][lanes], clip_z[3][lanes], clip_w[3][lanes];
+    for (uint32_t v = 0; v < 3; ++v) {
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            // Unused lanes get a dummy triangle, so they don't need special cases
+            const float* position = (lane < triangle_count ? triangles[lane][v] : triangles[0][v]) + position_register * 4;
+            clip_x[v][lane] = position[0];
+            clip_y[v][lane] = position[1];
+            clip_z[v][lane] = position[2];
+            clip_w[v][lane] = position[3];
+        }
+    }
+
+    // Outcodes: a triangle that's entirely outside one of the frustum planes is culled, a triangle that's
+    // partially outside the w plane or the guard band gets clipped
+    const float guard_x = 1.0f + 2.0f * raster_guard_band_pixels / std::max(viewport.width, 1.0f);
+    const float guard_y = 1.0f + 2.0f * raster_guard_band_pixels / std::max(viewport.height, 1.0f);
+    uint32_t outside_mask = 0;
+    uint32_t needs_clip_mask = 0;
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        uint32_t all_outside = 0xFF;
+        uint32_t any_outside = 0;
+        for (uint32_t v = 0; v < 3; ++v) {
+            const float x = clip_x[v][lane];
+            const float y = clip_y[v][lane];
+            const float z = clip_z[v][lane];
+            const float w = clip_w[v][lane];
+            const uint32_t code = (x < -w) << 0 | (x > w) << 1 | (y < -w) << 2 | (y > w) << 3 | (z < 0.0f) << 4 | (z > w) << 5
+                                | (!(w >= raster_min_clip_w)) << 6 | (x < -guard_x * w || x > guard_x * w || y < -guard_y * w || y > guard_y * w) << 7;
+            all_outside &= code;
+            any_outside |= code;
+        }
+        outside_mask |= static_cast<uint32_t>((all_outside & 0x7F) != 0) << lane;
+        needs_clip_mask |= static_cast<uint32_t>((any_outside & 0xC0) != 0) << lane;
+    }
+    outside_mask &= valid_mask;
+    needs_clip_mask &= valid_mask & ~outside_mask;
+    if (!allow_clipping) {
+        // Pieces of clipped triangles can still be a hair outside because of rounding, the guard band has room for that
+        needs_clip_mask = 0;
+    }
+    clip_mask = needs_clip_mask;
+
+    // Project to screen space and snap to the subpixel grid. The clamp keeps the snapped positions in 28 bits.
+    float inv_w[3][lanes], screen_z[3][lanes];
+    float min_x[lanes], min_y[lanes], max_x[lanes], max_y[lanes];
+    int32_t fixed_x[3][lanes], fixed_y[3][lanes];
+    const float depth_scale = viewport.max_depth - viewport.min_depth;
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        min_x[lane] = min_y[lane] = FLT_MAX;
+        max_x[lane] = max_y[lane] = -FLT_MAX;
+    }
+    for (uint32_t v = 0; v < 3; ++v) {
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            // Lanes that are culled or clipped may have any w, keep them from producing infinities (or NaNs)
+            inv_w[v][lane] = 1.0f / std::max(raster_min_clip_w, clip_w[v][lane]);
+            const float screen_x = std::min(std::max(viewport.top_left_x + (clip_x[v][lane] * inv_w[v][lane] * 0.5f + 0.5f) * viewport.width, -max_screen_coordinate), max_screen_coordinate);
+            const float screen_y = std::min(std::max(viewport.top_left_y + (0.5f - clip_y[v][lane] * inv_w[v][lane] * 0.5f) * viewport.height, -max_screen_coordinate), max_screen_coordinate);
+            screen_z[v][lane] = viewport.min_depth + clip_z[v][lane] * inv_w[v][lane] * depth_scale;
+            fixed_x[v][lane] = static_cast<int32_t>(std::floor(screen_x * subpixel_scale + 0.5f));
+            fixed_y[v][lane] = static_cast<int32_t>(std::floor(screen_y * subpixel_scale + 0.5f));
+            min_x[lane] = std::min(min_x[lane], screen_x);
+            min_y[lane] = std::min(min_y[lane], screen_y);
+            max_x[lane] = std::max(max_x[lane], screen_x);
+            max_y[lane] = std::max(max_y[lane], screen_y);
+        }
+    }
+
+    // Zero area and backface culling. The area is positive for triangles that are clockwise on screen.
+    int64_t area[lanes];
+    uint32_t culled_mask = 0;
+    const bool cull_back = pipeline_state->cull_mode == CullMode::back;
+    const bool cull_front = pipeline_state->cull_mode == CullMode::front;
+    const bool front_counter_clockwise = pipeline_state->front_counter_clockwise;
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        area[lane] = static_cast<int64_t>(fixed_x[1][lane] - fixed_x[0][lane]) * (fixed_y[2][lane] - fixed_y[0][lane])
+                   - static_cast<int64_t>(fixed_y[1][lane] - fixed_y[0][lane]) * (fixed_x[2][lane] - fixed_x[0][lane]);
+    }
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        const bool front_facing = (area[lane] > 0) != front_counter_clockwise;
+        const bool culled = area[lane] == 0 || (cull_back && !front_facing) || (cull_front && front_facing);
+        culled_mask |= static_cast<uint32_t>(culled) << lane;
+    }
+
+    // Edge functions, flipped for counter-clockwise triangles so the inside is always positive.
+    // Edge i goes from vertex i + 1 to vertex i + 2.
+    int32_t edge_a[3][lanes], edge_b[3][lanes];
+    int64_t edge_c[3][lanes];
+    for (uint32_t i = 0; i < 3; ++i) {
+        const uint32_t j = (i + 1) % 3;
+        const uint32_t k = (i + 2) % 3;
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            const int32_t sign = area[lane] < 0 ? -1 : 1;
+            edge_a[i][lane] = (fixed_y[j][lane] - fixed_y[k][lane]) * sign;
+            edge_b[i][lane] = (fixed_x[k][lane] - fixed_x[j][lane]) * sign;
+            edge_c[i][lane] = (static_cast<int64_t>(fixed_x[j][lane]) * fixed_y[k][lane] - static_cast<int64_t>(fixed_x[k][lane]) * fixed_y[j][lane]) * sign;
+
+            // Top-left rule: pixels exactly on an edge only belong to the triangle if it's a top or a left edge
+            const bool top_edge = edge_a[i][lane] == 0 && edge_b[i][lane] > 0;
+            const bool left_edge = edge_a[i][lane] > 0;
+            edge_c[i][lane] -= static_cast<int64_t>(!top_edge && !left_edge);
+        }
+    }
+
+    // Bounding box, clipped to the viewport, the scissor rectangle and the render target
+    const float viewport_left = std::max(viewport.top_left_x, 0.0f);
+    const float viewport_top = std::max(viewport.top_left_y, 0.0f);
+    const float viewport_right = viewport.top_left_x + viewport.width;
+    const float viewport_bottom = viewport.top_left_y + viewport.height;
+    const int32_t box_left = std::max(scissor[0], 0);
+    const int32_t box_top = std::max(scissor[1], 0);
+    const int32_t box_right = std::min(scissor[2], static_cast<int32_t>(render_target->width)) - 1;
+    const int32_t box_bottom = std::min(scissor[3], static_cast<int32_t>(render_target->height)) - 1;
+    int32_t box_min_x[lanes], box_min_y[lanes], box_max_x[lanes], box_max_y[lanes];
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        box_min_x[lane] = std::max(static_cast<int32_t>(std::floor(std::max(min_x[lane], viewport_left))), box_left);
+        box_min_y[lane] = std::max(static_cast<int32_t>(std::floor(std::max(min_y[lane], viewport_top))), box_top);
+        box_max_x[lane] = std::min(static_cast<int32_t>(std::ceil(std::min(max_x[lane], viewport_right))) - 1, box_right);
+        box_max_y[lane] = std::min(static_cast<int32_t>(std::ceil(std::min(max_y[lane], viewport_bottom))) - 1, box_bottom);
+    }
+    uint32_t empty_mask = 0;
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        empty_mask |= static_cast<uint32_t>(box_min_x[lane] > box_max_x[lane] || box_min_y[lane] > box_max_y[lane]) << lane;
+    }
+
+    // Write out the surviving triangles
+    const uint32_t visible_mask = valid_mask & ~outside_mask & ~needs_clip_mask & ~culled_mask & ~empty_mask;
+    uint32_t setup_count = 0;
+    for (uint32_t lane = 0; lane < triangle_count; ++lane) {
+        if ((visible_mask & (1u << lane)) == 0) {
+            continue;
+        }
+        TriangleSetup& setup = setups[setup_count++];
+        for (uint32_t i = 0; i < 3; ++i) {
+            setup.a[i] = edge_a[i][lane];
+            setup.b[i] = edge_b[i][lane];
+            setup.c[i] = edge_c[i][lane];
+            setup.z[i] = screen_z[i][lane];
+            setup.inv_w[i] = inv_w[i][lane];
+            setup.vertices[i] = triangles[lane][i];
+        }
+        setup.sequence = sequences[lane];
+        setup.inv_area = 1.0f / static_cast<float>(area[lane] < 0 ? -area[lane] : area[lane]);
+        setup.min_x = box_min_x[lane];
+        setup.min_y = box_min_y[lane];
+        setup.max_x = box_max_x[lane];
+        setup.max_y = box_max_y[lane];
+        setup.min_z = std::min({ setup.z[0], setup.z[1], setup.z[2] });
+        setup.max_z = std::max({ setup.z[0], setup.z[1], setup.z[2] });
+    }
+    if (allow_clipping) {
+        worker.stats.triangles_culled += std::bitset<shader_lane_count>(valid_mask & ~needs_clip_mask & ~visible_mask).count();
+    }
+    return setup_count;
+}
+
+/* HOMOGENEOUS CLIPPING
+* Sutherland-Hodgman clipping in clip space, before the perspective divide. The polygon is clipped against one
+* plane at a time, and every edge that crosses the plane gets a new vertex, with all vertex shader outputs
+* interpolated linearly. Doing this before the divide keeps the interpolation perspective correct.
+*/
+uint32_t SoftwareRasterizer::clip_triangle(Worker& worker, const float* const triangle[3], float* polygon) {
+    const uint32_t stride = shaded_vertex_stride;
+    const float guard_x = 1.0f + 2.0f * raster_guard_band_pixels / std::max(viewport.width, 1.0f);
+    const float guard_y = 1.0f + 2.0f * raster_guard_band_pixels / std::max(viewport.height, 1.0f);
+
+    // Planes as (x, y, z, w, offset), a vertex is inside if dot(plane.xyzw, position) + offset >= 0. The w plane
+    // keeps 1 / w finite, the guard band planes are pulled in a little so rounding can't push vertices past them.
+    const float planes[5][5] = {
+        { 0.0f, 0.0f, 0.0f, 1.0f, -2.0f * raster_min_clip_w },
+        { 1.0f, 0.0f, 0.0f, guard_x * 0.999f, 0.0f },
+        { -1.0f, 0.0f, 0.0f, guard_x * 0.999f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, guard_y * 0.999f, 0.0f },
+        { 0.0f, -1.0f, 0.0f, guard_y * 0.999f, 0.0f },
+    };
+
+    // Ping-pong between the output polygon and a scratch polygon
+    float* polygons[2] = { polygon, worker.clip_scratch.data() };
+    uint32_t count = 3;
+    for (uint32_t v = 0; v < 3; ++v) {
+        memcpy(polygons[0] + v * stride, triangle[v], stride * sizeof(float));
+    }
+
+    uint32_t current = 0;
+    for (uint32_t p = 0; p < 5 && count >= 3; ++p) {
+        const float* source = polygons[current];
+        float* destination = polygons[current ^ 1];
+        uint32_t out_count = 0;
+        for (uint32_t v = 0; v < count; ++v) {
+            const float* a = source + v * stride;
+            const float* b = source + ((v + 1) % count) * stride;
+            const float* pa = a + position_register * 4;
+            const float* pb = b + position_register * 4;
+            const float da = planes[p][0] * pa[0] + planes[p][1] * pa[1] + planes[p][2] * pa[2] + planes[p][3] * pa[3] + planes[p][4];
+            const float db = planes[p][0] * pb[0] + planes[p][1] * pb[1] + planes[p][2] * pb[2] + planes[p][3] * pb[3] + planes[p][4];
+            if (da >= 0.0f) {
+                memcpy(destination + out_count++ * stride, a, stride * sizeof(float));
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                const float t = da / (da - db);
+                float* out = destination + out_count++ * stride;
+                for (uint32_t i = 0; i < stride; ++i) {
+                    out[i] = a[i] + (b[i] - a[i]) * t;
+                }
+            }
+        }
+        count = out_count;
+        current ^= 1;
+    }
+
+    if (current != 0) {
+        memcpy(polygon, polygons[1], static_cast<size_t>(count) * stride * sizeof(float));
+    }
+    return count >= 3 ? count : 0;
+}
+
+void SoftwareRasterizer::rasterize_triangle(Worker& worker, const TriangleSetup& setup) {
+    const bool depth_enable = pipeline_state->depth_enable;
+    const DepthFunc depth_func = pipeline_state->depth_func;
+    const int64_t sample_extent = sample_pattern_extent(render_target->sample_count);
+    for (uint32_t block_y = setup.min_y / raster_block_size; block_y <= setup.max_y / raster_block_size; ++block_y) {
+        for (uint32_t block_x = setup.min_x / raster_block_size; block_x <= setup.max_x / raster_block_size; ++block_x) {
+            // Evaluate the edge functions at the outermost samples of the four corner pixels of the block
+            const int64_t left = static_cast<int64_t>(block_x * raster_block_size) * subpixel_scale + subpixel_scale / 2 - sample_extent;
+            const int64_t top = static_cast<int64_t>(block_y * raster_block_size) * subpixel_scale + subpixel_scale / 2 - sample_extent;
+            const int64_t right = left + (raster_block_size - 1) * subpixel_scale + 2 * sample_extent;
+            const int64_t bottom = top + (raster_block_size - 1) * subpixel_scale + 2 * sample_extent;
+            const int64_t corner_x[4] = { left, right, left, right };
+            const int64_t corner_y[4] = { top, top, bottom, bottom };
+
+            // If all four corners are outside the same edge, no pixel in the block is covered
+            bool outside = false;
+            float corner_weights[4][3];
+            for (int i = 0; i < 3 && !outside; ++i) {
+                bool all_outside = true;
+                for (int corner = 0; corner < 4; ++corner) {
+                    const int64_t e = setup.a[i] * corner_x[corner] + setup.b[i] * corner_y[corner] + setup.c[i];
+                    all_outside &= e < 0;
+                    corner_weights[corner][i] = static_cast<float>(e) * setup.inv_area;
+                }
+                outside = all_outside;
+            }
+            if (outside) {
+                continue;
+            }
+            worker.stats.blocks_visited++;
+
+            // Hierarchical Z: the depth is a plane over the screen, so its range over the block is the range at the
+            // corners. It's widened by a tiny bit, to stay on the safe side of any rounding in the per-pixel values.
+            bool depth_test = depth_enable;
+            if (depth_enable) {
+                float block_min_z = FLT_MAX;
+                float block_max_z = -FLT_MAX;
+                for (int corner = 0; corner < 4; ++corner) {
+                    const float z = corner_weights[corner][0] * setup.z[0] + corner_weights[corner][1] * setup.z[1] + corner_weights[corner][2] * setup.z[2];
+                    block_min_z = std::min(block_min_z, z);
+                    block_max_z = std::max(block_max_z, z);
+                }
+                const float slack = 1e-6f * std::max(std::abs(block_min_z), std::abs(block_max_z)) + 1e-7f;
+                block_min_z = std::max(block_min_z, setup.min_z) - slack;
+                block_max_z = std::min(block_max_z, setup.max_z) + slack;
+
+                const DepthBlockRange& block = render_target->depth_blocks[block_y * render_target->blocks_x + block_x];
+                if (block_fully_hidden(depth_func, block_min_z, block_max_z, block)) {
+                    worker.stats.blocks_rejected_hiz++;
+                    continue;
+                }
+                if (block_fully_visible(depth_func, block_min_z, block_max_z, block)) {
+                    worker.stats.blocks_accepted_hiz++;
+                    depth_test = false;
+                }
+            }
+
+            ShadingRate rate = pipeline_state->shading_rate;
+            if (pipeline_state->shading_rate_combiner != ShadingRateCombiner::passthrough) {
+                const bool in_image = block_x < shading_rate_image_width && block_y < shading_rate_image_height;
+                const ShadingRate image_rate = in_image ? static_cast<ShadingRate>(shading_rate_image[block_y * shading_rate_image_width + block_x]) : ShadingRate::rate_1x1;
+                rate = combine_shading_rates(rate, image_rate, pipeline_state->shading_rate_combiner);
+            }
+            switch (render_target->sample_count) {
+                case 2: shade_block<2>(worker, setup, block_x, block_y, depth_test, rate); break;
+                case 4: shade_block<4>(worker, setup, block_x, block_y, depth_test, rate); break;
+                case 8: shade_block<8>(worker, setup, block_x, block_y, depth_test, rate); break;
+                default: shade_block<1>(worker, setup, block_x, block_y, depth_test, rate); break;
+            }
+        }
+    }
+}
+
+// Coverage and depth test for every sample of the 8 pixels in a block row. Without MSAA the only sample is the center.
+// Also returns the barycentric weights at the pixel centers, where the pixel shader runs at the full rate.
+template <uint32_t sample_count>
+uint32_t SoftwareRasterizer::cover_block_row(const TriangleSetup& setup, const uint32_t x0, const uint32_t y, const float* depth_row, const bool depth_test,
+                                             float weights[3][shader_lane_count], uint32_t sample_masks[shader_lane_count],
+                                             float depth[][shader_lane_count]) const {
+    const SamplePosition* pattern = sample_pattern(sample_count);
+    const int64_t center_y = static_cast<int64_t>(y) * subpixel_scale + subpixel_scale / 2;
+    for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+        const int32_t x = static_cast<int32_t>(x0 + lane);
+        const int64_t center_x = static_cast<int64_t>(x) * subpixel_scale + subpixel_scale / 2;
+        const bool in_box = x >= setup.min_x && x <= setup.max_x;
+        int64_t center_edges[3];
+        for (int i = 0; i < 3; ++i) {
+            center_edges[i] = setup.a[i] * center_x + setup.b[i] * center_y + setup.c[i];
+            weights[i][lane] = static_cast<float>(center_edges[i]) * setup.inv_area;
+        }
+        sample_masks[lane] = 0;
+        for (uint32_t sample = 0; sample < sample_count; ++sample) {
+            const int64_t offset_x = pattern[sample].x * (subpixel_scale / 16);
+            const int64_t offset_y = pattern[sample].y * (subpixel_scale / 16);
+            bool inside = in_box;
+            float sample_weights[3];
+            for (int i = 0; i < 3; ++i) {
+                const int64_t e = center_edges[i] + setup.a[i] * offset_x + setup.b[i] * offset_y;
+                inside &= e >= 0;
+                sample_weights[i] = static_cast<float>(e) * setup.inv_area;
+            }
+            const float z = std::clamp(sample_weights[0] * setup.z[0] + sample_weights[1] * setup.z[1] + sample_weights[2] * setup.z[2], setup.min_z, setup.max_z);
+            depth[sample][lane] = z;
+
+            // Depth clipping, since triangles aren't clipped against the near and far planes
+            inside &= z >= viewport.min_depth && z <= viewport.max_depth;
+            if (inside && depth_test) {
+                inside = depth_test_passes(pipeline_state->depth_func, z, depth_row[sample * raster_block_size + lane]);
+            }
+            sample_masks[lane] |= static_cast<uint32_t>(inside) << sample;
+        }
+    }
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+        mask |= static_cast<uint32_t>(sample_masks[lane] != 0) << lane;
+    }
+    return mask;
+}
+
+void SoftwareRasterizer::set_pixel_shader_inputs(Worker& worker, const TriangleSetup& setup, const float weights[3][shader_lane_count],
+                                                 const float position_x[shader_lane_count], const float position_y[shader_lane_count]) const {
+    ShaderContext& pixel_context = worker.pixel_context;
+
+    // Perspective correct interpolation: interpolate attribute / w and 1 / w linearly, then divide
+    float perspective_weights[3][shader_lane_count];
+    float w[shader_lane_count];
+    for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+        const float p0 = weights[0][lane] * setup.inv_w[0];
+        const float p1 = weights[1][lane] * setup.inv_w[1];
+        const float p2 = weights[2][lane] * setup.inv_w[2];
+        const float sum = p0 + p1 + p2;
+        w[lane] = sum != 0.0f ? 1.0f / sum : 0.0f;
+        perspective_weights[0][lane] = p0 * w[lane];
+        perspective_weights[1][lane] = p1 * w[lane];
+        perspective_weights[2][lane] = p2 * w[lane];
+    }
+    for (const VaryingLink& link : varying_links) {
+        ShaderRegister& input = pixel_context.inputs[link.pixel_register];
+        for (uint32_t c = 0; c < 4; ++c) {
+            if ((link.mask & (1u << c)) == 0) {
+                continue;
+            }
+            const float a0 = setup.vertices[0][link.vertex_register * 4 + c];
+            const float a1 = setup.vertices[1][link.vertex_register * 4 + c];
+            const float a2 = setup.vertices[2][link.vertex_register * 4 + c];
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                input.lanes[c][lane] = perspective_weights[0][lane] * a0 + perspective_weights[1][lane] * a1 + perspective_weights[2][lane] * a2;
+            }
+        }
+    }
+    if (pixel_position_register >= 0) {
+        ShaderRegister& input = pixel_context.inputs[pixel_position_register];
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            input.lanes[0][lane] = position_x[lane];
+            input.lanes[1][lane] = position_y[lane];
+            input.lanes[2][lane] = std::clamp(weights[0][lane] * setup.z[0] + weights[1][lane] * setup.z[1] + weights[2][lane] * setup.z[2], setup.min_z, setup.max_z);
+            input.lanes[3][lane] = w[lane];
+        }
+    }
+}
+
+// Writes the colors and depths of a block row. The whole row is read and written at once, with the mask selecting between
+// the old and new values.
+template <uint32_t sample_count>
+void SoftwareRasterizer::write_block_row(Worker& worker, const uint32_t block_index, const uint32_t row, const uint32_t mask,
+                                         uint32_t sample_masks[shader_lane_count], const float depth[][shader_lane_count],
+                                         const float colors[4][shader_lane_count]) {
+    const bool depth_write = pipeline_state->depth_enable && pipeline_state->depth_write;
+    uint32_t* color_row = render_target->color.data() + static_cast<size_t>(block_index) * raster_block_pixels + row * raster_block_size;
+    float* depth_row = render_target->depth.data() + (static_cast<size_t>(block_index) * raster_block_pixels + row * raster_block_size) * sample_count;
+
+    uint32_t full_mask = mask;
+    if constexpr (sample_count > 1) {
+        const uint32_t all_samples = (1u << sample_count) - 1;
+        full_mask = 0;
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            sample_masks[lane] = (mask & (1u << lane)) ? sample_masks[lane] : 0;
+            full_mask |= static_cast<uint32_t>(sample_masks[lane] == all_samples) << lane;
+        }
+    }
+
+    if (color_register >= 0) {
+        if constexpr (sample_count == 1) {
+            blend_function(pipeline_state->blend, colors, blend_factor, mask, color_row);
+        }
+        else {
+            // Pixels where every sample gets the new color are written like without MSAA, and compressed again. If the
+            // blend needs the old color, that only works for pixels that don't have separate sample colors.
+            uint64_t& expanded = render_target->expanded_pixels[block_index];
+            const uint32_t row_shift = row * raster_block_size;
+            const uint32_t row_expanded = static_cast<uint32_t>(expanded >> row_shift) & ((1u << raster_block_size) - 1);
+            const uint32_t compressed_mask = blend_reads_pixels ? full_mask & ~row_expanded : full_mask;
+            blend_function(pipeline_state->blend, colors, blend_factor, compressed_mask, color_row);
+            expanded &= ~(static_cast<uint64_t>(compressed_mask) << row_shift);
+
+            // The other pixels are blended sample by sample, with a lane for every sample
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                if (((mask & ~compressed_mask) & (1u << lane)) == 0) {
+                    continue;
+                }
+                float sample_sources[4][shader_lane_count];
+                for (uint32_t channel = 0; channel < 4; ++channel) {
+                    std::fill_n(sample_sources[channel], shader_lane_count, colors[channel][lane]);
+                }
+                uint32_t* samples = expand_pixel(*render_target, block_index, row_shift + lane);
+                uint32_t sample_colors[shader_lane_count] = {};
+                std::copy_n(samples, sample_count, sample_colors);
+                blend_function(pipeline_state->blend, sample_sources, blend_factor, sample_masks[lane], sample_colors);
+                std::copy_n(sample_colors, sample_count, samples);
+            }
+        }
+    }
+    if (depth_write) {
+        for (uint32_t sample = 0; sample < sample_count; ++sample) {
+            float* sample_depth_row = depth_row + sample * raster_block_size;
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                const bool written = sample_count > 1 ? (sample_masks[lane] & (1u << sample)) != 0 : (mask & (1u << lane)) != 0;
+                sample_depth_row[lane] = written ? depth[sample][lane] : sample_depth_row[lane];
+            }
+        }
+    }
+    worker.stats.pixels_written += std::bitset<shader_lane_count>(mask).count();
+    if constexpr (sample_count > 1) {
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            worker.stats.samples_written += std::bitset<raster_max_samples>(sample_masks[lane]).count();
+        }
+    }
+    else {
+        worker.stats.samples_written += std::bitset<shader_lane_count>(mask).count();
+    }
+}
+
+// The sample count is a template parameter, so the loops over the samples have a fixed length, and disappear without MSAA
+template <uint32_t sample_count>
+void SoftwareRasterizer::shade_block(Worker& worker, const TriangleSetup& setup, const uint32_t block_x, const uint32_t block_y, const bool depth_test,
+                                     const ShadingRate rate) {
+    const ShaderProgram& ps = *pipeline_state->pixel_shader;
+    ShaderContext& pixel_context = worker.pixel_context;
+    const uint32_t x0 = block_x * raster_block_size;
+    const uint32_t y0 = block_y * raster_block_size;
+    const uint32_t block_index = block_y * render_target->blocks_x + block_x;
+    render_target->prepare_block(block_index);
+    const float* block_depth = render_target->depth.data() + static_cast<size_t>(block_index) * raster_block_pixels * sample_count;
+    bool depth_written = false;
+
+    if (rate == ShadingRate::rate_1x1 && !ps.uses_derivatives) {
+        // Full rate: the pixel shader runs on one block row at a time
+        for (uint32_t row = 0; row < raster_block_size; ++row) {
+            const int32_t y = static_cast<int32_t>(y0 + row);
+            if (y < setup.min_y || y > setup.max_y) {
+                continue;
+            }
+            float weights[3][shader_lane_count];
+            uint32_t sample_masks[shader_lane_count];
+            float depth[sample_count][shader_lane_count];
+            uint32_t mask = cover_block_row<sample_count>(setup, x0, y, block_depth + row * raster_block_size * sample_count, depth_test,
+                                                          weights, sample_masks, depth);
+            if (mask == 0) {
+                continue;
+            }
+
+            float position_x[shader_lane_count];
+            float position_y[shader_lane_count];
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                position_x[lane] = static_cast<float>(x0 + lane) + 0.5f;
+                position_y[lane] = static_cast<float>(y) + 0.5f;
+            }
+            set_pixel_shader_inputs(worker, setup, weights, position_x, position_y);
+            pixel_context.discarded_lanes = 0;
+            execute_shader(ps, pixel_context);
+            worker.stats.pixel_shader_batches++;
+            worker.stats.pixel_shader_invocations += std::bitset<shader_lane_count>(mask).count();
+            mask &= ~pixel_context.discarded_lanes;
+
+            // Without a color output, only depth gets written
+            const float (*colors)[shader_lane_count] = color_register >= 0 ? pixel_context.outputs[color_register].lanes : nullptr;
+            write_block_row<sample_count>(worker, block_index, row, mask, sample_masks, depth, colors);
+            depth_written |= mask != 0;
+        }
+    }
+    else {
+        // Coarse rate, or derivatives that need 2x2 quads: first the coverage of the whole block
+        uint32_t row_masks[raster_block_size] = {};
+        uint32_t sample_masks[raster_block_size][shader_lane_count];
+        float depth[raster_block_size][sample_count][shader_lane_count];
+        for (uint32_t row = 0; row < raster_block_size; ++row) {
+            const int32_t y = static_cast<int32_t>(y0 + row);
+            if (y < setup.min_y || y > setup.max_y) {
+                continue;
+            }
+            float unused_weights[3][shader_lane_count];
+            row_masks[row] = cover_block_row<sample_count>(setup, x0, y, block_depth + row * raster_block_size * sample_count, depth_test,
+                                                           unused_weights, sample_masks[row], depth[row]);
+        }
+
+        // Then the pixel shader runs on batches of 8 coarse pixels, at their centers, going through the block row by row.
+        // For derivatives, a batch is two 2x2 quads of coarse pixels next to each other instead. The block is at least
+        // 2x2 coarse pixels at every rate, so quads never go past it.
+        const bool quads = ps.uses_derivatives;
+        const uint32_t rate_width_log2 = static_cast<uint32_t>(rate) >> 2;
+        const uint32_t rate_height_log2 = static_cast<uint32_t>(rate) & 3;
+        const uint32_t rate_width = 1u << rate_width_log2;
+        const uint32_t rate_height = 1u << rate_height_log2;
+        const uint32_t coarse_columns_log2 = 3 - rate_width_log2; // The block is 8 pixels wide
+        const uint32_t coarse_count = raster_block_pixels >> (rate_width_log2 + rate_height_log2);
+        float colors[raster_block_size][4][shader_lane_count];
+        for (uint32_t batch_start = 0; batch_start < coarse_count; batch_start += shader_lane_count) {
+            // A coarse pixel is shaded if any of its pixels is covered
+            uint32_t mask = 0;
+            uint32_t columns[shader_lane_count];
+            uint32_t rows[shader_lane_count];
+            uint32_t footprints[shader_lane_count][max_shading_rate_size] = {};
+            float weights[3][shader_lane_count];
+            float position_x[shader_lane_count];
+            float position_y[shader_lane_count];
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                const uint32_t coarse = std::min(batch_start + lane, coarse_count - 1);
+                uint32_t column = coarse & ((1u << coarse_columns_log2) - 1);
+                uint32_t row = coarse >> coarse_columns_log2;
+                if (quads) {
+                    const uint32_t quad = coarse >> 2;
+                    const uint32_t quad_columns_log2 = coarse_columns_log2 - 1;
+                    column = ((quad & ((1u << quad_columns_log2) - 1)) << 1) | (coarse & 1);
+                    row = ((quad >> quad_columns_log2) << 1) | ((coarse >> 1) & 1);
+                }
+                columns[lane] = column << rate_width_log2;
+                rows[lane] = row << rate_height_log2;
+                const uint32_t row_bits = ((1u << rate_width) - 1) << columns[lane];
+                for (uint32_t i = 0; i < rate_height && batch_start + lane < coarse_count; ++i) {
+                    footprints[lane][i] = row_masks[rows[lane] + i] & row_bits;
+                    mask |= static_cast<uint32_t>(footprints[lane][i] != 0) << lane;
+                }
+
+                // The center of a coarse pixel can be outside the triangle, the attributes are extrapolated there
+                const int64_t center_x = static_cast<int64_t>(x0 + columns[lane]) * subpixel_scale + rate_width * subpixel_scale / 2;
+                const int64_t center_y = static_cast<int64_t>(y0 + rows[lane]) * subpixel_scale + rate_height * subpixel_scale / 2;
+                for (int i = 0; i < 3; ++i) {
+                    weights[i][lane] = static_cast<float>(setup.a[i] * center_x + setup.b[i] * center_y + setup.c[i]) * setup.inv_area;
+                }
+                position_x[lane] = static_cast<float>(x0 + columns[lane]) + 0.5f * static_cast<float>(rate_width);
+                position_y[lane] = static_cast<float>(y0 + rows[lane]) + 0.5f * static_cast<float>(rate_height);
+            }
+            if (mask == 0) {
+                continue;
+            }
+
+            set_pixel_shader_inputs(worker, setup, weights, position_x, position_y);
+            pixel_context.discarded_lanes = 0;
+            execute_shader(ps, pixel_context);
+            worker.stats.pixel_shader_batches++;
+            worker.stats.pixel_shader_invocations += std::bitset<shader_lane_count>(mask).count();
+
+            // Copy the color to all pixels of the coarse pixel. A discard throws away all of them.
+            const ShaderRegister* output = color_register >= 0 ? &pixel_context.outputs[color_register] : nullptr;
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                if ((mask & (1u << lane)) == 0) {
+                    continue;
+                }
+                const bool discarded = (pixel_context.discarded_lanes & (1u << lane)) != 0;
+                for (uint32_t i = 0; i < rate_height; ++i) {
+                    if (discarded) {
+                        row_masks[rows[lane] + i] &= ~footprints[lane][i];
+                    }
+                    for (uint32_t channel = 0; channel < 4 && output; ++channel) {
+                        std::fill_n(colors[rows[lane] + i][channel] + columns[lane], rate_width, output->lanes[channel][lane]);
+                    }
+                }
+            }
+        }
+
+        for (uint32_t row = 0; row < raster_block_size; ++row) {
+            if (row_masks[row] != 0) {
+                write_block_row<sample_count>(worker, block_index, row, row_masks[row], sample_masks[row], depth[row], colors[row]);
+                depth_written = true;
+            }
+        }
+    }
+
+    // Keep the block's depth range up to date
+    if (depth_written && pipeline_state->depth_enable && pipeline_state->depth_write) {
+        DepthBlockRange range{ FLT_MAX, -FLT_MAX };
+        const uint32_t column_count = std::min(raster_block_size, render_target->width - x0);
+        const uint32_t row_count = std::min(raster_block_size, render_target->height - y0);
+        for (uint32_t row = 0; row < row_count; ++row) {
+            for (uint32_t sample = 0; sample < sample_count; ++sample) {
+                const float* depth_row = block_depth + (row * sample_count + sample) * raster_block_size;
+                for (uint32_t x = 0; x < column_count; ++x) {
+                    range.min_depth = std::min(range.min_depth, depth_row[x]);
+                    range.max_depth = std::max(range.max_depth, depth_row[x]);
+                }
+            }
+        }
+        render_target->depth_blocks[block_index] = range;
+    }
+}
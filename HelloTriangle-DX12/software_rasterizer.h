@@ -0,0 +1,334 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "blend_kernels.h"
+#include "shader_interpreter.h"
+#include "tile_binner.h"
+
+struct ClusterLight;
+struct ClusterLightLists;
+
+/* SOFTWARE RASTERIZER
+* A CPU version of the draw call, so the sample can render without a GPU (and so we can measure what the
+* rasterizer does, which a GPU won't tell us). It takes the same inputs as the D3D12 pipeline: a vertex
+* buffer with an input layout, an index buffer, the compiled vertex and pixel shaders, and constant and
+* structured buffers.
+* The shaders run on the CPU with the shader interpreter.
+*
+* Triangles are rasterized with edge functions in 8x8 pixel blocks. A block row is 8 pixels wide, which is
+* exactly one batch for the shader interpreter, so the pixel shader usually runs on a full row of pixels. Pixel
+* shaders with derivatives run on two 2x2 quads at a time instead, since they need the pixels below too.
+*
+* A draw runs on all threads in three steps: the vertex shader, triangle setup with binning into 64x64 pixel
+* tiles, and then rasterizing the tiles. Only one thread ever works on a tile, and it draws the tile's
+* triangles in the order they were submitted, so the image is the same for any number of threads.
+*/
+
+constexpr uint32_t raster_block_size = 8;
+constexpr uint32_t raster_tile_size = 64;
+constexpr uint32_t raster_subpixel_bits = 8; // Vertex positions are snapped to 1/256th of a pixel, like on GPUs
+constexpr float raster_guard_band_pixels = 262144.0f; // Triangles can reach this far outside the viewport before they get clipped
+
+// Same values as D3D12_COMPARISON_FUNC
+enum class DepthFunc : uint8_t {
+    never = 1,
+    less = 2,
+    equal = 3,
+    less_equal = 4,
+    greater = 5,
+    not_equal = 6,
+    greater_equal = 7,
+    always = 8,
+};
+
+// Same values as D3D12_CULL_MODE
+enum class CullMode : uint8_t {
+    none = 1,
+    front = 2,
+    back = 3,
+};
+
+/* VARIABLE RATE SHADING
+* Not every part of the screen needs the pixel shader to run for every pixel. With a coarser shading rate,
+* one pixel shader invocation covers 1x2, 2x2, 2x4 or even 4x4 pixels, and its color is copied to all of
+* them. Coverage and depth are still tested for every pixel (and sample), so triangle edges stay sharp.
+*
+* The rate can be set per draw in the pipeline state, and per 8x8 screen tile with a shading rate image. The
+* two are combined like in D3D12: passthrough keeps the draw's rate, override takes the image's, min and max
+* pick per axis, and sum adds them up.
+*/
+constexpr uint32_t raster_shading_rate_tile_size = 8; // Same as raster_block_size
+
+// Same values as D3D12_SHADING_RATE: log2 of the width in bits 2-3, log2 of the height in bits 0-1
+enum class ShadingRate : uint8_t {
+    rate_1x1 = 0x0,
+    rate_1x2 = 0x1,
+    rate_2x1 = 0x4,
+    rate_2x2 = 0x5,
+    rate_2x4 = 0x6,
+    rate_4x2 = 0x9,
+    rate_4x4 = 0xa,
+};
+
+// Same values as D3D12_SHADING_RATE_COMBINER
+enum class ShadingRateCombiner : uint8_t {
+    passthrough = 0,
+    override = 1,
+    min = 2,
+    max = 3,
+    sum = 4,
+};
+
+// Describes where a vertex shader input comes from, like D3D12_INPUT_ELEMENT_DESC, but only for float data
+struct SoftwareInputElement {
+    const char* semantic_name = nullptr;
+    uint32_t semantic_index = 0;
+    uint32_t component_count = 0;   // 1 to 4 floats
+    uint32_t offset = 0;            // In bytes, from the start of the vertex
+};
+
+struct SoftwarePipelineState {
+    const ShaderProgram* vertex_shader = nullptr;
+    const ShaderProgram* pixel_shader = nullptr;
+    std::vector<SoftwareInputElement> input_layout;
+    uint32_t vertex_stride = 0;
+    CullMode cull_mode = CullMode::none;
+    bool front_counter_clockwise = false;
+    bool depth_enable = false;
+    bool depth_write = true;
+    DepthFunc depth_func = DepthFunc::greater_equal;
+    uint32_t sample_count = 1;      // Like DXGI_SAMPLE_DESC::Count, has to match the render target
+    ShadingRate shading_rate = ShadingRate::rate_1x1;
+    ShadingRateCombiner shading_rate_combiner = ShadingRateCombiner::passthrough; // How the shading rate image is applied
+    RenderTargetFormat render_target_format = RenderTargetFormat::r8g8b8a8_unorm; // Like RTVFormats[0], has to match the render target
+    SoftwareBlendState blend;
+};
+
+struct SoftwareViewport {
+    float top_left_x = 0.0f;
+    float top_left_y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    float min_depth = 0.0f;
+    float max_depth = 1.0f;
+};
+
+/* HIERARCHICAL Z
+* Next to the depth buffer we keep the smallest and largest depth value of every 8x8 block. Before a triangle
+* is shaded in a block, we compare the depth range the triangle can have in that block against the block's
+* range. If the triangle can't pass the depth test anywhere in the block, the whole block is skipped without
+* running the pixel shader even once. And if it passes everywhere, the per-pixel depth test is skipped.
+*/
+struct DepthBlockRange {
+    float min_depth = 0.0f;
+    float max_depth = 0.0f;
+};
+
+/* SWIZZLED RENDER TARGET
+* A row major image is bad for a rasterizer that works in 8x8 blocks: every block touches 8 rows, which are
+* 8 different cache lines (and pages, for wide images). So the render target is stored block by block
+* instead: the 64 pixels of a block are next to each other in memory, row major inside the block. A block
+* row is 8 pixels, which is exactly one batch for the shader interpreter, so it can be loaded and stored as
+* a whole. A color block is 256 bytes and a depth block is 256 bytes, so a block is 4 cache lines of each.
+*
+* Clearing doesn't touch the pixels either. It only stores the clear value and marks every block as
+* cleared. A cleared block gets filled with the clear value the first time a triangle is drawn into it, and
+* blocks that were never drawn to are never written at all. resolve_color() and resolve_depth() turn the
+* blocks back into a row major image, for presenting or reading back.
+*/
+constexpr uint32_t raster_block_pixels = raster_block_size * raster_block_size;
+
+/* MULTISAMPLING
+* With MSAA, coverage and depth are tested at 2, 4 or 8 points inside every pixel (the standard D3D sample
+* patterns), but the pixel shader still runs once per pixel, at the center. Its color is written to the
+* samples that were covered and passed the depth test. The resolve averages the samples of every pixel.
+*
+* Depth is stored for every sample, since it's different for every sample anyway. Color is compressed:
+* most pixels are either fully inside a triangle or not touched by it, so all their samples have the same
+* color. Those pixels only store that one color. Only the pixels on triangle edges get their samples
+* "expanded" into separate colors, which are allocated the first time a pixel needs them. A bit per pixel
+* says which pixels are expanded, and drawing over all samples of a pixel compresses it again.
+*/
+constexpr uint32_t raster_max_samples = 8;
+
+// The separate sample colors of the expanded pixels in one block. A pixel gets a slot the first time it's
+// expanded, and keeps it until the block is cleared.
+struct SampleColorBlock {
+    uint64_t slotted_pixels = 0;
+    uint8_t slots[raster_block_pixels] = {};
+    std::vector<uint32_t> colors;               // sample_count colors per slot
+};
+
+// A color buffer with 32 bits per pixel and a 32-bit float depth buffer, stored in 8x8 blocks
+struct SoftwareRenderTarget {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t blocks_x = 0;
+    uint32_t blocks_y = 0;
+    uint32_t sample_count = 1;
+    RenderTargetFormat format = RenderTargetFormat::r8g8b8a8_unorm;
+    std::vector<uint32_t> color;                // Block by block, one color per pixel. Use resolve_color() to get a row major image
+    std::vector<float> depth;                   // Block by block, and per block row, 8 floats for every sample
+    std::vector<DepthBlockRange> depth_blocks;
+    std::vector<uint8_t> cleared_blocks;        // Per block, bit 0 if color still needs the clear, bit 1 for depth
+    std::vector<uint64_t> expanded_pixels;      // Per block, a bit for every pixel that has separate sample colors
+    std::vector<std::unique_ptr<SampleColorBlock>> sample_colors; // Per block, allocated when a pixel in it is expanded
+    uint32_t clear_color_value = 0;
+    float clear_depth_value = 0.0f;
+
+    // sample_count can be 1, 2, 4 or 8. Every format with 32 bits per pixel is supported.
+    void resize(uint32_t new_width, uint32_t new_height, uint32_t new_sample_count = 1,
+                RenderTargetFormat new_format = RenderTargetFormat::r8g8b8a8_unorm);
+    void clear_color(const float rgba[4]);
+    void clear_depth(float value);
+
+    // Fills in the clear values of a block that's about to be drawn to
+    void prepare_block(uint32_t block_index);
+
+    // Copy to a row major image, row_pitch is in pixels. With MSAA, color is the average of the samples, and
+    // depth is the first sample (D3D12 can't resolve depth either).
+    void resolve_color(uint32_t* destination, size_t row_pitch) const;
+    void resolve_depth(float* destination, size_t row_pitch) const;
+
+    // Bytes used by the buffers, including the sample colors that have been allocated so far
+    size_t memory_size() const;
+
+    size_t pixel_index(const uint32_t x, const uint32_t y) const {
+        const size_t block = static_cast<size_t>(y / raster_block_size) * blocks_x + x / raster_block_size;
+        return block * raster_block_pixels + (y % raster_block_size) * raster_block_size + x % raster_block_size;
+    }
+};
+
+struct RasterStats {
+    uint64_t vertex_shader_invocations = 0;
+    uint64_t triangles_in = 0;
+    uint64_t triangles_culled = 0;              // Backfacing, zero area, or outside the viewport
+    uint64_t triangles_clipped = 0;             // Crossed the w = 0 plane or the guard band
+    uint64_t blocks_visited = 0;                // 8x8 blocks that overlap a triangle
+    uint64_t blocks_rejected_hiz = 0;           // Blocks skipped because the triangle was fully hidden
+    uint64_t blocks_accepted_hiz = 0;           // Blocks where the per-pixel depth test could be skipped
+    uint64_t pixel_shader_batches = 0;          // Times the pixel shader ran (for up to 8 pixels)
+    uint64_t pixel_shader_invocations = 0;      // Covered pixels that passed the depth test and got shaded
+    uint64_t pixels_written = 0;
+    uint64_t samples_written = 0;               // Same as pixels_written without MSAA
+    uint64_t tiles_rasterized = 0;              // Tiles that had at least one triangle
+    uint64_t tiles_stolen = 0;                  // Tiles rasterized by a thread that didn't start out with them
+
+    void reset() { *this = RasterStats{}; }
+    void add(const RasterStats& other) {
+        vertex_shader_invocations += other.vertex_shader_invocations;
+        triangles_in += other.triangles_in;
+        triangles_culled += other.triangles_culled;
+        triangles_clipped += other.triangles_clipped;
+        blocks_visited += other.blocks_visited;
+        blocks_rejected_hiz += other.blocks_rejected_hiz;
+        blocks_accepted_hiz += other.blocks_accepted_hiz;
+        pixel_shader_batches += other.pixel_shader_batches;
+        pixel_shader_invocations += other.pixel_shader_invocations;
+        pixels_written += other.pixels_written;
+        samples_written += other.samples_written;
+        tiles_rasterized += other.tiles_rasterized;
+        tiles_stolen += other.tiles_stolen;
+    }
+};
+
+class SoftwareRasterizer {
+public:
+    SoftwareRasterizer();
+    ~SoftwareRasterizer();
+
+    void set_pipeline_state(const SoftwarePipelineState* pipeline_state);
+    void set_vertex_buffer(const void* data, size_t size_bytes);
+    void set_index_buffer(const uint32_t* indices, size_t index_count);
+    void set_constant_buffer(uint32_t slot, const void* data, size_t size_bytes);
+    void set_structured_buffer(uint32_t slot, const void* data, uint32_t stride, uint32_t element_count); // Like a buffer SRV
+
+    // Binds the cluster ranges, light indices and lights to t0, t1 and t2, where hello_triangle.ps.hlsl reads them.
+    // The lists come from assign_lights_to_clusters(), the light count and lookup go in the frame constants.
+    void set_cluster_lights(const ClusterLightLists& lists, const ClusterLight* lights, uint32_t light_count);
+    void set_viewport(const SoftwareViewport& viewport);
+    void set_scissor_rect(int32_t left, int32_t top, int32_t right, int32_t bottom);
+    void set_render_target(SoftwareRenderTarget* render_target);
+    void set_thread_count(unsigned thread_count); // 0 uses all hardware threads
+    void set_blend_factor(const float rgba[4]);   // Like OMSetBlendFactor
+
+    // One ShadingRate per 8x8 tile, row major. Tiles outside the image are 1x1. Pass nullptr to remove it.
+    void set_shading_rate_image(const uint8_t* rates, uint32_t width, uint32_t height);
+
+    // Same as DrawIndexedInstanced with one instance
+    void draw_indexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex);
+
+    RasterStats stats;
+
+private:
+    struct TriangleSetup;
+    struct Worker;
+
+    // A pixel shader input that's read from a vertex shader output
+    struct VaryingLink {
+        uint32_t pixel_register = 0;
+        uint32_t vertex_register = 0;
+        uint8_t mask = 0;
+    };
+
+    bool link_shaders();
+    void shade_vertices(Worker& worker, const uint32_t* vertices, uint32_t vertex_count, float* destination);
+    void process_index_batch(Worker& worker, uint32_t worker_index, const uint32_t* indices, int32_t base_vertex, uint32_t first_triangle,
+                             uint32_t triangle_count);
+    void bin_index_batch(Worker& worker, uint32_t worker_index, const float* const vertices[], uint32_t first_triangle, uint32_t triangle_count);
+    float* allocate_shaded_vertices(Worker& worker, uint32_t count);
+    void bin_triangle_batch(Worker& worker, uint32_t worker_index, const float* const triangles[][3], const uint32_t sequences[],
+                            uint32_t triangle_count);
+    void bin_triangle(Worker& worker, uint32_t worker_index, const TriangleSetup& setup);
+    uint32_t setup_triangle_batch(Worker& worker, const float* const triangles[][3], const uint32_t sequences[], uint32_t triangle_count,
+                                  bool allow_clipping, TriangleSetup* setups, uint32_t& clip_mask);
+    float* allocate_clipped_polygon(Worker& worker);
+    uint32_t clip_triangle(Worker& worker, const float* const triangle[3], float* polygon);
+    void rasterize_tile(Worker& worker, uint32_t tile);
+    void rasterize_triangle(Worker& worker, const TriangleSetup& setup);
+    template <uint32_t sample_count>
+    void shade_block(Worker& worker, const TriangleSetup& setup, uint32_t block_x, uint32_t block_y, bool depth_test, ShadingRate rate);
+    template <uint32_t sample_count>
+    uint32_t cover_block_row(const TriangleSetup& setup, uint32_t x0, uint32_t y, const float* depth_row, bool depth_test,
+                             float weights[3][shader_lane_count], uint32_t sample_masks[shader_lane_count], float depth[][shader_lane_count]) const;
+    void set_pixel_shader_inputs(Worker& worker, const TriangleSetup& setup, const float weights[3][shader_lane_count],
+                                 const float position_x[shader_lane_count], const float position_y[shader_lane_count]) const;
+    template <uint32_t sample_count>
+    void write_block_row(Worker& worker, uint32_t block_index, uint32_t row, uint32_t mask, uint32_t sample_masks[shader_lane_count],
+                         const float depth[][shader_lane_count], const float colors[4][shader_lane_count]);
+
+    const SoftwarePipelineState* pipeline_state = nullptr;
+    const uint8_t* vertex_data = nullptr;
+    size_t vertex_data_size = 0;
+    const uint32_t* index_data = nullptr;
+    size_t index_count = 0;
+    const float* constant_buffers[shader_max_constant_buffers] = {};
+    uint32_t constant_buffer_sizes[shader_max_constant_buffers] = {};
+    ShaderStructuredBuffer structured_buffers[shader_max_structured_buffers];
+    SoftwareViewport viewport;
+    int32_t scissor[4] = { 0, 0, INT32_MAX, INT32_MAX };
+    SoftwareRenderTarget* render_target = nullptr;
+    unsigned thread_count = 0;
+    const uint8_t* shading_rate_image = nullptr;
+    uint32_t shading_rate_image_width = 0;
+    uint32_t shading_rate_image_height = 0;
+    float blend_factor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // Per draw state
+    uint32_t shaded_vertex_stride = 0;          // In floats, all vertex shader output registers as float4s
+    std::vector<float> shaded_vertices;         // Every vertex from shaded_first_vertex on, when the whole range was shaded up front
+    uint32_t shaded_first_vertex = 0;
+    std::vector<int> vertex_input_sources;      // Input layout element for every vertex shader input register, -1 for none
+    std::vector<VaryingLink> varying_links;
+    int vertex_id_register = -1;
+    int position_register = -1;
+    int pixel_position_register = -1;
+    int color_register = -1;
+    BlendFunction blend_function = nullptr;
+    bool blend_reads_pixels = false;            // The blend needs the old color, so MSAA pixels have to be blended per sample
+    uint32_t tiles_x = 0;
+    uint32_t tiles_y = 0;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<TileBinArena> bin_arenas;       // One per worker
+};
@@ -0,0 +1,301 @@
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "file_io.h"
+#include "parallel_for.h"
+#include "texture_loader.h"
+
+namespace {
+    using Clock = std::chrono::high_resolution_clock;
+
+    double seconds_since(const Clock::time_point start) {
+        return std::chrono::duration<double, std::ratio<1, 1>>(Clock::now() - start).count();
+    }
+
+    uint32_t align_up(const uint32_t value, const uint32_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /* SKYLINE
+    * The skyline is the top edge of everything packed so far, stored as horizontal segments from left to right.
+    * A new rectangle is placed on top of the skyline where its top edge ends up lowest, and then the skyline
+    * is raised under it. Space below the skyline that's covered by an overhang is lost, which is the tradeoff
+    * for being fast.
+    */
+    struct SkylineSegment {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    struct SkylinePage {
+        std::vector<SkylineSegment> segments;
+        uint32_t failed_width = UINT32_MAX; // Smallest rectangle that didn't fit, anything bigger won't fit either
+        uint32_t failed_height = UINT32_MAX;
+    };
+
+    // Returns the y coordinate a rectangle would rest at when placed at segment `index`, or UINT32_MAX if it doesn't fit
+    uint32_t skyline_fit(const SkylinePage& page, const size_t index, const uint32_t width, const uint32_t height,
+                         const uint32_t page_width, const uint32_t page_height) {
+        const uint32_t x = page.segments[index].x;
+        if (x + width > page_width) {
+            return UINT32_MAX;
+        }
+
+        uint32_t y = 0;
+        uint32_t width_left = width;
+        for (size_t i = index; width_left > 0; ++i) {
+            if (i >= page.segments.size()) {
+                return UINT32_MAX;
+            }
+            y = std::max(y, page.segments[i].y);
+            if (y + height > page_height) {
+                return UINT32_MAX;
+            }
+            width_left -= std::min(width_left, page.segments[i].width);
+        }
+        return y;
+    }
+
+    bool skyline_insert(SkylinePage& page, const uint32_t width, const uint32_t height, const uint32_t page_width,
+                        const uint32_t page_height, uint32_t& out_x, uint32_t& out_y) {
+        if (width >= page.failed_width && height >= page.failed_height) {
+            return false;
+        }
+
+        // Find the position where the top of the rectangle is lowest, leftmost on ties
+        size_t best_index = SIZE_MAX;
+        uint32_t best_top = UINT32_MAX;
+        uint32_t best_y = 0;
+        for (size_t i = 0; i < page.segments.size(); ++i) {
+            const uint32_t y = skyline_fit(page, i, width, height, page_width, page_height);
+            if (y != UINT32_MAX && y + height < best_top) {
+                best_index = i;
+                best_top = y + height;
+                best_y = y;
+            }
+        }
+
+        if (best_index == SIZE_MAX) {
+            if (width <= page.failed_width && height <= page.failed_height) {
+                page.failed_width = width;
+                page.failed_height = height;
+            }
+            return false;
+        }
+
+        out_x = page.segments[best_index].x;
+        out_y = best_y;
+
+        // Raise the skyline under the new rectangle
+        page.segments.insert(page.segments.begin() + best_index, SkylineSegment{ out_x, best_top, width });
+        for (size_t i = best_index + 1; i < page.segments.size();) {
+            SkylineSegment& segment = page.segments[i];
+            const uint32_t covered_until = out_x + width;
+            if (segment.x >= covered_until) {
+                break;
+            }
+            const uint32_t overlap = covered_until - segment.x;
+            if (overlap >= segment.width) {
+                page.segments.erase(page.segments.begin() + i);
+                continue;
+            }
+            segment.x += overlap;
+            segment.width -= overlap;
+            break;
+        }
+
+        // Merge neighbours at the same height, so the number of segments stays small
+        for (size_t i = 0; i + 1 < page.segments.size();) {
+            if (page.segments[i].y == page.segments[i + 1].y) {
+                page.segments[i].width += page.segments[i + 1].width;
+                page.segments.erase(page.segments.begin() + i + 1);
+            }
+            else {
+                ++i;
+            }
+        }
+        return true;
+    }
+
+    // Copy an image into its page, repeating the edge pixels into the padding around it
+    void blit_with_border(const AtlasImage& image, const AtlasEntry& entry, const uint32_t padding, const uint32_t page_width, uint8_t* page_pixels) {
+        const int64_t width = image.width;
+        const int64_t height = image.height;
+        for (int64_t y = -static_cast<int64_t>(padding); y < height + padding; ++y) {
+            const int64_t source_y = std::clamp<int64_t>(y, 0, height - 1);
+            const uint8_t* source_row = image.pixels + source_y * width * 4;
+            uint8_t* destination_row = page_pixels + ((entry.y + y) * page_width + entry.x) * 4;
+
+            // Left border, middle, right border
+            for (int64_t x = -static_cast<int64_t>(padding); x < 0; ++x) {
+                memcpy(destination_row + x * 4, source_row, 4);
+            }
+            memcpy(destination_row, source_row, static_cast<size_t>(width) * 4);
+            for (int64_t x = width; x < width + padding; ++x) {
+                memcpy(destination_row + x * 4, source_row + (width - 1) * 4, 4);
+            }
+        }
+    }
+}
+
+bool pack_atlas_rectangles(const std::vector<AtlasImage>& images, TextureAtlas& atlas, uint32_t& page_count) {
+    const AtlasSettings& settings = atlas.settings;
+    const uint32_t alignment = 1u << (std::max(1u, settings.mip_levels) - 1);
+    atlas.entries.assign(images.size(), AtlasEntry{});
+    atlas.uv_remap.assign(images.size(), AtlasUvRemap{});
+    atlas.stats.used_pixels = 0;
+    atlas.stats.failed_images = 0;
+    page_count = 0;
+
+    // Packing tall images first gives a much flatter skyline. Sort indices, so the entries keep the input order.
+    std::vector<uint32_t> order;
+    order.reserve(images.size());
+    for (uint32_t i = 0; i < images.size(); ++i) {
+        if (images[i].width > 0 && images[i].height > 0) {
+            order.push_back(i);
+        }
+        else {
+            atlas.stats.failed_images++;
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+        if (images[a].height != images[b].height) return images[a].height > images[b].height;
+        if (images[a].width != images[b].width) return images[a].width > images[b].width;
+        return a < b;
+    });
+
+    std::vector<SkylinePage> pages;
+    bool all_fit = true;
+    for (const uint32_t index : order) {
+        const AtlasImage& image = images[index];
+        const uint32_t padded_width = align_up(image.width + settings.padding * 2, alignment);
+        const uint32_t padded_height = align_up(image.height + settings.padding * 2, alignment);
+        if (padded_width > settings.page_width || padded_height > settings.page_height) {
+            printf("[ERROR] Image %u (%ux%u) is too big for a %ux%u atlas page\n", index, image.width, image.height, settings.page_width, settings.page_height);
+            atlas.stats.failed_images++;
+            all_fit = false;
+            continue;
+        }
+
+        // Try the pages we already have first, then start a new one
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t page_index = 0;
+        for (; page_index < pages.size(); ++page_index) {
+            if (skyline_insert(pages[page_index], padded_width, padded_height, settings.page_width, settings.page_height, x, y)) {
+                break;
+            }
+        }
+        if (page_index == pages.size()) {
+            if (pages.size() >= settings.max_pages) {
+                atlas.stats.failed_images++;
+                all_fit = false;
+                continue;
+            }
+            pages.push_back(SkylinePage{ { SkylineSegment{ 0, 0, settings.page_width } } });
+            skyline_insert(pages.back(), padded_width, padded_height, settings.page_width, settings.page_height, x, y);
+        }
+
+        AtlasEntry& entry = atlas.entries[index];
+        entry.page = page_index;
+        entry.x = x + settings.padding;
+        entry.y = y + settings.padding;
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.uv_offset = { static_cast<float>(entry.x) / settings.page_width, static_cast<float>(entry.y) / settings.page_height };
+        entry.uv_scale = { static_cast<float>(entry.width) / settings.page_width, static_cast<float>(entry.height) / settings.page_height };
+        AtlasUvRemap& remap = atlas.uv_remap[index];
+        remap.scale = entry.uv_scale;
+        remap.offset = entry.uv_offset;
+        remap.page = entry.page;
+        atlas.stats.used_pixels += static_cast<uint64_t>(padded_width) * padded_height;
+    }
+
+    page_count = static_cast<uint32_t>(pages.size());
+    atlas.stats.page_pixels = static_cast<uint64_t>(page_count) * settings.page_width * settings.page_height;
+    return all_fit;
+}
+
+bool build_atlas(const std::vector<AtlasImage>& images, const AtlasSettings& settings, TextureAtlas& atlas) {
+    atlas.settings = settings;
+
+    auto start = Clock::now();
+    uint32_t page_count = 0;
+    const bool all_fit = pack_atlas_rectangles(images, atlas, page_count);
+    atlas.stats.pack_seconds = seconds_since(start);
+
+    // Each image covers its own rectangle, so images can be copied in parallel without any locking
+    start = Clock::now();
+    atlas.pages.assign(page_count, AtlasPage{});
+    parallel_for(page_count, 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            atlas.pages[i].pixels.assign(static_cast<size_t>(settings.page_width) * settings.page_height * 4, 0);
+        }
+    });
+    parallel_for(images.size(), 64, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const AtlasEntry& entry = atlas.entries[i];
+            if (entry.page != UINT32_MAX && images[i].pixels) {
+                blit_with_border(images[i], entry, settings.padding, settings.page_width, atlas.pages[entry.page].pixels.data());
+            }
+        }
+    });
+    atlas.stats.blit_seconds = seconds_since(start);
+    return all_fit;
+}
+
+bool build_atlas_from_files(const std::vector<std::string>& paths, const AtlasSettings& settings, TextureAtlas& atlas) {
+    // Decode everything in parallel. Every thread reads and decodes its own files, so nothing is shared.
+    const auto start = Clock::now();
+    std::vector<DecodedImage> decoded(paths.size());
+    parallel_for(paths.size(), 16, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            load_image(paths[i], 4, decoded[i]);
+        }
+    });
+    const double decode_seconds = seconds_since(start);
+
+    std::vector<AtlasImage> images(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        images[i].width = static_cast<uint32_t>(decoded[i].width);
+        images[i].height = static_cast<uint32_t>(decoded[i].height);
+        images[i].pixels = static_cast<const uint8_t*>(decoded[i].pixels);
+    }
+
+    const bool all_fit = build_atlas(images, settings, atlas);
+    atlas.stats.decode_seconds = decode_seconds;
+
+    for (auto& image : decoded) {
+        free_image(image);
+    }
+    return all_fit && atlas.stats.failed_images == 0;
+}
+
+bool remap_mesh_uvs(const TextureAtlas& atlas, const uint32_t* image_indices, glm::vec2* texcoords, const size_t vertex_count) {
+    for (size_t i = 0; i < vertex_count; ++i) {
+        if (image_indices[i] >= atlas.uv_remap.size() || atlas.uv_remap[image_indices[i]].page == UINT32_MAX) {
+            printf("[ERROR] Vertex %zu uses image %u, which isn't in the atlas\n", i, image_indices[i]);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < vertex_count; ++i) {
+        const AtlasUvRemap& remap = atlas.uv_remap[image_indices[i]];
+        texcoords[i] = texcoords[i] * remap.scale + remap.offset;
+    }
+    return true;
+}
+
+bool write_uv_remap_table(const TextureAtlas& atlas, const std::string& path) {
+    const uint32_t entry_count = static_cast<uint32_t>(atlas.uv_remap.size());
+    std::vector<uint8_t> file(8 + atlas.uv_remap.size() * sizeof(AtlasUvRemap));
+    memcpy(file.data(), "ATUV", 4);
+    memcpy(file.data() + 4, &entry_count, sizeof(entry_count));
+    if (entry_count > 0) {
+        memcpy(file.data() + 8, atlas.uv_remap.data(), atlas.uv_remap.size() * sizeof(AtlasUvRemap));
+    }
+    return write_file(path, file.data(), file.size(), false);
+}
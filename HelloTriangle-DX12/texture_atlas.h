@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "glm/vec2.hpp"
+
+/* TEXTURE ATLAS
+* Instead of creating one texture (and one descriptor, and one binding per draw) for every small image,
+* we pack many images into a few big pages. Meshes then remap their UVs into the page with the entry's
+* offset and scale, and everything that uses the same page can be drawn with the same binding.
+*
+* Packing uses a skyline bottom-left packer, which is close to MaxRects in efficiency but much faster when
+* there are tens of thousands of images. Decoding and copying the images into the pages both run in parallel.
+*/
+
+struct AtlasSettings {
+    uint32_t page_width = 4096;
+    uint32_t page_height = 4096;
+    uint32_t padding = 2;       // Border around every image, filled by repeating its edge pixels, so filtering doesn't bleed
+    uint32_t mip_levels = 1;    // Images are aligned to 2^(mip_levels - 1) pixels, so they don't share texels in the smaller mips
+    uint32_t max_pages = 64;
+};
+
+// Where an image ended up, and how to remap its UVs: atlas_uv = uv * uv_scale + uv_offset
+struct AtlasEntry {
+    uint32_t page = UINT32_MAX; // UINT32_MAX if the image couldn't be decoded or didn't fit
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    glm::vec2 uv_offset{ 0.0f };
+    glm::vec2 uv_scale{ 0.0f };
+};
+
+/* UV REMAP TABLE
+* One entry per input image, in the same order, laid out so it can be uploaded as is as a StructuredBuffer. Meshes
+* keep their own UVs and store which image they use (per vertex or per draw), and the shader remaps with
+* atlas_uv = uv * scale + offset before sampling `page`. Images that aren't in the atlas have page UINT32_MAX.
+*/
+struct AtlasUvRemap {
+    glm::vec2 scale{ 0.0f };
+    glm::vec2 offset{ 0.0f };
+    uint32_t page = UINT32_MAX;
+    uint32_t padding[3] = {};
+};
+static_assert(sizeof(AtlasUvRemap) == 32, "AtlasUvRemap is uploaded as is, so it has to stay a multiple of 16 bytes");
+
+// An RGBA8 page
+struct AtlasPage {
+    std::vector<uint8_t> pixels;
+};
+
+struct AtlasStats {
+    double decode_seconds = 0.0;
+    double pack_seconds = 0.0;
+    double blit_seconds = 0.0;
+    uint64_t used_pixels = 0;     // Pixels covered by images, including padding
+    uint64_t page_pixels = 0;     // Total pixels in all pages
+    uint32_t failed_images = 0;
+    float efficiency() const { return page_pixels ? static_cast<float>(used_pixels) / static_cast<float>(page_pixels) : 0.0f; }
+};
+
+struct TextureAtlas {
+    AtlasSettings settings;
+    std::vector<AtlasPage> pages;
+    std::vector<AtlasEntry> entries; // Same order as the input images
+    std::vector<AtlasUvRemap> uv_remap; // Same order as the input images
+    AtlasStats stats;
+};
+
+// An image that's already decoded, as tightly packed RGBA8
+struct AtlasImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t* pixels = nullptr;
+};
+
+// Only packs the rectangles, without touching any pixels. Fills in `atlas.entries`, `atlas.uv_remap` and the page count.
+// Returns false if any of the images didn't fit.
+bool pack_atlas_rectangles(const std::vector<AtlasImage>& images, TextureAtlas& atlas, uint32_t& page_count);
+
+// Pack images that are already decoded
+bool build_atlas(const std::vector<AtlasImage>& images, const AtlasSettings& settings, TextureAtlas& atlas);
+
+// Decode image files in parallel with stb_image, then pack them
+bool build_atlas_from_files(const std::vector<std::string>& paths, const AtlasSettings& settings, TextureAtlas& atlas);
+
+// Remap a mesh's UVs into the atlas, for all vertices that use the given entry
+inline glm::vec2 remap_uv(const AtlasEntry& entry, const glm::vec2 uv) {
+    return uv * entry.uv_scale + entry.uv_offset;
+}
+
+// Bake the remap into a mesh's UVs, for meshes that can't do it in the shader. `image_indices` has the input image of
+// every vertex. Returns false, without changing anything, if a vertex uses an image that isn't in the atlas.
+bool remap_mesh_uvs(const TextureAtlas& atlas, const uint32_t* image_indices, glm::vec2* texcoords, size_t vertex_count);
+
+// Write the UV remap table to a file: "ATUV", the entry count as a uint32, then the AtlasUvRemap entries
+bool write_uv_remap_table(const TextureAtlas& atlas, const std::string& path);
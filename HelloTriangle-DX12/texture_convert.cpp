@@ -0,0 +1,368 @@
+#include "texture_convert.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_CONVERT_SSE2 1
+#include <emmintrin.h>
+#else
+#define TEXTURE_CONVERT_SSE2 0
+#endif
+
+namespace {
+    uint32_t float_bits(const float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bits_float(const uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    /* GAMMA LOOKUP TABLES
+    * An 8-bit channel only has 256 possible values, so instead of running the sRGB curve for every pixel,
+    * we run it once for every possible value. The half table lets 8-bit images go to RGBA16F without
+    * touching floats at all.
+    */
+    struct GammaTables {
+        float srgb_to_linear[256];
+        float unorm_to_float[256];
+        uint16_t srgb_to_half[256];
+        uint16_t unorm_to_half[256];
+
+        GammaTables() {
+            for (int i = 0; i < 256; ++i) {
+                const float c = static_cast<float>(i) / 255.0f;
+                srgb_to_linear[i] = (c <= 0.04045f) ? c / 12.92f : static_cast<float>(std::pow((c + 0.055) / 1.055, 2.4));
+                unorm_to_float[i] = c;
+                srgb_to_half[i] = float_to_half(srgb_to_linear[i]);
+                unorm_to_half[i] = float_to_half(unorm_to_float[i]);
+            }
+        }
+    };
+
+    const GammaTables& gamma_tables() {
+        static const GammaTables tables;
+        return tables;
+    }
+
+    // Which source channel ends up in each of the 4 output channels, -1 means "fill with 1"
+    struct ChannelMap {
+        int source[4];
+    };
+
+    ChannelMap channel_map(const int channels) {
+        switch (channels) {
+        case 1:  return { { 0, 0, 0, -1 } };
+        case 2:  return { { 0, 0, 0, 1 } };
+        case 3:  return { { 0, 1, 2, -1 } };
+        default: return { { 0, 1, 2, 3 } };
+        }
+    }
+
+    uint16_t float_to_unorm16(const float value) {
+        const float clamped = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f; // Also turns NaN into 0
+        return static_cast<uint16_t>(clamped * 65535.0f + 0.5f);
+    }
+
+    uint8_t float_to_unorm8(const float value) {
+        const float clamped = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f; // Also turns NaN into 0
+        return static_cast<uint8_t>(clamped * 255.0f + 0.5f);
+    }
+
+    // Read one channel of one pixel as 16-bit unorm
+    uint16_t fetch_unorm16(const DecodedImage& source, const size_t pixel, const int channel) {
+        if (channel < 0) {
+            return 0xFFFF;
+        }
+        const size_t index = pixel * source.channels + channel;
+        switch (source.bytes_per_channel) {
+        case 1:  return static_cast<uint16_t>(static_cast<const uint8_t*>(source.pixels)[index] * 257);
+        case 2:  return static_cast<const uint16_t*>(source.pixels)[index];
+        default: return float_to_unorm16(static_cast<const float*>(source.pixels)[index]);
+        }
+    }
+
+    // Expand one row of the source image to linear RGBA floats
+    void expand_row_to_float4(const DecodedImage& source, const int y, const bool srgb, float* row) {
+        const ChannelMap map = channel_map(source.channels);
+        const size_t first_pixel = static_cast<size_t>(y) * source.width;
+
+        if (source.bytes_per_channel == 1) {
+            const GammaTables& tables = gamma_tables();
+            const float* color_table = srgb ? tables.srgb_to_linear : tables.unorm_to_float;
+            const uint8_t* pixels = static_cast<const uint8_t*>(source.pixels) + first_pixel * source.channels;
+            for (int x = 0; x < source.width; ++x) {
+                const uint8_t* pixel = pixels + static_cast<size_t>(x) * source.channels;
+                row[x * 4 + 0] = color_table[pixel[map.source[0]]];
+                row[x * 4 + 1] = color_table[pixel[map.source[1]]];
+                row[x * 4 + 2] = color_table[pixel[map.source[2]]];
+                row[x * 4 + 3] = map.source[3] < 0 ? 1.0f : tables.unorm_to_float[pixel[map.source[3]]];
+            }
+        }
+        else if (source.bytes_per_channel == 2) {
+            const uint16_t* pixels = static_cast<const uint16_t*>(source.pixels) + first_pixel * source.channels;
+            for (int x = 0; x < source.width; ++x) {
+                const uint16_t* pixel = pixels + static_cast<size_t>(x) * source.channels;
+                for (int c = 0; c < 4; ++c) {
+                    row[x * 4 + c] = map.source[c] < 0 ? 1.0f : static_cast<float>(pixel[map.source[c]]) / 65535.0f;
+                }
+            }
+        }
+        else {
+            const float* pixels = static_cast<const float*>(source.pixels) + first_pixel * source.channels;
+            for (int x = 0; x < source.width; ++x) {
+                const float* pixel = pixels + static_cast<size_t>(x) * source.channels;
+                for (int c = 0; c < 4; ++c) {
+                    row[x * 4 + c] = map.source[c] < 0 ? 1.0f : pixel[map.source[c]];
+                }
+            }
+        }
+    }
+
+    // 8-bit source straight to RGBA16F through the half lookup tables, no floats involved
+    void convert_row_8_bit_to_half4(const DecodedImage& source, const int y, const bool srgb, uint16_t* destination) {
+        const GammaTables& tables = gamma_tables();
+        const uint16_t* color_table = srgb ? tables.srgb_to_half : tables.unorm_to_half;
+        const ChannelMap map = channel_map(source.channels);
+        const uint8_t* pixels = static_cast<const uint8_t*>(source.pixels) + static_cast<size_t>(y) * source.width * source.channels;
+        constexpr uint16_t half_one = 0x3C00;
+        for (int x = 0; x < source.width; ++x) {
+            const uint8_t* pixel = pixels + static_cast<size_t>(x) * source.channels;
+            destination[x * 4 + 0] = color_table[pixel[map.source[0]]];
+            destination[x * 4 + 1] = color_table[pixel[map.source[1]]];
+            destination[x * 4 + 2] = color_table[pixel[map.source[2]]];
+            destination[x * 4 + 3] = map.source[3] < 0 ? half_one : tables.unorm_to_half[pixel[map.source[3]]];
+        }
+    }
+}
+
+size_t texture_format_pixel_size(const TextureFormat format) {
+    switch (format) {
+    case TextureFormat::r8g8b8a8_unorm:     return 4;
+    case TextureFormat::r16_unorm:          return 2;
+    case TextureFormat::r16g16_unorm:       return 4;
+    case TextureFormat::r16g16b16a16_float: return 8;
+    case TextureFormat::r32g32b32a32_float: return 16;
+    case TextureFormat::r9g9b9e5_sharedexp: return 4;
+    }
+    return 0;
+}
+
+/* FLOAT TO HALF
+* Round-to-nearest-even conversion, handling overflow to infinity, NaN and subnormal results.
+* This is the branchless version by Fabian Giesen, the SSE2 version does the same thing 4 floats at a time.
+*/
+uint16_t float_to_half(const float value) {
+    constexpr uint32_t f32_infinity = 255u << 23;
+    constexpr uint32_t f16_max = (127u + 16u) << 23;
+    constexpr uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits = float_bits(value);
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t result;
+    if (bits >= f16_max) {
+        // Infinity stays infinity, NaN becomes a quiet NaN
+        result = (bits > f32_infinity) ? 0x7E00 : 0x7C00;
+    }
+    else if (bits < (113u << 23)) {
+        // Subnormal or zero: let the float adder do the rounding for us
+        result = float_bits(bits_float(bits) + bits_float(denorm_magic)) - denorm_magic;
+    }
+    else {
+        const uint32_t mantissa_odd = (bits >> 13) & 1;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+        bits += mantissa_odd;
+        result = bits >> 13;
+    }
+    return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+void float_to_half(const float* source, uint16_t* destination, const size_t count) {
+    size_t i = 0;
+#if TEXTURE_CONVERT_SSE2
+    const __m128i sign_mask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i f16_max = _mm_set1_epi32((127 + 16) << 23);
+    const __m128i nan_bit = _mm_set1_epi32(0x200);
+    const __m128i infinity = _mm_set1_epi32(0x7C00);
+    const __m128i min_normal = _mm_set1_epi32((127 - 14) << 23);
+    const __m128i subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i normal_bias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves[2];
+        for (int half = 0; half < 2; ++half) {
+            const __m128 value = _mm_loadu_ps(source + i + half * 4);
+            const __m128 just_sign = _mm_and_ps(_mm_castsi128_ps(sign_mask), value);
+            const __m128 absolute = _mm_xor_ps(value, just_sign);
+            const __m128i absolute_int = _mm_castps_si128(absolute);
+
+            const __m128 is_nan = _mm_cmpunord_ps(absolute, absolute);
+            const __m128i is_regular = _mm_cmpgt_epi32(f16_max, absolute_int);
+            const __m128i inf_or_nan = _mm_or_si128(_mm_and_si128(_mm_castps_si128(is_nan), nan_bit), infinity);
+            const __m128i is_subnormal = _mm_cmpgt_epi32(min_normal, absolute_int);
+
+            // Subnormal result
+            const __m128 subnormal_sum = _mm_add_ps(absolute, _mm_castsi128_ps(subnormal_magic));
+            const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormal_sum), subnormal_magic);
+
+            // Normal result
+            const __m128i mantissa_odd = _mm_srai_epi32(_mm_slli_epi32(absolute_int, 31 - 13), 31);
+            const __m128i rounded = _mm_sub_epi32(_mm_add_epi32(absolute_int, normal_bias), mantissa_odd);
+            const __m128i normal = _mm_srli_epi32(rounded, 13);
+
+            const __m128i finite = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+            const __m128i joined = _mm_or_si128(_mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, inf_or_nan));
+
+            // Shifting the sign down arithmetically makes negative results valid int16s, so the saturating pack keeps all the bits
+            halves[half] = _mm_or_si128(joined, _mm_srai_epi32(_mm_castps_si128(just_sign), 16));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packs_epi32(halves[0], halves[1]));
+    }
+#endif
+    for (; i < count; ++i) {
+        destination[i] = float_to_half(source[i]);
+    }
+}
+
+/* RGB9E5
+* Three 9-bit mantissas that share one 5-bit exponent, following the D3D conversion rules:
+* negative values and NaN become 0, and values are clamped to the largest representable number.
+*/
+uint32_t float3_to_rgb9e5(const float red, const float green, const float blue) {
+    constexpr float max_rgb9e5 = 65408.0f; // (511 / 512) * 2^16
+    const auto clamp = [](const float value) {
+        return value > 0.0f ? (value < max_rgb9e5 ? value : max_rgb9e5) : 0.0f;
+    };
+    const float r = clamp(red);
+    const float g = clamp(green);
+    const float b = clamp(blue);
+    const float max_channel = r > g ? (r > b ? r : b) : (g > b ? g : b);
+
+    // floor(log2(max_channel)), read straight from the float exponent. Zero and subnormals end up clamped to -16.
+    int exponent_floor = static_cast<int>((float_bits(max_channel) >> 23) & 0xFF) - 127;
+    if (exponent_floor < -16) {
+        exponent_floor = -16;
+    }
+    int shared_exponent = exponent_floor + 1 + 15;
+
+    // Scaling by a power of two is exact, so this can't be off by one from the division in the spec
+    float scale = bits_float(static_cast<uint32_t>(127 + 24 - shared_exponent) << 23);
+    if (static_cast<int>(std::floor(max_channel * scale + 0.5f)) == 512) {
+        scale *= 0.5f;
+        shared_exponent++;
+    }
+
+    const auto r_mantissa = static_cast<uint32_t>(std::floor(r * scale + 0.5f));
+    const auto g_mantissa = static_cast<uint32_t>(std::floor(g * scale + 0.5f));
+    const auto b_mantissa = static_cast<uint32_t>(std::floor(b * scale + 0.5f));
+    return r_mantissa | (g_mantissa << 9) | (b_mantissa << 18) | (static_cast<uint32_t>(shared_exponent) << 27);
+}
+
+float srgb_to_linear(const uint8_t value) {
+    return gamma_tables().srgb_to_linear[value];
+}
+
+void swap_bytes_16(const uint16_t* source, uint16_t* destination, const size_t count) {
+    size_t i = 0;
+#if TEXTURE_CONVERT_SSE2
+    for (; i + 8 <= count; i += 8) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), swapped);
+    }
+#endif
+    for (; i < count; ++i) {
+        destination[i] = static_cast<uint16_t>((source[i] << 8) | (source[i] >> 8));
+    }
+}
+
+bool convert_image(const DecodedImage& source, const TextureFormat format, const bool srgb, void* destination, const size_t destination_row_pitch) {
+    if (!source.pixels || !destination || source.channels < 1 || source.channels > 4) {
+        return false;
+    }
+    if (source.bytes_per_channel != 1 && source.bytes_per_channel != 2 && source.bytes_per_channel != 4) {
+        return false;
+    }
+    if (destination_row_pitch < static_cast<size_t>(source.width) * texture_format_pixel_size(format)) {
+        return false;
+    }
+
+    const ChannelMap map = channel_map(source.channels);
+    const size_t pixel_count = static_cast<size_t>(source.width);
+    std::vector<float> float_row;
+
+    for (int y = 0; y < source.height; ++y) {
+        uint8_t* row = static_cast<uint8_t*>(destination) + static_cast<size_t>(y) * destination_row_pitch;
+        const size_t first_pixel = static_cast<size_t>(y) * source.width;
+
+        switch (format) {
+        case TextureFormat::r8g8b8a8_unorm: {
+            // 8-bit stays in whatever encoding it was in, use an _SRGB view to get the GPU to linearize it
+            for (size_t x = 0; x < pixel_count; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    if (source.bytes_per_channel == 4 && map.source[c] >= 0) {
+                        // Straight from float, going through 16-bit first would round twice
+                        const float* pixel = static_cast<const float*>(source.pixels) + (first_pixel + x) * source.channels;
+                        row[x * 4 + c] = float_to_unorm8(pixel[map.source[c]]);
+                        continue;
+                    }
+                    const uint16_t value = fetch_unorm16(source, first_pixel + x, map.source[c]);
+                    row[x * 4 + c] = source.bytes_per_channel == 1
+                        ? static_cast<uint8_t>(value >> 8) // value is v * 257, so this gets v back exactly
+                        : static_cast<uint8_t>((value * 255u + 32767u) / 65535u);
+                }
+            }
+            break;
+        }
+        case TextureFormat::r16_unorm:
+        case TextureFormat::r16g16_unorm: {
+            const int output_channels = format == TextureFormat::r16_unorm ? 1 : 2;
+            uint16_t* output = reinterpret_cast<uint16_t*>(row);
+            for (size_t x = 0; x < pixel_count; ++x) {
+                for (int c = 0; c < output_channels; ++c) {
+                    // Take the channels as stored, so a grey + alpha heightfield gives (height, alpha)
+                    const int channel = c < source.channels ? c : map.source[c];
+                    output[x * output_channels + c] = fetch_unorm16(source, first_pixel + x, channel);
+                }
+            }
+            break;
+        }
+        case TextureFormat::r16g16b16a16_float: {
+            uint16_t* output = reinterpret_cast<uint16_t*>(row);
+            if (source.bytes_per_channel == 1) {
+                convert_row_8_bit_to_half4(source, y, srgb, output);
+            }
+            else {
+                float_row.resize(pixel_count * 4);
+                expand_row_to_float4(source, y, false, float_row.data());
+                float_to_half(float_row.data(), output, pixel_count * 4);
+            }
+            break;
+        }
+        case TextureFormat::r32g32b32a32_float: {
+            expand_row_to_float4(source, y, srgb, reinterpret_cast<float*>(row));
+            break;
+        }
+        case TextureFormat::r9g9b9e5_sharedexp: {
+            float_row.resize(pixel_count * 4);
+            expand_row_to_float4(source, y, srgb, float_row.data());
+            uint32_t* output = reinterpret_cast<uint32_t*>(row);
+            for (size_t x = 0; x < pixel_count; ++x) {
+                output[x] = float3_to_rgb9e5(float_row[x * 4 + 0], float_row[x * 4 + 1], float_row[x * 4 + 2]);
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
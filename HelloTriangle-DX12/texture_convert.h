@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "texture_loader.h"
+
+/* TEXTURE CONVERSION
+* Decoded images come out of stb_image as 8-bit, 16-bit or 32-bit float channels, with 1 to 4 channels.
+* The GPU wants something else: a specific DXGI format, usually with 4 channels, and rows aligned to
+* D3D12_TEXTURE_DATA_PITCH_ALIGNMENT (256 bytes). This converts in one pass, straight into upload memory.
+*
+* sRGB to linear is done with a 256-entry lookup table instead of calling pow() for every channel, and
+* the float to half conversion uses SSE2. The SSE2 paths produce exactly the same bits as the scalar ones.
+*/
+
+// Upload formats we can convert to. The names match the DXGI_FORMAT they are meant for.
+enum class TextureFormat : uint8_t {
+    r8g8b8a8_unorm,
+    r16_unorm,             // Heightfields
+    r16g16_unorm,          // Two-channel normal maps
+    r16g16b16a16_float,    // High precision color, normal maps with 3 channels
+    r32g32b32a32_float,
+    r9g9b9e5_sharedexp,    // HDR color, 4 bytes per pixel
+};
+
+size_t texture_format_pixel_size(TextureFormat format);
+
+// Convert a decoded image to `format`, writing rows `destination_row_pitch` bytes apart.
+// If `srgb` is set, 8-bit color channels are treated as sRGB and converted to linear for float formats.
+// Channels are expanded the same way stb_image does it: 1 channel is grey, 2 is grey + alpha, 3 is RGB,
+// and a missing alpha channel becomes 1. Formats with fewer channels take the first ones.
+bool convert_image(const DecodedImage& source, TextureFormat format, bool srgb, void* destination, size_t destination_row_pitch);
+
+// Building blocks, exposed so they can be verified against each other
+uint16_t float_to_half(float value);
+void float_to_half(const float* source, uint16_t* destination, size_t count);
+uint32_t float3_to_rgb9e5(float red, float green, float blue);
+float srgb_to_linear(uint8_t value);
+void swap_bytes_16(const uint16_t* source, uint16_t* destination, size_t count); // For big-endian data like 16-bit PNGs, can be in place
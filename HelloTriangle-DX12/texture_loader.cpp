@@ -0,0 +1,305 @@
+#include "texture_loader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "file_io.h"
+#include "texture_convert.h"
+
+/* ALLOCATION TRACKING
+* stb_image lets us replace malloc/realloc/free. We put a small header in front of every allocation that
+* remembers its size, so we can count allocations, track the peak amount of memory a decode uses, and refuse
+* allocations once a decode goes over its budget. stb_image handles a failed allocation like a corrupt file.
+*/
+
+namespace {
+    struct AllocationTracker {
+        size_t budget_bytes = SIZE_MAX;
+        size_t live_bytes = 0;
+        size_t peak_bytes = 0;
+        uint32_t allocation_count = 0;
+    };
+
+    // Each thread decodes one image at a time, so the tracker for the current decode is thread-local
+    thread_local AllocationTracker* current_tracker = nullptr;
+
+    constexpr size_t allocation_header_size = 16; // Keeps the returned pointer 16-byte aligned for SSE2
+
+    void* tracked_malloc(const size_t size) {
+        AllocationTracker* tracker = current_tracker;
+        if (tracker && size > tracker->budget_bytes - tracker->live_bytes) {
+            return nullptr;
+        }
+        if (size > SIZE_MAX - allocation_header_size) {
+            return nullptr;
+        }
+
+        auto* block = static_cast<uint8_t*>(malloc(size + allocation_header_size));
+        if (!block) {
+            return nullptr;
+        }
+        memcpy(block, &size, sizeof(size));
+
+        if (tracker) {
+            tracker->live_bytes += size;
+            tracker->allocation_count++;
+            if (tracker->live_bytes > tracker->peak_bytes) {
+                tracker->peak_bytes = tracker->live_bytes;
+            }
+        }
+        return block + allocation_header_size;
+    }
+
+    size_t tracked_size(void* pointer) {
+        size_t size;
+        memcpy(&size, static_cast<uint8_t*>(pointer) - allocation_header_size, sizeof(size));
+        return size;
+    }
+
+    void tracked_free(void* pointer) {
+        if (!pointer) {
+            return;
+        }
+        if (AllocationTracker* tracker = current_tracker) {
+            const size_t size = tracked_size(pointer);
+            tracker->live_bytes -= (size < tracker->live_bytes) ? size : tracker->live_bytes;
+        }
+        free(static_cast<uint8_t*>(pointer) - allocation_header_size);
+    }
+
+    void* tracked_realloc(void* pointer, const size_t new_size) {
+        if (!pointer) {
+            return tracked_malloc(new_size);
+        }
+
+        // Growing a block only adds the difference to the live bytes, and it's still one allocation.
+        // live_bytes never goes over the budget, so the subtraction can't wrap.
+        AllocationTracker* tracker = current_tracker;
+        const size_t old_size = tracked_size(pointer);
+        if (tracker && new_size > old_size && new_size - old_size > tracker->budget_bytes - tracker->live_bytes) {
+            return nullptr;
+        }
+        if (new_size > SIZE_MAX - allocation_header_size) {
+            return nullptr;
+        }
+
+        auto* block = static_cast<uint8_t*>(realloc(static_cast<uint8_t*>(pointer) - allocation_header_size, new_size + allocation_header_size));
+        if (!block) {
+            return nullptr;
+        }
+        memcpy(block, &new_size, sizeof(new_size));
+
+        if (tracker) {
+            if (new_size > old_size) {
+                tracker->live_bytes += new_size - old_size;
+            }
+            else {
+                const size_t freed = old_size - new_size;
+                tracker->live_bytes -= (freed < tracker->live_bytes) ? freed : tracker->live_bytes;
+            }
+            if (tracker->live_bytes > tracker->peak_bytes) {
+                tracker->peak_bytes = tracker->live_bytes;
+            }
+        }
+        return block + allocation_header_size;
+    }
+}
+
+// Images are decoded on several threads at once, so every thread needs its own failure reason
+#define STBI_THREAD_LOCAL thread_local
+#define STBI_MALLOC(size) tracked_malloc(size)
+#define STBI_REALLOC(pointer, new_size) tracked_realloc(pointer, new_size)
+#define STBI_FREE(pointer) tracked_free(pointer)
+// 16-bit PNGs are big-endian, we only run on little-endian CPUs so they always need the swap, which is SIMD in here
+#define STBI_SWAP_BYTES_16(pixels, count) swap_bytes_16(pixels, pixels, count)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+namespace {
+    std::mutex decode_totals_mutex;
+    DecodeFormatTotals decode_totals[static_cast<size_t>(ImageFormat::count)];
+
+    void add_to_totals(const DecodeStats& stats, const bool success) {
+        std::lock_guard<std::mutex> lock(decode_totals_mutex);
+        DecodeFormatTotals& totals = decode_totals[static_cast<size_t>(stats.format)];
+        totals.decode_count++;
+        totals.failure_count += success ? 0 : 1;
+        totals.encoded_bytes += stats.encoded_bytes;
+        totals.decoded_bytes += stats.decoded_bytes;
+        totals.decode_seconds += stats.decode_seconds;
+        totals.allocation_count += stats.allocation_count;
+        if (stats.peak_allocated_bytes > totals.peak_allocated_bytes) {
+            totals.peak_allocated_bytes = stats.peak_allocated_bytes;
+        }
+    }
+
+    bool starts_with(const uint8_t* data, const size_t size, const char* magic, const size_t magic_size) {
+        return size >= magic_size && memcmp(data, magic, magic_size) == 0;
+    }
+}
+
+ImageFormat detect_image_format(const uint8_t* data, const size_t size) {
+    if (starts_with(data, size, "\x89PNG\r\n\x1a\n", 8)) return ImageFormat::png;
+    if (starts_with(data, size, "\xff\xd8\xff", 3)) return ImageFormat::jpeg;
+    if (starts_with(data, size, "#?RADIANCE\n", 11) || starts_with(data, size, "#?RGBE\n", 7)) return ImageFormat::hdr;
+    if (starts_with(data, size, "GIF87a", 6) || starts_with(data, size, "GIF89a", 6)) return ImageFormat::gif;
+    if (starts_with(data, size, "BM", 2)) return ImageFormat::bmp;
+    if (starts_with(data, size, "8BPS", 4)) return ImageFormat::psd;
+    if (starts_with(data, size, "\x53\x80\xf6\x34", 4)) return ImageFormat::pic;
+    if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) return ImageFormat::pnm;
+
+    // TGA has no magic number, so check the image type field in the header instead
+    if (size >= 18) {
+        const uint8_t image_type = data[2];
+        if (image_type == 1 || image_type == 2 || image_type == 3 || image_type == 9 || image_type == 10 || image_type == 11) {
+            return ImageFormat::tga;
+        }
+    }
+    return ImageFormat::unknown;
+}
+
+const char* image_format_name(const ImageFormat format) {
+    switch (format) {
+    case ImageFormat::png:  return "PNG";
+    case ImageFormat::jpeg: return "JPEG";
+    case ImageFormat::hdr:  return "HDR";
+    case ImageFormat::tga:  return "TGA";
+    case ImageFormat::bmp:  return "BMP";
+    case ImageFormat::gif:  return "GIF";
+    case ImageFormat::psd:  return "PSD";
+    case ImageFormat::pic:  return "PIC";
+    case ImageFormat::pnm:  return "PNM";
+    default:                return "unknown";
+    }
+}
+
+bool decode_image(const uint8_t* data, const size_t size, const int desired_channels, DecodedImage& image, DecodeStats* stats,
+                  const DecodeLimits& limits, const bool as_16_bit, const bool as_float) {
+    DecodeStats local_stats;
+    DecodeStats& out_stats = stats ? *stats : local_stats;
+    out_stats = {};
+    out_stats.format = detect_image_format(data, size);
+    out_stats.encoded_bytes = size;
+    image = {};
+
+    // stb_image takes an int for the size
+    if (size == 0 || size > INT32_MAX) {
+        add_to_totals(out_stats, false);
+        return false;
+    }
+
+    // Check the header first, so we don't start decoding an image we're going to reject anyway
+    int width = 0;
+    int height = 0;
+    int channels_in_file = 0;
+    if (!stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels_in_file)) {
+        printf("[ERROR] Failed to read image header: %s\n", stbi_failure_reason());
+        add_to_totals(out_stats, false);
+        return false;
+    }
+    if (width <= 0 || height <= 0 || static_cast<uint32_t>(width) > limits.max_width || static_cast<uint32_t>(height) > limits.max_height) {
+        printf("[ERROR] Image is %ix%i, which is over the %ux%u limit\n", width, height, limits.max_width, limits.max_height);
+        add_to_totals(out_stats, false);
+        return false;
+    }
+
+    // Decode with allocation tracking
+    AllocationTracker tracker;
+    tracker.budget_bytes = limits.max_allocated_bytes;
+    AllocationTracker* previous_tracker = current_tracker;
+    current_tracker = &tracker;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    void* pixels;
+    if (as_float) {
+        pixels = stbi_loadf_from_memory(data, static_cast<int>(size), &width, &height, &channels_in_file, desired_channels);
+    }
+    else if (as_16_bit) {
+        pixels = stbi_load_16_from_memory(data, static_cast<int>(size), &width, &height, &channels_in_file, desired_channels);
+    }
+    else {
+        pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels_in_file, desired_channels);
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    current_tracker = previous_tracker;
+
+    out_stats.decode_seconds = std::chrono::duration<double, std::ratio<1, 1>>(end - start).count();
+    out_stats.allocation_count = tracker.allocation_count;
+    out_stats.peak_allocated_bytes = tracker.peak_bytes;
+
+    if (!pixels) {
+        printf("[ERROR] Failed to decode %s image: %s\n", image_format_name(out_stats.format), stbi_failure_reason());
+        add_to_totals(out_stats, false);
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.channels = desired_channels ? desired_channels : channels_in_file;
+    image.bytes_per_channel = as_float ? 4 : (as_16_bit ? 2 : 1);
+    image.pixels = pixels;
+    out_stats.decoded_bytes = static_cast<size_t>(width) * height * image.channels * image.bytes_per_channel;
+    add_to_totals(out_stats, true);
+    return true;
+}
+
+bool decode_image_full_precision(const uint8_t* data, const size_t size, DecodedImage& image, DecodeStats* stats, const DecodeLimits& limits) {
+    const int size_int = size > INT32_MAX ? INT32_MAX : static_cast<int>(size);
+    const bool is_hdr = stbi_is_hdr_from_memory(data, size_int) != 0;
+    const bool is_16_bit = !is_hdr && stbi_is_16_bit_from_memory(data, size_int) != 0;
+    return decode_image(data, size, 0, image, stats, limits, is_16_bit, is_hdr);
+}
+
+bool load_image(const std::string& path, const int desired_channels, DecodedImage& image, DecodeStats* stats, const DecodeLimits& limits) {
+    size_t size = 0;
+    char* data = nullptr;
+    read_file(path, size, data, false);
+    if (!data) {
+        image = {};
+        return false;
+    }
+
+    const bool success = decode_image(reinterpret_cast<const uint8_t*>(data), size, desired_channels, image, stats, limits);
+    free(data);
+    return success;
+}
+
+void free_image(DecodedImage& image) {
+    // The pixels were allocated through the tracked allocator, so they have to be freed through it too
+    stbi_image_free(image.pixels);
+    image = {};
+}
+
+DecodeFormatTotals get_decode_totals(const ImageFormat format) {
+    std::lock_guard<std::mutex> lock(decode_totals_mutex);
+    return decode_totals[static_cast<size_t>(format)];
+}
+
+void reset_decode_totals() {
+    std::lock_guard<std::mutex> lock(decode_totals_mutex);
+    for (auto& totals : decode_totals) {
+        totals = {};
+    }
+}
+
+void print_decode_report() {
+    printf("format   decodes  failed    MB/s  allocs/decode  peak MB\n");
+    for (size_t i = 0; i < static_cast<size_t>(ImageFormat::count); ++i) {
+        const DecodeFormatTotals totals = get_decode_totals(static_cast<ImageFormat>(i));
+        if (totals.decode_count == 0) {
+            continue;
+        }
+        const double megabytes = static_cast<double>(totals.decoded_bytes) / (1024.0 * 1024.0);
+        const double megabytes_per_second = totals.decode_seconds > 0.0 ? megabytes / totals.decode_seconds : 0.0;
+        printf("%-8s %7u %7u %7.1f %14.1f %8.2f\n",
+            image_format_name(static_cast<ImageFormat>(i)),
+            totals.decode_count,
+            totals.failure_count,
+            megabytes_per_second,
+            static_cast<double>(totals.allocation_count) / totals.decode_count,
+            static_cast<double>(totals.peak_allocated_bytes) / (1024.0 * 1024.0));
+    }
+}
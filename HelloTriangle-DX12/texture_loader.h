@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/* TEXTURE LOADER
+* Images are decoded on the CPU with stb_image, which supports PNG, JPEG, HDR, TGA, BMP, GIF, PSD, PIC and PNM.
+* Every decode goes through here so we can measure how fast each format decodes, how many allocations it does,
+* and so a malformed or huge file can't make us allocate gigabytes before we find out it's broken.
+*/
+
+enum class ImageFormat : uint8_t {
+    unknown,
+    png,
+    jpeg,
+    hdr,
+    tga,
+    bmp,
+    gif,
+    psd,
+    pic,
+    pnm,
+    count,
+};
+
+// Limits that are checked before and during decoding
+struct DecodeLimits {
+    uint32_t max_width = 16384;
+    uint32_t max_height = 16384;
+    size_t max_allocated_bytes = 512ull * 1024 * 1024; // Total live bytes stb_image may allocate for one decode
+};
+
+// Measurements for a single decode
+struct DecodeStats {
+    ImageFormat format = ImageFormat::unknown;
+    size_t encoded_bytes = 0;
+    size_t decoded_bytes = 0;
+    double decode_seconds = 0.0;
+    uint32_t allocation_count = 0;
+    size_t peak_allocated_bytes = 0;
+};
+
+// A decoded image. Pixels are tightly packed, with `channels` components of `bytes_per_channel` bytes each.
+// 1 byte per channel means 8-bit unorm, 2 means 16-bit unorm, 4 means 32-bit float.
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    int bytes_per_channel = 0;
+    void* pixels = nullptr;
+};
+
+// Guess the file format from the first few bytes of the file
+ImageFormat detect_image_format(const uint8_t* data, size_t size);
+const char* image_format_name(ImageFormat format);
+
+// Decode an image from memory. desired_channels can be 0 to keep the channel count of the file.
+// If `as_16_bit` is set, the image is decoded as 16-bit unorm, and if `as_float` is set, as 32-bit float.
+// Returns false if the image could not be decoded or exceeded the limits. The stats are filled in either way.
+bool decode_image(const uint8_t* data, size_t size, int desired_channels, DecodedImage& image, DecodeStats* stats = nullptr,
+                  const DecodeLimits& limits = {}, bool as_16_bit = false, bool as_float = false);
+
+// Decode an image at the highest precision the file has: HDR files as float, 16-bit PNG/PSD/PNM as 16-bit,
+// everything else as 8-bit. The channel count of the file is kept, so stb_image doesn't run its own
+// conversion loops. Use convert_image() from texture_convert.h to get it into an upload format.
+bool decode_image_full_precision(const uint8_t* data, size_t size, DecodedImage& image, DecodeStats* stats = nullptr,
+                                 const DecodeLimits& limits = {});
+bool load_image(const std::string& path, int desired_channels, DecodedImage& image, DecodeStats* stats = nullptr,
+                const DecodeLimits& limits = {});
+void free_image(DecodedImage& image);
+
+/* DECODE REPORT
+* Every decode_image() call adds its stats to a per-format total, so after loading a scene we can see
+* which formats are slow (MB/s of decoded output) and which ones allocate a lot.
+*/
+struct DecodeFormatTotals {
+    uint32_t decode_count = 0;
+    uint32_t failure_count = 0;
+    size_t encoded_bytes = 0;
+    size_t decoded_bytes = 0;
+    double decode_seconds = 0.0;
+    uint64_t allocation_count = 0;
+    size_t peak_allocated_bytes = 0;
+};
+
+DecodeFormatTotals get_decode_totals(ImageFormat format);
+void reset_decode_totals();
+void print_decode_report();
@@ -0,0 +1,93 @@
+#include "tile_binner.h"
+
+#include <algorithm>
+
+void TileBinArena::reset(const uint32_t tile_count) {
+    used_chunks = 0;
+    heads.assign(tile_count, UINT32_MAX);
+    tails.assign(tile_count, UINT32_MAX);
+}
+
+uint32_t TileBinArena::new_chunk(const uint32_t tile) {
+    // Reuse the chunks from earlier frames before growing the arena
+    if (used_chunks == chunks.size()) {
+        chunks.emplace_back();
+    }
+    const uint32_t chunk = static_cast<uint32_t>(used_chunks++);
+    chunks[chunk].count = 0;
+    chunks[chunk].next = UINT32_MAX;
+
+    if (tails[tile] == UINT32_MAX) {
+        heads[tile] = chunk;
+    }
+    else {
+        chunks[tails[tile]].next = chunk;
+    }
+    tails[tile] = chunk;
+    return chunk;
+}
+
+void merge_tile_bins(const std::vector<TileBinArena>& arenas, const uint32_t tile, std::vector<BinReference>& merged) {
+    merged.clear();
+
+    // A read position in every arena that has something in this tile
+    struct Cursor {
+        uint32_t arena;
+        uint32_t chunk;
+        uint32_t index;
+    };
+    Cursor cursors[64];
+    std::vector<Cursor> overflow_cursors;
+    Cursor* active = cursors;
+    uint32_t active_count = 0;
+    if (arenas.size() > 64) {
+        overflow_cursors.resize(arenas.size());
+        active = overflow_cursors.data();
+    }
+    for (uint32_t i = 0; i < arenas.size(); ++i) {
+        if (!arenas[i].empty(tile)) {
+            active[active_count++] = Cursor{ i, arenas[i].heads[tile], 0 };
+        }
+    }
+
+    // Most tiles only have triangles from one thread, which is just a copy
+    if (active_count == 1) {
+        const TileBinArena& arena = arenas[active[0].arena];
+        for (uint32_t chunk = arena.heads[tile]; chunk != UINT32_MAX; chunk = arena.chunks[chunk].next) {
+            for (uint32_t i = 0; i < arena.chunks[chunk].count; ++i) {
+                merged.push_back(BinReference{ active[0].arena, arena.chunks[chunk].entries[i].payload });
+            }
+        }
+        return;
+    }
+
+    // Otherwise repeatedly take the smallest sequence number. Every list is sorted, so this is a k-way merge.
+    while (active_count > 0) {
+        uint32_t best = 0;
+        uint32_t best_sequence = UINT32_MAX;
+        for (uint32_t i = 0; i < active_count; ++i) {
+            const Cursor& cursor = active[i];
+            const uint32_t sequence = arenas[cursor.arena].chunks[cursor.chunk].entries[cursor.index].sequence;
+            if (sequence < best_sequence) {
+                best = i;
+                best_sequence = sequence;
+            }
+        }
+
+        // Take all entries with that sequence number from the list, so split up triangles stay together
+        Cursor& cursor = active[best];
+        const TileBinArena& arena = arenas[cursor.arena];
+        bool exhausted = false;
+        while (!exhausted && arena.chunks[cursor.chunk].entries[cursor.index].sequence == best_sequence) {
+            merged.push_back(BinReference{ cursor.arena, arena.chunks[cursor.chunk].entries[cursor.index].payload });
+            if (++cursor.index == arena.chunks[cursor.chunk].count) {
+                cursor.index = 0;
+                cursor.chunk = arena.chunks[cursor.chunk].next;
+                exhausted = cursor.chunk == UINT32_MAX;
+            }
+        }
+        if (exhausted) {
+            active[best] = active[--active_count];
+        }
+    }
+}
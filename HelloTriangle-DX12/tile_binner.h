@@ -0,0 +1,73 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* TILE BINNING
+* A multithreaded rasterizer first sorts the triangles into screen tiles ("bins"), so every tile can then be
+* rasterized by one thread without any locking. If all threads appended to shared per-tile lists, every append
+* would need a lock or an atomic, and the threads would keep fighting over the same cache lines.
+*
+* Instead every thread gets its own arena, with its own list per tile. The lists are made of fixed-size
+* chunks that are allocated from the arena, so appending is just a store and an increment. The arenas keep
+* their chunks between frames, so after the first frame nothing gets allocated anymore.
+*
+* Every entry has a sequence number (the triangle's position in the draw). A thread always bins its
+* triangles in increasing order, so each per-thread list is sorted, and merging the lists of all threads by
+* sequence number gives the tile's triangles in the order they were submitted, no matter how many threads
+* there were or how the work was split between them.
+*/
+
+constexpr uint32_t bin_chunk_entries = 63;
+
+struct BinEntry {
+    uint32_t sequence = 0;  // Submission order, used to merge the threads' lists
+    uint32_t payload = 0;   // Whatever the user wants to store, e.g. an index into a per-thread array
+};
+
+// A merged entry, with the index of the arena it came from
+struct BinReference {
+    uint32_t arena = 0;
+    uint32_t payload = 0;
+};
+
+class TileBinArena {
+public:
+    // Empties all lists, keeps the memory
+    void reset(uint32_t tile_count);
+
+    // Entries of a tile have to be appended in increasing sequence order, merge_tile_bins() depends on it
+    void append(const uint32_t tile, const BinEntry entry) {
+        uint32_t chunk = tails[tile];
+        assert(chunk == UINT32_MAX || chunks[chunk].entries[chunks[chunk].count - 1].sequence <= entry.sequence);
+        if (chunk == UINT32_MAX || chunks[chunk].count == bin_chunk_entries) {
+            chunk = new_chunk(tile);
+        }
+        Chunk& target = chunks[chunk];
+        target.entries[target.count++] = entry;
+    }
+
+    bool empty(const uint32_t tile) const { return heads[tile] == UINT32_MAX; }
+    size_t chunk_count() const { return used_chunks; }
+
+private:
+    friend void merge_tile_bins(const std::vector<TileBinArena>& arenas, uint32_t tile, std::vector<BinReference>& merged);
+
+    struct Chunk {
+        BinEntry entries[bin_chunk_entries];
+        uint32_t count = 0;
+        uint32_t next = UINT32_MAX;
+    };
+
+    uint32_t new_chunk(uint32_t tile);
+
+    std::vector<Chunk> chunks;
+    size_t used_chunks = 0;
+    std::vector<uint32_t> heads;
+    std::vector<uint32_t> tails;
+};
+
+// Merge one tile's lists from all arenas, in submission order. Entries with the same sequence number stay in the
+// order they were appended in. Only correct if every list is sorted, which append() asserts.
+void merge_tile_bins(const std::vector<TileBinArena>& arenas, uint32_t tile, std::vector<BinReference>& merged);
@@ -0,0 +1,41 @@
+#include "upload_ring.h"
+#include <algorithm>
+
+UploadRing::UploadRing(const uint64_t size) : capacity(size) {
+}
+
+uint64_t UploadRing::allocate(const uint64_t size, const uint64_t alignment) {
+    // Nothing is in use, so start over at the start of the buffer, and have all of it
+    if (head == tail) {
+        head = tail = (head + capacity - 1) / capacity * capacity;
+    }
+    uint64_t start = (head + alignment - 1) & ~(alignment - 1);
+
+    // Allocations don't wrap around, the rest of the buffer is skipped instead
+    if (start % capacity + size > capacity) {
+        start = (start / capacity + 1) * capacity;
+    }
+    if (size > capacity || start + size - tail > capacity) {
+        statistics.failed_allocations++;
+        return invalid_offset;
+    }
+    head = start + size;
+    statistics.allocated_bytes += size;
+    statistics.peak_used = std::max(statistics.peak_used, used());
+    return start % capacity;
+}
+
+void UploadRing::finish_frame(const uint64_t fence_value) {
+    // A frame that didn't allocate anything doesn't hold on to anything
+    if (head == (frames.empty() ? tail : frames.back().end)) {
+        return;
+    }
+    frames.push_back({ fence_value, head });
+}
+
+void UploadRing::retire(const uint64_t completed_fence_value) {
+    while (!frames.empty() && frames.front().fence_value <= completed_fence_value) {
+        tail = frames.front().end;
+        frames.pop_front();
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+/* UPLOAD RING
+* Data that changes every frame, like particle billboards, is written into one big upload buffer that stays mapped,
+* used as a ring: what a frame allocates comes right after what the frame before it allocated, and wraps around to
+* the start when it doesn't fit at the end anymore. Once a frame is recorded, finish_frame() tags everything since
+* the last call with the fence value the GPU will signal when it's done with the frame, and retire() frees that
+* space again once the fence has passed it. If the GPU is so far behind that there's no room, allocate() fails
+* instead of waiting, and the caller can draw less or skip it for a frame.
+*
+* Like the DeferredReleaseQueue, it only hands out offsets and compares fence values, so it doesn't know about
+* D3D12, and it isn't thread safe, it belongs to the thread that records the frames.
+*/
+
+struct UploadRingStats {
+    uint64_t allocated_bytes = 0;
+    uint64_t failed_allocations = 0;
+    uint64_t peak_used = 0;             // Including the space skipped when wrapping around
+};
+
+class UploadRing {
+public:
+    static constexpr uint64_t invalid_offset = UINT64_MAX;
+
+    // `size` has to be a multiple of every alignment that's asked for
+    explicit UploadRing(uint64_t size);
+
+    // Returns the offset of `size` bytes, aligned to `alignment` (a power of two), or invalid_offset if there's no room
+    uint64_t allocate(uint64_t size, uint64_t alignment);
+
+    // Everything allocated since the last call is in use until the fence reaches fence_value
+    void finish_frame(uint64_t fence_value);
+
+    // Frees the space of the frames whose fence value has been reached
+    void retire(uint64_t completed_fence_value);
+
+    uint64_t size() const { return capacity; }
+    uint64_t used() const { return head - tail; }
+    const UploadRingStats& stats() const { return statistics; }
+
+private:
+    struct Frame {
+        uint64_t fence_value = 0;
+        uint64_t end = 0;               // Where `head` was when the frame finished
+    };
+
+    // Both only ever increase, the offset in the buffer is the position modulo the size
+    uint64_t capacity = 0;
+    uint64_t head = 0;                  // Where the next allocation starts looking
+    uint64_t tail = 0;                  // The start of the oldest frame the GPU might still read
+    std::deque<Frame> frames;           // In fence order
+    UploadRingStats statistics;
+};
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "file_io.h"
+#include "mesh_codec.h"
+#include "mesh_cooker.h"
+#include "mesh_importer.h"
+
+/* MESH COOKER TOOL
+* Cooks a mesh file (see mesh_format.h) for the renderer to load.
+* Usage: MeshCooker <output.mesh> <input.gltf|input.glb|input.obj> [--uncompressed]
+*        MeshCooker <output.mesh> --triangle [--uncompressed]
+*        MeshCooker <output.mesh> --sphere <segments> [--uncompressed]
+* Imported scenes are flattened into one mesh, with every instance's transform baked in.
+* Files are compressed (see mesh_codec.h) unless --uncompressed is given.
+*/
+
+namespace {
+    const char* section_name(const MeshSectionType type) {
+        switch (type) {
+            case MeshSectionType::vertex_stream: return "vertex stream";
+            case MeshSectionType::indices: return "indices";
+            case MeshSectionType::meshlets: return "meshlets";
+            case MeshSectionType::meshlet_vertices: return "meshlet vertices";
+            case MeshSectionType::meshlet_triangles: return "meshlet triangles";
+            case MeshSectionType::bounds: return "bounds";
+            case MeshSectionType::lods: return "LODs";
+            case MeshSectionType::meshlet_bounds: return "meshlet bounds";
+        }
+        return "unknown";
+    }
+
+    // The triangle the renderer draws when it's not given a mesh
+    MeshSource make_triangle() {
+        MeshSource mesh;
+        mesh.positions = { {+0.5f, -0.5f, 0.f}, {-0.5f, -0.5f, 0.f}, {0.0f, +0.5f, 0.f} };
+        mesh.colors = { {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f} };
+        mesh.indices = { 0, 1, 2 };
+        return mesh;
+    }
+
+    // A UV sphere with a radius of 0.5, colored by its normals
+    MeshSource make_sphere(const uint32_t segments) {
+        MeshSource mesh;
+        const uint32_t rings = segments / 2;
+        for (uint32_t ring = 0; ring <= rings; ++ring) {
+            const float theta = 3.141593f * static_cast<float>(ring) / static_cast<float>(rings);
+            for (uint32_t segment = 0; segment <= segments; ++segment) {
+                const float phi = 2.0f * 3.141593f * static_cast<float>(segment) / static_cast<float>(segments);
+                const glm::vec3 normal(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+                mesh.positions.push_back(normal * 0.5f);
+                mesh.normals.push_back(normal);
+                mesh.colors.push_back(normal * 0.5f + 0.5f);
+                mesh.texcoords.emplace_back(static_cast<float>(segment) / static_cast<float>(segments), static_cast<float>(ring) / static_cast<float>(rings));
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ++ring) {
+            for (uint32_t segment = 0; segment < segments; ++segment) {
+                const uint32_t a = ring * (segments + 1) + segment;
+                const uint32_t b = a + segments + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+            }
+        }
+        return mesh;
+    }
+}
+
+int main(const int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: MeshCooker <output.mesh> <input.gltf|input.glb|input.obj> [--uncompressed]\n");
+        printf("       MeshCooker <output.mesh> --triangle [--uncompressed]\n");
+        printf("       MeshCooker <output.mesh> --sphere <segments> [--uncompressed]\n");
+        return 1;
+    }
+    const std::string output_path = argv[1];
+    MeshSource source;
+    if (strcmp(argv[2], "--triangle") == 0) {
+        source = make_triangle();
+    }
+    else if (strcmp(argv[2], "--sphere") == 0 && argc > 3) {
+        source = make_sphere(std::max(3u, static_cast<uint32_t>(strtoul(argv[3], nullptr, 10))));
+    }
+    else if (argv[2][0] != '-') {
+        ImportedScene scene;
+        ImportStats stats;
+        if (!import_scene(argv[2], scene, &stats)) {
+            return 1;
+        }
+        printf("%s: %zu meshes, %zu instances, %zu vertices, %zu triangles, imported in %.1f ms (%.1f MB/s)\n", argv[2],
+               scene.meshes.size(), scene.instances.size(), stats.vertex_count, stats.triangle_count, stats.import_seconds * 1000.0,
+               static_cast<double>(stats.input_bytes) / (1024.0 * 1024.0) / std::max(stats.import_seconds, 1e-9));
+        flatten_scene(scene, source);
+    }
+    else {
+        printf("[ERROR] Unknown input '%s'\n", argv[2]);
+        return 1;
+    }
+
+    MeshCookSettings settings;
+    settings.compress = strcmp(argv[argc - 1], "--uncompressed") != 0;
+    std::vector<uint8_t> file;
+    if (!cook_mesh(source, settings, file) || !write_file(output_path, file.data(), file.size(), false)) {
+        return 1;
+    }
+
+    // Print what ended up in the file
+    MeshView view;
+    if (!open_mesh_view(file.data(), file.size(), view)) {
+        return 1;
+    }
+    printf("%s: %u vertices, %zu bytes, %llu bytes decoded\n", output_path.c_str(), view.header->vertex_count, file.size(),
+           static_cast<unsigned long long>(view.header->upload_size));
+    for (uint32_t i = 0; i < view.header->section_count; ++i) {
+        const MeshSectionHeader& section = view.sections[i];
+        if (section.encoding != MeshSectionEncoding::none) {
+            printf("    %s: %llu -> %llu bytes, %.2f:1\n", section_name(section.type),
+                   static_cast<unsigned long long>(section.size), static_cast<unsigned long long>(section.file_size),
+                   static_cast<double>(section.size) / static_cast<double>(section.file_size));
+        }
+    }
+
+    // How fast the renderer can get it into upload memory, the best of a few runs
+    std::vector<uint8_t> upload(static_cast<size_t>(view.header->upload_size));
+    double best_seconds = INFINITY;
+    for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        if (!copy_mesh_sections(view, upload.data())) {
+            return 1;
+        }
+        best_seconds = std::min(best_seconds, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    printf("    Decoded in %.2f ms (%.2f GB/s of decoded data)\n", best_seconds * 1000.0,
+           static_cast<double>(view.header->upload_size) / 1e9 / std::max(best_seconds, 1e-9));
+    const MeshLod* lods = view.section_data<MeshLod>(*view.find_section(MeshSectionType::lods));
+    const MeshSectionHeader* meshlets_section = view.find_section(MeshSectionType::meshlets);
+    const MeshSectionHeader* bounds_section = view.find_section(MeshSectionType::meshlet_bounds);
+    for (uint32_t i = 0; i < view.header->lod_count; ++i) {
+        printf("    LOD %u: %u triangles, %u meshlets, error %g\n", i, lods[i].index_count / 3, lods[i].meshlet_count, lods[i].error);
+        if (lods[i].meshlet_count == 0 || !meshlets_section || !bounds_section) {
+            continue;
+        }
+        // How full the meshlets are, and how many have a normal cone that can cull them
+        const MeshletDesc* meshlets = view.section_data<MeshletDesc>(*meshlets_section) + lods[i].first_meshlet;
+        const MeshletBounds* bounds = view.section_data<MeshletBounds>(*bounds_section) + lods[i].first_meshlet;
+        uint64_t vertices = 0;
+        uint32_t cones = 0;
+        for (uint32_t j = 0; j < lods[i].meshlet_count; ++j) {
+            vertices += meshlets[j].vertex_count;
+            cones += bounds[j].cone_cutoff < 127 ? 1 : 0;
+        }
+        printf("        %.1f triangles and %.1f vertices per meshlet, %.1f%% have a usable normal cone\n",
+               static_cast<double>(lods[i].index_count / 3) / lods[i].meshlet_count, static_cast<double>(vertices) / lods[i].meshlet_count,
+               100.0 * cones / lods[i].meshlet_count);
+    }
+    return 0;
+}
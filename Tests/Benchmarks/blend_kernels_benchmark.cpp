@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "blend_kernels.h"
+
+/* BLEND KERNELS BENCHMARK
+* The blend function select_blend_function() picks, 8 pixels at a time, against blend_pixel(), the scalar version that
+* does one pixel at a time and switches on the whole blend state for every pixel. For every render target format and
+* the kinds of blending that have their own kernel: opaque, alpha, premultiplied alpha, additive, the general case and
+* a logic op. Prints Mpixels/s of each, the best of at least 3 passes over the buffer, and the speedup.
+* Usage: blend_kernels_benchmark [pixel count]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    template <typename Work>
+    double best_time(const Work& work) {
+        double best = 1e30;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.25; ++run) {
+            const auto run_start = high_resolution_clock::now();
+            work();
+            best = std::min(best, duration<double>(high_resolution_clock::now() - run_start).count());
+        }
+        return best;
+    }
+
+    SoftwareBlendState make_blend(const BlendFactor src, const BlendFactor dest, const BlendOp op) {
+        SoftwareBlendState state;
+        state.blend_enable = true;
+        state.src_blend = state.src_blend_alpha = src;
+        state.dest_blend = state.dest_blend_alpha = dest;
+        state.blend_op = state.blend_op_alpha = op;
+        return state;
+    }
+}
+
+int main(const int argc, char** argv) {
+    const size_t pixel_count = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 1 << 20) / shader_lane_count * shader_lane_count;
+
+    // Shader outputs for a few batches, used over and over, in [0, 1] with some out of range
+    constexpr uint32_t source_batches = 64;
+    static float sources[source_batches][4][shader_lane_count];
+    uint32_t seed = 1;
+    for (auto& batch : sources) {
+        for (auto& channel : batch) {
+            for (float& value : channel) {
+                seed = seed * 1664525u + 1013904223u;
+                value = static_cast<float>(seed >> 8) / 16777216.0f * 1.2f - 0.1f;
+            }
+        }
+    }
+    const float blend_factor[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+
+    struct Blend {
+        const char* name;
+        SoftwareBlendState state;
+    };
+    SoftwareBlendState logic_op;
+    logic_op.logic_op_enable = true;
+    logic_op.logic_op = LogicOp::xor_;
+    const Blend blends[] = {
+        { "opaque", SoftwareBlendState{} },
+        { "alpha", make_blend(BlendFactor::src_alpha, BlendFactor::inv_src_alpha, BlendOp::add) },
+        { "premultiplied", make_blend(BlendFactor::one, BlendFactor::inv_src_alpha, BlendOp::add) },
+        { "additive", make_blend(BlendFactor::one, BlendFactor::one, BlendOp::add) },
+        { "general", make_blend(BlendFactor::dest_color, BlendFactor::inv_blend_factor, BlendOp::rev_subtract) },
+        { "logic op xor", logic_op },
+    };
+    struct Format {
+        const char* name;
+        RenderTargetFormat format;
+    };
+    const Format formats[] = {
+        { "RGBA8", RenderTargetFormat::r8g8b8a8_unorm }, { "RGBA8 sRGB", RenderTargetFormat::r8g8b8a8_unorm_srgb },
+        { "RGB10A2", RenderTargetFormat::r10g10b10a2_unorm }, { "RG11B10F", RenderTargetFormat::r11g11b10_float },
+        { "RGBA16F", RenderTargetFormat::r16g16b16a16_float },
+    };
+
+    printf("%zu pixels\n", pixel_count);
+    printf("format      blend           8-wide Mpx/s  scalar Mpx/s  speedup\n");
+    std::vector<uint64_t> pixels(pixel_count);
+    for (const Format& format : formats) {
+        const size_t pixel_size = render_target_format_pixel_size(format.format);
+        for (const Blend& blend : blends) {
+            const BlendFunction function = select_blend_function(blend.state, format.format);
+            if (!function) {
+                continue;
+            }
+            // Half floats 0.5 and 1.0 with noise in the low bits, so no format sees NaNs or denormals
+            for (size_t i = 0; i < pixel_count; ++i) {
+                pixels[i] = 0x3c003800'3c003800ull ^ (i * 0x9e3779b97f4a7c15ull >> 40);
+            }
+            uint8_t* destination = reinterpret_cast<uint8_t*>(pixels.data());
+            const double wide_seconds = best_time([&]() {
+                for (size_t i = 0; i < pixel_count; i += shader_lane_count) {
+                    function(blend.state, sources[(i / shader_lane_count) % source_batches], blend_factor, 0xFF, destination + i * pixel_size);
+                }
+            });
+            const double scalar_seconds = best_time([&]() {
+                for (size_t i = 0; i < pixel_count; ++i) {
+                    const auto& batch = sources[(i / shader_lane_count) % source_batches];
+                    const uint32_t lane = static_cast<uint32_t>(i % shader_lane_count);
+                    const float source[4] = { batch[0][lane], batch[1][lane], batch[2][lane], batch[3][lane] };
+                    uint64_t pixel = 0;
+                    memcpy(&pixel, destination + i * pixel_size, pixel_size);
+                    pixel = blend_pixel(blend.state, format.format, source, blend_factor, pixel);
+                    memcpy(destination + i * pixel_size, &pixel, pixel_size);
+                }
+            });
+            printf("%-11s %-15s %12.1f %13.1f %8.1fx\n", format.name, blend.name, pixel_count / wide_seconds / 1e6,
+                   pixel_count / scalar_seconds / 1e6, scalar_seconds / wide_seconds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "command_bundle.h"
+
+/* COMMAND BUNDLE BENCHMARK
+* What a frame's draws cost on the CPU when they're recorded every frame, against building the CachedBundle key and
+* executing the bundle that was recorded once, for 1 to 10000 draws. The command lists are mocks that encode every
+* call as a packet through a virtual call, like a driver does, so this is the cost of the commands on our side and
+* a rough stand-in for the driver's, not a measurement of it. Also counts how often the bundle is recorded when the
+* pipeline state changes every 100 frames. Prints microseconds per frame, the best of at least 3 runs.
+* Usage: command_bundle_benchmark [frame count]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    template <typename Work>
+    double best_time(const Work& work) {
+        double best = 1e30;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.25; ++run) {
+            const auto run_start = high_resolution_clock::now();
+            work();
+            best = std::min(best, duration<double>(high_resolution_clock::now() - run_start).count());
+        }
+        return best;
+    }
+
+    // Stand-ins for the D3D12 structs, the same as in command_bundle_tests.cpp
+    struct VertexBufferView {
+        uint64_t location;
+        uint32_t size;
+        uint32_t stride;
+    };
+
+    struct IndexBufferView {
+        uint64_t location;
+        uint32_t size;
+        uint32_t format;
+    };
+
+    struct DrawItem {
+        uint32_t index_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t transform_index;
+    };
+
+    class CommandList {
+    public:
+        virtual ~CommandList() = default;
+        virtual void set_pipeline_state(const void* pipeline) = 0;
+        virtual void set_root_signature(const void* signature) = 0;
+        virtual void set_vertex_buffers(const VertexBufferView* views, uint32_t count) = 0;
+        virtual void set_index_buffer(const IndexBufferView& view) = 0;
+        virtual void set_root_constant(uint32_t index, uint32_t value) = 0;
+        virtual void draw_indexed(uint32_t index_count, uint32_t first_index, int32_t base_vertex) = 0;
+        virtual void execute_bundle(const CommandList& bundle) = 0;
+    };
+
+    // Every command is its opcode and arguments, appended to one buffer
+    class MockCommandList final : public CommandList {
+    public:
+        std::vector<uint64_t> packets;
+
+        void set_pipeline_state(const void* pipeline) override { packets.insert(packets.end(), { 1, reinterpret_cast<uintptr_t>(pipeline) }); }
+        void set_root_signature(const void* signature) override { packets.insert(packets.end(), { 2, reinterpret_cast<uintptr_t>(signature) }); }
+        void set_vertex_buffers(const VertexBufferView* views, const uint32_t count) override {
+            packets.insert(packets.end(), { 3, count });
+            for (uint32_t i = 0; i < count; ++i) {
+                packets.insert(packets.end(), { views[i].location, views[i].size, views[i].stride });
+            }
+        }
+        void set_index_buffer(const IndexBufferView& view) override { packets.insert(packets.end(), { 4, view.location, view.size, view.format }); }
+        void set_root_constant(const uint32_t index, const uint32_t value) override { packets.insert(packets.end(), { 5, index, value }); }
+        void draw_indexed(const uint32_t index_count, const uint32_t first_index, const int32_t base_vertex) override {
+            packets.insert(packets.end(), { 6, index_count, first_index, static_cast<uint64_t>(base_vertex) });
+        }
+        void execute_bundle(const CommandList& bundle) override { packets.insert(packets.end(), { 7, reinterpret_cast<uintptr_t>(&bundle) }); }
+    };
+
+    // Everything the draw bundle is recorded with
+    struct FrameInputs {
+        const void* pipeline_state;
+        const void* root_signature;
+        std::vector<VertexBufferView> vertex_buffers;
+        IndexBufferView index_buffer;
+        std::vector<DrawItem> draws;
+    };
+
+    // The same commands as the renderer's draw bundle
+    void record_draws(const FrameInputs& inputs, CommandList& list) {
+        list.set_pipeline_state(inputs.pipeline_state);
+        list.set_root_signature(inputs.root_signature);
+        list.set_vertex_buffers(inputs.vertex_buffers.data(), static_cast<uint32_t>(inputs.vertex_buffers.size()));
+        list.set_index_buffer(inputs.index_buffer);
+        for (const DrawItem& draw : inputs.draws) {
+            list.set_root_constant(5, draw.transform_index);
+            list.draw_indexed(draw.index_count, draw.first_index, draw.base_vertex);
+        }
+    }
+
+    // One frame the way the renderer does it: build the key, record the bundle if it changed, execute it
+    void draw_with_bundle(const FrameInputs& inputs, CachedBundle& bundle, MockCommandList& bundle_list, CommandList& frame_list) {
+        BundleKey& key = bundle.begin_key();
+        key.add_pointer(inputs.pipeline_state);
+        key.add_pointer(inputs.root_signature);
+        key.add(inputs.vertex_buffers.data(), inputs.vertex_buffers.size() * sizeof(VertexBufferView));
+        key.add_value(inputs.index_buffer);
+        key.add(inputs.draws.data(), inputs.draws.size() * sizeof(DrawItem));
+        if (bundle.needs_recording()) {
+            bundle_list.packets.clear();
+            record_draws(inputs, bundle_list);
+        }
+        frame_list.execute_bundle(bundle_list);
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t frame_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1000;
+    int pipelines[2] = {};
+    int root_signature = 0;
+
+    printf("%u frames\n", frame_count);
+    printf("draws  recorded us/frame  bundle us/frame  speedup  recordings with a new pipeline every 100 frames\n");
+    for (const uint32_t draw_count : { 1u, 100u, 1000u, 10000u }) {
+        FrameInputs inputs;
+        inputs.pipeline_state = &pipelines[0];
+        inputs.root_signature = &root_signature;
+        inputs.vertex_buffers = { { 0x10000, 1 << 20, 12 }, { 0x200000, 1 << 20, 12 } };
+        inputs.index_buffer = { 0x400000, 1 << 20, 42 };
+        for (uint32_t i = 0; i < draw_count; ++i) {
+            inputs.draws.push_back({ 36, i * 36, static_cast<int32_t>(i * 24), i });
+        }
+
+        MockCommandList frame_list;
+        const double recorded_seconds = best_time([&]() {
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frame_list.packets.clear();
+                record_draws(inputs, frame_list);
+            }
+        });
+
+        CachedBundle bundle;
+        MockCommandList bundle_list;
+        const double bundle_seconds = best_time([&]() {
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frame_list.packets.clear();
+                draw_with_bundle(inputs, bundle, bundle_list, frame_list);
+            }
+        });
+
+        const uint64_t recordings = bundle.stats().recordings;
+        for (uint32_t frame = 0; frame < frame_count; ++frame) {
+            inputs.pipeline_state = &pipelines[frame / 100 % 2];
+            frame_list.packets.clear();
+            draw_with_bundle(inputs, bundle, bundle_list, frame_list);
+        }
+        printf("%5u %18.2f %16.2f %7.1fx %48llu\n", draw_count, recorded_seconds * 1e6 / frame_count, bundle_seconds * 1e6 / frame_count,
+               recorded_seconds / bundle_seconds, static_cast<unsigned long long>(bundle.stats().recordings - recordings));
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "frame_mailbox.h"
+#include "frame_packet.h"
+
+/* FRAME MAILBOX BENCHMARK
+* The threads of the app with a null renderer, which only reads the packets.
+* - Throughput: the simulation publishes packets as fast as it can and the renderer takes them as fast as it can, for
+*   one second, through the lock-free FrameMailbox and through the same triple buffer with a mutex. Every packet has
+*   64 transforms stamped with its sequence number, so a torn or stale packet is counted.
+* - Latency: like the app, input at 240 Hz, the simulation at its fixed step, and the renderer at 60 Hz with 3 ms of
+*   recording work. Prints how old the packet and its input are when the renderer takes it.
+* Usage: frame_mailbox_benchmark [paced seconds]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    // The same triple buffer with a lock, for comparison
+    template <typename T>
+    class MutexMailbox {
+    public:
+        T& back() { return slots[0]; }
+        void publish() {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(slots[0], slots[1]);
+            fresh = true;
+        }
+        bool acquire() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!fresh) {
+                return false;
+            }
+            std::swap(slots[1], slots[2]);
+            fresh = false;
+            return true;
+        }
+        const T& front() const { return slots[2]; }
+
+    private:
+        std::mutex mutex;
+        T slots[3];
+        bool fresh = false;
+    };
+
+    constexpr size_t stamped_transforms = 64;
+
+    template <typename Mailbox>
+    void measure_throughput(const char* name) {
+        Mailbox mailbox;
+        std::atomic<bool> running{ true };
+        uint64_t published = 0;
+        std::thread simulation_thread([&]() {
+            SimulationState state;
+            const InputState input;
+            while (running.load(std::memory_order_relaxed)) {
+                FramePacket& packet = mailbox.back();
+                simulate_frame(state, input, packet);
+                packet.transforms.resize(stamped_transforms);
+                for (glm::mat4& transform : packet.transforms) {
+                    transform = glm::mat4(static_cast<float>(packet.sequence));
+                }
+                mailbox.publish();
+                published++;
+            }
+        });
+
+        uint64_t taken = 0;
+        uint64_t skipped = 0;
+        uint64_t broken = 0;
+        uint64_t last_sequence = 0;
+        const auto start = steady_clock::now();
+        while (steady_clock::now() - start < seconds(1)) {
+            if (!mailbox.acquire()) {
+                continue;
+            }
+            const FramePacket& packet = mailbox.front();
+            taken++;
+            if (packet.sequence <= last_sequence) {
+                broken++;
+                continue;
+            }
+            skipped += packet.sequence - last_sequence - 1;
+            last_sequence = packet.sequence;
+            for (const glm::mat4& transform : packet.transforms) {
+                if (transform[0][0] != static_cast<float>(packet.sequence)) {
+                    broken++;
+                    break;
+                }
+            }
+        }
+        running = false;
+        simulation_thread.join();
+        printf("%-9s %9llu packets/s published, %9llu taken, %llu skipped, %llu torn or out of order\n", name,
+               static_cast<unsigned long long>(published), static_cast<unsigned long long>(taken),
+               static_cast<unsigned long long>(skipped), static_cast<unsigned long long>(broken));
+    }
+
+    double percentile(std::vector<double> values, const double fraction) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(fraction * static_cast<double>(values.size() - 1))];
+    }
+
+    void measure_latency(const double duration_seconds) {
+        FrameMailbox<InputState> input_mailbox;
+        FrameMailbox<FramePacket> frame_mailbox;
+        std::atomic<bool> running{ true };
+        std::mutex first_packet_mutex;
+        std::condition_variable first_packet_ready;
+        bool first_packet_published = false;
+
+        std::thread simulation_thread([&]() {
+            const auto step_duration = duration_cast<FrameClock::duration>(duration<double>(simulation_step));
+            SimulationState state;
+            auto next_step = FrameClock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                input_mailbox.acquire();
+                simulate_frame(state, input_mailbox.front(), frame_mailbox.back());
+                frame_mailbox.publish();
+                if (state.step == 1) {
+                    {
+                        std::lock_guard<std::mutex> lock(first_packet_mutex);
+                        first_packet_published = true;
+                    }
+                    first_packet_ready.notify_one();
+                }
+                next_step += step_duration;
+                std::this_thread::sleep_until(next_step);
+            }
+        });
+
+        std::vector<double> packet_ages;
+        std::vector<double> input_ages;
+        uint64_t frames = 0;
+        uint64_t repeated = 0;
+        std::thread render_thread([&]() {
+            {
+                std::unique_lock<std::mutex> lock(first_packet_mutex);
+                first_packet_ready.wait(lock, [&]() { return first_packet_published || !running.load(std::memory_order_relaxed); });
+            }
+            uint64_t last_sequence = 0;
+            auto next_frame = FrameClock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                frame_mailbox.acquire();
+                const FramePacket& packet = frame_mailbox.front();
+                const auto now = FrameClock::now();
+                packet_ages.push_back(duration<double, std::milli>(now - packet.publish_time).count());
+                if (packet.input_sequence != 0) {
+                    input_ages.push_back(duration<double, std::milli>(now - packet.input_time).count());
+                }
+                repeated += packet.sequence == last_sequence ? 1 : 0;
+                last_sequence = packet.sequence;
+
+                // Recording, then vsync
+                while (FrameClock::now() - now < microseconds(3000)) {
+                }
+                frames++;
+                next_frame += microseconds(16667);
+                std::this_thread::sleep_until(next_frame);
+            }
+        });
+
+        uint64_t input_sequence = 0;
+        const auto start = FrameClock::now();
+        while (FrameClock::now() - start < duration<double>(duration_seconds)) {
+            InputState& input = input_mailbox.back();
+            input.sequence = ++input_sequence;
+            input.sample_time = FrameClock::now();
+            input_mailbox.publish();
+            std::this_thread::sleep_for(microseconds(4167));
+        }
+        {
+            std::lock_guard<std::mutex> lock(first_packet_mutex);
+            running = false;
+        }
+        first_packet_ready.notify_one();
+        simulation_thread.join();
+        render_thread.join();
+
+        printf("paced: %llu frames in %.1f s, %llu repeated a packet, packet age p50 %.2f ms p99 %.2f ms, input age p50 %.2f ms p99 %.2f ms\n",
+               static_cast<unsigned long long>(frames), duration_seconds, static_cast<unsigned long long>(repeated),
+               percentile(packet_ages, 0.5), percentile(packet_ages, 0.99), percentile(input_ages, 0.5), percentile(input_ages, 0.99));
+    }
+}
+
+int main(const int argc, char** argv) {
+    const double paced_seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    measure_throughput<FrameMailbox<FramePacket>>("lock-free");
+    measure_throughput<MutexMailbox<FramePacket>>("mutex");
+    measure_latency(paced_seconds);
+    return 0;
+}
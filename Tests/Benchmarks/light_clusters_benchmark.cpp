@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "glm/trigonometric.hpp"
+#include "light_clusters.h"
+#include "projection.h"
+
+/* LIGHT CLUSTERS BENCHMARK
+* Assigns random lights in front of the camera to the clusters of a 1920x1080 view, on one thread and on all of them,
+* and with a plain loop that tests every light against every cluster, which is what a naive CPU version would do.
+* Prints the best of 20 for each light count, and how many light/cluster pairs there are, which all three agree on.
+* 10000 lights is the case the CPU version has to be fast enough for.
+* Usage: light_clusters_benchmark [max light count]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    template <typename Function>
+    double best_milliseconds(Function&& function) {
+        double best = INFINITY;
+        for (int run = 0; run < 20; ++run) {
+            const auto start = high_resolution_clock::now();
+            function();
+            best = std::min(best, duration<double, std::milli>(high_resolution_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    // Every light against every cluster box, with the same test as assign_lights_to_clusters()
+    uint64_t count_pairs_brute_force(const ClusterGrid& grid, const std::vector<ClusterLight>& lights) {
+        uint64_t pairs = 0;
+        for (uint32_t slice = 0; slice < cluster_slices; ++slice) {
+            for (uint32_t row = 0; row < cluster_tiles_y; ++row) {
+                for (uint32_t column = 0; column < cluster_tiles_x; ++column) {
+                    const glm::vec2 z = grid.bounds.z[slice];
+                    const glm::vec2 x = grid.bounds.x[slice][column];
+                    const glm::vec2 y = grid.bounds.y[slice][row];
+                    for (const ClusterLight& light : lights) {
+                        const float dx = light.position.x - std::clamp(light.position.x, x.x, x.y);
+                        const float dy = light.position.y - std::clamp(light.position.y, y.x, y.y);
+                        const float dz = light.position.z - std::clamp(light.position.z, z.x, z.y);
+                        pairs += (dz * dz + dy * dy) + dx * dx <= light.radius * light.radius ? 1 : 0;
+                    }
+                }
+            }
+        }
+        return pairs;
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t max_light_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : max_cluster_lights;
+    constexpr float near_plane = 0.1f;
+    const glm::mat4 projection = reverse_z_infinite_perspective(glm::radians(60.0f), 16.0f / 9.0f, near_plane);
+    const ClusterGrid grid = make_cluster_grid(projection, 1920, 1080, near_plane, 100.0f);
+    const unsigned thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (const uint32_t light_count : { 256u, 1024u, 4096u, 10000u, max_cluster_lights }) {
+        if (light_count > std::min(max_light_count, max_cluster_lights)) {
+            break;
+        }
+        // Spread over the view up to 40 units away, more of them close by like in a scene
+        std::vector<ClusterLight> lights(light_count);
+        for (ClusterLight& light : lights) {
+            const float depth = 0.5f + 39.5f * uniform(random) * uniform(random);
+            light.position = glm::vec3((uniform(random) * 2.0f - 1.0f) * depth * 1.03f, (uniform(random) * 2.0f - 1.0f) * depth * 0.58f, -depth);
+            light.radius = 0.2f + 1.3f * uniform(random);
+            light.color = glm::vec3(1.0f);
+            light.padding = 0.0f;
+        }
+
+        ClusterLightLists lists;
+        ClusterAssignStats stats;
+        const double single_ms = best_milliseconds([&]() {
+            stats = {};
+            assign_lights_to_clusters(grid, lights.data(), light_count, lists, &stats, 1);
+        });
+        const double threaded_ms = best_milliseconds([&]() { assign_lights_to_clusters(grid, lights.data(), light_count, lists, nullptr, thread_count); });
+        const auto start = high_resolution_clock::now();
+        const uint64_t brute_force_pairs = count_pairs_brute_force(grid, lights);
+        const double brute_force_ms = duration<double, std::milli>(high_resolution_clock::now() - start).count();
+
+        printf("%5u lights: %7llu pairs, at most %4u per cluster | 1 thread %7.3f ms, %u threads %7.3f ms, every light and cluster %8.1f ms%s\n",
+               light_count, static_cast<unsigned long long>(stats.light_cluster_pairs), stats.max_cluster_lights, single_ms, thread_count,
+               threaded_ms, brute_force_ms, brute_force_pairs == stats.light_cluster_pairs ? "" : " (pairs differ)");
+    }
+    return 0;
+}
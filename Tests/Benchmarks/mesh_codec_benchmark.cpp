@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "mesh_codec.h"
+#include "mesh_cooker.h"
+
+/* MESH CODEC BENCHMARK
+* Encodes the indices of a UV sphere, with its vertices in the order the triangles first use them like the cooker
+* does, and its vertices as 32-byte vertices (position, normal, texture coordinate). Prints the compression and how
+* fast they decode, best of 10, next to a plain memcpy() of the decoded data.
+* Usage: mesh_codec_benchmark [segments]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    template <typename Function>
+    double best_seconds(Function&& function) {
+        double best = INFINITY;
+        for (int run = 0; run < 10; ++run) {
+            const auto start = high_resolution_clock::now();
+            function();
+            best = std::min(best, duration<double>(high_resolution_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void print_result(const char* name, const size_t decoded_size, const size_t encoded_size, const double decode_seconds, const double copy_seconds) {
+        printf("%-18s %6.1f MB -> %6.1f MB (%.2f:1), decoded at %5.2f GB/s, memcpy %5.2f GB/s\n", name,
+               static_cast<double>(decoded_size) / 1e6, static_cast<double>(encoded_size) / 1e6,
+               static_cast<double>(decoded_size) / static_cast<double>(encoded_size), static_cast<double>(decoded_size) / 1e9 / decode_seconds,
+               static_cast<double>(decoded_size) / 1e9 / copy_seconds);
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t segments = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1024;
+
+    MeshSource sphere;
+    const uint32_t rings = segments / 2;
+    for (uint32_t ring = 0; ring <= rings; ++ring) {
+        for (uint32_t segment = 0; segment <= segments; ++segment) {
+            const float u = static_cast<float>(segment) / static_cast<float>(segments);
+            const float v = static_cast<float>(ring) / static_cast<float>(rings);
+            const glm::vec3 normal(sinf(v * 3.14159265f) * cosf(u * 6.28318531f), cosf(v * 3.14159265f), sinf(v * 3.14159265f) * sinf(u * 6.28318531f));
+            sphere.positions.push_back(normal * 0.5f);
+            sphere.normals.push_back(normal);
+            sphere.texcoords.emplace_back(u, v);
+        }
+    }
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            const uint32_t a = ring * (segments + 1) + segment;
+            const uint32_t b = a + segments + 1;
+            sphere.indices.insert(sphere.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    reorder_vertices_by_first_use(sphere);
+
+    constexpr uint32_t vertex_size = 32;
+    std::vector<uint8_t> vertices(sphere.positions.size() * vertex_size);
+    for (size_t i = 0; i < sphere.positions.size(); ++i) {
+        memcpy(vertices.data() + i * vertex_size, &sphere.positions[i], 12);
+        memcpy(vertices.data() + i * vertex_size + 12, &sphere.normals[i], 12);
+        memcpy(vertices.data() + i * vertex_size + 24, &sphere.texcoords[i], 8);
+    }
+    printf("%zu triangles, %zu vertices\n", sphere.indices.size() / 3, sphere.positions.size());
+
+    std::vector<uint8_t> encoded_indices;
+    std::vector<uint8_t> encoded_vertices;
+    const double index_encode_seconds = best_seconds([&]() { encode_index_buffer(sphere.indices.data(), sphere.indices.size(), encoded_indices); });
+    const double vertex_encode_seconds = best_seconds([&]() { encode_vertex_buffer(vertices.data(), sphere.positions.size(), vertex_size, encoded_vertices); });
+    printf("encoded indices in %.1f ms, vertices in %.1f ms\n", index_encode_seconds * 1000.0, vertex_encode_seconds * 1000.0);
+
+    bool valid = true;
+    std::vector<uint8_t> decoded(std::max(sphere.indices.size() * 4, vertices.size()));
+    const size_t index_size = sphere.indices.size() * 4;
+    const double index_seconds = best_seconds([&]() {
+        valid = decode_index_buffer(decoded.data(), sphere.indices.size(), 4, encoded_indices.data(), encoded_indices.size()) && valid;
+    });
+    const double index_copy_seconds = best_seconds([&]() { memcpy(decoded.data(), sphere.indices.data(), index_size); });
+    print_result("32-bit indices", index_size, encoded_indices.size(), index_seconds, index_copy_seconds);
+
+    const double vertex_seconds = best_seconds([&]() {
+        valid = decode_vertex_buffer(decoded.data(), sphere.positions.size(), vertex_size, encoded_vertices.data(), encoded_vertices.size()) && valid;
+    });
+    const double vertex_copy_seconds = best_seconds([&]() { memcpy(decoded.data(), vertices.data(), vertices.size()); });
+    print_result("32-byte vertices", vertices.size(), encoded_vertices.size(), vertex_seconds, vertex_copy_seconds);
+    valid = valid && memcmp(decoded.data(), vertices.data(), vertices.size()) == 0;
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "file_io.h"
+#include "mesh_importer.h"
+
+/* MESH IMPORT BENCHMARK
+* Writes a UV sphere split into 16 groups as an OBJ file, and 16 copies of it as primitives of a .glb file, to a
+* temporary directory, then imports each with import_scene(), best of 3. For the OBJ file it also prints how long
+* only reading its numbers with strtof() on one thread takes, which is roughly what a plain OBJ reader spends.
+* Usage: mesh_import_benchmark [segments]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    constexpr uint32_t part_count = 16;
+
+    glm::vec3 sphere_position(const uint32_t x, const uint32_t y, const uint32_t segments) {
+        const float u = static_cast<float>(x) / static_cast<float>(segments) * 6.28318531f;
+        const float v = static_cast<float>(y) / static_cast<float>(segments) * 3.14159265f;
+        return { sinf(v) * cosf(u), cosf(v), sinf(v) * sinf(u) };
+    }
+
+    std::string make_obj(const uint32_t segments) {
+        std::string text;
+        char line[128];
+        uint32_t first_vertex = 1;
+        for (uint32_t part = 0; part < part_count; ++part) {
+            const uint32_t first_row = part * segments / part_count;
+            const uint32_t last_row = (part + 1) * segments / part_count;
+            text += "g part" + std::to_string(part) + "\n";
+            for (uint32_t y = first_row; y <= last_row; ++y) {
+                for (uint32_t x = 0; x <= segments; ++x) {
+                    const glm::vec3 p = sphere_position(x, y, segments);
+                    snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", p.x, p.y, p.z,
+                             static_cast<float>(x) / static_cast<float>(segments), static_cast<float>(y) / static_cast<float>(segments), p.x, p.y, p.z);
+                    text += line;
+                }
+            }
+            for (uint32_t y = 0; y < last_row - first_row; ++y) {
+                for (uint32_t x = 0; x < segments; ++x) {
+                    const uint32_t a = first_vertex + y * (segments + 1) + x;
+                    const uint32_t c = a + segments + 1;
+                    snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, c + 1, c + 1, c + 1, a + 1, a + 1, a + 1);
+                    text += line;
+                }
+            }
+            first_vertex += (last_row - first_row + 1) * (segments + 1);
+        }
+        return text;
+    }
+
+    template <typename T>
+    void append(std::vector<uint8_t>& bytes, const T* values, const size_t count) {
+        const uint8_t* begin = reinterpret_cast<const uint8_t*>(values);
+        bytes.insert(bytes.end(), begin, begin + count * sizeof(T));
+    }
+
+    // Every primitive is the whole sphere, with positions, normals, texcoords and 32-bit indices
+    std::vector<uint8_t> make_glb(const uint32_t segments) {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texcoords;
+        for (uint32_t y = 0; y <= segments; ++y) {
+            for (uint32_t x = 0; x <= segments; ++x) {
+                positions.push_back(sphere_position(x, y, segments));
+                texcoords.emplace_back(static_cast<float>(x) / static_cast<float>(segments), static_cast<float>(y) / static_cast<float>(segments));
+            }
+        }
+        std::vector<uint32_t> indices;
+        for (uint32_t y = 0; y < segments; ++y) {
+            for (uint32_t x = 0; x < segments; ++x) {
+                const uint32_t a = y * (segments + 1) + x;
+                const uint32_t c = a + segments + 1;
+                indices.insert(indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+            }
+        }
+
+        std::vector<uint8_t> bin;
+        append(bin, positions.data(), positions.size());
+        append(bin, positions.data(), positions.size());
+        append(bin, texcoords.data(), texcoords.size());
+        append(bin, indices.data(), indices.size());
+        const size_t sizes[4] = { positions.size() * 12, positions.size() * 12, texcoords.size() * 8, indices.size() * 4 };
+
+        std::string views;
+        size_t offset = 0;
+        for (const size_t size : sizes) {
+            views += (views.empty() ? "" : ",") + std::string("{\"buffer\":0,\"byteOffset\":") + std::to_string(offset) + ",\"byteLength\":" + std::to_string(size) + "}";
+            offset += size;
+        }
+        const std::string vertex_count = std::to_string(positions.size());
+        const std::string accessors =
+            "{\"bufferView\":0,\"componentType\":5126,\"count\":" + vertex_count + ",\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},"
+            "{\"bufferView\":1,\"componentType\":5126,\"count\":" + vertex_count + ",\"type\":\"VEC3\"},"
+            "{\"bufferView\":2,\"componentType\":5126,\"count\":" + vertex_count + ",\"type\":\"VEC2\"},"
+            "{\"bufferView\":3,\"componentType\":5125,\"count\":" + std::to_string(indices.size()) + ",\"type\":\"SCALAR\"}";
+        std::string meshes;
+        std::string nodes;
+        std::string node_indices;
+        for (uint32_t part = 0; part < part_count; ++part) {
+            const std::string index = std::to_string(part);
+            meshes += std::string(part ? "," : "") + "{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}";
+            nodes += std::string(part ? "," : "") + "{\"mesh\":" + index + ",\"translation\":[" + index + ",0,0]}";
+            node_indices += std::string(part ? "," : "") + index;
+        }
+        std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" + node_indices + "]}],\"nodes\":[" + nodes
+            + "],\"meshes\":[" + meshes + "],\"accessors\":[" + accessors + "],\"bufferViews\":[" + views
+            + "],\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}]}";
+        while (json.size() % 4 != 0) {
+            json += ' ';
+        }
+
+        // The header, then a JSON chunk and a binary chunk
+        const uint32_t header[5] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()),
+                                     static_cast<uint32_t>(json.size()), 0x4E4F534A };
+        const uint32_t bin_header[2] = { static_cast<uint32_t>(bin.size()), 0x004E4942 };
+        std::vector<uint8_t> glb;
+        append(glb, header, 5);
+        glb.insert(glb.end(), json.begin(), json.end());
+        append(glb, bin_header, 2);
+        glb.insert(glb.end(), bin.begin(), bin.end());
+        return glb;
+    }
+
+    void measure_import(const char* name, const std::string& path) {
+        ImportStats best;
+        best.import_seconds = INFINITY;
+        for (int run = 0; run < 3; ++run) {
+            ImportedScene scene;
+            ImportStats stats;
+            if (!import_scene(path, scene, &stats)) {
+                return;
+            }
+            if (stats.import_seconds < best.import_seconds) {
+                best = stats;
+            }
+        }
+        printf("%s: %.1f MB, %zu vertices, %zu triangles, imported in %.1f ms (%.0f MB/s)\n", name,
+               static_cast<double>(best.input_bytes) / 1e6, best.vertex_count, best.triangle_count, best.import_seconds * 1000.0,
+               static_cast<double>(best.input_bytes) / 1e6 / best.import_seconds);
+    }
+
+    // Every number of the vertex lines with strtof(), on one thread
+    void measure_strtof(const std::string& text) {
+        const auto start = high_resolution_clock::now();
+        double sum = 0.0;
+        const char* cursor = text.c_str();
+        while (*cursor != '\0') {
+            const char* line_end = strchr(cursor, '\n');
+            if (cursor[0] == 'v') {
+                char* number_end = const_cast<char*>(cursor) + (cursor[1] == ' ' ? 1 : 2);
+                for (const char* number = number_end; number < line_end; number = number_end) {
+                    sum += strtof(number, &number_end);
+                    if (number_end == number) {
+                        break;
+                    }
+                }
+            }
+            cursor = line_end + 1;
+        }
+        const double seconds = duration<double>(high_resolution_clock::now() - start).count();
+        printf("obj numbers with strtof: %.1f ms (%.0f MB/s), checksum %.3f\n", seconds * 1000.0,
+               static_cast<double>(text.size()) / 1e6 / seconds, sum);
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t segments = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 512;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string obj_path = (directory / "mesh_import_benchmark.obj").string();
+    const std::string glb_path = (directory / "mesh_import_benchmark.glb").string();
+
+    const std::string obj = make_obj(segments);
+    const std::vector<uint8_t> glb = make_glb(segments);
+    if (!write_file(obj_path, obj.data(), obj.size(), false) || !write_file(glb_path, glb.data(), glb.size(), false)) {
+        return 1;
+    }
+    measure_import("obj", obj_path);
+    measure_strtof(obj);
+    measure_import("glb", glb_path);
+    std::filesystem::remove(obj_path);
+    std::filesystem::remove(glb_path);
+    return 0;
+}
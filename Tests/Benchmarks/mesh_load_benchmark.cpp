@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "file_io.h"
+#include "mesh_codec.h"
+#include "mesh_cooker.h"
+#include "mesh_format.h"
+
+/* MESH LOAD BENCHMARK
+* Cooks a UV sphere without compression, writes it to a temporary file and loads it into upload memory the two ways
+* the app could: read_file() into the heap and copy, or map the file and copy straight from the mapping. Prints the
+* cook time and the best of 5 loads of each. The file is in the OS cache after the first load, so this measures the
+* copies and the system calls, not the disk.
+* Usage: mesh_load_benchmark [segments]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    double milliseconds_since(const high_resolution_clock::time_point start) {
+        return duration<double, std::milli>(high_resolution_clock::now() - start).count();
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t segments = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1024;
+
+    MeshSource sphere;
+    for (uint32_t y = 0; y <= segments; ++y) {
+        for (uint32_t x = 0; x <= segments; ++x) {
+            const float u = static_cast<float>(x) / static_cast<float>(segments);
+            const float v = static_cast<float>(y) / static_cast<float>(segments);
+            const glm::vec3 position(sinf(v * 3.14159265f) * cosf(u * 6.28318531f), cosf(v * 3.14159265f),
+                                     sinf(v * 3.14159265f) * sinf(u * 6.28318531f));
+            sphere.positions.push_back(position);
+            sphere.normals.push_back(position);
+            sphere.texcoords.emplace_back(u, v);
+        }
+    }
+    for (uint32_t y = 0; y < segments; ++y) {
+        for (uint32_t x = 0; x < segments; ++x) {
+            const uint32_t a = y * (segments + 1) + x;
+            const uint32_t c = a + segments + 1;
+            sphere.indices.insert(sphere.indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+        }
+    }
+
+    MeshCookSettings settings;
+    settings.compress = false;
+    std::vector<uint8_t> file;
+    auto start = high_resolution_clock::now();
+    if (!cook_mesh(sphere, settings, file)) {
+        return 1;
+    }
+    const double cook_ms = milliseconds_since(start);
+    const std::string path = (std::filesystem::temp_directory_path() / "mesh_load_benchmark.mesh").string();
+    if (!write_file(path, file.data(), file.size(), false)) {
+        return 1;
+    }
+    printf("%zu triangles, %.1f MB file, cooked in %.1f ms\n", sphere.indices.size() / 3, static_cast<double>(file.size()) / 1e6, cook_ms);
+
+    std::vector<uint8_t> upload(file.size());
+    double best_read_ms = INFINITY;
+    double best_mapped_ms = INFINITY;
+    for (int run = 0; run < 5; ++run) {
+        start = high_resolution_clock::now();
+        size_t size = 0;
+        char* data = nullptr;
+        read_file(path, size, data, false);
+        MeshView read_view;
+        if (!open_mesh_view(data, size, read_view) || !copy_mesh_sections(read_view, upload.data())) {
+            free(data);
+            return 1;
+        }
+        free(data);
+        best_read_ms = std::min(best_read_ms, milliseconds_since(start));
+
+        start = high_resolution_clock::now();
+        MappedFile mapped;
+        MeshView mapped_view;
+        if (!mapped.open(path, false) || !open_mesh_view(mapped.data(), mapped.size(), mapped_view)
+            || !copy_mesh_sections(mapped_view, upload.data())) {
+            return 1;
+        }
+        mapped.close();
+        best_mapped_ms = std::min(best_mapped_ms, milliseconds_since(start));
+    }
+    std::filesystem::remove(path);
+
+    const double megabytes = static_cast<double>(file.size()) / 1e6;
+    printf("read_file and copy: %.2f ms (%.0f MB/s)\n", best_read_ms, megabytes / best_read_ms * 1000.0);
+    printf("mapped and copy:    %.2f ms (%.0f MB/s)\n", best_mapped_ms, megabytes / best_mapped_ms * 1000.0);
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "glm/gtc/matrix_transform.hpp"
+#include "meshlet_builder.h"
+#include "meshlet_culler.h"
+#include "projection.h"
+
+/* MESHLET BENCHMARK
+* Builds meshlets for a sphere, a bumpy sphere and a sphere with its triangles shuffled, with build_meshlets() and
+* with a greedy builder that fills meshlets in index order, and prints how long it took, how full the meshlets
+* are, how often vertices are loaded again by another meshlet, and their bounds. Then culls them for 256 random
+* cameras around the mesh and prints how many were culled by the frustum and by their normal cones.
+* Usage: meshlet_benchmark [segments]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    struct TestMesh {
+        const char* name = "";
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    TestMesh make_sphere(const uint32_t segments) {
+        TestMesh mesh;
+        mesh.name = "sphere";
+        const uint32_t rings = segments / 2;
+        for (uint32_t ring = 0; ring <= rings; ++ring) {
+            for (uint32_t segment = 0; segment <= segments; ++segment) {
+                const float theta = 3.14159265f * static_cast<float>(ring) / static_cast<float>(rings);
+                const float phi = 6.28318531f * static_cast<float>(segment) / static_cast<float>(segments);
+                mesh.positions.emplace_back(sinf(theta) * cosf(phi) * 0.5f, cosf(theta) * 0.5f, sinf(theta) * sinf(phi) * 0.5f);
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ++ring) {
+            for (uint32_t segment = 0; segment < segments; ++segment) {
+                const uint32_t a = ring * (segments + 1) + segment;
+                const uint32_t b = a + segments + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    // Bumps all over, so the normal cones of neighbouring meshlets differ
+    TestMesh make_bumpy_sphere(const uint32_t segments) {
+        TestMesh mesh = make_sphere(segments);
+        mesh.name = "bumpy sphere";
+        for (glm::vec3& position : mesh.positions) {
+            const glm::vec3 normal = glm::normalize(position);
+            position = normal * 0.5f * (1.0f + 0.15f * sinf(normal.x * 23.0f) * sinf(normal.y * 19.0f) * sinf(normal.z * 17.0f));
+        }
+        return mesh;
+    }
+
+    TestMesh make_shuffled_sphere(const uint32_t segments) {
+        TestMesh mesh = make_sphere(segments);
+        mesh.name = "shuffled sphere";
+        std::vector<uint32_t> order(mesh.indices.size() / 3);
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937(3));
+        std::vector<uint32_t> shuffled;
+        for (const uint32_t triangle : order) {
+            shuffled.insert(shuffled.end(), { mesh.indices[triangle * 3], mesh.indices[triangle * 3 + 1], mesh.indices[triangle * 3 + 2] });
+        }
+        mesh.indices = shuffled;
+        return mesh;
+    }
+
+    // Starts a new meshlet whenever the next triangle doesn't fit
+    void build_meshlets_greedy(const TestMesh& mesh, std::vector<MeshletDesc>& meshlets, std::vector<uint32_t>& meshlet_vertices,
+                               std::vector<uint32_t>& meshlet_triangles) {
+        std::vector<uint32_t> local_index(mesh.positions.size(), UINT32_MAX);
+        MeshletDesc meshlet;
+        const auto finish = [&]() {
+            if (meshlet.triangle_count == 0) {
+                return;
+            }
+            for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+                local_index[meshlet_vertices[meshlet.vertex_offset + i]] = UINT32_MAX;
+            }
+            meshlets.push_back(meshlet);
+            meshlet = {};
+            meshlet.vertex_offset = static_cast<uint32_t>(meshlet_vertices.size());
+            meshlet.triangle_offset = static_cast<uint32_t>(meshlet_triangles.size());
+        };
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            uint32_t new_vertices = 0;
+            for (size_t corner = 0; corner < 3; ++corner) {
+                new_vertices += local_index[mesh.indices[i + corner]] == UINT32_MAX ? 1 : 0;
+            }
+            if (meshlet.vertex_count + new_vertices > meshlet_max_vertices || meshlet.triangle_count == meshlet_max_triangles) {
+                finish();
+            }
+            uint32_t corners[3];
+            for (size_t corner = 0; corner < 3; ++corner) {
+                uint32_t& local = local_index[mesh.indices[i + corner]];
+                if (local == UINT32_MAX) {
+                    local = meshlet.vertex_count++;
+                    meshlet_vertices.push_back(mesh.indices[i + corner]);
+                }
+                corners[corner] = local;
+            }
+            meshlet_triangles.push_back(pack_meshlet_triangle(corners[0], corners[1], corners[2]));
+            meshlet.triangle_count++;
+        }
+        finish();
+    }
+
+    void measure(const TestMesh& mesh, const bool greedy) {
+        std::vector<MeshletDesc> meshlets;
+        std::vector<uint32_t> meshlet_vertices;
+        std::vector<uint32_t> meshlet_triangles;
+        auto start = high_resolution_clock::now();
+        if (greedy) {
+            build_meshlets_greedy(mesh, meshlets, meshlet_vertices, meshlet_triangles);
+        }
+        else {
+            build_meshlets(mesh.positions, mesh.indices.data(), mesh.indices.size(), meshlet_default_cone_weight, meshlets, meshlet_vertices, meshlet_triangles);
+        }
+        const double build_ms = duration<double, std::milli>(high_resolution_clock::now() - start).count();
+
+        std::vector<MeshletBounds> bounds;
+        double radius_sum = 0.0;
+        uint32_t cones = 0;
+        for (const MeshletDesc& meshlet : meshlets) {
+            bounds.push_back(compute_meshlet_bounds(mesh.positions, meshlet, meshlet_vertices, meshlet_triangles));
+            radius_sum += bounds.back().radius;
+            cones += bounds.back().cone_cutoff < 127 ? 1 : 0;
+        }
+        const double meshlet_count = static_cast<double>(meshlets.size());
+        printf("    %-7s built in %6.1f ms, %6zu meshlets, %5.1f triangles and %4.1f vertices each, vertices loaded %.2fx, "
+               "mean radius %.4f, %.1f%% with a cone\n", greedy ? "greedy" : "builder", build_ms, meshlets.size(),
+               static_cast<double>(mesh.indices.size() / 3) / meshlet_count, static_cast<double>(meshlet_vertices.size()) / meshlet_count,
+               static_cast<double>(meshlet_vertices.size()) / static_cast<double>(mesh.positions.size()), radius_sum / meshlet_count,
+               100.0 * cones / meshlet_count);
+
+        // Cameras 1.1 to 2.1 units from the center, looking at random points near the mesh, which is rotated randomly
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        const glm::mat4 projection = reverse_z_infinite_perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.01f);
+        MeshletCullStats total;
+        std::vector<uint32_t> visible;
+        double cull_seconds = 0.0;
+        for (int camera = 0; camera < 256; ++camera) {
+            const glm::vec3 direction = glm::normalize(glm::vec3(uniform(random), uniform(random), uniform(random)));
+            const glm::vec3 eye = direction * (1.6f + uniform(random) * 0.5f);
+            const glm::vec3 target(uniform(random), uniform(random), uniform(random));
+            const glm::mat4 model = glm::rotate(glm::mat4(1.0f), uniform(random) * 3.0f,
+                                                glm::normalize(glm::vec3(uniform(random), uniform(random), uniform(random)) + glm::vec3(0.01f)));
+            const MeshletCullView view = make_meshlet_cull_view(model, projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)), eye);
+            visible.clear();
+            MeshletCullStats stats;
+            start = high_resolution_clock::now();
+            cull_meshlets(bounds.data(), 0, static_cast<uint32_t>(bounds.size()), view, visible, stats);
+            cull_seconds += duration<double>(high_resolution_clock::now() - start).count();
+            total.add(stats);
+        }
+        const double tested = static_cast<double>(total.tested);
+        printf("            culled by the frustum %.1f%%, by the cone %.1f%%, visible %.1f%%, %.0f M meshlets/s\n",
+               100.0 * total.frustum_culled / tested, 100.0 * total.cone_culled / tested, 100.0 * total.visible / tested, tested / cull_seconds / 1e6);
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t segments = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1024;
+    for (const TestMesh& mesh : { make_sphere(segments), make_bumpy_sphere(segments), make_shuffled_sphere(segments) }) {
+        printf("%s: %zu triangles\n", mesh.name, mesh.indices.size() / 3);
+        measure(mesh, true);
+        measure(mesh, false);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "overlay.h"
+
+/* OVERLAY BENCHMARK
+* Builds an overlay like a full screen debug log: a dark background and lines of 41 characters over a 1280x720
+* screen, about 10000 glyphs by default, and copies the quads out like the app copies them into the upload ring.
+* Then a frame stats panel with formatted text, half of it outside its scissor rectangle. Prints the quads, draws
+* and the average and best time of 2000 frames for each.
+* Usage: overlay_benchmark [line count]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    template <typename Function>
+    void measure(const char* name, const Overlay& overlay, Function&& build) {
+        std::vector<OverlayQuad> upload;
+        double total_ms = 0.0;
+        double best_ms = INFINITY;
+        constexpr int frames = 2000;
+        for (int frame = 0; frame < frames; ++frame) {
+            const auto start = high_resolution_clock::now();
+            build(frame);
+            upload.resize(std::max<size_t>(upload.size(), overlay.quad_count));
+            memcpy(upload.data(), overlay.quads.data(), overlay.quad_count * sizeof(OverlayQuad));
+            const double milliseconds = duration<double, std::milli>(high_resolution_clock::now() - start).count();
+            total_ms += milliseconds;
+            best_ms = std::min(best_ms, milliseconds);
+        }
+        const OverlayStats stats = overlay_stats(overlay);
+        printf("%s: %u quads (%zu bytes), %u draws, %u culled | average %.4f ms, best %.4f ms\n", name, stats.quads,
+               stats.quads * sizeof(OverlayQuad), stats.batches, stats.culled, total_ms / frames, best_ms);
+    }
+}
+
+int main(const int argc, char** argv) {
+    const size_t line_count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 250;
+    OverlayFont font;
+    if (!build_overlay_font(font)) {
+        return 1;
+    }
+
+    std::vector<std::string> lines(line_count);
+    for (size_t i = 0; i < line_count; ++i) {
+        char line[64];
+        snprintf(line, sizeof(line), "line%04zu:ABCDEFGHIJKLMNOPQRSTUVWXYZ0123%02zu", i % 10000, i % 100);
+        lines[i] = line;
+    }
+
+    Overlay overlay;
+    measure("debug log", overlay, [&](int) {
+        begin_overlay(overlay, font, 1280, 720, 1);
+        add_overlay_rect(overlay, 0, 0, 1280, 720, overlay_color(0, 0, 0, 128));
+        for (size_t i = 0; i < lines.size(); ++i) {
+            add_overlay_text(overlay, static_cast<int32_t>(i / 72 * 330), static_cast<int32_t>(i % 72 * 10), lines[i].c_str(),
+                             lines[i].size(), overlay_color(255, 255, 255));
+        }
+    });
+
+    measure("stats panel", overlay, [&](const int frame) {
+        begin_overlay(overlay, font, 1920, 1080, 2);
+        add_overlay_rect(overlay, 8, 8, 400, 200, overlay_color(0, 0, 0, 160));
+        set_overlay_scissor(overlay, { 8, 8, 408, 208 });
+        for (int32_t row = 0; row < 20; ++row) {
+            add_overlay_textf(overlay, 16, 16 + row * overlay_line_height * 2, overlay_color(255, 255, 0), "counter %2d: %8.3f ms %6d draws",
+                              row, static_cast<double>(frame) * 0.016 + row, frame * row);
+        }
+        reset_overlay_scissor(overlay);
+    });
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "frame_packet.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "particles.h"
+
+/* PARTICLES BENCHMARK
+* The app's emitters, run at the simulation step until the particle count settles, then 120 more steps timed:
+* stepping (integration, compaction and spawning), sorting back to front and writing the billboards, on one thread
+* and on all of them. Sorting is also timed with std::sort on (depth, index) pairs, for comparison.
+* Usage: particles_benchmark [emitter count]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    double milliseconds_since(const high_resolution_clock::time_point start) {
+        return duration<double, std::milli>(high_resolution_clock::now() - start).count();
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t emitter_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 16384;
+    const unsigned all_threads = std::max(1u, std::thread::hardware_concurrency());
+    const std::vector<ParticleEmitter> emitters = make_particle_emitters(emitter_count);
+    const float delta_time = static_cast<float>(simulation_step);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.5f, 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    for (const unsigned thread_count : { 1u, all_threads }) {
+        ParticleSystem system;
+        init_particle_system(system, max_particles, emitter_count);
+        for (int step = 0; step < 600; ++step) {
+            step_particles(system, emitters.data(), particle_gravity, delta_time, nullptr, thread_count);
+        }
+
+        std::vector<uint32_t> order;
+        std::vector<ParticleInstance> instances(system.capacity);
+        double step_ms = 0.0;
+        double sort_ms = 0.0;
+        double write_ms = 0.0;
+        ParticleStepStats stats;
+        constexpr int timed_steps = 120;
+        for (int step = 0; step < timed_steps; ++step) {
+            auto start = high_resolution_clock::now();
+            step_particles(system, emitters.data(), particle_gravity, delta_time, &stats, thread_count);
+            step_ms += milliseconds_since(start);
+            start = high_resolution_clock::now();
+            sort_particles_by_depth(system, view, order, thread_count);
+            sort_ms += milliseconds_since(start);
+            start = high_resolution_clock::now();
+            write_particle_instances(system, order.data(), system.count, instances.data(), thread_count);
+            write_ms += milliseconds_since(start);
+        }
+        printf("%u threads: %u particles, %u spawned per step | step %.3f ms, sort %.3f ms, write %.3f ms\n", thread_count,
+               system.count, stats.spawned / timed_steps, step_ms / timed_steps, sort_ms / timed_steps, write_ms / timed_steps);
+
+        if (thread_count == 1) {
+            std::vector<std::pair<float, uint32_t>> items(system.count);
+            const auto start = high_resolution_clock::now();
+            for (uint32_t i = 0; i < system.count; ++i) {
+                const glm::vec4 position(system.particles.position_x[i], system.particles.position_y[i], system.particles.position_z[i], 1.0f);
+                items[i] = { (view * position).z, i };
+            }
+            std::sort(items.begin(), items.end());
+            printf("           std::sort of the same particles %.3f ms\n", milliseconds_since(start));
+        }
+        if (all_threads == 1) {
+            break;
+        }
+    }
+    return 0;
+}
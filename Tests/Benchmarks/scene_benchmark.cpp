@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "scene.h"
+
+/* SCENE BENCHMARK
+* A scene of 9009 roots with 10 children each and 10 grandchildren each of those, 999999 nodes that are all drawn.
+* Times, best of 20, updating the transforms when every root moved and when 1% of them did, on one thread and on
+* all of them, and packing the draws. Then replaces 1% of the leaves every frame, which sorts the hierarchy again.
+* Usage: scene_benchmark [root count]
+*/
+
+namespace {
+    using namespace std::chrono;
+
+    template <typename Function>
+    double best_milliseconds(Function&& function) {
+        double best = INFINITY;
+        for (int run = 0; run < 20; ++run) {
+            const auto start = high_resolution_clock::now();
+            function();
+            best = std::min(best, duration<double, std::milli>(high_resolution_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    SceneEntity create_drawn_node(Scene& scene, const SceneEntity parent, const float offset) {
+        const SceneEntity entity = create_entity(scene, scene_component_transform | scene_component_draw);
+        set_parent(scene, entity, parent);
+        set_local_transform(scene, entity, glm::vec3(offset, 0.0f, 0.0f), glm::angleAxis(offset, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(0.5f));
+        find_draw(scene, entity)->index_count = 3;
+        return entity;
+    }
+
+    void move_roots(Scene& scene, const std::vector<SceneEntity>& roots, const size_t step, const float time) {
+        for (size_t i = 0; i < roots.size(); i += step) {
+            set_local_transform(scene, roots[i], glm::vec3(static_cast<float>(i), time, 0.0f),
+                                glm::angleAxis(time, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f));
+        }
+    }
+}
+
+int main(const int argc, char** argv) {
+    const size_t root_count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 9009;
+    const unsigned thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    Scene scene;
+    std::vector<SceneEntity> roots;
+    std::vector<SceneEntity> leaves;
+    for (size_t root = 0; root < root_count; ++root) {
+        roots.push_back(create_drawn_node(scene, SceneEntity{}, static_cast<float>(root)));
+        for (int child = 0; child < 10; ++child) {
+            const SceneEntity middle = create_drawn_node(scene, roots.back(), static_cast<float>(child));
+            for (int grandchild = 0; grandchild < 10; ++grandchild) {
+                leaves.push_back(create_drawn_node(scene, middle, static_cast<float>(grandchild)));
+            }
+        }
+    }
+    SceneUpdateStats stats;
+    auto start = high_resolution_clock::now();
+    update_transforms(scene, &stats, thread_count);
+    printf("%zu nodes in %u levels, first update with the sort %.2f ms\n", scene.transforms.world.size(), stats.levels,
+           duration<double, std::milli>(high_resolution_clock::now() - start).count());
+
+    float time = 0.0f;
+    for (const size_t step : { size_t(1), size_t(100) }) {
+        for (const unsigned threads : { 1u, thread_count }) {
+            const double milliseconds = best_milliseconds([&]() {
+                move_roots(scene, roots, step, time += 0.01f);
+                update_transforms(scene, &stats, threads);
+            });
+            printf("%3zu%% of the roots moved, %u threads: %7.3f ms, %6u nodes updated\n", 100 / step, threads, milliseconds, stats.updated_nodes);
+            if (thread_count == 1) {
+                break;
+            }
+        }
+    }
+
+    std::vector<glm::mat4> transforms(count_draws(scene));
+    std::vector<DrawItem> draws(transforms.size());
+    const double pack_ms = best_milliseconds([&]() { pack_draws(scene, transforms.data(), draws.data(), thread_count); });
+    printf("packed %zu draws: %.3f ms\n", draws.size(), pack_ms);
+
+    // Churn: replace 1% of the leaves every frame, under the same parents
+    size_t next_leaf = 0;
+    const double churn_ms = best_milliseconds([&]() {
+        for (size_t i = 0; i < leaves.size() / 100; ++i) {
+            SceneEntity& leaf = leaves[next_leaf++ % leaves.size()];
+            const SceneEntity parent = scene.transforms.entities[scene.transforms.parents[find_transform_node(scene, leaf)]];
+            destroy_entity(scene, leaf);
+            leaf = create_drawn_node(scene, parent, 1.0f);
+        }
+        move_roots(scene, roots, 100, time += 0.01f);
+        update_transforms(scene, &stats, thread_count);
+    });
+    printf("1%% of the leaves replaced, then sorted and updated: %.3f ms\n", churn_ms);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "dxbc_builder.h"
+#include "file_io.h"
+#include "glm/ext/matrix_transform.hpp"
+#include "glm/trigonometric.hpp"
+#include "light_clusters.h"
+#include "projection.h"
+#include "shader_interpreter.h"
+
+/* SHADER INTERPRETER BENCHMARK
+* Runs the sample's shaders (Shaders/hello_triangle.vs.cso and .ps.cso in the tests) on the CPU, one batch of 8
+* invocations after the other, next to the passthrough shaders from dxbc_builder.h, which are about as small as a
+* shader gets. The pixel shader loops over the lights of its cluster, so it runs with 0 to 4096 lights in front of
+* the camera (with many more, the light index list is full and clusters lose their lights). Prints Minvocations/s
+* on one thread, the best of at least 3 passes over all batches.
+* Usage: shader_interpreter_benchmark [batch count]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    template <typename Work>
+    double best_time(const Work& work) {
+        double best = 1e30;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.25; ++run) {
+            const auto run_start = high_resolution_clock::now();
+            work();
+            best = std::min(best, duration<double>(high_resolution_clock::now() - run_start).count());
+        }
+        return best;
+    }
+
+    bool load_shader_file(const std::string& path, ShaderProgram& program) {
+        size_t size = 0;
+        char* data = nullptr;
+        read_file(path, size, data, false);
+        const bool loaded = data && load_shader_program(data, size, program);
+        free(data);
+        return loaded;
+    }
+
+    // Must match frame_constants.hlsli
+    struct FrameConstants {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 color_mul;
+        uint32_t light_count;
+        ClusterLookup cluster_lookup;
+    };
+
+    // Runs every batch of inputs through the program, returns the invocations per second. Programs with fewer inputs
+    // get the first ones.
+    double invocations_per_second(const ShaderProgram& program, ShaderContext& context, const std::vector<std::vector<ShaderRegister>>& batches) {
+        const double seconds = best_time([&]() {
+            for (const std::vector<ShaderRegister>& inputs : batches) {
+                std::copy_n(inputs.begin(), std::min(inputs.size(), context.inputs.size()), context.inputs.begin());
+                execute_shader(program, context);
+            }
+        });
+        return batches.size() * shader_lane_count / seconds;
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t batch_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 20000;
+    ShaderProgram vertex_shader;
+    ShaderProgram pixel_shader;
+    if (!load_shader_file(TEST_DATA_DIR "/Shaders/hello_triangle.vs.cso", vertex_shader) ||
+        !load_shader_file(TEST_DATA_DIR "/Shaders/hello_triangle.ps.cso", pixel_shader)) {
+        return 1;
+    }
+    ShaderProgram passthrough_vertex_shader;
+    ShaderProgram color_pixel_shader;
+    const std::vector<uint8_t> passthrough_bytecode = test::passthrough_vertex_shader();
+    const std::vector<uint8_t> color_bytecode = test::color_pixel_shader();
+    load_shader_program(passthrough_bytecode.data(), passthrough_bytecode.size(), passthrough_vertex_shader);
+    load_shader_program(color_bytecode.data(), color_bytecode.size(), color_pixel_shader);
+
+    constexpr uint32_t width = 1920;
+    constexpr uint32_t height = 1080;
+    constexpr float near_plane = 0.1f;
+    FrameConstants constants = {};
+    constants.view = glm::lookAt(glm::vec3(1.0f, 2.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    constants.projection = reverse_z_infinite_perspective(glm::radians(60.0f), static_cast<float>(width) / height, near_plane);
+    constants.color_mul = glm::vec3(1.0f);
+    const ClusterGrid grid = make_cluster_grid(constants.projection, width, height, near_plane, 100.0f);
+    constants.cluster_lookup = grid.lookup;
+    const glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, -1.0f));
+    const uint32_t draw_constants[4] = {};
+
+    // Vertices in [-1, 1], and 2x2 quads of pixels on a slanted surface 2 to 20 units away
+    std::mt19937 random(23);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::vector<std::vector<ShaderRegister>> vertex_batches(batch_count, std::vector<ShaderRegister>(2));
+    std::vector<std::vector<ShaderRegister>> pixel_batches(batch_count, std::vector<ShaderRegister>(3));
+    for (uint32_t batch = 0; batch < batch_count; ++batch) {
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            for (int i = 0; i < 4; ++i) {
+                vertex_batches[batch][0].lanes[i][lane] = i < 3 ? uniform(random) * 2.0f - 1.0f : 1.0f;
+                vertex_batches[batch][1].lanes[i][lane] = uniform(random);
+            }
+        }
+        for (uint32_t quad = 0; quad < 2; ++quad) {
+            const uint32_t quad_x = static_cast<uint32_t>(uniform(random) * (width / 2)) * 2;
+            const uint32_t quad_y = static_cast<uint32_t>(uniform(random) * (height / 2)) * 2;
+            for (uint32_t corner = 0; corner < 4; ++corner) {
+                const uint32_t lane = quad * 4 + corner;
+                const float x = quad_x + (corner & 1) + 0.5f;
+                const float y = quad_y + (corner >> 1) + 0.5f;
+                const float depth = 2.0f + 18.0f * (x / width * 0.3f + y / height * 0.7f);
+                const glm::vec3 view_position = glm::vec3((x / width * 2.0f - 1.0f) / constants.projection[0][0],
+                                                          (1.0f - y / height * 2.0f) / constants.projection[1][1], -1.0f) * depth;
+                for (int i = 0; i < 3; ++i) {
+                    pixel_batches[batch][0].lanes[i][lane] = uniform(random);
+                    pixel_batches[batch][1].lanes[i][lane] = view_position[i];
+                }
+                pixel_batches[batch][2].lanes[0][lane] = x;
+                pixel_batches[batch][2].lanes[1][lane] = y;
+            }
+        }
+    }
+
+    printf("%u batches of %u\n", batch_count, shader_lane_count);
+    printf("shader                        lights per pixel  Minvocations/s\n");
+    {
+        ShaderContext context;
+        context.prepare(passthrough_vertex_shader);
+        context.constant_buffers[0] = reinterpret_cast<const float*>(&constants.color_mul);
+        context.constant_buffer_sizes[0] = 1;
+        printf("passthrough vs                %16s %15.1f\n", "", invocations_per_second(passthrough_vertex_shader, context, vertex_batches) / 1e6);
+    }
+    {
+        ShaderContext context;
+        context.prepare(vertex_shader);
+        context.constant_buffers[0] = reinterpret_cast<const float*>(&constants);
+        context.constant_buffer_sizes[0] = sizeof(FrameConstants) / 16;
+        context.constant_buffers[1] = reinterpret_cast<const float*>(draw_constants);
+        context.constant_buffer_sizes[1] = 1;
+        context.structured_buffers[3] = { reinterpret_cast<const uint8_t*>(&transform), sizeof(glm::mat4), 1 };
+        printf("hello_triangle.vs             %16s %15.1f\n", "", invocations_per_second(vertex_shader, context, vertex_batches) / 1e6);
+    }
+    {
+        ShaderContext context;
+        context.prepare(color_pixel_shader);
+        printf("color ps                      %16s %15.1f\n", "", invocations_per_second(color_pixel_shader, context, pixel_batches) / 1e6);
+    }
+
+    // Spread over the view up to 40 units away, more of them close by like in a scene
+    for (const uint32_t light_count : { 0u, 256u, 1024u, 4096u }) {
+        std::vector<ClusterLight> lights(light_count);
+        for (ClusterLight& light : lights) {
+            const float depth = 0.5f + 39.5f * uniform(random) * uniform(random);
+            light.position = glm::vec3((uniform(random) * 2.0f - 1.0f) * depth * 1.03f, (uniform(random) * 2.0f - 1.0f) * depth * 0.58f, -depth);
+            light.radius = 0.2f + 1.3f * uniform(random);
+            light.color = glm::vec3(1.0f);
+            light.padding = 0.0f;
+        }
+        constants.light_count = light_count;
+        ClusterLightLists lists;
+        assign_lights_to_clusters(grid, lights.data(), light_count, lists);
+
+        // How many lights the pixels loop over, on average
+        uint64_t looped_lights = 0;
+        for (const std::vector<ShaderRegister>& inputs : pixel_batches) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                looped_lights += lists.ranges[cluster_at(grid.lookup, inputs[2].lanes[0][lane], inputs[2].lanes[1][lane], -inputs[1].lanes[2][lane])].count;
+            }
+        }
+
+        ShaderContext context;
+        context.prepare(pixel_shader);
+        context.constant_buffers[0] = reinterpret_cast<const float*>(&constants);
+        context.constant_buffer_sizes[0] = sizeof(FrameConstants) / 16;
+        context.structured_buffers[0] = { reinterpret_cast<const uint8_t*>(lists.ranges.data()), sizeof(ClusterRange), cluster_count };
+        context.structured_buffers[1] = { reinterpret_cast<const uint8_t*>(lists.light_indices.data()), sizeof(uint32_t),
+                                          static_cast<uint32_t>(lists.light_indices.size()) };
+        context.structured_buffers[2] = { reinterpret_cast<const uint8_t*>(lights.data()), sizeof(ClusterLight), light_count };
+        printf("hello_triangle.ps, %5u lights %16.1f %15.1f\n", light_count, static_cast<double>(looped_lights) / (batch_count * shader_lane_count),
+               invocations_per_second(pixel_shader, context, pixel_batches) / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shader_reload.h"
+
+/* SHADER RELOAD BENCHMARK
+* Three pipelines in a temporary shader directory, two of them sharing an include, rebuilt by a ShaderReloader while
+* a render loop runs at 240 Hz and takes the reloads at the start of every frame. There is no GPU here, so a build
+* is a stand-in that sleeps for 40 ms (or the given time) instead of compiling shaders and creating a PSO. Edits a
+* shared include, a single shader, and one shader five times in a row, and prints how long each reload took from
+* the edit to the frame that took it, and how long the frames took, which shouldn't change during a rebuild.
+* Usage: shader_reload_benchmark [build ms]
+*/
+
+namespace {
+    using namespace std::chrono;
+    using Clock = steady_clock;
+
+    void write_text(const std::filesystem::path& path, const std::string& text) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+    }
+
+    double percentile(std::vector<double> values, const double fraction) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(fraction * static_cast<double>(values.size() - 1))];
+    }
+}
+
+int main(const int argc, char** argv) {
+    const int build_ms = argc > 1 ? atoi(argv[1]) : 40;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "shader_reload_benchmark";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    write_text(directory / "common.hlsli", "// common\n");
+    write_text(directory / "mesh.vs.hlsl", "#include \"common.hlsli\"\nvoid main() {}\n");
+    write_text(directory / "mesh.ps.hlsl", "void main() {}\n");
+    write_text(directory / "particles.ps.hlsl", "#include \"common.hlsli\"\nvoid main() {}\n");
+    write_text(directory / "clusters.cs.hlsl", "void main() {}\n");
+
+    // The objects are just ints, what matters is how long building them takes
+    static std::atomic<int> live_objects{ 0 };
+    const auto release = [](void* object) {
+        delete static_cast<int*>(object);
+        live_objects--;
+    };
+    const auto build = [build_ms]() -> void* {
+        std::this_thread::sleep_for(milliseconds(build_ms));
+        live_objects++;
+        return new int(0);
+    };
+    ShaderReloader reloader;
+    reloader.add("mesh", { "mesh.vs.hlsl", "mesh.ps.hlsl" }, build, release);
+    reloader.add("particles", { "particles.ps.hlsl" }, build, release);
+    reloader.add("clusters", { "clusters.cs.hlsl" }, build, release);
+    if (!reloader.start(directory.string())) {
+        return 1;
+    }
+    std::this_thread::sleep_for(milliseconds(100));
+
+    // The render loop: take the reloads, 1 ms of work, then wait for the next frame
+    std::atomic<bool> running{ true };
+    std::atomic<Clock::rep> edit_time{ 0 };
+    std::vector<double> frame_ms;
+    std::vector<double> take_us;
+    std::thread render_thread([&]() {
+        std::vector<ShaderReload> reloads;
+        auto next_frame = Clock::now();
+        while (running) {
+            const auto frame_start = Clock::now();
+            reloader.take_reloads(reloads);
+            take_us.push_back(duration<double, std::micro>(Clock::now() - frame_start).count());
+            for (const ShaderReload& reload : reloads) {
+                const double since_edit = duration<double, std::milli>(Clock::now() - Clock::time_point(Clock::duration(edit_time.load()))).count();
+                printf("    %-9s taken %.1f ms after the edit, ready after %.1f ms, built in %.1f ms\n", reload.name, since_edit,
+                       reload.latency_ms, reload.build_ms);
+                release(reload.object);
+            }
+            reloads.clear();
+            while (Clock::now() - frame_start < microseconds(1000)) {
+            }
+            frame_ms.push_back(duration<double, std::milli>(Clock::now() - frame_start).count());
+            next_frame += microseconds(4167);
+            std::this_thread::sleep_until(next_frame);
+        }
+    });
+
+    const auto edit = [&](const char* label, const char* file, const std::string& text, const int times) {
+        printf("%s\n", label);
+        edit_time = Clock::now().time_since_epoch().count();
+        for (int i = 0; i < times; ++i) {
+            write_text(directory / file, text + "// " + std::to_string(i) + "\n");
+            std::this_thread::sleep_for(milliseconds(8));
+        }
+        std::this_thread::sleep_for(milliseconds(build_ms * 3 + 300));
+    };
+    edit("common.hlsli changed, mesh and particles rebuild", "common.hlsli", "// common\n", 1);
+    edit("mesh.ps.hlsl changed", "mesh.ps.hlsl", "void main() {}\n", 1);
+    edit("clusters.cs.hlsl saved 5 times in 40 ms, rebuilds once", "clusters.cs.hlsl", "void main() {}\n", 5);
+    running = false;
+    render_thread.join();
+    reloader.stop();
+
+    const ShaderReloadStats stats = reloader.stats();
+    printf("%llu rebuilds, %llu superseded, worst latency %.1f ms, %d objects left\n", static_cast<unsigned long long>(stats.rebuilds),
+           static_cast<unsigned long long>(stats.superseded), stats.max_latency_ms, live_objects.load());
+    printf("%zu frames: frame p50 %.3f ms, p99 %.3f ms, worst %.3f ms | take_reloads p50 %.2f us, worst %.1f us\n", frame_ms.size(),
+           percentile(frame_ms, 0.5), percentile(frame_ms, 0.99), percentile(frame_ms, 1.0), percentile(take_us, 0.5), percentile(take_us, 1.0));
+    std::filesystem::remove_all(directory);
+    return 0;
+}
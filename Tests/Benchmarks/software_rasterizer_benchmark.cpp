@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "raster_scene.h"
+
+/* SOFTWARE RASTERIZER BENCHMARK
+* Triangle throughput of a whole draw, vertex shader to pixels, into a 1920x1080 target: random triangles of a few
+* sizes scattered over the screen, from ones smaller than a pixel, where setup and binning are all the work, to big
+* ones, where it's shading. Prints the best of at least 3 draws as triangles and shaded pixels per second.
+* Usage: software_rasterizer_benchmark [thread count, 0 for all]
+*/
+
+using namespace std::chrono;
+
+int main(const int argc, char** argv) {
+    const unsigned thread_count = argc > 1 ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 0;
+    constexpr uint32_t width = 1920;
+    constexpr uint32_t height = 1080;
+
+    struct Case {
+        float area;                 // In pixels
+        uint32_t triangle_count;
+    };
+    const Case cases[] = { { 0.5f, 1000000 }, { 8.0f, 500000 }, { 64.0f, 200000 }, { 512.0f, 50000 }, { 8192.0f, 5000 } };
+
+    SoftwareRenderTarget render_target;
+    render_target.resize(width, height);
+    if (thread_count == 0) {
+        printf("%ux%u, all threads\n", width, height);
+    }
+    else {
+        printf("%ux%u, %u threads\n", width, height, thread_count);
+    }
+    printf("area px  triangles  best ms  Mtriangles/s  Mpixels/s\n");
+    for (const Case& test_case : cases) {
+        // Right triangles with legs of sqrt(2 * area) pixels, in clip space
+        const float leg = std::sqrt(2.0f * test_case.area);
+        const float leg_x = 2.0f * leg / width;
+        const float leg_y = 2.0f * leg / height;
+        test::RasterScene scene;
+        uint32_t seed = 1;
+        for (uint32_t i = 0; i < test_case.triangle_count; ++i) {
+            const float x = test::random_float(seed, -1.0f, 1.0f - leg_x);
+            const float y = test::random_float(seed, -1.0f, 1.0f - leg_y);
+            const float z = test::random_float(seed, 0.1f, 0.9f);
+            const float a[4] = { x, y, z, 1.0f };
+            const float b[4] = { x + leg_x, y, z, 1.0f };
+            const float c[4] = { x, y + leg_y, z, 1.0f };
+            scene.add_triangle(a, b, c, i);
+        }
+        scene.pipeline_state.depth_enable = true;
+
+        SoftwareRasterizer rasterizer;
+        scene.bind(rasterizer, render_target, thread_count);
+        const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        double best_seconds = 1e30;
+        for (int run = 0; run < 3; ++run) {
+            render_target.clear_color(clear);
+            render_target.clear_depth(0.0f);
+            rasterizer.stats.reset();
+            const auto start = high_resolution_clock::now();
+            rasterizer.draw_indexed(test_case.triangle_count * 3, 0, 0);
+            best_seconds = std::min(best_seconds, duration<double>(high_resolution_clock::now() - start).count());
+        }
+        printf("%7.1f %10u %8.2f %13.2f %10.1f\n", test_case.area, test_case.triangle_count, best_seconds * 1000.0,
+               test_case.triangle_count / best_seconds / 1e6, rasterizer.stats.pixel_shader_invocations / best_seconds / 1e6);
+    }
+    return 0;
+}
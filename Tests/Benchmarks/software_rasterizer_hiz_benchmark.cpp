@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "raster_scene.h"
+
+/* SOFTWARE RASTERIZER HIERARCHICAL Z BENCHMARK
+* Overdraw: layers of overlapping triangles over a 1280x720 target, each layer covering most of the screen at its own
+* depth. Drawn front to back, hierarchical Z rejects whole blocks of every layer behind the first one. Drawn back to
+* front, nothing can be rejected and every layer gets shaded. Prints the best time of each order, and how many blocks
+* were rejected and pixels shaded.
+* Usage: software_rasterizer_hiz_benchmark [layer count]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    constexpr uint32_t width = 1280;
+    constexpr uint32_t height = 720;
+    constexpr uint32_t triangles_per_layer = 64;
+
+    // A layer of triangles over most of the screen, in a random jumble so the blocks they cover are partly shared
+    void add_layer(test::RasterScene& scene, const float z, uint32_t& seed, const uint32_t layer) {
+        for (uint32_t i = 0; i < triangles_per_layer; ++i) {
+            const float x = test::random_float(seed, -1.0f, 1.0f);
+            const float y = test::random_float(seed, -1.0f, 1.0f);
+            float vertices[3][4];
+            for (auto& vertex : vertices) {
+                vertex[0] = x + test::random_float(seed, -0.5f, 0.5f);
+                vertex[1] = y + test::random_float(seed, -0.5f, 0.5f);
+                vertex[2] = z;
+                vertex[3] = 1.0f;
+            }
+            scene.add_triangle(vertices[0], vertices[1], vertices[2], layer);
+        }
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t layer_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 16;
+
+    // Reverse Z: greater is closer, so front to back is from the largest depth down
+    test::RasterScene front_to_back;
+    test::RasterScene back_to_front;
+    const uint32_t seed = 7;
+    for (uint32_t layer = 0; layer < layer_count; ++layer) {
+        uint32_t layer_seed = seed + layer;
+        add_layer(front_to_back, 0.9f - 0.8f * layer / layer_count, layer_seed, layer);
+        layer_seed = seed + (layer_count - 1 - layer);
+        add_layer(back_to_front, 0.9f - 0.8f * (layer_count - 1 - layer) / layer_count, layer_seed, layer_count - 1 - layer);
+    }
+
+    SoftwareRenderTarget render_target;
+    render_target.resize(width, height);
+    printf("%ux%u, %u layers of %u triangles\n", width, height, layer_count, triangles_per_layer);
+    printf("order          best ms  blocks  rejected  accepted  PS invocations\n");
+    std::vector<uint32_t> images[2];
+    int order = 0;
+    for (test::RasterScene* scene : { &front_to_back, &back_to_front }) {
+        scene->pipeline_state.depth_enable = true;
+        SoftwareRasterizer rasterizer;
+        scene->bind(rasterizer, render_target, 0);
+        const uint32_t index_count = static_cast<uint32_t>(scene->indices.size());
+        const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        // At least 3 draws and at least half a second, the best one counts
+        double best_seconds = 1e30;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.5; ++run) {
+            render_target.clear_color(clear);
+            render_target.clear_depth(0.0f);
+            rasterizer.stats.reset();
+            const auto run_start = high_resolution_clock::now();
+            rasterizer.draw_indexed(index_count, 0, 0);
+            best_seconds = std::min(best_seconds, duration<double>(high_resolution_clock::now() - run_start).count());
+        }
+        const RasterStats& stats = rasterizer.stats;
+        printf("%-13s %8.2f %7llu %9llu %9llu %15llu\n", order == 0 ? "front to back" : "back to front", best_seconds * 1000.0,
+               static_cast<unsigned long long>(stats.blocks_visited), static_cast<unsigned long long>(stats.blocks_rejected_hiz),
+               static_cast<unsigned long long>(stats.blocks_accepted_hiz), static_cast<unsigned long long>(stats.pixel_shader_invocations));
+        images[order++] = test::resolve_color(render_target);
+    }
+
+    // Both orders have to end up with the same image, or the savings don't mean anything
+    if (images[0] != images[1]) {
+        printf("[ERROR] The two orders drew different images\n");
+        return 1;
+    }
+    return 0;
+}
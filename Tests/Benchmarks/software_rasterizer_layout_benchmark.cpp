@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "software_rasterizer.h"
+
+/* SOFTWARE RASTERIZER LAYOUT BENCHMARK
+* The render target stored block by block against a row major image, for what the rasterizer does with it: reading
+* and writing 8x8 blocks in tile order (64x64 pixel tiles, like the binner hands them out), clearing, and getting a
+* row major image back. The clear of the blocks is only setting flags, the first draw into a block pays for filling
+* it, so that's timed together with a pass over every block. Prints GB/s of pixels touched, best of at least 3.
+* Usage: software_rasterizer_layout_benchmark [width height]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    template <typename Work>
+    double best_time(const Work& work) {
+        double best = 1e30;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.25; ++run) {
+            const auto run_start = high_resolution_clock::now();
+            work();
+            best = std::min(best, duration<double>(high_resolution_clock::now() - run_start).count());
+        }
+        return best;
+    }
+
+    void print_bandwidth(const char* name, const size_t bytes, const double seconds) {
+        printf("%-36s %8.3f ms %8.2f GB/s\n", name, seconds * 1000.0, static_cast<double>(bytes) / seconds / 1e9);
+    }
+
+    // Calls block(block_x, block_y) for every 8x8 block, tile by tile
+    template <typename Block>
+    void for_each_block_in_tile_order(const uint32_t blocks_x, const uint32_t blocks_y, const Block& block) {
+        constexpr uint32_t tile_blocks = raster_tile_size / raster_block_size;
+        for (uint32_t tile_y = 0; tile_y < blocks_y; tile_y += tile_blocks) {
+            for (uint32_t tile_x = 0; tile_x < blocks_x; tile_x += tile_blocks) {
+                for (uint32_t block_y = tile_y; block_y < std::min(tile_y + tile_blocks, blocks_y); ++block_y) {
+                    for (uint32_t block_x = tile_x; block_x < std::min(tile_x + tile_blocks, blocks_x); ++block_x) {
+                        block(block_x, block_y);
+                    }
+                }
+            }
+        }
+    }
+
+    // What the pixel shader stores do to a block row: read the 8 pixels, change them, write them back
+    inline void update_row(uint32_t* row) {
+        uint32_t pixels[raster_block_size];
+        memcpy(pixels, row, sizeof(pixels));
+        for (uint32_t& pixel : pixels) {
+            pixel = pixel * 3 + 1;
+        }
+        memcpy(row, pixels, sizeof(pixels));
+    }
+}
+
+int main(const int argc, char** argv) {
+    // Full blocks only, so both layouts touch exactly the same pixels
+    const uint32_t width = (argc > 2 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1920) / raster_block_size * raster_block_size;
+    const uint32_t height = (argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 1080) / raster_block_size * raster_block_size;
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+    const size_t bytes = pixel_count * sizeof(uint32_t);
+    printf("%ux%u, %.1f MB per layout\n", width, height, bytes / (1024.0 * 1024.0));
+
+    SoftwareRenderTarget tiled;
+    tiled.resize(width, height);
+    std::vector<uint32_t> linear(pixel_count, 0);
+    std::vector<uint32_t> resolved(pixel_count, 0);
+    const uint32_t blocks_x = tiled.blocks_x;
+    const uint32_t blocks_y = tiled.blocks_y;
+
+    print_bandwidth("blocks in tile order, tiled", bytes * 2, best_time([&]() {
+        for_each_block_in_tile_order(blocks_x, blocks_y, [&](const uint32_t block_x, const uint32_t block_y) {
+            uint32_t* block = tiled.color.data() + (static_cast<size_t>(block_y) * blocks_x + block_x) * raster_block_pixels;
+            for (uint32_t row = 0; row < raster_block_size; ++row) {
+                update_row(block + row * raster_block_size);
+            }
+        });
+    }));
+    print_bandwidth("blocks in tile order, linear", bytes * 2, best_time([&]() {
+        for_each_block_in_tile_order(blocks_x, blocks_y, [&](const uint32_t block_x, const uint32_t block_y) {
+            uint32_t* block = linear.data() + static_cast<size_t>(block_y) * raster_block_size * width + block_x * raster_block_size;
+            for (uint32_t row = 0; row < raster_block_size; ++row) {
+                update_row(block + row * width);
+            }
+        });
+    }));
+
+    const float clear_color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+    print_bandwidth("clear, tiled flags", bytes, best_time([&]() { tiled.clear_color(clear_color); }));
+    const uint32_t clear_value = tiled.clear_color_value;
+    print_bandwidth("clear, linear fill", bytes, best_time([&]() { std::fill(linear.begin(), linear.end(), clear_value); }));
+    print_bandwidth("clear and first draw, tiled", bytes * 3, best_time([&]() {
+        tiled.clear_color(clear_color);
+        for_each_block_in_tile_order(blocks_x, blocks_y, [&](const uint32_t block_x, const uint32_t block_y) {
+            const uint32_t block_index = block_y * blocks_x + block_x;
+            tiled.prepare_block(block_index);
+            uint32_t* block = tiled.color.data() + static_cast<size_t>(block_index) * raster_block_pixels;
+            for (uint32_t row = 0; row < raster_block_size; ++row) {
+                update_row(block + row * raster_block_size);
+            }
+        });
+    }));
+    print_bandwidth("clear and first draw, linear", bytes * 3, best_time([&]() {
+        std::fill(linear.begin(), linear.end(), clear_value);
+        for_each_block_in_tile_order(blocks_x, blocks_y, [&](const uint32_t block_x, const uint32_t block_y) {
+            uint32_t* block = linear.data() + static_cast<size_t>(block_y) * raster_block_size * width + block_x * raster_block_size;
+            for (uint32_t row = 0; row < raster_block_size; ++row) {
+                update_row(block + row * width);
+            }
+        });
+    }));
+
+    // Drawn blocks, and then blocks that are all still cleared
+    for_each_block_in_tile_order(blocks_x, blocks_y, [&](const uint32_t block_x, const uint32_t block_y) {
+        tiled.prepare_block(block_y * blocks_x + block_x);
+    });
+    print_bandwidth("resolve to linear, tiled", bytes * 2, best_time([&]() { tiled.resolve_color(resolved.data(), width); }));
+    print_bandwidth("copy, linear", bytes * 2, best_time([&]() { memcpy(resolved.data(), linear.data(), bytes); }));
+    tiled.clear_color(clear_color);
+    print_bandwidth("resolve cleared to linear, tiled", bytes, best_time([&]() { tiled.resolve_color(resolved.data(), width); }));
+    return 0;
+}
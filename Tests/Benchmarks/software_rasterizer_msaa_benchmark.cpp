@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "raster_scene.h"
+
+/* SOFTWARE RASTERIZER MSAA BENCHMARK
+* Draws and resolves a scene of overlapping triangles into a 1920x1080 target at 1x, 2x, 4x and 8x MSAA. Prints the
+* best draw and resolve times, how many pixels got their samples expanded, and the memory the render target takes
+* with compressed sample colors against what storing every sample's color would take.
+* Usage: software_rasterizer_msaa_benchmark [triangle count]
+*/
+
+using namespace std::chrono;
+
+int main(const int argc, char** argv) {
+    const uint32_t triangle_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 20000;
+    constexpr uint32_t width = 1920;
+    constexpr uint32_t height = 1080;
+
+    test::RasterScene scene;
+    uint32_t seed = 5;
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        const float x = test::random_float(seed, -1.1f, 1.1f);
+        const float y = test::random_float(seed, -1.1f, 1.1f);
+        const float size = test::random_float(seed, 0.01f, 0.1f);
+        float vertices[3][4];
+        for (auto& vertex : vertices) {
+            vertex[0] = x + test::random_float(seed, -size, size);
+            vertex[1] = y + test::random_float(seed, -size, size);
+            vertex[2] = test::random_float(seed, 0.1f, 0.9f);
+            vertex[3] = 1.0f;
+        }
+        scene.add_triangle(vertices[0], vertices[1], vertices[2], i);
+    }
+    scene.pipeline_state.depth_enable = true;
+
+    printf("%ux%u, %u triangles\n", width, height, triangle_count);
+    printf("samples  draw ms  resolve ms  Mpixels/s  expanded  memory MB  uncompressed MB\n");
+    std::vector<uint32_t> resolved(static_cast<size_t>(width) * height);
+    for (const uint32_t sample_count : { 1u, 2u, 4u, 8u }) {
+        SoftwareRenderTarget render_target;
+        render_target.resize(width, height, sample_count);
+        SoftwareRasterizer rasterizer;
+        scene.bind(rasterizer, render_target, 0);
+        const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        double best_draw = 1e30;
+        double best_resolve = 1e30;
+        for (int run = 0; run < 3; ++run) {
+            render_target.clear_color(clear);
+            render_target.clear_depth(0.0f);
+            rasterizer.stats.reset();
+            const auto start = high_resolution_clock::now();
+            rasterizer.draw_indexed(triangle_count * 3, 0, 0);
+            const auto draw_end = high_resolution_clock::now();
+            render_target.resolve_color(resolved.data(), width);
+            best_draw = std::min(best_draw, duration<double>(draw_end - start).count());
+            best_resolve = std::min(best_resolve, duration<double>(high_resolution_clock::now() - draw_end).count());
+        }
+
+        uint64_t expanded = 0;
+        for (size_t block = 0; block < render_target.expanded_pixels.size(); ++block) {
+            if ((render_target.cleared_blocks[block] & 1) != 0) {
+                continue;
+            }
+            for (uint64_t pixels = render_target.expanded_pixels[block]; pixels != 0; pixels &= pixels - 1) {
+                ++expanded;
+            }
+        }
+        // A color for every sample instead of one per pixel plus the expanded ones, the rest as it is
+        const size_t all_sample_colors = render_target.color.size() * sample_count * sizeof(uint32_t);
+        size_t allocated_sample_colors = render_target.color.size() * sizeof(uint32_t);
+        for (const auto& block : render_target.sample_colors) {
+            if (block) {
+                allocated_sample_colors += sizeof(SampleColorBlock) + block->colors.capacity() * sizeof(uint32_t);
+            }
+        }
+        const size_t uncompressed = render_target.memory_size() - allocated_sample_colors + all_sample_colors;
+        printf("%7u %8.2f %11.2f %10.1f %9llu %10.1f %16.1f\n", sample_count, best_draw * 1000.0, best_resolve * 1000.0,
+               rasterizer.stats.pixel_shader_invocations / best_draw / 1e6, static_cast<unsigned long long>(expanded),
+               render_target.memory_size() / (1024.0 * 1024.0), uncompressed / (1024.0 * 1024.0));
+    }
+    return 0;
+}
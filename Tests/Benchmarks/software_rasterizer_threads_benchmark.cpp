@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "raster_scene.h"
+
+/* SOFTWARE RASTERIZER THREAD SCALING BENCHMARK
+* The same draw with 1 to 64 threads, for how far binning into per-thread arenas and the tile merge scale: a scene of
+* many small triangles, where binning is most of the work, and one of fewer big overlapping ones, where tiles are
+* unevenly loaded and work stealing matters. Prints the best of at least 3 draws for each thread count, the speedup
+* over one thread and how many tiles were stolen. Every thread count has to draw the same image.
+* Usage: software_rasterizer_threads_benchmark [max thread count]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    // Triangles of up to `size` in clip space, crowded toward the top left so the tiles get uneven amounts of work
+    void add_triangles(test::RasterScene& scene, const uint32_t count, const float size, uint32_t seed) {
+        for (uint32_t i = 0; i < count; ++i) {
+            const float u = test::random_float(seed, 0.0f, 1.0f);
+            const float v = test::random_float(seed, 0.0f, 1.0f);
+            const float x = -1.0f + 2.0f * u * u;
+            const float y = 1.0f - 2.0f * v * v;
+            float vertices[3][4];
+            for (auto& vertex : vertices) {
+                vertex[0] = x + test::random_float(seed, -size, size);
+                vertex[1] = y + test::random_float(seed, -size, size);
+                vertex[2] = test::random_float(seed, 0.1f, 0.9f);
+                vertex[3] = 1.0f;
+            }
+            scene.add_triangle(vertices[0], vertices[1], vertices[2], i);
+        }
+        scene.pipeline_state.depth_enable = true;
+    }
+}
+
+int main(const int argc, char** argv) {
+    const unsigned max_thread_count = argc > 1 ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 64;
+    constexpr uint32_t width = 1920;
+    constexpr uint32_t height = 1080;
+
+    test::RasterScene small_triangles;
+    add_triangles(small_triangles, 400000, 0.01f, 1);
+    test::RasterScene big_triangles;
+    add_triangles(big_triangles, 4000, 0.3f, 2);
+    struct Case {
+        const char* name;
+        test::RasterScene* scene;
+    };
+    const Case cases[] = { { "400k small triangles", &small_triangles }, { "4k big triangles", &big_triangles } };
+
+    SoftwareRenderTarget render_target;
+    render_target.resize(width, height);
+    printf("%ux%u, %u hardware threads\n", width, height, std::thread::hardware_concurrency());
+    bool deterministic = true;
+    for (const Case& test_case : cases) {
+        printf("%s\nthreads  best ms  speedup  tiles stolen\n", test_case.name);
+        const uint32_t index_count = static_cast<uint32_t>(test_case.scene->indices.size());
+        const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        double single_thread_seconds = 0.0;
+        std::vector<uint32_t> expected;
+        for (unsigned thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+            SoftwareRasterizer rasterizer;
+            test_case.scene->bind(rasterizer, render_target, thread_count);
+            double best_seconds = 1e30;
+            for (int run = 0; run < 3; ++run) {
+                render_target.clear_color(clear);
+                render_target.clear_depth(0.0f);
+                rasterizer.stats.reset();
+                const auto start = high_resolution_clock::now();
+                rasterizer.draw_indexed(index_count, 0, 0);
+                best_seconds = std::min(best_seconds, duration<double>(high_resolution_clock::now() - start).count());
+            }
+            if (thread_count == 1) {
+                single_thread_seconds = best_seconds;
+                expected = test::resolve_color(render_target);
+            }
+            else if (test::resolve_color(render_target) != expected) {
+                printf("[ERROR] %u threads drew a different image than one thread\n", thread_count);
+                deterministic = false;
+            }
+            printf("%7u %8.2f %8.2f %13llu\n", thread_count, best_seconds * 1000.0, single_thread_seconds / best_seconds,
+                   static_cast<unsigned long long>(rasterizer.stats.tiles_stolen));
+        }
+    }
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "raster_scene.h"
+
+/* SOFTWARE RASTERIZER VARIABLE RATE SHADING BENCHMARK
+* Layers of big triangles over a 1920x1080 target, without depth so every layer gets shaded, at every shading rate
+* for the whole draw, and with a shading rate image that keeps the middle of the screen at 1x1 and goes down to 4x4
+* toward the edges. Prints the best of at least 3 draws and the pixel shader invocations next to the 1x1 ones.
+* Usage: software_rasterizer_vrs_benchmark [layer count]
+*/
+
+using namespace std::chrono;
+
+int main(const int argc, char** argv) {
+    const uint32_t layer_count = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 8;
+    constexpr uint32_t width = 1920;
+    constexpr uint32_t height = 1080;
+
+    const uint32_t triangle_count = layer_count * 16;
+    test::RasterScene scene;
+    uint32_t seed = 3;
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        const float x = test::random_float(seed, -0.8f, 0.8f);
+        const float y = test::random_float(seed, -0.8f, 0.8f);
+        float vertices[3][4];
+        for (auto& vertex : vertices) {
+            vertex[0] = x + test::random_float(seed, -0.6f, 0.6f);
+            vertex[1] = y + test::random_float(seed, -0.6f, 0.6f);
+            vertex[2] = 0.5f;
+            vertex[3] = 1.0f;
+        }
+        scene.add_triangle(vertices[0], vertices[1], vertices[2], i);
+    }
+
+    // Foveated: 1x1 in the middle, 2x2 around it, 4x4 at the edges
+    const uint32_t image_width = (width + raster_shading_rate_tile_size - 1) / raster_shading_rate_tile_size;
+    const uint32_t image_height = (height + raster_shading_rate_tile_size - 1) / raster_shading_rate_tile_size;
+    std::vector<uint8_t> foveated(static_cast<size_t>(image_width) * image_height);
+    for (uint32_t y = 0; y < image_height; ++y) {
+        for (uint32_t x = 0; x < image_width; ++x) {
+            const float dx = (x + 0.5f) / image_width * 2.0f - 1.0f;
+            const float dy = (y + 0.5f) / image_height * 2.0f - 1.0f;
+            const float distance = dx * dx + dy * dy;
+            const ShadingRate rate = distance < 0.15f ? ShadingRate::rate_1x1 : distance < 0.5f ? ShadingRate::rate_2x2 : ShadingRate::rate_4x4;
+            foveated[y * image_width + x] = static_cast<uint8_t>(rate);
+        }
+    }
+
+    struct Case {
+        const char* name;
+        ShadingRate rate;
+        const uint8_t* image;
+    };
+    const Case cases[] = {
+        { "1x1", ShadingRate::rate_1x1, nullptr }, { "1x2", ShadingRate::rate_1x2, nullptr }, { "2x1", ShadingRate::rate_2x1, nullptr },
+        { "2x2", ShadingRate::rate_2x2, nullptr }, { "2x4", ShadingRate::rate_2x4, nullptr }, { "4x2", ShadingRate::rate_4x2, nullptr },
+        { "4x4", ShadingRate::rate_4x4, nullptr }, { "foveated image", ShadingRate::rate_1x1, foveated.data() },
+    };
+
+    SoftwareRenderTarget render_target;
+    render_target.resize(width, height);
+    printf("%ux%u, %u triangles\n", width, height, triangle_count);
+    printf("rate            best ms  PS invocations  of 1x1\n");
+    uint64_t full_rate_invocations = 0;
+    for (const Case& test_case : cases) {
+        scene.pipeline_state.shading_rate = test_case.rate;
+        scene.pipeline_state.shading_rate_combiner = test_case.image ? ShadingRateCombiner::override : ShadingRateCombiner::passthrough;
+        SoftwareRasterizer rasterizer;
+        scene.bind(rasterizer, render_target, 0);
+        rasterizer.set_shading_rate_image(test_case.image, image_width, image_height);
+        const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        double best_seconds = 1e30;
+        for (int run = 0; run < 3; ++run) {
+            render_target.clear_color(clear);
+            rasterizer.stats.reset();
+            const auto start = high_resolution_clock::now();
+            rasterizer.draw_indexed(triangle_count * 3, 0, 0);
+            best_seconds = std::min(best_seconds, duration<double>(high_resolution_clock::now() - start).count());
+        }
+        const uint64_t invocations = rasterizer.stats.pixel_shader_invocations;
+        if (full_rate_invocations == 0) {
+            full_rate_invocations = invocations;
+        }
+        printf("%-15s %7.2f %15llu %6.1f%%\n", test_case.name, best_seconds * 1000.0, static_cast<unsigned long long>(invocations),
+               100.0 * invocations / full_rate_invocations);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "texture_atlas.h"
+
+/* TEXTURE ATLAS BENCHMARK
+* Packs and blits 100k random sprites between 8 and 64 pixels into 4096x4096 pages, with 2 pixels of padding and
+* borders for 3 mip levels. Prints the page count, packing efficiency and the time of every step.
+* Usage: texture_atlas_benchmark [sprite count]
+*/
+
+int main(const int argc, char** argv) {
+    const size_t sprite_count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+
+    uint32_t seed = 1;
+    const auto random_size = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return 8 + (seed >> 8) % 57;
+    };
+    std::vector<AtlasImage> images(sprite_count);
+    std::vector<std::vector<uint8_t>> pixels(sprite_count);
+    for (size_t i = 0; i < sprite_count; ++i) {
+        images[i].width = random_size();
+        images[i].height = random_size();
+        pixels[i].assign(static_cast<size_t>(images[i].width) * images[i].height * 4, static_cast<uint8_t>(i));
+        images[i].pixels = pixels[i].data();
+    }
+
+    AtlasSettings settings;
+    settings.padding = 2;
+    settings.mip_levels = 3;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    TextureAtlas atlas;
+    const bool all_fit = build_atlas(images, settings, atlas);
+    const double total_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    printf("%zu sprites: %zu pages, %.1f%% efficiency, %s\n", sprite_count, atlas.pages.size(), atlas.stats.efficiency() * 100.0f,
+        all_fit ? "all fit" : "some didn't fit");
+    printf("pack %.1f ms, blit %.1f ms, total %.1f ms\n", atlas.stats.pack_seconds * 1000.0, atlas.stats.blit_seconds * 1000.0, total_ms);
+    return all_fit ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "test_images.h"
+#include "texture_convert.h"
+#include "texture_loader.h"
+
+/* TEXTURE CONVERSION BENCHMARK
+* Throughput of the conversions textures go through between stb_image and upload memory: the 16-bit byte swap of
+* PNG data against the per-sample loop stb_image has, and convert_image() from each decoded precision to the formats
+* it's used for. Then the decode of a 16-bit PNG, which does its swap with swap_bytes_16(). Sizes are in MB of input.
+* Usage: texture_convert_benchmark [image size]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    // Runs `work` until a quarter of a second has passed, at least 3 times, and returns the fastest run in seconds
+    template <typename Work>
+    double best_time(const Work& work) {
+        double best = 1e30;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.25; ++run) {
+            const auto run_start = high_resolution_clock::now();
+            work();
+            best = std::min(best, duration<double>(high_resolution_clock::now() - run_start).count());
+        }
+        return best;
+    }
+
+    void print_throughput(const char* name, const size_t bytes, const double seconds) {
+        printf("%-34s %8.1f MB/s\n", name, static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds);
+    }
+
+    // The loop stb_image has for this, kept here to compare against
+    void swap_bytes_16_stb(uint8_t* data, const size_t count) {
+        uint16_t* data16 = reinterpret_cast<uint16_t*>(data);
+        for (size_t i = 0; i < count; ++i, data += 2) {
+            data16[i] = static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+    }
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t size = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 2048;
+    const size_t pixel_count = static_cast<size_t>(size) * size;
+    printf("%ux%u\n", size, size);
+
+    std::vector<uint16_t> samples16(pixel_count * 4);
+    for (size_t i = 0; i < samples16.size(); ++i) {
+        samples16[i] = static_cast<uint16_t>(test::hash_u32(static_cast<uint32_t>(i)));
+    }
+    // In place, like stb_image does it. Swapping again every run just swaps it back.
+    std::vector<uint16_t> swapped = samples16;
+    const size_t bytes16 = swapped.size() * 2;
+    print_throughput("swap 16-bit, stb loop", bytes16, best_time([&]() { swap_bytes_16_stb(reinterpret_cast<uint8_t*>(swapped.data()), swapped.size()); }));
+    print_throughput("swap 16-bit, swap_bytes_16", bytes16, best_time([&]() { swap_bytes_16(swapped.data(), swapped.data(), swapped.size()); }));
+
+    std::vector<uint8_t> samples8(pixel_count * 4);
+    for (size_t i = 0; i < samples8.size(); ++i) {
+        samples8[i] = static_cast<uint8_t>(samples16[i]);
+    }
+    std::vector<float> samples_float(pixel_count * 4);
+    for (size_t i = 0; i < samples_float.size(); ++i) {
+        samples_float[i] = samples16[i] / 4096.0f;
+    }
+    std::vector<uint8_t> destination(pixel_count * 16);
+
+    struct Conversion {
+        const char* name;
+        void* pixels;
+        int channels;
+        int bytes_per_channel;
+        TextureFormat format;
+        bool srgb;
+    };
+    const Conversion conversions[] = {
+        { "RGB8 to RGBA8", samples8.data(), 3, 1, TextureFormat::r8g8b8a8_unorm, false },
+        { "RGBA8 sRGB to RGBA16F", samples8.data(), 4, 1, TextureFormat::r16g16b16a16_float, true },
+        { "R16 to R16", samples16.data(), 1, 2, TextureFormat::r16_unorm, false },
+        { "RGBA16 to RGBA8", samples16.data(), 4, 2, TextureFormat::r8g8b8a8_unorm, false },
+        { "RG16 to RG16", samples16.data(), 2, 2, TextureFormat::r16g16_unorm, false },
+        { "RGB32F to RGBA16F", samples_float.data(), 3, 4, TextureFormat::r16g16b16a16_float, false },
+        { "RGB32F to RGB9E5", samples_float.data(), 3, 4, TextureFormat::r9g9b9e5_sharedexp, false },
+    };
+    bool all_converted = true;
+    for (const Conversion& conversion : conversions) {
+        DecodedImage image;
+        image.width = static_cast<int>(size);
+        image.height = static_cast<int>(size);
+        image.channels = conversion.channels;
+        image.bytes_per_channel = conversion.bytes_per_channel;
+        image.pixels = conversion.pixels;
+        const size_t row_pitch = size * texture_format_pixel_size(conversion.format);
+        const double seconds = best_time([&]() {
+            all_converted &= convert_image(image, conversion.format, conversion.srgb, destination.data(), row_pitch);
+        });
+        print_throughput(conversion.name, pixel_count * conversion.channels * conversion.bytes_per_channel, seconds);
+    }
+
+    // A whole 16-bit PNG decode, for how much of it the swap is
+    const std::vector<uint8_t> png = test::encode_png(test::make_test_image(size, size, 4, 16));
+    DecodeStats stats;
+    const double decode_seconds = best_time([&]() {
+        DecodedImage image;
+        all_converted &= decode_image_full_precision(png.data(), png.size(), image, &stats);
+        free_image(image);
+    });
+    print_throughput("decode RGBA16 PNG", stats.decoded_bytes, decode_seconds);
+    return all_converted ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "test_images.h"
+#include "texture_loader.h"
+
+/* TEXTURE DECODE BENCHMARK
+* Decodes a generated image of every format and the variants that decode differently (16-bit and interlaced PNG,
+* progressive JPEG, the RLE formats), the way the renderer loads textures. Prints the decoded MB/s, allocations and
+* peak memory of each, then the per-format totals from print_decode_report().
+* Usage: texture_decode_benchmark [image size]
+*/
+
+using namespace std::chrono;
+
+namespace {
+    struct Variant {
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+}
+
+int main(const int argc, char** argv) {
+    const uint32_t size = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1024;
+
+    const test::TestImage rgba = test::make_test_image(size, size, 4, 8);
+    const test::TestImage rgb = test::make_test_image(size, size, 3, 8);
+    const test::TestImage rgb16 = test::make_test_image(size, size, 3, 16);
+    const test::TestImage indices = test::make_test_image(size, size, 1, 8);
+    test::PngOptions interlaced;
+    interlaced.interlaced = true;
+    test::JpegOptions baseline;
+    test::JpegOptions progressive;
+    progressive.progressive = true;
+    test::JpegOptions restart;
+    restart.restart_interval = 4;
+    test::TgaOptions tga_rle;
+    tga_rle.rle = true;
+
+    std::vector<Variant> variants;
+    variants.push_back({ "PNG RGBA8", test::encode_png(rgba) });
+    variants.push_back({ "PNG RGBA8 interlaced", test::encode_png(rgba, interlaced) });
+    variants.push_back({ "PNG RGB16", test::encode_png(rgb16) });
+    variants.push_back({ "JPEG baseline", test::encode_jpeg(rgb, baseline) });
+    variants.push_back({ "JPEG restart markers", test::encode_jpeg(rgb, restart) });
+    variants.push_back({ "JPEG progressive", test::encode_jpeg(rgb, progressive) });
+    variants.push_back({ "HDR RLE", test::encode_hdr(rgb16, 64.0f, true) });
+    variants.push_back({ "TGA RGBA RLE", test::encode_tga(rgba, tga_rle) });
+    variants.push_back({ "BMP RGB", test::encode_bmp(rgb, 24, false) });
+    variants.push_back({ "GIF", test::encode_gif(indices, false, 1) });
+    variants.push_back({ "PSD RGBA RLE", test::encode_psd(rgba, true) });
+    variants.push_back({ "PSD RGB16", test::encode_psd(rgb16, false) });
+    variants.push_back({ "PIC RGBA mixed RLE", test::encode_pic(rgba, 2, false) });
+    variants.push_back({ "PNM RGB", test::encode_pnm(rgb, 255, false) });
+
+    reset_decode_totals();
+    printf("%ux%u\n", size, size);
+    printf("variant                encoded KB   MB/s  allocs  peak MB\n");
+    bool all_decoded = true;
+    for (const Variant& variant : variants) {
+        // At least 3 decodes and at least half a second, the best one counts
+        double best_seconds = 1e30;
+        DecodeStats stats;
+        size_t decoded_bytes = 0;
+        const auto start = high_resolution_clock::now();
+        for (int run = 0; run < 3 || duration<double>(high_resolution_clock::now() - start).count() < 0.5; ++run) {
+            DecodedImage image;
+            if (!decode_image_full_precision(variant.data.data(), variant.data.size(), image, &stats)) {
+                all_decoded = false;
+                break;
+            }
+            decoded_bytes = stats.decoded_bytes;
+            best_seconds = std::min(best_seconds, stats.decode_seconds);
+            free_image(image);
+        }
+        printf("%-22s %10.1f %6.1f %7u %8.2f\n", variant.name.c_str(), variant.data.size() / 1024.0,
+               decoded_bytes / (1024.0 * 1024.0) / best_seconds, stats.allocation_count, stats.peak_allocated_bytes / (1024.0 * 1024.0));
+    }
+    printf("\n");
+    print_decode_report();
+    return all_decoded ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "file_io.h"
+
+/* FUZZ CORPUS REPLAY
+* Stands in for libFuzzer's main() when the fuzzers aren't built with it (see Tests/CMakeLists.txt): every file and
+* every file in every directory on the command line goes through LLVMFuzzerTestOneInput() once. Arguments that start
+* with '-' are libFuzzer flags, which are ignored. A crash or an abort() in the fuzz target fails the test.
+*/
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+    void run_file(const std::string& path, size_t& run_count) {
+        size_t size = 0;
+        char* data = nullptr;
+        read_file(path, size, data, false);
+        if (!data) {
+            printf("[ERROR] Failed to read fuzz input '%s'\n", path.c_str());
+            exit(1);
+        }
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data), size);
+        free(data);
+        run_count++;
+    }
+}
+
+int main(const int argc, char** argv) {
+    size_t run_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-') {
+            continue;
+        }
+        if (std::filesystem::is_directory(argv[i])) {
+            // Sorted, so the order doesn't depend on the file system
+            std::vector<std::string> paths;
+            for (const auto& entry : std::filesystem::directory_iterator(argv[i])) {
+                if (entry.is_regular_file()) {
+                    paths.push_back(entry.path().string());
+                }
+            }
+            std::sort(paths.begin(), paths.end());
+            for (const auto& path : paths) {
+                run_file(path, run_count);
+            }
+        }
+        else {
+            run_file(argv[i], run_count);
+        }
+    }
+
+    if (run_count == 0) {
+        printf("[ERROR] No fuzz inputs given\n");
+        return 1;
+    }
+    printf("Ran %zu fuzz inputs\n", run_count);
+    return 0;
+}
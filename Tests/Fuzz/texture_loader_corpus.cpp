@@ -0,0 +1,300 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "file_io.h"
+#include "test_images.h"
+#include "texture_loader.h"
+
+/* TEXTURE LOADER CORPUS
+* Writes the seed corpus of the texture loader fuzzers: every format stb_image reads, in the variants that take their
+* own paths through its decoders (interlaced PNG of every color type and bit depth, baseline, restart marker and
+* progressive JPEG, raw and RLE PSD, each PIC packet compression, and so on), over a sweep of sizes that includes 1x1
+* and sizes that aren't a multiple of any block or filter size. Then some of them cut in half, and headers that are
+* too big, which have to be rejected.
+* Every file is decoded once as it's written, and one that doesn't decode (or decodes when it's too big) fails, so the
+* corpus can't silently turn into files that all stop at the header check. Cut files only have to not crash, some
+* decoders fill in what's missing.
+* Usage: texture_loader_corpus <directory>, Tests/Fuzz/corpus/texture_loader_fuzz to regenerate the checked in corpus
+*/
+
+namespace {
+    struct CorpusWriter {
+        std::string directory;
+        uint32_t file_count = 0;
+        uint32_t failure_count = 0;
+
+        // `channels` is what the file decodes to, 0 for a file that has to fail, -1 for one that may do either
+        void add(const std::string& name, const std::vector<uint8_t>& data, const uint32_t width, const uint32_t height, const int channels) {
+            const std::string path = directory + "/" + name;
+            if (!write_file(path, data.data(), data.size(), false)) {
+                printf("[ERROR] Failed to write '%s'\n", path.c_str());
+                failure_count++;
+                return;
+            }
+            file_count++;
+
+            DecodedImage image;
+            const bool success = decode_image_full_precision(data.data(), data.size(), image);
+            const bool expected = success && image.width == static_cast<int>(width) && image.height == static_cast<int>(height) &&
+                                  image.channels == channels;
+            if (channels >= 0 && (channels == 0 ? success : !expected)) {
+                printf("[ERROR] '%s' decoded as %ix%i with %i channels, expected %s\n", name.c_str(), image.width, image.height,
+                       image.channels, channels == 0 ? "a failure" : (std::to_string(width) + "x" + std::to_string(height)).c_str());
+                failure_count++;
+            }
+            free_image(image);
+        }
+
+        // A valid file, then the first half of it
+        void add_with_truncated(const std::string& name, const std::vector<uint8_t>& data, const uint32_t width, const uint32_t height,
+                                const int channels) {
+            add(name, data, width, height, channels);
+            const size_t dot = name.rfind('.');
+            add(name.substr(0, dot) + "_truncated" + name.substr(dot), std::vector<uint8_t>(data.begin(), data.begin() + data.size() / 2), 0, 0, -1);
+        }
+    };
+
+    struct Size {
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // 1x1, odd sizes that don't line up with PNG passes, JPEG blocks or RLE runs, and one that's a bit bigger
+    const Size sizes[] = { { 1, 1 }, { 7, 3 }, { 33, 17 } };
+
+    std::string size_name(const Size& size) {
+        return std::to_string(size.width) + "x" + std::to_string(size.height);
+    }
+
+    void add_png(CorpusWriter& writer) {
+        struct PngVariant {
+            const char* name;
+            uint32_t channels;
+            bool paletted;
+            std::vector<uint32_t> bit_depths;
+        };
+        const PngVariant variants[] = {
+            { "gray", 1, false, { 1, 2, 4, 8, 16 } },
+            { "gray_alpha", 2, false, { 8, 16 } },
+            { "rgb", 3, false, { 8, 16 } },
+            { "rgba", 4, false, { 8, 16 } },
+            { "palette", 1, true, { 1, 2, 4, 8 } },
+        };
+        for (const PngVariant& variant : variants) {
+            for (const uint32_t bits : variant.bit_depths) {
+                for (const Size& size : sizes) {
+                    for (const bool interlaced : { false, true }) {
+                        test::PngOptions options;
+                        options.interlaced = interlaced;
+                        options.paletted = variant.paletted;
+                        const test::TestImage image = test::make_test_image(size.width, size.height, variant.channels, bits);
+                        const std::string name = std::string("png_") + variant.name + std::to_string(bits) + "_" + size_name(size) +
+                                                 (interlaced ? "_interlaced" : "") + ".png";
+                        writer.add(name, test::encode_png(image, options), size.width, size.height, variant.paletted ? 3 : variant.channels);
+                    }
+                }
+            }
+        }
+
+        // Transparency from tRNS adds an alpha channel, IDATs split into many chunks, and an ancillary chunk to skip
+        const test::TestImage palette = test::make_test_image(33, 17, 1, 4);
+        test::PngOptions options;
+        options.paletted = true;
+        options.transparency = true;
+        options.interlaced = true;
+        writer.add("png_palette4_trns_interlaced.png", test::encode_png(palette, options), 33, 17, 4);
+        const test::TestImage rgb = test::make_test_image(33, 17, 3, 16);
+        options = {};
+        options.transparency = true;
+        writer.add("png_rgb16_trns.png", test::encode_png(rgb, options), 33, 17, 4);
+        const test::TestImage rgba = test::make_test_image(33, 17, 4, 8);
+        options = {};
+        options.idat_size = 7;
+        options.text_chunk = true;
+        writer.add_with_truncated("png_rgba8_split_idat.png", test::encode_png(rgba, options), 33, 17, 4);
+
+        // A header that's far over the decode limits
+        std::vector<uint8_t> huge = test::encode_png(test::make_test_image(1, 1, 4, 8));
+        const uint8_t huge_size[8] = { 0, 1, 0, 0, 0, 1, 0, 0 };
+        memcpy(&huge[16], huge_size, sizeof(huge_size));
+        const uint32_t crc = test::png_crc(&huge[12], 17) ^ 0xFFFFFFFFu;
+        const uint8_t crc_bytes[4] = { static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc) };
+        memcpy(&huge[29], crc_bytes, sizeof(crc_bytes));
+        writer.add("png_huge.png", huge, 0, 0, 0);
+    }
+
+    void add_jpeg(CorpusWriter& writer) {
+        struct JpegVariant {
+            const char* name;
+            bool progressive;
+            uint32_t restart_interval;
+        };
+        const JpegVariant variants[] = { { "baseline", false, 0 }, { "restart1", false, 1 }, { "restart3", false, 3 }, { "progressive", true, 0 },
+                                         { "progressive_restart2", true, 2 } };
+        const Size jpeg_sizes[] = { { 1, 1 }, { 13, 9 }, { 40, 24 } };
+        for (const JpegVariant& variant : variants) {
+            for (const Size& size : jpeg_sizes) {
+                for (const uint32_t channels : { 1u, 3u }) {
+                    for (const bool subsampled : { false, true }) {
+                        if (channels == 1 && subsampled) {
+                            continue;
+                        }
+                        test::JpegOptions options;
+                        options.progressive = variant.progressive;
+                        options.restart_interval = variant.restart_interval;
+                        options.subsampled = subsampled;
+                        const test::TestImage image = test::make_test_image(size.width, size.height, channels, 8);
+                        const std::string name = std::string("jpeg_") + variant.name + (channels == 1 ? "_gray_" : subsampled ? "_420_" : "_444_") +
+                                                 size_name(size) + ".jpg";
+                        writer.add(name, test::encode_jpeg(image, options), size.width, size.height, static_cast<int>(channels));
+                    }
+                }
+            }
+        }
+        test::JpegOptions options;
+        options.progressive = true;
+        options.quality = 30;
+        writer.add_with_truncated("jpeg_progressive_q30.jpg", test::encode_jpeg(test::make_test_image(40, 24, 3, 8), options), 40, 24, 3);
+        options = {};
+        options.restart_interval = 1;
+        options.quality = 98;
+        writer.add_with_truncated("jpeg_restart1_q98.jpg", test::encode_jpeg(test::make_test_image(40, 24, 3, 8), options), 40, 24, 3);
+    }
+
+    void add_psd(CorpusWriter& writer) {
+        const Size psd_sizes[] = { { 1, 1 }, { 13, 9 } };
+        for (const uint32_t bits : { 8u, 16u }) {
+            for (const uint32_t channels : { 3u, 4u, 5u }) {
+                for (const Size& size : psd_sizes) {
+                    for (const bool rle : { false, true }) {
+                        // stb_image only reads 16-bit PSDs raw
+                        if (bits == 16 && rle) {
+                            continue;
+                        }
+                        const test::TestImage image = test::make_test_image(size.width, size.height, channels, bits);
+                        const std::string name = "psd_" + std::to_string(channels) + "x" + std::to_string(bits) + "_" + size_name(size) +
+                                                 (rle ? "_rle" : "_raw") + ".psd";
+                        writer.add(name, test::encode_psd(image, rle), size.width, size.height, 4);
+                    }
+                }
+            }
+        }
+        // Two levels stored as 8 bits, for runs longer than a PackBits run
+        test::TestImage runs = test::make_test_image(300, 2, 3, 1);
+        runs.bits = 8;
+        writer.add_with_truncated("psd_rle_long_runs.psd", test::encode_psd(runs, true), 300, 2, 4);
+    }
+
+    void add_pic(CorpusWriter& writer) {
+        for (const uint8_t compression : { 0, 1, 2 }) {
+            for (const uint32_t channels : { 3u, 4u }) {
+                for (const bool separate_alpha : { false, true }) {
+                    if (channels == 3 && separate_alpha) {
+                        continue;
+                    }
+                    for (const Size& size : sizes) {
+                        const test::TestImage image = test::make_test_image(size.width, size.height, channels, 8);
+                        const std::string name = "pic_" + std::string(channels == 3 ? "rgb" : separate_alpha ? "rgb_alpha" : "rgba") + "_c" +
+                                                 std::to_string(compression) + "_" + size_name(size) + ".pic";
+                        writer.add(name, test::encode_pic(image, compression, separate_alpha), size.width, size.height, static_cast<int>(channels));
+                    }
+                }
+            }
+        }
+        // Runs longer than 128, which mixed packets store with a 16-bit count
+        writer.add_with_truncated("pic_rgba_c2_long_runs.pic", test::encode_pic(test::make_test_image(300, 3, 4, 1), 2, true), 300, 3, 4);
+    }
+
+    void add_other_formats(CorpusWriter& writer) {
+        for (const Size& size : sizes) {
+            writer.add("pnm_gray_" + size_name(size) + ".pgm", test::encode_pnm(test::make_test_image(size.width, size.height, 1, 8), 255, false),
+                       size.width, size.height, 1);
+            writer.add("pnm_rgb_" + size_name(size) + ".ppm", test::encode_pnm(test::make_test_image(size.width, size.height, 3, 8), 255, true),
+                       size.width, size.height, 3);
+        }
+        writer.add_with_truncated("pnm_rgb_max100.ppm", test::encode_pnm(test::make_test_image(33, 17, 3, 8), 100, true), 33, 17, 3);
+        writer.add("pnm_gray16.pgm", test::encode_pnm(test::make_test_image(7, 3, 1, 16), 65535, false), 0, 0, 0);
+
+        struct TgaVariant {
+            const char* name;
+            uint32_t channels;
+            uint32_t bits;
+            test::TgaOptions options;
+            int decoded_channels;
+        };
+        const TgaVariant tga_variants[] = {
+            { "gray", 1, 8, { 8, false, false, false }, 1 },
+            { "palette", 1, 4, { 8, true, false, false }, 3 },
+            { "rgb15", 3, 8, { 15, false, false, false }, 3 },
+            { "rgb16", 4, 8, { 16, false, false, true }, 3 },
+            { "rgb24", 3, 8, { 24, false, false, false }, 3 },
+            { "rgba32", 4, 8, { 32, false, false, true }, 4 },
+        };
+        for (const TgaVariant& variant : tga_variants) {
+            for (const bool rle : { false, true }) {
+                for (const Size& size : sizes) {
+                    test::TgaOptions options = variant.options;
+                    options.rle = rle;
+                    const test::TestImage image = test::make_test_image(size.width, size.height, variant.channels, variant.bits);
+                    const std::string name = std::string("tga_") + variant.name + (rle ? "_rle_" : "_") + size_name(size) + ".tga";
+                    writer.add(name, test::encode_tga(image, options), size.width, size.height, variant.decoded_channels);
+                }
+            }
+        }
+
+        for (const uint32_t bits : { 1u, 4u, 8u, 16u, 24u, 32u }) {
+            for (const bool top_down : { false, true }) {
+                for (const Size& size : sizes) {
+                    const bool paletted = bits <= 8;
+                    const test::TestImage image = test::make_test_image(size.width, size.height, paletted ? 1 : bits == 32 ? 4 : 3, paletted ? bits : 8);
+                    const std::string name = "bmp_" + std::to_string(bits) + (top_down ? "_top_down_" : "_") + size_name(size) + ".bmp";
+                    writer.add(name, test::encode_bmp(image, bits, top_down), size.width, size.height, bits == 32 ? 4 : 3);
+                }
+            }
+        }
+
+        const Size hdr_sizes[] = { { 1, 1 }, { 7, 3 }, { 40, 9 } };
+        for (const bool rle : { false, true }) {
+            for (const Size& size : hdr_sizes) {
+                const test::TestImage image = test::make_test_image(size.width, size.height, 3, 16);
+                const std::string name = std::string("hdr_") + (rle ? "rle_" : "flat_") + size_name(size) + ".hdr";
+                writer.add(name, test::encode_hdr(image, 64.0f, rle), size.width, size.height, 3);
+            }
+        }
+        writer.add_with_truncated("hdr_rle_bright.hdr", test::encode_hdr(test::make_test_image(300, 2, 3, 8), 60000.0f, true), 300, 2, 3);
+
+        for (const uint32_t bits : { 1u, 2u, 8u }) {
+            for (const bool interlaced : { false, true }) {
+                for (const Size& size : sizes) {
+                    const test::TestImage image = test::make_test_image(size.width, size.height, 1, bits);
+                    const std::string name = "gif_" + std::to_string(bits) + (interlaced ? "_interlaced_" : "_") + size_name(size) + ".gif";
+                    writer.add(name, test::encode_gif(image, interlaced, 1), size.width, size.height, 4);
+                }
+            }
+        }
+        writer.add_with_truncated("gif_animated.gif", test::encode_gif(test::make_test_image(33, 17, 1, 8), true, 3), 33, 17, 4);
+    }
+}
+
+int main(const int argc, char** argv) {
+    if (argc != 2) {
+        printf("Usage: %s <directory>\n", argv[0]);
+        return 1;
+    }
+    CorpusWriter writer;
+    writer.directory = argv[1];
+    std::filesystem::create_directories(writer.directory);
+
+    add_png(writer);
+    add_jpeg(writer);
+    add_psd(writer);
+    add_pic(writer);
+    add_other_formats(writer);
+
+    printf("Wrote %u files to %s, %u failed\n", writer.file_count, writer.directory.c_str(), writer.failure_count);
+    return writer.failure_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <cstdlib>
+#include "texture_loader.h"
+
+/* TEXTURE LOADER FUZZER
+* Feeds arbitrary bytes to the image decoders, the way a corrupt file on disk would reach them. Every input is decoded
+* the way the renderer decodes textures and at full precision, and once more with an allocation budget that's too
+* small for most images, so the budget checks in the tracked allocator get fuzzed along with stb_image itself.
+* Besides crashes, it checks that a decode never goes over its budget and that a decoded image is as big as it says.
+* It's also built once per format with TEXTURE_LOADER_FUZZ_FORMAT set to that format, as texture_loader_fuzz_<format>,
+* which skips every other format, so a fuzzing run spends all of its time in one decoder.
+*/
+
+namespace {
+    void check_decode(const bool success, const DecodedImage& image, const DecodeStats& stats, const DecodeLimits& limits) {
+        if (stats.peak_allocated_bytes > limits.max_allocated_bytes) {
+            abort();
+        }
+        if (!success) {
+            if (image.pixels) {
+                abort();
+            }
+            return;
+        }
+        if (!image.pixels || image.width <= 0 || image.height <= 0 || stats.allocation_count == 0) {
+            abort();
+        }
+        if (stats.decoded_bytes != static_cast<size_t>(image.width) * image.height * image.channels * image.bytes_per_channel) {
+            abort();
+        }
+
+        // Touch the last byte, so a short allocation shows up under AddressSanitizer
+        volatile uint8_t last = static_cast<const uint8_t*>(image.pixels)[stats.decoded_bytes - 1];
+        (void)last;
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, const size_t size) {
+#ifdef TEXTURE_LOADER_FUZZ_FORMAT
+    if (detect_image_format(data, size) != ImageFormat::TEXTURE_LOADER_FUZZ_FORMAT) {
+        return 0;
+    }
+#endif
+
+    DecodeLimits limits;
+    limits.max_width = 4096;
+    limits.max_height = 4096;
+    limits.max_allocated_bytes = 64ull * 1024 * 1024;
+
+    DecodeLimits small_limits = limits;
+    small_limits.max_allocated_bytes = 4096;
+
+    DecodedImage image;
+    DecodeStats stats;
+    bool success = decode_image(data, size, 4, image, &stats, limits);
+    check_decode(success, image, stats, limits);
+    free_image(image);
+
+    success = decode_image_full_precision(data, size, image, &stats, limits);
+    check_decode(success, image, stats, limits);
+    free_image(image);
+
+    success = decode_image(data, size, 0, image, &stats, small_limits);
+    check_decode(success, image, stats, small_limits);
+    free_image(image);
+    return 0;
+}
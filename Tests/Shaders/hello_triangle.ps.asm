@@ -0,0 +1,81 @@
+//
+// Hand-assembled from Shaders/DX12/hello_triangle.ps.hlsl, /T ps_5_0 /E main
+//
+// Input signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// COLOR                    0   xyz         0     NONE   float   xyz
+// VIEW_POSITION            0   xyz         1     NONE   float   xyz
+// SV_Position              0   xyzw        2      POS   float   xy
+//
+//
+// Output signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// SV_Target                0   xyzw        0   TARGET   float   xyzw
+//
+ps_5_0
+dcl_globalFlags refactoringAllowed
+dcl_constantbuffer CB0[10], immediateIndexed
+dcl_resource_structured t0, 8
+dcl_resource_structured t1, 4
+dcl_resource_structured t2, 32
+dcl_input_ps linear v0.xyz
+dcl_input_ps linear v1.xyz
+dcl_input_ps_siv linear noperspective v2.xy, position
+dcl_output o0.xyzw
+dcl_temps 5
+deriv_rty_coarse r0.xyz, v1.zxyz
+deriv_rtx_coarse r1.xyz, v1.yzxy
+mul r2.xyz, r0.xyzx, r1.xyzx
+deriv_rty_coarse r0.xyz, v1.yzxy
+deriv_rtx_coarse r1.xyz, v1.zxyz
+mad r0.xyz, r0.xyzx, r1.xyzx, -r2.xyzx
+dp3 r0.w, r0.xyzx, r0.xyzx
+rsq r0.w, r0.w
+mul r0.xyz, r0.wwww, r0.xyzx
+mul r1.xy, v2.xyxx, cb0[9].xyxx
+max r1.xy, r1.xyxx, l(0.000000, 0.000000, 0.000000, 0.000000)
+ftou r1.xy, r1.xyxx
+umin r1.xy, r1.xyxx, l(15, 8, 0, 0)
+max r1.z, -v1.z, l(1.000000e-30)
+log r1.z, r1.z
+mad r1.z, r1.z, cb0[9].z, cb0[9].w
+max r1.z, r1.z, l(0.000000)
+ftou r1.z, r1.z
+umin r1.z, r1.z, l(23)
+imad r1.y, r1.z, l(9), r1.y
+imad r1.x, r1.y, l(16), r1.x
+ld_structured_indexable(structured_buffer, stride=8)(mixed,mixed,mixed,mixed) r1.xy, r1.x, l(0), t0.xyxx
+mov r2.xyz, l(0.250000, 0.250000, 0.250000, 0.000000)
+mov r1.z, l(0)
+loop
+  uge r1.w, r1.z, r1.y
+  breakc_nz r1.w
+  iadd r1.w, r1.z, r1.x
+  ld_structured_indexable(structured_buffer, stride=4)(mixed,mixed,mixed,mixed) r1.w, r1.w, l(0), t1.xxxx
+  ld_structured_indexable(structured_buffer, stride=32)(mixed,mixed,mixed,mixed) r3.xyzw, r1.w, l(0), t2.xyzw
+  ld_structured_indexable(structured_buffer, stride=32)(mixed,mixed,mixed,mixed) r4.xyz, r1.w, l(16), t2.xyzx
+  add r3.xyz, r3.xyzx, -v1.xyzx
+  dp3 r1.w, r3.xyzx, r3.xyzx
+  mul r3.w, r3.w, r3.w
+  lt r4.w, r1.w, r3.w
+  if_nz r4.w
+    div r3.w, r1.w, r3.w
+    add r3.w, -r3.w, l(1.000000)
+    mul r3.w, r3.w, r3.w
+    max r1.w, r1.w, l(1.000000e-08)
+    rsq r1.w, r1.w
+    mul r3.xyz, r1.wwww, r3.xyzx
+    dp3_sat r1.w, r0.xyzx, r3.xyzx
+    mul r1.w, r1.w, r3.w
+    mad r2.xyz, r4.xyzx, r1.wwww, r2.xyzx
+  endif
+  iadd r1.z, r1.z, l(1)
+endloop
+mul o0.xyz, r2.xyzx, v0.xyzx
+mov o0.w, l(1.000000)
+ret
+// Approximately 51 instruction slots used
@@ -0,0 +1,50 @@
+//
+// Hand-assembled from Shaders/DX12/hello_triangle.vs.hlsl, /T vs_5_0 /E main
+//
+// Input signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// POSITION                 0   xyz         0     NONE   float   xyz
+// COLOR                    0   xyz         1     NONE   float   xyz
+//
+//
+// Output signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// COLOR                    0   xyz         0     NONE   float   xyz
+// VIEW_POSITION            0   xyz         1     NONE   float   xyz
+// SV_Position              0   xyzw        2      POS   float   xyzw
+//
+vs_5_0
+dcl_globalFlags refactoringAllowed
+dcl_constantbuffer CB0[9], immediateIndexed
+dcl_constantbuffer CB1[1], immediateIndexed
+dcl_resource_structured t3, 64
+dcl_input v0.xyz
+dcl_input v1.xyz
+dcl_output o0.xyz
+dcl_output o1.xyz
+dcl_output_siv o2.xyzw, position
+dcl_temps 2
+ld_structured_indexable(structured_buffer, stride=64)(mixed,mixed,mixed,mixed) r0.xyzw, cb1[0].x, l(16), t3.xyzw
+mul r0.xyzw, r0.xyzw, v0.yyyy
+ld_structured_indexable(structured_buffer, stride=64)(mixed,mixed,mixed,mixed) r1.xyzw, cb1[0].x, l(0), t3.xyzw
+mad r0.xyzw, r1.xyzw, v0.xxxx, r0.xyzw
+ld_structured_indexable(structured_buffer, stride=64)(mixed,mixed,mixed,mixed) r1.xyzw, cb1[0].x, l(32), t3.xyzw
+mad r0.xyzw, r1.xyzw, v0.zzzz, r0.xyzw
+ld_structured_indexable(structured_buffer, stride=64)(mixed,mixed,mixed,mixed) r1.xyzw, cb1[0].x, l(48), t3.xyzw
+add r0.xyzw, r0.xyzw, r1.xyzw
+mul r1.xyzw, r0.yyyy, cb0[1].xyzw
+mad r1.xyzw, cb0[0].xyzw, r0.xxxx, r1.xyzw
+mad r1.xyzw, cb0[2].xyzw, r0.zzzz, r1.xyzw
+mad r0.xyzw, cb0[3].xyzw, r0.wwww, r1.xyzw
+mov o1.xyz, r0.xyzx
+mul r1.xyzw, r0.yyyy, cb0[5].xyzw
+mad r1.xyzw, cb0[4].xyzw, r0.xxxx, r1.xyzw
+mad r1.xyzw, cb0[6].xyzw, r0.zzzz, r1.xyzw
+mad o2.xyzw, cb0[7].xyzw, r0.wwww, r1.xyzw
+mul o0.xyz, v1.xyzx, cb0[8].xyzx
+ret
+// Approximately 19 instruction slots used
@@ -0,0 +1,269 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "blend_kernels.h"
+#include "test_common.h"
+
+/* BLEND KERNEL TESTS
+* The 8-pixel kernels have to produce exactly the bits of the scalar versions in blend_kernels.h, and the scalar UNORM
+* conversions are checked against the D3D rules with doubles. By default the tests take a few seconds: packing sees
+* every 97th float bit pattern in every channel, unpacking every half and 16M 32-bit pixels, and blending every color
+* blend state with every 4th alpha factor. With --exhaustive, which CTest runs with -C Exhaustive, they go through
+* every float, every 32-bit pixel and every combination of color and alpha blend states, which takes a lot longer.
+*/
+
+namespace {
+    bool exhaustive = false;
+
+    constexpr RenderTargetFormat formats[] = {
+        RenderTargetFormat::r8g8b8a8_unorm,
+        RenderTargetFormat::r8g8b8a8_unorm_srgb,
+        RenderTargetFormat::r10g10b10a2_unorm,
+        RenderTargetFormat::r11g11b10_float,
+        RenderTargetFormat::r16g16b16a16_float,
+    };
+    const char* format_names[] = { "r8g8b8a8_unorm", "r8g8b8a8_unorm_srgb", "r10g10b10a2_unorm", "r11g11b10_float", "r16g16b16a16_float" };
+
+    constexpr BlendFactor blend_factors[] = {
+        BlendFactor::zero, BlendFactor::one, BlendFactor::src_color, BlendFactor::inv_src_color, BlendFactor::src_alpha,
+        BlendFactor::inv_src_alpha, BlendFactor::dest_alpha, BlendFactor::inv_dest_alpha, BlendFactor::dest_color,
+        BlendFactor::inv_dest_color, BlendFactor::src_alpha_sat, BlendFactor::blend_factor, BlendFactor::inv_blend_factor,
+    };
+    constexpr BlendOp blend_ops[] = { BlendOp::add, BlendOp::subtract, BlendOp::rev_subtract, BlendOp::min, BlendOp::max };
+
+    float bits_float(const uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // 8 pixels of either size, so every format goes through the same code
+    struct PixelRow {
+        uint32_t pixels32[shader_lane_count];
+        uint64_t pixels64[shader_lane_count];
+
+        void* data(const RenderTargetFormat format) {
+            return render_target_format_pixel_size(format) == 8 ? static_cast<void*>(pixels64) : static_cast<void*>(pixels32);
+        }
+        uint64_t get(const RenderTargetFormat format, const uint32_t lane) const {
+            return render_target_format_pixel_size(format) == 8 ? pixels64[lane] : pixels32[lane];
+        }
+        void set(const uint32_t lane, const uint64_t pixel) {
+            pixels64[lane] = pixel;
+            pixels32[lane] = static_cast<uint32_t>(pixel);
+        }
+    };
+
+    // D3D clamps to [0, 1], with NaN as 0, scales by the largest code and rounds to nearest, and allows the result
+    // to be off by 0.6 of a code, so a float multiply and add is enough
+    bool within_unorm_tolerance(const float value, const uint32_t max_code, const uint32_t code) {
+        const double clamped = value > 0.0f ? (value < 1.0f ? static_cast<double>(value) : 1.0) : 0.0;
+        return code <= max_code && std::fabs(clamped * max_code - code) <= 0.6;
+    }
+
+    void test_unorm_tolerance() {
+        // The scalar versions against the spec, for every float between 0 and 1 a multiple of 61 bits apart
+        size_t mismatches = 0;
+        const auto check = [&](const float value) {
+            const float rgba[4] = { value, value, value, value };
+            const auto rgba8 = static_cast<uint32_t>(pack_pixel(RenderTargetFormat::r8g8b8a8_unorm, rgba));
+            const auto rgb10a2 = static_cast<uint32_t>(pack_pixel(RenderTargetFormat::r10g10b10a2_unorm, rgba));
+            for (uint32_t channel = 0; channel < 4; ++channel) {
+                mismatches += !within_unorm_tolerance(value, 255, (rgba8 >> (channel * 8)) & 0xff);
+                mismatches += !within_unorm_tolerance(value, channel == 3 ? 3 : 1023, (rgb10a2 >> (channel * 10)) & (channel == 3 ? 3 : 0x3ff));
+            }
+        };
+        for (uint32_t bits = 0; bits <= 0x3f800000u; bits += 61) {
+            check(bits_float(bits));
+        }
+        for (const float value : { -1.0f, -0.0f, NAN, INFINITY, -INFINITY, 2.0f }) {
+            check(value);
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void test_pack() {
+        const uint64_t step = exhaustive ? 1 : 97;
+        for (size_t format_index = 0; format_index < std::size(formats); ++format_index) {
+            const RenderTargetFormat format = formats[format_index];
+            size_t mismatches = 0;
+            for (uint64_t first = 0; first < (uint64_t(1) << 32); first += shader_lane_count * step) {
+                // The same float in all channels, so every channel sees every value
+                float source[4][shader_lane_count];
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    const float value = bits_float(static_cast<uint32_t>(first + lane * step));
+                    for (auto& channel : source) {
+                        channel[lane] = value;
+                    }
+                }
+                PixelRow packed;
+                pack_pixels(format, source, packed.data(format));
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    const float rgba[4] = { source[0][lane], source[1][lane], source[2][lane], source[3][lane] };
+                    mismatches += packed.get(format, lane) != pack_pixel(format, rgba);
+                }
+            }
+            if (!CHECK(mismatches == 0)) {
+                printf("    pack_pixels(%s): %zu pixels differ\n", format_names[format_index], mismatches);
+            }
+        }
+    }
+
+    bool same_bits(const float a, const float b) {
+        return memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    void test_unpack() {
+        for (size_t format_index = 0; format_index < std::size(formats); ++format_index) {
+            const RenderTargetFormat format = formats[format_index];
+            const bool wide = render_target_format_pixel_size(format) == 8;
+            // Every half in every channel, or every 32-bit pixel, or 16M of them spread over all of them
+            const uint64_t count = wide ? 65536 : (exhaustive ? uint64_t(1) << 32 : uint64_t(1) << 24);
+            const uint64_t multiplier = wide || exhaustive ? 1 : 251;
+            size_t mismatches = 0;
+            for (uint64_t first = 0; first < count; first += shader_lane_count) {
+                PixelRow pixels;
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    const uint64_t value = (first + lane) * multiplier;
+                    pixels.set(lane, wide ? (value & 0xffff) * 0x0001000100010001ull : value);
+                }
+                float unpacked[4][shader_lane_count];
+                unpack_pixels(format, pixels.data(format), unpacked);
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    float expected[4];
+                    unpack_pixel(format, pixels.get(format, lane), expected);
+                    for (uint32_t channel = 0; channel < 4; ++channel) {
+                        mismatches += !same_bits(unpacked[channel][lane], expected[channel]);
+                    }
+                }
+            }
+            if (!CHECK(mismatches == 0)) {
+                printf("    unpack_pixels(%s): %zu channels differ\n", format_names[format_index], mismatches);
+            }
+        }
+    }
+
+    /* BLEND STATES
+    * Every state is run on 8 random pixels with a random lane mask, and each lane has to be what blend_pixel() makes
+    * of it, or the old pixel if the lane isn't in the mask. Lanes 0 and 1 of the source are 0 and 1 exactly, the rest
+    * go a bit past [0, 1] so the clamping of UNORM formats is hit too.
+    */
+    struct BlendTester {
+        RenderTargetFormat format;
+        std::mt19937 random{ 1 };
+        size_t states = 0;
+        size_t mismatches = 0;
+
+        float random_value(const float low, const float high) {
+            return std::uniform_real_distribution<float>(low, high)(random);
+        }
+
+        void run(const SoftwareBlendState& state) {
+            const BlendFunction function = select_blend_function(state, format);
+            if (!CHECK(function != nullptr)) {
+                return;
+            }
+            states++;
+
+            float source[4][shader_lane_count];
+            float blend_factor[4];
+            for (uint32_t channel = 0; channel < 4; ++channel) {
+                blend_factor[channel] = random_value(-0.25f, 1.25f);
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    source[channel][lane] = lane == 0 ? 0.0f : (lane == 1 ? 1.0f : random_value(-0.25f, 1.25f));
+                }
+            }
+            PixelRow before;
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                uint64_t pixel = (uint64_t(random()) << 32) | random();
+                if (render_target_format_pixel_size(format) == 8) {
+                    // Random bits would be NaNs and infinities, which don't blend the same way twice
+                    const float rgba[4] = { random_value(-1.0f, 5.0f), random_value(-1.0f, 5.0f), random_value(-1.0f, 5.0f), random_value(-1.0f, 5.0f) };
+                    pixel = pack_pixel(format, rgba);
+                }
+                before.set(lane, pixel);
+            }
+            const uint32_t mask = random() % 4 == 0 ? 0xff : random() & 0xff;
+
+            PixelRow after = before;
+            function(state, source, blend_factor, mask, after.data(format));
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                uint64_t expected = before.get(format, lane);
+                if ((mask >> lane) & 1) {
+                    const float rgba[4] = { source[0][lane], source[1][lane], source[2][lane], source[3][lane] };
+                    expected = blend_pixel(state, format, rgba, blend_factor, expected);
+                }
+                mismatches += after.get(format, lane) != expected;
+            }
+        }
+    };
+
+    void test_blend() {
+        const size_t alpha_factor_step = exhaustive ? 1 : 4;
+        for (size_t format_index = 0; format_index < std::size(formats); ++format_index) {
+            BlendTester tester;
+            tester.format = formats[format_index];
+
+            for (const BlendFactor src_blend : blend_factors) {
+                for (const BlendFactor dest_blend : blend_factors) {
+                    for (const BlendOp blend_op : blend_ops) {
+                        for (size_t src_alpha = 0; src_alpha < std::size(blend_factors); src_alpha += alpha_factor_step) {
+                            for (size_t dest_alpha = 0; dest_alpha < std::size(blend_factors); dest_alpha += alpha_factor_step) {
+                                for (const BlendOp blend_op_alpha : blend_ops) {
+                                    SoftwareBlendState state;
+                                    state.blend_enable = true;
+                                    state.src_blend = src_blend;
+                                    state.dest_blend = dest_blend;
+                                    state.blend_op = blend_op;
+                                    state.src_blend_alpha = blend_factors[src_alpha];
+                                    state.dest_blend_alpha = blend_factors[dest_alpha];
+                                    state.blend_op_alpha = blend_op_alpha;
+                                    // Half of them with every channel, which lets the kernel skip reading the pixels
+                                    state.write_mask = tester.random() % 2 ? 0xf : tester.random() % 16;
+                                    tester.run(state);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Every logic op and opaque, with every write mask
+            for (uint8_t write_mask = 0; write_mask < 16; ++write_mask) {
+                for (uint8_t logic_op = 0; logic_op < 16; ++logic_op) {
+                    SoftwareBlendState state;
+                    state.logic_op_enable = true;
+                    state.logic_op = static_cast<LogicOp>(logic_op);
+                    state.write_mask = write_mask;
+                    for (int i = 0; i < 16; ++i) {
+                        tester.run(state);
+                    }
+                }
+                SoftwareBlendState state;
+                state.write_mask = write_mask;
+                for (int i = 0; i < 64; ++i) {
+                    tester.run(state);
+                }
+            }
+
+            if (!CHECK(tester.mismatches == 0)) {
+                printf("    blend %s: %zu pixels of %zu states differ\n", format_names[format_index], tester.mismatches, tester.states);
+            }
+        }
+
+        // Blending and a logic op at the same time isn't valid
+        SoftwareBlendState both;
+        both.blend_enable = true;
+        both.logic_op_enable = true;
+        CHECK(select_blend_function(both, RenderTargetFormat::r8g8b8a8_unorm) == nullptr);
+    }
+}
+
+int main(const int argc, char** argv) {
+    exhaustive = argc > 1 && strcmp(argv[1], "--exhaustive") == 0;
+    test_unorm_tolerance();
+    test_pack();
+    test_unpack();
+    test_blend();
+    return test::test_result();
+}
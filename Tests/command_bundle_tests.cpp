@@ -0,0 +1,242 @@
+#include <cstdint>
+#include <vector>
+#include "command_bundle.h"
+#include "test_common.h"
+
+/* COMMAND BUNDLE TESTS
+* A mock command list stands in for the D3D12 bundle: it keeps every command recorded into it, and counts every
+* recording. Each frame builds the key and records the draws like the renderer does, so the tests show the bundle
+* is recorded again exactly when one of its inputs changed, and that what it holds then is what recording the new
+* inputs directly gives.
+*/
+
+namespace {
+    // Stand-ins for the D3D12 structs that go into the key, by value
+    struct VertexBufferView {
+        uint64_t location;
+        uint32_t size;
+        uint32_t stride;
+    };
+
+    struct IndexBufferView {
+        uint64_t location;
+        uint32_t size;
+        uint32_t format;
+    };
+
+    struct DrawItem {
+        uint32_t index_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t transform_index;
+    };
+
+    // Every command is its opcode and arguments, so two recordings are the same if their commands are
+    struct MockCommandList {
+        std::vector<uint64_t> commands;
+        uint32_t recordings = 0;
+        uint32_t executed = 0;
+
+        void reset() {
+            commands.clear();
+            recordings++;
+        }
+        void set_pipeline_state(const void* pipeline) { commands.insert(commands.end(), { 1, reinterpret_cast<uintptr_t>(pipeline) }); }
+        void set_root_signature(const void* signature) { commands.insert(commands.end(), { 2, reinterpret_cast<uintptr_t>(signature) }); }
+        void set_vertex_buffers(const std::vector<VertexBufferView>& views) {
+            commands.insert(commands.end(), { 3, views.size() });
+            for (const VertexBufferView& view : views) {
+                commands.insert(commands.end(), { view.location, view.size, view.stride });
+            }
+        }
+        void set_index_buffer(const IndexBufferView& view) { commands.insert(commands.end(), { 4, view.location, view.size, view.format }); }
+        void set_root_constant(const uint32_t index, const uint32_t value) { commands.insert(commands.end(), { 5, index, value }); }
+        void draw_indexed(const DrawItem& draw) {
+            commands.insert(commands.end(), { 6, draw.index_count, draw.first_index, static_cast<uint64_t>(draw.base_vertex) });
+        }
+    };
+
+    // Everything the draw bundle is recorded with
+    struct FrameInputs {
+        const void* pipeline_state;
+        const void* root_signature;
+        std::vector<VertexBufferView> vertex_buffers;
+        IndexBufferView index_buffer;
+        std::vector<DrawItem> draws;
+    };
+
+    void record_draws(const FrameInputs& inputs, MockCommandList& list) {
+        list.reset();
+        list.set_pipeline_state(inputs.pipeline_state);
+        list.set_root_signature(inputs.root_signature);
+        list.set_vertex_buffers(inputs.vertex_buffers);
+        list.set_index_buffer(inputs.index_buffer);
+        for (const DrawItem& draw : inputs.draws) {
+            list.set_root_constant(5, draw.transform_index);
+            list.draw_indexed(draw);
+        }
+    }
+
+    // One frame, the way the renderer does it: build the key, record if it changed, execute
+    void render_frame(const FrameInputs& inputs, CachedBundle& bundle, MockCommandList& bundle_list) {
+        BundleKey& key = bundle.begin_key();
+        key.add_pointer(inputs.pipeline_state);
+        key.add_pointer(inputs.root_signature);
+        key.add(inputs.vertex_buffers.data(), inputs.vertex_buffers.size() * sizeof(VertexBufferView));
+        key.add_value(inputs.index_buffer);
+        key.add(inputs.draws.data(), inputs.draws.size() * sizeof(DrawItem));
+        if (bundle.needs_recording()) {
+            record_draws(inputs, bundle_list);
+        }
+        bundle_list.executed++;
+    }
+
+    // Whether the bundle holds what recording the inputs directly gives
+    bool matches_direct_recording(const FrameInputs& inputs, const MockCommandList& bundle_list) {
+        MockCommandList direct;
+        record_draws(inputs, direct);
+        return direct.commands == bundle_list.commands;
+    }
+
+    FrameInputs make_inputs() {
+        static int pipeline = 0;
+        static int root_signature = 0;
+        FrameInputs inputs;
+        inputs.pipeline_state = &pipeline;
+        inputs.root_signature = &root_signature;
+        inputs.vertex_buffers = { { 0x10000, 4096, 12 }, { 0x20000, 4096, 16 } };
+        inputs.index_buffer = { 0x30000, 1024, 42 };
+        for (uint32_t i = 0; i < 100; ++i) {
+            inputs.draws.push_back({ 36, i * 36, 0, i });
+        }
+        return inputs;
+    }
+
+    void test_unchanged_frames() {
+        const FrameInputs inputs = make_inputs();
+        CachedBundle bundle;
+        MockCommandList bundle_list;
+        for (int frame = 0; frame < 100; ++frame) {
+            render_frame(inputs, bundle, bundle_list);
+        }
+        CHECK(bundle_list.recordings == 1);
+        CHECK(bundle_list.executed == 100);
+        CHECK(bundle.stats().recordings == 1);
+        CHECK(bundle.stats().uses == 100);
+        CHECK(matches_direct_recording(inputs, bundle_list));
+    }
+
+    // Each input changed on its own, then left alone: one recording for the change, none after it
+    void test_changed_inputs() {
+        static int reloaded_pipeline = 0;
+        static int other_root_signature = 0;
+        const FrameInputs original = make_inputs();
+        std::vector<FrameInputs> changes;
+        changes.push_back(original);
+        changes.back().pipeline_state = &reloaded_pipeline;
+        changes.push_back(original);
+        changes.back().root_signature = &other_root_signature;
+        changes.push_back(original);
+        changes.back().vertex_buffers[1].location = 0x40000;
+        changes.push_back(original);
+        changes.back().vertex_buffers.pop_back();
+        changes.push_back(original);
+        changes.back().index_buffer.format = 57;
+        changes.push_back(original);
+        changes.back().draws[50].transform_index = 7;
+        changes.push_back(original);
+        changes.back().draws[99].base_vertex = -1;
+        changes.push_back(original);
+        changes.back().draws.push_back({ 6, 0, 0, 100 });
+        changes.push_back(original);
+        changes.back().draws.pop_back();
+        changes.push_back(original);
+        changes.back().draws.clear();
+
+        for (const FrameInputs& changed : changes) {
+            CachedBundle bundle;
+            MockCommandList bundle_list;
+            for (int frame = 0; frame < 10; ++frame) {
+                render_frame(original, bundle, bundle_list);
+            }
+            for (int frame = 0; frame < 10; ++frame) {
+                render_frame(changed, bundle, bundle_list);
+            }
+            CHECK(bundle_list.recordings == 2);
+            CHECK(matches_direct_recording(changed, bundle_list));
+
+            // Only the last key is kept, so going back records again
+            render_frame(original, bundle, bundle_list);
+            CHECK(bundle_list.recordings == 3);
+            CHECK(matches_direct_recording(original, bundle_list));
+            CHECK(bundle.stats().uses == 21 && bundle.stats().recordings == 3);
+        }
+    }
+
+    // A different input every few frames, like a pipeline that's hot reloaded now and then
+    void test_alternating_inputs() {
+        static int reloaded_pipeline = 0;
+        const FrameInputs original = make_inputs();
+        FrameInputs reloaded = original;
+        reloaded.pipeline_state = &reloaded_pipeline;
+
+        CachedBundle bundle;
+        MockCommandList bundle_list;
+        for (int frame = 0; frame < 1000; ++frame) {
+            const FrameInputs& inputs = frame / 100 % 2 == 0 ? original : reloaded;
+            render_frame(inputs, bundle, bundle_list);
+            if (frame % 100 == 0) {
+                CHECK(matches_direct_recording(inputs, bundle_list));
+            }
+        }
+        CHECK(bundle_list.recordings == 10);
+        CHECK(bundle.stats().recordings == 10);
+    }
+
+    void test_invalidate() {
+        const FrameInputs inputs = make_inputs();
+        CachedBundle bundle;
+        MockCommandList bundle_list;
+        render_frame(inputs, bundle, bundle_list);
+        render_frame(inputs, bundle, bundle_list);
+        bundle.invalidate();
+        render_frame(inputs, bundle, bundle_list);
+        render_frame(inputs, bundle, bundle_list);
+        CHECK(bundle_list.recordings == 2);
+        CHECK(matches_direct_recording(inputs, bundle_list));
+    }
+
+    void test_keys() {
+        const uint8_t bytes[] = { 1, 2, 3, 4 };
+        BundleKey empty;
+        BundleKey whole;
+        whole.add(bytes, sizeof(bytes));
+        BundleKey split;
+        split.add(bytes, 1);
+        split.add(bytes + 1, 0);
+        split.add(bytes + 1, 3);
+        BundleKey prefix;
+        prefix.add(bytes, 3);
+        BundleKey other;
+        other.add_value(uint32_t(0x04030201) + 1);
+
+        CHECK(empty == BundleKey());
+        CHECK(empty.size() == 0);
+        CHECK(whole == split);
+        CHECK(whole.size() == 4);
+        CHECK(whole != prefix);
+        CHECK(whole != empty);
+        CHECK(whole != other);
+        whole.clear();
+        CHECK(whole == empty);
+    }
+}
+
+int main() {
+    test_unchanged_frames();
+    test_changed_inputs();
+    test_alternating_inputs();
+    test_invalidate();
+    test_keys();
+    return test::test_result();
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "deferred_release.h"
+#include "test_common.h"
+
+/* DEFERRED RELEASE TESTS
+* A fake fence stands in for the GPU: the frames it completes lag a few frames behind the ones the CPU submits, and
+* every fake object knows the last frame that used it, so releasing it before the fence passed that frame is counted.
+* Also checks the budget per retire(), out of order fence values, malloc'd memory and the leak report.
+*/
+
+namespace {
+    struct FakeFence {
+        uint64_t completed = 0;
+    };
+
+    struct FakeObject {
+        FakeFence* fence = nullptr;
+        uint64_t last_use = 0;
+        uint32_t* released = nullptr;
+        uint32_t* released_early = nullptr;
+
+        void Release() {
+            if (last_use > fence->completed) {
+                (*released_early)++;
+            }
+            (*released)++;
+            delete this;
+        }
+    };
+
+    uint32_t random_u32(uint32_t& seed) {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    }
+
+    void test_lagging_fence() {
+        constexpr size_t budget = 512;
+        FakeFence fence;
+        uint32_t released = 0;
+        uint32_t released_early = 0;
+        uint32_t enqueued = 0;
+        size_t peak_released = 0;
+        uint32_t seed = 1;
+
+        DeferredReleaseQueue queue;
+        uint64_t cpu_frame = 0;
+        for (uint32_t frame = 0; frame < 2000; ++frame) {
+            cpu_frame++;
+
+            // Mostly a few objects per frame, with a burst every 200 frames like unloading a level
+            const uint32_t count = frame % 200 == 0 ? 5000 : random_u32(seed) % 8;
+            for (uint32_t i = 0; i < count; ++i) {
+                FakeObject* object = new FakeObject{ &fence, cpu_frame, &released, &released_early };
+                queue.enqueue_release(cpu_frame, object, "fake object");
+                enqueued++;
+            }
+
+            // The GPU is 0 to 3 frames behind, and never goes backwards
+            const uint64_t lag = random_u32(seed) % 4;
+            if (cpu_frame > lag) {
+                fence.completed = std::max(fence.completed, cpu_frame - lag);
+            }
+            peak_released = std::max(peak_released, queue.retire(fence.completed, budget));
+        }
+
+        fence.completed = cpu_frame;
+        while (queue.pending() != 0) {
+            CHECK(queue.retire(fence.completed, budget) <= budget);
+        }
+
+        CHECK(released_early == 0);
+        CHECK(released == enqueued);
+        CHECK(peak_released == budget);
+        CHECK(queue.stats().enqueued == enqueued);
+        CHECK(queue.stats().released == enqueued);
+        CHECK(queue.stats().budget_limited > 0);
+        CHECK(queue.stats().peak_pending >= 5000);
+    }
+
+    void test_fence_order() {
+        FakeFence fence;
+        uint32_t released = 0;
+        uint32_t released_early = 0;
+
+        // A smaller fence value than the one before is treated like the one before, so it's only released later
+        DeferredReleaseQueue queue;
+        queue.enqueue_release(10, new FakeObject{ &fence, 10, &released, &released_early });
+        queue.enqueue_release(5, new FakeObject{ &fence, 10, &released, &released_early });
+
+        fence.completed = 5;
+        CHECK(queue.retire(fence.completed) == 0);
+        fence.completed = 9;
+        CHECK(queue.retire(fence.completed) == 0);
+        fence.completed = 10;
+        CHECK(queue.retire(fence.completed) == 2);
+        CHECK(released == 2);
+        CHECK(released_early == 0);
+        CHECK(queue.pending() == 0);
+    }
+
+    void test_free_and_leaks() {
+        DeferredReleaseQueue queue;
+        queue.enqueue_free(1, malloc(100), "buffer");
+        queue.enqueue_free(2, malloc(100), "leaked buffer");
+        queue.enqueue_free(3, nullptr, "null");
+        CHECK(queue.pending() == 2);
+
+        CHECK(queue.retire(1) == 1);
+        CHECK(queue.report_leaks() == 1);
+        CHECK(queue.flush() == 1);
+        CHECK(queue.report_leaks() == 0);
+        CHECK(queue.pending() == 0);
+    }
+}
+
+int main() {
+    test_lagging_fence();
+    test_fence_order();
+    test_free_and_leaks();
+    return test::test_result();
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* DXBC BUILDER
+* The tests can't run the HLSL compiler, so the shaders they run on the CPU are assembled by hand: a DXBC container
+* with an input signature, an output signature and a SHEX chunk with the bytecode tokens. The tokens are what FXC
+* would write for the same code. The container checksum is left at 0, the interpreter doesn't check it.
+*/
+
+namespace test {
+    struct SignatureElement {
+        std::string semantic_name;
+        uint32_t semantic_index;
+        uint32_t system_value;      // D3D_NAME: 0 = none, 1 = SV_Position, 64 = SV_Target
+        uint32_t register_index;
+        uint8_t mask;
+    };
+
+    inline void write_u32(std::vector<uint8_t>& bytes, const size_t offset, const uint32_t value) {
+        memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    // An ISGN or OSGN chunk: a header, 24 bytes per element, then the semantic names
+    inline std::vector<uint8_t> make_signature(const std::vector<SignatureElement>& elements) {
+        std::vector<uint8_t> chunk(8 + 24 * elements.size(), 0);
+        write_u32(chunk, 0, static_cast<uint32_t>(elements.size()));
+        write_u32(chunk, 4, 8);
+        for (size_t i = 0; i < elements.size(); ++i) {
+            const size_t element = 8 + 24 * i;
+            write_u32(chunk, element + 0, static_cast<uint32_t>(chunk.size()));
+            write_u32(chunk, element + 4, elements[i].semantic_index);
+            write_u32(chunk, element + 8, elements[i].system_value);
+            write_u32(chunk, element + 12, 3); // float
+            write_u32(chunk, element + 16, elements[i].register_index);
+            chunk[element + 20] = elements[i].mask;
+            chunk[element + 21] = elements[i].mask;
+            chunk.insert(chunk.end(), elements[i].semantic_name.begin(), elements[i].semantic_name.end());
+            chunk.push_back(0);
+            while (chunk.size() % 4 != 0) {
+                chunk.push_back(0);
+            }
+        }
+        return chunk;
+    }
+
+    // `tokens` starts with the version token, the length token after it is filled in here
+    inline std::vector<uint8_t> make_dxbc(const std::vector<SignatureElement>& inputs, const std::vector<SignatureElement>& outputs,
+                                          std::vector<uint32_t> tokens) {
+        tokens.insert(tokens.begin() + 1, static_cast<uint32_t>(tokens.size() + 1));
+        const std::pair<const char*, std::vector<uint8_t>> chunks[] = {
+            { "ISGN", make_signature(inputs) },
+            { "OSGN", make_signature(outputs) },
+            { "SHEX", std::vector<uint8_t>(reinterpret_cast<const uint8_t*>(tokens.data()), reinterpret_cast<const uint8_t*>(tokens.data() + tokens.size())) },
+        };
+
+        std::vector<uint8_t> container(32 + 4 * 3, 0);
+        memcpy(container.data(), "DXBC", 4);
+        write_u32(container, 20, 1);
+        write_u32(container, 28, 3);
+        for (size_t i = 0; i < 3; ++i) {
+            write_u32(container, 32 + 4 * i, static_cast<uint32_t>(container.size()));
+            container.insert(container.end(), chunks[i].first, chunks[i].first + 4);
+            const size_t size_offset = container.size();
+            container.resize(size_offset + 4);
+            write_u32(container, size_offset, static_cast<uint32_t>(chunks[i].second.size()));
+            container.insert(container.end(), chunks[i].second.begin(), chunks[i].second.end());
+        }
+        write_u32(container, 24, static_cast<uint32_t>(container.size()));
+        return container;
+    }
+
+    /* SAMPLE SHADERS
+    * The vertex shader passes a float4 clip space POSITION through and multiplies COLOR by cb0[0].xyz, the pixel
+    * shader writes the interpolated color with alpha 1.
+    */
+    inline std::vector<uint8_t> passthrough_vertex_shader() {
+        return make_dxbc(
+            { { "POSITION", 0, 0, 0, 0xF }, { "COLOR", 0, 0, 1, 0x7 } },
+            { { "COLOR", 0, 0, 0, 0x7 }, { "SV_Position", 0, 1, 1, 0xF } },
+            {
+                0x00010050,                                                         // vs_5_0
+                0x0100086a,                                                         // dcl_global_flags refactoringAllowed
+                0x04000059, 0x00208e46, 0, 1,                                       // dcl_constantbuffer cb0[1]
+                0x0300005f, 0x001010f2, 0,                                          // dcl_input v0.xyzw
+                0x0300005f, 0x00101072, 1,                                          // dcl_input v1.xyz
+                0x03000065, 0x00102072, 0,                                          // dcl_output o0.xyz
+                0x04000067, 0x001020f2, 1, 1,                                       // dcl_output_siv o1.xyzw, position
+                0x08000038, 0x00102072, 0, 0x00101246, 1, 0x00208246, 0, 0,         // mul o0.xyz, v1.xyzx, cb0[0].xyzx
+                0x05000036, 0x001020f2, 1, 0x00101e46, 0,                           // mov o1.xyzw, v0.xyzw
+                0x0100003e,                                                         // ret
+            });
+    }
+
+    inline std::vector<uint8_t> color_pixel_shader() {
+        return make_dxbc(
+            { { "COLOR", 0, 0, 0, 0x7 } },
+            { { "SV_Target", 0, 64, 0, 0xF } },
+            {
+                0x00000050,                                                         // ps_5_0
+                0x0100086a,                                                         // dcl_global_flags refactoringAllowed
+                0x03001062, 0x00101072, 0,                                          // dcl_input_ps linear v0.xyz
+                0x03000065, 0x001020f2, 0,                                          // dcl_output o0.xyzw
+                0x05000036, 0x00102072, 0, 0x00101246, 0,                           // mov o0.xyz, v0.xyzx
+                0x05000036, 0x00102082, 0, 0x00004001, 0x3f800000,                  // mov o0.w, l(1.0)
+                0x0100003e,                                                         // ret
+            });
+    }
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "mesh_codec.h"
+#include "test_common.h"
+
+/* MESH CODEC TESTS
+* Encodes index and vertex buffers and decodes them again. Indices have to come back as the same triangles in the
+* same order, each maybe rotated, and vertices byte for byte. Covers grids, shuffled and random triangles, 16- and
+* 32-bit indices, every vertex size and counts around the block and group sizes, and checks that broken data and
+* indices that don't fit in 16 bits are rejected.
+*/
+
+namespace {
+    std::vector<uint32_t> make_grid(const uint32_t width, const uint32_t height) {
+        std::vector<uint32_t> indices;
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                const uint32_t a = y * (width + 1) + x;
+                const uint32_t c = a + width + 1;
+                indices.insert(indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+            }
+        }
+        return indices;
+    }
+
+    std::vector<uint32_t> shuffle_triangles(const std::vector<uint32_t>& indices, std::mt19937& random) {
+        std::vector<uint32_t> order(indices.size() / 3);
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), random);
+        std::vector<uint32_t> shuffled;
+        for (const uint32_t triangle : order) {
+            shuffled.insert(shuffled.end(), { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] });
+        }
+        return shuffled;
+    }
+
+    template <typename T>
+    bool same_triangles(const std::vector<uint32_t>& indices, const std::vector<T>& decoded) {
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            bool same = false;
+            for (size_t rotation = 0; rotation < 3; ++rotation) {
+                same = same || (decoded[i + rotation] == indices[i] && decoded[i + (rotation + 1) % 3] == indices[i + 1]
+                                && decoded[i + (rotation + 2) % 3] == indices[i + 2]);
+            }
+            if (!same) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void test_index_round_trip(const std::vector<uint32_t>& indices, const bool fits_16_bits) {
+        std::vector<uint8_t> encoded;
+        encode_index_buffer(indices.data(), indices.size(), encoded);
+
+        std::vector<uint32_t> decoded(indices.size());
+        CHECK(decode_index_buffer(decoded.data(), decoded.size(), 4, encoded.data(), encoded.size()));
+        CHECK(same_triangles(indices, decoded));
+
+        std::vector<uint16_t> decoded_16(indices.size());
+        const bool decoded_as_16 = decode_index_buffer(decoded_16.data(), decoded_16.size(), 2, encoded.data(), encoded.size());
+        CHECK(decoded_as_16 == fits_16_bits);
+        if (decoded_as_16) {
+            CHECK(same_triangles(indices, decoded_16));
+        }
+    }
+
+    void test_indices() {
+        std::mt19937 random(5);
+        const std::vector<uint32_t> grid = make_grid(100, 80);
+        test_index_round_trip({}, true);
+        test_index_round_trip({ 0, 1, 2 }, true);
+        test_index_round_trip({ 5, 5, 5, 0, 0, 0 }, true);
+        test_index_round_trip(grid, true);
+        test_index_round_trip(shuffle_triangles(grid, random), true);
+
+        // Random triangles over the whole 16-bit range, and past it
+        for (const uint32_t vertex_count : { 65536u, 65537u, 1u << 24 }) {
+            std::vector<uint32_t> indices(3000);
+            for (uint32_t& index : indices) {
+                index = random() % vertex_count;
+            }
+            indices[1500] = vertex_count - 1;
+            test_index_round_trip(indices, vertex_count <= 65536);
+        }
+
+        // A grid with more than 65536 vertices, so only the last triangles don't fit in 16 bits
+        test_index_round_trip(make_grid(300, 220), false);
+        test_index_round_trip({ 0xFFFFFFFFu, 0, 0xFFFFFFFEu, 7, 0xFFFFFFFFu, 0x80000000u }, false);
+
+        // Grids compress to about a byte per triangle
+        std::vector<uint8_t> encoded;
+        encode_index_buffer(grid.data(), grid.size(), encoded);
+        CHECK(encoded.size() < grid.size() / 3 * 11 / 10);
+
+        // Broken data: a different version, cut off, or with bytes left over
+        std::vector<uint32_t> decoded(grid.size());
+        std::vector<uint8_t> broken = encoded;
+        broken[0] ^= 1;
+        CHECK(!decode_index_buffer(decoded.data(), decoded.size(), 4, broken.data(), broken.size()));
+        const std::vector<uint32_t> shuffled = shuffle_triangles(grid, random);
+        encode_index_buffer(shuffled.data(), shuffled.size(), encoded);
+        CHECK(!decode_index_buffer(decoded.data(), decoded.size(), 4, encoded.data(), encoded.size() - 1));
+        broken = encoded;
+        broken.push_back(0);
+        CHECK(!decode_index_buffer(decoded.data(), decoded.size(), 4, broken.data(), broken.size()));
+        CHECK(!decode_index_buffer(decoded.data(), decoded.size() - 1, 4, encoded.data(), encoded.size()));
+        CHECK(!decode_index_buffer(decoded.data(), decoded.size(), 3, encoded.data(), encoded.size()));
+    }
+
+    void test_vertex_round_trip(const std::vector<uint8_t>& vertices, const uint32_t vertex_size) {
+        const size_t vertex_count = vertices.size() / vertex_size;
+        std::vector<uint8_t> encoded;
+        encode_vertex_buffer(vertices.data(), vertex_count, vertex_size, encoded);
+
+        // One byte more than the vertices, which has to stay untouched
+        std::vector<uint8_t> decoded(vertices.size() + 1, 0xCD);
+        CHECK(decode_vertex_buffer(decoded.data(), vertex_count, vertex_size, encoded.data(), encoded.size()));
+        CHECK(memcmp(decoded.data(), vertices.data(), vertices.size()) == 0);
+        CHECK(decoded.back() == 0xCD);
+
+        if (vertex_count > 0) {
+            CHECK(!decode_vertex_buffer(decoded.data(), vertex_count, vertex_size, encoded.data(), encoded.size() - 1));
+            encoded.push_back(0);
+            CHECK(!decode_vertex_buffer(decoded.data(), vertex_count, vertex_size, encoded.data(), encoded.size()));
+        }
+    }
+
+    void test_vertices() {
+        std::mt19937 random(9);
+        for (uint32_t vertex_size = 4; vertex_size <= 256; vertex_size += 4) {
+            for (const size_t vertex_count : { 0, 1, 15, 16, 17, 255, 256, 257, 1000 }) {
+                // Random bytes, then floats that change slowly, like positions, normals and texture coordinates
+                std::vector<uint8_t> vertices(vertex_count * vertex_size);
+                for (uint8_t& byte : vertices) {
+                    byte = static_cast<uint8_t>(random());
+                }
+                test_vertex_round_trip(vertices, vertex_size);
+
+                for (size_t i = 0; i < vertices.size() / 4; ++i) {
+                    const float value = static_cast<float>(i / (vertex_size / 4)) * 0.01f + static_cast<float>(i % (vertex_size / 4));
+                    memcpy(vertices.data() + i * 4, &value, 4);
+                }
+                test_vertex_round_trip(vertices, vertex_size);
+            }
+        }
+
+        // Smooth data compresses, even though the low bytes of the floats are close to random
+        std::vector<uint8_t> vertices(4096 * 12);
+        for (size_t i = 0; i < vertices.size() / 4; ++i) {
+            const float value = static_cast<float>(i / 3) * 0.001f;
+            memcpy(vertices.data() + i * 4, &value, 4);
+        }
+        std::vector<uint8_t> encoded;
+        encode_vertex_buffer(vertices.data(), 4096, 12, encoded);
+        CHECK(encoded.size() < vertices.size() * 2 / 3);
+
+        std::vector<uint8_t> decoded(vertices.size());
+        CHECK(!decode_vertex_buffer(decoded.data(), 4096, 10, encoded.data(), encoded.size()));
+        CHECK(!decode_vertex_buffer(decoded.data(), 4096, 260, encoded.data(), encoded.size()));
+        encoded[0] ^= 1;
+        CHECK(!decode_vertex_buffer(decoded.data(), 4096, 12, encoded.data(), encoded.size()));
+    }
+}
+
+int main() {
+    test_indices();
+    test_vertices();
+    return test::test_result();
+}
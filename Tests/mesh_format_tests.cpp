@@ -0,0 +1,151 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "mesh_codec.h"
+#include "mesh_cooker.h"
+#include "mesh_format.h"
+#include "test_common.h"
+
+/* MESH FORMAT TESTS
+* Cooks a sphere, checks that open_mesh_view() accepts it and that its sections and LODs are where the header says,
+* then breaks one thing at a time in a copy of the file and checks that open_mesh_view() rejects it.
+*/
+
+namespace {
+    MeshSource make_sphere(const uint32_t segments) {
+        MeshSource sphere;
+        for (uint32_t y = 0; y <= segments; ++y) {
+            for (uint32_t x = 0; x <= segments; ++x) {
+                const float u = static_cast<float>(x) / static_cast<float>(segments);
+                const float v = static_cast<float>(y) / static_cast<float>(segments);
+                const glm::vec3 position(sinf(v * 3.14159265f) * cosf(u * 6.28318531f), cosf(v * 3.14159265f),
+                                         sinf(v * 3.14159265f) * sinf(u * 6.28318531f));
+                sphere.positions.push_back(position);
+                sphere.normals.push_back(position);
+                sphere.texcoords.emplace_back(u, v);
+            }
+        }
+        for (uint32_t y = 0; y < segments; ++y) {
+            for (uint32_t x = 0; x < segments; ++x) {
+                const uint32_t a = y * (segments + 1) + x;
+                const uint32_t c = a + segments + 1;
+                sphere.indices.insert(sphere.indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+            }
+        }
+        return sphere;
+    }
+
+    // The section header of the given type in a copy of a file, for breaking it
+    MeshSectionHeader* section_in(std::vector<uint8_t>& file, const MeshSectionType type) {
+        const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(file.data());
+        MeshSectionHeader* sections = reinterpret_cast<MeshSectionHeader*>(file.data() + sizeof(MeshFileHeader));
+        for (uint32_t i = 0; i < header->section_count; ++i) {
+            if (sections[i].type == type) {
+                return &sections[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void test_valid_file(const std::vector<uint8_t>& file) {
+        MeshView view;
+        if (!CHECK(open_mesh_view(file.data(), file.size(), view))) {
+            return;
+        }
+        const MeshSectionHeader* indices = view.find_section(MeshSectionType::indices);
+        const MeshSectionHeader* lods = view.find_section(MeshSectionType::lods);
+        const MeshSectionHeader* meshlets = view.find_section(MeshSectionType::meshlets);
+        if (!CHECK(indices && lods && meshlets && view.find_section(MeshSectionType::bounds))) {
+            return;
+        }
+        CHECK(view.header->lod_count > 1);
+        CHECK(lods->element_count == view.header->lod_count);
+        const MeshLod* lod_data = view.section_data<MeshLod>(*lods);
+        CHECK(lod_data[0].first_index == 0 && lod_data[0].index_count == 64 * 64 * 6);
+        for (uint32_t i = 1; i < view.header->lod_count; ++i) {
+            CHECK(lod_data[i].first_index == lod_data[i - 1].first_index + lod_data[i - 1].index_count);
+            CHECK(lod_data[i].index_count < lod_data[i - 1].index_count);
+        }
+        for (uint32_t i = 0; i < view.header->section_count; ++i) {
+            CHECK(view.sections[i].file_offset % mesh_section_alignment == 0 && view.sections[i].offset % mesh_section_alignment == 0);
+        }
+        CHECK(view.find_section(MeshSectionType::vertex_stream, 0) != nullptr);
+        CHECK(view.find_section(MeshSectionType::vertex_stream, 7) == nullptr);
+
+        std::vector<uint8_t> upload(static_cast<size_t>(view.header->upload_size));
+        CHECK(copy_mesh_sections(view, upload.data()));
+    }
+
+    void test_broken_files(const std::vector<uint8_t>& file) {
+        const auto rejects = [&](auto&& breaking) {
+            std::vector<uint8_t> broken = file;
+            breaking(broken);
+            MeshView view;
+            const bool opened = open_mesh_view(broken.data(), broken.size(), view);
+            return !opened && view.header == nullptr;
+        };
+
+        CHECK(rejects([](std::vector<uint8_t>& broken) { broken.resize(32); }));
+        CHECK(rejects([](std::vector<uint8_t>& broken) { broken[0] ^= 1; }));
+        CHECK(rejects([](std::vector<uint8_t>& broken) { broken.resize(broken.size() + mesh_section_alignment); }));
+        CHECK(rejects([](std::vector<uint8_t>& broken) { section_in(broken, MeshSectionType::bounds)->file_offset += 4; }));
+        CHECK(rejects([](std::vector<uint8_t>& broken) { section_in(broken, MeshSectionType::bounds)->file_offset = broken.size(); }));
+
+        // Missing sections
+        CHECK(rejects([](std::vector<uint8_t>& broken) { section_in(broken, MeshSectionType::indices)->type = static_cast<MeshSectionType>(99); }));
+        CHECK(rejects([](std::vector<uint8_t>& broken) { section_in(broken, MeshSectionType::lods)->type = static_cast<MeshSectionType>(99); }));
+        CHECK(rejects([](std::vector<uint8_t>& broken) { section_in(broken, MeshSectionType::meshlets)->type = static_cast<MeshSectionType>(99); }));
+
+        // No elements, or elements of the wrong size
+        const auto resize_elements = [](std::vector<uint8_t>& broken, const MeshSectionType type, const uint32_t element_size, const uint32_t element_count) {
+            MeshSectionHeader* section = section_in(broken, type);
+            section->element_size = element_size;
+            section->element_count = element_count;
+            section->size = uint64_t(element_size) * element_count;
+            if (section->encoding == MeshSectionEncoding::none) {
+                section->file_size = section->size;
+            }
+        };
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { resize_elements(broken, MeshSectionType::indices, 2, 0); }));
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { resize_elements(broken, MeshSectionType::lods, sizeof(MeshLod), 0); }));
+        CHECK(rejects([&](std::vector<uint8_t>& broken) {
+            reinterpret_cast<MeshFileHeader*>(broken.data())->lod_count = 0;
+            resize_elements(broken, MeshSectionType::lods, sizeof(MeshLod), 0);
+        }));
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { resize_elements(broken, MeshSectionType::lods, 4, 1); }));
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { resize_elements(broken, MeshSectionType::bounds, 4, 1); }));
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { resize_elements(broken, MeshSectionType::bounds, sizeof(MeshBounds) / 2, 2); }));
+
+        // A LOD outside the indices or the meshlets
+        const auto break_lod = [&](std::vector<uint8_t>& broken, const uint32_t first_index, const uint32_t first_meshlet) {
+            MeshLod* lods = reinterpret_cast<MeshLod*>(broken.data() + section_in(broken, MeshSectionType::lods)->file_offset);
+            lods[0].first_index = first_index;
+            lods[0].first_meshlet = first_meshlet;
+        };
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { break_lod(broken, UINT32_MAX - 2, 0); }));
+        CHECK(rejects([&](std::vector<uint8_t>& broken) { break_lod(broken, 0, UINT32_MAX); }));
+    }
+}
+
+int main() {
+    const MeshSource sphere = make_sphere(64);
+    for (const bool compress : { false, true }) {
+        MeshCookSettings settings;
+        settings.compress = compress;
+        std::vector<uint8_t> file;
+        if (!CHECK(cook_mesh(sphere, settings, file))) {
+            continue;
+        }
+        test_valid_file(file);
+        test_broken_files(file);
+    }
+
+    // Without meshlets, like the triangle the app cooks when it's not given a mesh
+    MeshCookSettings settings;
+    settings.build_meshlets = false;
+    settings.max_lod_count = 1;
+    std::vector<uint8_t> file;
+    MeshView view;
+    CHECK(cook_mesh(sphere, settings, file) && open_mesh_view(file.data(), file.size(), view));
+    return test::test_result();
+}
@@ -0,0 +1,172 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/trigonometric.hpp"
+#include "occlusion_culling.h"
+#include "projection.h"
+#include "test_common.h"
+
+/* OCCLUSION CULLING TESTS
+* The depth pyramid of a small odd sized depth buffer, checked texel by texel against levels worked out by hand, so
+* the edge columns and rows that have no pair and the row pitch are covered. Then a wall in front of a camera, and
+* boxes in front of it, behind it, next to it, behind the camera and across the near plane, each with the result
+* it must have. Depths are sixteenths and distances are powers of two where it matters, so every value is exact.
+*/
+
+namespace {
+    // 17x5, in sixteenths, with a row pitch of 20. The padding is 0, the farthest depth, so reading it would show.
+    constexpr uint32_t depth_width = 17;
+    constexpr uint32_t depth_height = 5;
+    constexpr size_t depth_pitch = 20;
+    constexpr float depth_sixteenths[depth_height][depth_width] = {
+        { 3, 9, 14, 6, 11, 16, 8, 13, 5, 10, 15, 7, 12, 4, 9, 14, 6 },
+        { 7, 12, 4, 9, 14, 6, 11, 16, 8, 13, 5, 10, 15, 7, 12, 4, 9 },
+        { 10, 15, 7, 12, 4, 9, 14, 6, 11, 2, 8, 13, 5, 10, 15, 7, 12 },
+        { 13, 5, 10, 15, 7, 12, 4, 9, 14, 6, 11, 16, 8, 13, 5, 10, 15 },
+        { 16, 8, 13, 5, 10, 15, 7, 12, 4, 9, 14, 6, 11, 16, 8, 13, 1 },
+    };
+
+    // Every level, level 0 first: 9x3, 5x2, 3x1, 2x1 and 1x1
+    constexpr float expected_pyramid_sixteenths[] = {
+        3, 4, 6, 8, 5, 5, 4, 4, 6,
+        5, 7, 4, 4, 2, 8, 5, 5, 12,
+        8, 5, 10, 7, 4, 6, 11, 8, 1,
+        3, 4, 2, 4, 6,
+        5, 7, 4, 8, 1,
+        3, 2, 1,
+        2, 1,
+        1,
+    };
+
+    void test_pyramid(const unsigned thread_count) {
+        std::vector<float> depth(depth_pitch * depth_height, 0.0f);
+        for (uint32_t y = 0; y < depth_height; ++y) {
+            for (uint32_t x = 0; x < depth_width; ++x) {
+                depth[y * depth_pitch + x] = depth_sixteenths[y][x] / 16.0f;
+            }
+        }
+
+        DepthPyramid pyramid;
+        make_depth_pyramid(depth_width, depth_height, pyramid);
+        constexpr DepthPyramidLevel expected_levels[] = { { 0, 9, 3, 0 }, { 27, 5, 2, 0 }, { 37, 3, 1, 0 }, { 40, 2, 1, 0 }, { 42, 1, 1, 0 } };
+        if (!CHECK(pyramid.level_count == 5) || !CHECK(pyramid.texels.size() == 43)) {
+            return;
+        }
+        for (uint32_t i = 0; i < pyramid.level_count; ++i) {
+            CHECK(pyramid.levels[i].offset == expected_levels[i].offset);
+            CHECK(pyramid.levels[i].width == expected_levels[i].width);
+            CHECK(pyramid.levels[i].height == expected_levels[i].height);
+        }
+
+        build_depth_pyramid(depth.data(), depth_pitch, pyramid, thread_count);
+        std::vector<float> expected(pyramid.texels.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            expected[i] = expected_pyramid_sixteenths[i] / 16.0f;
+            CHECK(pyramid.texels[i] == expected[i]);
+        }
+        CHECK(count_depth_pyramid_differences(pyramid, expected.data()) == 0);
+        expected[30] = 0.5f;
+        CHECK(count_depth_pyramid_differences(pyramid, expected.data()) == 1);
+
+        // A 1x1 depth buffer still gets a level
+        DepthPyramid single;
+        make_depth_pyramid(1, 1, single);
+        const float single_depth = 0.25f;
+        build_depth_pyramid(&single_depth, 1, single, thread_count);
+        CHECK(single.level_count == 1 && single.texels.size() == 1 && single.texels[0] == 0.25f);
+    }
+
+    // A 64x64 depth buffer: a wall at a depth of 0.5, 2 units away, over pixels [16, 48) in both directions, and
+    // nothing around it. With a 90 degree field of view that's the middle half of the view, [-d/2, d/2] at
+    // distance d.
+    constexpr uint32_t view_size = 64;
+
+    OcclusionObject make_box(const glm::vec3& box_min, const glm::vec3& box_max, const uint32_t transform_index = 0) {
+        OcclusionObject object = {};
+        object.box_min = box_min;
+        object.box_max = box_max;
+        object.transform_index = transform_index;
+        object.index_count = 3;
+        return object;
+    }
+
+    struct ExpectedResult {
+        const char* name;
+        OcclusionObject object;
+        OcclusionResult result;
+    };
+
+    void test_visibility(const unsigned thread_count) {
+        std::vector<float> depth(view_size * view_size, reverse_z_clear_depth);
+        for (uint32_t y = 16; y < 48; ++y) {
+            for (uint32_t x = 16; x < 48; ++x) {
+                depth[y * view_size + x] = 0.5f;
+            }
+        }
+        DepthPyramid pyramid;
+        make_depth_pyramid(view_size, view_size, pyramid);
+        build_depth_pyramid(depth.data(), view_size, pyramid, thread_count);
+        if (!CHECK(pyramid.level_count == 6)) {
+            return;
+        }
+        // Level 2 texels are 8x8 pixels, so the wall is exactly texels [2, 6) there
+        const DepthPyramidLevel& level_2 = pyramid.levels[2];
+        CHECK(pyramid.texels[level_2.offset + 2 * level_2.width + 2] == 0.5f);
+        CHECK(pyramid.texels[level_2.offset + 2 * level_2.width + 1] == 0.0f);
+        CHECK(pyramid.texels[level_2.offset + 6 * level_2.width + 5] == 0.0f);
+
+        // The camera is at the origin looking down -z, the near plane is 1 away
+        const glm::mat4 view_projection = reverse_z_infinite_perspective(glm::radians(90.0f), 1.0f, 1.0f);
+        const glm::mat4 transforms[2] = { glm::mat4(1.0f), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -8.0f)) };
+
+        const ExpectedResult cases[] = {
+            { "small box behind the wall", make_box({ -1, -1, -9 }, { 1, 1, -8 }), OcclusionResult::occluded },
+            { "box behind the wall tested on level 2", make_box({ -3, -3, -9 }, { 3, 3, -8 }), OcclusionResult::occluded },
+            { "box just behind the wall", make_box({ -0.5f, -0.5f, -2.5f }, { 0.5f, 0.5f, -2.25f }), OcclusionResult::occluded },
+            { "box moved behind the wall by its transform", make_box({ -1, -1, -1 }, { 1, 1, 0 }, 1), OcclusionResult::occluded },
+            { "box touching the wall", make_box({ -0.5f, -0.5f, -2.5f }, { 0.5f, 0.5f, -2.0f }), OcclusionResult::visible },
+            { "box in front of the wall", make_box({ -0.25f, -0.25f, -1.5f }, { 0.25f, 0.25f, -1.25f }), OcclusionResult::visible },
+            { "box next to the wall", make_box({ 5, -1, -9 }, { 7, 1, -8 }), OcclusionResult::visible },
+            { "box half behind the wall", make_box({ 2, -1, -9 }, { 6, 1, -8 }), OcclusionResult::visible },
+            { "box across the near plane", make_box({ -1, -1, -4 }, { 1, 1, 0.5f }), OcclusionResult::visible },
+            { "box behind the camera", make_box({ -1, -1, 4 }, { 1, 1, 6 }), OcclusionResult::outside_frustum },
+            { "box left of the view", make_box({ -40, -1, -9 }, { -20, 1, -8 }), OcclusionResult::outside_frustum },
+            { "box above the view", make_box({ -1, 20, -9 }, { 1, 40, -8 }), OcclusionResult::outside_frustum },
+        };
+        constexpr uint32_t case_count = sizeof(cases) / sizeof(cases[0]);
+
+        OcclusionObject objects[case_count];
+        for (uint32_t i = 0; i < case_count; ++i) {
+            const ExpectedResult& test_case = cases[i];
+            const glm::mat4& world = transforms[test_case.object.transform_index];
+            const OcclusionResult result = test_occlusion(test_case.object, world, view_projection, pyramid);
+            if (!CHECK(result == test_case.result)) {
+                printf("    %s: %d, expected %d\n", test_case.name, static_cast<int>(result), static_cast<int>(test_case.result));
+            }
+            CHECK(outside_frustum(test_case.object, world, view_projection) == (test_case.result == OcclusionResult::outside_frustum));
+            objects[i] = test_case.object;
+        }
+
+        // The same through cull_occluded_objects(), with the counts
+        uint8_t visible[case_count];
+        memset(visible, 0xFF, sizeof(visible));
+        OcclusionCullStats stats;
+        cull_occluded_objects(objects, case_count, transforms, view_projection, pyramid, visible, &stats, thread_count);
+        for (uint32_t i = 0; i < case_count; ++i) {
+            CHECK(visible[i] == (cases[i].result == OcclusionResult::visible ? 1 : 0));
+        }
+        CHECK(stats.tested == 12);
+        CHECK(stats.occluded == 4);
+        CHECK(stats.visible == 5);
+        CHECK(stats.outside_frustum == 3);
+    }
+}
+
+int main() {
+    for (const unsigned thread_count : { 1u, 4u }) {
+        test_pyramid(thread_count);
+        test_visibility(thread_count);
+    }
+    return test::test_result();
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "dxbc_builder.h"
+#include "software_rasterizer.h"
+#include "test_common.h"
+
+/* RASTER SCENES
+* Triangles for the software rasterizer tests and benchmarks, drawn with the sample shaders from dxbc_builder.h:
+* clip space positions go straight through, and every triangle gets a flat color of its own, so the color of a pixel
+* says which triangle was drawn there last.
+*/
+
+namespace test {
+    struct RasterVertex {
+        float position[4];
+        float color[3];
+    };
+
+    // The color add_triangle() gives a triangle, as it ends up in an R8G8B8A8 render target
+    inline uint32_t raster_triangle_color(const uint32_t triangle_index) {
+        return ((triangle_index * 97 + 13) % 256) | ((triangle_index * 57 + 101) % 256) << 8 | ((triangle_index * 31 + 7) % 256) << 16 | 0xFF000000u;
+    }
+
+    struct RasterScene {
+        ShaderProgram vertex_shader;
+        ShaderProgram pixel_shader;
+        SoftwarePipelineState pipeline_state;
+        std::vector<RasterVertex> vertices;
+        std::vector<uint32_t> indices;
+        float color_scale[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+        float viewport_offset[2] = { 0.0f, 0.0f };
+
+        RasterScene() {
+            const std::vector<uint8_t> vertex_bytecode = passthrough_vertex_shader();
+            const std::vector<uint8_t> pixel_bytecode = color_pixel_shader();
+            CHECK(load_shader_program(vertex_bytecode.data(), vertex_bytecode.size(), vertex_shader));
+            CHECK(load_shader_program(pixel_bytecode.data(), pixel_bytecode.size(), pixel_shader));
+            pipeline_state.vertex_shader = &vertex_shader;
+            pipeline_state.pixel_shader = &pixel_shader;
+            pipeline_state.input_layout = { { "POSITION", 0, 4, 0 }, { "COLOR", 0, 3, 16 } };
+            pipeline_state.vertex_stride = sizeof(RasterVertex);
+        }
+
+        void add_triangle(const float a[4], const float b[4], const float c[4], const uint32_t triangle_index) {
+            const uint32_t color = raster_triangle_color(triangle_index);
+            for (const float* position : { a, b, c }) {
+                RasterVertex vertex;
+                memcpy(vertex.position, position, sizeof(vertex.position));
+                for (int i = 0; i < 3; ++i) {
+                    vertex.color[i] = static_cast<float>((color >> (i * 8)) & 0xFF) / 255.0f;
+                }
+                indices.push_back(static_cast<uint32_t>(vertices.size()));
+                vertices.push_back(vertex);
+            }
+        }
+
+        // Two triangles that cover the whole viewport at depth z
+        void add_fullscreen_quad(const float z, const uint32_t triangle_index) {
+            const float corners[4][4] = { { -1, -1, z, 1 }, { 1, -1, z, 1 }, { -1, 1, z, 1 }, { 1, 1, z, 1 } };
+            add_triangle(corners[0], corners[2], corners[1], triangle_index);
+            add_triangle(corners[1], corners[2], corners[3], triangle_index);
+        }
+
+        // Everything a draw needs, with a viewport that covers the render target
+        void bind(SoftwareRasterizer& rasterizer, SoftwareRenderTarget& render_target, const unsigned thread_count) {
+            pipeline_state.sample_count = render_target.sample_count;
+            pipeline_state.render_target_format = render_target.format;
+            rasterizer.set_pipeline_state(&pipeline_state);
+            rasterizer.set_vertex_buffer(vertices.data(), vertices.size() * sizeof(RasterVertex));
+            rasterizer.set_index_buffer(indices.data(), indices.size());
+            rasterizer.set_constant_buffer(0, color_scale, sizeof(color_scale));
+            SoftwareViewport viewport;
+            viewport.top_left_x = viewport_offset[0];
+            viewport.top_left_y = viewport_offset[1];
+            viewport.width = static_cast<float>(render_target.width);
+            viewport.height = static_cast<float>(render_target.height);
+            rasterizer.set_viewport(viewport);
+            rasterizer.set_render_target(&render_target);
+            rasterizer.set_thread_count(thread_count);
+        }
+
+        // Draws triangles [first_triangle, first_triangle + triangle_count), into a cleared render target unless
+        // `clear` is false
+        void draw(SoftwareRenderTarget& render_target, const unsigned thread_count, const uint32_t first_triangle,
+                  const uint32_t triangle_count, RasterStats* stats = nullptr, const bool clear = true) {
+            if (clear) {
+                const float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                render_target.clear_color(clear_color);
+                render_target.clear_depth(0.0f);
+            }
+            SoftwareRasterizer rasterizer;
+            bind(rasterizer, render_target, thread_count);
+            rasterizer.draw_indexed(triangle_count * 3, first_triangle * 3, 0);
+            if (stats) {
+                *stats = rasterizer.stats;
+            }
+        }
+    };
+
+    inline std::vector<uint32_t> resolve_color(const SoftwareRenderTarget& render_target) {
+        std::vector<uint32_t> pixels(static_cast<size_t>(render_target.width) * render_target.height);
+        render_target.resolve_color(pixels.data(), render_target.width);
+        return pixels;
+    }
+
+    inline float random_float(uint32_t& seed, const float low, const float high) {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
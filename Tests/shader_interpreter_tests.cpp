@@ -0,0 +1,667 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "dxbc_builder.h"
+#include "file_io.h"
+#include "glm/ext/matrix_transform.hpp"
+#include "glm/geometric.hpp"
+#include "glm/trigonometric.hpp"
+#include "light_clusters.h"
+#include "projection.h"
+#include "shader_interpreter.h"
+#include "test_common.h"
+
+/* SHADER INTERPRETER TESTS
+* Runs hand-assembled shaders (see dxbc_builder.h) and checks the results of every lane. Also checks that shaders
+* with instructions the interpreter doesn't implement are rejected at load time, instead of being skipped, and runs
+* the sample's own shaders from Shaders/ against a C++ version of the HLSL.
+*/
+
+namespace {
+    uint32_t as_bits(const float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // A vertex shader with one float input and one float2 output, running `instructions` between the declarations and ret
+    std::vector<uint8_t> make_test_shader(const std::vector<uint32_t>& instructions) {
+        std::vector<uint32_t> tokens = {
+            0x00010050,                     // vs_5_0
+            0x0100086a,                     // dcl_global_flags refactoringAllowed
+            0x0300005f, 0x00101012, 0,      // dcl_input v0.x
+            0x03000065, 0x00102032, 0,      // dcl_output o0.xy
+        };
+        tokens.insert(tokens.end(), instructions.begin(), instructions.end());
+        tokens.push_back(0x0100003e);       // ret
+        return test::make_dxbc({ { "VALUE", 0, 0, 0, 0x1 } }, { { "VALUE", 0, 0, 0, 0x3 } }, tokens);
+    }
+
+    // The same as a pixel shader, for derivatives
+    std::vector<uint8_t> make_test_pixel_shader(const std::vector<uint32_t>& instructions) {
+        std::vector<uint32_t> tokens = {
+            0x00000050,                     // ps_5_0
+            0x0100086a,                     // dcl_global_flags refactoringAllowed
+            0x03001062, 0x00101012, 0,      // dcl_input_ps linear v0.x
+            0x03000065, 0x00102032, 0,      // dcl_output o0.xy
+        };
+        tokens.insert(tokens.end(), instructions.begin(), instructions.end());
+        tokens.push_back(0x0100003e);       // ret
+        return test::make_dxbc({ { "VALUE", 0, 0, 0, 0x1 } }, { { "SV_Target", 0, 64, 0, 0x3 } }, tokens);
+    }
+
+    // Runs a program on one batch with the bits of `inputs` in v0.x, returns the bits of o0.x and o0.y
+    void run_test_shader(const ShaderProgram& program, const uint32_t inputs[shader_lane_count], uint32_t outputs[2][shader_lane_count]) {
+        ShaderContext context;
+        context.prepare(program);
+        memcpy(context.inputs[0].lanes[0], inputs, sizeof(context.inputs[0].lanes[0]));
+        execute_shader(program, context);
+        memcpy(outputs[0], context.outputs[0].lanes[0], sizeof(outputs[0]));
+        memcpy(outputs[1], context.outputs[0].lanes[1], sizeof(outputs[1]));
+    }
+
+    void test_sample_shaders() {
+        const std::vector<uint8_t> vertex_bytecode = test::passthrough_vertex_shader();
+        ShaderProgram vertex_shader;
+        if (!CHECK(load_shader_program(vertex_bytecode.data(), vertex_bytecode.size(), vertex_shader))) {
+            return;
+        }
+        CHECK(vertex_shader.stage == ShaderStage::vertex);
+        CHECK(vertex_shader.input_count == 2 && vertex_shader.output_count == 2 && vertex_shader.instructions.size() == 3);
+        CHECK(find_shader_register(vertex_shader.inputs, "COLOR", 0) == 1);
+        CHECK(find_shader_register(vertex_shader.inputs, "color", 0) == 1);
+        CHECK(find_shader_register(vertex_shader.inputs, "COLOR", 1) == -1);
+        CHECK(find_shader_system_value_register(vertex_shader.outputs, 1) == 1);
+
+        ShaderContext context;
+        context.prepare(vertex_shader);
+        const float constants[4] = { 2.0f, 3.0f, 4.0f, 0.0f };
+        context.constant_buffers[0] = constants;
+        context.constant_buffer_sizes[0] = 1;
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            for (int i = 0; i < 4; ++i) {
+                context.inputs[0].lanes[i][lane] = static_cast<float>(lane) + i * 0.25f;
+                context.inputs[1].lanes[i][lane] = static_cast<float>(lane * 4 + i);
+            }
+        }
+        execute_shader(vertex_shader, context);
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            for (int i = 0; i < 3; ++i) {
+                CHECK(context.outputs[0].lanes[i][lane] == static_cast<float>(lane * 4 + i) * constants[i]);
+            }
+            for (int i = 0; i < 4; ++i) {
+                CHECK(context.outputs[1].lanes[i][lane] == static_cast<float>(lane) + i * 0.25f);
+            }
+        }
+
+        const std::vector<uint8_t> pixel_bytecode = test::color_pixel_shader();
+        ShaderProgram pixel_shader;
+        if (!CHECK(load_shader_program(pixel_bytecode.data(), pixel_bytecode.size(), pixel_shader))) {
+            return;
+        }
+        CHECK(pixel_shader.stage == ShaderStage::pixel);
+        ShaderContext pixel_context;
+        pixel_context.prepare(pixel_shader);
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            pixel_context.inputs[0].lanes[0][lane] = lane * 0.125f;
+        }
+        execute_shader(pixel_shader, pixel_context);
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            CHECK(pixel_context.outputs[0].lanes[0][lane] == lane * 0.125f);
+            CHECK(pixel_context.outputs[0].lanes[3][lane] == 1.0f);
+        }
+    }
+
+    void test_float_to_integer() {
+        // ftoi o0.x, v0.x / ftou o0.y, v0.x
+        const std::vector<uint8_t> bytecode = make_test_shader({
+            0x0500001b, 0x00102012, 0, 0x0010100a, 0,
+            0x0500001c, 0x00102022, 0, 0x0010100a, 0,
+        });
+        ShaderProgram program;
+        if (!CHECK(load_shader_program(bytecode.data(), bytecode.size(), program))) {
+            return;
+        }
+
+        // Rounded towards zero, NaN becomes 0 and everything out of range saturates
+        const float inputs[] = { 2.75f, -2.75f, NAN, 1e10f, -1e10f, INFINITY, -INFINITY, 4294967040.0f,
+                                 -0.5f, 2147483520.0f, -2147483648.0f, 5e9f, 0.0f, -0.0f, 16777217.0f, 1.0f };
+        const uint32_t expected_int[] = { 2, static_cast<uint32_t>(-2), 0, 0x7FFFFFFF, 0x80000000, 0x7FFFFFFF, 0x80000000, 0x7FFFFFFF,
+                                          0, 2147483520u, 0x80000000, 0x7FFFFFFF, 0, 0, 16777216, 1 };
+        const uint32_t expected_uint[] = { 2, 0, 0, 0xFFFFFFFF, 0, 0xFFFFFFFF, 0, 4294967040u,
+                                           0, 2147483520u, 0, 0xFFFFFFFF, 0, 0, 16777216, 1 };
+        static_assert(sizeof(inputs) / sizeof(inputs[0]) == 2 * shader_lane_count, "Two batches of inputs");
+
+        ShaderContext context;
+        context.prepare(program);
+        for (uint32_t batch = 0; batch < 2; ++batch) {
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                context.inputs[0].lanes[0][lane] = inputs[batch * shader_lane_count + lane];
+            }
+            execute_shader(program, context);
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                CHECK(as_bits(context.outputs[0].lanes[0][lane]) == expected_int[batch * shader_lane_count + lane]);
+                CHECK(as_bits(context.outputs[0].lanes[1][lane]) == expected_uint[batch * shader_lane_count + lane]);
+            }
+        }
+    }
+
+    void test_structured_buffer_loads() {
+        // Elements of 5 dwords, element e holds e * 100 + dword
+        constexpr uint32_t stride = 20;
+        constexpr uint32_t element_count = 6;
+        uint32_t elements[element_count][stride / 4];
+        for (uint32_t e = 0; e < element_count; ++e) {
+            for (uint32_t i = 0; i < stride / 4; ++i) {
+                elements[e][i] = e * 100 + i;
+            }
+        }
+        const uint32_t draw_constants[4] = { 2, 0, 0, 0 };
+
+        // ftou r0.x, v0.x / ld_structured r1.xyzw, r0.x, l(4), t3.xyzw / mov o0.xy, r1.xwxx
+        const std::vector<uint8_t> per_lane_bytecode = make_test_shader({
+            0x02000068, 2,                  // dcl_temps 2
+            0x0500001c, 0x00100012, 0, 0x0010100a, 0,
+            0x090000a7, 0x001000f2, 1, 0x0010000a, 0, 0x00004001, 4, 0x00107e46, 3,
+            0x05000036, 0x00102032, 0, 0x001000c6, 1,
+        });
+        // The index from a constant, like transforms[transform_index] in hello_triangle.vs.hlsl, and w is past the element:
+        // ld_structured r1.xyzw, cb1[0].x, l(12), t3.xyzw / mov o0.xy, r1.xwxx
+        const std::vector<uint8_t> constant_index_bytecode = make_test_shader({
+            0x02000068, 2,                  // dcl_temps 2
+            0x0a0000a7, 0x001000f2, 1, 0x0020800a, 1, 0, 0x00004001, 12, 0x00107e46, 3,
+            0x05000036, 0x00102032, 0, 0x001000c6, 1,
+        });
+        ShaderProgram per_lane;
+        ShaderProgram constant_index;
+        if (!CHECK(load_shader_program(per_lane_bytecode.data(), per_lane_bytecode.size(), per_lane)) ||
+            !CHECK(load_shader_program(constant_index_bytecode.data(), constant_index_bytecode.size(), constant_index))) {
+            return;
+        }
+
+        // Past the last element reads 0, so does a slot without a buffer
+        const float indices[shader_lane_count] = { 0.0f, 1.0f, 5.0f, 6.0f, 7.0f, 2.9f, 1e10f, -1.0f };
+        const uint32_t expected_elements[shader_lane_count] = { 0, 1, 5, element_count, element_count, 2, element_count, 0 };
+        for (const bool bound : { true, false }) {
+            ShaderContext context;
+            context.prepare(per_lane);
+            if (bound) {
+                context.structured_buffers[3] = { reinterpret_cast<const uint8_t*>(elements), stride, element_count };
+            }
+            memcpy(context.inputs[0].lanes[0], indices, sizeof(indices));
+            execute_shader(per_lane, context);
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                const uint32_t e = expected_elements[lane];
+                const bool in_range = bound && e < element_count;
+                CHECK(as_bits(context.outputs[0].lanes[0][lane]) == (in_range ? e * 100 + 1 : 0));
+                CHECK(as_bits(context.outputs[0].lanes[1][lane]) == (in_range ? e * 100 + 4 : 0));
+            }
+        }
+
+        ShaderContext context;
+        context.prepare(constant_index);
+        context.structured_buffers[3] = { reinterpret_cast<const uint8_t*>(elements), stride, element_count };
+        context.constant_buffers[1] = reinterpret_cast<const float*>(draw_constants);
+        context.constant_buffer_sizes[1] = 1;
+        execute_shader(constant_index, context);
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            CHECK(as_bits(context.outputs[0].lanes[0][lane]) == 203);
+            CHECK(as_bits(context.outputs[0].lanes[1][lane]) == 0);
+        }
+
+        // Resources can't be read like registers, and a load needs a resource: mov o0.xy, t3.xyxx / ld_structured with r0 as the buffer
+        const std::vector<uint8_t> resource_move = make_test_shader({ 0x05000036, 0x00102032, 0, 0x00107046, 3 });
+        const std::vector<uint8_t> register_load = make_test_shader({
+            0x02000068, 1,                  // dcl_temps 1
+            0x090000a7, 0x00102032, 0, 0x0010100a, 0, 0x00004001, 0, 0x00100e46, 0,
+        });
+        ShaderProgram program;
+        CHECK(!load_shader_program(resource_move.data(), resource_move.size(), program));
+        CHECK(!load_shader_program(register_load.data(), register_load.size(), program));
+    }
+
+    void test_integer_ops() {
+        const uint32_t inputs[shader_lane_count] = { 0, 1, 5, 0xFFFFFFFF, 0x80000000, 0x7FFFFFFF, 123456789, 0xFFFFFFFD };
+        const uint32_t constants[] = { 5, 0xFFFFFFFD, 33 };
+
+        // <opcode> o0.x, v0.x, l(constant)
+        struct BinaryOp {
+            uint32_t opcode;
+            uint32_t (*expected)(uint32_t x, uint32_t y);
+        };
+        const BinaryOp binary_ops[] = {
+            { 30, [](const uint32_t x, const uint32_t y) { return x + y; } },                                               // iadd
+            { 32, [](const uint32_t x, const uint32_t y) { return x == y ? ~0u : 0u; } },                                   // ieq
+            { 33, [](const uint32_t x, const uint32_t y) { return static_cast<int32_t>(x) >= static_cast<int32_t>(y) ? ~0u : 0u; } }, // ige
+            { 34, [](const uint32_t x, const uint32_t y) { return static_cast<int32_t>(x) < static_cast<int32_t>(y) ? ~0u : 0u; } },  // ilt
+            { 36, [](const uint32_t x, const uint32_t y) { return static_cast<uint32_t>(std::max(static_cast<int32_t>(x), static_cast<int32_t>(y))); } }, // imax
+            { 37, [](const uint32_t x, const uint32_t y) { return static_cast<uint32_t>(std::min(static_cast<int32_t>(x), static_cast<int32_t>(y))); } }, // imin
+            { 39, [](const uint32_t x, const uint32_t y) { return x != y ? ~0u : 0u; } },                                   // ine
+            { 41, [](const uint32_t x, const uint32_t y) { return x << (y & 31); } },                                       // ishl
+            { 42, [](const uint32_t x, const uint32_t y) { return static_cast<int32_t>(x) < 0 ? ~(~x >> (y & 31)) : x >> (y & 31); } }, // ishr
+            { 79, [](const uint32_t x, const uint32_t y) { return x < y ? ~0u : 0u; } },                                    // ult
+            { 80, [](const uint32_t x, const uint32_t y) { return x >= y ? ~0u : 0u; } },                                   // uge
+            { 83, [](const uint32_t x, const uint32_t y) { return std::max(x, y); } },                                      // umax
+            { 84, [](const uint32_t x, const uint32_t y) { return std::min(x, y); } },                                      // umin
+            { 85, [](const uint32_t x, const uint32_t y) { return x >> (y & 31); } },                                       // ushr
+            { 87, [](const uint32_t x, const uint32_t y) { return x ^ y; } },                                               // xor
+        };
+        uint32_t outputs[2][shader_lane_count];
+        for (const BinaryOp& op : binary_ops) {
+            for (const uint32_t constant : constants) {
+                const std::vector<uint8_t> bytecode = make_test_shader({ 0x07000000 | op.opcode, 0x00102012, 0, 0x0010100a, 0, 0x00004001, constant });
+                ShaderProgram program;
+                if (!CHECK(load_shader_program(bytecode.data(), bytecode.size(), program))) {
+                    continue;
+                }
+                run_test_shader(program, inputs, outputs);
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    CHECK(outputs[0][lane] == op.expected(inputs[lane], constant));
+                }
+            }
+        }
+
+        // Two results: imul, umul and udiv o0.x, o0.y, v0.x, l(constant). Dividing by 0 sets all bits of both.
+        for (const uint32_t opcode : { 38u, 81u, 78u }) {
+            for (const uint32_t constant : { 5u, 0xFFFFFFFDu, 0u }) {
+                const std::vector<uint8_t> bytecode = make_test_shader({ 0x09000000 | opcode, 0x00102012, 0, 0x00102022, 0, 0x0010100a, 0, 0x00004001, constant });
+                ShaderProgram program;
+                if (!CHECK(load_shader_program(bytecode.data(), bytecode.size(), program))) {
+                    continue;
+                }
+                run_test_shader(program, inputs, outputs);
+                for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                    const uint32_t x = inputs[lane];
+                    uint32_t expected[2];
+                    if (opcode == 78) {
+                        expected[0] = constant != 0 ? x / constant : ~0u;
+                        expected[1] = constant != 0 ? x % constant : ~0u;
+                    }
+                    else {
+                        const uint64_t product = opcode == 38 ? static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(x)) * static_cast<int32_t>(constant))
+                                                              : static_cast<uint64_t>(x) * constant;
+                        expected[0] = static_cast<uint32_t>(product >> 32);
+                        expected[1] = static_cast<uint32_t>(product);
+                    }
+                    CHECK(outputs[0][lane] == expected[0] && outputs[1][lane] == expected[1]);
+                }
+            }
+        }
+
+        // One and three sources, and a negated integer source:
+        // ineg o0.x, v0.x / not o0.y, v0.x
+        // imad o0.x, v0.x, l(-3), l(7) / iadd o0.y, -v0.x, l(5)
+        // utof o0.x, v0.x / itof o0.y, v0.x
+        const std::vector<uint8_t> bytecodes[] = {
+            make_test_shader({ 0x05000028, 0x00102012, 0, 0x0010100a, 0, 0x0500003b, 0x00102022, 0, 0x0010100a, 0 }),
+            make_test_shader({
+                0x09000023, 0x00102012, 0, 0x0010100a, 0, 0x00004001, 0xFFFFFFFD, 0x00004001, 7,
+                0x0800001e, 0x00102022, 0, 0x8010100a, 0x00000041, 0, 0x00004001, 5,
+            }),
+            make_test_shader({ 0x05000056, 0x00102012, 0, 0x0010100a, 0, 0x0500002b, 0x00102022, 0, 0x0010100a, 0 }),
+        };
+        ShaderProgram programs[3];
+        for (int i = 0; i < 3; ++i) {
+            if (!CHECK(load_shader_program(bytecodes[i].data(), bytecodes[i].size(), programs[i]))) {
+                return;
+            }
+        }
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            const uint32_t x = inputs[lane];
+            uint32_t one_input[shader_lane_count] = {};
+            one_input[lane] = x;
+            run_test_shader(programs[0], one_input, outputs);
+            CHECK(outputs[0][lane] == 0u - x && outputs[1][lane] == ~x);
+            run_test_shader(programs[1], one_input, outputs);
+            CHECK(outputs[0][lane] == x * 0xFFFFFFFDu + 7 && outputs[1][lane] == 5 - x);
+            run_test_shader(programs[2], one_input, outputs);
+            CHECK(as_bits(static_cast<float>(x)) == outputs[0][lane] && as_bits(static_cast<float>(static_cast<int32_t>(x))) == outputs[1][lane]);
+        }
+
+        // Integers can't have float modifiers: iadd o0.x, |v0.x|, l(5)
+        const std::vector<uint8_t> absolute = make_test_shader({ 0x0800001e, 0x00102012, 0, 0x8010100a, 0x00000081, 0, 0x00004001, 5 });
+        ShaderProgram program;
+        CHECK(!load_shader_program(absolute.data(), absolute.size(), program));
+    }
+
+    void test_flow_control() {
+        // For n = v0.x: o0.x = the sum of i for i < min(n, 5), skipping i = 2, o0.y = n * 3 for odd n, -n for even n. For
+        // n = 9 it returns before that, with o0.xy = 77.
+        const std::vector<uint8_t> bytecode = make_test_shader({
+            0x02000068, 2,                                                      // dcl_temps 2
+            0x05000036, 0x00100012, 0, 0x0010100a, 0,                           // mov r0.x, v0.x
+            0x05000036, 0x00100022, 0, 0x00004001, 0,                           // mov r0.y, l(0)
+            0x05000036, 0x00100042, 0, 0x00004001, 0,                           // mov r0.z, l(0)
+            0x01000030,                                                         // loop
+            0x07000050, 0x00100012, 1, 0x0010001a, 0, 0x0010000a, 0,            //   uge r1.x, r0.y, r0.x
+            0x03040003, 0x0010000a, 1,                                          //   breakc_nz r1.x
+            0x07000020, 0x00100022, 1, 0x0010001a, 0, 0x00004001, 2,            //   ieq r1.y, r0.y, l(2)
+            0x0304001f, 0x0010001a, 1,                                          //   if_nz r1.y
+            0x0700001e, 0x00100022, 0, 0x0010001a, 0, 0x00004001, 1,            //     iadd r0.y, r0.y, l(1)
+            0x01000007,                                                         //     continue
+            0x01000015,                                                         //   endif
+            0x07000050, 0x00100042, 1, 0x0010001a, 0, 0x00004001, 5,            //   uge r1.z, r0.y, l(5)
+            0x03040003, 0x0010002a, 1,                                          //   breakc_nz r1.z
+            0x0700001e, 0x00100042, 0, 0x0010002a, 0, 0x0010001a, 0,            //   iadd r0.z, r0.z, r0.y
+            0x0700001e, 0x00100022, 0, 0x0010001a, 0, 0x00004001, 1,            //   iadd r0.y, r0.y, l(1)
+            0x01000016,                                                         // endloop
+            0x08000036, 0x00102032, 0, 0x00004002, 77, 77, 0, 0,                // mov o0.xy, l(77, 77, 0, 0)
+            0x07000020, 0x00100082, 1, 0x0010000a, 0, 0x00004001, 9,            // ieq r1.w, r0.x, l(9)
+            0x0304003f, 0x0010003a, 1,                                          // retc_nz r1.w
+            0x07000001, 0x00100012, 1, 0x0010000a, 0, 0x00004001, 1,            // and r1.x, r0.x, l(1)
+            0x0304001f, 0x0010000a, 1,                                          // if_nz r1.x
+            0x08000026, 0x0000d000, 0x00100082, 0, 0x0010000a, 0, 0x00004001, 3, //   imul null, r0.w, r0.x, l(3)
+            0x01000012,                                                         // else
+            0x05000028, 0x00100082, 0, 0x0010000a, 0,                           //   ineg r0.w, r0.x
+            0x01000015,                                                         // endif
+            0x05000036, 0x00102032, 0, 0x00100ae6, 0,                           // mov o0.xy, r0.zwzz
+        });
+        ShaderProgram program;
+        if (!CHECK(load_shader_program(bytecode.data(), bytecode.size(), program))) {
+            return;
+        }
+        const uint32_t inputs[shader_lane_count] = { 0, 1, 2, 3, 4, 5, 6, 9 };
+        const uint32_t expected_sums[shader_lane_count] = { 0, 0, 1, 1, 4, 8, 8, 77 };
+        uint32_t outputs[2][shader_lane_count];
+        run_test_shader(program, inputs, outputs);
+        for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+            const uint32_t n = inputs[lane];
+            CHECK(outputs[0][lane] == expected_sums[lane]);
+            CHECK(outputs[1][lane] == (n == 9 ? 77 : (n & 1) ? n * 3 : 0u - n));
+        }
+
+        // Blocks that don't end, end twice, or end the wrong way, and breaks outside of loops
+        const std::vector<uint32_t> broken_blocks[] = {
+            { 0x0304001f, 0x0010100a, 0 },                                      // if_nz v0.x
+            { 0x01000015 },                                                     // endif
+            { 0x01000030, 0x01000015 },                                         // loop / endif
+            { 0x0304001f, 0x0010100a, 0, 0x01000016 },                          // if_nz v0.x / endloop
+            { 0x0304001f, 0x0010100a, 0, 0x01000012, 0x01000012, 0x01000015 },  // if_nz v0.x / else / else / endif
+            { 0x01000002 },                                                     // break
+            { 0x0304001f, 0x0010100a, 0, 0x01000007, 0x01000015 },              // if_nz v0.x / continue / endif
+        };
+        for (const std::vector<uint32_t>& instructions : broken_blocks) {
+            const std::vector<uint8_t> broken = make_test_shader(instructions);
+            CHECK(!load_shader_program(broken.data(), broken.size(), program));
+        }
+
+        // 64 nested ifs are fine, 65 are too many
+        for (const uint32_t depth : { shader_max_flow_control_depth, shader_max_flow_control_depth + 1 }) {
+            std::vector<uint32_t> instructions;
+            for (uint32_t i = 0; i < depth; ++i) {
+                instructions.insert(instructions.end(), { 0x0304001f, 0x0010100a, 0 });
+            }
+            instructions.insert(instructions.end(), depth, 0x01000015);
+            const std::vector<uint8_t> nested = make_test_shader(instructions);
+            CHECK(load_shader_program(nested.data(), nested.size(), program) == (depth <= shader_max_flow_control_depth));
+        }
+    }
+
+    void test_derivatives() {
+        // The lanes are two quads, top left, top right, bottom left, bottom right: v0.x = lane * lane is
+        //  0  1 | 16 25
+        //  4  9 | 36 49
+        const uint32_t opcodes[] = { 122, 123, 124, 125, 11, 12 };
+        const float expected[][shader_lane_count] = {
+            { 1, 1, 1, 1, 9, 9, 9, 9 },         // deriv_rtx_coarse: top row
+            { 1, 1, 5, 5, 9, 9, 13, 13 },       // deriv_rtx_fine: own row
+            { 4, 4, 4, 4, 20, 20, 20, 20 },     // deriv_rty_coarse: left column
+            { 4, 8, 4, 8, 20, 24, 20, 24 },     // deriv_rty_fine: own column
+            { 1, 1, 1, 1, 9, 9, 9, 9 },         // deriv_rtx is coarse
+            { 4, 4, 4, 4, 20, 20, 20, 20 },     // deriv_rty too
+        };
+        for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); ++i) {
+            // <opcode> o0.x, v0.x
+            const std::vector<uint32_t> instruction = { 0x05000000 | opcodes[i], 0x00102012, 0, 0x0010100a, 0 };
+            const std::vector<uint8_t> bytecode = make_test_pixel_shader(instruction);
+            ShaderProgram program;
+            if (!CHECK(load_shader_program(bytecode.data(), bytecode.size(), program))) {
+                continue;
+            }
+            CHECK(program.uses_derivatives);
+            uint32_t inputs[shader_lane_count];
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                inputs[lane] = as_bits(static_cast<float>(lane * lane));
+            }
+            uint32_t outputs[2][shader_lane_count];
+            run_test_shader(program, inputs, outputs);
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                CHECK(outputs[0][lane] == as_bits(expected[i][lane]));
+            }
+
+            // Vertex shaders don't have quads
+            const std::vector<uint8_t> vertex_bytecode = make_test_shader(instruction);
+            CHECK(!load_shader_program(vertex_bytecode.data(), vertex_bytecode.size(), program));
+        }
+    }
+
+    bool load_shader_file(const std::string& path, ShaderProgram& program) {
+        size_t size = 0;
+        char* data = nullptr;
+        read_file(path, size, data, false);
+        const bool loaded = data && load_shader_program(data, size, program);
+        free(data);
+        return loaded;
+    }
+
+    // Must match frame_constants.hlsli
+    struct FrameConstants {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 color_mul;
+        uint32_t light_count;
+        ClusterLookup cluster_lookup;
+    };
+    static_assert(sizeof(FrameConstants) == 10 * 16, "FrameConstants must match the HLSL cbuffer");
+
+    bool nearly_equal(const float a, const float b) {
+        return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(b));
+    }
+
+    /* SAMPLE SHADERS
+    * Shaders/hello_triangle.vs.cso and .ps.cso are hello_triangle.vs.hlsl and .ps.hlsl from Shaders/DX12 as FXC
+    * compiles them, with the listings next to them. The vertex shader gets random vertices and all of the transforms,
+    * the pixel shader gets quads of pixels on a surface in front of the camera, lit by lights assigned to clusters
+    * by assign_lights_to_clusters(), so it runs its loop and both sides of its if.
+    */
+    void test_hello_triangle_shaders() {
+        ShaderProgram vertex_shader;
+        ShaderProgram pixel_shader;
+        if (!CHECK(load_shader_file(TEST_DATA_DIR "/Shaders/hello_triangle.vs.cso", vertex_shader)) ||
+            !CHECK(load_shader_file(TEST_DATA_DIR "/Shaders/hello_triangle.ps.cso", pixel_shader))) {
+            return;
+        }
+        CHECK(vertex_shader.stage == ShaderStage::vertex && pixel_shader.stage == ShaderStage::pixel && pixel_shader.uses_derivatives);
+        CHECK(find_shader_register(vertex_shader.outputs, "VIEW_POSITION", 0) == 1 && find_shader_register(pixel_shader.inputs, "VIEW_POSITION", 0) == 1);
+        CHECK(find_shader_system_value_register(vertex_shader.outputs, 1) == 2 && find_shader_system_value_register(pixel_shader.inputs, 1) == 2);
+
+        constexpr uint32_t width = 1280;
+        constexpr uint32_t height = 720;
+        constexpr float near_plane = 0.1f;
+        FrameConstants constants = {};
+        constants.view = glm::lookAt(glm::vec3(1.0f, 2.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        constants.projection = reverse_z_infinite_perspective(glm::radians(60.0f), static_cast<float>(width) / height, near_plane);
+        constants.color_mul = glm::vec3(0.5f, 1.0f, 2.0f);
+        const ClusterGrid grid = make_cluster_grid(constants.projection, width, height, near_plane, 60.0f);
+        constants.cluster_lookup = grid.lookup;
+
+        std::mt19937 random(17);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+        // Vertex shader, with every transform_index
+        std::vector<glm::mat4> transforms;
+        for (int i = 0; i < 4; ++i) {
+            const glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), uniform(random) * 6.0f, glm::normalize(glm::vec3(uniform(random), 1.0f, uniform(random))));
+            transforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(i * 2.0f - 3.0f, uniform(random), -uniform(random))) * rotation);
+        }
+        ShaderContext vertex_context;
+        vertex_context.prepare(vertex_shader);
+        vertex_context.constant_buffers[0] = reinterpret_cast<const float*>(&constants);
+        vertex_context.constant_buffer_sizes[0] = sizeof(FrameConstants) / 16;
+        vertex_context.structured_buffers[3] = { reinterpret_cast<const uint8_t*>(transforms.data()), sizeof(glm::mat4), static_cast<uint32_t>(transforms.size()) };
+        size_t vertex_mismatches = 0;
+        for (uint32_t transform_index = 0; transform_index < transforms.size(); ++transform_index) {
+            const uint32_t draw_constants[4] = { transform_index, 0, 0, 0 };
+            vertex_context.constant_buffers[1] = reinterpret_cast<const float*>(draw_constants);
+            vertex_context.constant_buffer_sizes[1] = 1;
+            glm::vec3 positions[shader_lane_count];
+            glm::vec3 colors[shader_lane_count];
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                positions[lane] = glm::vec3(uniform(random), uniform(random), uniform(random)) * 2.0f - 1.0f;
+                colors[lane] = glm::vec3(uniform(random), uniform(random), uniform(random));
+                for (int i = 0; i < 3; ++i) {
+                    vertex_context.inputs[0].lanes[i][lane] = positions[lane][i];
+                    vertex_context.inputs[1].lanes[i][lane] = colors[lane][i];
+                }
+            }
+            execute_shader(vertex_shader, vertex_context);
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                const glm::vec4 view_position = constants.view * (transforms[transform_index] * glm::vec4(positions[lane], 1.0f));
+                const glm::vec4 position = constants.projection * view_position;
+                const glm::vec3 color = colors[lane] * constants.color_mul;
+                for (int i = 0; i < 4; ++i) {
+                    vertex_mismatches += i < 3 && !nearly_equal(vertex_context.outputs[0].lanes[i][lane], color[i]);
+                    vertex_mismatches += i < 3 && !nearly_equal(vertex_context.outputs[1].lanes[i][lane], view_position[i]);
+                    vertex_mismatches += !nearly_equal(vertex_context.outputs[2].lanes[i][lane], position[i]);
+                }
+            }
+        }
+        if (!CHECK(vertex_mismatches == 0)) {
+            printf("    %zu vertex shader outputs differ from the HLSL\n", vertex_mismatches);
+        }
+
+        // Pixel shader, lights up to 30 units away
+        std::vector<ClusterLight> lights(3000);
+        for (ClusterLight& light : lights) {
+            const float depth = 1.0f + 29.0f * uniform(random) * uniform(random);
+            light.position = glm::vec3((uniform(random) * 2.0f - 1.0f) * depth * 1.03f, (uniform(random) * 2.0f - 1.0f) * depth * 0.58f, -depth);
+            light.radius = 0.5f + 2.5f * uniform(random);
+            light.color = glm::vec3(uniform(random), uniform(random), uniform(random));
+            light.padding = 0.0f;
+        }
+        constants.light_count = static_cast<uint32_t>(lights.size());
+        ClusterLightLists lists;
+        assign_lights_to_clusters(grid, lights.data(), constants.light_count, lists, nullptr, 1);
+
+        ShaderContext pixel_context;
+        pixel_context.prepare(pixel_shader);
+        pixel_context.constant_buffers[0] = reinterpret_cast<const float*>(&constants);
+        pixel_context.constant_buffer_sizes[0] = sizeof(FrameConstants) / 16;
+        pixel_context.structured_buffers[0] = { reinterpret_cast<const uint8_t*>(lists.ranges.data()), sizeof(ClusterRange), cluster_count };
+        pixel_context.structured_buffers[1] = { reinterpret_cast<const uint8_t*>(lists.light_indices.data()), sizeof(uint32_t),
+                                                static_cast<uint32_t>(lists.light_indices.size()) };
+        pixel_context.structured_buffers[2] = { reinterpret_cast<const uint8_t*>(lights.data()), sizeof(ClusterLight), constants.light_count };
+
+        size_t pixel_mismatches = 0;
+        uint32_t lit_pixels = 0;
+        uint32_t missed_lights = 0;
+        for (int batch = 0; batch < 500; ++batch) {
+            // Two quads, each pixel on a slanted surface between 2 and 20 units away
+            glm::vec2 pixels[shader_lane_count];
+            glm::vec3 view_positions[shader_lane_count];
+            glm::vec3 colors[shader_lane_count];
+            for (uint32_t quad = 0; quad < 2; ++quad) {
+                const uint32_t quad_x = static_cast<uint32_t>(uniform(random) * (width / 2)) * 2;
+                const uint32_t quad_y = static_cast<uint32_t>(uniform(random) * (height / 2)) * 2;
+                for (uint32_t corner = 0; corner < 4; ++corner) {
+                    const uint32_t lane = quad * 4 + corner;
+                    pixels[lane] = glm::vec2(quad_x + (corner & 1) + 0.5f, quad_y + (corner >> 1) + 0.5f);
+                    const glm::vec2 ndc(pixels[lane].x / width * 2.0f - 1.0f, 1.0f - pixels[lane].y / height * 2.0f);
+                    const float depth = 2.0f + 18.0f * (pixels[lane].x / width * 0.3f + pixels[lane].y / height * 0.7f);
+                    view_positions[lane] = glm::vec3(ndc.x / constants.projection[0][0], ndc.y / constants.projection[1][1], -1.0f) * depth;
+                    colors[lane] = glm::vec3(uniform(random), uniform(random), uniform(random));
+                    for (int i = 0; i < 3; ++i) {
+                        pixel_context.inputs[0].lanes[i][lane] = colors[lane][i];
+                        pixel_context.inputs[1].lanes[i][lane] = view_positions[lane][i];
+                    }
+                    pixel_context.inputs[2].lanes[0][lane] = pixels[lane].x;
+                    pixel_context.inputs[2].lanes[1][lane] = pixels[lane].y;
+                }
+            }
+            execute_shader(pixel_shader, pixel_context);
+
+            for (uint32_t lane = 0; lane < shader_lane_count; ++lane) {
+                // ddx and ddy are coarse: the same for the whole quad
+                const uint32_t top_left = lane & ~3u;
+                const glm::vec3 ddx = view_positions[top_left + 1] - view_positions[top_left];
+                const glm::vec3 ddy = view_positions[top_left + 2] - view_positions[top_left];
+                const glm::vec3 normal = glm::normalize(glm::cross(ddy, ddx));
+                const glm::vec3& view_position = view_positions[lane];
+                const ClusterRange range = lists.ranges[cluster_at(constants.cluster_lookup, pixels[lane].x, pixels[lane].y, -view_position.z)];
+                glm::vec3 lighting(0.25f);
+                for (uint32_t i = 0; i < range.count; ++i) {
+                    const ClusterLight& light = lights[lists.light_indices[range.offset + i]];
+                    const glm::vec3 to_light = light.position - view_position;
+                    const float distance_squared = glm::dot(to_light, to_light);
+                    const float radius_squared = light.radius * light.radius;
+                    if (distance_squared < radius_squared) {
+                        const float falloff = 1.0f - distance_squared / radius_squared;
+                        const float facing = glm::dot(normal, to_light / std::sqrt(std::max(distance_squared, 1e-8f)));
+                        lighting += light.color * (falloff * falloff * std::min(std::max(facing, 0.0f), 1.0f));
+                    }
+                    else {
+                        ++missed_lights;
+                    }
+                }
+                lit_pixels += lighting != glm::vec3(0.25f);
+                const glm::vec4 expected(colors[lane] * lighting, 1.0f);
+                for (int i = 0; i < 4; ++i) {
+                    pixel_mismatches += !nearly_equal(pixel_context.outputs[0].lanes[i][lane], expected[i]);
+                }
+            }
+        }
+        if (!CHECK(pixel_mismatches == 0)) {
+            printf("    %zu pixel shader outputs differ from the HLSL\n", pixel_mismatches);
+        }
+        // Most pixels have a light that reaches them, but not all, and most lights in a cluster don't
+        CHECK(lit_pixels > 2000 && lit_pixels < 4000 && missed_lights > 10000);
+    }
+
+    void test_unsupported_opcodes() {
+        // Instructions of shader model 4.1 and 5 that have opcodes between the declarations, and a few below them
+        const uint32_t opcodes[] = {
+            69,     // sample
+            76,     // switch
+            108,    // lod
+            109,    // gather4
+            129,    // rcp
+            131,    // f16tof32
+            138,    // ubfe
+            140,    // bfi
+            169,    // atomic_and
+            190,    // sync
+        };
+        for (const uint32_t opcode : opcodes) {
+            // <opcode> o0.x, v0.x
+            const std::vector<uint8_t> bytecode = make_test_shader({ 0x05000000 | opcode, 0x00102012, 0, 0x0010100a, 0 });
+            ShaderProgram program;
+            CHECK(!load_shader_program(bytecode.data(), bytecode.size(), program));
+        }
+
+        // Declarations from every range are skipped
+        const std::vector<uint8_t> bytecode = make_test_shader({
+            0x04000059, 0x00208e46, 0, 1,   // dcl_constantbuffer cb0[1]
+            0x0300005a, 0x00106000, 0,      // dcl_sampler s0, mode_default
+            0x020000ce, 1,                  // dcl_gs_instance_count 1
+            0x040000a2, 0x00107000, 0, 16,  // dcl_resource_structured t0, 16
+            0x05000036, 0x00102032, 0, 0x00101006, 0, // mov o0.xy, v0.xx
+        });
+        ShaderProgram program;
+        CHECK(load_shader_program(bytecode.data(), bytecode.size(), program));
+    }
+}
+
+int main() {
+    test_sample_shaders();
+    test_float_to_integer();
+    test_structured_buffer_loads();
+    test_integer_ops();
+    test_flow_control();
+    test_derivatives();
+    test_hello_triangle_shaders();
+    test_unsupported_opcodes();
+    return test::test_result();
+}
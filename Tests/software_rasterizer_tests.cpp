@@ -0,0 +1,805 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "file_io.h"
+#include "raster_scene.h"
+#include "tile_binner.h"
+
+/* SOFTWARE RASTERIZER TESTS
+* Draws the scenes from raster_scene.h, where the color of a pixel says which triangle was drawn there last.
+*/
+
+namespace {
+    using test::RasterScene;
+    using test::random_float;
+    using test::resolve_color;
+
+    /* CLIPPED TRIANGLE ORDER
+    * Triangles that cross the w = 0 plane or reach past the guard band are clipped into fans, which are set up
+    * separately from the rest of their batch. The fans still have to be drawn where their triangle was submitted.
+    * Without depth, the last triangle that covers a pixel decides its color, so drawing every triangle on its own
+    * tells us what every pixel of the whole draw has to be.
+    */
+    void test_clipped_triangle_order() {
+        RasterScene scene;
+        uint32_t seed = 3;
+        constexpr uint32_t triangle_count = 48;
+        for (uint32_t i = 0; i < triangle_count; ++i) {
+            float vertices[3][4];
+            for (auto& vertex : vertices) {
+                vertex[0] = random_float(seed, -1.2f, 1.2f);
+                vertex[1] = random_float(seed, -1.2f, 1.2f);
+                vertex[2] = 0.5f;
+                vertex[3] = 1.0f;
+            }
+            if (i % 3 == 1) {
+                // One vertex behind the camera
+                vertices[2][2] = -0.5f;
+                vertices[2][3] = -0.5f;
+            }
+            else if (i % 3 == 2) {
+                // One vertex far outside the guard band
+                vertices[1][0] = 5000.0f;
+            }
+            scene.add_triangle(vertices[0], vertices[1], vertices[2], i);
+        }
+
+        SoftwareRenderTarget render_target;
+        render_target.resize(160, 96);
+        std::vector<uint32_t> expected(static_cast<size_t>(render_target.width) * render_target.height, 0);
+        std::vector<uint32_t> last_triangle(expected.size(), UINT32_MAX);
+        for (uint32_t i = 0; i < triangle_count; ++i) {
+            scene.draw(render_target, 1, i, 1);
+            const std::vector<uint32_t> pixels = resolve_color(render_target);
+            for (size_t pixel = 0; pixel < pixels.size(); ++pixel) {
+                if (pixels[pixel] != 0) {
+                    expected[pixel] = pixels[pixel];
+                    last_triangle[pixel] = i;
+                }
+            }
+        }
+
+        // The scene only tests something if clipped triangles are drawn over others and the other way around
+        uint32_t clipped_on_top = 0;
+        uint32_t unclipped_on_top = 0;
+        for (const uint32_t triangle : last_triangle) {
+            clipped_on_top += triangle != UINT32_MAX && triangle % 3 != 0;
+            unclipped_on_top += triangle != UINT32_MAX && triangle % 3 == 0;
+        }
+        CHECK(clipped_on_top > 200 && unclipped_on_top > 200);
+
+        for (const unsigned thread_count : { 1u, 2u, 3u, 8u }) {
+            RasterStats stats;
+            scene.draw(render_target, thread_count, 0, triangle_count, &stats);
+            CHECK(stats.triangles_clipped == 32);
+            CHECK(resolve_color(render_target) == expected);
+        }
+    }
+
+    // Lists from three arenas, with a triangle that was split into two entries
+    void test_merge_tile_bins() {
+        std::vector<TileBinArena> arenas(3);
+        for (TileBinArena& arena : arenas) {
+            arena.reset(2);
+        }
+        const uint32_t sequences[3][4] = { { 0, 3, 3, 9 }, { 1, 2, 7, 8 }, { 4, 5, 6, 10 } };
+        for (uint32_t arena = 0; arena < 3; ++arena) {
+            for (uint32_t i = 0; i < 4; ++i) {
+                arenas[arena].append(1, BinEntry{ sequences[arena][i], arena * 10 + i });
+            }
+        }
+        // Enough entries in tile 0 to need more than one chunk
+        for (uint32_t i = 0; i < 200; ++i) {
+            arenas[i % 3].append(0, BinEntry{ i, i });
+        }
+
+        std::vector<BinReference> merged;
+        merge_tile_bins(arenas, 1, merged);
+        const uint32_t expected[12] = { 0, 10, 11, 1, 2, 20, 21, 22, 12, 13, 3, 23 };
+        if (CHECK(merged.size() == 12)) {
+            for (uint32_t i = 0; i < 12; ++i) {
+                CHECK(merged[i].payload == expected[i] && merged[i].arena == expected[i] / 10);
+            }
+        }
+        merge_tile_bins(arenas, 0, merged);
+        if (CHECK(merged.size() == 200)) {
+            for (uint32_t i = 0; i < 200; ++i) {
+                CHECK(merged[i].payload == i && merged[i].arena == i % 3);
+            }
+        }
+
+        // Reset keeps the chunks, and an empty tile merges to nothing
+        arenas[0].reset(2);
+        CHECK(arenas[0].empty(0) && arenas[0].chunk_count() == 0);
+        for (TileBinArena& arena : arenas) {
+            arena.reset(2);
+        }
+        merge_tile_bins(arenas, 0, merged);
+        CHECK(merged.empty());
+    }
+
+    /* THREAD COUNT DETERMINISM
+    * Every thread bins into its own lists and the lists are merged per tile, so the image has to be the same, bit for
+    * bit, for any thread count. Thousands of small triangles with some that cross the near plane and get clipped,
+    * with and without depth.
+    */
+    void test_thread_count_determinism() {
+        RasterScene scene;
+        uint32_t seed = 11;
+        constexpr uint32_t triangle_count = 20000;
+        for (uint32_t i = 0; i < triangle_count; ++i) {
+            const float x = random_float(seed, -1.1f, 1.1f);
+            const float y = random_float(seed, -1.1f, 1.1f);
+            const float size = random_float(seed, 0.01f, 0.3f);
+            float vertices[3][4];
+            for (auto& vertex : vertices) {
+                vertex[3] = random_float(seed, 0.5f, 2.0f);
+                vertex[0] = (x + random_float(seed, -size, size)) * vertex[3];
+                vertex[1] = (y + random_float(seed, -size, size)) * vertex[3];
+                vertex[2] = random_float(seed, 0.05f, 0.95f) * vertex[3];
+            }
+            if (i % 50 == 0) {
+                // Reaches behind the camera, the clipped part covers a big part of the screen
+                vertices[0][2] = -1.0f;
+                vertices[0][3] = -0.25f;
+            }
+            scene.add_triangle(vertices[0], vertices[1], vertices[2], i);
+        }
+
+        SoftwareRenderTarget render_target;
+        render_target.resize(320, 200);
+        for (const bool depth_enable : { false, true }) {
+            scene.pipeline_state.depth_enable = depth_enable;
+            std::vector<uint32_t> expected_color;
+            std::vector<float> expected_depth;
+            uint64_t expected_clipped = 0;
+            for (const unsigned thread_count : { 1u, 2u, 3u, 4u, 5u, 7u, 8u, 16u }) {
+                RasterStats stats;
+                scene.draw(render_target, thread_count, 0, triangle_count, &stats);
+
+                std::vector<float> depth(static_cast<size_t>(render_target.width) * render_target.height);
+                render_target.resolve_depth(depth.data(), render_target.width);
+                if (thread_count == 1) {
+                    // Some of the ones reaching behind the camera are entirely off screen and culled before clipping
+                    CHECK(stats.triangles_clipped > triangle_count / 100);
+                    expected_color = resolve_color(render_target);
+                    expected_depth = depth;
+                    expected_clipped = stats.triangles_clipped;
+                    continue;
+                }
+                CHECK(stats.triangles_clipped == expected_clipped);
+                CHECK(resolve_color(render_target) == expected_color);
+                CHECK(memcmp(depth.data(), expected_depth.data(), depth.size() * sizeof(float)) == 0);
+            }
+        }
+    }
+
+    // Overlapping triangles of all sizes and slopes at different depths, some of them cutting through each other
+    void add_msaa_scene(RasterScene& scene) {
+        uint32_t seed = 5;
+        for (uint32_t i = 0; i < 300; ++i) {
+            const float x = random_float(seed, -1.1f, 1.1f);
+            const float y = random_float(seed, -1.1f, 1.1f);
+            const float size = random_float(seed, 0.01f, 0.6f);
+            float vertices[3][4];
+            for (auto& vertex : vertices) {
+                vertex[0] = x + random_float(seed, -size, size);
+                vertex[1] = y + random_float(seed, -size, size);
+                vertex[2] = random_float(seed, 0.1f, 0.9f);
+                vertex[3] = 1.0f;
+            }
+            scene.add_triangle(vertices[0], vertices[1], vertices[2], i);
+        }
+        scene.pipeline_state.depth_enable = true;
+    }
+
+    // The color of one sample, however the pixel is stored
+    uint32_t sample_color(const SoftwareRenderTarget& render_target, const uint32_t x, const uint32_t y, const uint32_t sample) {
+        const size_t block = static_cast<size_t>(y / raster_block_size) * render_target.blocks_x + x / raster_block_size;
+        const uint32_t pixel = (y % raster_block_size) * raster_block_size + x % raster_block_size;
+        if (render_target.cleared_blocks[block] & 1) {
+            return render_target.clear_color_value;
+        }
+        if ((render_target.expanded_pixels[block] >> pixel) & 1) {
+            const SampleColorBlock& colors = *render_target.sample_colors[block];
+            return colors.colors[colors.slots[pixel] * render_target.sample_count + sample];
+        }
+        return render_target.color[block * raster_block_pixels + pixel];
+    }
+
+    /* MSAA SAMPLES
+    * Every sample has to be exactly what a render without MSAA gives, with the viewport moved so the sample lands on
+    * the pixel center. The offsets are the standard D3D sample patterns, in 1/16 pixels.
+    */
+    void test_msaa_samples() {
+        struct Pattern {
+            uint32_t sample_count;
+            int8_t offsets[8][2];
+        };
+        const Pattern patterns[] = {
+            { 2, { { 4, 4 }, { -4, -4 } } },
+            { 4, { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } } },
+            { 8, { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 }, { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } } },
+        };
+
+        RasterScene scene;
+        add_msaa_scene(scene);
+        SoftwareRenderTarget single_sample;
+        single_sample.resize(96, 64);
+        for (const Pattern& pattern : patterns) {
+            SoftwareRenderTarget render_target;
+            render_target.resize(96, 64, pattern.sample_count);
+            scene.viewport_offset[0] = scene.viewport_offset[1] = 0.0f;
+            scene.draw(render_target, 4, 0, 300);
+
+            for (uint32_t sample = 0; sample < pattern.sample_count; ++sample) {
+                scene.viewport_offset[0] = -pattern.offsets[sample][0] / 16.0f;
+                scene.viewport_offset[1] = -pattern.offsets[sample][1] / 16.0f;
+                scene.draw(single_sample, 4, 0, 300);
+                const std::vector<uint32_t> expected = resolve_color(single_sample);
+                size_t mismatches = 0;
+                for (uint32_t y = 0; y < render_target.height; ++y) {
+                    for (uint32_t x = 0; x < render_target.width; ++x) {
+                        mismatches += sample_color(render_target, x, y, sample) != expected[y * render_target.width + x];
+                    }
+                }
+                if (!CHECK(mismatches == 0)) {
+                    printf("    %ux MSAA, sample %u: %zu pixels differ\n", pattern.sample_count, sample, mismatches);
+                }
+            }
+        }
+    }
+
+    /* SHARED VERTICES
+    * A 16x16 grid of cells with indexed vertices, so inner vertices are used by 6 triangles: 512 triangles and 1536
+    * indices, but only 289 vertices. Drawn from a vertex buffer with nothing else in it, every vertex is shaded once
+    * up front. With the grid spread out over a buffer 4 times as big, the indices are handled in batches of 128
+    * triangles, which are 4 rows of cells: 5 rows of 17 vertices per batch, and the rows between batches get shaded
+    * again, 340 in total. Both have to draw the same image.
+    */
+    void test_shared_vertex_grid() {
+        constexpr uint32_t cells = 16;
+        constexpr uint32_t row_vertices = cells + 1;
+        RasterScene dense;
+        for (uint32_t y = 0; y < row_vertices; ++y) {
+            for (uint32_t x = 0; x < row_vertices; ++x) {
+                test::RasterVertex vertex = { { -0.9f + 1.8f * x / cells, -0.9f + 1.8f * y / cells, 0.5f, 1.0f },
+                                              { static_cast<float>(x) / cells, static_cast<float>(y) / cells, 0.5f } };
+                dense.vertices.push_back(vertex);
+            }
+        }
+        for (uint32_t y = 0; y < cells; ++y) {
+            for (uint32_t x = 0; x < cells; ++x) {
+                const uint32_t corner = y * row_vertices + x;
+                for (const uint32_t index : { corner, corner + 1, corner + row_vertices, corner + 1, corner + row_vertices + 1, corner + row_vertices }) {
+                    dense.indices.push_back(index);
+                }
+            }
+        }
+        RasterScene sparse;
+        sparse.vertices.resize(dense.vertices.size() * 4, dense.vertices[0]);
+        for (size_t i = 0; i < dense.vertices.size(); ++i) {
+            sparse.vertices[i * 4] = dense.vertices[i];
+        }
+        for (const uint32_t index : dense.indices) {
+            sparse.indices.push_back(index * 4);
+        }
+
+        SoftwareRenderTarget render_target;
+        render_target.resize(96, 64);
+        for (const unsigned thread_count : { 1u, 4u }) {
+            RasterStats stats;
+            dense.draw(render_target, thread_count, 0, cells * cells * 2, &stats);
+            CHECK(stats.vertex_shader_invocations == row_vertices * row_vertices);
+            const std::vector<uint32_t> expected = resolve_color(render_target);
+            sparse.draw(render_target, thread_count, 0, cells * cells * 2, &stats);
+            CHECK(stats.vertex_shader_invocations == 340);
+            CHECK(resolve_color(render_target) == expected);
+        }
+    }
+
+    /* TILED RESOLVE
+    * The blocks resolved to a row major image, against a reference that reads every pixel through pixel_index(), for
+    * sizes that don't fill their edge blocks and a row pitch wider than the image. A cleared block has to read back as
+    * the clear color without its memory being touched, so the blocks are filled with garbage before the clear. Then
+    * some blocks are drawn to after the clear, and only those read back what's in memory.
+    */
+    void test_tiled_resolve() {
+        const uint32_t sizes[][2] = { { 1, 1 }, { 7, 5 }, { 8, 8 }, { 37, 21 }, { 64, 64 }, { 65, 9 } };
+        for (const auto& size : sizes) {
+            SoftwareRenderTarget render_target;
+            render_target.resize(size[0], size[1]);
+            const size_t row_pitch = size[0] + 3;
+            const size_t pixel_count = row_pitch * size[1];
+            for (size_t i = 0; i < render_target.color.size(); ++i) {
+                render_target.color[i] = static_cast<uint32_t>(i) * 2654435761u;
+                render_target.depth[i] = static_cast<float>(i);
+            }
+
+            // Every pixel, and nothing in the padding at the end of the rows
+            const auto check_resolve = [&](const bool prepared_only, const uint32_t clear_color, const float clear_depth) {
+                std::vector<uint32_t> color(pixel_count, 0xDEADBEEF);
+                std::vector<float> depth(pixel_count, -1.0f);
+                render_target.resolve_color(color.data(), row_pitch);
+                render_target.resolve_depth(depth.data(), row_pitch);
+                size_t mismatches = 0;
+                for (uint32_t y = 0; y < size[1]; ++y) {
+                    for (uint32_t x = 0; x < row_pitch; ++x) {
+                        const size_t i = y * row_pitch + x;
+                        if (x >= size[0]) {
+                            mismatches += color[i] != 0xDEADBEEF || depth[i] != -1.0f;
+                            continue;
+                        }
+                        const size_t pixel = render_target.pixel_index(x, y);
+                        const bool cleared = prepared_only && render_target.cleared_blocks[pixel / raster_block_pixels] != 0;
+                        mismatches += color[i] != (cleared ? clear_color : render_target.color[pixel]);
+                        mismatches += depth[i] != (cleared ? clear_depth : render_target.depth[pixel]);
+                    }
+                }
+                if (!CHECK(mismatches == 0)) {
+                    printf("    %ux%u: %zu values differ\n", size[0], size[1], mismatches);
+                }
+            };
+            check_resolve(false, 0, 0.0f);
+
+            // Garbage stays in memory, the blocks only have their clear flags set
+            const float clear[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+            render_target.clear_color(clear);
+            render_target.clear_depth(0.25f);
+            CHECK(render_target.clear_color_value == 0xFF0000FF);
+            CHECK(render_target.color[1] == 2654435761u);
+            check_resolve(true, 0xFF0000FF, 0.25f);
+
+            // Every third block drawn to
+            for (uint32_t block = 0; block < render_target.cleared_blocks.size(); block += 3) {
+                render_target.prepare_block(block);
+                CHECK(render_target.color[block * raster_block_pixels] == 0xFF0000FF);
+                for (uint32_t pixel = 0; pixel < raster_block_pixels; pixel += 2) {
+                    render_target.color[block * raster_block_pixels + pixel] = (pixel + block) * 2654435761u;
+                    render_target.depth[block * raster_block_pixels + pixel] = 1.0f / (pixel + 1);
+                }
+            }
+            check_resolve(true, 0xFF0000FF, 0.25f);
+        }
+    }
+
+    /* TOP-LEFT FILL RULE
+    * A square with its edges exactly on pixel centers, split into two triangles along either diagonal and with every
+    * vertex order. Pixel centers on the left and top edges are covered, the ones on the right and bottom edges aren't,
+    * and the pixels on the diagonal belong to exactly one of the triangles.
+    */
+    void test_top_left_fill_rule() {
+        constexpr uint32_t size = 16;
+        // Pixel centers 2.5 and 6.5, in clip space
+        const float low = 2.5f / (size / 2) - 1.0f;
+        const float high = 6.5f / (size / 2) - 1.0f;
+        const float corners[4][4] = { { low, high, 0, 1 }, { high, high, 0, 1 }, { low, low, 0, 1 }, { high, low, 0, 1 } };
+        const uint32_t splits[2][2][3] = { { { 0, 1, 2 }, { 1, 3, 2 } }, { { 0, 1, 3 }, { 0, 3, 2 } } };
+
+        SoftwareRenderTarget render_target;
+        render_target.resize(size, size);
+        for (const auto& split : splits) {
+            for (uint32_t rotation = 0; rotation < 3; ++rotation) {
+                for (const bool flip : { false, true }) {
+                    RasterScene scene;
+                    for (uint32_t triangle = 0; triangle < 2; ++triangle) {
+                        uint32_t order[3];
+                        for (uint32_t i = 0; i < 3; ++i) {
+                            order[i] = split[triangle][(i + rotation) % 3];
+                        }
+                        if (flip) {
+                            std::swap(order[1], order[2]);
+                        }
+                        scene.add_triangle(corners[order[0]], corners[order[1]], corners[order[2]], triangle + 1);
+                    }
+                    RasterStats stats;
+                    scene.draw(render_target, 1, 0, 2, &stats);
+                    const std::vector<uint32_t> pixels = resolve_color(render_target);
+                    bool inside_covered = true;
+                    bool outside_empty = true;
+                    for (uint32_t y = 0; y < size; ++y) {
+                        for (uint32_t x = 0; x < size; ++x) {
+                            const bool inside = x >= 2 && x < 6 && y >= 9 && y < 13;
+                            inside_covered &= !inside || pixels[y * size + x] != 0;
+                            outside_empty &= inside || pixels[y * size + x] == 0;
+                        }
+                    }
+                    CHECK(inside_covered && outside_empty);
+                    CHECK(stats.pixel_shader_invocations == 16);
+                }
+            }
+        }
+    }
+
+    /* SHARED EDGES AND CRACKS
+    * A grid of randomly moved vertices that covers the whole viewport, with triangles of both windings. Every pixel
+    * has to be covered (no cracks between neighbors) and shaded exactly once (no pixel drawn by both triangles of a
+    * shared edge), and with MSAA every sample has to be written exactly once.
+    */
+    void test_shared_edges() {
+        constexpr uint32_t cells = 24;
+        uint32_t seed = 17;
+        float grid[cells + 1][cells + 1][4];
+        for (uint32_t y = 0; y <= cells; ++y) {
+            for (uint32_t x = 0; x <= cells; ++x) {
+                // The outer vertices stay on the border of the viewport
+                const float jitter = 0.4f / cells;
+                grid[y][x][0] = -1.0f + 2.0f * x / cells + (x > 0 && x < cells ? random_float(seed, -jitter, jitter) : 0.0f);
+                grid[y][x][1] = -1.0f + 2.0f * y / cells + (y > 0 && y < cells ? random_float(seed, -jitter, jitter) : 0.0f);
+                grid[y][x][2] = 0.5f;
+                grid[y][x][3] = 1.0f;
+            }
+        }
+        RasterScene scene;
+        uint32_t triangle_count = 0;
+        for (uint32_t y = 0; y < cells; ++y) {
+            for (uint32_t x = 0; x < cells; ++x) {
+                const float* a = grid[y][x];
+                const float* b = grid[y][x + 1];
+                const float* c = grid[y + 1][x];
+                const float* d = grid[y + 1][x + 1];
+                // Alternate the diagonal and the winding
+                if ((x + y) % 2 == 0) {
+                    scene.add_triangle(a, b, c, triangle_count++);
+                    scene.add_triangle(d, b, c, triangle_count++);
+                }
+                else {
+                    scene.add_triangle(a, d, b, triangle_count++);
+                    scene.add_triangle(a, c, d, triangle_count++);
+                }
+            }
+        }
+
+        for (const uint32_t sample_count : { 1u, 4u }) {
+            SoftwareRenderTarget render_target;
+            render_target.resize(157, 93, sample_count);
+            RasterStats stats;
+            scene.draw(render_target, 3, 0, triangle_count, &stats);
+            const size_t pixel_count = static_cast<size_t>(render_target.width) * render_target.height;
+            // With MSAA, a pixel on an edge is shaded for both triangles, but each of its samples is written once
+            CHECK(sample_count == 1 ? stats.pixel_shader_invocations == pixel_count : stats.pixel_shader_invocations > pixel_count);
+            CHECK(stats.samples_written == pixel_count * sample_count);
+            const std::vector<uint32_t> pixels = resolve_color(render_target);
+            CHECK(std::count(pixels.begin(), pixels.end(), 0u) == 0);
+        }
+    }
+
+    /* VARIABLE RATE SHADING
+    * One triangle over a whole 32x32 target, with red and green going up by 8 per pixel from the top left corner, so a
+    * pixel's color says where it was shaded. A coarse pixel is shaded once, at its center, and every pixel in it gets
+    * that color. The draw's rate is tested on its own, then 2x2 combined with a shading rate image that gives each of
+    * the 16 tiles a rate of its own, with every combiner. The invocation counts are worked out by hand: a fully
+    * covered tile takes 64 invocations at 1x1, 16 at 2x2 and 4 at 4x4.
+    */
+    void test_variable_rate_shading() {
+        constexpr uint32_t size = 32;
+        RasterScene scene;
+        // Screen corners (0, 0), (64, 0) and (0, 64), in clip space
+        const float positions[3][4] = { { -1, 1, 0, 1 }, { 3, 1, 0, 1 }, { -1, -3, 0, 1 } };
+        const float colors[3][3] = { { 0, 0, 0 }, { 512.0f / 255.0f, 0, 0 }, { 0, 512.0f / 255.0f, 0 } };
+        for (uint32_t i = 0; i < 3; ++i) {
+            test::RasterVertex vertex;
+            memcpy(vertex.position, positions[i], sizeof(vertex.position));
+            memcpy(vertex.color, colors[i], sizeof(vertex.color));
+            scene.indices.push_back(i);
+            scene.vertices.push_back(vertex);
+        }
+
+        // The color every pixel should have, with the rate of every tile
+        const auto expected_pixels = [&](const ShadingRate tile_rates[16]) {
+            std::vector<uint32_t> pixels(size * size);
+            for (uint32_t y = 0; y < size; ++y) {
+                for (uint32_t x = 0; x < size; ++x) {
+                    const uint32_t rate = static_cast<uint32_t>(tile_rates[(y / 8) * 4 + x / 8]);
+                    const uint32_t rate_width = 1u << (rate >> 2);
+                    const uint32_t rate_height = 1u << (rate & 3);
+                    const uint32_t red = (x / rate_width * rate_width) * 8 + rate_width * 4;
+                    const uint32_t green = (y / rate_height * rate_height) * 8 + rate_height * 4;
+                    pixels[y * size + x] = red | green << 8 | 0xFF000000u;
+                }
+            }
+            return pixels;
+        };
+
+        SoftwareRenderTarget render_target;
+        render_target.resize(size, size);
+        const auto check_draw = [&](const ShadingRate tile_rates[16], const uint64_t expected_invocations) {
+            RasterStats stats;
+            scene.draw(render_target, 1, 0, 1, &stats);
+            CHECK(stats.pixel_shader_invocations == expected_invocations);
+            CHECK(stats.pixels_written == size * size);
+            CHECK(resolve_color(render_target) == expected_pixels(tile_rates));
+        };
+
+        struct DrawRate {
+            ShadingRate rate;
+            uint64_t invocations;
+        };
+        const DrawRate draw_rates[] = { { ShadingRate::rate_1x1, 1024 }, { ShadingRate::rate_2x2, 256 }, { ShadingRate::rate_4x4, 64 } };
+        for (const DrawRate& draw_rate : draw_rates) {
+            scene.pipeline_state.shading_rate = draw_rate.rate;
+            ShadingRate tile_rates[16];
+            std::fill_n(tile_rates, 16, draw_rate.rate);
+            check_draw(tile_rates, draw_rate.invocations);
+        }
+
+        // The image goes through the rates in order: 1x1, 1x2, 2x1, 2x2, 2x4, 4x2, 4x4, 1x1, ...
+        const ShadingRate rates[7] = { ShadingRate::rate_1x1, ShadingRate::rate_1x2, ShadingRate::rate_2x1, ShadingRate::rate_2x2,
+                                       ShadingRate::rate_2x4, ShadingRate::rate_4x2, ShadingRate::rate_4x4 };
+        uint8_t image[16];
+        for (uint32_t tile = 0; tile < 16; ++tile) {
+            image[tile] = static_cast<uint8_t>(rates[tile % 7]);
+        }
+        // What each image rate becomes with a draw rate of 2x2, in the same order
+        struct Combiner {
+            ShadingRateCombiner combiner;
+            ShadingRate combined[7];
+            uint64_t invocations;
+        };
+        const ShadingRate r1x1 = ShadingRate::rate_1x1, r1x2 = ShadingRate::rate_1x2, r2x1 = ShadingRate::rate_2x1, r2x2 = ShadingRate::rate_2x2,
+                          r2x4 = ShadingRate::rate_2x4, r4x2 = ShadingRate::rate_4x2, r4x4 = ShadingRate::rate_4x4;
+        const Combiner combiners[] = {
+            { ShadingRateCombiner::passthrough, { r2x2, r2x2, r2x2, r2x2, r2x2, r2x2, r2x2 }, 256 },
+            { ShadingRateCombiner::override, { r1x1, r1x2, r2x1, r2x2, r2x4, r4x2, r4x4 }, 424 },
+            { ShadingRateCombiner::min, { r1x1, r1x2, r2x1, r2x2, r2x2, r2x2, r2x2 }, 480 },
+            { ShadingRateCombiner::max, { r2x2, r2x2, r2x2, r2x2, r2x4, r4x2, r4x4 }, 200 },
+            { ShadingRateCombiner::sum, { r2x2, r2x4, r4x2, r4x4, r4x4, r4x4, r4x4 }, 120 },
+        };
+        scene.pipeline_state.shading_rate = ShadingRate::rate_2x2;
+        for (const Combiner& combiner : combiners) {
+            scene.pipeline_state.shading_rate_combiner = combiner.combiner;
+            ShadingRate tile_rates[16];
+            for (uint32_t tile = 0; tile < 16; ++tile) {
+                tile_rates[tile] = combiner.combined[tile % 7];
+            }
+            SoftwareRasterizer rasterizer;
+            scene.bind(rasterizer, render_target, 1);
+            rasterizer.set_shading_rate_image(image, 4, 4);
+            const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            render_target.clear_color(clear);
+            rasterizer.draw_indexed(3, 0, 0);
+            CHECK(rasterizer.stats.pixel_shader_invocations == combiner.invocations);
+            CHECK(rasterizer.stats.pixels_written == size * size);
+            if (!CHECK(resolve_color(render_target) == expected_pixels(tile_rates))) {
+                printf("    Combiner %u\n", static_cast<uint32_t>(combiner.combiner));
+            }
+        }
+    }
+
+    /* PIXEL SHADER DERIVATIVES
+    * A pixel shader that writes ddx(SV_Position.x) and ddy(SV_Position.y), which are the width and height of a
+    * pixel at the shading rate if the lanes are 2x2 quads, whatever the triangle covers of them. Over a triangle
+    * with ragged edges, so many quads have helper lanes, which must not be written.
+    */
+    void test_pixel_shader_derivatives() {
+        const std::vector<uint8_t> bytecode = test::make_dxbc(
+            { { "SV_Position", 0, 1, 0, 0xF } },
+            { { "SV_Target", 0, 64, 0, 0xF } },
+            {
+                0x00000050,                                                         // ps_5_0
+                0x0100086a,                                                         // dcl_global_flags refactoringAllowed
+                0x04002064, 0x00101032, 0, 1,                                       // dcl_input_ps_siv linear noperspective v0.xy, position
+                0x03000065, 0x001020f2, 0,                                          // dcl_output o0.xyzw
+                0x02000068, 1,                                                      // dcl_temps 1
+                0x0500007a, 0x00100012, 0, 0x0010100a, 0,                           // deriv_rtx_coarse r0.x, v0.x
+                0x0500007d, 0x00100022, 0, 0x0010101a, 0,                           // deriv_rty_fine r0.y, v0.y
+                0x0a000038, 0x00102032, 0, 0x00100046, 0, 0x00004002, 0x3e4ccccd, 0x3e4ccccd, 0, 0, // mul o0.xy, r0.xyxx, l(0.2, 0.2, 0, 0)
+                0x08000036, 0x001020c2, 0, 0x00004002, 0, 0, 0, 0x3f800000,         // mov o0.zw, l(0, 0, 0, 1.0)
+                0x0100003e,                                                         // ret
+            });
+        ShaderProgram derivative_shader;
+        if (!CHECK(load_shader_program(bytecode.data(), bytecode.size(), derivative_shader)) || !CHECK(derivative_shader.uses_derivatives)) {
+            return;
+        }
+
+        RasterScene scene;
+        const float corners[3][4] = { { -0.93f, 0.87f, 0, 1 }, { 0.81f, 0.42f, 0, 1 }, { -0.27f, -0.95f, 0, 1 } };
+        scene.add_triangle(corners[0], corners[1], corners[2], 0);
+        SoftwareRenderTarget render_target;
+        render_target.resize(45, 37);
+
+        // Which pixels the triangle covers, with the flat color shader
+        RasterStats stats;
+        scene.draw(render_target, 1, 0, 1, &stats);
+        const std::vector<uint32_t> covered = resolve_color(render_target);
+        const uint64_t covered_count = stats.pixels_written;
+
+        scene.pipeline_state.pixel_shader = &derivative_shader;
+        const ShadingRate rates[] = { ShadingRate::rate_1x1, ShadingRate::rate_1x2, ShadingRate::rate_2x1, ShadingRate::rate_2x2,
+                                      ShadingRate::rate_2x4, ShadingRate::rate_4x4 };
+        for (const ShadingRate rate : rates) {
+            scene.pipeline_state.shading_rate = rate;
+            scene.draw(render_target, 1, 0, 1, &stats);
+            const uint32_t rate_width = 1u << (static_cast<uint32_t>(rate) >> 2);
+            const uint32_t rate_height = 1u << (static_cast<uint32_t>(rate) & 3);
+            const uint32_t expected = 51 * rate_width | (51 * rate_height) << 8 | 0xFF000000u;
+            const std::vector<uint32_t> pixels = resolve_color(render_target);
+            size_t wrong = 0;
+            for (size_t i = 0; i < pixels.size(); ++i) {
+                wrong += pixels[i] != (covered[i] != 0 ? expected : 0u);
+            }
+            CHECK(stats.pixels_written == covered_count);
+            if (!CHECK(wrong == 0)) {
+                printf("    Rate %ux%u: %zu pixels are wrong\n", rate_width, rate_height, wrong);
+            }
+            if (rate == ShadingRate::rate_1x1) {
+                CHECK(stats.pixel_shader_invocations == covered_count);
+            }
+        }
+    }
+
+    /* HIERARCHICAL Z
+    * A full screen occluder, then a triangle over half the screen behind it: every block the triangle touches has
+    * to be rejected by its depth range alone, without running the pixel shader, and the image can't change. The same
+    * triangle in front of the occluder has to skip the per-pixel depth test in every block instead, and shade exactly
+    * the pixels it changes.
+    */
+    void test_hierarchical_z() {
+        RasterScene scene;
+        scene.add_fullscreen_quad(0.5f, 0);
+        const float corners[3][4] = { { -1, -1, 0, 1 }, { 1, -1, 0, 1 }, { -1, 1, 0, 1 } };
+        for (const float z : { 0.3f, 0.9f }) {
+            float triangle[3][4];
+            memcpy(triangle, corners, sizeof(triangle));
+            triangle[0][2] = triangle[1][2] = triangle[2][2] = z;
+            scene.add_triangle(triangle[0], triangle[1], triangle[2], 1);
+        }
+        scene.pipeline_state.depth_enable = true;
+
+        SoftwareRenderTarget render_target;
+        render_target.resize(64, 64);
+        RasterStats stats;
+        scene.draw(render_target, 1, 0, 2, &stats);
+        const std::vector<uint32_t> occluder = resolve_color(render_target);
+        CHECK(stats.pixel_shader_invocations == 64 * 64);
+
+        // Behind
+        scene.draw(render_target, 1, 2, 1, &stats, false);
+        CHECK(stats.blocks_visited > 0);
+        CHECK(stats.blocks_rejected_hiz == stats.blocks_visited);
+        CHECK(stats.pixel_shader_invocations == 0 && stats.pixels_written == 0);
+        CHECK(resolve_color(render_target) == occluder);
+
+        // In front
+        scene.draw(render_target, 1, 3, 1, &stats, false);
+        const std::vector<uint32_t> pixels = resolve_color(render_target);
+        uint64_t changed = 0;
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            if (pixels[i] != occluder[i]) {
+                CHECK(pixels[i] == test::raster_triangle_color(1));
+                ++changed;
+            }
+        }
+        CHECK(changed > 64 * 64 / 2 - 64 && changed < 64 * 64 / 2 + 64);
+        CHECK(stats.blocks_rejected_hiz == 0);
+        CHECK(stats.blocks_accepted_hiz == stats.blocks_visited);
+        CHECK(stats.pixel_shader_invocations == changed && stats.pixels_written == changed);
+    }
+
+    /* MSAA GOLDEN IMAGES
+    * The resolved images of the MSAA scene at 1x, 4x and 8x have to match the ones in Golden/, give or take one step
+    * per channel for differences in float rounding between compilers. Alpha isn't stored. After an intended change to
+    * the output, run the test with --update-golden to write new ones, and look at them before committing them.
+    *
+    * Independent of the golden images, more samples have to get closer to a 16x16 supersampled render, and the
+    * compressed sample colors have to take less memory than storing every sample.
+    */
+    bool update_golden_images = false;
+
+    void write_ppm(const std::string& path, const std::vector<uint32_t>& pixels, const uint32_t width, const uint32_t height) {
+        std::string file = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        for (const uint32_t pixel : pixels) {
+            file.push_back(static_cast<char>(pixel & 0xff));
+            file.push_back(static_cast<char>((pixel >> 8) & 0xff));
+            file.push_back(static_cast<char>((pixel >> 16) & 0xff));
+        }
+        CHECK(write_file(path, file.data(), file.size(), false));
+    }
+
+    // Only reads what write_ppm() writes
+    bool read_ppm(const std::string& path, const uint32_t width, const uint32_t height, std::vector<uint32_t>& pixels) {
+        size_t size = 0;
+        char* data = nullptr;
+        read_file(path, size, data, false);
+        const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        const size_t pixel_count = static_cast<size_t>(width) * height;
+        const bool valid = size == header.size() + pixel_count * 3 && memcmp(data, header.data(), header.size()) == 0;
+        if (valid) {
+            const uint8_t* rgb = reinterpret_cast<const uint8_t*>(data) + header.size();
+            pixels.resize(pixel_count);
+            for (size_t i = 0; i < pixel_count; ++i) {
+                pixels[i] = rgb[i * 3] | (rgb[i * 3 + 1] << 8) | (rgb[i * 3 + 2] << 16);
+            }
+        }
+        free(data);
+        return valid;
+    }
+
+    void test_msaa_golden_images() {
+        constexpr uint32_t width = 160;
+        constexpr uint32_t height = 96;
+        RasterScene scene;
+        add_msaa_scene(scene);
+
+        // What the pixels should converge to
+        constexpr uint32_t supersampling = 16;
+        SoftwareRenderTarget reference_target;
+        reference_target.resize(width * supersampling, height * supersampling);
+        scene.draw(reference_target, 4, 0, 300);
+        const std::vector<uint32_t> reference_pixels = resolve_color(reference_target);
+        std::vector<double> reference(static_cast<size_t>(width) * height * 3, 0.0);
+        for (uint32_t y = 0; y < height * supersampling; ++y) {
+            for (uint32_t x = 0; x < width * supersampling; ++x) {
+                const uint32_t pixel = reference_pixels[static_cast<size_t>(y) * width * supersampling + x];
+                for (uint32_t channel = 0; channel < 3; ++channel) {
+                    reference[((y / supersampling) * width + x / supersampling) * 3 + channel] +=
+                        ((pixel >> (channel * 8)) & 0xff) / double(supersampling * supersampling);
+                }
+            }
+        }
+
+        double previous_error = 1e30;
+        for (const uint32_t sample_count : { 1u, 4u, 8u }) {
+            SoftwareRenderTarget render_target;
+            render_target.resize(width, height, sample_count);
+            scene.draw(render_target, 4, 0, 300);
+            const std::vector<uint32_t> pixels = resolve_color(render_target);
+
+            double squared_error = 0.0;
+            for (size_t i = 0; i < pixels.size(); ++i) {
+                for (uint32_t channel = 0; channel < 3; ++channel) {
+                    const double difference = ((pixels[i] >> (channel * 8)) & 0xff) - reference[i * 3 + channel];
+                    squared_error += difference * difference;
+                }
+            }
+            const double error = std::sqrt(squared_error / (pixels.size() * 3));
+            CHECK(error < previous_error);
+            previous_error = error;
+
+            const size_t uncompressed_color = static_cast<size_t>(render_target.blocks_x) * render_target.blocks_y * raster_block_pixels * sample_count * sizeof(uint32_t);
+            const size_t depth_size = render_target.depth.size() * sizeof(float);
+            if (sample_count > 1) {
+                CHECK(render_target.memory_size() < uncompressed_color + depth_size);
+            }
+
+            const std::string path = TEST_DATA_DIR "/Golden/software_rasterizer_msaa_" + std::to_string(sample_count) + "x.ppm";
+            if (update_golden_images) {
+                write_ppm(path, pixels, width, height);
+                continue;
+            }
+            std::vector<uint32_t> golden;
+            if (!CHECK(read_ppm(path, width, height, golden))) {
+                continue;
+            }
+            size_t mismatches = 0;
+            for (size_t i = 0; i < pixels.size(); ++i) {
+                for (uint32_t channel = 0; channel < 3; ++channel) {
+                    const int difference = static_cast<int>((pixels[i] >> (channel * 8)) & 0xff) - static_cast<int>((golden[i] >> (channel * 8)) & 0xff);
+                    mismatches += difference > 1 || difference < -1;
+                }
+            }
+            if (!CHECK(mismatches == 0)) {
+                printf("    %ux MSAA: %zu channels differ from %s\n", sample_count, mismatches, path.c_str());
+            }
+        }
+    }
+}
+
+int main(const int argc, char** argv) {
+    update_golden_images = argc > 1 && strcmp(argv[1], "--update-golden") == 0;
+    test_clipped_triangle_order();
+    test_merge_tile_bins();
+    test_thread_count_determinism();
+    test_msaa_samples();
+    test_shared_vertex_grid();
+    test_tiled_resolve();
+    test_top_left_fill_rule();
+    test_shared_edges();
+    test_variable_rate_shading();
+    test_pixel_shader_derivatives();
+    test_hierarchical_z();
+    test_msaa_golden_images();
+    return test::test_result();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdio>
+
+/* TEST HELPERS
+* Every test is its own executable, which CTest runs. A failed CHECK prints where it failed and the test keeps going,
+* so one run shows every failure, and test_result() at the end of main() turns that into the exit code.
+*/
+
+namespace test {
+    inline int& failure_count() {
+        static int count = 0;
+        return count;
+    }
+
+    inline bool check(const bool condition, const char* expression, const char* file, const int line) {
+        if (!condition) {
+            printf("[FAIL] %s:%i: %s\n", file, line, expression);
+            failure_count()++;
+        }
+        return condition;
+    }
+
+    inline int test_result() {
+        if (failure_count() != 0) {
+            printf("%i checks failed\n", failure_count());
+            return 1;
+        }
+        return 0;
+    }
+}
+
+// Returns whether it passed, so a test can stop before it reads out of bounds
+#define CHECK(condition) test::check((condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,1139 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Only stbi_zlib_compress() is used, static so every executable that includes this gets its own copy
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+
+/* TEST IMAGES
+* Encoders for every format stb_image reads, for the fuzz corpus and the decode benchmarks. stb_image_write only
+* writes the common cases, these also write the ones that take other paths through the decoders: PNGs of every color
+* type and bit depth, interlaced or not, with every row filter; baseline JPEGs with restart markers, progressive JPEGs
+* with successive approximation; PSDs with RLE and 16-bit channels; PIC files with each packet compression; paletted
+* and RLE TGAs and BMPs of every bit depth; flat and RLE HDRs; interlaced and animated GIFs.
+* Samples are made up by make_test_image(): smooth gradients with some noise, so they compress like photos and
+* textures do, not like noise or flat color.
+*/
+
+namespace test {
+    // Samples of `bits` bits each (1 to 16), `channels` per pixel, rows top to bottom
+    struct TestImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t channels = 0;
+        uint32_t bits = 8;
+        std::vector<uint16_t> samples;
+
+        uint16_t sample(const uint32_t x, const uint32_t y, const uint32_t channel) const { return samples[(static_cast<size_t>(y) * width + x) * channels + channel]; }
+    };
+
+    inline uint32_t hash_u32(uint32_t value) {
+        value ^= value >> 16;
+        value *= 0x7feb352du;
+        value ^= value >> 15;
+        value *= 0x846ca68bu;
+        value ^= value >> 16;
+        return value;
+    }
+
+    inline TestImage make_test_image(const uint32_t width, const uint32_t height, const uint32_t channels, const uint32_t bits, const uint32_t seed = 0) {
+        TestImage image;
+        image.width = width;
+        image.height = height;
+        image.channels = channels;
+        image.bits = bits;
+        image.samples.resize(static_cast<size_t>(width) * height * channels);
+        const uint32_t max_value = (1u << bits) - 1;
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                for (uint32_t c = 0; c < channels; ++c) {
+                    const float u = static_cast<float>(x) / static_cast<float>(std::max(width, 2u) - 1);
+                    const float v = static_cast<float>(y) / static_cast<float>(std::max(height, 2u) - 1);
+                    const float wave = 0.5f + 0.5f * sinf((u * 3.0f + v * 2.0f + static_cast<float>(c)) * 3.14159265f);
+                    const float gradient = c % 2 == 0 ? u * 0.6f + v * 0.4f : 1.0f - u * 0.5f - v * 0.3f;
+                    const float noise = static_cast<float>(hash_u32((y * width + x) * 4 + c + seed * 0x9e3779b9u) & 0xFFFF) / 65535.0f - 0.5f;
+                    const float value = std::min(1.0f, std::max(0.0f, 0.45f * gradient + 0.45f * wave + 0.1f * noise + 0.05f));
+                    image.samples[(static_cast<size_t>(y) * width + x) * channels + c] = static_cast<uint16_t>(lroundf(value * static_cast<float>(max_value)));
+                }
+            }
+        }
+        return image;
+    }
+
+    // A palette of 2^bits RGBA colors, for the paletted formats
+    inline std::vector<uint8_t> make_test_palette(const uint32_t bits) {
+        const uint32_t count = 1u << bits;
+        std::vector<uint8_t> palette(count * 4);
+        for (uint32_t i = 0; i < count; ++i) {
+            palette[i * 4 + 0] = static_cast<uint8_t>(i * 255 / std::max(count - 1, 1u));
+            palette[i * 4 + 1] = static_cast<uint8_t>(hash_u32(i) & 0xFF);
+            palette[i * 4 + 2] = static_cast<uint8_t>(255 - i * 255 / std::max(count - 1, 1u));
+            palette[i * 4 + 3] = static_cast<uint8_t>(i % 3 == 0 ? 255 : i * 37);
+        }
+        return palette;
+    }
+
+    inline void put_u16_be(std::vector<uint8_t>& out, const uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    inline void put_u32_be(std::vector<uint8_t>& out, const uint32_t value) {
+        put_u16_be(out, value >> 16);
+        put_u16_be(out, value & 0xFFFF);
+    }
+
+    inline void put_u16_le(std::vector<uint8_t>& out, const uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    inline void put_u32_le(std::vector<uint8_t>& out, const uint32_t value) {
+        put_u16_le(out, value & 0xFFFF);
+        put_u16_le(out, value >> 16);
+    }
+
+    inline void put_bytes(std::vector<uint8_t>& out, const void* data, const size_t size) {
+        out.insert(out.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    }
+
+    // An 8-bit sample, from any bit depth
+    inline uint8_t sample_8(const TestImage& image, const uint32_t x, const uint32_t y, const uint32_t channel) {
+        const uint32_t max_value = (1u << image.bits) - 1;
+        return static_cast<uint8_t>((image.sample(x, y, channel) * 255u + max_value / 2) / max_value);
+    }
+
+    // PackBits, the RLE of PSD and TIFF: n < 128 is n + 1 literal bytes, n > 128 is 257 - n copies of the next byte
+    inline void pack_bits(const uint8_t* data, const size_t size, std::vector<uint8_t>& out) {
+        size_t i = 0;
+        while (i < size) {
+            size_t run = 1;
+            while (i + run < size && run < 128 && data[i + run] == data[i]) {
+                ++run;
+            }
+            if (run >= 3) {
+                out.push_back(static_cast<uint8_t>(257 - run));
+                out.push_back(data[i]);
+                i += run;
+                continue;
+            }
+            size_t literal = 0;
+            while (i + literal < size && literal < 128 && !(i + literal + 2 < size && data[i + literal] == data[i + literal + 1] &&
+                                                           data[i + literal] == data[i + literal + 2])) {
+                ++literal;
+            }
+            out.push_back(static_cast<uint8_t>(literal - 1));
+            put_bytes(out, data + i, literal);
+            i += literal;
+        }
+    }
+
+    /* PNG
+    * The color type follows the channel count (gray, gray + alpha, RGB, RGBA), or is paletted, where the image is the
+    * indices. Row y of every pass uses filter y % 5, so all five filters are decoded.
+    */
+    struct PngOptions {
+        bool interlaced = false;
+        bool paletted = false;
+        bool transparency = false;      // A tRNS chunk: palette alphas, or a color key for gray and RGB
+        size_t idat_size = 0;           // Split the data over IDAT chunks of this size, 0 for one chunk
+        bool text_chunk = false;        // An ancillary chunk the decoder has to skip
+    };
+
+    inline uint32_t png_crc(const uint8_t* data, const size_t size, uint32_t crc = 0xFFFFFFFFu) {
+        for (size_t i = 0; i < size; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            }
+        }
+        return crc;
+    }
+
+    inline void put_png_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+        put_u32_be(out, static_cast<uint32_t>(data.size()));
+        const size_t type_offset = out.size();
+        put_bytes(out, type, 4);
+        put_bytes(out, data.data(), data.size());
+        put_u32_be(out, png_crc(out.data() + type_offset, out.size() - type_offset) ^ 0xFFFFFFFFu);
+    }
+
+    inline uint8_t paeth(const int a, const int b, const int c) {
+        const int p = a + b - c;
+        const int pa = abs(p - a);
+        const int pb = abs(p - b);
+        const int pc = abs(p - c);
+        return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+    }
+
+    inline std::vector<uint8_t> encode_png(const TestImage& image, const PngOptions& options = {}) {
+        const uint8_t color_type = options.paletted ? 3 : (image.channels == 1 ? 0 : image.channels == 2 ? 4 : image.channels == 3 ? 2 : 6);
+        const uint32_t bits_per_pixel = image.channels * image.bits;
+        const size_t filter_bpp = std::max(1u, bits_per_pixel / 8);
+
+        // Pass i covers the pixels at (x0 + dx * n, y0 + dy * m), one pass of the whole image without interlacing
+        static const uint32_t adam7[7][4] = { { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+        static const uint32_t single_pass[1][4] = { { 0, 0, 1, 1 } };
+        const uint32_t(*passes)[4] = options.interlaced ? adam7 : single_pass;
+        const int pass_count = options.interlaced ? 7 : 1;
+
+        std::vector<uint8_t> filtered;
+        for (int pass = 0; pass < pass_count; ++pass) {
+            const uint32_t x0 = passes[pass][0];
+            const uint32_t y0 = passes[pass][1];
+            const uint32_t dx = passes[pass][2];
+            const uint32_t dy = passes[pass][3];
+            const uint32_t pass_width = image.width > x0 ? (image.width - x0 + dx - 1) / dx : 0;
+            const uint32_t pass_height = image.height > y0 ? (image.height - y0 + dy - 1) / dy : 0;
+            if (pass_width == 0 || pass_height == 0) {
+                continue;
+            }
+            const size_t row_size = (static_cast<size_t>(pass_width) * bits_per_pixel + 7) / 8;
+            std::vector<uint8_t> previous(row_size, 0);
+            std::vector<uint8_t> row(row_size);
+            for (uint32_t py = 0; py < pass_height; ++py) {
+                std::fill(row.begin(), row.end(), 0);
+                size_t bit = 0;
+                for (uint32_t px = 0; px < pass_width; ++px) {
+                    for (uint32_t c = 0; c < image.channels; ++c) {
+                        const uint32_t value = image.sample(x0 + px * dx, y0 + py * dy, c);
+                        if (image.bits == 16) {
+                            row[bit / 8] = static_cast<uint8_t>(value >> 8);
+                            row[bit / 8 + 1] = static_cast<uint8_t>(value);
+                        }
+                        else {
+                            row[bit / 8] |= static_cast<uint8_t>(value << (8 - image.bits - bit % 8));
+                        }
+                        bit += image.bits;
+                    }
+                }
+                const uint8_t filter = static_cast<uint8_t>(py % 5);
+                filtered.push_back(filter);
+                for (size_t i = 0; i < row_size; ++i) {
+                    const int a = i >= filter_bpp ? row[i - filter_bpp] : 0;
+                    const int b = previous[i];
+                    const int c = i >= filter_bpp ? previous[i - filter_bpp] : 0;
+                    const int predictor = filter == 0 ? 0 : filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : paeth(a, b, c);
+                    filtered.push_back(static_cast<uint8_t>(row[i] - predictor));
+                }
+                previous = row;
+            }
+        }
+
+        std::vector<uint8_t> out;
+        put_bytes(out, "\x89PNG\r\n\x1a\n", 8);
+        std::vector<uint8_t> header;
+        put_u32_be(header, image.width);
+        put_u32_be(header, image.height);
+        header.push_back(static_cast<uint8_t>(image.bits));
+        header.push_back(color_type);
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(options.interlaced ? 1 : 0);
+        put_png_chunk(out, "IHDR", header);
+        if (options.text_chunk) {
+            const char text[] = "Comment\0made by test_images.h";
+            put_png_chunk(out, "tEXt", std::vector<uint8_t>(text, text + sizeof(text) - 1));
+        }
+        if (options.paletted) {
+            const std::vector<uint8_t> palette = make_test_palette(image.bits);
+            std::vector<uint8_t> colors;
+            std::vector<uint8_t> alphas;
+            for (size_t i = 0; i < palette.size(); i += 4) {
+                put_bytes(colors, &palette[i], 3);
+                alphas.push_back(palette[i + 3]);
+            }
+            put_png_chunk(out, "PLTE", colors);
+            if (options.transparency) {
+                put_png_chunk(out, "tRNS", alphas);
+            }
+        }
+        else if (options.transparency && (image.channels == 1 || image.channels == 3)) {
+            std::vector<uint8_t> key;
+            for (uint32_t c = 0; c < image.channels; ++c) {
+                put_u16_be(key, image.sample(0, 0, c));
+            }
+            put_png_chunk(out, "tRNS", key);
+        }
+
+        int compressed_size = 0;
+        unsigned char* compressed = stbi_zlib_compress(filtered.data(), static_cast<int>(filtered.size()), &compressed_size, 8);
+        const size_t chunk_size = options.idat_size ? options.idat_size : static_cast<size_t>(compressed_size);
+        for (size_t offset = 0; offset < static_cast<size_t>(compressed_size); offset += chunk_size) {
+            const size_t size = std::min(chunk_size, static_cast<size_t>(compressed_size) - offset);
+            put_png_chunk(out, "IDAT", std::vector<uint8_t>(compressed + offset, compressed + offset + size));
+        }
+        STBIW_FREE(compressed);
+        put_png_chunk(out, "IEND", {});
+        return out;
+    }
+
+    /* JPEG
+    * 8-bit gray or YCbCr, with the Annex K quantization and Huffman tables. Progressive files have a DC scan at half
+    * precision, a DC refinement scan, then two AC spectral bands per component, so both successive approximation and
+    * spectral selection are decoded. A restart interval puts RST markers between every `restart_interval` MCUs.
+    */
+    struct JpegOptions {
+        int quality = 85;
+        bool subsampled = true;         // 4:2:0 chroma
+        bool progressive = false;
+        uint32_t restart_interval = 0;  // In MCUs, 0 for none
+    };
+
+    struct JpegHuffman {
+        uint16_t codes[256] = {};
+        uint8_t lengths[256] = {};
+    };
+
+    inline JpegHuffman make_jpeg_huffman(const uint8_t counts[16], const uint8_t* values) {
+        JpegHuffman table;
+        uint16_t code = 0;
+        size_t k = 0;
+        for (uint8_t length = 1; length <= 16; ++length) {
+            for (uint8_t i = 0; i < counts[length - 1]; ++i) {
+                table.codes[values[k]] = code++;
+                table.lengths[values[k]] = length;
+                ++k;
+            }
+            code = static_cast<uint16_t>(code << 1);
+        }
+        return table;
+    }
+
+    class JpegBitWriter {
+    public:
+        explicit JpegBitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        void put(const uint32_t value, const uint32_t count) {
+            for (int i = static_cast<int>(count) - 1; i >= 0; --i) {
+                accumulator = (accumulator << 1) | ((value >> i) & 1);
+                if (++bit_count == 8) {
+                    flush_byte();
+                }
+            }
+        }
+
+        // Pads the last byte with ones, before a marker or the end of the scan
+        void flush() {
+            while (bit_count != 0) {
+                put(1, 1);
+            }
+        }
+
+    private:
+        void flush_byte() {
+            out.push_back(static_cast<uint8_t>(accumulator));
+            if (static_cast<uint8_t>(accumulator) == 0xFF) {
+                out.push_back(0x00);
+            }
+            accumulator = 0;
+            bit_count = 0;
+        }
+
+        std::vector<uint8_t>& out;
+        uint32_t accumulator = 0;
+        uint32_t bit_count = 0;
+    };
+
+    // The magnitude category of a coefficient, and its bits as JPEG stores them
+    inline uint32_t jpeg_category(const int value) {
+        uint32_t magnitude = static_cast<uint32_t>(abs(value));
+        uint32_t category = 0;
+        while (magnitude) {
+            ++category;
+            magnitude >>= 1;
+        }
+        return category;
+    }
+
+    inline uint32_t jpeg_value_bits(const int value, const uint32_t category) {
+        return static_cast<uint32_t>(value < 0 ? value + (1 << category) - 1 : value) & ((1u << category) - 1);
+    }
+
+    inline std::vector<uint8_t> encode_jpeg(const TestImage& image, const JpegOptions& options = {}) {
+        static const uint8_t zigzag[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,
+                                            7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31,
+                                            39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+        static const uint8_t luma_quantization[64] = { 16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57,
+                                                       69, 56, 14, 17, 22, 29, 51, 87, 80, 62, 18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64,
+                                                       81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99 };
+        static const uint8_t chroma_quantization[64] = { 17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+                                                         99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+                                                         99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99 };
+        static const uint8_t dc_luma_counts[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+        static const uint8_t dc_chroma_counts[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+        static const uint8_t dc_values[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+        static const uint8_t ac_luma_counts[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+        static const uint8_t ac_luma_values[162] = {
+            0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91,
+            0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a,
+            0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53,
+            0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+            0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+            0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+            0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2,
+            0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+        };
+        static const uint8_t ac_chroma_counts[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+        static const uint8_t ac_chroma_values[162] = {
+            0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14,
+            0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17,
+            0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a,
+            0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+            0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+            0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+            0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2,
+            0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+        };
+        const JpegHuffman dc_tables[2] = { make_jpeg_huffman(dc_luma_counts, dc_values), make_jpeg_huffman(dc_chroma_counts, dc_values) };
+        const JpegHuffman ac_tables[2] = { make_jpeg_huffman(ac_luma_counts, ac_luma_values), make_jpeg_huffman(ac_chroma_counts, ac_chroma_values) };
+
+        // Quantization tables, natural order
+        const int scale = options.quality < 50 ? 5000 / options.quality : 200 - options.quality * 2;
+        uint8_t quantization[2][64];
+        for (int i = 0; i < 64; ++i) {
+            quantization[0][i] = static_cast<uint8_t>(std::min(255, std::max(1, (luma_quantization[i] * scale + 50) / 100)));
+            quantization[1][i] = static_cast<uint8_t>(std::min(255, std::max(1, (chroma_quantization[i] * scale + 50) / 100)));
+        }
+
+        // Components, with their sampling factors and the size of their block grid, padded to whole MCUs
+        const uint32_t component_count = image.channels >= 3 ? 3 : 1;
+        const uint32_t max_factor = component_count == 3 && options.subsampled ? 2 : 1;
+        const uint32_t mcu_size = 8 * max_factor;
+        const uint32_t mcus_x = (image.width + mcu_size - 1) / mcu_size;
+        const uint32_t mcus_y = (image.height + mcu_size - 1) / mcu_size;
+        struct Component {
+            uint32_t factor;
+            uint32_t table;
+            uint32_t blocks_x;          // Of the padded grid
+            uint32_t blocks_y;
+            uint32_t used_blocks_x;     // Of the image, which is what a non-interleaved scan covers
+            uint32_t used_blocks_y;
+            std::vector<int> coefficients;  // 64 per block, zigzag order, quantized
+        };
+        Component components[3];
+        for (uint32_t c = 0; c < component_count; ++c) {
+            Component& component = components[c];
+            component.factor = c == 0 ? max_factor : 1;
+            component.table = c == 0 ? 0 : 1;
+            component.blocks_x = mcus_x * component.factor;
+            component.blocks_y = mcus_y * component.factor;
+            component.used_blocks_x = ((image.width * component.factor + max_factor - 1) / max_factor + 7) / 8;
+            component.used_blocks_y = ((image.height * component.factor + max_factor - 1) / max_factor + 7) / 8;
+            component.coefficients.resize(static_cast<size_t>(component.blocks_x) * component.blocks_y * 64);
+        }
+
+        // Color conversion, edges repeated, then a DCT and quantization of every block
+        const auto pixel = [&](const uint32_t c, uint32_t x, uint32_t y) {
+            x = std::min(x, image.width - 1);
+            y = std::min(y, image.height - 1);
+            if (component_count == 1) {
+                return static_cast<float>(sample_8(image, x, y, 0));
+            }
+            const float r = sample_8(image, x, y, 0);
+            const float g = sample_8(image, x, y, 1);
+            const float b = sample_8(image, x, y, 2);
+            return c == 0 ? 0.299f * r + 0.587f * g + 0.114f * b : c == 1 ? -0.168736f * r - 0.331264f * g + 0.5f * b + 128.0f
+                                                                           : 0.5f * r - 0.418688f * g - 0.081312f * b + 128.0f;
+        };
+        float cosines[8][8];
+        for (int x = 0; x < 8; ++x) {
+            for (int u = 0; u < 8; ++u) {
+                cosines[x][u] = cosf(static_cast<float>((2 * x + 1) * u) * 3.14159265f / 16.0f) * (u == 0 ? sqrtf(0.125f) : 0.5f);
+            }
+        }
+        for (uint32_t c = 0; c < component_count; ++c) {
+            Component& component = components[c];
+            const uint32_t step = max_factor / component.factor;
+            for (uint32_t block_y = 0; block_y < component.blocks_y; ++block_y) {
+                for (uint32_t block_x = 0; block_x < component.blocks_x; ++block_x) {
+                    float samples[8][8];
+                    for (uint32_t y = 0; y < 8; ++y) {
+                        for (uint32_t x = 0; x < 8; ++x) {
+                            float sum = 0.0f;
+                            for (uint32_t sy = 0; sy < step; ++sy) {
+                                for (uint32_t sx = 0; sx < step; ++sx) {
+                                    sum += pixel(c, ((block_x * 8 + x) * step) + sx, ((block_y * 8 + y) * step) + sy);
+                                }
+                            }
+                            samples[y][x] = sum / static_cast<float>(step * step) - 128.0f;
+                        }
+                    }
+                    float rows[8][8];
+                    for (int y = 0; y < 8; ++y) {
+                        for (int u = 0; u < 8; ++u) {
+                            float sum = 0.0f;
+                            for (int x = 0; x < 8; ++x) {
+                                sum += samples[y][x] * cosines[x][u];
+                            }
+                            rows[y][u] = sum;
+                        }
+                    }
+                    int* block = &component.coefficients[(static_cast<size_t>(block_y) * component.blocks_x + block_x) * 64];
+                    for (int k = 0; k < 64; ++k) {
+                        const int u = zigzag[k] % 8;
+                        const int v = zigzag[k] / 8;
+                        float sum = 0.0f;
+                        for (int y = 0; y < 8; ++y) {
+                            sum += rows[y][u] * cosines[y][v];
+                        }
+                        block[k] = static_cast<int>(lroundf(sum / static_cast<float>(quantization[component.table][zigzag[k]])));
+                    }
+                }
+            }
+        }
+
+        std::vector<uint8_t> out = { 0xFF, 0xD8 };
+        const auto begin_marker = [&](const uint8_t marker) {
+            out.push_back(0xFF);
+            out.push_back(marker);
+            const size_t length_offset = out.size();
+            out.resize(out.size() + 2);
+            return length_offset;
+        };
+        const auto end_marker = [&](const size_t length_offset) {
+            const size_t length = out.size() - length_offset;
+            out[length_offset] = static_cast<uint8_t>(length >> 8);
+            out[length_offset + 1] = static_cast<uint8_t>(length);
+        };
+
+        size_t marker = begin_marker(0xDB);
+        for (uint8_t table = 0; table < (component_count == 3 ? 2 : 1); ++table) {
+            out.push_back(table);
+            for (int k = 0; k < 64; ++k) {
+                out.push_back(quantization[table][zigzag[k]]);
+            }
+        }
+        end_marker(marker);
+
+        marker = begin_marker(options.progressive ? 0xC2 : 0xC0);
+        out.push_back(8);
+        put_u16_be(out, image.height);
+        put_u16_be(out, image.width);
+        out.push_back(static_cast<uint8_t>(component_count));
+        for (uint32_t c = 0; c < component_count; ++c) {
+            out.push_back(static_cast<uint8_t>(c + 1));
+            out.push_back(static_cast<uint8_t>(components[c].factor << 4 | components[c].factor));
+            out.push_back(static_cast<uint8_t>(components[c].table));
+        }
+        end_marker(marker);
+
+        marker = begin_marker(0xC4);
+        for (uint8_t table = 0; table < (component_count == 3 ? 2 : 1); ++table) {
+            const uint8_t* const counts[2][2] = { { dc_luma_counts, ac_luma_counts }, { dc_chroma_counts, ac_chroma_counts } };
+            const uint8_t* const values[2][2] = { { dc_values, ac_luma_values }, { dc_values, ac_chroma_values } };
+            for (uint8_t table_class = 0; table_class < 2; ++table_class) {
+                out.push_back(static_cast<uint8_t>(table_class << 4 | table));
+                put_bytes(out, counts[table][table_class], 16);
+                size_t value_count = 0;
+                for (int i = 0; i < 16; ++i) {
+                    value_count += counts[table][table_class][i];
+                }
+                put_bytes(out, values[table][table_class], value_count);
+            }
+        }
+        end_marker(marker);
+
+        if (options.restart_interval) {
+            marker = begin_marker(0xDD);
+            put_u16_be(out, options.restart_interval);
+            end_marker(marker);
+        }
+
+        // One scan. `first_component` and `scan_components` pick the components, more than one makes it interleaved.
+        const auto write_scan = [&](const uint32_t first_component, const uint32_t scan_components, const int start, const int end,
+                                    const int high, const int low) {
+            marker = begin_marker(0xDA);
+            out.push_back(static_cast<uint8_t>(scan_components));
+            for (uint32_t c = first_component; c < first_component + scan_components; ++c) {
+                out.push_back(static_cast<uint8_t>(c + 1));
+                out.push_back(static_cast<uint8_t>(components[c].table << 4 | components[c].table));
+            }
+            out.push_back(static_cast<uint8_t>(start));
+            out.push_back(static_cast<uint8_t>(end));
+            out.push_back(static_cast<uint8_t>(high << 4 | low));
+            end_marker(marker);
+
+            JpegBitWriter writer(out);
+            int predictions[3] = {};
+            const auto encode_block = [&](const uint32_t c, const int* block) {
+                const JpegHuffman& dc = dc_tables[components[c].table];
+                const JpegHuffman& ac = ac_tables[components[c].table];
+                if (start == 0 && high != 0) {
+                    writer.put(static_cast<uint32_t>(block[0] >> low) & 1, 1);
+                    return;
+                }
+                if (start == 0) {
+                    const int value = block[0] >> low;
+                    const int difference = value - predictions[c];
+                    predictions[c] = value;
+                    const uint32_t category = jpeg_category(difference);
+                    writer.put(dc.codes[category], dc.lengths[category]);
+                    writer.put(jpeg_value_bits(difference, category), category);
+                }
+                const int first_ac = std::max(start, 1);
+                if (end < first_ac) {
+                    return;
+                }
+                int run = 0;
+                for (int k = first_ac; k <= end; ++k) {
+                    if (block[k] == 0) {
+                        ++run;
+                        continue;
+                    }
+                    while (run > 15) {
+                        writer.put(ac.codes[0xF0], ac.lengths[0xF0]);
+                        run -= 16;
+                    }
+                    const uint32_t category = jpeg_category(block[k]);
+                    const uint32_t symbol = static_cast<uint32_t>(run << 4) | category;
+                    writer.put(ac.codes[symbol], ac.lengths[symbol]);
+                    writer.put(jpeg_value_bits(block[k], category), category);
+                    run = 0;
+                }
+                if (run > 0) {
+                    writer.put(ac.codes[0x00], ac.lengths[0x00]);
+                }
+            };
+
+            // Interleaved scans go MCU by MCU, a scan of one component goes block by block over the image
+            const bool interleaved = scan_components > 1;
+            const uint32_t units_x = interleaved ? mcus_x : components[first_component].used_blocks_x;
+            const uint32_t units_y = interleaved ? mcus_y : components[first_component].used_blocks_y;
+            uint32_t units = 0;
+            uint32_t restarts = 0;
+            for (uint32_t unit_y = 0; unit_y < units_y; ++unit_y) {
+                for (uint32_t unit_x = 0; unit_x < units_x; ++unit_x) {
+                    if (options.restart_interval && units != 0 && units % options.restart_interval == 0) {
+                        writer.flush();
+                        out.push_back(0xFF);
+                        out.push_back(static_cast<uint8_t>(0xD0 + restarts++ % 8));
+                        predictions[0] = predictions[1] = predictions[2] = 0;
+                    }
+                    ++units;
+                    for (uint32_t c = first_component; c < first_component + scan_components; ++c) {
+                        const Component& component = components[c];
+                        const uint32_t factor = interleaved ? component.factor : 1;
+                        for (uint32_t y = 0; y < factor; ++y) {
+                            for (uint32_t x = 0; x < factor; ++x) {
+                                const size_t block = static_cast<size_t>(unit_y * factor + y) * component.blocks_x + unit_x * factor + x;
+                                encode_block(c, &component.coefficients[block * 64]);
+                            }
+                        }
+                    }
+                }
+            }
+            writer.flush();
+        };
+
+        if (options.progressive) {
+            write_scan(0, component_count, 0, 0, 0, 1);
+            write_scan(0, component_count, 0, 0, 1, 0);
+            for (uint32_t c = 0; c < component_count; ++c) {
+                write_scan(c, 1, 1, 5, 0, 0);
+                write_scan(c, 1, 6, 63, 0, 0);
+            }
+        }
+        else {
+            write_scan(0, component_count, 0, 63, 0, 0);
+        }
+        out.push_back(0xFF);
+        out.push_back(0xD9);
+        return out;
+    }
+
+    /* PSD
+    * RGB color mode with 3 or more channels, 8 or 16 bits, raw or PackBits compressed. Channels past the fourth are
+    * there for the decoder to skip.
+    */
+    inline std::vector<uint8_t> encode_psd(const TestImage& image, const bool rle) {
+        std::vector<uint8_t> out;
+        put_bytes(out, "8BPS", 4);
+        put_u16_be(out, 1);
+        out.insert(out.end(), 6, 0);
+        put_u16_be(out, image.channels);
+        put_u32_be(out, image.height);
+        put_u32_be(out, image.width);
+        put_u16_be(out, image.bits);
+        put_u16_be(out, 3);
+        put_u32_be(out, 0);
+        put_u32_be(out, 4);
+        put_bytes(out, "\0\0\0\0", 4);      // Image resources, skipped by their size
+        put_u32_be(out, 0);
+        put_u16_be(out, rle ? 1 : 0);
+
+        const size_t bytes_per_sample = image.bits / 8;
+        std::vector<std::vector<uint8_t>> rows;
+        for (uint32_t c = 0; c < image.channels; ++c) {
+            for (uint32_t y = 0; y < image.height; ++y) {
+                std::vector<uint8_t> row;
+                for (uint32_t x = 0; x < image.width; ++x) {
+                    if (bytes_per_sample == 2) {
+                        put_u16_be(row, image.sample(x, y, c));
+                    }
+                    else {
+                        row.push_back(static_cast<uint8_t>(image.sample(x, y, c)));
+                    }
+                }
+                rows.push_back(row);
+            }
+        }
+        if (rle) {
+            std::vector<std::vector<uint8_t>> packed(rows.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                pack_bits(rows[i].data(), rows[i].size(), packed[i]);
+                put_u16_be(out, static_cast<uint32_t>(packed[i].size()));
+            }
+            for (const std::vector<uint8_t>& row : packed) {
+                put_bytes(out, row.data(), row.size());
+            }
+        }
+        else {
+            for (const std::vector<uint8_t>& row : rows) {
+                put_bytes(out, row.data(), row.size());
+            }
+        }
+        return out;
+    }
+
+    /* SOFTIMAGE PIC
+    * 8-bit RGB or RGBA in chained packets. Compression 0 is raw, 1 is runs of up to 255, 2 mixes raw and runs. With
+    * `separate_alpha`, alpha gets a packet of its own with the next compression.
+    */
+    inline void write_pic_row(const TestImage& image, const uint32_t y, const uint8_t compression, const uint32_t first_channel,
+                              const uint32_t channel_count, std::vector<uint8_t>& out) {
+        const auto same = [&](const uint32_t a, const uint32_t b) {
+            for (uint32_t c = first_channel; c < first_channel + channel_count; ++c) {
+                if (image.sample(a, y, c) != image.sample(b, y, c)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        const auto put_pixel = [&](const uint32_t x) {
+            for (uint32_t c = first_channel; c < first_channel + channel_count; ++c) {
+                out.push_back(static_cast<uint8_t>(image.sample(x, y, c)));
+            }
+        };
+        uint32_t x = 0;
+        while (x < image.width) {
+            uint32_t run = 1;
+            while (x + run < image.width && same(x, x + run) && run < 65535) {
+                ++run;
+            }
+            if (compression == 0) {
+                put_pixel(x++);
+            }
+            else if (compression == 1) {
+                run = std::min(run, 255u);
+                out.push_back(static_cast<uint8_t>(run));
+                put_pixel(x);
+                x += run;
+            }
+            else if (run >= 2) {
+                // A run of up to 128 in the count byte, longer ones after a 128
+                if (run <= 128) {
+                    out.push_back(static_cast<uint8_t>(run + 127));
+                }
+                else {
+                    out.push_back(128);
+                    put_u16_be(out, run);
+                }
+                put_pixel(x);
+                x += run;
+            }
+            else {
+                uint32_t literal = 1;
+                while (x + literal < image.width && literal < 128 && !(x + literal + 1 < image.width && same(x + literal, x + literal + 1))) {
+                    ++literal;
+                }
+                out.push_back(static_cast<uint8_t>(literal - 1));
+                for (uint32_t i = 0; i < literal; ++i) {
+                    put_pixel(x + i);
+                }
+                x += literal;
+            }
+        }
+    }
+
+    inline std::vector<uint8_t> encode_pic(const TestImage& image, const uint8_t compression, const bool separate_alpha) {
+        std::vector<uint8_t> out = { 0x53, 0x80, 0xF6, 0x34 };
+        put_u32_be(out, 0x40533333);        // Version 3.3 as a float
+        const char comment[80] = "made by test_images.h";
+        put_bytes(out, comment, sizeof(comment));
+        put_bytes(out, "PICT", 4);
+        put_u16_be(out, image.width);
+        put_u16_be(out, image.height);
+        put_u32_be(out, 0x3F800000);        // Pixel ratio 1.0
+        put_u16_be(out, 3);                 // Both fields
+        put_u16_be(out, 0);
+
+        const bool alpha = image.channels == 4;
+        const bool alpha_packet = alpha && separate_alpha;
+        const uint8_t alpha_compression = static_cast<uint8_t>((compression + 1) % 3);
+        out.insert(out.end(), { static_cast<uint8_t>(alpha_packet ? 1 : 0), 8, compression, static_cast<uint8_t>(alpha && !alpha_packet ? 0xF0 : 0xE0) });
+        if (alpha_packet) {
+            out.insert(out.end(), { 0, 8, alpha_compression, 0x10 });
+        }
+        for (uint32_t y = 0; y < image.height; ++y) {
+            write_pic_row(image, y, compression, 0, alpha && !alpha_packet ? 4 : 3, out);
+            if (alpha_packet) {
+                write_pic_row(image, y, alpha_compression, 3, 1, out);
+            }
+        }
+        return out;
+    }
+
+    // PGM or PPM, with samples up to `max_value`, which stb_image only reads up to 255
+    inline std::vector<uint8_t> encode_pnm(const TestImage& image, const uint32_t max_value, const bool comment) {
+        std::string header = image.channels == 1 ? "P5\n" : "P6\n";
+        if (comment) {
+            header += "# made by test_images.h\n";
+        }
+        header += std::to_string(image.width) + " " + std::to_string(image.height) + "\n" + std::to_string(max_value) + "\n";
+        std::vector<uint8_t> out(header.begin(), header.end());
+        for (uint32_t y = 0; y < image.height; ++y) {
+            for (uint32_t x = 0; x < image.width; ++x) {
+                for (uint32_t c = 0; c < image.channels; ++c) {
+                    const uint32_t value = image.sample(x, y, c) * max_value / ((1u << image.bits) - 1);
+                    if (max_value > 255) {
+                        put_u16_be(out, value);
+                    }
+                    else {
+                        out.push_back(static_cast<uint8_t>(value));
+                    }
+                }
+            }
+        }
+        return out;
+    }
+
+    /* TGA
+    * `pixel_bits` is 8 (gray, or indices when paletted), 15, 16, 24 or 32. RLE packets mix runs and raw pixels. Rows go
+    * bottom to top unless `top_left`.
+    */
+    struct TgaOptions {
+        uint32_t pixel_bits = 32;
+        bool paletted = false;
+        bool rle = false;
+        bool top_left = false;
+    };
+
+    inline void put_tga_pixel(const TestImage& image, const uint32_t x, const uint32_t y, const TgaOptions& options, std::vector<uint8_t>& out) {
+        if (options.pixel_bits == 8) {
+            out.push_back(options.paletted ? static_cast<uint8_t>(image.sample(x, y, 0)) : sample_8(image, x, y, 0));
+            return;
+        }
+        const uint8_t r = sample_8(image, x, y, 0);
+        const uint8_t g = sample_8(image, x, y, image.channels >= 3 ? 1 : 0);
+        const uint8_t b = sample_8(image, x, y, image.channels >= 3 ? 2 : 0);
+        const uint8_t a = image.channels == 4 || image.channels == 2 ? sample_8(image, x, y, image.channels - 1) : 255;
+        if (options.pixel_bits <= 16) {
+            put_u16_le(out, static_cast<uint32_t>((a >= 128 ? 0x8000 : 0) | (r >> 3) << 10 | (g >> 3) << 5 | (b >> 3)));
+        }
+        else {
+            out.insert(out.end(), { b, g, r });
+            if (options.pixel_bits == 32) {
+                out.push_back(a);
+            }
+        }
+    }
+
+    inline std::vector<uint8_t> encode_tga(const TestImage& image, const TgaOptions& options = {}) {
+        const uint8_t base_type = options.paletted ? 1 : (options.pixel_bits == 8 ? 3 : 2);
+        std::vector<uint8_t> out;
+        const char id[] = "test";
+        out.push_back(sizeof(id) - 1);
+        out.push_back(options.paletted ? 1 : 0);
+        out.push_back(static_cast<uint8_t>(base_type + (options.rle ? 8 : 0)));
+        const std::vector<uint8_t> palette = make_test_palette(options.paletted ? image.bits : 1);
+        put_u16_le(out, 0);
+        put_u16_le(out, options.paletted ? static_cast<uint32_t>(palette.size() / 4) : 0);
+        out.push_back(options.paletted ? 24 : 0);
+        put_u16_le(out, 0);
+        put_u16_le(out, 0);
+        put_u16_le(out, image.width);
+        put_u16_le(out, image.height);
+        out.push_back(static_cast<uint8_t>(options.pixel_bits));
+        out.push_back(static_cast<uint8_t>((options.top_left ? 0x20 : 0) | (options.pixel_bits == 32 ? 8 : options.pixel_bits == 16 ? 1 : 0)));
+        put_bytes(out, id, sizeof(id) - 1);
+        if (options.paletted) {
+            for (size_t i = 0; i < palette.size(); i += 4) {
+                out.insert(out.end(), { palette[i + 2], palette[i + 1], palette[i] });
+            }
+        }
+
+        for (uint32_t row = 0; row < image.height; ++row) {
+            const uint32_t y = options.top_left ? row : image.height - 1 - row;
+            uint32_t x = 0;
+            while (x < image.width) {
+                if (!options.rle) {
+                    put_tga_pixel(image, x++, y, options, out);
+                    continue;
+                }
+                // Packets don't cross rows, so the runs are found in the encoded pixels of this row
+                std::vector<uint8_t> first;
+                put_tga_pixel(image, x, y, options, first);
+                uint32_t run = 1;
+                while (x + run < image.width && run < 128) {
+                    std::vector<uint8_t> next;
+                    put_tga_pixel(image, x + run, y, options, next);
+                    if (next != first) {
+                        break;
+                    }
+                    ++run;
+                }
+                if (run >= 2) {
+                    out.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+                    put_bytes(out, first.data(), first.size());
+                    x += run;
+                }
+                else {
+                    const uint32_t literal = std::min(image.width - x, 3u);
+                    out.push_back(static_cast<uint8_t>(literal - 1));
+                    for (uint32_t i = 0; i < literal; ++i) {
+                        put_tga_pixel(image, x + i, y, options, out);
+                    }
+                    x += literal;
+                }
+            }
+        }
+        return out;
+    }
+
+    /* BMP
+    * `pixel_bits` is 1, 4 or 8 (the image is indices into a palette), 16 (5:5:5), 24, or 32 with a V4 header that has
+    * BI_BITFIELDS masks and alpha. Rows are padded to 4 bytes and go bottom to top unless `top_down`.
+    */
+    inline std::vector<uint8_t> encode_bmp(const TestImage& image, const uint32_t pixel_bits, const bool top_down) {
+        const bool paletted = pixel_bits <= 8;
+        const bool bitfields = pixel_bits == 32;
+        const uint32_t palette_size = paletted ? (1u << pixel_bits) * 4 : 0;
+        const uint32_t header_size = bitfields ? 108 : 40;
+        const uint32_t row_size = (image.width * pixel_bits + 31) / 32 * 4;
+        const uint32_t data_offset = 14 + header_size + palette_size;
+
+        std::vector<uint8_t> out = { 'B', 'M' };
+        put_u32_le(out, data_offset + row_size * image.height);
+        put_u32_le(out, 0);
+        put_u32_le(out, data_offset);
+        put_u32_le(out, header_size);
+        put_u32_le(out, image.width);
+        put_u32_le(out, top_down ? static_cast<uint32_t>(-static_cast<int32_t>(image.height)) : image.height);
+        put_u16_le(out, 1);
+        put_u16_le(out, pixel_bits);
+        put_u32_le(out, bitfields ? 3 : 0);
+        put_u32_le(out, row_size * image.height);
+        put_u32_le(out, 2835);
+        put_u32_le(out, 2835);
+        put_u32_le(out, paletted ? 1u << pixel_bits : 0);
+        put_u32_le(out, 0);
+        if (bitfields) {
+            put_u32_le(out, 0x00FF0000);
+            put_u32_le(out, 0x0000FF00);
+            put_u32_le(out, 0x000000FF);
+            put_u32_le(out, 0xFF000000);
+            put_bytes(out, "BGRs", 4);
+            out.insert(out.end(), 48, 0);   // Endpoints and gammas, unused for sRGB
+        }
+        if (paletted) {
+            const std::vector<uint8_t> palette = make_test_palette(pixel_bits);
+            for (size_t i = 0; i < palette.size(); i += 4) {
+                out.insert(out.end(), { palette[i + 2], palette[i + 1], palette[i], 0 });
+            }
+        }
+
+        for (uint32_t row = 0; row < image.height; ++row) {
+            const uint32_t y = top_down ? row : image.height - 1 - row;
+            std::vector<uint8_t> data(row_size, 0);
+            for (uint32_t x = 0; x < image.width; ++x) {
+                if (paletted) {
+                    const size_t bit = static_cast<size_t>(x) * pixel_bits;
+                    data[bit / 8] |= static_cast<uint8_t>(image.sample(x, y, 0) << (8 - pixel_bits - bit % 8));
+                    continue;
+                }
+                const uint8_t r = sample_8(image, x, y, 0);
+                const uint8_t g = sample_8(image, x, y, image.channels >= 3 ? 1 : 0);
+                const uint8_t b = sample_8(image, x, y, image.channels >= 3 ? 2 : 0);
+                const uint8_t a = image.channels == 4 ? sample_8(image, x, y, 3) : 255;
+                uint8_t* pixel = &data[static_cast<size_t>(x) * pixel_bits / 8];
+                if (pixel_bits == 16) {
+                    const uint32_t value = (r >> 3) << 10 | (g >> 3) << 5 | (b >> 3);
+                    pixel[0] = static_cast<uint8_t>(value);
+                    pixel[1] = static_cast<uint8_t>(value >> 8);
+                }
+                else {
+                    pixel[0] = b;
+                    pixel[1] = g;
+                    pixel[2] = r;
+                    if (pixel_bits == 32) {
+                        pixel[3] = a;
+                    }
+                }
+            }
+            put_bytes(out, data.data(), data.size());
+        }
+        return out;
+    }
+
+    /* RADIANCE HDR
+    * RGBE pixels from the image, scaled up to `max_value`. With `rle`, rows are in the new run-length format, which
+    * stb_image only takes for widths from 8 to 32767, so narrower images are always flat.
+    */
+    inline std::vector<uint8_t> encode_hdr(const TestImage& image, const float max_value, const bool rle) {
+        const std::string header = "#?RADIANCE\n# made by test_images.h\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(image.height) + " +X " +
+                                   std::to_string(image.width) + "\n";
+        std::vector<uint8_t> out(header.begin(), header.end());
+        const float scale = max_value / static_cast<float>((1u << image.bits) - 1);
+        const bool rle_rows = rle && image.width >= 8 && image.width < 32768;
+        std::vector<uint8_t> rgbe(static_cast<size_t>(image.width) * 4);
+        for (uint32_t y = 0; y < image.height; ++y) {
+            for (uint32_t x = 0; x < image.width; ++x) {
+                float color[3];
+                for (uint32_t c = 0; c < 3; ++c) {
+                    color[c] = static_cast<float>(image.sample(x, y, std::min(c, image.channels - 1))) * scale;
+                }
+                const float largest = std::max(color[0], std::max(color[1], color[2]));
+                uint8_t* pixel = &rgbe[static_cast<size_t>(x) * 4];
+                if (largest < 1e-32f) {
+                    pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+                    continue;
+                }
+                int exponent;
+                const float mantissa = frexpf(largest, &exponent) * 256.0f / largest;
+                for (int c = 0; c < 3; ++c) {
+                    pixel[c] = static_cast<uint8_t>(color[c] * mantissa);
+                }
+                pixel[3] = static_cast<uint8_t>(exponent + 128);
+            }
+            if (!rle_rows) {
+                put_bytes(out, rgbe.data(), rgbe.size());
+                continue;
+            }
+            out.insert(out.end(), { 2, 2 });
+            put_u16_be(out, image.width);
+            for (int c = 0; c < 4; ++c) {
+                uint32_t x = 0;
+                while (x < image.width) {
+                    uint32_t run = 1;
+                    while (x + run < image.width && run < 127 && rgbe[(x + run) * 4 + c] == rgbe[x * 4 + c]) {
+                        ++run;
+                    }
+                    if (run >= 3) {
+                        out.push_back(static_cast<uint8_t>(128 + run));
+                        out.push_back(rgbe[x * 4 + c]);
+                        x += run;
+                        continue;
+                    }
+                    const uint32_t literal = std::min(image.width - x, 128u);
+                    out.push_back(static_cast<uint8_t>(literal));
+                    for (uint32_t i = 0; i < literal; ++i) {
+                        out.push_back(rgbe[(x + i) * 4 + c]);
+                    }
+                    x += literal;
+                }
+            }
+        }
+        return out;
+    }
+
+    /* GIF
+    * `frame_count` frames of the image's indices (up to 8 bits), each shifted by a pixel. The LZW codes are written
+    * without ever growing the code size, with a clear code whenever the table would, so every frame is valid
+    * without an LZW compressor. Later frames have their own color table and a transparent color.
+    */
+    inline std::vector<uint8_t> encode_gif(const TestImage& image, const bool interlaced, const uint32_t frame_count) {
+        const uint32_t bits = std::max(2u, image.bits);
+        const std::vector<uint8_t> palette = make_test_palette(bits);
+        std::vector<uint8_t> out;
+        put_bytes(out, "GIF89a", 6);
+        put_u16_le(out, image.width);
+        put_u16_le(out, image.height);
+        out.push_back(static_cast<uint8_t>(0x80 | 0x70 | (bits - 1)));
+        out.push_back(0);
+        out.push_back(0);
+        for (size_t i = 0; i < palette.size(); i += 4) {
+            put_bytes(out, &palette[i], 3);
+        }
+
+        for (uint32_t frame = 0; frame < frame_count; ++frame) {
+            out.insert(out.end(), { 0x21, 0xF9, 4, static_cast<uint8_t>(frame > 0 ? 0x09 : 0x04), 10, 0, static_cast<uint8_t>(frame), 0 });
+            out.push_back(0x2C);
+            put_u16_le(out, 0);
+            put_u16_le(out, 0);
+            put_u16_le(out, image.width);
+            put_u16_le(out, image.height);
+            out.push_back(static_cast<uint8_t>((frame > 0 ? 0x80 | (bits - 1) : 0) | (interlaced ? 0x40 : 0)));
+            if (frame > 0) {
+                for (size_t i = 0; i < palette.size(); i += 4) {
+                    out.insert(out.end(), { palette[i + 2], palette[i + 1], palette[i] });
+                }
+            }
+
+            // Rows in the order they're stored: interlaced is every 8th row from 0, every 8th from 4, every 4th from
+            // 2, then every 2nd from 1
+            std::vector<uint32_t> rows;
+            if (interlaced) {
+                const uint32_t starts[4] = { 0, 4, 2, 1 };
+                const uint32_t steps[4] = { 8, 8, 4, 2 };
+                for (int pass = 0; pass < 4; ++pass) {
+                    for (uint32_t y = starts[pass]; y < image.height; y += steps[pass]) {
+                        rows.push_back(y);
+                    }
+                }
+            }
+            else {
+                for (uint32_t y = 0; y < image.height; ++y) {
+                    rows.push_back(y);
+                }
+            }
+
+            const uint32_t clear = 1u << bits;
+            const uint32_t code_bits = bits + 1;
+            std::vector<uint8_t> codes;
+            uint32_t accumulator = 0;
+            uint32_t accumulated_bits = 0;
+            const auto put_code = [&](const uint32_t code) {
+                accumulator |= code << accumulated_bits;
+                accumulated_bits += code_bits;
+                while (accumulated_bits >= 8) {
+                    codes.push_back(static_cast<uint8_t>(accumulator));
+                    accumulator >>= 8;
+                    accumulated_bits -= 8;
+                }
+            };
+            put_code(clear);
+            uint32_t since_clear = 0;
+            for (const uint32_t y : rows) {
+                for (uint32_t x = 0; x < image.width; ++x) {
+                    if (since_clear == clear - 2) {
+                        put_code(clear);
+                        since_clear = 0;
+                    }
+                    put_code(image.sample((x + frame) % image.width, y, 0) & (clear - 1));
+                    ++since_clear;
+                }
+            }
+            put_code(clear + 1);
+            if (accumulated_bits > 0) {
+                codes.push_back(static_cast<uint8_t>(accumulator));
+            }
+
+            out.push_back(static_cast<uint8_t>(bits));
+            for (size_t offset = 0; offset < codes.size(); offset += 255) {
+                const size_t size = std::min<size_t>(255, codes.size() - offset);
+                out.push_back(static_cast<uint8_t>(size));
+                put_bytes(out, &codes[offset], size);
+            }
+            out.push_back(0);
+        }
+        out.push_back(0x3B);
+        return out;
+    }
+}
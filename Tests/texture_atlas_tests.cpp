@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "file_io.h"
+#include "test_common.h"
+#include "texture_atlas.h"
+#include "texture_loader.h"
+
+/* TEXTURE ATLAS TESTS
+* Packs random rectangles and checks that no two padded rectangles overlap, that they're aligned for the mips and that
+* the UV remap table matches the entries. Then builds small atlases from pixels and from files and checks the pixels
+* and borders that end up in the pages.
+*/
+
+namespace {
+    uint32_t random_u32(uint32_t& seed) {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    }
+
+    void test_packing() {
+        AtlasSettings settings;
+        settings.page_width = 512;
+        settings.page_height = 256;
+        settings.padding = 2;
+        settings.mip_levels = 3;
+
+        uint32_t seed = 7;
+        std::vector<AtlasImage> images(3000);
+        for (AtlasImage& image : images) {
+            image.width = 1 + random_u32(seed) % 40;
+            image.height = 1 + random_u32(seed) % 40;
+        }
+        images[10].width = 600; // Too wide for a page
+
+        TextureAtlas atlas;
+        atlas.settings = settings;
+        uint32_t page_count = 0;
+        CHECK(!pack_atlas_rectangles(images, atlas, page_count));
+        CHECK(atlas.stats.failed_images == 1);
+        CHECK(atlas.entries[10].page == UINT32_MAX);
+        CHECK(atlas.uv_remap[10].page == UINT32_MAX);
+        CHECK(atlas.stats.efficiency() > 0.8f);
+        if (!CHECK(atlas.entries.size() == images.size() && atlas.uv_remap.size() == images.size())) {
+            return;
+        }
+
+        // Mark every padded rectangle in a coverage map, any texel marked twice is an overlap
+        std::vector<uint8_t> coverage(static_cast<size_t>(page_count) * settings.page_width * settings.page_height, 0);
+        uint32_t overlaps = 0;
+        for (size_t i = 0; i < images.size(); ++i) {
+            const AtlasEntry& entry = atlas.entries[i];
+            const AtlasUvRemap& remap = atlas.uv_remap[i];
+            if (entry.page == UINT32_MAX) {
+                continue;
+            }
+            CHECK(entry.page < page_count);
+            CHECK(entry.width == images[i].width && entry.height == images[i].height);
+            CHECK((entry.x - settings.padding) % 4 == 0 && (entry.y - settings.padding) % 4 == 0);
+            CHECK(remap.page == entry.page && remap.scale == entry.uv_scale && remap.offset == entry.uv_offset);
+
+            const glm::vec2 corner = remap_uv(entry, glm::vec2(1.0f));
+            CHECK(corner.x == static_cast<float>(entry.x + entry.width) / settings.page_width);
+            CHECK(corner.y == static_cast<float>(entry.y + entry.height) / settings.page_height);
+
+            const uint32_t x0 = entry.x - settings.padding;
+            const uint32_t y0 = entry.y - settings.padding;
+            const uint32_t x1 = entry.x + entry.width + settings.padding;
+            const uint32_t y1 = entry.y + entry.height + settings.padding;
+            if (!CHECK(x1 <= settings.page_width && y1 <= settings.page_height)) {
+                continue;
+            }
+            for (uint32_t y = y0; y < y1; ++y) {
+                for (uint32_t x = x0; x < x1; ++x) {
+                    uint8_t& texel = coverage[(static_cast<size_t>(entry.page) * settings.page_height + y) * settings.page_width + x];
+                    overlaps += texel;
+                    texel = 1;
+                }
+            }
+        }
+        CHECK(overlaps == 0);
+    }
+
+    void test_pixels_and_borders() {
+        // A 3x2 image with a different color in every pixel
+        uint8_t pixels[3 * 2 * 4];
+        for (uint8_t i = 0; i < sizeof(pixels); ++i) {
+            pixels[i] = static_cast<uint8_t>(i * 9 + 1);
+        }
+        std::vector<AtlasImage> images = { AtlasImage{ 3, 2, pixels }, AtlasImage{ 3, 2, pixels } };
+        AtlasSettings settings;
+        settings.page_width = 32;
+        settings.page_height = 32;
+        settings.padding = 2;
+
+        TextureAtlas atlas;
+        if (!CHECK(build_atlas(images, settings, atlas)) || !CHECK(atlas.pages.size() == 1)) {
+            return;
+        }
+        const uint8_t* page = atlas.pages[0].pixels.data();
+        for (const AtlasEntry& entry : atlas.entries) {
+            // Every texel of the padded rectangle is the closest pixel of the image
+            for (int y = -2; y < 4; ++y) {
+                for (int x = -2; x < 5; ++x) {
+                    const int source_x = std::min(std::max(x, 0), 2);
+                    const int source_y = std::min(std::max(y, 0), 1);
+                    const uint8_t* texel = page + ((entry.y + y) * settings.page_width + entry.x + x) * 4;
+                    CHECK(memcmp(texel, pixels + (source_y * 3 + source_x) * 4, 4) == 0);
+                }
+            }
+        }
+    }
+
+    void test_mesh_remap() {
+        uint8_t pixel[4] = { 255, 255, 255, 255 };
+        std::vector<AtlasImage> images = { AtlasImage{ 1, 1, pixel }, AtlasImage{ 0, 0, nullptr }, AtlasImage{ 1, 1, pixel } };
+        TextureAtlas atlas;
+        build_atlas(images, AtlasSettings{}, atlas);
+
+        glm::vec2 texcoords[3] = { { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 0.5f, 0.25f } };
+        const uint32_t image_indices[3] = { 0, 2, 2 };
+        CHECK(remap_mesh_uvs(atlas, image_indices, texcoords, 3));
+        CHECK(texcoords[0] == atlas.entries[0].uv_offset);
+        CHECK(texcoords[1] == remap_uv(atlas.entries[2], glm::vec2(1.0f)));
+        CHECK(texcoords[2] == remap_uv(atlas.entries[2], glm::vec2(0.5f, 0.25f)));
+
+        // Image 1 failed, so nothing gets remapped
+        glm::vec2 unchanged[2] = { { 0.5f, 0.5f }, { 0.5f, 0.5f } };
+        const uint32_t bad_indices[2] = { 0, 1 };
+        CHECK(!remap_mesh_uvs(atlas, bad_indices, unchanged, 2));
+        CHECK(unchanged[0] == glm::vec2(0.5f));
+
+        const std::string path = (std::filesystem::temp_directory_path() / "texture_atlas_tests.atuv").string();
+        CHECK(write_uv_remap_table(atlas, path));
+        size_t size = 0;
+        char* data = nullptr;
+        read_file(path, size, data, false);
+        std::filesystem::remove(path);
+        if (CHECK(data != nullptr && size == 8 + 3 * sizeof(AtlasUvRemap))) {
+            uint32_t count = 0;
+            memcpy(&count, data + 4, sizeof(count));
+            CHECK(memcmp(data, "ATUV", 4) == 0 && count == 3);
+            CHECK(memcmp(data + 8, atlas.uv_remap.data(), 3 * sizeof(AtlasUvRemap)) == 0);
+        }
+        free(data);
+    }
+
+    void test_from_files() {
+        // Enough files that the decode is split over several threads, with broken ones in between
+        const std::string corpus = TEST_DATA_DIR "/Fuzz/corpus/texture_loader_fuzz/";
+        std::vector<std::string> paths;
+        for (int i = 0; i < 16; ++i) {
+            paths.push_back(corpus + "png_rgba8_33x17.png");
+            paths.push_back(corpus + "png_rgba8_split_idat_truncated.png");
+            paths.push_back(corpus + "bmp_24_33x17.bmp");
+            paths.push_back(corpus + "missing.png");
+        }
+        TextureAtlas atlas;
+        CHECK(!build_atlas_from_files(paths, AtlasSettings{}, atlas));
+        CHECK(atlas.stats.failed_images == 32);
+
+        DecodedImage expected;
+        if (!CHECK(load_image(corpus + "png_rgba8_33x17.png", 4, expected))) {
+            return;
+        }
+        for (size_t i = 0; i < paths.size(); ++i) {
+            const AtlasEntry& entry = atlas.entries[i];
+            CHECK((entry.page != UINT32_MAX) == (i % 4 == 0 || i % 4 == 2));
+            if (i % 4 != 0 || entry.page == UINT32_MAX) {
+                continue;
+            }
+            const uint8_t* page = atlas.pages[entry.page].pixels.data();
+            for (uint32_t y = 0; y < entry.height; ++y) {
+                const uint8_t* row = page + ((static_cast<size_t>(entry.y) + y) * atlas.settings.page_width + entry.x) * 4;
+                CHECK(memcmp(row, static_cast<const uint8_t*>(expected.pixels) + y * expected.width * 4, entry.width * 4) == 0);
+            }
+        }
+        free_image(expected);
+    }
+}
+
+int main() {
+    test_packing();
+    test_pixels_and_borders();
+    test_mesh_remap();
+    test_from_files();
+    return test::test_result();
+}
@@ -0,0 +1,283 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "test_common.h"
+#include "test_images.h"
+#include "texture_convert.h"
+#include "texture_loader.h"
+
+/* TEXTURE CONVERSION TESTS
+* The conversions are checked bit for bit against straightforward reference versions that follow the D3D rules with
+* doubles, instead of against themselves. Half conversion is checked for every float whose bits are a multiple of
+* 64 apart, which hits every half, every rounding tie and both sides of it, and the SSE2 path against the scalar one.
+* 16-bit PNGs, which stb_image byte swaps with swap_bytes_16(), have to decode to exactly the samples they were written
+* with.
+*/
+
+namespace {
+    float bits_float(const uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Round to nearest even, with the exponent found the slow way
+    uint16_t reference_float_to_half(const float value) {
+        const uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+        if (std::isnan(value)) {
+            return sign | 0x7E00;
+        }
+        const double absolute = std::fabs(static_cast<double>(value));
+        if (absolute >= 65520.0) {
+            return sign | 0x7C00;
+        }
+        if (absolute == 0.0) {
+            return sign;
+        }
+        int exponent = static_cast<int>(std::floor(std::log2(absolute)));
+        if (exponent < -14) {
+            exponent = -14;
+        }
+        const double ulp = std::ldexp(1.0, exponent - 10);
+        auto mantissa = static_cast<uint32_t>(std::nearbyint(absolute / ulp));
+        if (mantissa == 2048) {
+            mantissa = 1024;
+            exponent++;
+        }
+        if (mantissa < 1024) {
+            return static_cast<uint16_t>(sign | mantissa);
+        }
+        return static_cast<uint16_t>(sign | ((exponent + 15) << 10) | (mantissa - 1024));
+    }
+
+    // The formula from the D3D spec, with doubles
+    uint32_t reference_rgb9e5(const float red, const float green, const float blue) {
+        const auto clamp = [](const float value) {
+            return std::isnan(value) || value < 0.0f ? 0.0 : (value > 65408.0f ? 65408.0 : static_cast<double>(value));
+        };
+        const double r = clamp(red);
+        const double g = clamp(green);
+        const double b = clamp(blue);
+        const double max_channel = std::fmax(r, std::fmax(g, b));
+        int exponent = (max_channel > 0.0 ? std::max(-16, static_cast<int>(std::floor(std::log2(max_channel)))) : -16) + 1 + 15;
+        double denominator = std::ldexp(1.0, exponent - 15 - 9);
+        if (static_cast<int>(std::floor(max_channel / denominator + 0.5)) == 512) {
+            denominator *= 2.0;
+            exponent++;
+        }
+        return static_cast<uint32_t>(std::floor(r / denominator + 0.5))
+            | (static_cast<uint32_t>(std::floor(g / denominator + 0.5)) << 9)
+            | (static_cast<uint32_t>(std::floor(b / denominator + 0.5)) << 18)
+            | (static_cast<uint32_t>(exponent) << 27);
+    }
+
+    DecodedImage make_image(void* pixels, const int width, const int channels, const int bytes_per_channel) {
+        DecodedImage image;
+        image.width = width;
+        image.height = 1;
+        image.channels = channels;
+        image.bytes_per_channel = bytes_per_channel;
+        image.pixels = pixels;
+        return image;
+    }
+
+    void test_float_to_half() {
+        constexpr uint32_t step = 64;
+        std::vector<float> values;
+        values.reserve(1 << 20);
+        std::vector<uint16_t> halves;
+        uint64_t mismatches = 0;
+        uint64_t simd_mismatches = 0;
+        for (uint64_t base = 0; base < (1ull << 32); base += step << 20) {
+            values.clear();
+            // Odd counts, so the scalar tail of the SSE2 version runs too
+            for (uint64_t bits = base; bits < base + (step << 20) - step; bits += step) {
+                values.push_back(bits_float(static_cast<uint32_t>(bits)));
+            }
+            halves.resize(values.size());
+            float_to_half(values.data(), halves.data(), values.size());
+            for (size_t i = 0; i < values.size(); ++i) {
+                const uint16_t half = float_to_half(values[i]);
+                mismatches += half != reference_float_to_half(values[i]);
+                simd_mismatches += half != halves[i];
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(simd_mismatches == 0);
+
+        CHECK(float_to_half(65504.0f) == 0x7BFF);
+        CHECK(float_to_half(65519.99f) == 0x7BFF);
+        CHECK(float_to_half(65520.0f) == 0x7C00);
+        CHECK(float_to_half(-INFINITY) == 0xFC00);
+        CHECK(float_to_half(std::ldexp(1.0f, -24)) == 0x0001);
+        CHECK(float_to_half(std::ldexp(1.0f, -25)) == 0x0000); // A tie, rounds to even
+        CHECK(float_to_half(-0.0f) == 0x8000);
+    }
+
+    void test_rgb9e5() {
+        const float special[] = { 0.0f, -0.0f, -1.0f, NAN, INFINITY, 65408.0f, 65504.0f, 1.0f, 0.5f, 511.0f / 512.0f,
+                                  std::ldexp(1.0f, -24), std::ldexp(1.0f, -15), std::ldexp(511.5f, -24), 1e-30f };
+        for (const float r : special) {
+            for (const float g : special) {
+                for (const float b : special) {
+                    CHECK(float3_to_rgb9e5(r, g, b) == reference_rgb9e5(r, g, b));
+                }
+            }
+        }
+
+        // Random finite colors across the whole range
+        uint32_t seed = 1;
+        uint64_t mismatches = 0;
+        for (int i = 0; i < 1000000; ++i) {
+            float channels[3];
+            for (float& channel : channels) {
+                seed = seed * 1664525u + 1013904223u;
+                channel = std::ldexp(static_cast<float>(seed >> 8) / 16777216.0f, static_cast<int>(seed % 48) - 30);
+            }
+            mismatches += float3_to_rgb9e5(channels[0], channels[1], channels[2]) != reference_rgb9e5(channels[0], channels[1], channels[2]);
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void test_srgb() {
+        CHECK(srgb_to_linear(0) == 0.0f);
+        CHECK(srgb_to_linear(255) == 1.0f);
+        for (int i = 1; i < 256; ++i) {
+            CHECK(srgb_to_linear(static_cast<uint8_t>(i)) > srgb_to_linear(static_cast<uint8_t>(i - 1)));
+            const double c = i / 255.0;
+            const double expected = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            CHECK(std::fabs(srgb_to_linear(static_cast<uint8_t>(i)) - expected) < 1e-6);
+        }
+    }
+
+    void test_convert_8_bit() {
+        // Every value through every channel count, 8-bit stays exactly as it was
+        uint8_t pixels[256 * 4];
+        for (int i = 0; i < 256 * 4; ++i) {
+            pixels[i] = static_cast<uint8_t>(i * 7);
+        }
+        for (int channels = 1; channels <= 4; ++channels) {
+            const DecodedImage image = make_image(pixels, 256, channels, 1);
+            uint8_t output[256 * 4];
+            CHECK(convert_image(image, TextureFormat::r8g8b8a8_unorm, false, output, sizeof(output)));
+            for (int x = 0; x < 256; ++x) {
+                const uint8_t* pixel = pixels + x * channels;
+                const uint8_t expected[4] = {
+                    pixel[0],
+                    pixel[channels >= 3 ? 1 : 0],
+                    pixel[channels >= 3 ? 2 : 0],
+                    channels == 2 ? pixel[1] : (channels == 4 ? pixel[3] : uint8_t(255)),
+                };
+                CHECK(memcmp(output + x * 4, expected, 4) == 0);
+            }
+
+            // sRGB to half goes through a table, which has to match converting the linear float
+            uint16_t halves[256 * 4];
+            CHECK(convert_image(image, TextureFormat::r16g16b16a16_float, true, halves, sizeof(halves)));
+            for (int x = 0; x < 256; ++x) {
+                CHECK(halves[x * 4] == float_to_half(srgb_to_linear(pixels[x * channels])));
+            }
+        }
+    }
+
+    void test_convert_16_bit() {
+        // Every 16-bit value to 8-bit, rounded to nearest
+        std::vector<uint16_t> pixels(65536);
+        for (uint32_t i = 0; i < 65536; ++i) {
+            pixels[i] = static_cast<uint16_t>(i);
+        }
+        std::vector<uint8_t> output(65536 * 4);
+        CHECK(convert_image(make_image(pixels.data(), 65536, 1, 2), TextureFormat::r8g8b8a8_unorm, false, output.data(), output.size()));
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < 65536; ++i) {
+            mismatches += output[i * 4] != static_cast<uint8_t>(std::floor(i * 255.0 / 65535.0 + 0.5));
+        }
+        CHECK(mismatches == 0);
+
+        // Heightfields keep their exact values
+        std::vector<uint16_t> heights(65536);
+        CHECK(convert_image(make_image(pixels.data(), 65536, 1, 2), TextureFormat::r16_unorm, false, heights.data(), heights.size() * 2));
+        CHECK(heights == pixels);
+
+        std::vector<uint16_t> swapped(65535);
+        swap_bytes_16(pixels.data(), swapped.data(), swapped.size());
+        mismatches = 0;
+        for (uint32_t i = 0; i < swapped.size(); ++i) {
+            mismatches += swapped[i] != static_cast<uint16_t>((i >> 8) | ((i & 0xFF) << 8));
+        }
+        CHECK(mismatches == 0);
+
+        // In place, like stb_image does it
+        swap_bytes_16(swapped.data(), swapped.data(), swapped.size());
+        CHECK(memcmp(swapped.data(), pixels.data(), swapped.size() * 2) == 0);
+    }
+
+    // Odd sizes, so the pixel count isn't a multiple of the SSE2 width, and interlaced, which is swapped after the
+    // passes are put together
+    void test_decode_16_bit_png() {
+        for (const uint32_t channels : { 1u, 2u, 3u, 4u }) {
+            for (const bool interlaced : { false, true }) {
+                const test::TestImage source = test::make_test_image(13, 7, channels, 16, channels);
+                test::PngOptions options;
+                options.interlaced = interlaced;
+                const std::vector<uint8_t> png = test::encode_png(source, options);
+
+                DecodedImage image;
+                if (!CHECK(decode_image_full_precision(png.data(), png.size(), image))) {
+                    continue;
+                }
+                CHECK(image.width == 13 && image.height == 7);
+                CHECK(image.channels == static_cast<int>(channels) && image.bytes_per_channel == 2);
+                CHECK(memcmp(image.pixels, source.samples.data(), source.samples.size() * 2) == 0);
+                free_image(image);
+
+                // Expanded to 4 channels by stb_image after the swap
+                if (!CHECK(decode_image(png.data(), png.size(), 4, image, nullptr, {}, true))) {
+                    continue;
+                }
+                const uint16_t* pixels = static_cast<const uint16_t*>(image.pixels);
+                uint32_t mismatches = 0;
+                for (uint32_t i = 0; i < 13 * 7; ++i) {
+                    const uint16_t* pixel = &source.samples[i * channels];
+                    const uint16_t gray = pixel[0];
+                    const uint16_t expected[4] = { channels >= 3 ? pixel[0] : gray, channels >= 3 ? pixel[1] : gray, channels >= 3 ? pixel[2] : gray,
+                                                   channels == 2 || channels == 4 ? pixel[channels - 1] : static_cast<uint16_t>(0xFFFF) };
+                    mismatches += memcmp(&pixels[i * 4], expected, sizeof(expected)) != 0;
+                }
+                CHECK(mismatches == 0);
+                free_image(image);
+            }
+        }
+    }
+
+    void test_convert_float() {
+        // Float goes to 8-bit in one rounding step, with NaN and out of range values clamped
+        float pixels[] = { 0.0f, 1.0f, 0.5f, 0.51f / 255.0f, 0.49f / 255.0f, -1.0f, 2.0f, NAN,
+                           127.49f / 255.0f, 254.51f / 255.0f, INFINITY, -INFINITY, 1e-30f };
+        const uint8_t expected[] = { 0, 255, 128, 1, 0, 0, 255, 0, 127, 255, 255, 0, 0 };
+        constexpr int count = sizeof(pixels) / sizeof(pixels[0]);
+        uint8_t output[count * 4];
+        CHECK(convert_image(make_image(pixels, count, 1, 4), TextureFormat::r8g8b8a8_unorm, false, output, sizeof(output)));
+        for (int i = 0; i < count; ++i) {
+            CHECK(output[i * 4] == expected[i]);
+            CHECK(output[i * 4 + 3] == 255);
+        }
+
+        uint32_t shared[count];
+        CHECK(convert_image(make_image(pixels, count, 1, 4), TextureFormat::r9g9b9e5_sharedexp, false, shared, sizeof(shared)));
+        for (int i = 0; i < count; ++i) {
+            CHECK(shared[i] == reference_rgb9e5(pixels[i], pixels[i], pixels[i]));
+        }
+    }
+}
+
+int main() {
+    test_float_to_half();
+    test_rgb9e5();
+    test_srgb();
+    test_convert_8_bit();
+    test_convert_16_bit();
+    test_decode_16_bit_png();
+    test_convert_float();
+    return test::test_result();
+}